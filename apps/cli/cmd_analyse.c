@@ -0,0 +1,240 @@
+/**
+ * cmd_analyse.c - Search a Set of Positions
+ *
+ * Usage: dama analyse [options] <positions.txt | ->
+ *        dama analyse [options] --dataset <data.bin>
+ *
+ * Searches every position with the same node budget through
+ * mcts_search_many (searches in parallel, one batched evaluator) and
+ * prints one line per position, in input order, as soon as it is known:
+ *
+ *   <index> bestmove <m> value <v> visits <n> moves <m>:<visits>...
+ *
+ * value is for the side to move, in [-1, 1]; moves are most visited
+ * first. A position without a move prints "<index> bestmove none".
+ * Position lines use the server's syntax (search_server.h), with or
+ * without the "position" keyword; blank lines and '#' comments are skipped.
+ *
+ * Options:
+ *   -w <weights>     Search with this network (default: no network, Grandmaster)
+ *   -n <nodes>       Nodes per position (default: 800)
+ *   -t <threads>     Searches at once (default: all cores)
+ *   --limit <n>      Only the first n positions
+ */
+
+#include "dama/search/mcts_many.h"
+#include "dama/training/dataset.h"
+#include "dama/engine/game_view.h"
+#include "dama/engine/movegen.h"
+#include "dama/engine/zobrist.h"
+#include "dama/neural/cnn.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANALYSE_MAX_TOKENS  512
+
+typedef struct {
+    const SearchPosition *positions;
+    size_t first;               // Input index of positions[0]
+} AnalyseBatch;
+
+static void print_result(const SearchManyResult *r, void *user) {
+    const AnalyseBatch *batch = user;
+    const GameState *s = &batch->positions[r->index].state;
+    const size_t index = batch->first + (size_t)r->index;
+    if (r->best.length == 0 && r->best.path[0] == r->best.path[1]) {
+        printf("%zu bestmove none\n", index);
+        return;
+    }
+    char text[MOVE_TEXT_MAX];
+    format_move(&r->best, text, sizeof(text));
+    printf("%zu bestmove %s value %.3f visits %d moves", index, text, r->value, r->visits);
+    for (int k = 0; k < r->num_moves; k++) {
+        Move m;
+        if (!movegen_unpack_move(s, r->moves[k], &m)) continue;
+        format_move(&m, text, sizeof(text));
+        printf(" %s:%d", text, r->move_visits[k]);
+    }
+    printf("\n");
+}
+
+static void analyse_totals(SearchManyStats *total, const SearchManyStats *part) {
+    total->searched += part->searched;
+    total->nodes += part->nodes;
+    total->seconds += part->seconds;
+}
+
+// =============================================================================
+// INPUT
+// =============================================================================
+
+/**
+ * Read position lines into a growing array.
+ * @return Positions read, -1 on a bad line (reported)
+ */
+static long read_positions(FILE *in, long limit, SearchPosition **out) {
+    static char line[SERVE_MAX_LINE];
+    SearchPosition *positions = NULL;
+    long n = 0, cap = 0, line_no = 0;
+    while ((limit <= 0 || n < limit) && fgets(line, sizeof(line), in)) {
+        line_no++;
+        char *tok[ANALYSE_MAX_TOKENS];
+        int t = 0;
+        for (char *p = strtok(line, " \t\r\n"); p && t < ANALYSE_MAX_TOKENS; p = strtok(NULL, " \t\r\n")) tok[t++] = p;
+        if (t == 0 || tok[0][0] == '#') continue;
+        char **args = tok;
+        if (strcmp(args[0], "position") == 0) {
+            args++;
+            t--;
+        }
+
+        if (n == cap) {
+            cap = cap ? cap * 2 : 256;
+            SearchPosition *grown = realloc(positions, (size_t)cap * sizeof(SearchPosition));
+            if (!grown) {
+                free(positions);
+                fprintf(stderr, "Error: out of memory at line %ld\n", line_no);
+                return -1;
+            }
+            positions = grown;
+        }
+        const char *bad_move;
+        if (search_position_parse(args, t, &positions[n], &bad_move) != 0) {
+            if (bad_move) fprintf(stderr, "Error: line %ld: illegal move %s\n", line_no, bad_move);
+            else fprintf(stderr, "Error: line %ld: expected startpos or board <32 squares> <w|b>\n", line_no);
+            free(positions);
+            return -1;
+        }
+        n++;
+    }
+    *out = positions;
+    return n;
+}
+
+static void sample_position(const TrainingSample *s, SearchPosition *pos) {
+    memset(pos, 0, sizeof(*pos));
+    pos->state = s->state;
+    pos->plies = training_sample_history_plies(s);
+    memcpy(pos->history, s->history, (size_t)pos->plies * sizeof(GameState));
+}
+
+// =============================================================================
+// COMMAND
+// =============================================================================
+
+int cmd_analyse(int argc, char **argv) {
+    const char *weights = NULL;
+    const char *input = NULL;
+    const char *dataset = NULL;
+    long limit = 0;
+    SearchManyConfig many = { .threads = 0, .nodes = 800, .on_result = print_result };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printf("Usage: dama analyse [options] <positions.txt | ->\n");
+            printf("       dama analyse [options] --dataset <data.bin>\n\n");
+            printf("One position per line: [position] startpos|board <32 squares> <w|b> [moves <m>...]\n\n");
+            printf("Options:\n");
+            printf("  -w <weights>     Search with this network (default: Grandmaster, no network)\n");
+            printf("  -n <nodes>       Nodes per position (default: 800)\n");
+            printf("  -t <threads>     Searches at once (default: all cores)\n");
+            printf("  --limit <n>      Only the first n positions\n\n");
+            printf("Output: <index> bestmove <m> value <v> visits <n> moves <m>:<visits>...\n");
+            return 0;
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i+1 < argc) weights = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0 && i+1 < argc) many.nodes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) many.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--limit") == 0 && i+1 < argc) limit = atol(argv[++i]);
+        else if (strcmp(argv[i], "--dataset") == 0 && i+1 < argc) dataset = argv[++i];
+        else input = argv[i];
+    }
+    if ((!input) == (!dataset) || many.nodes < 1) {
+        fprintf(stderr, "Usage: dama analyse [-w <weights>] [-n <nodes>] [-t <threads>] [--limit <n>] "
+                        "<positions.txt | - | --dataset <data.bin>>\n");
+        return 1;
+    }
+
+    zobrist_init();
+    movegen_init();
+    log_set_level(LOG_WARN);  // stdout carries the results
+
+    CNNWeights w;
+    cnn_init(&w);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_GRANDMASTER);
+    if (weights) {
+        if (cnn_load_weights(&w, weights) != 0) {
+            fprintf(stderr, "Error loading weights %s\n", weights);
+            cnn_free(&w);
+            return 1;
+        }
+        config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+        config.cnn_weights = &w;
+    }
+
+    // Positions go in ANALYSE_BATCH at a time: results stay bounded on large sets
+    SearchPosition *positions = NULL;
+    SearchManyResult *results = malloc(ANALYSE_BATCH * sizeof(SearchManyResult));
+    TrainingSample *samples = NULL;
+    DatasetView view = {0};
+    size_t total = 0;
+    int res = 0;
+    if (!results) {
+        res = 1;
+    } else if (dataset) {
+        if (dataset_open(dataset, &view) != 0) {
+            fprintf(stderr, "Error reading %s\n", dataset);
+            res = 1;
+        } else {
+            total = view.count;
+            if (limit > 0 && (size_t)limit < total) total = (size_t)limit;
+            positions = malloc(ANALYSE_BATCH * sizeof(SearchPosition));
+            samples = malloc(ANALYSE_BATCH * sizeof(TrainingSample));
+            if (!positions || !samples) res = 1;
+        }
+    } else {
+        FILE *in = strcmp(input, "-") == 0 ? stdin : fopen(input, "r");
+        long n = in ? read_positions(in, limit, &positions) : -1;
+        if (!in) fprintf(stderr, "Error reading %s\n", input);
+        if (in && in != stdin) fclose(in);
+        if (n < 0) res = 1;
+        else total = (size_t)n;
+    }
+
+    SearchManyStats stats = {0};
+    for (size_t first = 0; res == 0 && first < total; first += ANALYSE_BATCH) {
+        const size_t n = total - first < ANALYSE_BATCH ? total - first : ANALYSE_BATCH;
+        AnalyseBatch batch = { dataset ? positions : positions + first, first };
+        if (dataset) {
+            if (dataset_view_read(&view, first, n, samples) != 0) {
+                fprintf(stderr, "Error reading %s\n", dataset);
+                res = 1;
+                break;
+            }
+            for (size_t i = 0; i < n; i++) sample_position(&samples[i], &positions[i]);
+        }
+        many.user = &batch;
+        SearchManyStats part;
+        if (mcts_search_many(batch.positions, (int)n, &config, &many, results, &part) != 0) {
+            res = 1;
+            break;
+        }
+        fflush(stdout);
+        analyse_totals(&stats, &part);
+    }
+
+    if (res == 0) {
+        fprintf(stderr, "%zu positions (%d searched), %ld nodes in %.1f s (%.0f nodes/s)\n",
+                total, stats.searched, stats.nodes, stats.seconds,
+                stats.seconds > 0 ? stats.nodes / stats.seconds : 0.0);
+    }
+    if (dataset) dataset_close(&view);
+    free(samples);
+    free(positions);
+    free(results);
+    cnn_free(&w);
+    return res;
+}
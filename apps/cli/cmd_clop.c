@@ -8,6 +8,10 @@
  *   --games N       Games per evaluation (default: 10)
  *   --nodes N       MCTS nodes per move (default: 200)
  *   --seed N        Random seed (default: time-based)
+ *   --sprt E0 E1    End an evaluation once the SPRT decides (--games is the maximum)
+ *   --elo-margin M  End an evaluation once the 95% Elo interval is within +-M
+ *   --min-games N   No early stop before N games
+ *   --batch K       Evaluations in flight at once, one per thread (default: 1)
  *   --verbose       Print detailed output
  *   --help          Show this help
  */
@@ -17,6 +21,7 @@
 #include "dama/tournament/tournament.h"
 #include "dama/search/mcts.h"
 #include "dama/search/mcts_config.h"
+#include "dama/search/mcts_pool.h"
 #include "dama/engine/game.h"
 #include "dama/engine/zobrist.h"
 #include "dama/engine/movegen.h"
@@ -26,6 +31,10 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // =============================================================================
 // HELPER: Apply CLOP params to MCTSConfig
 // =============================================================================
@@ -50,7 +59,8 @@ static void apply_clop_params(MCTSConfig *cfg, const double *params) {
 // HELPER: Evaluate Parameters via Mini-Tournament
 // =============================================================================
 
-static double evaluate_params(const double *params, int games, int nodes) {
+static double evaluate_params(const double *params, int games, int nodes, const MatchStopRule *stop,
+                              int *out_games) {
     // Create two players: tuned vs baseline
     TournamentPlayer players[2];
     memset(players, 0, sizeof(players));
@@ -74,11 +84,13 @@ static double evaluate_params(const double *params, int games, int nodes) {
     tcfg.games_per_pair = games;
     tcfg.time_limit = 0;  // Use max_nodes instead
     tcfg.parallel_games = 0;
+    tcfg.stop = *stop;
     
     tournament_run(&tcfg);
     
     // Return win rate of tuned player
     int total = players[0].wins + players[0].losses + players[0].draws;
+    *out_games = total;
     if (total == 0) return 0.5;
     
     double win_rate = (players[0].wins + 0.5 * players[0].draws) / total;
@@ -94,7 +106,9 @@ int cmd_clop(int argc, char **argv) {
     int games = 10;
     int nodes = 200;
     int verbose = 0;
+    int batch = 1;
     unsigned int seed = (unsigned int)time(NULL);
+    MatchStopRule stop = {0};
     
     // Parse args
     for (int i = 1; i < argc; i++) {
@@ -106,6 +120,16 @@ int cmd_clop(int argc, char **argv) {
             nodes = atoi(argv[++i]);
         } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
             seed = (unsigned int)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sprt") == 0 && i + 2 < argc) {
+            stop.sprt = 1;
+            stop.elo0 = atof(argv[++i]);
+            stop.elo1 = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--elo-margin") == 0 && i + 1 < argc) {
+            stop.elo_margin = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-games") == 0 && i + 1 < argc) {
+            stop.min_games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
         } else if (strcmp(argv[i], "--verbose") == 0) {
             verbose = 1;
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
@@ -115,12 +139,27 @@ int cmd_clop(int argc, char **argv) {
             printf("  --games N       Games per evaluation (default: 10)\n");
             printf("  --nodes N       MCTS nodes per move (default: 200)\n");
             printf("  --seed N        Random seed\n");
+            printf("  --sprt E0 E1    End an evaluation once the SPRT decides (--games is the maximum)\n");
+            printf("  --elo-margin M  End an evaluation once the 95%% Elo interval is within +-M\n");
+            printf("  --min-games N   No early stop before N games (default: %d)\n", SPRT_MIN_GAMES);
+            printf("  --batch K       Evaluations in flight at once (default: 1, 0: all cores)\n");
             printf("  --verbose       Print detailed output\n");
             printf("  --help          Show this help\n");
             return 0;
         }
     }
     
+    if (stop.sprt && stop.elo0 == stop.elo1) {
+        log_error("--sprt needs two different Elo bounds");
+        return 1;
+    }
+#ifdef _OPENMP
+    if (batch <= 0) batch = omp_get_max_threads();
+#else
+    batch = 1;
+#endif
+    if (batch > iterations) batch = iterations > 0 ? iterations : 1;
+    
     // Initialize game tables
     zobrist_init();
     movegen_init();
@@ -131,7 +170,7 @@ int cmd_clop(int argc, char **argv) {
     log_printf("├────────────────────────────────────────────────────────────────────┤\n");
     log_printf("│  Iterations : %-6d      Games/Eval : %-6d                       │\n", iterations, games);
     log_printf("│  MCTS Nodes : %-6d      Random Seed: %-10u                   │\n", nodes, seed);
-    log_printf("│  Parameters : %-6d                                               │\n", (int)CLOP_DEFAULT_NUM_PARAMS);
+    log_printf("│  Parameters : %-6d      Batch      : %-6d                       │\n", (int)CLOP_DEFAULT_NUM_PARAMS, batch);
     log_printf("└────────────────────────────────────────────────────────────────────┘\n\n");
     
     // Initialize CLOP
@@ -148,35 +187,52 @@ int cmd_clop(int argc, char **argv) {
         return 1;
     }
     
-    // Main CLOP loop
-    for (int iter = 0; iter < iterations; iter++) {
-        log_printf("[CLOP] Iteration %d/%d\n", iter + 1, iterations);
-        
-        // Get next params to try
-        if (clop_suggest(&clop, params) < 0) {
-            log_error("clop_suggest failed");
-            break;
-        }
-        
-        if (verbose) {
-            log_printf("  Params: ");
-            for (int i = 0; i < (int)CLOP_DEFAULT_NUM_PARAMS; i++) {
-                log_printf("%.3f ", params[i]);
+    // Main CLOP loop: each thread takes a suggestion, plays its mini-tournament
+    // and feeds the result back as soon as it ends. The next suggestion sees
+    // the results so far and the evaluations still in flight.
+    int issued = 0, done = 0, failed = 0;
+    #pragma omp parallel num_threads(batch) if(batch > 1)
+    {
+        double mine[CLOP_DEFAULT_NUM_PARAMS];
+        for (;;) {
+            int iter = -1;
+            #pragma omp critical(clop_state)
+            {
+                if (!failed && issued < iterations) {
+                    if (clop_suggest(&clop, mine) < 0) {
+                        log_error("clop_suggest failed");
+                        failed = 1;
+                    } else {
+                        iter = issued++;
+                    }
+                }
+            }
+            if (iter < 0) break;
+            
+            // Evaluate
+            int played = 0;
+            double win_rate = evaluate_params(mine, games, nodes, &stop, &played);
+            
+            // Update CLOP
+            #pragma omp critical(clop_state)
+            {
+                log_printf("[CLOP] Iteration %d/%d (%d in flight)\n", ++done, iterations, clop_get_num_pending(&clop) - 1);
+                if (verbose) {
+                    log_printf("  Params: ");
+                    for (int i = 0; i < (int)CLOP_DEFAULT_NUM_PARAMS; i++) {
+                        log_printf("%.3f ", mine[i]);
+                    }
+                    log_printf("\n");
+                }
+                log_printf("  Win rate: %.1f%% (%d games)\n", win_rate * 100.0, played);
+                if (clop_update(&clop, mine, win_rate) < 0) {
+                    log_error("clop_update failed");
+                    failed = 1;
+                }
             }
-            log_printf("\n");
-        }
-        
-        // Evaluate
-        double win_rate = evaluate_params(params, games, nodes);
-        log_printf("  Win rate: %.1f%%\n", win_rate * 100.0);
-        
-        // Update CLOP
-        if (clop_update(&clop, params, win_rate) < 0) {
-            log_error("clop_update failed");
-            break;
         }
+        search_pool_release();
     }
-    
     // Print best parameters
     clop_get_best(&clop, params);
     
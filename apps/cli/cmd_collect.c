@@ -0,0 +1,82 @@
+/**
+ * cmd_collect.c - Distributed Self-Play Collector
+ *
+ * Usage: dama collect [options]
+ *
+ * Options:
+ *   --port N       TCP port (default: NET_COLLECTOR_PORT)
+ *   --bind ADDR    Address to listen on (default: NET_COLLECTOR_BIND, loopback only);
+ *                  0.0.0.0 or :: for remote workers (the protocol is unauthenticated)
+ *   --data PATH    Dataset file or replay buffer to append to (default: out/data/active.dat)
+ *   --weights PATH Model served to the workers (default: out/models/cnn_weights.bin)
+ *   --samples N    Return after N samples (default: 0, until interrupted)
+ *   --help         Show this help
+ *
+ * Workers connect with `dama train --worker HOST:PORT`.
+ */
+
+#include "dama/common/logging.h"
+#include "dama/common/params.h"
+#include "dama/training/selfplay_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+static Collector collector;
+
+static void collect_on_signal(int sig) {
+    (void)sig;
+    collector_stop(&collector);
+}
+
+int cmd_collect(int argc, char **argv) {
+    int port = NET_COLLECTOR_PORT;
+    const char *bind_addr = NET_COLLECTOR_BIND;
+    const char *data = "out/data/active.dat";
+    const char *weights = "out/models/cnn_weights.bin";
+    size_t max_samples = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            bind_addr = argv[++i];
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            weights = argv[++i];
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            max_samples = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printf("Usage: dama collect [options]\n\n");
+            printf("Options:\n");
+            printf("  --port N       TCP port (default: %d)\n", NET_COLLECTOR_PORT);
+            printf("  --bind ADDR    Address to listen on (default: %s, this machine only);\n", NET_COLLECTOR_BIND);
+            printf("                 0.0.0.0 or :: for remote workers, on a trusted network only\n");
+            printf("  --data PATH    Dataset file or replay buffer to append to\n");
+            printf("  --weights PATH Model served to the workers (reloaded when it changes)\n");
+            printf("  --samples N    Return after N samples (default: until interrupted)\n");
+            printf("  --help         Show this help\n\n");
+            printf("Workers: dama train --worker HOST:PORT [--games N] [--rounds N]\n");
+            return 0;
+        }
+    }
+
+    if (port < 0 || port > 65535) {
+        printf("Error: --port must be in 0..65535\n");
+        return 1;
+    }
+    if (collector_open(&collector, bind_addr, port, data, weights, max_samples) != 0) {
+        log_error("Cannot start the collector on %s port %d", bind_addr, port);
+        return 1;
+    }
+    signal(SIGINT, collect_on_signal);
+    signal(SIGTERM, collect_on_signal);
+
+    log_printf("Collecting on %s port %d into %s, serving %s\n", bind_addr, collector.port, data, weights);
+    int res = collector_run(&collector);
+    log_printf("Collected %zu samples\n", atomic_load(&collector.received));
+    collector_close(&collector);
+    return res == 0 ? 0 : 1;
+}
@@ -3,11 +3,31 @@
  * 
  * Contains:
  * - Data loading and balanced sampling (used by cmd_train)
- * - inspect/merge commands (used by CLI)
+ * - inspect/merge/trim/convert commands (used by CLI), streamed block by
+ *   block: outputs are written in the compact v2 format
+ * - replay command: create/configure a replay buffer directory
+ * - calibrate command (int8 model from a network and a dataset)
+ * - reanalyse command (new search targets with a newer network)
+ * - tablebase command (endgame tables for the search)
+ * - book command (opening book from searches or datasets)
  */
 
 #include "dama/training/dataset.h"
+#include "dama/training/replay_buffer.h"
+#include "dama/training/batch_prefetch.h"
+#include "dama/training/dataset_dedupe.h"
+#include "dama/training/reanalyse.h"
+#include "dama/training/book_games.h"
 #include "dama/engine/game.h"
+#include "dama/engine/movegen.h"
+#include "dama/engine/zobrist.h"
+#include "dama/engine/tablebase.h"
+#include "dama/engine/game_view.h"
+#include "dama/neural/cnn.h"
+#include "dama/neural/cnn_quant.h"
+#include "dama/common/math_backend.h"
+#include "dama/common/params.h"
+#include "dama/common/error_codes.h"
 #include "dama/common/logging.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,6 +35,7 @@
 #include <math.h>
 #include <locale.h>
 #include <dirent.h>
+#include <sys/stat.h>
 #include "dama/training/dataset_analysis.h"
 #include "dama/common/cli_view.h"
 
@@ -22,9 +43,15 @@
 // INSPECT - Show dataset statistics
 // =============================================================================
 
+static void inspect_on_progress(size_t done, size_t total) {
+    printf("\rAnalyzing: %'zu/%'zu samples (%d%%) ", done, total, (int)(done * 100 / total));
+    if (done == total) printf("\r%60s\r", "");
+    fflush(stdout);
+}
+
 static int data_inspect(const char *path) {
     DatasetStats stats;
-    int res = dataset_analyze(path, &stats);
+    int res = dataset_analyze(path, &stats, inspect_on_progress);
     
     if (res != 0) {
         printf("ERROR: Cannot read file or empty (code %d).\n", res);
@@ -36,6 +63,8 @@ static int data_inspect(const char *path) {
         .path = path,
         .count = stats.count,
         .file_size_mb = stats.file_size_mb,
+        .format_version = stats.format_version,
+        .bytes_per_sample = stats.bytes_per_sample,
         .wins = stats.wins, .losses = stats.losses, .draws = stats.draws,
         .val_mean = stats.val_mean, .val_min = stats.val_min, .val_max = stats.val_max,
         
@@ -46,6 +75,8 @@ static int data_inspect(const char *path) {
         .avg_max_prob_pct = stats.avg_max_prob * 100.0f,
         .sharp_policies = stats.sharp_policies,
         .sharp_ratio_pct = stats.sharp_ratio_pct,
+        .value_only = stats.value_only,
+        .value_only_pct = stats.value_only_pct,
         
         .avg_pieces = stats.avg_pieces,
         .avg_pawns = stats.avg_pawns,
@@ -68,6 +99,54 @@ static int data_inspect(const char *path) {
     return 0;
 }
 
+// =============================================================================
+// COPY - Stream a sample range into a (v2) dataset file
+// =============================================================================
+
+#define COPY_CHUNK_SAMPLES  (DATASET_BLOCK_SAMPLES * DATASET_SHUFFLE_BLOCKS)
+
+// Append samples [first, first + count) of view to output: a producer thread
+// decodes the next chunk while this one is encoded (block-parallel) and written
+static int data_copy_range(const DatasetView *view, size_t first, size_t count, const char *output) {
+    DatasetStream stream;
+    BatchPrefetcher pf;
+    if (dataset_stream_init(&stream, view, first, count, 0, 0) != 0) {
+        printf("ERROR: Out of memory.\n");
+        return 1;
+    }
+    if (batch_prefetch_init(&pf, &stream, COPY_CHUNK_SAMPLES, TRAINING_PREFETCH_DEPTH) != 0) {
+        printf("ERROR: Out of memory.\n");
+        dataset_stream_free(&stream);
+        return 1;
+    }
+    
+    int res = 0, n;
+    size_t copied = 0;
+    const TrainingSample *chunk;
+    batch_prefetch_start(&pf);
+    while (res == 0 && (chunk = batch_prefetch_next(&pf, &n)) != NULL) {
+        if (dataset_save_append(output, chunk, n) != 0) {
+            printf("ERROR: Cannot write %s.\n", output);
+            res = 1;
+        }
+        copied += n;
+    }
+    if (res == 0 && copied < count) {
+        printf("WARNING: %'zu samples in corrupt blocks skipped.\n", count - copied);
+    }
+    batch_prefetch_free(&pf);
+    dataset_stream_free(&stream);
+    return res;
+}
+
+static float file_mb(const char *path) {
+    DatasetView view;
+    if (dataset_open(path, &view) != 0) return 0.0f;
+    float mb = (float)view.mapping_bytes / (1024*1024);
+    dataset_close(&view);
+    return mb;
+}
+
 // =============================================================================
 // MERGE - Combine multiple dataset files
 // =============================================================================
@@ -93,31 +172,19 @@ static int data_merge(int file_count, char **files, const char *output) {
     }
     
     printf("\nTotal: %'d samples\n", total);
-    
-    TrainingSample *all = malloc(total * sizeof(TrainingSample));
-    if (!all) {
-        printf("ERROR: Out of memory.\n");
-        return 1;
-    }
-    
-    int offset = 0;
-    for (int i = 0; i < file_count; i++) {
-        int n = dataset_get_count(files[i]);
-        if (n > 0) {
-            dataset_load(files[i], all + offset, n);
-            offset += n;
-        }
-    }
-    
     printf("\nSaving to %s... ", output);
     fflush(stdout);
     
     remove(output);
-    dataset_save_append(output, all, total);
-    
-    printf("Done! (%.2f MB)\n", (float)(total * sizeof(TrainingSample)) / (1024*1024));
+    for (int i = 0; i < file_count; i++) {
+        DatasetView view;
+        if (dataset_get_count(files[i]) <= 0 || dataset_open(files[i], &view) != 0) continue;
+        int res = data_copy_range(&view, 0, view.count, output);
+        dataset_close(&view);
+        if (res != 0) return 1;
+    }
     
-    free(all);
+    printf("Done! (%.2f MB)\n", file_mb(output));
     return 0;
 }
 
@@ -157,161 +224,460 @@ static int data_glob(const char *dir, const char *pattern, char ***out_files, in
 }
 
 // =============================================================================
-// DEDUPE - Remove duplicate positions
+// DEDUPE - Merge duplicate positions
 // =============================================================================
 
-typedef struct {
-    uint64_t hash;
-    int index;
-} HashIndex;
-
-static int compare_hash_index(const void *a, const void *b) {
-    uint64_t ha = ((const HashIndex*)a)->hash;
-    uint64_t hb = ((const HashIndex*)b)->hash;
-    return (ha > hb) - (ha < hb);
-}
-
-static int data_dedupe(const char *input, const char *output) {
+static int data_dedupe(int file_count, char **files, const char *output) {
     printf("=== Dataset Deduplicator ===\n\n");
-    printf("Input:  %s\n", input);
+    for (int i = 0; i < file_count; i++) printf("Input:  %s\n", files[i]);
     printf("Output: %s\n\n", output);
     
-    int count = dataset_get_count(input);
-    if (count <= 0) {
-        printf("ERROR: Cannot read file or empty.\n");
+    printf("Deduplicating... ");
+    fflush(stdout);
+    DedupeStats stats;
+    if (dataset_dedupe((const char *const *)files, file_count, output, &stats) != 0) {
+        printf("\nERROR: Deduplication failed.\n");
         return 1;
     }
+    printf("Done! (%d partitions, %.2f MB)\n\n", stats.partitions, file_mb(output));
     
-    TrainingSample *samples = malloc(count * sizeof(TrainingSample));
-    HashIndex *hashes = malloc(count * sizeof(HashIndex));
-    if (!samples || !hashes) {
-        printf("ERROR: Out of memory.\n");
-        return 1;
+    size_t removed = stats.input - stats.unique;
+    printf("Original:   %'zu samples\n", stats.input);
+    printf("Duplicates: %'zu (%.1f%%), targets averaged\n", removed,
+           stats.input ? 100.0f * removed / stats.input : 0.0f);
+    printf("Unique:     %'zu samples\n", stats.unique);
+    return 0;
+}
+
+// =============================================================================
+// TRIM - Keep only last N samples
+// =============================================================================
+
+static int data_trim(const char *file, int keeping) {
+    // Replay buffer: becomes its window (whole oldest segments are dropped)
+    if (replay_is_buffer(file)) {
+        if (replay_create(file, 0, keeping) != 0) {
+            printf("ERROR: Cannot update %s.\n", file);
+            return 1;
+        }
+        printf("Replay window set to %d samples (%ld kept).\n", keeping, replay_count(file));
+        return 0;
     }
     
-    dataset_load(input, samples, count);
-    
-    // Build hash index
-    for (int i = 0; i < count; i++) {
-        hashes[i].hash = samples[i].state.hash;
-        hashes[i].index = i;
+    int count = dataset_get_count(file);
+    if (count <= keeping) {
+        printf("Dataset size (%d) <= limit (%d). No trim needed.\n", count, keeping);
+        return 0;
     }
+
+    printf("Trimming dataset from %d to %d samples...\n", count, keeping);
     
-    // Sort by hash
-    qsort(hashes, count, sizeof(HashIndex), compare_hash_index);
+    DatasetView view;
+    if (dataset_open(file, &view) != 0) {
+        printf("ERROR: Cannot read %s.\n", file);
+        return 1;
+    }
     
-    // Mark unique samples (keep first occurrence of each hash)
-    int *keep = calloc(count, sizeof(int));
-    int unique_count = 0;
+    // Save Overwrite
+    // We create a temp file then rename to be safe
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file);
     
-    for (int i = 0; i < count; i++) {
-        int is_dup = (i > 0 && hashes[i].hash == hashes[i-1].hash);
-        if (!is_dup) {
-            keep[hashes[i].index] = 1;
-            unique_count++;
-        }
+    remove(tmp_path);
+    int res = data_copy_range(&view, view.count - keeping, keeping, tmp_path);
+    dataset_close(&view);
+    if (res != 0) {
+        printf("ERROR: Failed to save trim file.\n");
+        remove(tmp_path);
+        return 1;
     }
     
-    int removed = count - unique_count;
-    printf("Original:   %'d samples\n", count);
-    printf("Duplicates: %'d (%.1f%%)\n", removed, 100.0f * removed / count);
-    printf("Unique:     %'d samples\n\n", unique_count);
+    if (rename(tmp_path, file) != 0) {
+        printf("ERROR: Failed to replace original file.\n");
+        return 1;
+    }
     
-    // Copy unique samples
-    TrainingSample *unique = malloc(unique_count * sizeof(TrainingSample));
-    if (!unique) {
-        printf("ERROR: Out of memory.\n");
+    printf("Trim complete.\n");
+    return 0;
+}
+
+// =============================================================================
+// REPLAY - Create or configure a replay buffer directory
+// =============================================================================
+
+// Options left out keep their current value
+static int data_replay(const char *dir, long window, long segment) {
+    ReplayIndex index;
+    int exists = replay_read_index(dir, &index) == 0;
+    if (window <= 0) window = exists ? (long)index.window : 0;
+    if (replay_create(dir, segment > 0 ? segment : 0, window) != 0 ||
+        replay_read_index(dir, &index) != 0) {
+        printf("ERROR: Cannot create replay buffer %s.\n", dir);
         return 1;
     }
     
-    int j = 0;
-    for (int i = 0; i < count; i++) {
-        if (keep[i]) {
-            unique[j++] = samples[i];
-        }
+    printf("Replay buffer: %s\n", dir);
+    printf("  Segments: %u (up to %'u samples each)\n",
+           index.next_segment - index.first_segment, index.segment_samples);
+    printf("  Samples:  %'ld\n", replay_count(dir));
+    if (index.window > 0) printf("  Window:   %'llu samples\n", (unsigned long long)index.window);
+    else printf("  Window:   unbounded\n");
+    return 0;
+}
+
+// =============================================================================
+// CONVERT - Rewrite a dataset in the current (v2) format
+// =============================================================================
+
+static int data_convert(const char *input, const char *output) {
+    DatasetView view;
+    if (dataset_open(input, &view) != 0) {
+        printf("ERROR: Cannot read %s.\n", input);
+        return 1;
     }
     
-    // Save
-    printf("Saving to %s... ", output);
+    // In place: through a temp file, renamed over the input
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", output);
+    printf("Converting %s (v%u, %'zu samples)... ", input, view.version, view.count);
     fflush(stdout);
     
-    remove(output);
-    dataset_save_append(output, unique, unique_count);
-    
-    printf("Done! (%.2f MB)\n", (float)(unique_count * sizeof(TrainingSample)) / (1024*1024));
+    float before = (float)view.mapping_bytes / (1024*1024);
+    remove(tmp_path);
+    int res = data_copy_range(&view, 0, view.count, tmp_path);
+    dataset_close(&view);
+    if (res != 0 || rename(tmp_path, output) != 0) {
+        printf("ERROR: Failed to write %s.\n", output);
+        remove(tmp_path);
+        return 1;
+    }
     
-    free(samples);
-    free(hashes);
-    free(keep);
-    free(unique);
+    printf("Done! (%.2f MB -> %.2f MB)\n", before, file_mb(output));
     return 0;
 }
 
 // =============================================================================
-// TRIM - Keep only last N samples
+// CALIBRATE - Int8 model from fp32 weights and a calibration dataset
 // =============================================================================
 
-static int data_trim(const char *file, int keeping) {
-    int count = dataset_get_count(file);
-    if (count <= keeping) {
-        printf("Dataset size (%d) <= limit (%d). No trim needed.\n", count, keeping);
-        return 0;
+static int data_calibrate(const char *weights, const char *dataset, const char *output, int max_samples) {
+    CNNWeights w;
+    cnn_init(&w);
+    if (cnn_load_weights(&w, weights) != 0) {
+        printf("ERROR: Cannot load weights %s\n", weights);
+        cnn_free(&w);
+        return 1;
     }
-
-    printf("Trimming dataset from %d to %d samples...\n", count, keeping);
     
-    TrainingSample *samples = malloc(count * sizeof(TrainingSample));
+    int count = 0;
+    TrainingSample *samples = dataset_load_alloc(dataset, &count);
     if (!samples) {
-        printf("ERROR: Out of memory loading for trim.\n");
+        printf("ERROR: Cannot read dataset %s\n", dataset);
+        cnn_free(&w);
+        return 1;
+    }
+    dataset_shuffle(samples, count);    // Spread the calibration set over all games
+    if (count > max_samples) count = max_samples;
+    
+    printf("Calibrating on %'d samples (%s kernels)...\n", count, vec_s8_name());
+    CNNQuantWeights q;
+    int err = cnn_quant_calibrate(&w, samples, count, &q);
+    if (err != ERR_OK) {
+        printf("ERROR: Calibration failed (code %d)\n", err);
+        free(samples);
+        cnn_free(&w);
         return 1;
     }
     
-    // Load ALL (inefficient but safe for now)
-    // Optimization: seek and load only last N if 'dataset_load' supports partial/seek
-    // Current API loads from start. 
-    dataset_load(file, samples, count);
-    
-    int start_idx = count - keeping;
-    if (start_idx < 0) start_idx = 0;
+    // Agreement with the fp32 network on the calibration set
+    double value_err = 0.0;
+    int top1 = 0;
+    for (int i = 0; i < count; i++) {
+        CNNOutput ref, out;
+        w.quant = NULL;
+        cnn_forward_sample(&w, &samples[i], &ref);
+        w.quant = &q;
+        cnn_forward_sample(&w, &samples[i], &out);
+        value_err += fabsf(ref.value - out.value);
+        int best_ref = 0, best_out = 0;
+        for (int k = 1; k < CNN_POLICY_SIZE; k++) {
+            if (ref.policy[k] > ref.policy[best_ref]) best_ref = k;
+            if (out.policy[k] > out.policy[best_out]) best_out = k;
+        }
+        top1 += (best_ref == best_out);
+    }
+    w.quant = NULL;
+    printf("  Value MAE vs fp32:   %.4f\n", value_err / count);
+    printf("  Policy top-1 match:  %.1f%%\n", 100.0 * top1 / count);
+    printf("  Int8 model size:     %.2f MB\n", cnn_quant_bytes(&q) / (1024.0 * 1024.0));
     
-    // Save Overwrite
-    // We create a temp file then rename to be safe
-    char tmp_path[256];
-    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file);
+    err = cnn_quant_save(&q, output);
+    if (err == ERR_OK) printf("Saved %s\n", output);
     
-    remove(tmp_path);
-    if (dataset_save(tmp_path, &samples[start_idx], keeping) != 0) {
-        printf("ERROR: Failed to save trim file.\n");
-        free(samples);
+    cnn_quant_free(&q);
+    free(samples);
+    cnn_free(&w);
+    return err == ERR_OK ? 0 : 1;
+}
+
+// =============================================================================
+// REANALYSE - New policy targets from a newer network
+// =============================================================================
+
+static void reanalyse_on_progress(size_t done, size_t total) {
+    printf("\rReanalysing: %'zu/%'zu samples (%d%%) ", done, total, (int)(done * 100 / total));
+    if (done == total) printf("\n");
+    fflush(stdout);
+}
+
+static int data_reanalyse(const char *weights, const char *input, const char *output,
+                          int nodes, int threads, float value_blend) {
+    CNNWeights w;
+    cnn_init(&w);
+    if (cnn_load_weights(&w, weights) != 0) {
+        printf("ERROR: Cannot load weights %s\n", weights);
+        cnn_free(&w);
         return 1;
     }
+    movegen_init();
+    
+    MCTSConfig mcts_cfg = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    mcts_cfg.cnn_weights = &w;
+    mcts_cfg.max_nodes = nodes;
+    ReanalyseConfig cfg = {
+        .threads = threads,
+        .value_blend = value_blend,
+        .on_progress = reanalyse_on_progress
+    };
     
-    free(samples);
+    printf("=== Dataset Reanalyse ===\n\n");
+    printf("Network: %s\n", weights);
+    printf("Input:   %s\n", input);
+    printf("Output:  %s\n", output);
+    printf("Search:  %d nodes, value blend %.2f\n\n", nodes, value_blend);
     
-    if (rename(tmp_path, file) != 0) {
-        printf("ERROR: Failed to replace original file.\n");
+    ReanalyseStats stats;
+    int res = dataset_reanalyse(input, output, &cfg, &mcts_cfg, &stats);
+    cnn_free(&w);
+    if (res != 0) {
+        printf("\nERROR: Reanalyse failed.\n");
         return 1;
     }
-    
-    printf("Trim complete.\n");
+    printf("Searched:      %'zu of %'zu samples\n", stats.searched, stats.samples);
+    printf("Policy added:  %'zu value-only samples\n", stats.filled);
+    printf("Policy shift:  %.3f (mean total variation)\n", stats.policy_shift);
+    return 0;
+}
+
+// =============================================================================
+// TABLEBASE - Endgame tables
+// =============================================================================
+
+static void tablebase_on_table(const char *name, size_t positions, int passes, double seconds) {
+    printf("  %-12s %'14zu positions  %3d passes  %8.1f s\n", name, positions, passes, seconds);
+    fflush(stdout);
+}
+
+static int data_tablebase(const char *dir, int pieces, int threads) {
+    movegen_init();
+    mkdir(dir, 0755);
+    TablebaseGenConfig cfg = { .threads = threads, .on_table = tablebase_on_table };
+
+    printf("=== Endgame Tablebases ===\n\n");
+    printf("Directory: %s\n", dir);
+    printf("Pieces:    up to %d (existing tables are kept)\n\n", pieces);
+    if (tablebase_generate(dir, pieces, &cfg) != 0) {
+        printf("\nERROR: Tablebase generation failed.\n");
+        return 1;
+    }
+    printf("\nDone.\n");
     return 0;
 }
 
+// =============================================================================
+// BOOK - Opening book
+// =============================================================================
+
+static void book_on_ply(int ply, long positions) {
+    printf("  ply %2d: %'ld positions searched\n", ply, positions);
+    fflush(stdout);
+}
+
+static int book_write(BookBuilder *b, const char *output, uint32_t min_visits) {
+    long written = book_builder_write(b, output, min_visits);
+    book_builder_free(b);
+    if (written < 0) {
+        printf("\nERROR: Cannot write the book.\n");
+        return 1;
+    }
+    printf("\nWritten %'ld moves to %s\n", written, output);
+    return 0;
+}
+
+static int data_book_search(const char *weights, const char *output, int depth, int nodes,
+                            double min_share, int threads) {
+    movegen_init();
+    CNNWeights w;
+    cnn_init(&w);
+    MCTSConfig mcts_cfg = mcts_get_preset(MCTS_PRESET_GRANDMASTER);
+    if (weights) {
+        if (cnn_load_weights(&w, weights) != 0) {
+            printf("ERROR: Cannot load weights %s\n", weights);
+            cnn_free(&w);
+            return 1;
+        }
+        mcts_cfg = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+        mcts_cfg.cnn_weights = &w;
+    }
+    mcts_cfg.max_nodes = nodes;
+
+    printf("=== Opening Book (search) ===\n\n");
+    printf("Search:  %s, %d nodes per position\n", weights ? weights : "no network", nodes);
+    printf("Tree:    %d plies, moves with >= %.0f%% of the visits\n\n", depth, min_share * 100.0);
+
+    GameState start;
+    init_game(&start);
+    BookBuilder b;
+    book_builder_init(&b);
+    long searched = opening_book_search(&b, &start, depth, min_share, &mcts_cfg, threads, book_on_ply);
+    cnn_free(&w);
+    if (searched < 0) {
+        book_builder_free(&b);
+        printf("\nERROR: Book search failed.\n");
+        return 1;
+    }
+    return book_write(&b, output, 1);
+}
+
+static int data_book_games(int file_count, char **files, const char *output, int min_games) {
+    movegen_init();
+    printf("=== Opening Book (games) ===\n\n");
+    BookBuilder b;
+    book_builder_init(&b);
+    for (int i = 0; i < file_count; i++) {
+        BookGamesStats stats;
+        if (book_add_games(&b, files[i], &stats) != 0) {
+            book_builder_free(&b);
+            return 1;
+        }
+        printf("  %s: %'zu opening moves in %'zu samples\n", files[i], stats.moves, stats.samples);
+    }
+    return book_write(&b, output, (uint32_t)min_games);
+}
+
+static int data_book_show(const char *path) {
+    movegen_init();
+    OpeningBook book;
+    if (opening_book_open(&book, path) != 0) return 1;
+    GameState start;
+    init_game(&start);
+    BookEntry found[MAX_MOVES];
+    int n = opening_book_probe(&book, &start, found, MAX_MOVES);
+
+    printf("=== Opening Book ===\n\n");
+    printf("File:   %s (%'zu moves)\n\n", path, book.count);
+    printf("Start position:\n");
+    for (int i = 0; i < n; i++) {
+        Move m;
+        if (!movegen_unpack_move(&start, found[i].move, &m)) continue;
+        printf("  ");
+        print_move_description(m);
+        printf("  %'10u visits  score %.3f\n", found[i].visits, found[i].score);
+    }
+    if (n == 0) printf("  (not in book)\n");
+    opening_book_close(&book);
+    return 0;
+}
+
+static int data_book(int argc, char **argv) {
+    if (argc < 3) {
+        printf("Usage: dama data book <search|games|show> [args]\n\n");
+        printf("  search [-w <weights>] [-o <out>] [-d <plies>] [-n <nodes>] [--min-share <s>] [-t <threads>]\n");
+        printf("                              Search the opening tree (default: %d plies, %d nodes)\n",
+               BOOK_SEARCH_DEPTH, BOOK_SEARCH_NODES);
+        printf("  games <data> ... [-o <out>] [--min-games <n>]\n");
+        printf("                              Moves played in selfplay datasets (default: %d games)\n",
+               BOOK_MIN_GAMES);
+        printf("  show <book>                 Book moves of the start position\n");
+        return 1;
+    }
+    const char *mode = argv[2];
+    const char *output = BOOK_DEFAULT_PATH;
+
+    if (strcmp(mode, "search") == 0) {
+        const char *weights = NULL;
+        int depth = BOOK_SEARCH_DEPTH, nodes = BOOK_SEARCH_NODES, threads = 0;
+        double min_share = BOOK_MIN_SHARE;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "-w") == 0 && i+1 < argc) weights = argv[++i];
+            else if (strcmp(argv[i], "-o") == 0 && i+1 < argc) output = argv[++i];
+            else if (strcmp(argv[i], "-d") == 0 && i+1 < argc) depth = atoi(argv[++i]);
+            else if (strcmp(argv[i], "-n") == 0 && i+1 < argc) nodes = atoi(argv[++i]);
+            else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--min-share") == 0 && i+1 < argc) min_share = atof(argv[++i]);
+        }
+        if (depth < 1 || nodes < 1 || min_share <= 0.0 || min_share > 1.0) {
+            printf("ERROR: Need -d >= 1, -n >= 1 and --min-share in (0, 1].\n");
+            return 1;
+        }
+        return data_book_search(weights, output, depth, nodes, min_share, threads);
+    }
+
+    if (strcmp(mode, "games") == 0) {
+        char **files = malloc(argc * sizeof(char*));
+        int file_count = 0, min_games = BOOK_MIN_GAMES;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "-o") == 0 && i+1 < argc) output = argv[++i];
+            else if (strcmp(argv[i], "--min-games") == 0 && i+1 < argc) min_games = atoi(argv[++i]);
+            else files[file_count++] = argv[i];
+        }
+        if (file_count < 1 || min_games < 1) {
+            printf("ERROR: Need at least one dataset and --min-games >= 1.\n");
+            free(files);
+            return 1;
+        }
+        int res = data_book_games(file_count, files, output, min_games);
+        free(files);
+        return res;
+    }
+
+    if (strcmp(mode, "show") == 0 && argc >= 4) return data_book_show(argv[3]);
+
+    printf("Unknown book mode: %s\n", mode);
+    return 1;
+}
+
 // =============================================================================
 // CMD_DATA - Entry point
 // =============================================================================
 
 int cmd_data(int argc, char **argv) {
     setlocale(LC_NUMERIC, "");
+    zobrist_init();  // v2 records are decoded with recomputed hashes
     
     if (argc < 2) {
         printf("Usage: dama data <subcommand> [args]\n\n");
         printf("Subcommands:\n");
         printf("  inspect <file>              Show dataset statistics\n");
-        printf("  dedupe <input> [-o <out>]   Remove duplicate positions\n");
+        printf("  dedupe <inputs> [-o <out>]  Merge duplicate positions (averaged targets)\n");
         printf("  merge <file1> <file2> ...   Merge files\n");
         printf("  merge -d <dir> -p <pattern> Merge matching files\n");
         printf("  merge -o <output> ...       Specify output file\n");
+        printf("  merge --dedupe ...          Merge duplicate positions too\n");
+        printf("  trim <file> <max_samples>   Keep only the last samples\n");
+        printf("  convert <file> [-o <out>]   Rewrite in the compact v2 format\n");
+        printf("  replay <dir> [--window <n>] [--segment <n>]\n");
+        printf("                              Create/configure a replay buffer\n");
+        printf("  calibrate <weights> <data> [-o <out>] [-n <samples>]\n");
+        printf("                              Build the int8 model\n");
+        printf("  reanalyse <weights> <data> [-o <out>] [-n <nodes>] [-t <threads>] [--value-blend <b>]\n");
+        printf("                              New policy targets from a newer network\n");
+        printf("  tablebase [<dir>] [-p <pieces>] [-t <threads>]\n");
+        printf("                              Build endgame tables (default: %s, %d pieces)\n",
+               TB_DEFAULT_DIR, TB_MAX_PIECES);
+        printf("  book <search|games|show> ...\n");
+        printf("                              Build or show an opening book (default: %s)\n",
+               BOOK_DEFAULT_PATH);
         return 1;
     }
     
@@ -335,9 +701,12 @@ int cmd_data(int argc, char **argv) {
         char **files = NULL;
         int file_count = 0;
         
-        int argi = 2;
+        int argi = 2, dedupe = 0;
         while (argi < argc) {
-            if (strcmp(argv[argi], "-o") == 0 && argi+1 < argc) {
+            if (strcmp(argv[argi], "--dedupe") == 0) {
+                dedupe = 1;
+                argi++;
+            } else if (strcmp(argv[argi], "-o") == 0 && argi+1 < argc) {
                 output = argv[++argi];
                 argi++;
             } else if (strcmp(argv[argi], "-d") == 0 && argi+1 < argc) {
@@ -362,23 +731,29 @@ int cmd_data(int argc, char **argv) {
             return 1;
         }
         
+        if (dedupe) return data_dedupe(file_count, files, output);
         return data_merge(file_count, files, output);
     }
     
     if (strcmp(subcmd, "dedupe") == 0) {
         if (argc < 3) {
-            printf("Usage: dama data dedupe <input.bin> [-o <output.bin>]\n");
+            printf("Usage: dama data dedupe <input.bin> ... [-o <output.bin>]\n");
             return 1;
         }
-        const char *input = argv[2];
         const char *output = "out/data/deduped.bin";
+        char **files = malloc(argc * sizeof(char*));
+        int file_count = 0;
         
-        for (int i = 3; i < argc; i++) {
+        for (int i = 2; i < argc; i++) {
             if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
                 output = argv[++i];
+            } else {
+                files[file_count++] = argv[i];
             }
         }
-        return data_dedupe(input, output);
+        int res = data_dedupe(file_count, files, output);
+        free(files);
+        return res;
     }
 
     if (strcmp(subcmd, "trim") == 0) {
@@ -389,6 +764,104 @@ int cmd_data(int argc, char **argv) {
         return data_trim(argv[2], atoi(argv[3]));
     }
     
+    if (strcmp(subcmd, "replay") == 0) {
+        if (argc < 3) {
+            printf("Usage: dama data replay <dir> [--window <samples>] [--segment <samples>]\n");
+            return 1;
+        }
+        long window = 0, segment = 0;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--window") == 0 && i+1 < argc) window = atol(argv[++i]);
+            else if (strcmp(argv[i], "--segment") == 0 && i+1 < argc) segment = atol(argv[++i]);
+        }
+        return data_replay(argv[2], window, segment);
+    }
+    
+    if (strcmp(subcmd, "convert") == 0) {
+        if (argc < 3) {
+            printf("Usage: dama data convert <file.bin> [-o <output.bin>]\n");
+            return 1;
+        }
+        const char *output = argv[2];
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+                output = argv[++i];
+            }
+        }
+        return data_convert(argv[2], output);
+    }
+    
+    if (strcmp(subcmd, "calibrate") == 0) {
+        if (argc < 4) {
+            printf("Usage: dama data calibrate <weights.bin> <dataset.bin> [-o <out.q8>] [-n <samples>]\n");
+            return 1;
+        }
+        const char *output = "out/models/cnn_weights.q8";
+        int max_samples = CNN_QUANT_CALIB_SAMPLES;
+        
+        for (int i = 4; i < argc; i++) {
+            if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+                output = argv[++i];
+            } else if (strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+                max_samples = atoi(argv[++i]);
+            }
+        }
+        return data_calibrate(argv[2], argv[3], output, max_samples);
+    }
+    
+    if (strcmp(subcmd, "reanalyse") == 0) {
+        if (argc < 4) {
+            printf("Usage: dama data reanalyse <weights.bin> <dataset> [-o <output.bin>] [-n <nodes>] "
+                   "[-t <threads>] [--value-blend <b>]\n");
+            return 1;
+        }
+        const char *output = argv[3];
+        int nodes = 800, threads = 0;
+        float value_blend = REANALYSE_VALUE_BLEND;
+        
+        for (int i = 4; i < argc; i++) {
+            if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+                output = argv[++i];
+            } else if (strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+                nodes = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+                threads = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--value-blend") == 0 && i+1 < argc) {
+                value_blend = atof(argv[++i]);
+            }
+        }
+        if (replay_is_buffer(output)) {
+            printf("ERROR: The output is a single file: give a replay buffer input an -o <output.bin>.\n");
+            return 1;
+        }
+        if (nodes < 1 || value_blend < 0.0f || value_blend > 1.0f) {
+            printf("ERROR: Need -n >= 1 and --value-blend in [0, 1].\n");
+            return 1;
+        }
+        return data_reanalyse(argv[2], argv[3], output, nodes, threads, value_blend);
+    }
+    
+    if (strcmp(subcmd, "tablebase") == 0) {
+        const char *dir = TB_DEFAULT_DIR;
+        int pieces = TB_MAX_PIECES, threads = 0;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "-p") == 0 && i+1 < argc) {
+                pieces = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+                threads = atoi(argv[++i]);
+            } else if (argv[i][0] != '-') {
+                dir = argv[i];
+            }
+        }
+        if (pieces < 2 || pieces > TB_MAX_PIECES) {
+            printf("ERROR: Need -p in [2, %d].\n", TB_MAX_PIECES);
+            return 1;
+        }
+        return data_tablebase(dir, pieces, threads);
+    }
+    
+    if (strcmp(subcmd, "book") == 0) return data_book(argc, argv);
+    
     printf("Unknown subcommand: %s\n", subcmd);
     return 1;
 }
@@ -6,6 +6,9 @@
  * 2. Activation distributions (dead neurons?)
  * 3. Policy output distribution (uniform vs peaked?)
  * 4. Target policy verification (are targets correct?)
+ *
+ * With --perf: hardware counters (cycles, IPC, cache and branch misses) of
+ * move generation and of a search per preset, per call and per node.
  */
 
 #include "dama/training/dataset.h"
@@ -13,6 +16,11 @@
 #include "dama/engine/game.h"
 #include "dama/engine/zobrist.h"
 #include "dama/engine/movegen.h"
+#include "dama/search/mcts.h"
+#include "dama/common/perf_counters.h"
+#include "dama/common/cli_view.h"
+#include "dama/common/params.h"
+#include "dama/common/rng.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -41,7 +49,131 @@ static void print_stats(const char *name, float *arr, int n) {
            name, min, max, mean, std, zeros, n);
 }
 
+// =============================================================================
+// HARDWARE COUNTERS (--perf)
+// =============================================================================
+
+static void print_perf_row(const char *label, const PerfReading *d, double units, const char *unit) {
+    const uint64_t *c = d->count;
+    printf("  %-28s %-5s %10.0f %6.2f %10.2f %10.2f %10.3f %8.2f\n", label, unit,
+           c[PERF_CYCLES] / units, c[PERF_CYCLES] ? (double)c[PERF_INSTRUCTIONS] / c[PERF_CYCLES] : 0.0,
+           c[PERF_L1D_MISSES] / units, c[PERF_BRANCH_MISSES] / units, c[PERF_LLC_MISSES] / units,
+           c[PERF_INSTRUCTIONS] ? 1000.0 * c[PERF_BRANCH_MISSES] / c[PERF_INSTRUCTIONS] : 0.0);
+}
+
+// Positions of random games, for move generation
+static int random_positions(GameState *out, int max) {
+    RNG rng;
+    rng_seed(&rng, 12345);
+    int n = 0;
+    while (n < max) {
+        GameState s;
+        init_game(&s);
+        for (int ply = 0; ply < MAX_GAME_TURNS && n < max; ply++) {
+            MoveList moves;
+            movegen_generate(&s, &moves);
+            if (moves.count == 0) break;
+            out[n++] = s;
+            apply_move(&s, &moves.moves[rng_u32(&rng) % moves.count]);
+        }
+    }
+    return n;
+}
+
+// One sequential search from the initial position
+static void perf_search(const char *label, MCTSConfig config, int nodes, MCTSStats *stats) {
+    config.max_nodes = nodes;
+    config.num_threads = 0;
+    Arena arena;
+    if (arena_init(&arena, ARENA_SIZE_BENCHMARK) != 0) return;
+    TranspositionTable *tt = config.use_tt ? tt_create(TT_SIZE_DEFAULT) : NULL;
+    GameState state;
+    init_game(&state);
+    Node *root = mcts_create_root(state, &arena, config);
+    
+    PerfReading start, end, d;
+    perf_counters_read(&start);
+    mcts_search(root, &arena, 60.0, config, stats, tt, NULL);
+    perf_counters_read(&end);
+    perf_reading_delta(&d, &end, &start);
+    int visits = atomic_load(&root->visits);
+    print_perf_row(label, &d, visits > 0 ? visits : 1, "node");
+    
+    tt_free(tt);
+    arena_free(&arena);
+}
+
+static int diagnose_perf(int argc, char **argv) {
+    int nodes = 2000;
+    const char *weights_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--nodes") == 0 && i+1 < argc) nodes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--weights") == 0 && i+1 < argc) weights_path = argv[++i];
+    }
+    
+    printf("=== Hardware Counters ===\n\n");
+    zobrist_init();
+    movegen_init();
+    if (perf_counters_enable() == 0) return 1;
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (!(perf_counters_available() & (1u << e))) printf("  (%s: not counted on this CPU)\n", perf_event_name(e));
+    }
+    printf("  %-28s %-5s %10s %6s %10s %10s %10s %8s\n", "", "per", "cycles", "IPC",
+           "L1D miss", "br miss", "LLC miss", "br/kins");
+    
+    // Move generation over positions of random games: branch-bound if
+    // br/kins is high and IPC low
+    enum { POSITIONS = 4096, ROUNDS = 50 };
+    GameState *positions = malloc(POSITIONS * sizeof(GameState));
+    if (!positions) return 1;
+    const int n = random_positions(positions, POSITIONS);
+    PerfReading start, end, d;
+    MoveList moves;
+    long total_moves = 0;
+    perf_counters_read(&start);
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < n; i++) {
+            movegen_generate(&positions[i], &moves);
+            total_moves += moves.count;
+        }
+    }
+    perf_counters_read(&end);
+    perf_reading_delta(&d, &end, &start);
+    print_perf_row("movegen_generate", &d, (double)n * ROUNDS, "call");
+    print_perf_row("movegen_generate", &d, total_moves > 0 ? (double)total_moves : 1.0, "move");
+    free(positions);
+    
+    // Searches: whole search per node, then the phases (PROFILE=1 builds)
+    CNNWeights weights;
+    cnn_init(&weights);
+    if (weights_path && cnn_load_weights(&weights, weights_path) != 0) {
+        printf("  (cannot load %s, random weights)\n", weights_path);
+    }
+    MCTSConfig alpha_zero = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    alpha_zero.cnn_weights = &weights;
+    const struct { const char *label; MCTSConfig config; } presets[] = {
+        {"mcts: Vanilla", mcts_get_preset(MCTS_PRESET_VANILLA)},
+        {"mcts: Grandmaster", mcts_get_preset(MCTS_PRESET_GRANDMASTER)},
+        {"mcts: AlphaZero+CNN", alpha_zero},
+    };
+    MCTSStats stats[3];
+    memset(stats, 0, sizeof(stats));
+    for (int p = 0; p < 3; p++) perf_search(presets[p].label, presets[p].config, nodes, &stats[p]);
+    printf("  (user space, calling thread only; misses per call / move / node)\n");
+    
+    for (int p = 0; p < 3; p++) {
+        SearchProfileView view = { .title = presets[p].label, .profile = &stats[p].profile };
+        cli_view_print_search_profile(&view);
+    }
+    cnn_free(&weights);
+    return 0;
+}
+
 int cmd_diagnose(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--perf") == 0) return diagnose_perf(argc, argv);
+    }
+    
     printf("=== CNN Training Diagnostics ===\n\n");
     
     const char *data_path = "out/data/run_3h_master.dat";
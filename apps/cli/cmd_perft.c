@@ -0,0 +1,92 @@
+/**
+ * cmd_perft.c - Move Generator Perft
+ * 
+ * Usage: dama perft [options]
+ * 
+ * Options:
+ *   --depth N   Maximum depth (default: 8)
+ *   --divide    Print per-move subtree counts at the root
+ *   --help      Show this help
+ */
+
+#include "dama/engine/game.h"
+#include "dama/engine/game_view.h"
+#include "dama/engine/movegen.h"
+#include "dama/engine/zobrist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double perft_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void perft_divide(const GameState *state, int depth) {
+    MoveList list;
+    movegen_generate(state, &list);
+    
+    uint64_t total = 0;
+    for (int i = 0; i < list.count; i++) {
+        const Move *m = &list.moves[i];
+        GameState next = *state;
+        apply_move(&next, m);
+        uint64_t n = movegen_perft(&next, depth - 1);
+        total += n;
+        
+        printf("  ");
+        print_move_description(*m);
+        printf("  %llu\n", (unsigned long long)n);
+    }
+    printf("  Total: %llu\n", (unsigned long long)total);
+}
+
+int cmd_perft(int argc, char **argv) {
+    int max_depth = 8;
+    int divide = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            max_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--divide") == 0) {
+            divide = 1;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printf("Usage: dama perft [options]\n\n");
+            printf("Options:\n");
+            printf("  --depth N   Maximum depth (default: 8)\n");
+            printf("  --divide    Print per-move subtree counts at the root\n");
+            printf("  --help      Show this help\n");
+            return 0;
+        }
+    }
+    
+    if (max_depth < 1) {
+        printf("Error: --depth must be >= 1\n");
+        return 1;
+    }
+    
+    zobrist_init();
+    movegen_init();
+    
+    GameState state;
+    init_game(&state);
+    
+    printf("Perft from initial position\n\n");
+    printf("  %-6s %16s %10s %12s\n", "Depth", "Nodes", "Time (s)", "MNodes/s");
+    for (int d = 1; d <= max_depth; d++) {
+        double t0 = perft_now();
+        uint64_t nodes = movegen_perft(&state, d);
+        double dt = perft_now() - t0;
+        printf("  %-6d %16llu %10.3f %12.2f\n", d, (unsigned long long)nodes, dt,
+               dt > 0 ? nodes / dt / 1e6 : 0.0);
+    }
+    
+    if (divide) {
+        printf("\nDivide (depth %d):\n", max_depth);
+        perft_divide(&state, max_depth);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * cmd_serve.c - Resident Engine Server
+ *
+ * Usage: dama serve [options]
+ *
+ * Loads the network and allocates arenas, TT and eval cache once, then
+ * answers search_server.h commands on stdin/stdout, or on a TCP port (one
+ * client at a time, the engine kept between clients).
+ *
+ * Options:
+ *   -w <weights>     Search with this network (default: no network, Grandmaster)
+ *   --port <n>       Listen on 127.0.0.1:<n> instead of stdin
+ *   --threads <n>    Search threads (default: preset)
+ *   --backend <name> Run the network's batches on this backend (cnn_backend.h)
+ *   --root-parallel  One independent tree per thread, merged at the root
+ *   --arena <MB>     Arena size (default: ARENA_SIZE_SERVE)
+ *   --tablebase <d>  Endgame tables
+ */
+
+#include "dama/search/search_server.h"
+#include "dama/engine/movegen.h"
+#include "dama/engine/zobrist.h"
+#include "dama/engine/tablebase.h"
+#include "dama/neural/cnn.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/neural/cnn_backend.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define SERVE_POLL_MS   20
+
+/**
+ * Read commands from in_fd until quit or end of input, polling the search
+ * between reads.
+ * @return 1 on quit, 0 at end of input
+ */
+static int serve_session(SearchServer *srv, int in_fd) {
+    static char buf[SERVE_MAX_LINE];
+    size_t used = 0;
+    int quit = 0, eof = 0;
+    while (!quit && !eof) {
+        struct pollfd p = { .fd = in_fd, .events = POLLIN };
+        int searching = search_server_poll(srv);
+        if (poll(&p, 1, searching ? SERVE_POLL_MS : -1) <= 0) continue;
+
+        ssize_t got = read(in_fd, buf + used, sizeof(buf) - 1 - used);
+        if (got <= 0) {
+            eof = 1;
+            got = 0;
+        }
+        used += (size_t)got;
+
+        // Every complete line, then keep the partial one
+        char *start = buf, *nl;
+        while (!quit && (nl = memchr(start, '\n', buf + used - start))) {
+            *nl = '\0';
+            quit = search_server_command(srv, start);
+            start = nl + 1;
+        }
+        used -= (size_t)(start - buf);
+        memmove(buf, start, used);
+        if (used == sizeof(buf) - 1) {
+            fprintf(srv->out, "error line too long\n");
+            fflush(srv->out);
+            used = 0;
+        }
+    }
+    if (eof && used > 0 && !quit) {
+        buf[used] = '\0';
+        quit = search_server_command(srv, buf);
+    }
+    // Report a search the client left running
+    search_server_finish(srv);
+    return quit;
+}
+
+static int serve_socket(SearchServer *srv, int port) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) return 1;
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 4) != 0) {
+        log_error("[Serve] Cannot listen on port %d", port);
+        close(listen_fd);
+        return 1;
+    }
+    fprintf(stderr, "Listening on 127.0.0.1:%d\n", port);
+
+    int quit = 0;
+    while (!quit) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        FILE *out = fdopen(dup(fd), "w");
+        if (!out) {
+            close(fd);
+            continue;
+        }
+        srv->out = out;
+        quit = serve_session(srv, fd);
+        fclose(out);
+        close(fd);
+    }
+    srv->out = stdout;
+    close(listen_fd);
+    return 0;
+}
+
+int cmd_serve(int argc, char **argv) {
+    const char *weights = NULL;
+    const char *tb_dir = NULL;
+    const char *backend = NULL;
+    int port = 0, threads = -1, root_parallel = 0;
+    size_t arena_size = ARENA_SIZE_SERVE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printf("Usage: dama serve [options]\n\n");
+            printf("Options:\n");
+            printf("  -w <weights>     Search with this network (default: Grandmaster, no network)\n");
+            printf("  --port <n>       Listen on 127.0.0.1:<n> instead of stdin/stdout\n");
+            printf("  --threads <n>    Search threads (default: preset)\n");
+            printf("  --backend <name> Run the network's batches on this backend (cpu)\n");
+            printf("  --root-parallel  One independent tree per thread, merged at the root\n");
+            printf("  --arena <MB>     Arena size (default: %zu MB)\n", ARENA_SIZE_SERVE >> 20);
+            printf("  --tablebase <d>  Endgame tables (dama data tablebase)\n\n");
+            printf("Commands: isready, newgame, position, legal, go, stop, quit\n");
+            printf("(see include/dama/search/search_server.h)\n");
+            return 0;
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i+1 < argc) weights = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0 && i+1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--backend") == 0 && i+1 < argc) backend = argv[++i];
+        else if (strcmp(argv[i], "--root-parallel") == 0) root_parallel = 1;
+        else if (strcmp(argv[i], "--arena") == 0 && i+1 < argc) arena_size = (size_t)atol(argv[++i]) << 20;
+        else if (strcmp(argv[i], "--tablebase") == 0 && i+1 < argc) tb_dir = argv[++i];
+    }
+
+    zobrist_init();
+    movegen_init();
+    log_set_level(LOG_WARN);  // stdout carries the protocol
+
+    CNNWeights w;
+    cnn_init(&w);
+    CNNCache *cache = NULL;
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_GRANDMASTER);
+    if (weights) {
+        if (cnn_load_weights(&w, weights) != 0) {
+            fprintf(stderr, "Error loading weights %s\n", weights);
+            cnn_free(&w);
+            return 1;
+        }
+        if (backend && cnn_backend_attach_named(&w, backend) != ERR_OK) {
+            fprintf(stderr, "Error attaching backend %s\n", backend);
+            cnn_free(&w);
+            return 1;
+        }
+        config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+        config.cnn_weights = &w;
+        cache = cnn_cache_create(CNN_CACHE_SIZE_DEFAULT);
+        config.cnn_cache = cache;
+    }
+    if (threads >= 0) config.num_threads = threads;
+    config.root_parallel = root_parallel;
+    config.use_tree_reuse = 1;
+
+    Tablebase tb = {0};
+    if (tb_dir) {
+        if (tablebase_open(&tb, tb_dir) <= 0) {
+            fprintf(stderr, "Error loading tablebases from %s\n", tb_dir);
+            cnn_cache_free(cache);
+            cnn_free(&w);
+            return 1;
+        }
+        config.tablebase = &tb;
+    }
+
+    SearchServer srv;
+    int res = 0;
+    if (search_server_init(&srv, config, arena_size, stdout) != 0) {
+        fprintf(stderr, "Cannot allocate the search memory\n");
+        res = 1;
+    } else {
+        if (port > 0) res = serve_socket(&srv, port);
+        else serve_session(&srv, STDIN_FILENO);
+        search_server_free(&srv);
+    }
+
+    tablebase_close(&tb);
+    cnn_cache_free(cache);
+    cnn_free(&w);
+    return res;
+}
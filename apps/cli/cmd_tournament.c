@@ -4,10 +4,16 @@
 
 #include "dama/common/logging.h"
 #include "dama/common/cli_view.h"
+#include "dama/common/affinity.h"
 #include "dama/tournament/tournament.h"
+#include "dama/search/search_cache.h"
 #include "dama/engine/movegen.h"
 #include "dama/engine/zobrist.h"
+#include "dama/engine/tablebase.h"
 #include "dama/neural/cnn.h"
+#include "dama/neural/cnn_quant.h"
+#include "dama/neural/cnn_backend.h"
+#include "dama/common/error_codes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,19 +26,25 @@
 static TournamentPlayer *g_players = NULL;
 
 static void on_start(int total) {
-    printf("\nStarting Round-Robin Tournament: %d matches scheduled\n", total);
-    printf("Legend: ips = Iters/s | nps = Nodes/s | D = Avg Depth | BF = Avg Branching Factor | Eff%% = TT Hit Rate | Mem = Peak Memory\n");
+    log_printf("\nStarting Round-Robin Tournament: %d matches scheduled\n", total);
+    log_printf("Legend: ips = Iters/s | nps = Nodes/s | D = Avg Depth | BF = Avg Branching Factor | Eff%% = TT Hit Rate | Mem = Peak Memory\n");
 }
 
 static void on_match_start(int i, int j, const char *n1, const char *n2) {
     (void)i; (void)j;
-    printf("\n[%s vs %s]\n", n1, n2);
+    log_printf("\n[%s vs %s]\n", n1, n2);
 }
 
 static void on_match_end(int i, int j, int s1, int s2, int d) {
-    (void)i; (void)j;
-    // Simple inline result print. Could use View if complex.
-    printf("Result: %d - %d (Draws: %d)\n", s1, s2, d);
+    // Pairs play concurrently: name the match the result belongs to
+    if (g_players) log_printf("Result: %s %d - %d %s (Draws: %d)\n", g_players[i].name, s1, s2, g_players[j].name, d);
+    else log_printf("Result: %d - %d (Draws: %d)\n", s1, s2, d);
+}
+
+static void on_match_decided(int i, int j, int verdict, double llr) {
+    const char *what = verdict == MATCH_ACCEPT_H1 ? "H1 accepted" :
+                       verdict == MATCH_ACCEPT_H0 ? "H0 accepted" : "Elo interval reached";
+    if (g_players) log_printf("  [%s vs %s] Stopped early: %s (LLR %.2f)\n", g_players[i].name, g_players[j].name, what, llr);
 }
 
 static void on_game_complete(const TournamentGameResult *r) {
@@ -44,7 +56,7 @@ static void on_game_complete(const TournamentGameResult *r) {
     if (r->result == 1) winner = n1;
     else if (r->result == -1) winner = n2;
     
-    printf("  > Game: %-15s vs %-15s -> %s (%d moves, %.2fs)\n", 
+    log_printf("  > Game: %-15s vs %-15s -> %s (%d moves, %.2fs)\n", 
            n1, n2, winner, r->moves, r->duration);
            
     // P1 Stats
@@ -59,7 +71,7 @@ static void on_game_complete(const TournamentGameResult *r) {
     double eff1 = (r->s1.tt_hits + r->s1.tt_misses > 0) ? 
         (double)r->s1.tt_hits * 100.0 / (r->s1.tt_hits + r->s1.tt_misses) : 0.0;
     
-    printf("    [%-15s]: %s iters (%s/mv), %s nodes | D%2.1f, BF%.1f | %s ips, %s nps | Eff%2.0f%% | Mem: %s\n",
+    log_printf("    [%-15s]: %s iters (%s/mv), %s nodes | D%2.1f, BF%.1f | %s ips, %s nps | Eff%2.0f%% | Mem: %s\n",
            n1, format_num(r->s1.total_iterations), format_num(avg_iters1), format_num(r->s1.total_nodes), 
            depth1, bf1, format_metric(ips1), format_metric(nps1), eff1,
            format_metric(r->s1.peak_memory_bytes));
@@ -76,7 +88,7 @@ static void on_game_complete(const TournamentGameResult *r) {
     double eff2 = (r->s2.tt_hits + r->s2.tt_misses > 0) ? 
         (double)r->s2.tt_hits * 100.0 / (r->s2.tt_hits + r->s2.tt_misses) : 0.0;
     
-    printf("    [%-15s]: %s iters (%s/mv), %s nodes | D%2.1f, BF%.1f | %s ips, %s nps | Eff%2.0f%% | Mem: %s\n",
+    log_printf("    [%-15s]: %s iters (%s/mv), %s nodes | D%2.1f, BF%.1f | %s ips, %s nps | Eff%2.0f%% | Mem: %s\n",
            n2, format_num(r->s2.total_iterations), format_num(avg_iters2), format_num(r->s2.total_nodes), 
            depth2, bf2, format_metric(ips2), format_metric(nps2), eff2,
            format_metric(r->s2.peak_memory_bytes));
@@ -133,6 +145,25 @@ static void on_tournament_end(TournamentPlayer *players, int count) {
     TournamentLeaderboardView view = { .count = count, .players = stats };
     cli_view_print_tournament_leaderboard(&view);
     
+    for (int k = 0; k < count; k++) {
+        SearchProfileView pv = { .title = players[k].name, .profile = &players[k].profile };
+        cli_view_print_search_profile(&pv);
+    }
+    
+    for (int k = 0; k < count; k++) {
+        long long probes = players[k].search_cache_hits + players[k].search_cache_misses;
+        if (probes == 0) continue;
+        log_printf("Search cache [%s]: %lld / %lld roots seeded (%.1f%%)\n", players[k].name,
+               players[k].search_cache_hits, probes, 100.0 * players[k].search_cache_hits / probes);
+    }
+    
+    for (int k = 0; k < count; k++) {
+        if (players[k].arena_allocs == 0) continue;
+        log_printf("Arena [%s]: high water %sB, %s allocations, %.0f B/allocation\n", players[k].name,
+               format_metric((double)players[k].arena_high_water), format_num(players[k].arena_allocs),
+               (double)players[k].arena_bytes / players[k].arena_allocs);
+    }
+    
     free(stats);
 }
 
@@ -212,11 +243,23 @@ static int setup_roster(TournamentPlayer *players, CNNWeights *v3, CNNWeights *a
 int cmd_tournament(int argc, char **argv) {
     int games = 10; // per pairing
     double time_limit = 0.2;  // 200ms per move (time-based)
+    double clock_base = 0, clock_increment = 0;  // --tc: game clock instead
     int nodes = 0;  // 0 = no node limit, use time only
     int use_parallel = 1;
+    int ponder = 0;
+    int deterministic = 0;
+    unsigned seed = 0;
+    AffinityPolicy affinity = AFFINITY_NONE;
+    const char *tb_dir = NULL;
+    const char *book_path = NULL;
+    const char *cache_path = NULL;
+    MatchStopRule stop = {0};
 
     char *p1_path = NULL;
     char *p2_path = NULL;
+    char *p1_quant = NULL;
+    char *p2_quant = NULL;
+    const char *backend = NULL;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -225,31 +268,93 @@ int cmd_tournament(int argc, char **argv) {
             printf("  -g <n>      Games per pair (default: 10)\n");
             printf("  -n <n>      MCTS nodes (default: 800)\n");
             printf("  -t <sec>    Time limit per move (default: 1.0)\n");
+            printf("  --tc <base>[+<inc>]  Play on a clock: base seconds per game, inc per move (replaces -t)\n");
             printf("  --serial    Run games serially (default: parallel)\n");
+            printf("  --ponder    Think on the opponent's time (turns on tree reuse; needs -t or --tc)\n");
+            printf("  --deterministic <seed> Reproducible games: fixed-node searches (needs -n), seeded per game and move\n");
+            printf("  --affinity <p>        Pin game threads: none, compact (fill a NUMA node first), scatter (default: none)\n");
+            printf("  --tablebase <dir>     Endgame tables for every player (dama data tablebase)\n");
+            printf("  --book <file>         Play book moves without searching (dama data book)\n");
+            printf("  --search-cache <file> Persistent search cache: seed roots searched before (created if missing)\n");
+            printf("  --sprt <elo0> <elo1>  Stop a match once the SPRT decides (-g is the maximum)\n");
+            printf("  --sprt-alpha <a>      SPRT error rates (default: %.2f / %.2f)\n", SPRT_ALPHA, SPRT_BETA);
+            printf("  --sprt-beta <b>\n");
+            printf("  --elo-margin <m>      Stop once the 95%% Elo interval is within +-m\n");
+            printf("  --min-games <n>       No early stop before n games (default: %d)\n", SPRT_MIN_GAMES);
             printf("  --p1-path <file>  Custom weights for Player 1 (Candidate)\n");
             printf("  --p2-path <file>  Custom weights for Player 2 (Opponent)\n");
+            printf("  --p1-quant <file> Run Player 1 on this int8 model (dama data calibrate)\n");
+            printf("  --p2-quant <file> Run Player 2 on this int8 model\n");
+            printf("  --backend <name>  Run both networks' batches on this backend (cpu; replaces int8)\n");
             return 0;
         }
         else if (strcmp(argv[i], "-g") == 0 && i+1 < argc) games = atoi(argv[++i]);
         else if (strcmp(argv[i], "-n") == 0 && i+1 < argc) nodes = atoi(argv[++i]);
         else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) time_limit = atof(argv[++i]);
+        else if (strcmp(argv[i], "--tc") == 0 && i+1 < argc) {
+            char *end;
+            clock_base = strtod(argv[++i], &end);
+            clock_increment = (*end == '+') ? strtod(end + 1, NULL) : 0.0;
+        }
         else if (strcmp(argv[i], "--serial") == 0) use_parallel = 0;
+        else if (strcmp(argv[i], "--ponder") == 0) ponder = 1;
+        else if (strcmp(argv[i], "--deterministic") == 0 && i+1 < argc) {
+            deterministic = 1;
+            seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--affinity") == 0 && i+1 < argc) {
+            if (!affinity_parse(argv[++i], &affinity)) {
+                printf("Error: --affinity takes none, compact or scatter\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--tablebase") == 0 && i+1 < argc) tb_dir = argv[++i];
+        else if (strcmp(argv[i], "--book") == 0 && i+1 < argc) book_path = argv[++i];
+        else if (strcmp(argv[i], "--search-cache") == 0 && i+1 < argc) cache_path = argv[++i];
+        else if (strcmp(argv[i], "--sprt") == 0 && i+2 < argc) {
+            stop.sprt = 1;
+            stop.elo0 = atof(argv[++i]);
+            stop.elo1 = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--sprt-alpha") == 0 && i+1 < argc) stop.alpha = atof(argv[++i]);
+        else if (strcmp(argv[i], "--sprt-beta") == 0 && i+1 < argc) stop.beta = atof(argv[++i]);
+        else if (strcmp(argv[i], "--elo-margin") == 0 && i+1 < argc) stop.elo_margin = atof(argv[++i]);
+        else if (strcmp(argv[i], "--min-games") == 0 && i+1 < argc) stop.min_games = atoi(argv[++i]);
         else if (strcmp(argv[i], "--p1-path") == 0 && i+1 < argc) p1_path = argv[++i];
         else if (strcmp(argv[i], "--p2-path") == 0 && i+1 < argc) p2_path = argv[++i];
+        else if (strcmp(argv[i], "--p1-quant") == 0 && i+1 < argc) p1_quant = argv[++i];
+        else if (strcmp(argv[i], "--p2-quant") == 0 && i+1 < argc) p2_quant = argv[++i];
+        else if (strcmp(argv[i], "--backend") == 0 && i+1 < argc) backend = argv[++i];
         else if (strcmp(argv[i], "--p1-type") == 0 && i+1 < argc) { i++; /* Ignore legacy arg */ }
         else if (strcmp(argv[i], "--p2-type") == 0 && i+1 < argc) { i++; /* Ignore legacy arg */ }
         else if (strcmp(argv[i], "--timeout") == 0 && i+1 < argc) time_limit = atof(argv[++i]); /* Alias for -t */
     }
     
+    if (stop.sprt && stop.elo0 == stop.elo1) {
+        printf("Error: --sprt needs two different Elo bounds\n");
+        return 1;
+    }
+    if (clock_base < 0 || clock_increment < 0) {
+        printf("Error: --tc needs a positive base and increment\n");
+        return 1;
+    }
+    if (deterministic && nodes <= 0) {
+        printf("Error: --deterministic needs a node budget (-n)\n");
+        return 1;
+    }
+    
     // Init Deps
     zobrist_init();
     movegen_init();
     srand(time(NULL));
+    affinity_set_policy(affinity);
     
     // Load Weights
     CNNWeights w3, w_active;
     cnn_init(&w3); cnn_init(&w_active);
     
+    CNNQuantWeights q1 = {0}, q2 = {0};
+    
     TournamentPlayer players[16];
     int n = 0;
 
@@ -257,6 +362,16 @@ int cmd_tournament(int argc, char **argv) {
         printf("Running Dual Tournament (Candidate vs Defender)...\n");
         if(cnn_load_weights(&w_active, p1_path) != 0) { printf("Error loading P1: %s\n", p1_path); return 1; }
         if(cnn_load_weights(&w3, p2_path) != 0) { printf("Error loading P2: %s\n", p2_path); return 1; }
+        
+        // Int8 players: same p1/p2 weights measure the quantization Elo loss
+        if (p1_quant) {
+            if (cnn_quant_load(&q1, p1_quant) != 0) { printf("Error loading P1 int8: %s\n", p1_quant); return 1; }
+            w_active.quant = &q1;
+        }
+        if (p2_quant) {
+            if (cnn_quant_load(&q2, p2_quant) != 0) { printf("Error loading P2 int8: %s\n", p2_quant); return 1; }
+            w3.quant = &q2;
+        }
 
         // Player 1: Candidate
         MCTSConfig c1 = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO); 
@@ -274,6 +389,37 @@ int cmd_tournament(int argc, char **argv) {
         if(cnn_load_weights(&w_active, "out/models/cnn_weights.bin") != 0) printf("Warning: Active model missing\n");
         n = setup_roster(players, &w3, &w_active, nodes);
     }
+    if (backend && (cnn_backend_attach_named(&w_active, backend) != ERR_OK ||
+                    cnn_backend_attach_named(&w3, backend) != ERR_OK)) {
+        printf("Error attaching backend %s\n", backend);
+        return 1;
+    }
+    
+    // Pondering hands its tree over through tree reuse
+    if (ponder) {
+        for (int i = 0; i < n; i++) players[i].config.use_tree_reuse = 1;
+    }
+
+    Tablebase tb = {0};
+    if (tb_dir) {
+        int tables = tablebase_open(&tb, tb_dir);
+        if (tables <= 0) { printf("Error loading tablebases from %s\n", tb_dir); return 1; }
+        printf("Tablebases: %d tables, up to %d pieces\n", tables, tb.max_pieces);
+        for (int i = 0; i < n; i++) players[i].config.tablebase = &tb;
+    }
+
+    OpeningBook book = {0};
+    if (book_path) {
+        if (opening_book_open(&book, book_path) != 0) { printf("Error loading book %s\n", book_path); return 1; }
+        printf("Opening book: %zu moves\n", book.count);
+    }
+
+    SearchCache search_cache = {0};
+    if (cache_path) {
+        if (search_cache_open(&search_cache, cache_path, 0) != 0) { printf("Error opening search cache %s\n", cache_path); return 1; }
+        printf("Search cache: %zu entries\n", search_cache.capacity);
+        for (int i = 0; i < n; i++) players[i].config.search_cache = &search_cache;
+    }
     
     // Run
     TournamentSystemConfig cfg = {
@@ -281,9 +427,17 @@ int cmd_tournament(int argc, char **argv) {
         .players = players,
         .games_per_pair = games,
         .time_limit = time_limit,
+        .clock_base = clock_base,
+        .clock_increment = clock_increment,
         .parallel_games = use_parallel,
+        .ponder = ponder,
+        .deterministic = deterministic,
+        .seed = seed,
+        .stop = stop,
+        .book = book_path ? &book : NULL,
         .on_start = on_start,
         .on_match_start = on_match_start,
+        .on_match_decided = on_match_decided,
         .on_match_end = on_match_end,
         .on_game_complete = on_game_complete,
         .on_tournament_end = on_tournament_end
@@ -303,7 +457,9 @@ int cmd_tournament(int argc, char **argv) {
     cli_view_print_tournament_roster(&rv);
     
     g_players = players;
+    log_set_async(1);       // Per-game reports queue instead of flushing under the result lock
     tournament_run(&cfg);
+    log_set_async(0);
     g_players = NULL;
 
     // Helper for script parsing
@@ -313,6 +469,10 @@ int cmd_tournament(int argc, char **argv) {
     
     // Cleanup
     cnn_free(&w3); cnn_free(&w_active);
+    cnn_quant_free(&q1); cnn_quant_free(&q2);
+    tablebase_close(&tb);
+    opening_book_close(&book);
+    search_cache_close(&search_cache);
     
     return 0;
 }
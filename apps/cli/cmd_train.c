@@ -7,8 +7,12 @@
 
 #include "dama/common/logging.h"
 #include "dama/common/cli_view.h"
+#include "dama/common/affinity.h"
 #include "dama/training/selfplay.h"
+#include "dama/training/selfplay_net.h"
 #include "dama/training/training_pipeline.h"
+#include "dama/neural/cnn_backend.h"
+#include "dama/common/error_codes.h"
 #include "dama/engine/movegen.h"
 #include "dama/engine/zobrist.h"
 #include "dama/common/params.h"
@@ -17,6 +21,7 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <signal.h>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -34,14 +39,13 @@ static void sp_on_start(int total) {
 
 static void sp_on_progress(int completed, int total, int w, int l, int d) {
     // Interactive progress bar
-    printf("\rGenerated: %d/%d | W:%d L:%d D:%d ", completed, total, w, l, d);
-    fflush(stdout);
+    log_printf("\rGenerated: %d/%d | W:%d L:%d D:%d ", completed, total, w, l, d);
 }
 
 static void sp_on_game_complete(int g, int total, int res, int moves, int reason) {
     const char* winners[] = {"Draw ", "White", "Black"};
     const char* reasons[] = {"Normal", "Resign", "Mercy ", "Stale ", "MaxMov", "Repet "};
-    printf("\n  > Game %3d/%3d | Result: %s | Moves: %3d | Case: %s", 
+    log_printf("\n  > Game %3d/%3d | Result: %s | Moves: %3d | Case: %s", 
            g + 1, total, winners[res], moves, reasons[reason]);
 }
 
@@ -99,6 +103,15 @@ static void tr_on_complete(float best, int epoch) {
     cli_view_print_training_complete(&view);
 }
 
+// --- Worker ---
+
+static volatile sig_atomic_t worker_stop = 0;
+
+static void worker_on_signal(int sig) {
+    (void)sig;
+    worker_stop = 1;
+}
+
 // =============================================================================
 // CONFIGURATION
 // =============================================================================
@@ -128,7 +141,9 @@ int cmd_train(int argc, char **argv) {
         .on_start = sp_on_start,
         .on_progress = sp_on_progress,
         .on_game_complete = sp_on_game_complete,
-        .endgame_prob = 0.0f
+        .endgame_prob = 0.0f,
+        .fast_nodes = 0,
+        .full_search_prob = SELFPLAY_FULL_SEARCH_PROB
     };
     
     TrainingPipelineConfig tr_cfg = {
@@ -141,6 +156,7 @@ int cmd_train(int argc, char **argv) {
         .data_path = "out/data/active.dat",
         .model_path = NULL, // Will determine
         .num_threads = get_max_threads(),
+        .prefetch_depth = TRAINING_PREFETCH_DEPTH,
         .on_init = tr_on_init,
         .on_epoch_start = tr_on_epoch_start,
         .on_batch_log = tr_on_batch,
@@ -157,18 +173,31 @@ int cmd_train(int argc, char **argv) {
     // Override parameters (0 = use defaults)
     int nodes_override = 0;
     int threads_override = 0;
+    AffinityPolicy affinity = AFFINITY_NONE;
+    
+    // Distributed worker (--worker HOST:PORT)
+    char worker_host[256] = "";
+    int worker_port = 0;
+    int worker_rounds = 0;
+    int games_set = 0;
+    const char *model_cache = NULL;
+    const char *backend = NULL;
     
     // Parse Args
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--selfplay") == 0) selfplay_only = 1;
         else if (strcmp(argv[i], "--train") == 0) train_only = 1;
-        else if (strcmp(argv[i], "--games") == 0 && i+1 < argc) sp_cfg.games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--games") == 0 && i+1 < argc) {
+            sp_cfg.games = atoi(argv[++i]);
+            games_set = 1;
+        }
         else if (strcmp(argv[i], "--temp") == 0 && i+1 < argc) sp_cfg.temp = atof(argv[++i]);
         else if (strcmp(argv[i], "--epochs") == 0 && i+1 < argc) tr_cfg.epochs = atoi(argv[++i]);
         else if (strcmp(argv[i], "--lr") == 0 && i+1 < argc) tr_cfg.learning_rate = atof(argv[++i]);
         else if (strcmp(argv[i], "--batch") == 0 && i+1 < argc) tr_cfg.batch_size = atoi(argv[++i]);
         else if (strcmp(argv[i], "--l2") == 0 && i+1 < argc) tr_cfg.l2_decay = atof(argv[++i]);
         else if (strcmp(argv[i], "--patience") == 0 && i+1 < argc) tr_cfg.patience = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--prefetch") == 0 && i+1 < argc) tr_cfg.prefetch_depth = atoi(argv[++i]);
         else if (strcmp(argv[i], "--data") == 0 && i+1 < argc) {
             sp_cfg.output_file = argv[++i];
             tr_cfg.data_path = sp_cfg.output_file;
@@ -179,10 +208,32 @@ int cmd_train(int argc, char **argv) {
         }
         else if (strcmp(argv[i], "--nodes") == 0 && i+1 < argc) nodes_override = atoi(argv[++i]);
         else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads_override = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--affinity") == 0 && i+1 < argc) {
+            if (!affinity_parse(argv[++i], &affinity)) {
+                log_error("--affinity takes none, compact or scatter");
+                return 1;
+            }
+        }
         else if (strcmp(argv[i], "--endgame-prob") == 0 && i+1 < argc) sp_cfg.endgame_prob = atof(argv[++i]);
+        else if (strcmp(argv[i], "--fast-nodes") == 0 && i+1 < argc) sp_cfg.fast_nodes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--full-prob") == 0 && i+1 < argc) sp_cfg.full_search_prob = atof(argv[++i]);
         else if (strcmp(argv[i], "--val-interval") == 0 && i+1 < argc) training_val_interval = atoi(argv[++i]);
         else if (strcmp(argv[i], "--overwrite") == 0) sp_cfg.overwrite_data = 1;
         else if (strcmp(argv[i], "--init") == 0) fresh_init = 1;
+        else if (strcmp(argv[i], "--worker") == 0 && i+1 < argc) {
+            const char *colon = strrchr(argv[++i], ':');
+            size_t len = colon ? (size_t)(colon - argv[i]) : 0;
+            if (!colon || len == 0 || len >= sizeof(worker_host) || atoi(colon + 1) <= 0) {
+                log_error("--worker expects HOST:PORT, got '%s'", argv[i]);
+                return 1;
+            }
+            memcpy(worker_host, argv[i], len);
+            worker_host[len] = '\0';
+            worker_port = atoi(colon + 1);
+        }
+        else if (strcmp(argv[i], "--rounds") == 0 && i+1 < argc) worker_rounds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--model-cache") == 0 && i+1 < argc) model_cache = argv[++i];
+        else if (strcmp(argv[i], "--backend") == 0 && i+1 < argc) backend = argv[++i];
         else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             printf("Usage: dama train [options]\n");
             // ... print help ...
@@ -196,6 +247,7 @@ int cmd_train(int argc, char **argv) {
     // Setup
     zobrist_init();
     movegen_init();
+    affinity_set_policy(affinity);  // Selfplay game threads
     
     // Load Model
     CNNWeights weights;
@@ -205,6 +257,12 @@ int cmd_train(int argc, char **argv) {
     } else {
         log_printf("Initialized fresh weights\n");
     }
+    // Self-play batches only: training runs on the weights themselves
+    if (backend && cnn_backend_attach_named(&weights, backend) != ERR_OK) {
+        log_error("Cannot attach backend %s", backend);
+        cnn_free(&weights);
+        return 1;
+    }
     
     // MCTS Config for Selfplay
     MCTSConfig mcts_cfg = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
@@ -220,6 +278,19 @@ int cmd_train(int argc, char **argv) {
         tr_cfg.num_threads = threads_override;
     }
     
+    // Worker: selfplay rounds for a remote collector, no local data or training
+    if (worker_port > 0) {
+        if (!games_set) sp_cfg.games = NET_WORKER_ROUND_GAMES;
+        signal(SIGINT, worker_on_signal);
+        signal(SIGTERM, worker_on_signal);
+        log_printf("Selfplay worker for %s:%d (%d games per round, %d nodes)\n",
+                   worker_host, worker_port, sp_cfg.games, mcts_cfg.max_nodes);
+        selfplay_worker_run(worker_host, worker_port, model_cache ? model_cache : weights_in,
+                            worker_rounds, &sp_cfg, &mcts_cfg, &weights, &worker_stop);
+        cnn_free(&weights);
+        return 0;
+    }
+    
     // 1. Selfplay
     if (!train_only) {
         // Prepare Date String
@@ -241,11 +312,15 @@ int cmd_train(int argc, char **argv) {
             .temperature = sp_cfg.temp,
             .temp_threshold = 30, // Default in selfplay.c usually
             .max_moves = sp_cfg.max_moves,
-            .endgame_prob = sp_cfg.endgame_prob
+            .endgame_prob = sp_cfg.endgame_prob,
+            .fast_nodes = sp_cfg.fast_nodes,
+            .full_search_prob = sp_cfg.full_search_prob
         };
         cli_view_print_selfplay(&sp_view); // Print header
         
+        log_set_async(1);   // Per-game lines are printed inside the selfplay progress lock
         selfplay_run(&sp_cfg, &mcts_cfg);
+        log_set_async(0);
         
         log_printf("\nSelf-play complete.\n");
     }
@@ -273,6 +348,7 @@ int cmd_train(int argc, char **argv) {
         training_model_path = tr_cfg.model_path;
         training_total_samples = dataset_get_count(tr_cfg.data_path) * tr_cfg.epochs;
         
+        cnn_backend_detach(&weights);  // The device copy would go stale as training updates the weights
         training_run(&weights, &tr_cfg);
     }
     
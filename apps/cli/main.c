@@ -5,6 +5,12 @@
  *   dama train [options]      - Train CNN (selfplay + training)
  *   dama tournament [options] - Run MCTS tournament
  *   dama data <subcommand>    - Data utilities (inspect, merge)
+ *   dama perft [options]      - Move generator perft
+ *   dama collect [options]    - Distributed selfplay collector
+ *   dama serve [options]      - Resident engine (line protocol)
+ *   dama analyse [options]    - Search a set of positions
+ *
+ *   dama --trace <file> <command> ...   Chrome trace of the run (make TRACE=1)
  */
 
 #include <stdio.h>
@@ -18,6 +24,7 @@
 
 // cli_view.c now compiled as part of LIB_SRCS, just include the header
 #include "dama/common/cli_view.h"
+#include "dama/common/trace.h"
 
 // External command handlers (compiled separately via CLI_SRCS in Makefile)
 extern int cmd_data(int argc, char **argv);
@@ -25,6 +32,10 @@ extern int cmd_train(int argc, char **argv);
 extern int cmd_tournament(int argc, char **argv);
 extern int cmd_diagnose(int argc, char **argv);
 extern int cmd_clop(int argc, char **argv);
+extern int cmd_perft(int argc, char **argv);
+extern int cmd_collect(int argc, char **argv);
+extern int cmd_serve(int argc, char **argv);
+extern int cmd_analyse(int argc, char **argv);
 
 
 // =============================================================================
@@ -43,6 +54,10 @@ static Command commands[] = {
     {"data",       "Data utilities (inspect, merge)",    cmd_data},
     {"diagnose",   "CNN training diagnostics",           cmd_diagnose},
     {"clop",       "CLOP hyperparameter tuning",         cmd_clop},
+    {"perft",      "Move generator perft (node counts)", cmd_perft},
+    {"collect",    "Collect samples from selfplay workers", cmd_collect},
+    {"serve",      "Resident engine on a line protocol", cmd_serve},
+    {"analyse",    "Search a set of positions",          cmd_analyse},
     {NULL, NULL, NULL}
 };
 
@@ -60,6 +75,7 @@ static void print_usage(const char *program) {
     }
     
     printf("\nRun '%s <command> --help' for command-specific options.\n", program);
+    printf("Timeline of any command: %s --trace <file.json> <command> ... (make TRACE=1)\n", program);
     printf("\nFor GUI play: ./bin/game_gui\n");
 }
 
@@ -73,6 +89,18 @@ int main(int argc, char **argv) {
         return 0;
     }
     
+    // Global option: spans written at exit, for chrome://tracing or Perfetto
+    if (strcmp(argv[1], "--trace") == 0) {
+        if (argc < 4) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        trace_open(argv[2]);
+        argc -= 2;
+        argv += 2;
+        argv[0] = argv[-2];
+    }
+    
     const char *cmd_name = argv[1];
     
     if (strcmp(cmd_name, "--help") == 0 || strcmp(cmd_name, "-h") == 0) {
@@ -5,9 +5,11 @@
 #include <math.h>
 #include "dama/engine/game.h"
 #include "dama/engine/movegen.h"
+#include "dama/engine/game_view.h"
+#include "dama/engine/zobrist.h"
 #include "dama/search/mcts.h"
+#include "dama/search/mcts_async.h"
 #include "dama/neural/cnn.h"
-#include "dama/search/mcts.h"
 #include "dama/common/params.h"
 
 
@@ -38,7 +40,8 @@ MCTSConfig config_cnn; // Neural Network
 MCTSConfig config_advisor; // Advisor uses GM settings
 MCTSConfig active_config; // The one we will use
 Arena mcts_arena;
-Arena advisor_arena; // Separate arena for Advisor thread
+Arena advisor_arena; // Separate arena for the Advisor search
+Arena advisor_spare; // Tree reuse compaction target for the Advisor
 
 CNNWeights cnn_weights; // Shared weights
 
@@ -49,11 +52,13 @@ int last_move_from = -1;
 int last_move_to = -1;
 
 // Advisor Globals
-SDL_Thread *advisor_thread = NULL;
-bool advisor_running = false;
+MCTSAsyncSearch advisor_search;
+Node *advisor_root = NULL; // Analysed position, kept across moves
 int advisor_suggest_from = -1;
 int advisor_suggest_to = -1;
+double advisor_value = 0.5; // Expected score of the suggestion for the human
 uint64_t advisor_analyzed_hash = 0; // To validate suggestion relevance
+Uint32 advisor_last_update = 0;
 
 bool is_ai_thinking = false;
 
@@ -67,63 +72,60 @@ void ai_move();
 
 // --- ADVISOR LOGIC ---
 
-int advisor_runner(void *data) {
-    (void)data; // Unused
-    advisor_running = true;
-    
-    // Copy state closely to avoid race conditions roughly (assuming main thread idle)
-    // Critical: Main thread modifies 'state' in apply_move. 
-    GameState local_state = state; 
-    advisor_analyzed_hash = local_state.hash;
-
-    // Run MCTS (GM)
-    arena_reset(&advisor_arena);
-    Node *adv_root = mcts_create_root(local_state, &advisor_arena, config_advisor);
-    Move adv_move = mcts_search(adv_root, &advisor_arena, TIME_HIGH, config_advisor, NULL, NULL);
-
-    // Print Advisor Tree Stats
-    if (adv_root) {
-        printf("\n--- Advisor Tree Stats ---\n");
-        printf("Root Visits: %d | Depth: %d | Nodes: %d\n", 
-               adv_root->visits, get_tree_depth(adv_root), get_tree_node_count(adv_root));
-        print_mcts_stats_sorted(adv_root);
-    }
+// Infinite analysis of the human's position on a background search. The
+// render loop polls it for the current best move; a new position stops it
+// at once and carries the analysed subtree over (mcts_advance_root).
 
-    // Output Result
-    if (adv_move.path[0] != 0 || adv_move.length > 0) {
-        advisor_suggest_from = adv_move.path[0];
-        advisor_suggest_to = (adv_move.length > 0) ? adv_move.path[adv_move.length] : adv_move.path[1];
-        
-        // Human-readable format (e.g., C3 -> D4)
-        char from_file = (advisor_suggest_from % 8) + 'A';
-        int from_rank = (advisor_suggest_from / 8) + 1;
-        char to_file = (advisor_suggest_to % 8) + 'A';
-        int to_rank = (advisor_suggest_to / 8) + 1;
-        
-        printf("[Advisor] Suggests: %c%d -> %c%d (idx %d -> %d)\n", 
-               from_file, from_rank, to_file, to_rank,
-               advisor_suggest_from, advisor_suggest_to);
+void advisor_stop() {
+    if (advisor_search.active) {
+        mcts_async_stop(&advisor_search);
+        mcts_async_wait(&advisor_search, NULL);
     }
-
-    advisor_running = false;
-    return 0;
 }
 
-void start_advisor() {
-    if (advisor_running || advisor_thread != NULL) return; 
-    
-    // Reset suggestion for new turn
+void advisor_analyse(const GameState *s) {
+    advisor_stop();
+    advisor_analyzed_hash = s->hash;
     advisor_suggest_from = -1;
     advisor_suggest_to = -1;
-    
-    advisor_thread = SDL_CreateThread(advisor_runner, "AdvisorThread", NULL);
+    advisor_value = 0.5;
+
+    // Our move and the AI's reply are two plies below the last analysis
+    Node *adv_root = advisor_root ? mcts_advance_root(advisor_root, s, &advisor_arena, &advisor_spare, NULL) : NULL;
+    if (!adv_root) {
+        arena_reset(&advisor_arena);
+        adv_root = mcts_create_root(*s, &advisor_arena, config_advisor);
+    }
+    advisor_root = adv_root;
+    if (!adv_root || adv_root->is_terminal) return;
+    if (adv_root->visits > 0) printf("[Advisor] Continuing from %d visits\n", adv_root->visits);
+    mcts_async_start(&advisor_search, adv_root, &advisor_arena, 0.0, config_advisor, NULL, NULL);
 }
 
-void clean_advisor() {
-    if (advisor_thread) {
-        SDL_WaitThread(advisor_thread, NULL);
-        advisor_thread = NULL;
+// Every frame of the human's turn: (re)start on a new position, then pick
+// up the current best move a few times per second
+void advisor_update(SDL_Window *window) {
+    if (advisor_analyzed_hash != state.hash) advisor_analyse(&state);
+    if (!advisor_search.active || SDL_GetTicks() - advisor_last_update < 250) return;
+    advisor_last_update = SDL_GetTicks();
+
+    Move best;
+    double value;
+    if (mcts_async_peek(&advisor_search, &best, 1, &value) == 0) return;
+    int from = best.path[0];
+    int to = (best.length > 0) ? best.path[best.length] : best.path[1];
+    if (from != advisor_suggest_from || to != advisor_suggest_to) {
+        char text[MOVE_TEXT_MAX];
+        format_move(&best, text, sizeof(text));
+        printf("[Advisor] Suggests: %s (%.1f%%, %d visits)\n", text, value * 100.0, advisor_root->visits);
     }
+    advisor_suggest_from = from;
+    advisor_suggest_to = to;
+    advisor_value = value;
+
+    char title[100];
+    snprintf(title, sizeof(title), "MCTS Dama - Advisor: %.1f%% (%d visits)", value * 100.0, advisor_root->visits);
+    SDL_SetWindowTitle(window, title);
 }
 
 // ---------------------
@@ -220,8 +222,8 @@ void render_board(SDL_Renderer *renderer) {
 }
 
 void ai_move() {
-    // Ensure Advisor is stopped/cleaned before AI moves (should be implicit as AI moves on opponent turn, but safety first)
-    if (advisor_thread) clean_advisor();
+    // The Advisor's tree waits for the human's next turn
+    advisor_stop();
 
     is_ai_thinking = true;
     printf("AI Thinking (Turn: %d)...\n", state.current_player);
@@ -236,7 +238,7 @@ void ai_move() {
     
     Node *new_root = NULL;
 
-    Move best_move = mcts_search(root, &mcts_arena, TIME_HIGH, active_config, NULL, &new_root, NULL);
+    Move best_move = mcts_search(root, &mcts_arena, TIME_HIGH, active_config, NULL, NULL, &new_root);
     
     if (best_move.path[0] == 0 && best_move.path[1] == 0 && best_move.length == 0) {
         printf("AI Resigns (No valid moves).\n");
@@ -255,7 +257,7 @@ void ai_move() {
     last_move_to = (best_move.length > 0) ? best_move.path[best_move.length] : best_move.path[1];
     
     apply_move(&state, &best_move);
-    generate_moves(&state, &legal_moves);
+    movegen_generate(&state, &legal_moves);
     
     printf("AI Played Move. New Turn: %d\n", state.current_player);
     is_ai_thinking = false;
@@ -289,11 +291,8 @@ void handle_click(int x, int y) {
             if (m.path[0] == selected_sq) {
                 int dest = m.path[ (m.length>0) ? m.length : 1 ];
                 if (dest == sq_idx) {
-                    // HUMAN MOVE: Invalidate Advisor
-                    if (advisor_thread) {
-                         // Thread will finish naturally, but we invalidate hash
-                         advisor_analyzed_hash = 0; 
-                    }
+                    // HUMAN MOVE: Cancel the analysis (its tree is kept)
+                    advisor_stop();
                 
                     apply_move(&state, &m);
                     selected_sq = -1;
@@ -306,7 +305,7 @@ void handle_click(int x, int y) {
                     root = NULL;
                     arena_reset(&mcts_arena); 
                     
-                    generate_moves(&state, &legal_moves);
+                    movegen_generate(&state, &legal_moves);
                     return;
                 }
             }
@@ -317,12 +316,12 @@ void handle_click(int x, int y) {
 
 int main(void) {
     // Init Game
-    init_game(&state);
-    init_move_tables();
     zobrist_init();
-    generate_moves(&state, &legal_moves);
+    movegen_init();
+    init_game(&state);
+    movegen_generate(&state, &legal_moves);
     
-    arena_init(&mcts_arena, ARENA_SIZE);
+    arena_init_with(&mcts_arena, ARENA_SIZE, &ARENA_BACKING_SEARCH);
 
     // 1. Config Grandmaster (Hard)
     config_gm = mcts_get_preset(MCTS_PRESET_GRANDMASTER);
@@ -354,8 +353,13 @@ int main(void) {
     } else {
         config_advisor = config_gm;
     }
-    config_advisor.verbose = 1;
+    config_advisor.max_nodes = 0; // Until the position changes
 
+    // TIME_HIGH searches on a reused tree: fixed footprint instead of a growing arena
+    config_gm.max_tree_nodes = MCTS_TREE_NODES_ANALYSIS;
+    config_vanilla.max_tree_nodes = MCTS_TREE_NODES_ANALYSIS;
+    config_advisor.max_tree_nodes = MCTS_TREE_NODES_ANALYSIS;
+    
     // DIFFICULTY SELECTION
     int difficulty = 0;
     while (difficulty < 1 || difficulty > 3) {
@@ -391,8 +395,9 @@ int main(void) {
         return 1;
     }
     
-    // Initialize Advisor Arena
-    arena_init(&advisor_arena, ARENA_SIZE);
+    // Initialize Advisor Arenas
+    arena_init_with(&advisor_arena, ARENA_SIZE, &ARENA_BACKING_SEARCH);
+    arena_init_with(&advisor_spare, ARENA_SIZE, &ARENA_BACKING_SEARCH);
 
     SDL_Window *window = SDL_CreateWindow(title, 
                                           SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 
@@ -439,7 +444,7 @@ int main(void) {
              } 
              // Human Turn - Run Advisor
              else if ((int)state.current_player == human_color && !is_ai_thinking) {
-                 start_advisor(); // Safe to call repeatedly, it checks running flag
+                 advisor_update(window);
              }
         }
 
@@ -453,14 +458,15 @@ int main(void) {
         SDL_Delay(16); // ~60fps
     }
 
-    // Clean threads
-    clean_advisor();
+    // Stop the Advisor search
+    advisor_stop();
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
     arena_free(&mcts_arena);
     arena_free(&advisor_arena);
+    arena_free(&advisor_spare);
 
     return 0;
 }
@@ -0,0 +1,66 @@
+/**
+ * affinity.h - CPU Affinity and NUMA Placement
+ *
+ * Process-wide placement policy for the threads that play games (selfplay,
+ * tournaments) and the helpers they start (search workers, root-parallel
+ * trees, inference evaluators):
+ *
+ *   AFFINITY_NONE     The scheduler decides (default)
+ *   AFFINITY_COMPACT  Game thread k on the k-th allowed CPU, one NUMA node
+ *                     filled before the next
+ *   AFFINITY_SCATTER  Game threads dealt round-robin over the NUMA nodes
+ *
+ * A pinned game thread allocates its pooled arenas and TT itself
+ * (search_pool_acquire), so their pages fault in on its node (Linux first
+ * touch). Helper threads run on every CPU of their starter's node, which
+ * keeps workers next to the tree and evaluators next to the request queue.
+ *
+ * Topology comes from sysfs (no libnuma); elsewhere than Linux every call
+ * is a no-op.
+ */
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <pthread.h>
+
+typedef enum {
+    AFFINITY_NONE = 0,
+    AFFINITY_COMPACT,
+    AFFINITY_SCATTER
+} AffinityPolicy;
+
+/**
+ * Set the policy (reads the topology and the CPUs the process may use).
+ * Call it before starting any game thread.
+ */
+void affinity_set_policy(AffinityPolicy policy);
+AffinityPolicy affinity_get_policy(void);
+
+/**
+ * Policy from its name: "none", "compact" or "scatter".
+ * @return 1 on success, 0 for an unknown name
+ */
+int affinity_parse(const char *name, AffinityPolicy *out);
+
+/** NUMA nodes among the allowed CPUs (1 if unknown). */
+int affinity_num_nodes(void);
+
+/**
+ * Pin the calling game thread to the CPU of `slot` (its thread number).
+ * @return The CPU, or -1 (no policy, or pinning failed)
+ */
+int affinity_pin_slot(int slot);
+
+/** Give the calling thread every allowed CPU back (end of a pinned region). */
+void affinity_unpin(void);
+
+/**
+ * Thread attributes for a helper of the calling thread: every CPU of the
+ * NUMA node the caller runs on.
+ * @return 1 if attr was initialized (pass it, then pthread_attr_destroy),
+ *         0 with no policy (pass NULL)
+ */
+int affinity_helper_attr(pthread_attr_t *attr);
+
+#endif // AFFINITY_H
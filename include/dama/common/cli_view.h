@@ -10,6 +10,7 @@
 #ifndef CLI_VIEW_H
 #define CLI_VIEW_H
 
+#include "dama/search/mcts_profile.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -85,6 +86,8 @@ typedef struct {
     float dirichlet_alpha;
     float dirichlet_epsilon;
     float endgame_prob;
+    int fast_nodes;             // Playout cap: 0 off
+    float full_search_prob;
 } SelfplayView;
 
 typedef struct {
@@ -108,6 +111,8 @@ typedef struct {
     const char *path;
     int count;
     float file_size_mb;
+    int format_version;
+    float bytes_per_sample;
     
     // Value stats
     int wins, losses, draws;
@@ -119,6 +124,8 @@ typedef struct {
     float avg_max_prob_pct;
     int sharp_policies; 
     float sharp_ratio_pct;
+    int value_only;
+    float value_only_pct;
     
     // Occupancy
     float avg_pieces, avg_pawns, avg_ladies;
@@ -170,6 +177,11 @@ typedef struct {
     const TournamentPlayerStats *players;
 } TournamentLeaderboardView;
 
+typedef struct {
+    const char *title;
+    const MCTSProfile *profile;     // MCTSStats.profile, merged over the run
+} SearchProfileView;
+
 // =============================================================================
 // VIEW RENDERING FUNCTIONS
 // =============================================================================
@@ -180,5 +192,6 @@ void cli_view_print_training_complete(const TrainingResultView *view);
 void cli_view_print_dataset_stats(const DatasetStatsView *view);
 void cli_view_print_tournament_roster(const TournamentRosterView *view);
 void cli_view_print_tournament_leaderboard(const TournamentLeaderboardView *view);
+void cli_view_print_search_profile(const SearchProfileView *view);
 
 #endif // CLI_VIEW_H
@@ -1,12 +1,13 @@
 /**
  * logging.h - Structured Logging Module with Severity Levels
- * 
+ *
  * Features:
  *   - 5 log levels: ERROR, WARN, INFO, DEBUG, VERBOSE
  *   - Color output for terminal (ANSI codes)
  *   - Dual output: stdout/stderr + optional file
  *   - Level filtering (set minimum level to display)
- * 
+ *   - Async mode: per-thread queues drained by a writer thread
+ *
  * Usage:
  *   log_init("path/to/file.log");   // Optional file logging
  *   log_set_level(LOG_DEBUG);       // Set minimum level
@@ -16,6 +17,16 @@
  *   log_debug("Debug data: %d", n); // Only if level >= DEBUG
  *   log_verbose("Trace: %p", ptr);  // Only if level >= VERBOSE
  *   log_close();                    // Cleanup
+ *
+ * Async mode (log_set_async(1)), for selfplay and tournaments that log per
+ * game: a message is formatted into the calling thread's ring (vsnprintf,
+ * no lock, no I/O) and a writer thread prints the rings in global order,
+ * flushing once per pass instead of once per message. log_error still
+ * flushes before returning, so an error is never lost in a queue. A full
+ * ring makes its thread wait for the writer; a message longer than
+ * LOG_RECORD_BYTES is written synchronously after the queued ones.
+ * Output printed with printf while async is on may overtake queued
+ * messages: route it through log_printf, or log_flush() first.
  */
 
 #ifndef LOGGING_H
@@ -47,107 +58,34 @@ typedef enum {
 #define LOG_COLOR_CYAN    "\033[0;36m"
 #define LOG_COLOR_GRAY    "\033[0;90m"
 
-// =============================================================================
-// GLOBAL STATE
-// =============================================================================
-
-static FILE *g_log_file = NULL;
-static LogLevel g_log_level = LOG_INFO;
-static int g_log_use_color = 1;
-
 // =============================================================================
 // CONFIGURATION
 // =============================================================================
 
-static inline void log_init(const char *path) {
-    if (path && path[0]) {
-        g_log_file = fopen(path, "w");
-    }
-}
+void log_init(const char *path);
+void log_close(void);
+void log_set_level(LogLevel level);
+void log_set_color(int enabled);
 
-static inline void log_close(void) {
-    if (g_log_file) {
-        fclose(g_log_file);
-        g_log_file = NULL;
-    }
-}
-
-static inline void log_set_level(LogLevel level) {
-    g_log_level = level;
-}
-
-static inline void log_set_color(int enabled) {
-    g_log_use_color = enabled;
-}
-
-// =============================================================================
-// CORE LOGGING FUNCTION
-// =============================================================================
+/**
+ * Switch async mode on (starts the writer) or off (drains and joins it).
+ * Also drained at exit.
+ * @return 0 on success, -1 if the writer cannot start (stays synchronous)
+ */
+int log_set_async(int enabled);
 
-static inline void log_message(LogLevel level, const char *color, 
-                               FILE *stream, const char *fmt, va_list args) {
-    if (level > g_log_level) return;
-    
-    // Terminal output with optional color
-    if (g_log_use_color && color) {
-        fprintf(stream, "%s", color);
-    }
-    vfprintf(stream, fmt, args);
-    if (g_log_use_color && color) {
-        fprintf(stream, "%s", LOG_COLOR_RESET);
-    }
-    fprintf(stream, "\n");
-    fflush(stream);
-    
-    // File output (no color)
-    if (g_log_file) {
-        va_list args_copy;
-        va_copy(args_copy, args);
-        vfprintf(g_log_file, fmt, args_copy);
-        fprintf(g_log_file, "\n");
-        fflush(g_log_file);
-        va_end(args_copy);
-    }
-}
+/** Write every queued message and flush the streams (no-op when synchronous). */
+void log_flush(void);
 
 // =============================================================================
 // PUBLIC API
 // =============================================================================
 
-static inline void log_error(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    log_message(LOG_ERROR, LOG_COLOR_RED, stderr, fmt, args);
-    va_end(args);
-}
-
-static inline void log_warn(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    log_message(LOG_WARN, LOG_COLOR_YELLOW, stderr, fmt, args);
-    va_end(args);
-}
-
-static inline void log_info(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    log_message(LOG_INFO, NULL, stdout, fmt, args);
-    va_end(args);
-}
-
-static inline void log_debug(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    log_message(LOG_DEBUG, LOG_COLOR_CYAN, stdout, fmt, args);
-    va_end(args);
-}
-
-static inline void log_verbose(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    log_message(LOG_VERBOSE, LOG_COLOR_GRAY, stdout, fmt, args);
-    va_end(args);
-}
+void log_error(const char *fmt, ...);
+void log_warn(const char *fmt, ...);
+void log_info(const char *fmt, ...);
+void log_debug(const char *fmt, ...);
+void log_verbose(const char *fmt, ...);
 
 // =============================================================================
 // BACKWARD COMPATIBILITY
@@ -155,20 +93,6 @@ static inline void log_verbose(const char *fmt, ...) {
 
 // log_printf now works like before but uses log_info internally
 // Note: We keep the old signature without automatic newline for compatibility
-static inline void log_printf(const char *fmt, ...) {
-    if (LOG_INFO > g_log_level) return;
-    
-    va_list args;
-    va_start(args, fmt);
-    vprintf(fmt, args);
-    va_end(args);
-    
-    if (g_log_file) {
-        va_start(args, fmt);
-        vfprintf(g_log_file, fmt, args);
-        fflush(g_log_file);
-        va_end(args);
-    }
-}
+void log_printf(const char *fmt, ...);
 
 #endif // LOGGING_H
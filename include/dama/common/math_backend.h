@@ -0,0 +1,120 @@
+/**
+ * math_backend.h - BLAS/LAPACK and Vector Kernel Backend
+ *
+ * One include for the CNN, training and CLOP math. The backend is picked
+ * at build time (make BLAS=accelerate|openblas|mkl):
+ * - DAMA_BLAS_ACCELERATE: Apple Accelerate (CBLAS, LAPACK, vDSP)
+ * - DAMA_BLAS_OPENBLAS:   OpenBLAS (CBLAS + bundled LAPACK)
+ * - DAMA_BLAS_MKL:        Intel MKL (CBLAS + LAPACK)
+ *
+ * The vec_* kernels use vDSP with Accelerate, otherwise AVX-512 / AVX2 /
+ * scalar loops as the target allows. The int8 kernels (quantized
+ * inference) use VNNI, AVX2, NEON dot product or scalar loops on every backend,
+ * the fp16 ones (half-precision heads) F16C, NEON or scalar conversion.
+ */
+
+#ifndef MATH_BACKEND_H
+#define MATH_BACKEND_H
+
+#if !defined(DAMA_BLAS_ACCELERATE) && !defined(DAMA_BLAS_OPENBLAS) && !defined(DAMA_BLAS_MKL)
+    #ifdef __APPLE__
+        #define DAMA_BLAS_ACCELERATE
+    #else
+        #define DAMA_BLAS_OPENBLAS
+    #endif
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(DAMA_BLAS_ACCELERATE)
+    #include <Accelerate/Accelerate.h>
+#elif defined(DAMA_BLAS_MKL)
+    #include <mkl_cblas.h>
+    #include <mkl_lapack.h>
+#else
+    #include <cblas.h>
+    // LAPACK least squares and SPD solve (bundled with OpenBLAS)
+    extern void dgels_(char *trans, int *m, int *n, int *nrhs,
+                       double *a, int *lda, double *b, int *ldb,
+                       double *work, int *lwork, int *info);
+    extern void dposv_(char *uplo, int *n, int *nrhs, double *a, int *lda,
+                       double *b, int *ldb, int *info);
+#endif
+
+// =============================================================================
+// BACKEND INFO
+// =============================================================================
+
+/** BLAS library and vector kernel set, e.g. "OpenBLAS + AVX2". */
+const char* math_backend_name(void);
+
+// =============================================================================
+// VECTOR KERNELS
+// =============================================================================
+
+float vec_max(const float *x, int n);
+float vec_sum(const float *x, int n);
+
+/** x[i] += a */
+void vec_add_scalar(float *x, float a, int n);
+
+/** x[i] = max(x[i] + a, 0) */
+void vec_add_scalar_relu(float *x, float a, int n);
+
+/**
+ * Softmax of x into out (may alias x).
+ * x is used as scratch: it holds exp(x - max) on return.
+ */
+void vec_softmax(float *x, float *out, int n);
+
+// =============================================================================
+// INT8 KERNELS
+// =============================================================================
+
+/**
+ * Dot product of activations x (0..127) and weights w (-127..127).
+ * 7-bit activations keep the AVX2 pair sums (vpmaddubsw) clear of int16
+ * saturation and fit the signed NEON sdot.
+ */
+int32_t vec_dot_s8(const int8_t *x, const int8_t *w, int n);
+
+/** y[r] = vec_dot_s8(x, &W[r * n], n) for r < rows (rows share the x loads) */
+void vec_gemv_s8(const int8_t *W, const int8_t *x, int32_t *y, int rows, int n);
+
+/** Int8 kernel set, e.g. "AVX-512 VNNI". */
+const char* vec_s8_name(void);
+
+// =============================================================================
+// FP16 KERNELS
+// =============================================================================
+// Weights stored as IEEE binary16 (uint16_t), widened to fp32 in registers;
+// activations and accumulation stay fp32.
+
+/** h[i] = x[i] rounded to half precision (nearest even). */
+void vec_f32_to_f16(const float *x, uint16_t *h, size_t n);
+
+/** x[i] = h[i] widened to fp32 (exact). */
+void vec_f16_to_f32(const uint16_t *h, float *x, size_t n);
+
+/** Dot product of half weights w and fp32 x. */
+float vec_dot_f16(const uint16_t *w, const float *x, int n);
+
+/** y[r] += dot(W[r * ld .. + n], x) for r < rows. */
+void vec_gemv_f16(const uint16_t *W, int ld, const float *x, float *y, int rows, int n);
+
+/** Y[b * ldy + r] += dot(W[r * ld .. + n], X[b * ldx .. + n]) for b < batch. */
+void vec_gemm_f16(const uint16_t *W, int ld, const float *X, int ldx, float *Y, int ldy,
+                  int rows, int n, int batch);
+
+/** Fp16 kernel set, e.g. "F16C". */
+const char* vec_f16_name(void);
+
+// =============================================================================
+// BIT EXPANSION
+// =============================================================================
+
+/** out[i] = bit i of bits as 0.0f / 1.0f, for i < 64 (one board plane). */
+void vec_bits_to_f32(uint64_t bits, float *out);
+
+#endif // MATH_BACKEND_H
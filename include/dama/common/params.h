@@ -10,6 +10,13 @@
 #define CNN_PIECE_CHANNELS  4       // white_pawns, white_ladies, black_pawns, black_ladies
 #define CNN_POLICY_SIZE     512     // 64 squares × 8 channels (4 moves + 4 captures)
 #define CNN_VALUE_HIDDEN    256     // Value head hidden layer size
+#define CNN_CONV_ALGO_DEFAULT   CNN_CONV_WINOGRAD   // Inference convs (CNN_CONV_IM2COL: im2col + sgemm)
+#define CNN_HEAD_PRECISION_DEFAULT  CNN_HEAD_FP16   // Inference FC head weights (CNN_HEAD_FP32: masters)
+#define CNN_TRAIN_ALGO_DEFAULT  CNN_TRAIN_BATCHED   // cnn_train_step (CNN_TRAIN_PER_SAMPLE: data parallel)
+#define CNN_INTRA_OP_THREADS_DEFAULT 1      // Batched neural kernels: single-threaded unless raised
+#define CNN_INTRA_OP_MIN_BATCH       16     // Smallest batch split across intra-op threads
+#define CNN_QUANT_CALIB_PERCENTILE  0.9999      // Int8 activation clip: percentile of the positive calibration values
+#define CNN_QUANT_CALIB_SAMPLES     2048        // Default calibration positions (dama data calibrate)
 
 // =============================================================================
 // GAME LIMITS
@@ -43,6 +50,7 @@
 #define ROLLOUT_EPSILON_HEURISTIC   0.0     // 100% Heuristic (no random)
 #define ROLLOUT_EPSILON_RANDOM      1.0     // Fully random rollout
 #define ROLLOUT_EPSILON_NN          0.0     // No rollouts (Neural Net only)
+#define ROLLOUT_BATCH_MAX           8       // Playouts per leaf played in lockstep (MCTSConfig.rollouts_per_leaf)
 
 // Fast Rollout Material Advantage Thresholds
 #define FAST_ROLLOUT_MATERIAL_THRESHOLD  3      // Piece diff for early termination
@@ -52,7 +60,7 @@
 
 #define EXPANSION_THRESHOLD         0
 #define DEFAULT_USE_LOOKAHEAD       1
-#define DEFAULT_TREE_REUSE          0
+#define DEFAULT_TREE_REUSE          1   // Keep the played subtree (compacted, see mcts_advance_root)
 #define DEFAULT_USE_TT              1
 #define DEFAULT_USE_SOLVER          1
 #define DEFAULT_USE_UCB1_TUNED      1
@@ -89,6 +97,24 @@
 
 #define ARENA_SIZE_TUNER        ((size_t)256 * 1024 * 1024)         // 256MB (tuner)
 
+#define ARENA_CHUNK_SIZE        ((size_t)64 * 1024)                 // Per-thread bump chunk
+
+// Arena backing per call site (ArenaOptions in mcts_types.h: pages, pre-faulted
+// bytes, bytes kept resident by arena_reset). Pre-fault threads inherit the
+// owner's CPU affinity, so pinned searches still get node-local pages.
+#define ARENA_PREFAULT_STEP     ((size_t)2 * 1024 * 1024)           // Pages faulted in per madvise call
+#define ARENA_BACKING_SEARCH    ((ArenaOptions){ ARENA_PAGES_THP, (size_t)64 << 20, (size_t)256 << 20 })  // Server, GUI, analyse, reanalyse, book
+#define ARENA_BACKING_ROOT_TREE ((ArenaOptions){ ARENA_PAGES_THP, 0, 0 })                       // Per-search root-parallel trees: first touch by their thread
+#define ARENA_BACKING_SELFPLAY  ((ArenaOptions){ ARENA_PAGES_THP, (size_t)32 << 20, 0 })        // Reset every game: pages stay
+#define ARENA_BACKING_TOURNAMENT ((ArenaOptions){ ARENA_PAGES_THP, (size_t)64 << 20, 0 })       // Reset every move: pages stay
+
+// Bounded-memory search (MCTSConfig.max_tree_nodes)
+#define MCTS_TREE_NODES_ANALYSIS    (4 * 1024 * 1024)   // Long analyses (GUI, TIME_HIGH): ~0.6 GB of nodes
+#define MCTS_PRUNE_KEEP_FRACTION    0.75                // Tree size left after a prune, relative to the budget
+
+#define PATH_SET_MAX_DEPTH      1024    // Root history + descent (repetition set)
+#define PATH_SET_SLOTS          1024    // Counting filter slots (power of two)
+
 // =============================================================================
 // HEURISTIC WEIGHTS (SPSA-tuned)
 // =============================================================================
@@ -117,12 +143,23 @@
 //
 #define NUM_MCTS_THREADS        0           // Set to 0 for maximal throughput in parallel self-play (sequential search)
 #define MCTS_BATCH_SIZE         64          // Max batch size for Async MCTS inference
+#define MCTS_LEAF_BATCH         8           // Leaves per CNN call in sequential search (1 = off)
+#define INFERENCE_SPIN_LIMIT    256         // Busy-wait iterations before a waiting thread sleeps
+#define INFERENCE_GATHER_US     50          // Evaluator waits this long for a batch to fill
+#define INFERENCE_IDLE_US       200         // Evaluator sleep on an empty ring (limit-check period)
+#define INFERENCE_SERVER_GATHER_US 200      // Shared server: independent games need a wider gather window
+#define INFERENCE_MAX_EVALUATORS 4          // Upper bound on evaluator threads per server
+#define MCTS_EVALUATOR_THREADS  1           // Evaluators per threaded search (>1: overlapping batches)
 
 // =============================================================================
 // TRAINING & LOGGING
 // =============================================================================
 
 #define LOG_RETENTION_COUNT     10          // Keep last N log files
+#define TRACE_RING_EVENTS       65536       // Spans kept per thread with make TRACE=1 (24 B each)
+#define LOG_RING_RECORDS        256         // Async logging: queued messages per thread
+#define LOG_RECORD_BYTES        240         // Async logging: longer messages are written synchronously
+#define LOG_WRITER_POLL_US      2000        // Async logging: writer sleep when every ring is empty
 
 // Mixed Opponent Training
 #define MIX_OPPONENT_PROB       0.25        // 25% of games vs Grandmaster Heuristics
@@ -131,16 +168,87 @@
 #define ARENA_SIZE_SELFPLAY         ((size_t)512 * 1024 * 1024) // 512 MB for persistence
 #define ARENA_SIZE_TOURNAMENT       ((size_t)512 * 1024 * 1024)  // 512 MB (reset per move)
 #define ARENA_SIZE_BENCHMARK        ((size_t)64 * 1024 * 1024)
+#define ARENA_SIZE_REANALYSE        ((size_t)128 * 1024 * 1024) // One search per position
+#define ARENA_SIZE_BOOK             ((size_t)128 * 1024 * 1024) // One search per book position
+#define ARENA_SIZE_ANALYSE          ((size_t)128 * 1024 * 1024) // One search per position (mcts_search_many)
+#define ANALYSE_BATCH               1024        // Positions per mcts_search_many call of dama analyse
+
+// =============================================================================
+// ENDGAME TABLEBASES
+// =============================================================================
+
+#define TB_MAX_PIECES               6           // Largest material a table can hold (both sides)
+#define TB_DEFAULT_DIR              "out/tablebases"
+
+// =============================================================================
+// ENGINE SERVER (dama serve)
+// =============================================================================
+
+#define SERVE_INFO_INTERVAL         0.5         // Seconds between info lines of a running search
+#define SERVE_MAX_LINE              8192        // Longest command line (position with its moves)
+#define MCTS_PV_MAX                 32          // Moves of a reported principal variation
+#define ARENA_SIZE_SERVE            ((size_t)1024 * 1024 * 1024) // 1 GB, kept across requests
+
+// =============================================================================
+// OPENING BOOK
+// =============================================================================
+
+#define BOOK_DEFAULT_PATH           "out/opening.book"
+#define BOOK_SEARCH_DEPTH           6           // Plies searched from the start position
+#define BOOK_SEARCH_NODES           100000      // Search budget per book position
+#define BOOK_MIN_SHARE              0.15        // Root visit share a move needs to be searched further
+#define BOOK_MIN_GAMES              20          // Dataset books: times a move must have been played
+#define BOOK_GAMES_MIN_PIECES       18          // Dataset books: fewer pieces on the board is past the opening
+#define BOOK_MIN_VISITS             2           // Fewer visits on the top move: out of book
+#define BOOK_PICK_SHARE             0.5         // Random picks: share of the top visits a move needs
+
+// =============================================================================
+// PERSISTENT SEARCH CACHE
+// =============================================================================
+
+#define SEARCH_CACHE_ENTRIES        (64 * 1024) // New cache files (128 B each: 8 MB)
+#define SEARCH_CACHE_MIN_VISITS     32          // Fewer root visits are not worth storing
+
+// =============================================================================
+// TOURNAMENT EARLY STOPPING
+// =============================================================================
+
+#define SPRT_ALPHA                  0.05        // False "H1" rate
+#define SPRT_BETA                   0.05        // False "H0" rate
+#define SPRT_MIN_GAMES              10          // No verdict before this many games
+
+// =============================================================================
+// TIME MANAGEMENT (game clock: base + increment)
+// =============================================================================
+
+#define TIME_MOVES_HORIZON          30          // Our moves the clock is spread over at the start
+#define TIME_MOVES_MIN              8           // ...and never fewer, however long the game
+#define TIME_INCREMENT_SHARE        0.8         // Share of the increment a move may spend
+#define TIME_HARD_FACTOR            3.0         // Hard cap: this many soft budgets...
+#define TIME_HARD_SHARE             0.3         // ...but never more of the remaining clock
+#define TIME_SAFETY_MARGIN          0.05        // Seconds always kept on the clock
+#define TIME_STABLE_SHARE           0.25        // Past soft: extend if the best move took the lead in this last share
+#define TIME_CHECK_MS               10          // Threaded search: managed-time checks this often (>= SEARCH_STOP_POLL_MS)
 
 // =============================================================================
 // SELFPLAY CONFIGURATION
 // =============================================================================
 
 #define SELFPLAY_MAX_MOVES          200         // Max moves per self-play game
+#define SELFPLAY_FULL_SEARCH_PROB   0.25f       // Playout cap: share of moves searched in full
+#define SELFPLAY_WRITE_SAMPLES      (4 * 1024)  // Queued samples that trigger a write (whole dataset blocks)
+#define SELFPLAY_WRITE_INTERVAL_MS  5000        // Longest a finished game waits to reach the output
+#define NET_COLLECTOR_PORT          7878        // Default sample collector port (dama collect)
+#define NET_COLLECTOR_BIND          "127.0.0.1" // Default collector address: loopback (dama collect --bind)
+#define NET_WORKER_ROUND_GAMES      32          // Worker games between model checks
+#define NET_RETRY_SECONDS           5           // Worker reconnect delay
+#define NET_POLL_MS                 200         // Collector threads check for stop this often
+#define REANALYSE_VALUE_BLEND       0.0f        // Reanalyse: weight of the search value in target_value
 #define RESIGN_THRESHOLD            -0.90f      // Neural network value below which to resign
 #define RESIGN_CHECK_THRESHOLD      40          // Moves before resignation checks begin
 #define EARLY_EXIT_CHECK_INTERVAL   10          // Check early exit every N nodes
 #define EARLY_EXIT_MIN_VISITS       40          // Minimum visits before early exit checks
+#define SEARCH_STOP_POLL_MS         5           // Threaded search: external stop flag checked this often
 // =============================================================================
 // TRAINING - NEURAL NETWORK
 // =============================================================================
@@ -158,6 +266,16 @@
 #define CNN_LR_DECAY_FACTOR     0.5f        // Multiply LR by this on plateau
 #define CNN_LR_DECAY_PATIENCE   2           // Epochs without improvement before decay
 
+// Dataset streaming (training_run maps the file, see DatasetStream)
+#define DATASET_BLOCK_SAMPLES   1024        // Contiguous samples read together (~2.2 MB)
+#define DATASET_SHUFFLE_BLOCKS  16          // Blocks shuffled together (~36 MB resident)
+#define REPLAY_SEGMENT_SAMPLES  65536       // Replay buffer segment capacity (~4 MB in v2)
+#define DEDUPE_PARTITION_BYTES  (256u << 20) // Decoded samples per dedupe partition (one per thread in memory)
+#define DEDUPE_MAX_PARTITIONS   64          // Each holds one decoded block in the final merge
+#define TRAINING_PREFETCH_DEPTH 2           // Batches assembled ahead of the train step (double buffering)
+
 #define TT_SIZE_DEFAULT             (1024 * 1024)
+#define CNN_CACHE_SIZE_DEFAULT      (64 * 1024) // NN eval cache entries (power of two, ~210 B each)
+#define CNN_CACHE_MAX_MOVES         32          // Positions with more legal moves are not cached
 
 #endif // PARAMS_H
@@ -0,0 +1,58 @@
+/**
+ * perf_counters.h - Hardware Performance Counters
+ *
+ * Cycles, instructions, L1D read misses, branch misses and LLC read misses
+ * of the calling thread, user space only, through perf_event_open (Linux).
+ * The events form one group read with a single read(); when the PMU
+ * multiplexes them the counts are scaled by enabled / running time.
+ *
+ * Off until perf_counters_enable(). From then on each thread opens its
+ * group on its first read and closes it when it exits, so counts are
+ * per thread: a reading brackets the work of the thread that takes it.
+ * Where there is no PMU (other systems, VMs without a virtual PMU,
+ * perf_event_paranoid > 2) enabling fails and readings stay zero.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,        // L1 data read misses
+    PERF_BRANCH_MISSES,
+    PERF_LLC_MISSES,        // Last-level cache read misses
+    PERF_EVENTS
+} PerfEvent;
+
+typedef struct {
+    uint64_t count[PERF_EVENTS];
+} PerfReading;
+
+extern int perf_counters_on;    // Set by a successful perf_counters_enable
+
+/**
+ * Turn counting on for every thread (tries the events on the caller).
+ * @return Events available (0: none, reason logged)
+ */
+int perf_counters_enable(void);
+
+/** Bit e set if event e counts on this machine. */
+unsigned perf_counters_available(void);
+
+/** Short name of an event, for reports. */
+const char* perf_event_name(int event);
+
+/** Counts of the calling thread so far (zero when off or unavailable). */
+void perf_counters_read(PerfReading *out);
+
+/** out = end - start, event by event. */
+static inline void perf_reading_delta(PerfReading *out, const PerfReading *end, const PerfReading *start) {
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        out->count[e] = end->count[e] > start->count[e] ? end->count[e] - start->count[e] : 0;
+    }
+}
+
+#endif // PERF_COUNTERS_H
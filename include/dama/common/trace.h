@@ -0,0 +1,55 @@
+/**
+ * trace.h - Timeline Tracing (Chrome / Perfetto JSON)
+ *
+ * Contains: per-thread span rings, TRACE_* macros, the JSON dump.
+ *
+ * Compiled in with -DDAMA_TRACE (make TRACE=1); otherwise the macros are
+ * empty. Even then nothing is recorded until trace_open names the output
+ * file (dama --trace <file> <command> ...); the rings are written there at
+ * exit, ready for chrome://tracing or ui.perfetto.dev.
+ *
+ * A thread's first span allocates its ring (TRACE_RING_EVENTS spans, the
+ * oldest overwritten) and pushes it on a lock-free list; recording is a
+ * plain store into the thread's own ring. Each span is one complete event
+ * (start and duration), so a wrapped ring never holds a begin without its
+ * end. Rings outlive their threads: workers and evaluators of finished
+ * searches still show up in the dump.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+extern int trace_on;    // Set by trace_open
+
+/**
+ * Start recording; the trace is written to `path` at exit (atexit).
+ * @return 0 on success, -1 if this build has no tracing (logged)
+ */
+int trace_open(const char *path);
+
+/** Write every ring now (also done at exit). @return 0, or -1 on I/O error */
+int trace_dump(void);
+
+/** Monotonic nanoseconds. */
+uint64_t trace_now(void);
+
+/** Record a span from `start_ns` to now. `name` must be a string literal. */
+void trace_span(const char *name, uint64_t start_ns);
+
+/** Name the calling thread in the trace (literal; first call wins). */
+void trace_thread_name(const char *name);
+
+#ifdef DAMA_TRACE
+    #define TRACE_BEGIN(t)          uint64_t t = trace_on ? trace_now() : 0
+    #define TRACE_END(name, t)      do { if (t) trace_span((name), (t)); } while (0)
+    #define TRACE_THREAD(name)      do { if (trace_on) trace_thread_name(name); } while (0)
+#else
+    // Release: No overhead
+    #define TRACE_BEGIN(t)          ((void)0)
+    #define TRACE_END(name, t)      ((void)0)
+    #define TRACE_THREAD(name)      ((void)0)
+#endif
+
+#endif // TRACE_H
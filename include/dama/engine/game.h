@@ -73,6 +73,37 @@ typedef struct {
     uint8_t count;
 } MoveList;
 
+// --- Packed Moves ---
+// A Move in one integer. Captured squares are a mask over the 32 dark
+// squares (sq >> 1). Intermediate landings of a multi-jump are not kept:
+// movegen_unpack_move() rebuilds the full Move from the position.
+// The Italian priority fields sit in the top bits, so
+// (m >> PM_PRIORITY_SHIFT) orders captures like calculate_score().
+//
+//   bits  0-5   from          bits 18-49  captured mask (dark squares)
+//   bits  6-11  first landing bit  54     first captured is lady
+//   bits 12-17  final square  bits 55-58  captured ladies
+//                             bit  59     moving piece is lady
+//                             bits 60-63  length (captures)
+typedef uint64_t PackedMove;
+
+typedef struct {
+    PackedMove moves[MAX_MOVES];
+    uint8_t count;
+} PackedMoveList;
+
+#define PM_STEP_SHIFT      6
+#define PM_TO_SHIFT        12
+#define PM_CAPTURED_SHIFT  18
+#define PM_PRIORITY_SHIFT  54
+#define PM_LADIES_SHIFT    55
+#define PM_LADY_SHIFT      59
+#define PM_LENGTH_SHIFT    60
+#define PM_NONE            ((PackedMove)0)
+
+#define DARK_INDEX(sq)     ((sq) >> 1)
+#define DARK_SQUARE(i)     (((i) << 1) | ((((i) >> 2) & 1) ^ 1))
+
 // --- Game State ---
 typedef struct {
     Bitboard piece[NUM_COLORS][NUM_PIECE_TYPES];
@@ -81,6 +112,15 @@ typedef struct {
     uint64_t hash;
 } GameState;
 
+// --- Undo Record ---
+// Everything apply_move destroys; filled by apply_move_with_undo.
+typedef struct {
+    uint64_t hash;
+    Bitboard captured[NUM_PIECE_TYPES];   // Opponent pieces removed, by type
+    uint8_t moves_without_captures;
+    uint8_t promoted;                     // Pawn reached the last rank
+} MoveUndo;
+
 // --- Constant Masks ---
 static const Bitboard PROM_RANKS[NUM_COLORS] = {
     0xFF00000000000000ULL,  // WHITE
@@ -109,6 +149,39 @@ static inline int check_bit(const Bitboard bb, const int sq) {
     return TEST_BIT(bb, sq) ? 1 : 0;
 }
 
+static inline int pmove_from(const PackedMove m)     { return (int)(m & 63); }
+static inline int pmove_step(const PackedMove m)     { return (int)((m >> PM_STEP_SHIFT) & 63); }
+static inline int pmove_to(const PackedMove m)       { return (int)((m >> PM_TO_SHIFT) & 63); }
+static inline int pmove_length(const PackedMove m)   { return (int)(m >> PM_LENGTH_SHIFT); }
+static inline int pmove_is_lady(const PackedMove m)  { return (int)((m >> PM_LADY_SHIFT) & 1); }
+static inline int pmove_captured_ladies(const PackedMove m) { return (int)((m >> PM_LADIES_SHIFT) & 15); }
+static inline uint32_t pmove_captured(const PackedMove m) { return (uint32_t)(m >> PM_CAPTURED_SHIFT); }
+
+// Captured squares as a full-board bitboard
+static inline Bitboard pmove_captured_bb(const PackedMove m) {
+    uint32_t mask = pmove_captured(m);
+    Bitboard bb = 0;
+    while (mask) {
+        bb |= BIT(DARK_SQUARE(__builtin_ctz(mask)));
+        mask &= mask - 1;
+    }
+    return bb;
+}
+
+static inline PackedMove move_pack(const Move *m) {
+    const int to = (m->length == 0) ? m->path[1] : m->path[m->length];
+    uint32_t captured = 0;
+    for (int i = 0; i < m->length; i++) captured |= 1u << DARK_INDEX(m->captured_squares[i]);
+    return (PackedMove)m->path[0]
+         | ((PackedMove)m->path[1] << PM_STEP_SHIFT)
+         | ((PackedMove)to << PM_TO_SHIFT)
+         | ((PackedMove)captured << PM_CAPTURED_SHIFT)
+         | ((PackedMove)(m->first_captured_is_lady & 1) << PM_PRIORITY_SHIFT)
+         | ((PackedMove)m->captured_ladies_count << PM_LADIES_SHIFT)
+         | ((PackedMove)(m->is_lady_move & 1) << PM_LADY_SHIFT)
+         | ((PackedMove)m->length << PM_LENGTH_SHIFT);
+}
+
 // --- Public API ---
 
 /**
@@ -126,4 +199,36 @@ void init_game(GameState *state);
  */
 void apply_move(GameState *state, const Move *move);
 
+/**
+ * @brief Apply a packed move. Same result as apply_move() on the unpacked Move.
+ *
+ * @param state Pointer to the current GameState.
+ * @param move The PackedMove to apply.
+ */
+void apply_packed_move(GameState *state, PackedMove move);
+
+/**
+ * @brief Apply a move in place, recording what is needed to take it back.
+ *
+ * Same effect as apply_move. Pair with undo_move to walk a line on a single
+ * GameState instead of copying it at every ply.
+ *
+ * @param state Pointer to the current GameState.
+ * @param move Pointer to the Move to apply.
+ * @param undo Output record, passed unchanged to undo_move.
+ */
+void apply_move_with_undo(GameState *state, const Move *move, MoveUndo *undo);
+
+/**
+ * @brief Take back a move applied with apply_move_with_undo.
+ *
+ * Restores bitboards, side to move, moves_without_captures and hash exactly.
+ * Moves must be undone in reverse order of application.
+ *
+ * @param state Pointer to the GameState the move was applied to.
+ * @param move The same Move passed to apply_move_with_undo.
+ * @param undo The record filled by apply_move_with_undo.
+ */
+void undo_move(GameState *state, const Move *move, const MoveUndo *undo);
+
 #endif /* GAME_H */
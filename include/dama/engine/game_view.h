@@ -7,6 +7,9 @@
 #define GAME_VIEW_H
 
 #include "dama/engine/game.h"
+#include <stddef.h>
+
+#define MOVE_TEXT_MAX   (3 * (MAX_CHAIN_LENGTH + 1))   // "A1" plus "xB2" per jump, and the '\0'
 
 /**
  * @brief Print the board to stdout (ASCII representation).
@@ -36,4 +39,18 @@ void print_move_list(const MoveList *list);
  */
 void print_move_description(Move m);
 
+/**
+ * @brief Write a move as print_move_description does ("B3-A4", "D3xF5xD7").
+ *
+ * @return Characters written (as snprintf).
+ */
+int format_move(const Move *m, char *out, size_t size);
+
+/**
+ * @brief Find the legal move of s written as text (format_move, any case).
+ *
+ * @return 1 if found, 0 if text is not a legal move of s.
+ */
+int parse_move(const GameState *s, const char *text, Move *out);
+
 #endif /* GAME_VIEW_H */
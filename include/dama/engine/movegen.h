@@ -27,14 +27,62 @@ void movegen_init(void);
  */
 void movegen_generate(const GameState *s, MoveList *list);
 
+/**
+ * @brief Same as movegen_generate(), producing packed moves.
+ *
+ * Quiet positions are packed straight from the set-wise generator.
+ *
+ * @param s Pointer to the current GameState.
+ * @param list Pointer to the PackedMoveList to populate.
+ */
+void movegen_generate_packed(const GameState *s, PackedMoveList *list);
+
+/**
+ * @brief Expand a packed move back into a full Move (path included).
+ *
+ * Simple moves need no position. Captures are rebuilt by generating the
+ * legal moves of 's' and matching; 's' must be the position the move is
+ * played from.
+ *
+ * @param s Position before the move (may be NULL for simple moves).
+ * @param packed The packed move.
+ * @param out Output Move.
+ * @return 1 on success, 0 if 'packed' is not legal in 's'.
+ */
+int movegen_unpack_move(const GameState *s, PackedMove packed, Move *out);
+
 /**
  * @brief Generate simple (non-capture) moves only.
  *
+ * Set-wise: one masked shift per direction finds every movable piece.
+ * Resets list->count.
+ *
  * @param s Pointer to the current GameState.
  * @param list Pointer to the MoveList to populate.
  */
 void movegen_generate_simple(const GameState *s, MoveList *list);
 
+/**
+ * @brief Reference per-square (lookup table) version of movegen_generate_simple().
+ *
+ * Same moves in the same order. Kept for tests and benchmarks.
+ *
+ * @param s Pointer to the current GameState.
+ * @param list Pointer to the MoveList to populate.
+ */
+void movegen_generate_simple_table(const GameState *s, MoveList *list);
+
+/**
+ * @brief Check whether the side to move has at least one capture.
+ *
+ * Set-wise shift test, no chain search. Captures are mandatory, so this
+ * also tells whether movegen_generate() returns captures.
+ *
+ * @param s Pointer to the current GameState.
+ * @return 1 if a capture is available, 0 otherwise.
+ */
+int movegen_has_capture(const GameState *s);
+
 /**
  * @brief Generate all capture moves (no Italian priority filtering).
  *
@@ -43,6 +91,37 @@ void movegen_generate_simple(const GameState *s, MoveList *list);
  */
 void movegen_generate_captures(const GameState *s, MoveList *list);
 
+/**
+ * @brief Count legal moves (Italian priority applied) without building a MoveList.
+ *
+ * Matches movegen_generate(s, &list).count whenever the result fits in MAX_MOVES.
+ *
+ * @param s Pointer to the current GameState.
+ * @return Number of legal moves for the side to move.
+ */
+int movegen_count(const GameState *s);
+
+/**
+ * @brief Check whether the side to move has at least one legal move.
+ *
+ * Cheaper than movegen_count(); stops at the first move found.
+ *
+ * @param s Pointer to the current GameState.
+ * @return 1 if any legal move exists, 0 if the side to move has lost.
+ */
+int movegen_has_any_move(const GameState *s);
+
+/**
+ * @brief Count leaf nodes of the legal move tree (perft).
+ *
+ * Uses movegen_count() at the last ply (bulk counting).
+ *
+ * @param s Pointer to the current GameState.
+ * @param depth Plies to search (0 returns 1).
+ * @return Number of leaf positions at the given depth.
+ */
+uint64_t movegen_perft(const GameState *s, int depth);
+
 /**
  * @brief Check if a square could be captured by opponent on their next move.
  *
@@ -0,0 +1,83 @@
+/**
+ * tablebase.h - Endgame Tablebases (win/draw/loss)
+ *
+ * Exact results of every position with few pieces, by retrograde analysis.
+ * One table per material signature (white pawns, white ladies, black pawns,
+ * black ladies; at most TB_MAX_PIECES in all, at least one piece a side).
+ *
+ * Index: pawns by color as combinations of the 28 dark squares they can
+ * stand on, then white and black ladies as combinations of the squares
+ * still free, then the side to move. Lady placements are perfect; only a
+ * white and a black pawn on the same square make a broken slot (stored as
+ * TB_UNKNOWN).
+ *
+ * Generation works up from two pieces: a capture leads to fewer pieces and
+ * a promotion to fewer pawns, so every successor leaving the table being
+ * built is already known. Inside the table, passes over the index resolve
+ * positions from their successors (a lost successor wins, all won lose)
+ * until nothing changes; what is left can never be forced and is a draw.
+ * The passes run in parallel across the index.
+ *
+ * Files hold 2 bits per position ("<wp>P<wl>L-<bp>P<bl>L.wdl" in one
+ * directory) and are probed in place through mmap. Results ignore
+ * MAX_MOVES_WITHOUT_CAPTURES: a win may be too long to play out before the
+ * move counter draws it.
+ */
+
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "dama/engine/game.h"
+#include <stddef.h>
+
+typedef enum {
+    TB_UNKNOWN = 0,     // Not in the tables (too many pieces, missing file, broken slot)
+    TB_DRAW = 1,
+    TB_WIN = 2,         // For the side to move
+    TB_LOSS = 3
+} TBResult;
+
+#define TB_SIGNATURES   (8 * 8 * 8 * 8)   // Piece counts fit in 3 bits each
+
+typedef struct {
+    const uint8_t *data;        // 2-bit results, 4 positions per byte (NULL: not loaded)
+    size_t entries;             // Positions x 2 sides to move
+    void *mapping;              // mmap of the whole file, or NULL if data is malloc'ed
+    size_t mapping_bytes;
+} TBTable;
+
+typedef struct {
+    TBTable tables[TB_SIGNATURES];
+    int max_pieces;             // Largest material with a loaded table (0: none)
+} Tablebase;
+
+typedef struct {
+    int threads;                // Threads per pass (0: OpenMP default)
+    void (*on_table)(const char *name, size_t positions, int passes, double seconds);  // May be NULL
+} TablebaseGenConfig;
+
+/**
+ * Build all tables up to max_pieces (<= TB_MAX_PIECES) into dir, which
+ * must exist. Tables already in dir are loaded instead of rebuilt, so
+ * 5-piece tables extend to 6 without redoing the rest. Needs zobrist_init
+ * and movegen_init.
+ * @return 0 on success, -1 on error (logged)
+ */
+int tablebase_generate(const char *dir, int max_pieces, const TablebaseGenConfig *cfg);
+
+/**
+ * Map every table found in dir (up to TB_MAX_PIECES).
+ * @return Tables loaded (0 if none), -1 if a file is corrupt
+ */
+int tablebase_open(Tablebase *tb, const char *dir);
+
+/** Unmap and free all tables. */
+void tablebase_close(Tablebase *tb);
+
+/**
+ * Result of s for the side to move. A side without pieces to move has
+ * lost; positions beyond tb->max_pieces are TB_UNKNOWN at once.
+ */
+TBResult tablebase_probe(const Tablebase *tb, const GameState *s);
+
+#endif // TABLEBASE_H
@@ -47,10 +47,51 @@ void cnn_encode_state(const GameState *state, float *tensor, float *player);
  */
 void cnn_encode_sample(const TrainingSample *sample, float *tensor, float *player);
 
+/**
+ * Same canonical planes as cnn_encode_state + history, as the list of set
+ * bits (what the inference conv1 reads). hist1/hist2 may be NULL.
+ */
+void cnn_encode_sparse(const GameState *state, const GameState *hist1,
+                       const GameState *hist2, CNNSparseInput *out);
+
 // =============================================================================
 // API FUNCTIONS - INFERENCE
 // =============================================================================
 
+/**
+ * Fold the BN running stats into the conv weights (fused_conv*, wino_conv*,
+ * sparse_conv1_w) and refresh the half copies of the heads (*_h).
+ * Done by cnn_init, cnn_load_weights and cnn_update_weights; call it again
+ * after editing conv or BN params by hand, before the next forward pass.
+ */
+void cnn_fold_batch_norm(CNNWeights *w);
+
+/**
+ * Convolution algorithm used by every forward pass (default CNN_CONV_ALGO_DEFAULT).
+ * Process-wide: set it before starting searches, not during one.
+ */
+void cnn_set_conv_algo(CNNConvAlgo algo);
+CNNConvAlgo cnn_get_conv_algo(void);
+
+/**
+ * FC head weight precision used by every forward pass (default
+ * CNN_HEAD_PRECISION_DEFAULT). Training always runs on the fp32 masters.
+ * Process-wide, like cnn_set_conv_algo.
+ */
+void cnn_set_head_precision(CNNHeadPrecision precision);
+CNNHeadPrecision cnn_get_head_precision(void);
+
+/**
+ * Intra-op threads of the batched neural kernels (default
+ * CNN_INTRA_OP_THREADS_DEFAULT = 1: single-threaded, vectorized). Only
+ * batches of CNN_INTRA_OP_MIN_BATCH+ positions outside any OpenMP parallel
+ * region split; per-position kernels never do, so callers that are already
+ * parallel (search workers, self-play games, training samples) never nest.
+ * Process-wide, like cnn_set_conv_algo.
+ */
+void cnn_set_intra_op_threads(int threads);
+int cnn_get_intra_op_threads(void);
+
 /**
  * Forward pass using TrainingSample (with full history encoding).
  */
@@ -64,7 +105,8 @@ void cnn_forward_with_history(const CNNWeights *w, const GameState *state,
                             CNNOutput *out);
 
 /**
- * Batch forward pass for multiple states (optimized with BLAS sgemm).
+ * Batch forward pass for multiple states (one GEMM per FC head), or one
+ * call into the attached backend (cnn_backend.h).
  * @param w          Network weights
  * @param states     Array of game state pointers (batch_size)
  * @param hist1s     Array of history-1 state pointers (can be NULL)
@@ -79,6 +121,53 @@ void cnn_forward_batch(const CNNWeights *w,
                        CNNOutput *outs, 
                        int batch_size);
 
+/**
+ * Forward passes that evaluate only the listed policy rows (see
+ * cnn_policy_subset): softmax over the legal moves, 0 elsewhere. The
+ * priors match the full softmax renormalized over the legal moves.
+ * legal == NULL computes the full 512-way policy; the batch variant takes
+ * one subset per sample.
+ */
+void cnn_forward_legal(const CNNWeights *w, const GameState *state,
+                       const GameState *hist1, const GameState *hist2,
+                       const CNNPolicySubset *legal, CNNOutput *out);
+
+void cnn_forward_batch_legal(const CNNWeights *w,
+                             const GameState **states,
+                             const GameState **hist1s,
+                             const GameState **hist2s,
+                             const CNNPolicySubset *legal,
+                             CNNOutput *outs,
+                             int batch_size);
+
+/**
+ * Inference workspace for batches of up to max_batch positions.
+ * @return NULL on OOM
+ */
+CNNWorkspace* cnn_workspace_create(int max_batch);
+void cnn_workspace_free(CNNWorkspace *ws);
+
+/**
+ * cnn_forward_batch_legal on the caller's workspace; batches larger than
+ * ws->max_batch run in chunks. The other forward entry points use a
+ * thread-local workspace, grown on demand and kept for the thread.
+ */
+void cnn_forward_batch_legal_ws(const CNNWeights *w, CNNWorkspace *ws,
+                                const GameState **states,
+                                const GameState **hist1s,
+                                const GameState **hist2s,
+                                const CNNPolicySubset *legal,
+                                CNNOutput *outs,
+                                int batch_size);
+
+/** Free the calling thread's default workspace (e.g. before thread exit). */
+void cnn_workspace_cleanup(void);
+
+/**
+ * Distinct policy indices of the legal moves in state.
+ */
+void cnn_policy_subset(const GameState *state, CNNPolicySubset *out);
+
 /**
  * Get prior probability for a move (for PUCT).
  */
@@ -101,6 +190,14 @@ void cnn_zero_gradients(CNNWeights *w);
 void cnn_clip_gradients(CNNWeights *w, float threshold);
 void cnn_update_weights(CNNWeights *w, float policy_lr, float value_lr, float momentum, float l1_decay, float l2_decay, int batch_size);
 
+/**
+ * Training algorithm of cnn_train_step (default CNN_TRAIN_ALGO_DEFAULT).
+ * CNN_TRAIN_BATCHED normalizes with the statistics of the whole batch and
+ * updates the BN running stats once per step. Process-wide.
+ */
+void cnn_set_train_algo(CNNTrainAlgo algo);
+CNNTrainAlgo cnn_get_train_algo(void);
+
 /**
  * Train on a batch of samples. Returns average loss.
  */
@@ -126,15 +223,25 @@ void cnn_training_cleanup(void);
 // =============================================================================
 
 /**
- * Save weights to binary file.
+ * Save weights as a versioned model file: the masters plus the inference
+ * form as of the last cnn_fold_batch_norm, checksummed. Replaces path
+ * atomically. Returns 0 on success, -1 on failure.
  */
-void cnn_save_weights(const CNNWeights *w, const char *path);
+int cnn_save_weights(const CNNWeights *w, const char *path);
 
 /**
- * Load weights from binary file. Returns 0 on success, -1 on failure.
+ * Load weights into an initialized w. Model files are memory-mapped and
+ * used in place (no copy, no refold unless the stored inference form is
+ * stale); pre-versioned raw files are read and folded. Returns 0 on
+ * success, -1 on failure (w keeps its previous weights).
  */
 int cnn_load_weights(CNNWeights *w, const char *path);
 
+/**
+ * Copy the mapped tensors to the heap and unmap the model file.
+ */
+void cnn_release_mapping(CNNWeights *w);
+
 // =============================================================================
 // API FUNCTIONS - MOVE MAPPING
 // =============================================================================
@@ -146,6 +253,11 @@ int cnn_load_weights(CNNWeights *w, const char *path);
  */
 int cnn_move_to_index(const Move *move, int color);
 
+/**
+ * Same mapping for a packed move (uses its from and first landing squares).
+ */
+int cnn_packed_move_to_index(PackedMove move, int color);
+
 // =============================================================================
 // INTERNAL HELPERS (Shared across modules)
 // =============================================================================
@@ -174,6 +286,7 @@ void batch_norm_forward_relu(
     int is_training
 );
 
+// Adds into d_gamma/d_beta; callers running concurrently pass their own
 void batch_norm_backward(
     const float *d_output, const float *input,
     const float *gamma, const float *batch_mean, const float *batch_var,
@@ -181,6 +294,9 @@ void batch_norm_backward(
     int C, int H, int W
 );
 
+// cnn_free: drop the mapped tensors (without copying) and unmap
+void cnn_unmap_weights(CNNWeights *w);
+
 // Used by encoding functions
 void encode_state_channels_canonical(const GameState *state, float *tensor, int channel_offset);
 void encode_state_channels(const GameState *state, float *tensor, int channel_offset);
@@ -0,0 +1,72 @@
+/**
+ * cnn_backend.h - Accelerator Backends for Batched Inference
+ *
+ * A backend keeps its own copy of a network's inference form (on the device,
+ * for a GPU) and evaluates batches given as packed bitboards. Attach one to
+ * CNNWeights and every batched forward (cnn_forward_batch*, hence the MCTS
+ * batches, the inference server and self-play) runs on it; single-position
+ * forwards stay on the built-in CPU path.
+ *
+ * "cpu" is the reference implementation (the built-in path behind the same
+ * interface). Device backends register in cnn_backend.c, built only when
+ * their SDK is available.
+ */
+
+#ifndef CNN_BACKEND_H
+#define CNN_BACKEND_H
+
+#include "dama/neural/cnn_types.h"
+
+typedef struct CNNBackend {
+    const char *name;
+    /** Copy w's inference form to the device; NULL on failure. */
+    void* (*upload)(const CNNWeights *w);
+    void (*release)(void *model);
+    /** Same contract as cnn_forward_batch_legal (legal may be NULL). */
+    void (*forward)(void *model, const CNNPackedInput *in, const CNNPolicySubset *legal,
+                    CNNOutput *outs, int batch);
+} CNNBackend;
+
+extern const CNNBackend cnn_backend_cpu;
+
+/** Backend by name ("cpu"); NULL when it is not built in. */
+const CNNBackend* cnn_backend_find(const char *name);
+
+/**
+ * Upload w to backend and route its batched forwards there (replaces a
+ * previous backend). The device copy is a snapshot: attach again after
+ * updating the weights. Takes precedence over CNNWeights.quant.
+ * @return ERR_OK, ERR_NULL_PTR or ERR_MEMORY (upload failed, w unchanged)
+ */
+int cnn_backend_attach(CNNWeights *w, const CNNBackend *backend);
+
+/**
+ * Attach the backend called name (the commands' --backend option).
+ * @return ERR_INVALID_ARG if no such backend is built in, else as
+ *         cnn_backend_attach
+ */
+int cnn_backend_attach_named(CNNWeights *w, const char *name);
+
+/** Release the device copy and go back to the built-in path. */
+void cnn_backend_detach(CNNWeights *w);
+
+/**
+ * Canonical planes of state + history as bitboards (hist1/hist2 may be NULL).
+ */
+void cnn_encode_packed(const GameState *state, const GameState *hist1,
+                       const GameState *hist2, CNNPackedInput *out);
+
+/** Dense [12][64] float planes of packed ones (cnn_encode_sample layout). */
+void cnn_packed_to_dense(const CNNPackedInput *in, float *tensor);
+
+/** Set-bit list of packed planes (what the CPU conv1 reads). */
+void cnn_packed_to_sparse(const CNNPackedInput *in, CNNSparseInput *out);
+
+/**
+ * Built-in forward (fp32 / CNN_HEAD_FP16, never int8) on packed inputs,
+ * on the calling thread's workspace.
+ */
+void cnn_forward_packed(const CNNWeights *w, const CNNPackedInput *in,
+                        const CNNPolicySubset *legal, CNNOutput *outs, int batch);
+
+#endif // CNN_BACKEND_H
@@ -0,0 +1,71 @@
+/**
+ * cnn_cache.h - Neural Evaluation Cache
+ *
+ * Fixed-size, lock-free cache of CNN results keyed by the Zobrist hashes
+ * of a position and its two history states (the full network input).
+ * Only the legal-move entries of the policy are stored.
+ */
+
+#ifndef CNN_CACHE_H
+#define CNN_CACHE_H
+
+#include "dama/neural/cnn_types.h"
+#include "dama/common/params.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Direct-mapped entry guarded by a seqlock: 'seq' is odd while a writer
+ * fills it, and a reader that sees 'seq' change during its copy treats
+ * the lookup as a miss.
+ */
+typedef struct {
+    _Atomic uint64_t seq;
+    uint64_t key;                           // 0 = empty
+    float value;                            // Raw network value [-1, 1]
+    int count;                              // Stored policy entries
+    uint16_t index[CNN_CACHE_MAX_MOVES];    // Policy indices of the legal moves
+    float prob[CNN_CACHE_MAX_MOVES];
+} CNNCacheEntry;
+
+typedef struct {
+    CNNCacheEntry *entries;
+    size_t size;                // Power of two
+    size_t mask;
+} CNNCache;
+
+/**
+ * Create a cache with `size` entries (rounded down to a power of two).
+ * @return NULL on allocation failure
+ */
+CNNCache* cnn_cache_create(size_t size);
+
+void cnn_cache_free(CNNCache *cache);
+
+/** Drop all entries (e.g. after the weights change). Not thread-safe. */
+void cnn_cache_clear(CNNCache *cache);
+
+/**
+ * Cache key: the network input is the state plus two history states.
+ * @param hist1 Previous state (NULL if none)
+ * @param hist2 State before hist1 (NULL if none)
+ */
+uint64_t cnn_cache_key(const GameState *state, const GameState *hist1, const GameState *hist2);
+
+/**
+ * Look a position up (any thread).
+ * On a hit, out->policy holds the stored legal-move probabilities and
+ * zero elsewhere.
+ * @return 1 on hit, 0 on miss
+ */
+int cnn_cache_probe(CNNCache *cache, uint64_t key, CNNOutput *out);
+
+/**
+ * Store a result (any thread; skipped if another writer holds the slot).
+ * @param state Position that was evaluated (for its legal moves)
+ * @return 1 if a different live position was evicted, else 0
+ */
+int cnn_cache_store(CNNCache *cache, uint64_t key, const GameState *state, const CNNOutput *out);
+
+#endif // CNN_CACHE_H
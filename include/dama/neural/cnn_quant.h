@@ -0,0 +1,65 @@
+/**
+ * cnn_quant.h - Int8 Quantized Inference
+ *
+ * Post-training quantization of a folded network: weights to int8 with one
+ * scale per output channel, activations to 0..127 with one scale per tensor,
+ * taken from a calibration set. Attach the result to CNNWeights.quant to run
+ * every inference forward (search, inference server, self-play) in int8.
+ */
+
+#ifndef CNN_QUANT_H
+#define CNN_QUANT_H
+
+#include "dama/neural/cnn_types.h"
+#include "dama/training/dataset.h"
+#include <stddef.h>
+
+#define CNN_QUANT_MAGIC     "DAMQ"
+#define CNN_QUANT_VERSION   1
+
+// =============================================================================
+// CALIBRATION
+// =============================================================================
+
+/**
+ * Quantize w (fp32, BN folded) into q. Each activation scale clips at the
+ * CNN_QUANT_CALIB_PERCENTILE of the values seen over the samples' fp32
+ * forward passes.
+ * @return ERR_OK, ERR_INVALID_ARG (no samples) or ERR_MEMORY
+ */
+int cnn_quant_calibrate(const CNNWeights *w, const TrainingSample *samples, int count,
+                        CNNQuantWeights *q);
+
+/** Free the buffers of q (the struct itself is the caller's). */
+void cnn_quant_free(CNNQuantWeights *q);
+
+/** Bytes of model data held by q (weights, scales and biases). */
+size_t cnn_quant_bytes(const CNNQuantWeights *q);
+
+// =============================================================================
+// PERSISTENCE
+// =============================================================================
+
+/**
+ * File: magic CNN_QUANT_MAGIC, uint32 version, then the fields of
+ * CNNQuantWeights in declaration order.
+ * @return ERR_OK or ERR_FILE_OPEN
+ */
+int cnn_quant_save(const CNNQuantWeights *q, const char *path);
+
+/** @return ERR_OK, ERR_FILE_OPEN, ERR_FILE_FORMAT, ERR_VERSION or ERR_MEMORY */
+int cnn_quant_load(CNNQuantWeights *q, const char *path);
+
+// =============================================================================
+// INFERENCE
+// =============================================================================
+
+/**
+ * Int8 forward pass; same contract as cnn_forward_legal (legal == NULL:
+ * full policy, count 0: value only).
+ */
+void cnn_quant_forward(const CNNQuantWeights *q, const GameState *state,
+                       const GameState *hist1, const GameState *hist2,
+                       const CNNPolicySubset *legal, CNNOutput *out);
+
+#endif // CNN_QUANT_H
@@ -9,6 +9,7 @@
 #define CNN_TYPES_H
 
 #include "dama/engine/game.h"
+#include <stddef.h>
 
 // =============================================================================
 // ARCHITECTURE CONSTANTS (derived from params.h)
@@ -23,6 +24,15 @@
 #define CNN_FLATTEN_SIZE    (CNN_BOARD_SIZE * CNN_BOARD_SIZE * CNN_CONV4_CHANNELS)  // 4096
 #define CNN_FC_INPUT_SIZE   (CNN_FLATTEN_SIZE + 1)  // 4097
 
+// Set input bits: at most 12 + 12 pieces per timestep
+#define CNN_MAX_ACTIVE_INPUTS  (CNN_HISTORY_T * 24)
+
+// Model file (cnn_io.c): header + tensor table + aligned payloads
+#define CNN_MODEL_MAGIC         "DAMW"
+#define CNN_MODEL_VERSION       2
+#define CNN_MODEL_FORM_VERSION  1   // Bump when cnn_fold_batch_norm's output changes
+#define CNN_MODEL_ALIGN         64  // Payload alignment (SIMD loads, page sharing)
+
 // Batch Normalization constants
 #define CNN_BN_EPSILON     1e-5f   // Numerical stability
 #define CNN_BN_MOMENTUM    0.1f    // Running stats update rate
@@ -43,6 +53,56 @@ typedef struct {
     int K;      // Kernel size (3)
 } ConvShape;
 
+/**
+ * Input planes as the list of set bits (they are binary): channel * 64 + square.
+ */
+typedef struct {
+    uint16_t index[CNN_MAX_ACTIVE_INPUTS];
+    int count;
+} CNNSparseInput;
+
+/**
+ * Input planes as bitboards, canonical (flipped for Black) like the other
+ * encodings: [timestep][my pawns, my ladies, opp pawns, opp ladies].
+ * The transfer format for accelerator backends (48 bytes vs 3 KB of floats).
+ */
+typedef struct {
+    uint64_t planes[CNN_HISTORY_T][CNN_PIECE_CHANNELS];
+} CNNPackedInput;
+
+/**
+ * Policy rows to evaluate: the distinct indices of a position's legal moves.
+ * count 0 skips the policy head (value only).
+ */
+typedef struct {
+    int16_t index[MAX_MOVES];
+    int count;
+} CNNPolicySubset;
+
+/**
+ * Convolution algorithm for the inference backbone.
+ */
+typedef enum {
+    CNN_CONV_IM2COL,        // im2col + sgemm per position
+    CNN_CONV_WINOGRAD       // Winograd F(2x2,3x3), whole batch per GEMM
+} CNNConvAlgo;
+
+/**
+ * Weight precision of the FC heads (policy_w, value_w1) at inference.
+ */
+typedef enum {
+    CNN_HEAD_FP32,          // Master weights, BLAS sgemv/sgemm
+    CNN_HEAD_FP16           // Half copies, widened to fp32 in the kernels
+} CNNHeadPrecision;
+
+/**
+ * How cnn_train_step runs a batch.
+ */
+typedef enum {
+    CNN_TRAIN_PER_SAMPLE,   // Data parallel, one forward/backward per sample; per-sample BN stats
+    CNN_TRAIN_BATCHED       // Whole batch per layer (batched im2col, large GEMMs); batch BN stats
+} CNNTrainAlgo;
+
 // Default shapes for this architecture
 #define CONV1_SHAPE ((ConvShape){8, 8, CNN_INPUT_CHANNELS, 64, 3})
 #define CONV2_SHAPE ((ConvShape){8, 8, 64, 64, 3})
@@ -73,6 +133,31 @@ typedef struct {
 // STRUCTURES
 // =============================================================================
 
+/**
+ * Int8 inference form of a network (cnn_quant.h): symmetric per-output-
+ * channel weight scales, one calibrated scale per activation tensor
+ * (post-ReLU, quantized to 0..127). Conv1 stays fp32 on the sparse input.
+ * Self-contained: a loaded model needs no CNNWeights data.
+ */
+typedef struct {
+    float *conv1_w;             // [CNN_INPUT_CHANNELS][3*3][64] sparse patches (fp32)
+    float *conv1_b;             // [64]
+    int8_t *conv_w[3];          // Conv2-4: [64][64*9], KERNEL_IDX order
+    float conv_scale[3][64];    // Per output channel
+    float conv_b[3][64];
+    float conv_in_scale[3];     // Input activation of conv2-4
+    
+    int8_t *policy_w;           // [512][4096]
+    float policy_scale[CNN_POLICY_SIZE];
+    float policy_b[CNN_POLICY_SIZE];        // + player column (input is always 1.0)
+    int8_t *value_w1;           // [256][4096]
+    float value_scale[CNN_VALUE_HIDDEN];
+    float value_b1[CNN_VALUE_HIDDEN];       // + player column
+    float value_w2[CNN_VALUE_HIDDEN];
+    float value_b2;
+    float fc_in_scale;          // Flattened conv4 features
+} CNNQuantWeights;
+
 /**
  * CNN Weights structure containing all learnable parameters.
  */
@@ -107,6 +192,23 @@ typedef struct {
     float *bn3_mean, *bn3_var;    // [64]
     float *bn4_mean, *bn4_var;    // [64]
     
+    // === Inference Form ===
+    // Conv weights with the BN (running stats) folded in, rebuilt by
+    // cnn_fold_batch_norm: conv + bias + ReLU == conv + BN + ReLU
+    float *fused_conv1_w, *fused_conv1_b;
+    float *fused_conv2_w, *fused_conv2_b;
+    float *fused_conv3_w, *fused_conv3_b;
+    float *fused_conv4_w, *fused_conv4_b;
+    // Same filters, Winograd-transformed (CNN_CONV_WINOGRAD, conv2-4)
+    float *wino_conv2_u;    // [16][64][64]
+    float *wino_conv3_u;    // [16][64][64]
+    float *wino_conv4_u;    // [16][64][64]
+    // Conv1 for sparse input: one 64-wide patch per (channel, kernel tap)
+    float *sparse_conv1_w;  // [CNN_INPUT_CHANNELS][3*3][64]
+    // FC head weights in half precision (CNN_HEAD_FP16), same layout
+    uint16_t *policy_w_h;   // [512][4097]
+    uint16_t *value_w1_h;   // [256][4097]
+    
     // === Policy Head ===
     float *policy_w;    // [256][4097]
     float *policy_b;    // [256]
@@ -117,6 +219,20 @@ typedef struct {
     float *value_w2;    // [1][64]
     float *value_b2;    // [1]
     
+    // Int8 form used by every inference forward when set (not owned,
+    // NULL = fp32). Training ignores it: re-calibrate after updates
+    const CNNQuantWeights *quant;
+    
+    // Accelerator backend every batched inference forward runs on when set
+    // (cnn_backend.h), with its device copy of the inference form
+    const struct CNNBackend *backend;
+    void *backend_model;
+    
+    // Model file the tensors above may point into (cnn_load_weights,
+    // MAP_PRIVATE: edits stay private), NULL when everything is heap
+    void *mapping;
+    size_t mapping_bytes;
+    
     // === Gradients (d_ prefix) ===
     float *d_conv1_w, *d_conv1_b;
     float *d_conv2_w, *d_conv2_b;
@@ -153,6 +269,24 @@ typedef struct {
     float value;                     // Position value [-1, 1]
 } CNNOutput;
 
+/**
+ * Inference buffers for up to max_batch positions (cnn_workspace_create).
+ * One per thread or evaluator, reused by every forward pass: no allocation
+ * per inference, every buffer 64-byte aligned. Not shareable across threads.
+ */
+typedef struct {
+    int max_batch;
+    CNNSparseInput *inputs;     // [max_batch]
+    float *features;            // [max_batch][64*64]
+    float *scratch;             // [max_batch][64*64]
+    float *fc;                  // [max_batch][4097] flattened features + player
+    float *policy;              // [max_batch][512] logits
+    float *value_h;             // [max_batch][256]
+    float *col;                 // im2col [64*9][64], one position at a time
+    float *wino_v, *wino_m;     // WINOGRAD_WORKSPACE_FLOATS(64, max_batch) each
+    void *block;                // Single allocation behind all of the above
+} CNNWorkspace;
+
 // =============================================================================
 // HELPER FUNCTIONS
 // =============================================================================
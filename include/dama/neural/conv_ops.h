@@ -44,6 +44,18 @@ void conv2d_forward(
     int H, int W, int Ci, int Co, int K
 );
 
+/**
+ * conv2d_forward followed by ReLU, applied in the bias pass.
+ * With BN-folded weights (cnn_fold_batch_norm) this is a whole inference layer.
+ */
+void conv2d_forward_relu(
+    const float *input,
+    const float *kernel,
+    const float *bias,
+    float *output,
+    int H, int W, int Ci, int Co, int K
+);
+
 /**
  * Backward pass of 2D convolution.
  * Computes gradients for input, kernel weights, and bias.
@@ -83,6 +95,30 @@ void conv2d_forward_s(
     ConvShape shape
 );
 
+/**
+ * Fused conv + bias + ReLU using ConvShape.
+ */
+void conv2d_forward_relu_s(
+    const float *input,
+    const float *kernel,
+    const float *bias,
+    float *output,
+    ConvShape shape
+);
+
+/**
+ * conv2d_forward_relu_s with a caller-owned im2col buffer
+ * col [C_in*K*K][H*W] instead of the thread-local one.
+ */
+void conv2d_forward_relu_col(
+    const float *input,
+    const float *kernel,
+    const float *bias,
+    float *output,
+    ConvShape shape,
+    float *col
+);
+
 /**
  * Backward pass using ConvShape.
  */
@@ -96,6 +132,111 @@ void conv2d_backward_s(
     ConvShape shape
 );
 
+// =============================================================================
+// BATCHED CONVOLUTION (CHANNEL-MAJOR, TRAINING)
+// =============================================================================
+// Activations as [C][batch][H*W]: each channel of the whole batch is one
+// contiguous row, so batch BatchNorm runs on it as C x (1 x batch*H*W).
+
+#define CONV_BATCH_CHUNK    32      // Positions per im2col + sgemm
+/** col buffer floats for the batched convolutions of shape s */
+#define CONV_BATCH_COL_FLOATS(s) ((size_t)(s).C_in * (s).K * (s).K * CONV_BATCH_CHUNK * (s).H * (s).W)
+
+/**
+ * output = conv(input) + bias for the whole batch: one sgemm per
+ * CONV_BATCH_CHUNK positions (N = chunk * H*W columns).
+ */
+void conv2d_forward_batch(const float *input, const float *kernel, const float *bias,
+                          float *output, ConvShape shape, int batch, float *col);
+
+/**
+ * Accumulates d_kernel and d_bias over the batch; d_input (overwritten)
+ * may be NULL for the first layer.
+ */
+void conv2d_backward_batch(const float *input, const float *kernel, const float *d_output,
+                           float *d_input, float *d_kernel, float *d_bias,
+                           ConvShape shape, int batch, float *col);
+
+// =============================================================================
+// SPARSE INPUT (binary planes, 8x8)
+// =============================================================================
+
+/**
+ * Kernels [Co][Ci][3][3] -> patches [Ci][3*3][Co] (one Co-vector per tap).
+ */
+void conv3x3_sparse_kernel(const float *kernel, float *patches, int Ci, int Co);
+
+/**
+ * Same-padded 3x3 conv + bias + ReLU of a binary 8x8 input given as its
+ * set bits: ~9 patch adds per piece instead of a dense GEMM.
+ * Matches conv2d_forward_relu_s on the dense planes (Co <= 64).
+ *
+ * @param patches  From conv3x3_sparse_kernel
+ * @param in       Set bits (channel * 64 + square)
+ * @param output   Output tensor [Co][8][8]
+ */
+void conv3x3_sparse_relu(
+    const float *patches,
+    const float *bias,
+    const CNNSparseInput *in,
+    float *output,
+    int Co
+);
+
+// =============================================================================
+// WINOGRAD F(2x2, 3x3) - 8x8 BOARD (conv_winograd.c)
+// =============================================================================
+
+// Transformed filter points per (Co, Ci) pair: a 4x4 tile
+#define WINOGRAD_POINTS 16
+
+// Floats in each of the V/M buffers of conv3x3_winograd_relu_ws
+// (C = max(C_in, C_out); 16 output tiles per 8x8 position)
+#define WINOGRAD_WORKSPACE_FLOATS(C, batch) ((size_t)WINOGRAD_POINTS * (C) * (batch) * 16)
+
+/**
+ * Filter transform U = G g G^T.
+ * @param kernel  Kernels [Co][Ci][3][3]
+ * @param U       Output [WINOGRAD_POINTS][Co][Ci]
+ */
+void conv3x3_winograd_kernel(const float *kernel, float *U, int Ci, int Co);
+
+/**
+ * Same-padded 3x3 conv + bias + ReLU on `batch` 8x8 inputs, with filters
+ * already transformed by conv3x3_winograd_kernel. Matches conv2d_forward_relu_s.
+ *
+ * @param input   Inputs [batch][Ci][8][8]
+ * @param U       Transformed kernels [WINOGRAD_POINTS][Co][Ci]
+ * @param bias    Bias per output channel [Co]
+ * @param output  Outputs [batch][Co][8][8]
+ */
+void conv3x3_winograd_relu(
+    const float *input,
+    const float *U,
+    const float *bias,
+    float *output,
+    ConvShape shape,
+    int batch
+);
+
+/**
+ * conv3x3_winograd_relu with caller-owned buffers V and M, each
+ * WINOGRAD_WORKSPACE_FLOATS(max(C_in, C_out), batch) floats.
+ */
+void conv3x3_winograd_relu_ws(
+    const float *input,
+    const float *U,
+    const float *bias,
+    float *output,
+    ConvShape shape,
+    int batch,
+    float *V,
+    float *M
+);
+
+/** Free the thread-local Winograd workspace (also done by conv_ops_cleanup). */
+void conv_winograd_cleanup(void);
+
 // =============================================================================
 // TENSOR OPERATIONS
 // =============================================================================
@@ -115,6 +256,13 @@ void tensor_relu(float *data, int size);
  */
 void tensor_relu_backward(const float *pre_activation, float *d_output, int size);
 
+/**
+ * OpenMP threads for a kernel over `batch` positions under the intra-op
+ * policy (cnn_set_intra_op_threads): 1 below CNN_INTRA_OP_MIN_BATCH or
+ * inside another parallel region.
+ */
+int conv_threads(int batch);
+
 /**
  * Cleanup thread-local convolution buffers.
  * Call from each thread that used convolution operations.
@@ -24,8 +24,19 @@ Node* mcts_create_root(GameState state, Arena *arena, MCTSConfig config);
  */
 Node* mcts_create_root_with_history(GameState state, Arena *arena, MCTSConfig config, Node *history_parent);
 
+/**
+ * Allocates the positions before a root (history[0] the last one) as a
+ * parent chain for mcts_create_root_with_history.
+ * @param head Output: node of history[0] (NULL when plies is 0)
+ * @return 0 on success, -1 if the arena is full
+ */
+int mcts_history_chain(const GameState *history, int plies, Arena *arena, Node **head);
+
 /**
  * Executes the MCTS search algorithm.
+ * With config.deterministic and a node budget the result depends only on
+ * the position, the config and config.seed: the time limit is ignored and
+ * num_threads only changes the speed (see mcts_step_lockstep).
  */
 Move mcts_search(Node *root, Arena *arena, double time_limit_seconds, MCTSConfig config,
                  MCTSStats *stats, TranspositionTable *tt, Node **out_new_root);
@@ -35,6 +46,45 @@ Move mcts_search(Node *root, Arena *arena, double time_limit_seconds, MCTSConfig
  */
 void mcts_get_policy(Node *root, float *policy, float temperature, const GameState *state);
 
+// =============================================================================
+// TREE REUSE
+// =============================================================================
+
+/**
+ * Keep the search tree across moves without letting the arena grow.
+ *
+ * Finds `state` at most two plies below `root` (our move, then the
+ * opponent's reply) and copies that subtree, plus two history states,
+ * into `spare`. The arenas are then swapped: `arena` holds only the
+ * compacted tree and `spare` is empty again. The TT (optional) is reset
+ * and refilled with the copied nodes.
+ *
+ * @return The new root (inside `arena`), or NULL if `state` was not found
+ *         or the copy failed, in which case the caller starts a fresh tree
+ */
+Node* mcts_advance_root(Node *root, const GameState *state, Arena *arena, Arena *spare,
+                        TranspositionTable *tt);
+
+// =============================================================================
+// BOUNDED MEMORY
+// =============================================================================
+
+/**
+ * Cut the tree back when it holds more than `limit` nodes.
+ *
+ * Parents with the fewest visits lose their children until about `target`
+ * nodes remain; they stay as leaves with their statistics and regrow on
+ * demand. Root children are always kept. Freed nodes and child arrays go
+ * to the arena free lists, the TT (optional) is rebuilt from the survivors.
+ * mcts_search calls this by itself when MCTSConfig.max_tree_nodes is set.
+ * Not safe while a search is running on the tree.
+ *
+ * @param out_freed Optional: nodes released
+ * @return Nodes left in the tree, or -1 on failure (tree unchanged)
+ */
+long mcts_prune_tree(Node *root, Arena *arena, TranspositionTable *tt, long limit, long target,
+                     long *out_freed);
+
 // =============================================================================
 // UTILITY FUNCTIONS
 // =============================================================================
@@ -0,0 +1,118 @@
+/**
+ * mcts_async.h - Background Search and Pondering
+ *
+ * Contains: MCTSAsyncSearch (mcts_search on its own thread, with stop,
+ * poll and a live view of the best line), mcts_get_pv, and pondering:
+ * thinking on the opponent's time below the reply the tree expects, then
+ * handing the tree over through mcts_advance_root once the reply is known.
+ *
+ * Typical timed game with tree reuse:
+ *
+ *   Node *played = NULL;
+ *   Move m = mcts_search(root, arena, t, cfg, stats, tt, &played);
+ *   mcts_ponder_start(&ponder, played, arena, cfg, tt);
+ *   ... opponent moves to `state` ...
+ *   root = mcts_ponder_finish(&ponder, root, &state, arena, spare, tt, &hit);
+ */
+
+#ifndef MCTS_ASYNC_H
+#define MCTS_ASYNC_H
+
+#include "dama/search/mcts.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// =============================================================================
+// ASYNC SEARCH
+// =============================================================================
+
+typedef struct {
+    pthread_t thread;
+    atomic_int stop;            // Set by mcts_async_stop, polled by the search
+    atomic_int done;            // The search returned: best and new_root are valid
+    int active;                 // Started and not yet joined
+
+    // Search arguments (owned by the caller, untouched until joined)
+    Node *root;
+    Arena *arena;
+    TranspositionTable *tt;
+    MCTSStats *stats;
+    MCTSConfig config;
+    double time_limit;
+
+    // Result
+    Move best;
+    Node *new_root;
+} MCTSAsyncSearch;
+
+/**
+ * Run mcts_search(root, ...) on a new thread. The limits are those of
+ * mcts_search; with neither time_limit_seconds nor config.max_nodes the
+ * search runs until mcts_async_stop. The tree, arena and TT belong to the
+ * search until mcts_async_wait.
+ * @return 0 on success, -1 if the thread could not be started
+ */
+int mcts_async_start(MCTSAsyncSearch *s, Node *root, Arena *arena, double time_limit_seconds,
+                     MCTSConfig config, MCTSStats *stats, TranspositionTable *tt);
+
+/** @return 1 once the search has returned (mcts_async_wait will not block) */
+int mcts_async_poll(const MCTSAsyncSearch *s);
+
+/** Ask the search to return (any thread, does not block). */
+void mcts_async_stop(MCTSAsyncSearch *s);
+
+/**
+ * Join the search (stopping it first is up to the caller).
+ * @param out_new_root Optional: as in mcts_search
+ * @return The move mcts_search returned (empty if none was started)
+ */
+Move mcts_async_wait(MCTSAsyncSearch *s, Node **out_new_root);
+
+/**
+ * Current best line of a running search (see mcts_get_pv). Under bounded
+ * memory (config.max_tree_nodes) only the root move is reported: deeper
+ * nodes may be pruned while this reads them.
+ * @return Moves written to pv
+ */
+int mcts_async_peek(const MCTSAsyncSearch *s, Move *pv, int max_len, double *value);
+
+// =============================================================================
+// PRINCIPAL VARIATION
+// =============================================================================
+
+/**
+ * Follow the most visited child from root, up to max_len moves. Safe on a
+ * tree that is being searched (not one being pruned).
+ * @param value Optional: score of the first move in [0, 1] for the side to
+ *              move at root (0.5 if the root has no visited child)
+ * @return Moves written to pv
+ */
+int mcts_get_pv(const Node *root, Move *pv, int max_len, double *value);
+
+// =============================================================================
+// PONDERING
+// =============================================================================
+
+/**
+ * Think on the opponent's time. `played` is our move's node (out_new_root
+ * of the search that chose it); the search runs below its most visited
+ * reply, or below `played` itself if it has none, until stopped. Visits
+ * also flow into the ancestors, which the handover discards. Pondering
+ * counts nothing into MCTSStats.
+ * @return The pondered node, or NULL if there is nothing to ponder (terminal
+ *         position, thread not started)
+ */
+Node* mcts_ponder_start(MCTSAsyncSearch *s, Node *played, Arena *arena, MCTSConfig config,
+                        TranspositionTable *tt);
+
+/**
+ * Stop pondering and hand the tree over: mcts_advance_root(root, state,
+ * ...), which keeps the pondered subtree on a hit and the searched sibling
+ * otherwise. Without an active ponder this is just mcts_advance_root.
+ * @param out_hit Optional: 1 if state is the position that was pondered
+ * @return The new root, or NULL (start a fresh tree, as with mcts_advance_root)
+ */
+Node* mcts_ponder_finish(MCTSAsyncSearch *s, Node *root, const GameState *state, Arena *arena,
+                         Arena *spare, TranspositionTable *tt, int *out_hit);
+
+#endif // MCTS_ASYNC_H
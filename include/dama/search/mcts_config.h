@@ -9,6 +9,7 @@
 #define MCTS_CONFIG_H
 
 #include "dama/common/params.h"
+#include "dama/search/mcts_profile.h"
 #include <string.h>
 
 // =============================================================================
@@ -37,6 +38,7 @@ typedef struct MCTSConfig {
     // Fast rollout: early termination on material advantage, shorter depth
     int use_fast_rollout;
     int fast_rollout_depth;  // Max depth when fast rollout enabled (default: 50)
+    int rollouts_per_leaf;   // Playouts averaged per leaf, up to ROLLOUT_BATCH_MAX (<= 1 = one)
 
     struct {
         double w_capture;
@@ -55,6 +57,17 @@ typedef struct MCTSConfig {
     void *cnn_weights;
     int max_nodes;
     int num_threads;
+    int root_parallel;      // num_threads > 1: that many independent trees merged at the root (no shared locks)
+    int leaf_batch;         // Sequential CNN search: leaves per cnn_forward_batch (<= 1 = off)
+    void *inference_server; // Optional InferenceServer* shared across games (sequential CNN search)
+    void *cnn_cache;        // Optional CNNCache* consulted before every CNN evaluation
+    int max_tree_nodes;     // Bounded memory: prune past this many nodes (0 = grow until the arena is full)
+    void *stop_flag;        // Optional atomic_int*: the search returns once it is nonzero
+    double soft_time;       // Managed time: target seconds, the time limit is the hard cap (0 = off, see mcts_time.h)
+    const void *tablebase;  // Optional Tablebase*: known endgames are solved at creation and end rollouts
+    void *search_cache;     // Optional SearchCache*: fresh roots start from cached results, searches are stored
+    int deterministic;      // Reproducible node search: seeded rollouts, lock-step rounds, no clock (needs max_nodes)
+    unsigned seed;          // Deterministic search: rollout stream seed (same seed, same tree)
 } MCTSConfig;
 
 // =============================================================================
@@ -64,9 +77,10 @@ typedef struct MCTSConfig {
 typedef struct {
     int total_moves;
     long total_iterations;
-    long total_nodes;
+    long total_nodes;           // Nodes created by the searches (TT hits excluded)
     long current_move_iterations;
-    long total_depth;
+    long total_depth;           // Sum of max_depth over the searches
+    int max_depth;              // Deepest node reached by the last search (plies below root)
     double total_time;
     size_t total_memory;
     // Debug stats for tree analysis
@@ -74,15 +88,40 @@ typedef struct {
     long total_policy_cached;   // How many times CNN policy was computed
     
     // Tree statistics (for branching factor and depth analysis)
-    long total_children_expanded;  // Sum of children across all expanded nodes
-    long nodes_with_children;      // Count of nodes that have children
+    long total_children_expanded;  // Children added by the searches
+    long nodes_with_children;      // Leaves that got their first children
     
     // TT statistics
     long tt_hits;                  // TT cache hits (avoided re-expansion)
     long tt_misses;                // TT cache misses
     
+    // NN eval cache statistics
+    long nn_cache_hits;            // Leaves answered without a forward pass
+    long nn_cache_misses;
+    long nn_cache_evictions;       // Stores that replaced another position
+    
+    // Persistent search cache statistics (fresh roots only)
+    long search_cache_hits;        // Roots seeded from a cached search
+    long search_cache_misses;
+    
+    // Parallel contention (lock-free tree)
+    long expand_collisions;        // Expansion claims lost to another thread: the leaf is backed up instead
+    
+    // Bounded-memory statistics
+    long tree_prunes;              // Times the tree was cut back to its budget
+    long nodes_recycled;           // Nodes returned to the arena free lists
+    
     // Hardware telemetry
     size_t peak_memory_bytes;      // Peak RSS during search
+    
+    // Allocator telemetry (the search threads' ArenaCounters)
+    long arena_allocs;             // Arena allocations
+    size_t arena_bytes;            // Bytes they asked for (aligned; chunk tails excluded)
+    long arena_refills;            // Chunks reserved from the shared offset
+    size_t arena_high_water;       // Peak bytes in use of the searched arena(s), see Arena.high_water
+    
+    // Phase timing (zero unless built with make PROFILE=1)
+    MCTSProfile profile;
 } MCTSStats;
 
 // =============================================================================
@@ -128,6 +167,7 @@ static inline MCTSConfig mcts_get_preset(MCTSPreset preset) {
     cfg.use_lookahead = 0;
     cfg.use_tree_reuse = 0;
     cfg.num_threads = NUM_MCTS_THREADS;
+    cfg.leaf_batch = MCTS_LEAF_BATCH;
 
     switch (preset) {
         case MCTS_PRESET_PURE_VANILLA:
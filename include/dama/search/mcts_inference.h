@@ -0,0 +1,88 @@
+/**
+ * mcts_inference.h - Batched CNN Evaluation over the Inference Ring
+ *
+ * Contains: inference_process_batch (one evaluator step), InferenceServer
+ * (evaluator threads used by mcts_search workers, or shared by many
+ * concurrent searches, e.g. the games of a parallel selfplay run).
+ */
+
+#ifndef MCTS_INFERENCE_H
+#define MCTS_INFERENCE_H
+
+#include "dama/search/mcts_worker.h"
+#include "dama/neural/cnn.h"
+
+// =============================================================================
+// EVALUATOR STEP
+// =============================================================================
+
+/**
+ * Drain the ring into one batch and evaluate it (safe from several evaluators).
+ *
+ * Dispatches when 'target' requests are gathered, or gather_us after the
+ * first one. Policy and value (scaled to [0, 1]) are written to each
+ * request before it is marked ready.
+ *
+ * @param ws  The evaluator's workspace (NULL: the thread's default one)
+ * @return Number of requests evaluated (0 if the ring stayed empty)
+ */
+int inference_process_batch(InferenceQueue *queue, const CNNWeights *weights, CNNWorkspace *ws,
+                            int target, long gather_us);
+
+// =============================================================================
+// SHARED INFERENCE SERVER
+// =============================================================================
+
+/**
+ * Evaluator thread pool fed by one inference ring.
+ *
+ * mcts_search starts a private one for its worker threads. Set
+ * MCTSConfig.inference_server to share one across searches instead
+ * (e.g. the games of a parallel selfplay run), so N games fill one batch.
+ * With several evaluators, one batch runs while the next is gathered.
+ */
+struct InferenceServer {
+    InferenceQueue queue;
+    const CNNWeights *weights;
+    pthread_t threads[INFERENCE_MAX_EVALUATORS];
+    int num_evaluators;
+    int batch_target;           // Dispatch size per evaluator
+    long gather_us;             // Max wait after the first request of a batch
+    _Atomic long total_batches;
+    _Atomic long total_requests;
+    MCTSProfile profile[INFERENCE_MAX_EVALUATORS]; // One per evaluator (make PROFILE=1)
+    _Atomic int profile_slots;
+};
+
+/**
+ * Start the evaluator threads.
+ * @param max_in_flight Requests that can be pending at once (clients * leaves each)
+ * @param gather_us Batch gather window (INFERENCE_GATHER_US, INFERENCE_SERVER_GATHER_US)
+ * @param evaluators Evaluator threads (clamped to 1..INFERENCE_MAX_EVALUATORS)
+ * @return ERR_OK, ERR_NULL_PTR or ERR_MEMORY (thread creation failed)
+ */
+int inference_server_start(InferenceServer *server, const CNNWeights *weights,
+                           int max_in_flight, long gather_us, int evaluators);
+
+/** Stop and join the evaluator. No search may still be using it. */
+void inference_server_stop(InferenceServer *server);
+
+/** Add the evaluators' inference time and batch sizes to *out (after stop). */
+void inference_server_merge_profile(const InferenceServer *server, MCTSProfile *out);
+
+/**
+ * Enqueue a request (blocks only while the ring is full).
+ * Submit a whole round of leaves first, then wait on each of them.
+ * @return 1 on success, 0 if the server is shutting down
+ */
+int inference_server_submit(InferenceServer *server, InferenceRequest *req);
+
+/**
+ * Block until a submitted request is evaluated.
+ * @return 1 when ready, 0 if the server shut down first
+ */
+static inline int inference_server_wait(InferenceServer *server, InferenceRequest *req) {
+    return inference_request_wait(req, &server->queue);
+}
+
+#endif // MCTS_INFERENCE_H
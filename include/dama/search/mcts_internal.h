@@ -14,6 +14,8 @@
 #include "dama/search/mcts_tree.h"
 #include "dama/engine/movegen.h"
 #include "dama/neural/cnn.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/common/rng.h"
 
 // =============================================================================
 // GAME RESULT HELPERS
@@ -28,10 +30,7 @@
 static inline int mcts_get_game_result(const GameState *state) {
     if (state->moves_without_captures >= MAX_MOVES_WITHOUT_CAPTURES) return 0;
     
-    MoveList ml;
-    movegen_generate(state, &ml);
-    
-    if (ml.count == 0) {
+    if (!movegen_has_any_move(state)) {
         return (state->current_player == WHITE) ? 2 : 1;
     }
     
@@ -46,6 +45,9 @@ static inline int mcts_get_game_result(const GameState *state) {
 void backpropagate(Node *node, double result, int use_solver);
 Node* select_promising_node(Node *root, MCTSConfig config);
 double simulate_rollout(Node *node, MCTSConfig config);
+/** Rollouts of the calling thread draw from rng (NULL: rng_global()). @return The previous one */
+RNG* mcts_rollout_set_rng(RNG *rng);
+int should_exit_early(Node *root, int max_nodes);
 /**
  * Handle a terminal node: compute result and backpropagate.
  * 
@@ -61,10 +63,106 @@ static inline void mcts_handle_terminal(Node *leaf, MCTSConfig config, MCTSStats
     else if (res == 2) result = (leaf->state.current_player == BLACK) ? 1.0 : 0.0;
     else result = config.draw_score;
     
+    PROFILE_BEGIN(t0);
     backpropagate(leaf, result, config.use_solver);
+    PROFILE_END(PROFILE_BACKPROP, t0);
     if (stats) stats->total_iterations++;
 }
 
+// =============================================================================
+// NN EVAL CACHE HELPERS
+// =============================================================================
+
+/** Network input history of a leaf: its parent and grandparent states. */
+static inline void mcts_leaf_history(const Node *leaf, const GameState **h1, const GameState **h2) {
+    *h1 = (leaf->parent) ? &leaf->parent->state : NULL;
+    *h2 = (leaf->parent && leaf->parent->parent) ? &leaf->parent->parent->state : NULL;
+}
+
+/**
+ * Look a leaf up in config.cnn_cache (if any).
+ * @param key Output: cache key, for the store after a miss
+ * @return 1 if 'out' was filled from the cache
+ */
+static inline int mcts_cache_probe(MCTSConfig config, const Node *leaf, uint64_t *key,
+                                   CNNOutput *out, MCTSStats *stats) {
+    if (!config.cnn_cache) return 0;
+    const GameState *h1, *h2;
+    mcts_leaf_history(leaf, &h1, &h2);
+    *key = cnn_cache_key(&leaf->state, h1, h2);
+    int hit = cnn_cache_probe((CNNCache*)config.cnn_cache, *key, out);
+    if (stats) {
+        if (hit) stats->nn_cache_hits++;
+        else stats->nn_cache_misses++;
+    }
+    return hit;
+}
+
+/** Store a freshly computed evaluation (raw network value). */
+static inline void mcts_cache_store(MCTSConfig config, const Node *leaf, uint64_t key,
+                                    const CNNOutput *out, MCTSStats *stats) {
+    if (!config.cnn_cache) return;
+    int evicted = cnn_cache_store((CNNCache*)config.cnn_cache, key, &leaf->state, out);
+    if (stats && evicted) stats->nn_cache_evictions++;
+}
+
+// =============================================================================
+// NODE MAP (tree walks over the TT-shared DAG)
+// =============================================================================
+
+/**
+ * Open-addressing map from Node* to a nonzero tag, sized once for the walk.
+ * TT hits make the tree a DAG: walks that copy or free nodes use it to
+ * visit shared nodes once.
+ */
+typedef struct {
+    const Node **keys;
+    uintptr_t *values;
+    size_t mask;
+} NodeMap;
+
+/** @return 0 on success, -1 if allocation failed */
+static inline int node_map_init(NodeMap *m, size_t expected) {
+    size_t cap = 16;
+    while (cap < expected * 2) cap *= 2;
+    m->keys = calloc(cap, sizeof(Node*));
+    m->values = malloc(cap * sizeof(uintptr_t));
+    m->mask = cap - 1;
+    if (!m->keys || !m->values) {
+        free(m->keys);
+        free(m->values);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void node_map_free(NodeMap *m) {
+    free(m->keys);
+    free(m->values);
+}
+
+static inline size_t node_map_slot(const NodeMap *m, const Node *key) {
+    uint64_t h = (uint64_t)(uintptr_t)key >> 3;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 16) & m->mask;
+}
+
+/** @return The tag stored for 'key', or 0 if absent */
+static inline uintptr_t node_map_get(const NodeMap *m, const Node *key) {
+    for (size_t i = node_map_slot(m, key); m->keys[i]; i = (i + 1) & m->mask) {
+        if (m->keys[i] == key) return m->values[i];
+    }
+    return 0;
+}
+
+/** Insert or overwrite. The caller keeps the load under one half. */
+static inline void node_map_put(NodeMap *m, const Node *key, uintptr_t value) {
+    size_t i = node_map_slot(m, key);
+    while (m->keys[i] && m->keys[i] != key) i = (i + 1) & m->mask;
+    m->keys[i] = key;
+    m->values[i] = value;
+}
+
 // =============================================================================
 // EXPANSION HELPERS
 // =============================================================================
@@ -72,7 +170,8 @@ static inline void mcts_handle_terminal(Node *leaf, MCTSConfig config, MCTSStats
 /**
  * Expand a leaf node with CNN policy priors.
  * 
- * Thread-safe: Uses node mutex for synchronization.
+ * Thread-safe: claims the node via its expand_state. A thread that loses
+ * the claim returns the leaf unchanged and backpropagates there.
  * 
  * @param leaf The leaf node to expand
  * @param arena Memory arena for allocations
@@ -89,17 +188,30 @@ static inline Node* mcts_expand_with_policy(
     float *policy, 
     MCTSStats *stats
 ) {
-    pthread_mutex_lock(&leaf->lock);
+    if (leaf->is_terminal) return leaf;
+    if (!node_try_claim_expansion(leaf)) {
+        if (stats) stats->expand_collisions++;
+        return leaf;
+    }
     
-    if (leaf->num_children == 0 && !leaf->is_terminal) {
+    if (leaf->num_children == 0) {
         MoveList legal_moves;
+        PROFILE_BEGIN(t0);
         movegen_generate(&leaf->state, &legal_moves);
+        PROFILE_END(PROFILE_MOVEGEN, t0);
         
         if (legal_moves.count > 0) {
-            leaf->children = arena_alloc(arena, legal_moves.count * sizeof(Node*));
+            if (!node_alloc_children(leaf, arena, legal_moves.count)) {
+                node_release_expansion(leaf, 0); // Out of memory: stays a leaf
+                return leaf;
+            }
+            leaf->num_legal = legal_moves.count;
             
             float sum = 0.0f;
-            float *filtered_policy = arena_alloc(arena, legal_moves.count * sizeof(float));
+            float filtered_policy[MAX_MOVES];
+            int created = 0, fresh = 0;
+            MoveHeuristic heuristic;
+            move_heuristic_init(&heuristic, &leaf->state, &config);
             
             for (int i = 0; i < legal_moves.count; i++) {
                 int idx = cnn_move_to_index(&legal_moves.moves[i], leaf->state.current_player);
@@ -124,7 +236,10 @@ static inline Node* mcts_expand_with_policy(
                 }
                 
                 if (!child) {
-                    child = create_node(leaf, legal_moves.moves[i], child_state, arena, config);
+                    child = create_node_scored(leaf, move_pack(&legal_moves.moves[i]), child_state, arena, config,
+                                               &heuristic);
+                    if (!child) break; // Out of memory: keep the moves created so far
+                    fresh++;
                     if (tt) {
                         tt_insert(tt, child);
                         if (stats) stats->tt_misses++;
@@ -132,30 +247,34 @@ static inline Node* mcts_expand_with_policy(
                 }
                 
                 child->prior = filtered_policy[i];
-                leaf->children[i] = child;
+                child_stats_attach(leaf, created++, child);
             }
             
-            leaf->untried_moves.count = 0;
+            leaf->num_legal = created;
             atomic_thread_fence(memory_order_release);
-            leaf->num_children = legal_moves.count;
+            leaf->num_children = created;
             
             if (stats) {
                 stats->total_expansions++;
                 stats->total_policy_cached += legal_moves.count;
+                if (created > 0) stats->nodes_with_children++;
+                stats->total_children_expanded += created;
+                stats->total_nodes += fresh;
             }
         } else {
             leaf->is_terminal = 1;
         }
     }
     
-    pthread_mutex_unlock(&leaf->lock);
+    node_release_expansion(leaf, 1);
     return leaf;
 }
 
 /**
  * Expand a leaf node using vanilla rollout (no CNN).
  * 
- * Thread-safe: Uses node mutex for synchronization.
+ * Thread-safe: adds one child under an expansion claim. A thread that
+ * loses the claim gets the leaf back.
  * 
  * @param leaf The leaf node to expand
  * @param arena Memory arena for allocations
@@ -170,19 +289,42 @@ static inline Node* mcts_expand_vanilla(
     MCTSConfig config, 
     MCTSStats *stats
 ) {
-    pthread_mutex_lock(&leaf->lock);
-    Node *next = leaf;
+    if (leaf->is_terminal) return leaf;
+    if (!node_try_claim_expansion(leaf)) {
+        if (stats) stats->expand_collisions++;
+        return leaf;
+    }
     
-    if (!leaf->is_terminal) {
-        next = expand_node(leaf, arena, tt, config, stats);
-        if (stats) {
-            stats->total_expansions++;
-            stats->total_policy_cached++;
-        }
+    Node *next = expand_node(leaf, arena, tt, config, stats);
+    if (stats) {
+        stats->total_expansions++;
+        stats->total_policy_cached++;
     }
     
-    pthread_mutex_unlock(&leaf->lock);
+    node_release_expansion(leaf, node_is_fully_expanded(leaf));
     return next;
 }
 
+/**
+ * Track the deepest node reached this search, in plies below its root.
+ * 
+ * Called with the node an iteration ended on; a policy expansion hangs
+ * its children one ply lower. Kept per thread in the worker's local stats
+ * and merged with max, so the depth never needs a walk of the whole tree.
+ */
+static inline void mcts_note_depth(MCTSStats *stats, const Node *root, const Node *node) {
+    if (!stats) return;
+    int depth = (int)node->depth - (int)root->depth + (node->num_children > 0);
+    if (depth > stats->max_depth) stats->max_depth = depth;
+}
+
+/** Add the calling thread's arena work since `before` (arena_thread_counters). */
+static inline void mcts_note_arena(MCTSStats *stats, const ArenaCounters *before) {
+    if (!stats) return;
+    const ArenaCounters now = arena_thread_counters();
+    stats->arena_allocs += now.allocs - before->allocs;
+    stats->arena_bytes += now.bytes - before->bytes;
+    stats->arena_refills += now.refills - before->refills;
+}
+
 #endif // MCTS_INTERNAL_H
@@ -0,0 +1,79 @@
+/**
+ * mcts_many.h - Search a Batch of Positions
+ *
+ * Scores a set of roots (test suites, sample sets) with one setup: an
+ * OpenMP team searches one position per thread, arenas come from the
+ * search pool, and with a network every search evaluates through one
+ * shared eval cache and one InferenceServer, so the leaves of all the
+ * searches in flight are batched together instead of running
+ * single-position inference.
+ *
+ *   SearchManyConfig many = { .threads = 0, .nodes = 800, .on_result = print_result };
+ *   mcts_search_many(positions, n, &cfg, &many, results, &stats);
+ *
+ * Results are reported in input order: result i goes to on_result as soon
+ * as it and every earlier one are done, while later positions are still
+ * being searched.
+ */
+
+#ifndef MCTS_MANY_H
+#define MCTS_MANY_H
+
+#include "dama/search/mcts_types.h"
+
+typedef struct {
+    GameState state;
+    GameState history[2];       // Positions before state (history[0] the last)
+    int plies;                  // History slots in use (0..2)
+} SearchPosition;
+
+typedef struct {
+    int index;                  // Position in the input
+    Move best;                  // Empty (length 0) if the position has no move
+    float value;                // Root value for the side to move, in [-1, 1]
+    int visits;                 // Root visits (0: not searched)
+    int num_moves;              // Searched root moves, most visited first
+    PackedMove moves[MAX_MOVES];    // movegen_unpack_move(&state, ...) for the full move
+    int move_visits[MAX_MOVES];
+} SearchManyResult;
+
+typedef struct {
+    int threads;                // Searches at once (0: omp_get_max_threads)
+    int nodes;                  // Node budget of each search (> 0)
+    size_t arena_size;          // Arena per search (0: ARENA_SIZE_ANALYSE)
+    void (*on_result)(const SearchManyResult *result, void *user);   // Optional, in input order
+    void *user;
+} SearchManyConfig;
+
+typedef struct {
+    int searched;               // Positions with a move that were searched
+    long nodes;                 // Root visits over all searches
+    double seconds;
+} SearchManyStats;
+
+/**
+ * Search count positions with config (its node and time limits replaced by
+ * many->nodes). Each position is searched by one thread: config->num_threads
+ * and root_parallel are ignored. Without config->cnn_cache a cache is made
+ * for the call; without config->inference_server a server is started when
+ * there is a network and more than one thread. Arenas (and TTs, with
+ * config->use_tt) stay in the threads' search pools for the next call.
+ *
+ * @param results Room for count results (result i for positions[i])
+ * @param stats Optional
+ * @return 0, or -1 on bad arguments
+ */
+int mcts_search_many(const SearchPosition *positions, int count, const MCTSConfig *config,
+                     const SearchManyConfig *many, SearchManyResult *results, SearchManyStats *stats);
+
+/**
+ * Read a position written as the server's position command takes it,
+ * without the keyword: "startpos [moves <m>...]" or
+ * "board <32 squares> <w|b> [moves <m>...]" (see search_server.h).
+ * @param bad_move Set on failure: the illegal move, or NULL if the position
+ *                 itself is malformed
+ * @return 0 on success, -1 on failure
+ */
+int search_position_parse(char **tok, int n, SearchPosition *out, const char **bad_move);
+
+#endif // MCTS_MANY_H
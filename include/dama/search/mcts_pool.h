@@ -0,0 +1,43 @@
+/**
+ * mcts_pool.h - Per-Thread Pool of Search Memory Across Games
+ *
+ * A game needs one or two 512 MB arenas (plus spares for tree reuse) and
+ * possibly a TT. Allocating them per game means faulting in and zeroing
+ * fresh pages for every game; the pool keeps them per thread and only
+ * resets them (O(1) for both arenas and TTs) when the next game starts.
+ * Selfplay, tournaments and CLOP (a tournament per evaluation) draw from it.
+ *
+ * Slots belong to the calling thread and are freed when it exits (or with
+ * search_pool_release), so OpenMP workers keep theirs across parallel
+ * regions.
+ */
+
+#ifndef MCTS_POOL_H
+#define MCTS_POOL_H
+
+#include "dama/search/mcts_types.h"
+
+#define SEARCH_POOL_SLOTS   2       // One per side of a game
+
+typedef struct {
+    Arena arena;
+    Arena spare;                    // Tree reuse compaction target (buffer NULL until wanted)
+    TranspositionTable *tt;         // NULL until wanted
+} SearchSlot;
+
+/**
+ * The calling thread's slot `index`, ready for a new game: the arena (and
+ * the spare, if want_spare) of arena_size bytes empty, the TT (TT_SIZE_DEFAULT,
+ * if want_tt) cleared. Allocated on first use, reused afterwards (arenas are
+ * reallocated when the size or the backing changes). A slot stays valid
+ * until the thread acquires the same index again.
+ * @param backing Arena backing (ARENA_BACKING_* of the call site), NULL: malloc
+ * @return The slot, NULL on allocation failure.
+ */
+SearchSlot* search_pool_acquire(int index, size_t arena_size, const ArenaOptions *backing,
+                                int want_spare, int want_tt);
+
+/** Free the calling thread's slots (they are reallocated on demand). */
+void search_pool_release(void);
+
+#endif // MCTS_POOL_H
@@ -0,0 +1,136 @@
+/**
+ * mcts_profile.h - Hot-Path Phase Timing
+ *
+ * Contains: MCTSProfile (per-phase ticks and calls, batch size histogram,
+ * hardware counters), PROFILE_* macros.
+ *
+ * Compiled in with -DMCTS_PROFILE (make PROFILE=1); otherwise the macros
+ * are empty and MCTSStats.profile stays zero. Each thread records into the
+ * profile its profile_tls points at (the search's stats, a worker's local
+ * stats, an evaluator's slot), merged at the end like the other counters.
+ *
+ * With perf_counters_enable() as well, each phase also adds its cycles,
+ * instructions and misses (two counter reads per phase: a diagnostic
+ * mode, the times it reports include the reads).
+ */
+
+#ifndef MCTS_PROFILE_H
+#define MCTS_PROFILE_H
+
+#include "dama/common/perf_counters.h"
+#include <stdint.h>
+#include <time.h>
+
+#if defined(MCTS_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+// =============================================================================
+// PHASES
+// =============================================================================
+
+typedef enum {
+    PROFILE_SELECT,         // Tree descent
+    PROFILE_EXPAND,         // Child creation (includes its movegen/heuristic)
+    PROFILE_MOVEGEN,        // Move generation in expansion and rollouts
+    PROFILE_HEURISTIC,      // Move scoring in create_node and rollout policy
+    PROFILE_ROLLOUT,        // Playouts (includes their movegen/heuristic)
+    PROFILE_INFERENCE,      // CNN forward passes (search thread or evaluator)
+    PROFILE_QUEUE_WAIT,     // Submit + wait on the inference server
+    PROFILE_BACKPROP,
+    PROFILE_PHASES
+} ProfilePhase;
+
+// Bin k counts batches of [2^k, 2^(k+1)) leaves (MCTS_BATCH_SIZE = 64 -> 7 bins)
+#define PROFILE_BATCH_BINS 8
+
+typedef struct {
+    uint64_t ticks[PROFILE_PHASES];
+    long calls[PROFILE_PHASES];
+    long batches[PROFILE_BATCH_BINS];
+    uint64_t events[PROFILE_PHASES][PERF_EVENTS];   // Hardware counters (perf_counters_on)
+} MCTSProfile;
+
+extern __thread MCTSProfile *profile_tls;
+
+/** Name of a phase, for reports. */
+const char* mcts_profile_phase_name(int phase);
+
+/** Add every counter of src into dst. */
+void mcts_profile_merge(MCTSProfile *dst, const MCTSProfile *src);
+
+/** Nanoseconds per tick (rdtsc is calibrated once against CLOCK_MONOTONIC_RAW). */
+double mcts_profile_ns_per_tick(void);
+
+static inline int mcts_profile_empty(const MCTSProfile *p) {
+    for (int i = 0; i < PROFILE_PHASES; i++) {
+        if (p->calls[i]) return 0;
+    }
+    return 1;
+}
+
+// =============================================================================
+// RECORDING
+// =============================================================================
+
+static inline uint64_t profile_ticks(void) {
+#if defined(MCTS_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc();
+#else
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Start of a phase: clock, and counters when they are on
+typedef struct {
+    uint64_t ticks;
+    PerfReading perf;
+} ProfileMark;
+
+static inline void profile_mark(ProfileMark *m) {
+    if (perf_counters_on && profile_tls) perf_counters_read(&m->perf);
+    m->ticks = profile_ticks();
+}
+
+static inline void profile_add(int phase, const ProfileMark *m) {
+    const uint64_t now = profile_ticks();
+    MCTSProfile *p = profile_tls;
+    if (!p) return;
+    p->ticks[phase] += now - m->ticks;
+    p->calls[phase]++;
+    if (perf_counters_on) {
+        PerfReading end;
+        perf_counters_read(&end);
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (end.count[e] > m->perf.count[e]) p->events[phase][e] += end.count[e] - m->perf.count[e];
+        }
+    }
+}
+
+static inline void profile_batch(int size) {
+    MCTSProfile *p = profile_tls;
+    if (!p || size < 1) return;
+    int bin = 31 - __builtin_clz((unsigned)size);
+    p->batches[bin < PROFILE_BATCH_BINS ? bin : PROFILE_BATCH_BINS - 1]++;
+}
+
+#ifdef MCTS_PROFILE
+    #define PROFILE_BEGIN(t)        ProfileMark t; profile_mark(&t)
+    #define PROFILE_END(phase, t)   profile_add((phase), &(t))
+    #define PROFILE_BATCH(n)        profile_batch(n)
+    #define PROFILE_BIND(p)         (profile_tls = (p))
+#else
+    // Release: No overhead
+    #define PROFILE_BEGIN(t)        ((void)0)
+    #define PROFILE_END(phase, t)   ((void)0)
+    #define PROFILE_BATCH(n)        ((void)0)
+    #define PROFILE_BIND(p)         ((void)0)
+#endif
+
+#endif // MCTS_PROFILE_H
@@ -0,0 +1,37 @@
+/**
+ * mcts_time.h - Time Management for Games on a Clock
+ *
+ * A GameClock holds one side's remaining time (base + increment per move).
+ * game_clock_budget splits it into a soft and a hard limit for the next
+ * search: mcts_search(root, arena, hard, cfg with soft_time = soft, ...)
+ * stops before soft once the best move is settled, at soft when it is
+ * stable, and only goes on to hard while the choice is still moving.
+ */
+
+#ifndef MCTS_TIME_H
+#define MCTS_TIME_H
+
+typedef struct {
+    double remaining;           // Seconds left (negative: flag fell)
+    double increment;           // Added after each move
+    int moves;                  // Moves made on this clock
+} GameClock;
+
+/** Start a clock with base seconds and increment seconds per move. */
+void game_clock_init(GameClock *clock, double base, double increment);
+
+/**
+ * Budget for the next move: the remaining time spread over the moves still
+ * expected, plus most of the increment (soft); at most TIME_HARD_FACTOR
+ * times that, TIME_HARD_SHARE of the clock and never into the safety
+ * margin (hard). soft <= hard.
+ */
+void game_clock_budget(const GameClock *clock, double *soft, double *hard);
+
+/**
+ * Charge a move's thinking time, then add the increment.
+ * @return 0, or -1 if the time ran out during the move
+ */
+int game_clock_spend(GameClock *clock, double seconds);
+
+#endif // MCTS_TIME_H
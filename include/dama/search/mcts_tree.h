@@ -19,25 +19,94 @@
  */
 double calculate_ucb1_score(Node *child, MCTSConfig config);
 
+/**
+ * Index of the child selection descends into, or -1 if none qualifies.
+ * Scores the whole child block at once from its ChildStats (AVX2/NEON
+ * when available); foreign slots are scored from the node itself.
+ */
+int select_child_index(const Node *parent, MCTSConfig config);
+
 /**
  * Select the most promising node for expansion/simulation.
  * Traverses down the tree using UCB1/PUCT until finding an unexpanded node.
+ * Resolves the kernel on every call: loops should use mcts_select_kernel.
  */
 Node* select_promising_node(Node *root, MCTSConfig config);
 
+/** Tree policy compiled for one combination of selection flags. */
+typedef Node* (*SelectKernel)(Node *root, const MCTSConfig *config);
+
+/**
+ * Kernel for a config: a specialized one when the flags match a preset
+ * (Vanilla, UCB1-Tuned, Grandmaster, AlphaZero), the generic one otherwise.
+ * Resolve once per search and call it with the same config.
+ */
+SelectKernel mcts_select_kernel(const MCTSConfig *config);
+
 // =============================================================================
 // EXPANSION
 // =============================================================================
 
+/**
+ * Move heuristic of one position: the side to move's weights resolved
+ * once (advance bonus per row, base rank) and shared by every move scored
+ * there (an expansion's children, a rollout ply's candidates). Square
+ * features are constant masks, so a move costs a few bit tests.
+ */
+typedef struct {
+    double capture, promotion, edge, center, base, lady_activity;
+    double advance[8];          // Pawn landing row -> advance bonus
+    uint64_t base_rows;         // Squares a pawn leaves its base from
+} MoveHeuristic;
+
+#define HEURISTIC_PROMOTION_ROWS    0xFF000000000000FFULL   // Rows 0 and 7
+#define HEURISTIC_EDGE_SQUARES      0x8181818181818181ULL   // Columns 0 and 7
+#define HEURISTIC_CENTER_SQUARES    0x0000003C3C000000ULL   // Rows 3-4, columns 2-5
+
+void move_heuristic_init(MoveHeuristic *h, const GameState *state, const MCTSConfig *config);
+
+/** Heuristic of a move from..to (length captures) in the position of h. */
+static inline double move_heuristic_score(const MoveHeuristic *h, int from, int to, int length, int is_lady) {
+    const uint64_t to_bit = 1ULL << to;
+    double score = 0.0;
+    if (length > 0) score += h->capture * length;
+    if (!is_lady) {
+        if (to_bit & HEURISTIC_PROMOTION_ROWS) score += h->promotion;
+        score += h->advance[to >> 3];
+        if (to_bit & HEURISTIC_EDGE_SQUARES) score += h->edge;
+    }
+    if (to_bit & HEURISTIC_CENTER_SQUARES) score += h->center;
+    if (!is_lady && ((1ULL << from) & h->base_rows)) score -= h->base;
+    if (is_lady) score += h->lady_activity;
+    return score;
+}
+
+static inline double move_heuristic_packed(const MoveHeuristic *h, PackedMove move) {
+    return move_heuristic_score(h, pmove_from(move), pmove_to(move), pmove_length(move), pmove_is_lady(move));
+}
+
 /**
  * Evaluate move heuristic for progressive bias.
  */
 double evaluate_move_heuristic(const GameState *state, const Move *move, MCTSConfig config);
 
+/**
+ * Same heuristic for a packed move.
+ */
+double evaluate_packed_move_heuristic(const GameState *state, PackedMove move, MCTSConfig config);
+
 /**
  * Create a new MCTS node in the arena.
+ * 'move' is the packed move from parent (PM_NONE for roots).
  */
-Node* create_node(Node *parent, Move move, GameState state, Arena *arena, MCTSConfig config);
+Node* create_node(Node *parent, PackedMove move, GameState state, Arena *arena, MCTSConfig config);
+
+/**
+ * Same, scoring the move with the parent's MoveHeuristic (NULL: resolved
+ * here). Expansions that create every child at once share one.
+ */
+Node* create_node_scored(Node *parent, PackedMove move, GameState state, Arena *arena, MCTSConfig config,
+                         const MoveHeuristic *heuristic);
 
 /**
  * Expand a node by adding one child for an untried move.
@@ -45,10 +114,16 @@ Node* create_node(Node *parent, Move move, GameState state, Arena *arena, MCTSCo
 Node *expand_node(Node *node, Arena *arena, TranspositionTable *tt, MCTSConfig config, MCTSStats *stats);
 
 /**
- * Find a child node by move (for tree reuse).
+ * Find a child node by move (for tree reuse). One integer compare per child.
  */
 Node* find_child_by_move(Node *parent, const Move *move);
 
+/**
+ * Refill a node's ChildStats from its children (after priors change or
+ * children are re-parented). Not safe while other threads select there.
+ */
+void child_stats_rebuild(Node *parent);
+
 /**
  * Check if two moves are equal.
  */
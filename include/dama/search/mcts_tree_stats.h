@@ -6,6 +6,7 @@
  * - Tree Depth (max/avg)
  * - TT Hit Rate
  * - Peak Memory (RSS)
+ * - Arena high-water mark and bytes per expanded child
  */
 
 #ifndef MCTS_TREE_STATS_H
@@ -17,6 +18,9 @@
 #ifdef __APPLE__
 #include <mach/mach.h>
 #endif
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 // =============================================================================
 // TREE STATISTICS STRUCT
@@ -28,6 +32,8 @@ typedef struct {
     double avg_depth;
     double tt_hit_rate;         // tt_hits / (tt_hits + tt_misses)
     size_t peak_rss_bytes;      // Peak Resident Set Size
+    size_t arena_high_water;    // Most arena bytes in use at once
+    double bytes_per_child;     // Arena bytes asked for per expanded child
 } TreeStats;
 
 // =============================================================================
@@ -46,6 +52,7 @@ static inline TreeStats compute_tree_stats(const MCTSStats *stats) {
     }
     
     // Depth (we have total_depth and total_expansions)
+    ts.max_depth = stats->max_depth;
     if (stats->total_expansions > 0) {
         ts.avg_depth = (double)stats->total_depth / stats->total_expansions;
     }
@@ -59,6 +66,12 @@ static inline TreeStats compute_tree_stats(const MCTSStats *stats) {
     // Peak RSS
     ts.peak_rss_bytes = stats->peak_memory_bytes;
     
+    // Allocator
+    ts.arena_high_water = stats->arena_high_water;
+    if (stats->total_children_expanded > 0) {
+        ts.bytes_per_child = (double)stats->arena_bytes / stats->total_children_expanded;
+    }
+    
     return ts;
 }
 
@@ -76,6 +89,24 @@ static inline size_t get_peak_rss(void) {
     return 0;
 }
 
+/**
+ * Current resident set size of the process (Linux and macOS, 0 elsewhere).
+ */
+static inline size_t get_current_rss(void) {
+#if defined(__APPLE__)
+    return get_peak_rss();
+#elif defined(__linux__)
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long pages = 0, resident = 0;
+    int ok = fscanf(f, "%lu %lu", &pages, &resident) == 2;
+    fclose(f);
+    return ok ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
 /**
  * Print tree statistics to stdout in a formatted table.
  */
@@ -87,6 +118,8 @@ static inline void print_tree_stats(const TreeStats *ts) {
     printf("║ Average Depth:           %10.2f                 ║\n", ts->avg_depth);
     printf("║ TT Hit Rate:             %10.2f%%                ║\n", ts->tt_hit_rate * 100.0);
     printf("║ Peak Memory (RSS):       %10.2f MB              ║\n", ts->peak_rss_bytes / (1024.0 * 1024.0));
+    printf("║ Arena High Water:        %10.2f MB              ║\n", ts->arena_high_water / (1024.0 * 1024.0));
+    printf("║ Arena Bytes/Child:       %10.1f                 ║\n", ts->bytes_per_child);
     printf("╚══════════════════════════════════════════════════════╝\n");
 }
 
@@ -2,7 +2,7 @@
  * mcts_types.h - MCTS Core Types and Memory Management
  * 
  * Contains:
- * - Arena allocator (Thread-safe bump allocator)
+ * - Arena allocator (Lock-free bump allocator with per-thread chunks)
  * - TranspositionTable
  * - Node struct and SolverStatus
  * 
@@ -19,67 +19,180 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdatomic.h>
-#include <pthread.h>
 
 // =============================================================================
 // ARENA ALLOCATOR
 // =============================================================================
 
+/**
+ * Lock-free bump allocator shared by all search threads.
+ *
+ * Each thread carves small allocations out of its own chunk (thread-local,
+ * see mcts_arena.c) and only touches the shared offset, via CAS, when the
+ * chunk runs dry. `offset` therefore counts bytes handed out to threads,
+ * including the unused tail of their current chunks.
+ *
+ * `generation` is bumped by arena_reset/arena_free (and is unique per
+ * init), which invalidates every thread's cached chunk.
+ *
+ * Blocks given back with arena_release (bounded-memory search, see
+ * mcts_prune_tree) go on exact-size free lists that the slow path serves
+ * before reserving a new chunk. Exact sizes keep the accounting honest:
+ * a recycled block is released again with the size it was taken for.
+ */
+typedef struct ArenaFreeBlock {
+    struct ArenaFreeBlock *next;
+} ArenaFreeBlock;
+
+#define ARENA_FREE_CLASSES  272     // One free list per 8-byte size: 8 B .. 2176 B (nodes, child blocks)
+
+/**
+ * Backing of an arena's buffer. All zero: malloc, the kernel faulting in
+ * 4 KB pages as the tree first touches them. Anything else maps the buffer
+ * with mmap, aligned to 2 MB so it can be backed by huge pages:
+ *   pages          THP: madvise(MADV_HUGEPAGE). HUGETLB: MAP_HUGETLB from
+ *                  the reserved pool (vm.nr_hugepages), THP if it is empty
+ *   prefault_bytes The leading bytes are faulted in by a background thread
+ *                  (MADV_POPULATE_WRITE, content untouched), so the search
+ *                  starts on resident pages; stopped by arena_free
+ *   reset_keep     arena_reset hands the pages used beyond this many bytes
+ *                  back to the kernel (MADV_DONTNEED): a search that grew
+ *                  the arena far does not keep it resident. 0: keep all
+ * The defaults of each call site are ARENA_BACKING_* in params.h.
+ */
+typedef enum {
+    ARENA_PAGES_DEFAULT = 0,        // Base pages (THP only if the system forces it)
+    ARENA_PAGES_THP,
+    ARENA_PAGES_HUGETLB
+} ArenaPages;
+
+typedef struct {
+    ArenaPages pages;
+    size_t prefault_bytes;
+    size_t reset_keep;
+} ArenaOptions;
+
 typedef struct {
     unsigned char *buffer;
     size_t size;
-    size_t offset;
-    pthread_mutex_t lock;
+    size_t chunk_size;
+    size_t mapped;                  // Length of the mmap'ed buffer, 0 if malloc'ed
+    size_t page_size;               // Of the mapping: huge page size with MAP_HUGETLB
+    ArenaOptions backing;
+    void *prefault;                 // Running pre-fault thread (mcts_arena.c), or NULL
+    _Atomic size_t offset;
+    _Atomic uint64_t generation;
+    _Atomic(ArenaFreeBlock*) free_list[ARENA_FREE_CLASSES];
+    _Atomic size_t free_bytes;      // Bytes sitting on the free lists
+    _Atomic size_t high_water;      // Peak arena_bytes_in_use since arena_init (kept across resets)
 } Arena;
 
 /**
- * Initialize arena allocator.
+ * Allocation counters of one thread, over every arena it used since it
+ * started. Take two snapshots (arena_thread_counters) to measure a span.
+ */
+typedef struct {
+    long allocs;            // Allocations served
+    size_t bytes;           // Bytes served (8-byte aligned sizes)
+    long refills;           // Chunks reserved from an arena's shared offset
+    long recycled;          // Blocks served from the free lists
+} ArenaCounters;
+
+/**
+ * Per-thread allocation window into an Arena.
+ */
+typedef struct {
+    const Arena *arena;
+    uint64_t generation;
+    size_t pos;
+    size_t end;
+    ArenaCounters counters;
+} ArenaChunk;
+
+#define ARENA_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+extern __thread ArenaChunk arena_tls_chunk;
+
+/** Process-wide unique generation id (mcts_arena.c). */
+uint64_t arena_next_generation(void);
+
+/** Slow path: recycle a freed block, refill the calling thread's chunk or allocate directly. */
+void* arena_alloc_slow(Arena *a, size_t bytes);
+
+/**
+ * Give a block back for reuse by later allocations.
+ * Only while no other thread allocates from `a` (like arena_reset).
+ * @param bytes Size the block was allocated with
+ */
+void arena_release(Arena *a, void *ptr, size_t bytes);
+
+/** The calling thread's allocation counters so far. */
+static inline ArenaCounters arena_thread_counters(void) {
+    return arena_tls_chunk.counters;
+}
+
+/** Drop every free list (the blocks stay inside the buffer). */
+static inline void arena_clear_free_lists(Arena *a) {
+    for (int c = 0; c < ARENA_FREE_CLASSES; c++) atomic_store(&a->free_list[c], NULL);
+    atomic_store(&a->free_bytes, 0);
+}
+
+/** Bytes held by live allocations (chunk tails included, free lists excluded). */
+static inline size_t arena_bytes_in_use(const Arena *a) {
+    size_t offset = atomic_load_explicit(&a->offset, memory_order_relaxed);
+    size_t free_bytes = atomic_load_explicit(&a->free_bytes, memory_order_relaxed);
+    return (offset > free_bytes) ? offset - free_bytes : 0;
+}
+
+/**
+ * Initialize arena allocator with a backing (NULL: malloc, like arena_init).
+ * @return 0 on success, -1 on failure (allocation failed)
+ */
+int arena_init_with(Arena *a, size_t total_size, const ArenaOptions *backing);
+
+/**
+ * Initialize arena allocator (malloc'ed buffer).
  * @return 0 on success, -1 on failure (malloc failed)
  */
 static inline int arena_init(Arena *a, size_t total_size) {
-    a->buffer = malloc(total_size);
-    if (!a->buffer) {
-        log_error("[Arena] Malloc failed for size %zu", total_size);
-        return -1;
-    }
-    a->size = total_size;
-    a->offset = 0;
-    pthread_mutex_init(&a->lock, NULL);
-    return 0;
+    return arena_init_with(a, total_size, NULL);
 }
 
+/** Give the pages between reset_keep and `used` back to the kernel (mcts_arena.c). */
+void arena_release_pages(Arena *a, size_t used);
+
 /**
- * Allocate memory from arena.
+ * Allocate memory from arena (8-byte aligned). Lock-free.
  * @return Pointer to allocated memory, or NULL if out of memory
  */
 static inline void* arena_alloc(Arena *a, size_t bytes) {
-    pthread_mutex_lock(&a->lock);
-    uintptr_t current_ptr = (uintptr_t)(a->buffer + a->offset);
-    uintptr_t padding = (8 - (current_ptr % 8)) % 8;
+    ArenaChunk *c = &arena_tls_chunk;
+    const size_t need = ARENA_ALIGN(bytes);
     
-    if (a->offset + padding + bytes > a->size) {
-        pthread_mutex_unlock(&a->lock);
-        log_error("[Arena] Out of Memory! (Size: %zu, Requested: %zu)", a->size, bytes);
-        return NULL;
+    if (c->arena == a &&
+        c->generation == atomic_load_explicit(&a->generation, memory_order_relaxed) &&
+        c->end - c->pos >= need) {
+        void *ptr = a->buffer + c->pos;
+        c->pos += need;
+        c->counters.allocs++;
+        c->counters.bytes += need;
+        return ptr;
     }
-    
-    void *ptr = a->buffer + a->offset + padding;
-    a->offset += padding + bytes;
-    pthread_mutex_unlock(&a->lock);
-    return ptr;
+    return arena_alloc_slow(a, bytes);
 }
 
+/**
+ * Discard all allocations. Not safe while other threads are allocating.
+ */
 static inline void arena_reset(Arena *a) {
-    pthread_mutex_lock(&a->lock);
-    a->offset = 0;
-    pthread_mutex_unlock(&a->lock);
+    const size_t used = atomic_exchange(&a->offset, 0);
+    atomic_store(&a->generation, arena_next_generation());
+    arena_clear_free_lists(a);
+    if (a->backing.reset_keep && used > a->backing.reset_keep) arena_release_pages(a, used);
 }
 
-static inline void arena_free(Arena *a) {
-    pthread_mutex_destroy(&a->lock);
-    free(a->buffer);
-    a->buffer = NULL;
-}
+/** Free the buffer (stopping its pre-fault thread first). */
+void arena_free(Arena *a);
 
 // =============================================================================
 // TRANSPOSITION TABLE
@@ -88,13 +201,45 @@ static inline void arena_free(Arena *a) {
 // Forward declaration for TT (Node is defined below)
 struct Node;
 
+/**
+ * Lock-free, set-associative transposition table.
+ *
+ * Each bucket is one cache line holding TT_WAYS entries. An entry's key is
+ * the position hash with its low TT_GEN_BITS replaced by the table
+ * generation, so a key both verifies the hash and marks the entry as
+ * current. tt_reset() just bumps the generation; entries from older
+ * generations read as empty and are the first to be replaced.
+ *
+ * Slots are claimed by CAS on the key to TT_KEY_BUSY (generation 0: no
+ * lookup matches it, no other insert takes it), then the node is stored
+ * and the real key released last, so a reader that matches a key always
+ * sees a node published under the current generation, never the evicted
+ * one (whose arena may have been reset or freed). Readers still re-verify
+ * the full state on the node.
+ */
+#define TT_WAYS      4
+#define TT_GEN_BITS  16
+#define TT_GEN_MASK  ((1ULL << TT_GEN_BITS) - 1)
+#define TT_KEY_BUSY  (~TT_GEN_MASK)     // Slot being written
+
 typedef struct {
-    struct Node **buckets;
-    size_t size;
-    size_t mask;
-    size_t count;
-    size_t collisions;
-    pthread_mutex_t lock;
+    _Atomic uint64_t key;
+    _Atomic(struct Node*) node;
+} TTEntry;
+
+typedef struct {
+    TTEntry entries[TT_WAYS];
+} __attribute__((aligned(64))) TTBucket;
+
+typedef struct {
+    TTBucket *buckets;
+    void *raw;                  // Unaligned allocation backing buckets
+    size_t size;                // Total entries (num_buckets * TT_WAYS)
+    size_t num_buckets;
+    size_t mask;                // num_buckets - 1
+    uint64_t generation;        // 1..TT_GEN_MASK
+    _Atomic size_t count;       // Entries written this generation
+    _Atomic size_t collisions;  // Live entries evicted this generation
 } TranspositionTable;
 
 // Helper to compare game states
@@ -107,40 +252,57 @@ static inline int states_equal(const GameState *s1, const GameState *s2) {
            s1->moves_without_captures == s2->moves_without_captures;
 }
 
+/**
+ * Create a table with room for `size` entries (rounded down to whole
+ * buckets; bucket count should be a power of two).
+ */
 static inline TranspositionTable* tt_create(size_t size) {
     TranspositionTable *tt = malloc(sizeof(TranspositionTable));
     if (!tt) return NULL;
-    tt->size = size;
-    tt->mask = size - 1;
-    tt->count = 0;
-    tt->collisions = 0;
-    tt->buckets = calloc(size, sizeof(struct Node*));
-    if (!tt->buckets) {
+    tt->num_buckets = (size >= TT_WAYS) ? size / TT_WAYS : 1;
+    tt->size = tt->num_buckets * TT_WAYS;
+    tt->mask = tt->num_buckets - 1;
+    tt->generation = 1;
+    atomic_init(&tt->count, 0);
+    atomic_init(&tt->collisions, 0);
+    
+    tt->raw = calloc(1, tt->num_buckets * sizeof(TTBucket) + 63);
+    if (!tt->raw) {
         free(tt);
         return NULL;
     }
-    pthread_mutex_init(&tt->lock, NULL);
+    tt->buckets = (TTBucket*)(((uintptr_t)tt->raw + 63) & ~(uintptr_t)63);
     return tt;
 }
 
 static inline void tt_free(TranspositionTable *tt) {
     if (tt) {
-        pthread_mutex_destroy(&tt->lock);
-        free(tt->buckets);
+        free(tt->raw);
         free(tt);
     }
 }
 
+/**
+ * Invalidate all entries in O(1) by advancing the generation.
+ * Only clears memory when the generation counter wraps.
+ * Not safe while other threads are using the table.
+ */
 static inline void tt_reset(TranspositionTable *tt) {
     if (tt) {
-        pthread_mutex_lock(&tt->lock);
-        memset(tt->buckets, 0, tt->size * sizeof(struct Node*));
-        tt->count = 0;
-        tt->collisions = 0;
-        pthread_mutex_unlock(&tt->lock);
+        tt->generation++;
+        if (tt->generation > TT_GEN_MASK) {
+            memset(tt->buckets, 0, tt->num_buckets * sizeof(TTBucket));
+            tt->generation = 1;
+        }
+        atomic_store(&tt->count, 0);
+        atomic_store(&tt->collisions, 0);
     }
 }
 
+static inline uint64_t tt_make_key(const TranspositionTable *tt, uint64_t hash) {
+    return (hash & ~TT_GEN_MASK) | tt->generation;
+}
+
 // =============================================================================
 // SOLVER STATUS
 // =============================================================================
@@ -152,69 +314,377 @@ typedef enum {
     SOLVED_DRAW = 2
 } SolverStatus;
 
+// =============================================================================
+// EXPANSION STATE
+// =============================================================================
+
+/**
+ * Expansion claim protocol (replaces a per-node mutex).
+ *
+ * A thread expands a node only after winning the CAS
+ * UNEXPANDED -> EXPANDING. Losers back off: they backpropagate at the leaf
+ * they already evaluated instead of blocking. The winner publishes children
+ * and then stores UNEXPANDED (more untried moves) or EXPANDED.
+ */
+typedef enum {
+    NODE_UNEXPANDED = 0,
+    NODE_EXPANDING = 1,
+    NODE_EXPANDED = 2
+} ExpandState;
+
 // =============================================================================
 // MCTS NODE
 // =============================================================================
 
+/**
+ * Tree node, laid out hot-to-cold.
+ *
+ * The first cache line holds everything selection and backpropagation touch
+ * (stats, prior, status, child array). The game state and parent move follow.
+ *
+ * Untried moves are not stored: a node records only how many legal moves it
+ * has (num_legal), and expand_node regenerates the move list on demand.
+ * `children` is NULL until the first expansion, then points to a child
+ * block with exactly num_legal slots (see ChildStats below).
+ */
 typedef struct Node {
-    GameState state;
-    Move move_from_parent;
-    int player_who_just_moved;
-    
-    struct Node *parent;
-    struct Node **children;
-    int num_children;
-    
-    MoveList untried_moves;
-    int is_terminal;
-    
+    // --- Hot: selection / backprop ---
     _Atomic int visits;
     _Atomic int virtual_loss;
-    
-    double score;
-    double sum_sq_score;
+    _Atomic double score;
+    _Atomic double sum_sq_score;
     double heuristic_score;
     float prior;
+    int8_t status;          // SolverStatus
+    uint8_t is_terminal;
+    uint8_t num_children;   // Children expanded so far
+    uint8_t num_legal;      // Legal moves (capacity of children[])
+    uint16_t depth;         // Ply from search root (TT replacement)
+    _Atomic uint8_t expand_state;  // ExpandState
+    uint8_t child_capacity; // Slots of the child block (0 = none)
+    uint8_t slot;           // Index in parent->children[]
+    struct Node **children;
+    struct Node *parent;
     
-    pthread_mutex_t lock;
-    int8_t status;  // SolverStatus
+    // --- Cold: position data ---
+    GameState state;
+    PackedMove move_from_parent;    // movegen_unpack_move(&parent->state, ...) for the path
+    int player_who_just_moved;
 } Node;
 
+/**
+ * Try to claim a node for expansion.
+ * @return 1 if the caller now owns the expansion, 0 if another thread does
+ */
+static inline int node_try_claim_expansion(Node *node) {
+    uint8_t expected = NODE_UNEXPANDED;
+    return atomic_compare_exchange_strong_explicit(&node->expand_state, &expected, NODE_EXPANDING,
+                                                   memory_order_acquire, memory_order_relaxed);
+}
+
+/**
+ * Release an expansion claim, publishing any children written under it.
+ */
+static inline void node_release_expansion(Node *node, int fully_expanded) {
+    atomic_store_explicit(&node->expand_state,
+                          fully_expanded ? NODE_EXPANDED : NODE_UNEXPANDED,
+                          memory_order_release);
+}
+
+/**
+ * Lock-free accumulate into an atomic double.
+ */
+static inline void atomic_add_double(_Atomic double *target, double value) {
+    double current = atomic_load_explicit(target, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(target, &current, current + value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+/**
+ * A node is fully expanded once every legal move has a child.
+ */
+static inline int node_is_fully_expanded(const Node *node) {
+    return node->num_children >= node->num_legal;
+}
+
+// =============================================================================
+// CHILD STATISTICS (structure of arrays)
+// =============================================================================
+
+/**
+ * Contiguous copy of the child fields selection reads, kept in the same
+ * arena block as the children[] pointers:
+ *
+ *   children[cap] | foreign | visits[cap] | virtual_loss[cap] | score[cap]
+ *   | sum_sq[cap] | prior[cap] | heuristic[cap] | status[cap] | pad
+ *
+ * The pad lets a vector load start at any slot: the lanes past the last
+ * child read the next array (or the pad) and are masked out.
+ *
+ * The Node fields stay authoritative: after each change a node rewrites
+ * its entry in the block of node->parent, at node->slot
+ * (child_stats_publish). A TT-shared child belongs to one parent only;
+ * in every other parent its bit in `foreign` is set and selection reads
+ * the node itself. Entries are floats: they only rank children and are
+ * rewritten, never accumulated, so the rounding does not build up.
+ */
+typedef struct {
+    uint64_t *foreign;      // Slots whose stats are not mirrored (bit i)
+    int32_t *visits;
+    int32_t *virtual_loss;
+    float *score;
+    float *sum_sq;
+    float *prior;
+    float *heuristic;
+    int8_t *status;
+} ChildStats;
+
+#define CHILD_STATS_SLOT_BYTES  (sizeof(Node*) + 6 * sizeof(float) + sizeof(int8_t))
+#define CHILD_STATS_PAD         32      // One 8-float vector
+
+/** Arena bytes of a child block with 'capacity' slots. */
+static inline size_t child_block_bytes(int capacity) {
+    return ARENA_ALIGN(sizeof(uint64_t) + (size_t)capacity * CHILD_STATS_SLOT_BYTES + CHILD_STATS_PAD);
+}
+
+static inline ChildStats child_stats_of(const Node *parent) {
+    const size_t cap = parent->child_capacity;
+    unsigned char *p = (unsigned char*)(parent->children + cap);
+    ChildStats s;
+    s.foreign = (uint64_t*)p;           p += sizeof(uint64_t);
+    s.visits = (int32_t*)p;             p += cap * sizeof(int32_t);
+    s.virtual_loss = (int32_t*)p;       p += cap * sizeof(int32_t);
+    s.score = (float*)p;                p += cap * sizeof(float);
+    s.sum_sq = (float*)p;               p += cap * sizeof(float);
+    s.prior = (float*)p;                p += cap * sizeof(float);
+    s.heuristic = (float*)p;            p += cap * sizeof(float);
+    s.status = (int8_t*)p;
+    return s;
+}
+
+/**
+ * Allocate a node's child block (children[] plus its ChildStats).
+ * @return node->children, or NULL if the arena is full
+ */
+static inline Node** node_alloc_children(Node *node, Arena *arena, int capacity) {
+    Node **children = (Node**)arena_alloc(arena, child_block_bytes(capacity));
+    if (!children) return NULL;
+    node->children = children;
+    node->child_capacity = (uint8_t)capacity;
+    *child_stats_of(node).foreign = 0;
+    return children;
+}
+
+/**
+ * Copy a child's fields into slot i (relaxed stores: readers may see a
+ * mix of old and new values, which only perturbs one selection).
+ */
+static inline void child_stats_store(const ChildStats *s, int i, const Node *child) {
+    atomic_store_explicit((_Atomic int32_t*)&s->visits[i],
+                          atomic_load_explicit(&child->visits, memory_order_relaxed), memory_order_relaxed);
+    atomic_store_explicit((_Atomic int32_t*)&s->virtual_loss[i],
+                          atomic_load_explicit(&child->virtual_loss, memory_order_relaxed), memory_order_relaxed);
+    atomic_store_explicit((_Atomic float*)&s->score[i],
+                          (float)atomic_load_explicit(&child->score, memory_order_relaxed), memory_order_relaxed);
+    atomic_store_explicit((_Atomic float*)&s->sum_sq[i],
+                          (float)atomic_load_explicit(&child->sum_sq_score, memory_order_relaxed), memory_order_relaxed);
+    s->prior[i] = child->prior;
+    s->heuristic[i] = (float)child->heuristic_score;
+    atomic_store_explicit((_Atomic int8_t*)&s->status[i], child->status, memory_order_relaxed);
+}
+
+static inline int child_stats_owned(const Node *node) {
+    const Node *parent = node->parent;
+    return parent && node->slot < parent->child_capacity && parent->children[node->slot] == node;
+}
+
+/** Rewrite a node's entry in its parent's block (no-op for the root). */
+static inline void child_stats_publish(const Node *node) {
+    if (!child_stats_owned(node)) return;
+    ChildStats s = child_stats_of(node->parent);
+    child_stats_store(&s, node->slot, node);
+}
+
+/** Same, when only the virtual loss changed (selection, dropped leaves). */
+static inline void child_stats_publish_virtual_loss(const Node *node) {
+    if (!child_stats_owned(node)) return;
+    ChildStats s = child_stats_of(node->parent);
+    atomic_store_explicit((_Atomic int32_t*)&s.virtual_loss[node->slot],
+                          atomic_load_explicit(&node->virtual_loss, memory_order_relaxed), memory_order_relaxed);
+}
+
+/**
+ * Place a child in slot i of a block under expansion: owned children take
+ * the slot, TT-shared ones are flagged foreign. Publish num_children after.
+ */
+static inline void child_stats_attach(Node *parent, int i, Node *child) {
+    ChildStats s = child_stats_of(parent);
+    parent->children[i] = child;
+    int taken = child->slot < i && parent->children[child->slot] == child; // Same position twice
+    if (child->parent == parent && !taken) {
+        child->slot = (uint8_t)i;
+        *s.foreign &= ~(1ULL << i);
+    } else {
+        *s.foreign |= 1ULL << i;
+    }
+    child_stats_store(&s, i, child);
+}
+
+// =============================================================================
+// PATH SET (repetition detection)
+// =============================================================================
+
+/**
+ * Hashes of the positions on the current selection path, root history
+ * included. A counting filter over the low hash bits answers most queries
+ * in O(1); a hit is confirmed against the stack.
+ *
+ * One per thread (path_tls). select_promising_node() loads it; create_node()
+ * uses it when its parent is the path top and walks ancestors otherwise.
+ */
+typedef struct {
+    uint64_t hashes[PATH_SET_MAX_DEPTH];
+    uint16_t counts[PATH_SET_SLOTS];
+    const Node *root;       // Root the history base was built for
+    const Node *root_parent;
+    const Node *top;        // Last node pushed (NULL = not usable)
+    int base;               // Entries for root and its history
+    int depth;
+} PathSet;
+
+extern __thread PathSet path_tls;
+
+static inline void path_set_push(PathSet *ps, const Node *node) {
+    if (ps->depth >= PATH_SET_MAX_DEPTH) {
+        ps->top = NULL;     // Too deep: fall back to the ancestor walk
+        return;
+    }
+    const uint64_t h = node->state.hash;
+    ps->hashes[ps->depth++] = h;
+    ps->counts[h & (PATH_SET_SLOTS - 1)]++;
+    ps->top = node;
+}
+
+static inline void path_set_truncate(PathSet *ps, int depth) {
+    while (ps->depth > depth) {
+        ps->counts[ps->hashes[--ps->depth] & (PATH_SET_SLOTS - 1)]--;
+    }
+}
+
+/**
+ * Start a descent from root: keep the cached history base when the root is
+ * unchanged, otherwise rebuild it from root and its parent chain.
+ */
+static inline void path_set_begin(PathSet *ps, const Node *root) {
+    if (ps->root == root && ps->root_parent == root->parent && ps->base > 0) {
+        path_set_truncate(ps, ps->base);
+        ps->top = root;
+        return;
+    }
+    path_set_truncate(ps, 0);
+    ps->root = root;
+    ps->root_parent = root->parent;
+    for (const Node *n = root->parent; n; n = n->parent) path_set_push(ps, n);
+    path_set_push(ps, root);
+    ps->base = ps->depth;
+    if (ps->top != root) ps->base = 0; // History overflowed the stack
+}
+
+/** Forget the loaded path (new tree, arena reset). */
+static inline void path_set_invalidate(PathSet *ps) {
+    path_set_truncate(ps, 0);
+    ps->root = NULL;
+    ps->root_parent = NULL;
+    ps->top = NULL;
+    ps->base = 0;
+}
+
+static inline int path_set_contains(const PathSet *ps, uint64_t hash) {
+    if (!ps->counts[hash & (PATH_SET_SLOTS - 1)]) return 0;
+    for (int i = ps->depth - 1; i >= 0; i--) {
+        if (ps->hashes[i] == hash) return 1;
+    }
+    return 0;
+}
+
 // =============================================================================
 // TRANSPOSITION TABLE LOOKUP/INSERT (need Node definition)
 // =============================================================================
 
 static inline Node* tt_lookup(TranspositionTable *tt, const GameState *state) {
     if (!tt) return NULL;
-    size_t idx = state->hash & tt->mask;
+    TTBucket *bucket = &tt->buckets[state->hash & tt->mask];
+    const uint64_t key = tt_make_key(tt, state->hash);
     
-    pthread_mutex_lock(&tt->lock);
-    Node *node = tt->buckets[idx];
-    if (node && node->state.hash == state->hash && states_equal(&node->state, state)) {
-        pthread_mutex_unlock(&tt->lock);
-        return node;
+    for (int w = 0; w < TT_WAYS; w++) {
+        TTEntry *e = &bucket->entries[w];
+        if (atomic_load_explicit(&e->key, memory_order_acquire) != key) continue;
+        Node *node = atomic_load_explicit(&e->node, memory_order_acquire);
+        if (node && node->state.hash == state->hash && states_equal(&node->state, state)) {
+            return node;
+        }
     }
-    pthread_mutex_unlock(&tt->lock);
     return NULL;
 }
 
+// Replacement value: more visits first, then shallower (closer to root)
+static inline long tt_entry_value(const Node *node) {
+    if (!node) return -1;
+    return ((long)atomic_load_explicit(&node->visits, memory_order_relaxed) << 16) - node->depth;
+}
+
 static inline void tt_insert(TranspositionTable *tt, Node *node) {
     if (!tt) return;
-    size_t idx = node->state.hash & tt->mask;
+    TTBucket *bucket = &tt->buckets[node->state.hash & tt->mask];
+    const uint64_t key = tt_make_key(tt, node->state.hash);
     
-    pthread_mutex_lock(&tt->lock);
-    Node *existing = tt->buckets[idx];
+    // Same position already stored: keep whichever has more visits
+    for (int w = 0; w < TT_WAYS; w++) {
+        TTEntry *e = &bucket->entries[w];
+        if (atomic_load_explicit(&e->key, memory_order_acquire) != key) continue;
+        Node *existing = atomic_load_explicit(&e->node, memory_order_acquire);
+        if (existing && !states_equal(&existing->state, &node->state)) continue;
+        
+        if (existing && atomic_load(&existing->visits) > atomic_load(&node->visits)) {
+            return;  // Keep existing higher-quality entry
+        }
+        atomic_compare_exchange_strong(&e->node, &existing, node);
+        return;
+    }
     
-    // Quality-based replacement: only replace if new node has more visits
-    if (existing && atomic_load(&existing->visits) > atomic_load(&node->visits)) {
-        pthread_mutex_unlock(&tt->lock);
-        return;  // Keep existing higher-quality entry
+    // Pick a victim: stale/empty entries first, then the least valuable one
+    int victim = -1;
+    long victim_value = 0;
+    int victim_live = 1;
+    for (int w = 0; w < TT_WAYS; w++) {
+        TTEntry *e = &bucket->entries[w];
+        uint64_t k = atomic_load_explicit(&e->key, memory_order_relaxed);
+        if (k == TT_KEY_BUSY) continue;
+        if ((k & TT_GEN_MASK) != tt->generation) {
+            victim = w;
+            victim_live = 0;
+            break;
+        }
+        long v = tt_entry_value(atomic_load_explicit(&e->node, memory_order_relaxed));
+        if (victim < 0 || v < victim_value) {
+            victim = w;
+            victim_value = v;
+        }
     }
     
-    if (tt->buckets[idx] != NULL) tt->collisions++;
-    tt->buckets[idx] = node;
-    tt->count++;
-    pthread_mutex_unlock(&tt->lock);
+    if (victim < 0) return;     // Every way is being written
+    if (victim_live && victim_value > tt_entry_value(node)) return;
+    
+    // Claim the slot; losing the race to another writer simply drops this insert
+    TTEntry *e = &bucket->entries[victim];
+    uint64_t old_key = atomic_load_explicit(&e->key, memory_order_relaxed);
+    if (old_key == TT_KEY_BUSY || !atomic_compare_exchange_strong(&e->key, &old_key, TT_KEY_BUSY)) return;
+    atomic_store_explicit(&e->node, node, memory_order_release);
+    atomic_store_explicit(&e->key, key, memory_order_release);
+    
+    if (victim_live) atomic_fetch_add_explicit(&tt->collisions, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tt->count, 1, memory_order_relaxed);
 }
 
 #endif // MCTS_TYPES_H
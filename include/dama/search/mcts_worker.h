@@ -8,37 +8,306 @@
 #define MCTS_WORKER_H
 
 #include "dama/search/mcts_types.h"
+#include "dama/search/mcts_tree.h"
 #include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
 
 // =============================================================================
 // ASYNC BATCHING INFRASTRUCTURE
 // =============================================================================
 
+/** Ring capacity: whole batches in flight while the next one fills. */
+#define INFERENCE_RING_SIZE  (2 * MCTS_BATCH_SIZE)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define CPU_RELAX() __asm__ volatile("yield")
+#else
+#define CPU_RELAX() ((void)0)
+#endif
+
 /**
  * Request structure for async CNN inference batching.
+ * Lives on the submitting worker's stack until 'ready' is set.
  */
 typedef struct {
     Node *node;
     float *policy_out;
     float *value_out;
-    int ready;
-    pthread_cond_t cond;
+    _Atomic int ready;      // Completion flag, set (release) by the evaluator
 } InferenceRequest;
 
+typedef struct {
+    _Atomic uint64_t seq;   // Slot turn (Vyukov bounded queue)
+    InferenceRequest *req;
+} InferenceSlot;
+
 /**
- * Queue for batching inference requests across worker threads.
+ * Lock-free MPMC ring of inference requests.
+ *
+ * Workers push with a CAS on 'head'; evaluators pop with a CAS on 'tail'.
+ * The ring holds two batches, so workers keep filling batch N+1 while
+ * batch N is inside cnn_forward_batch.
+ *
+ * Push, pop and completion never take a lock. Threads that run out of
+ * spinning sleep on the eventcount below, and the other side only takes
+ * the mutex when it sees a sleeper.
  */
 typedef struct {
-    GameState states[MCTS_BATCH_SIZE];
-    InferenceRequest *requests[MCTS_BATCH_SIZE];
-    int count;
+    InferenceSlot slots[INFERENCE_RING_SIZE];
+    _Atomic uint64_t head;  // Next ticket for producers
+    _Atomic uint64_t tail;  // Next slot for the consumer
+    _Atomic int shutdown;
     
+    // Sleep path only
     pthread_mutex_t lock;
-    pthread_cond_t cond_batch_ready;
-    
-    volatile int shutdown;
+    pthread_cond_t cond_done;       // Evaluator -> workers waiting on results
+    pthread_cond_t cond_work;       // Workers -> idle evaluator
+    _Atomic int sleeping_workers;
+    _Atomic int sleeping_evaluators;
 } InferenceQueue;
 
+static inline void inference_queue_init(InferenceQueue *q) {
+    for (uint64_t i = 0; i < INFERENCE_RING_SIZE; i++) {
+        atomic_init(&q->slots[i].seq, i);
+        q->slots[i].req = NULL;
+    }
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->shutdown, 0);
+    atomic_init(&q->sleeping_workers, 0);
+    atomic_init(&q->sleeping_evaluators, 0);
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond_done, NULL);
+    pthread_cond_init(&q->cond_work, NULL);
+}
+
+static inline void inference_queue_destroy(InferenceQueue *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond_done);
+    pthread_cond_destroy(&q->cond_work);
+}
+
+/** Wake every sleeper (shutdown). */
+static inline void inference_queue_shutdown(InferenceQueue *q) {
+    atomic_store(&q->shutdown, 1);
+    pthread_mutex_lock(&q->lock);
+    pthread_cond_broadcast(&q->cond_done);
+    pthread_cond_broadcast(&q->cond_work);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ * Enqueue a request (any thread).
+ * @return 1 on success, 0 if the ring is full
+ */
+static inline int inference_queue_push(InferenceQueue *q, InferenceRequest *req) {
+    uint64_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    for (;;) {
+        InferenceSlot *slot = &q->slots[pos & (INFERENCE_RING_SIZE - 1)];
+        const uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        const int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                slot->req = req;
+                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                atomic_thread_fence(memory_order_seq_cst); // Pairs with inference_queue_wait_work
+                if (atomic_load(&q->sleeping_evaluators) > 0) {
+                    pthread_mutex_lock(&q->lock);
+                    pthread_cond_signal(&q->cond_work);
+                    pthread_mutex_unlock(&q->lock);
+                }
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Dequeue a request (any evaluator).
+ * @return The oldest request, or NULL if the ring is empty
+ */
+static inline InferenceRequest* inference_queue_pop(InferenceQueue *q) {
+    uint64_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (;;) {
+        InferenceSlot *slot = &q->slots[pos & (INFERENCE_RING_SIZE - 1)];
+        const uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        const int64_t diff = (int64_t)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                InferenceRequest *req = slot->req;
+                atomic_store_explicit(&slot->seq, pos + INFERENCE_RING_SIZE, memory_order_release);
+                return req;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/** Mark a request done; its outputs must be written before this call. */
+static inline void inference_request_complete(InferenceRequest *req) {
+    atomic_store(&req->ready, 1);
+}
+
+/** After completing a batch: wake workers that went to sleep on it. */
+static inline void inference_queue_notify_done(InferenceQueue *q) {
+    if (atomic_load(&q->sleeping_workers) > 0) {
+        pthread_mutex_lock(&q->lock);
+        pthread_cond_broadcast(&q->cond_done);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+/**
+ * Wait for a request to complete: spin briefly, then sleep.
+ * @return 1 when ready, 0 if the queue shut down first
+ */
+static inline int inference_request_wait(InferenceRequest *req, InferenceQueue *q) {
+    for (int spins = 0; spins < INFERENCE_SPIN_LIMIT; spins++) {
+        if (atomic_load_explicit(&req->ready, memory_order_acquire)) return 1;
+        CPU_RELAX();
+    }
+    
+    // Dekker-style handshake with inference_queue_notify_done (seq_cst):
+    // either we see 'ready' or the evaluator sees us sleeping
+    pthread_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->sleeping_workers, 1);
+    while (!atomic_load(&req->ready) && !atomic_load(&q->shutdown)) {
+        pthread_cond_wait(&q->cond_done, &q->lock);
+    }
+    atomic_fetch_sub(&q->sleeping_workers, 1);
+    pthread_mutex_unlock(&q->lock);
+    return atomic_load(&req->ready);
+}
+
+/**
+ * Evaluator side: sleep until a request may be available or timeout_us pass.
+ */
+static inline void inference_queue_wait_work(InferenceQueue *q, long timeout_us) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += timeout_us * 1000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec += ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+    }
+    
+    pthread_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->sleeping_evaluators, 1);
+    const uint64_t tail = atomic_load(&q->tail);
+    InferenceSlot *slot = &q->slots[tail & (INFERENCE_RING_SIZE - 1)];
+    if (atomic_load(&slot->seq) != tail + 1 && !atomic_load(&q->shutdown)) {
+        pthread_cond_timedwait(&q->cond_work, &q->lock, &ts);
+    }
+    atomic_fetch_sub(&q->sleeping_evaluators, 1);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ * Stop signal between the search controller and its workers.
+ *
+ * Workers check node and early-exit limits after every iteration and
+ * raise 'stop' themselves; the controller sleeps on 'cond' until that
+ * happens or the time limit expires. No polling on either side.
+ * In a bounded-memory search, a worker that sees the arena pass
+ * 'memory_high_water' raises 'prune_requested' instead: every worker
+ * parks at the top of its loop, the controller prunes the quiescent tree
+ * and resumes them (same threads, so their arena chunks stay in use).
+ */
+typedef struct {
+    _Atomic int stop;
+    _Atomic int next_early_check;   // Visit count of the next should_exit_early test
+    _Atomic int prune_requested;
+    size_t memory_high_water;       // Arena bytes in use that trigger a prune (0 = unbounded)
+    int idle;                       // Workers parked or exited (under lock)
+    pthread_mutex_t lock;
+    pthread_cond_t cond;            // Wakes the controller
+    pthread_cond_t resume;          // Wakes parked workers
+} SearchControl;
+
+static inline void search_control_init(SearchControl *c) {
+    atomic_init(&c->stop, 0);
+    atomic_init(&c->next_early_check, 0);
+    atomic_init(&c->prune_requested, 0);
+    c->memory_high_water = 0;
+    c->idle = 0;
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    pthread_cond_init(&c->resume, NULL);
+}
+
+static inline void search_control_destroy(SearchControl *c) {
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->cond);
+    pthread_cond_destroy(&c->resume);
+}
+
+/** Stop the search (any thread), wake the controller and any parked worker. */
+static inline void search_control_stop(SearchControl *c) {
+    if (atomic_exchange(&c->stop, 1)) return;
+    pthread_mutex_lock(&c->lock);
+    pthread_cond_broadcast(&c->cond);
+    pthread_cond_broadcast(&c->resume);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/** Ask the controller for a prune (any worker). */
+static inline void search_control_request_prune(SearchControl *c) {
+    if (atomic_exchange(&c->prune_requested, 1)) return;
+    pthread_mutex_lock(&c->lock);
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/** Worker: wait out a requested prune (returns at once if stopped). */
+static inline void search_control_park(SearchControl *c) {
+    pthread_mutex_lock(&c->lock);
+    c->idle++;
+    pthread_cond_broadcast(&c->cond);
+    while (atomic_load(&c->prune_requested) && !atomic_load(&c->stop)) {
+        pthread_cond_wait(&c->resume, &c->lock);
+    }
+    c->idle--;
+    pthread_mutex_unlock(&c->lock);
+}
+
+/** Worker: leaving for good (counts as parked from then on). */
+static inline void search_control_exit(SearchControl *c) {
+    pthread_mutex_lock(&c->lock);
+    c->idle++;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/** Controller: block until all 'workers' are parked, then the tree is quiescent. */
+static inline void search_control_wait_idle(SearchControl *c, int workers) {
+    pthread_mutex_lock(&c->lock);
+    while (c->idle < workers) pthread_cond_wait(&c->cond, &c->lock);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/** Controller: prune done, let the parked workers go on. */
+static inline void search_control_resume(SearchControl *c) {
+    pthread_mutex_lock(&c->lock);
+    atomic_store(&c->prune_requested, 0);
+    pthread_cond_broadcast(&c->resume);
+    pthread_mutex_unlock(&c->lock);
+}
+
+typedef struct InferenceServer InferenceServer;
+
 /**
  * Arguments passed to each worker thread.
  */
@@ -46,7 +315,9 @@ typedef struct {
     Node *root;
     Arena *arena;
     MCTSConfig config;
-    InferenceQueue *queue;
+    SelectKernel select;        // Tree policy resolved by mcts_search
+    InferenceServer *server;    // CNN evaluator (NULL for rollouts)
+    SearchControl *control;     // Shared stop signal and limit bookkeeping
     int thread_id;
     TranspositionTable *tt;
     MCTSStats *local_stats;
@@ -0,0 +1,102 @@
+/**
+ * opening_book.h - Precomputed Opening Book
+ *
+ * Move statistics per position, built offline and consulted before
+ * searching. A book file is a sorted array of BookEntry (by position hash,
+ * then most played move first) behind a small header, probed in place
+ * through mmap with a binary search.
+ *
+ * Entries come from deep mcts_search runs over the first plies
+ * (opening_book_search) or from the moves played in selfplay datasets
+ * (book_add_games, training module); both feed a BookBuilder that merges
+ * duplicates and writes the file.
+ *
+ * Keys are GameState.hash: the move counter is not part of them, which the
+ * opening never reaches. Every probed move is checked against the legal
+ * moves of the position, so a hash collision only costs the book a move.
+ */
+
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include "dama/search/mcts.h"
+#include "dama/common/rng.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t key;               // GameState.hash of the position
+    PackedMove move;
+    uint32_t visits;            // Search visits, or games that played it
+    float score;                // Mean result for the side playing it, in [0, 1]
+} BookEntry;
+
+typedef struct {
+    const BookEntry *entries;
+    size_t count;
+    void *mapping;
+    size_t mapping_bytes;
+} OpeningBook;
+
+typedef struct {
+    BookEntry *entries;
+    size_t count, capacity;
+} BookBuilder;
+
+// =============================================================================
+// PROBING
+// =============================================================================
+
+/**
+ * Map a book file. Books written with other zobrist keys are rejected.
+ * @return 0 on success, -1 on error (logged; book zeroed)
+ */
+int opening_book_open(OpeningBook *book, const char *path);
+
+void opening_book_close(OpeningBook *book);
+
+/**
+ * Legal book moves of s, most played first.
+ * @return Entries written to out (at most max)
+ */
+int opening_book_probe(const OpeningBook *book, const GameState *s, BookEntry *out, int max);
+
+/**
+ * Move to play from the book: the most played one (rng NULL), or one drawn
+ * in proportion to visits among those with at least BOOK_PICK_SHARE of the
+ * top visits.
+ * @return 1 if out holds a move, 0 if s is out of book (or its top move
+ *         has fewer than BOOK_MIN_VISITS)
+ */
+int opening_book_pick(const OpeningBook *book, const GameState *s, RNG *rng, Move *out);
+
+// =============================================================================
+// BUILDING
+// =============================================================================
+
+void book_builder_init(BookBuilder *b);
+void book_builder_free(BookBuilder *b);
+
+/** Add statistics for one move (merged with earlier ones on write). */
+int book_builder_add(BookBuilder *b, uint64_t key, PackedMove move, uint32_t visits, float score);
+
+/**
+ * Merge duplicate moves (visits add up, scores average by visits), drop
+ * those below min_visits and write the book.
+ * @return Entries written, -1 on error (logged)
+ */
+long book_builder_write(BookBuilder *b, const char *path, uint32_t min_visits);
+
+/**
+ * Search the opening tree from start: one mcts_search per position (budget
+ * from config.max_nodes), every root child with a visit becomes an entry,
+ * and children with at least min_share of the root visits are searched in
+ * turn, down to `depth` plies. Transpositions are searched once. The
+ * positions of one ply are searched in parallel (threads 0: OpenMP default).
+ * @param on_ply Optional: called after each ply with the positions searched
+ * @return Positions searched, -1 on error
+ */
+long opening_book_search(BookBuilder *b, const GameState *start, int depth, double min_share,
+                         const MCTSConfig *config, int threads, void (*on_ply)(int ply, long positions));
+
+#endif // OPENING_BOOK_H
@@ -0,0 +1,99 @@
+/**
+ * search_cache.h - Persistent Search Cache
+ *
+ * Root results of finished searches (visits, value, visit distribution)
+ * kept in a fixed-size file that outlives games and runs: tournaments,
+ * CLOP sweeps and selfplay replay the same openings over and over. The
+ * file is mapped shared and read-write, so every thread and every process
+ * that opens it sees the others' stores at once.
+ *
+ * With MCTSConfig.search_cache set, mcts_search looks a fresh root up
+ * (no visits yet) and, on a hit, starts from the cached statistics: the
+ * root is fully expanded, each cached move gets its visits and mean score
+ * and a prior from its visit share. A search whose node budget the cache
+ * already covers returns at once. The root is stored back when the search
+ * ends.
+ *
+ * Keys mix GameState.hash, the moves without captures and a fingerprint of
+ * the config (search parameters, and the network's biases when there is
+ * one), so another engine, preset or model never reads these results.
+ * Network history planes are not part of the key.
+ *
+ * Entries are direct-mapped, 128 bytes, written and read lock-free as
+ * atomic words: the first word is the key XORed with all the others, so
+ * a read that races a write (or a write another process left half done)
+ * fails the check and is a miss.
+ */
+
+#ifndef SEARCH_CACHE_H
+#define SEARCH_CACHE_H
+
+#include "dama/search/mcts.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SEARCH_CACHE_WORDS      16      // 128 B per entry
+#define SEARCH_CACHE_MOVES      26      // Most visited root moves kept (2 per word after 3 header words)
+
+typedef struct {
+    _Atomic uint64_t words[SEARCH_CACHE_WORDS];
+} SearchCacheEntry;
+
+typedef struct {
+    SearchCacheEntry *entries;
+    size_t capacity;            // Power of two
+    size_t mask;
+    void *mapping;
+    size_t mapping_bytes;
+} SearchCache;
+
+/** One cached root, moves most visited first. */
+typedef struct {
+    uint32_t visits;            // Root visits of the stored search
+    float value;                // Mean score for the side to move, in [0, 1]
+    int num_legal;
+    int count;
+    uint8_t move_index[SEARCH_CACHE_MOVES];     // Index in movegen_generate_packed order
+    uint32_t move_visits[SEARCH_CACHE_MOVES];
+    float move_score[SEARCH_CACHE_MOVES];       // Mean score for the side to move
+} SearchCacheHit;
+
+/**
+ * Map a cache file, creating it with `entries` slots (rounded down to a
+ * power of two; 0: SEARCH_CACHE_ENTRIES) if it does not exist. An existing
+ * file keeps its own size. Files written with other zobrist keys are
+ * rejected.
+ * @return 0 on success, -1 on error (logged; cache zeroed)
+ */
+int search_cache_open(SearchCache *cache, const char *path, size_t entries);
+
+void search_cache_close(SearchCache *cache);
+
+/** Config (and network) part of the keys. */
+uint64_t search_cache_fingerprint(const MCTSConfig *config);
+
+/**
+ * Look s up (any thread, any process).
+ * @return 1 on hit, 0 on miss
+ */
+int search_cache_probe(const SearchCache *cache, const GameState *s, uint64_t fingerprint,
+                       SearchCacheHit *out);
+
+/**
+ * Store the root children statistics of a search. Replaces another
+ * position, or the same one searched with no more visits.
+ * @return 1 if stored, 0 if skipped (too few visits, deeper entry kept)
+ */
+int search_cache_store(SearchCache *cache, const Node *root, uint64_t fingerprint);
+
+/**
+ * Start a fresh root (no visits, no children) from its cached result:
+ * expand every move and give the cached ones their visits, score and a
+ * visit-share prior. Not safe while a search runs on the tree.
+ * @return Root visits seeded (0 on a miss)
+ */
+int search_cache_seed(const SearchCache *cache, Node *root, Arena *arena, TranspositionTable *tt,
+                      MCTSConfig config, uint64_t fingerprint, MCTSStats *stats);
+
+#endif // SEARCH_CACHE_H
@@ -0,0 +1,86 @@
+/**
+ * search_server.h - Resident Engine Behind a Line Protocol
+ *
+ * One engine (network, arenas, TT, eval cache) set up once and kept for
+ * every request, so a request costs only its search. Commands are text
+ * lines; replies go to `out`, one line each, flushed:
+ *
+ *   isready                          -> readyok
+ *   newgame                          Forget the kept tree and the TT
+ *   position startpos [moves <m>...] Set the position (moves as "B3-A4", "D3xF5xD7")
+ *   position board <32> <w|b> [moves <m>...]
+ *                                    Dark squares 0..31 from A1, '.' w W b B
+ *   legal                            -> legal <m>...
+ *   go [nodes <n>] [time <s>] [clock <remaining> [<increment>]] [infinite]
+ *                                    -> info ... (every SERVE_INFO_INTERVAL s),
+ *                                       then a final info and bestmove <m>
+ *   stop                             End the running search (bestmove follows)
+ *   quit
+ *
+ *   info time <s> nodes <n> depth <d> nps <n> value <v> pv <m>...
+ *
+ * value is the expected score of the best move in [0, 1] for the side to
+ * move. `go` with neither nodes nor a time limit runs until `stop`. Other
+ * commands wait for a bounded search to finish and stop an unbounded one
+ * (stop and isready answer at once). A new position below the last
+ * searched one (our move and the reply) keeps its subtree when the config
+ * has tree reuse. Errors answer "error <text>".
+ */
+
+#ifndef SEARCH_SERVER_H
+#define SEARCH_SERVER_H
+
+#include "dama/search/mcts_async.h"
+#include <stdio.h>
+
+typedef struct {
+    MCTSConfig config;
+    Arena arena, spare;
+    TranspositionTable *tt;     // NULL unless config.use_tt
+    FILE *out;
+
+    // Position
+    GameState state;
+    GameState history[2];       // Positions before state (history[0] the last)
+    int plies;                  // History slots in use (0..2)
+
+    // Search
+    Node *root;                 // Tree of the last search (tree reuse), or NULL
+    MCTSAsyncSearch search;
+    MCTSStats stats;
+    double started, last_info;
+    int bounded;                // The running search has a node or time limit
+} SearchServer;
+
+/**
+ * Allocate the arenas (the spare only with tree reuse) and the TT, and set
+ * the start position. The config's pointers (network, cache) are used as
+ * they are.
+ * @return 0 on success, -1 on allocation failure
+ */
+int search_server_init(SearchServer *srv, MCTSConfig config, size_t arena_size, FILE *out);
+
+/** Stop any search and free everything. */
+void search_server_free(SearchServer *srv);
+
+/**
+ * Handle one command line (no trailing newline needed).
+ * @return 1 on quit, 0 otherwise
+ */
+int search_server_command(SearchServer *srv, const char *line);
+
+/**
+ * Report on the running search: info lines while it runs, the final info
+ * and bestmove once it has returned. Call it regularly (between input
+ * reads).
+ * @return 1 while a search is running, 0 otherwise
+ */
+int search_server_poll(SearchServer *srv);
+
+/**
+ * Let a bounded search run to its limit (stop an unbounded one) and report
+ * it, as any command but stop and isready does first.
+ */
+void search_server_finish(SearchServer *srv);
+
+#endif // SEARCH_SERVER_H
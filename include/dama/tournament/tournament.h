@@ -2,6 +2,7 @@
 #define TOURNAMENT_H
 
 #include "dama/search/mcts.h"
+#include "dama/search/opening_book.h"
 
 // =============================================================================
 // TYPES
@@ -20,8 +21,12 @@ typedef struct {
     long long total_expansions;
     long long total_children_expanded;
     long long tt_hits, tt_misses;
+    long long search_cache_hits, search_cache_misses;
+    long long arena_allocs, arena_bytes;
     double total_duration;
     size_t peak_memory;
+    size_t arena_high_water;    // Most arena bytes any of its searches had in use
+    MCTSProfile profile;    // Phase timing over all games (make PROFILE=1)
 } TournamentPlayer;
 
 typedef struct {
@@ -36,17 +41,52 @@ typedef struct {
     MCTSStats s2;
 } TournamentGameResult;
 
+/**
+ * When a match may end before games_per_pair games (all zero: never).
+ *
+ * SPRT: sequential test of H0 "p1 - p2 = elo0 Elo" against H1 "= elo1"
+ * (normal approximation of the game score, draws included); the match ends
+ * once the log-likelihood ratio leaves [log(beta / (1 - alpha)),
+ * log((1 - beta) / alpha)]. Clearly better or worse players are decided in
+ * a fraction of the games.
+ *
+ * Elo confidence: the match ends once the 95% interval of the Elo
+ * difference is within +-elo_margin.
+ */
+typedef struct {
+    int sprt;                   // 1: run the SPRT
+    double elo0, elo1;          // Elo difference (p1 - p2) under H0 / H1
+    double alpha, beta;         // Error rates (0: SPRT_ALPHA / SPRT_BETA)
+    double elo_margin;          // > 0: precision stopping
+    int min_games;              // No stop before this many (0: SPRT_MIN_GAMES)
+} MatchStopRule;
+
+typedef enum {
+    MATCH_CONTINUE = 0,
+    MATCH_ACCEPT_H1 = 1,        // SPRT: p1 is elo1 stronger
+    MATCH_ACCEPT_H0 = -1,       // SPRT: p1 is elo0 stronger (not elo1)
+    MATCH_PRECISE = 2           // Elo interval within the margin
+} MatchVerdict;
+
 typedef struct {
     int num_players;
     TournamentPlayer *players;
     int games_per_pair;
     double time_limit;
+    double clock_base;      // > 0: each side plays on a clock of base seconds (time_limit unused)
+    double clock_increment; // Seconds added after each move
     int parallel_games; // 1 = serial
+    int ponder;         // Timed games: think on the opponent's time (players with tree reuse; one extra thread each)
+    MatchStopRule stop; // Early stopping per pair (zeroed: play every game)
+    const OpeningBook *book; // Both sides play its most played move while in book (no search, no clock time)
+    int deterministic;  // Reproducible games: deterministic node searches (players need max_nodes; no clock, no ponder)
+    unsigned seed;      // Deterministic: base of the per-game, per-move search seeds
     
     // Callbacks
     void (*on_start)(int total_matches);
     void (*on_match_start)(int p1, int p2, const char *n1, const char *n2);
     void (*on_game_complete)(const TournamentGameResult *res);
+    void (*on_match_decided)(int p1, int p2, int verdict, double llr); // A stop rule ended the match
     void (*on_match_end)(int p1, int p2, int score1, int score2, int draws); //, const TournamentMatchStats *stats);
     void (*on_tournament_end)(TournamentPlayer *players, int count);
 } TournamentSystemConfig;
@@ -61,6 +101,22 @@ typedef struct {
  */
 void tournament_run(TournamentSystemConfig *cfg);
 
+/**
+ * SPRT log-likelihood ratio of H1 (elo1) against H0 (elo0) after these
+ * games, from p1's side. 0 before any game.
+ */
+double match_sprt_llr(int wins, int losses, int draws, double elo0, double elo1);
+
+/** Elo difference estimate and the half width of its 95% interval. */
+void match_elo_interval(int wins, int losses, int draws, double *elo, double *margin);
+
+/**
+ * Apply rule to a match so far.
+ * @param out_llr Optional: the SPRT LLR (0 without SPRT)
+ * @return A MatchVerdict (MATCH_CONTINUE: play on)
+ */
+int match_stop_check(const MatchStopRule *rule, int wins, int losses, int draws, double *out_llr);
+
 /**
  * Calculates ELO ratings based on match matrix.
  * Helper exposed if needed, but tournament_run calls it automatically.
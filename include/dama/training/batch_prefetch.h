@@ -0,0 +1,56 @@
+/**
+ * batch_prefetch.h - Training Batches Assembled Ahead of the Train Step
+ *
+ * A producer thread pulls batches out of a DatasetStream (block decoding,
+ * window shuffling, copying) into a bounded ring while the caller trains on
+ * the previous one: depth 2 is double buffering, 3 triple buffering.
+ */
+
+#ifndef BATCH_PREFETCH_H
+#define BATCH_PREFETCH_H
+
+#include "dama/training/dataset.h"
+#include <pthread.h>
+
+typedef struct {
+    DatasetStream *stream;
+    int batch_size;
+    int depth;                  // Ring slots (0: synchronous, no thread)
+    TrainingSample *slots;      // max(depth, 1) x batch_size
+    int *sizes;                 // Samples in each slot
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond_filled; // Producer -> consumer
+    pthread_cond_t cond_free;   // Consumer -> producer
+    long filled;                // Batches produced this epoch
+    long consumed;              // Batches handed out this epoch
+    long released;              // Handed out and done with (the last one is in use)
+    int active;                 // Producer is filling the epoch
+    int cancel;                 // Epoch abandoned: stop filling
+    int stop;                   // Shut down the producer
+} BatchPrefetcher;
+
+/**
+ * Batches of batch_size samples from stream, depth of them ahead. The
+ * stream belongs to the prefetcher until batch_prefetch_free.
+ * @return 0 on success, -1 on allocation or thread creation failure.
+ */
+int batch_prefetch_init(BatchPrefetcher *pf, DatasetStream *stream, int batch_size, int depth);
+
+/**
+ * Rewind the stream and start filling a new epoch. The rest of an
+ * unfinished epoch is dropped.
+ */
+void batch_prefetch_start(BatchPrefetcher *pf);
+
+/**
+ * Next batch of the epoch, valid until the next call (its slot is refilled
+ * only then).
+ * @return The batch (*size samples), NULL at the end of the epoch.
+ */
+const TrainingSample* batch_prefetch_next(BatchPrefetcher *pf, int *size);
+
+void batch_prefetch_free(BatchPrefetcher *pf);
+
+#endif // BATCH_PREFETCH_H
@@ -0,0 +1,31 @@
+/**
+ * book_games.h - Opening Book from Selfplay Datasets
+ *
+ * Every sample with a history state is one played move: the move from
+ * history[0] to the sample's position, found among the legal moves of
+ * history[0]. Its result is the game outcome for the side that played it
+ * ((1 - target_value) / 2: target_value belongs to the side to move after
+ * it). Added to a BookBuilder with one visit each, so book_builder_write's
+ * min_visits is the number of games (BOOK_MIN_GAMES).
+ */
+
+#ifndef BOOK_GAMES_H
+#define BOOK_GAMES_H
+
+#include "dama/search/opening_book.h"
+#include <stddef.h>
+
+typedef struct {
+    size_t samples;             // Samples read
+    size_t moves;               // Moves added to the builder
+} BookGamesStats;
+
+/**
+ * Add the opening moves of a dataset (positions before the move with at
+ * least BOOK_GAMES_MIN_PIECES pieces) to b. Samples whose move cannot be
+ * found (not a single move apart) are skipped.
+ * @return 0 on success, -1 on error (logged)
+ */
+int book_add_games(BookBuilder *b, const char *dataset, BookGamesStats *stats);
+
+#endif // BOOK_GAMES_H
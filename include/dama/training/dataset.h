@@ -2,8 +2,10 @@
 #define DATASET_H
 
 #include "dama/engine/game.h"
+#include "dama/common/rng.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 // =============================================================================
 // TRAINING SAMPLE
@@ -17,18 +19,68 @@ typedef struct {
     float target_value;
 } TrainingSample;
 
+/**
+ * 0 for a value-only sample: an all-zero target_policy, which playout-cap
+ * selfplay records for its fast-search moves. Training skips their policy
+ * loss and gradient.
+ */
+static inline int training_sample_has_policy(const TrainingSample *s) {
+    for (int j = 0; j < CNN_POLICY_SIZE; j++) {
+        if (s->target_policy[j] != 0.0f) return 1;
+    }
+    return 0;
+}
+
+/** 1 for an unused history slot (a sample from the start of a game). */
+static inline int training_sample_history_empty(const GameState *slot) {
+    static const GameState empty;
+    return slot->hash == 0 && memcmp(slot->piece, empty.piece, sizeof(slot->piece)) == 0;
+}
+
+/** History slots in use, from history[0] back: the plies of mcts_history_chain. */
+static inline int training_sample_history_plies(const TrainingSample *s) {
+    int plies = 0;
+    while (plies < CNN_HISTORY_T - 1 && !training_sample_history_empty(&s->history[plies])) plies++;
+    return plies;
+}
+
 // =============================================================================
 // DATASET FILE FORMAT
 // =============================================================================
-// Binary file structure:
+// Binary file structure (v2, written by dataset_save / dataset_save_append):
 //   [Header: 12 bytes]
 //     - Magic: "DAMA" (4 bytes)
 //     - Version: uint32_t (4 bytes)
 //     - Sample count: uint32_t (4 bytes)
-//   [Samples: N × sizeof(TrainingSample)]
+//   [Index offset: uint64_t]
+//   [Blocks: up to DATASET_BLOCK_SAMPLES records each, decodable on their own]
+//   [Index: one DatasetBlockEntry per block]
+//
+// Record (variable length, ~80 bytes for a typical position):
+//   - u8 flags: bits 0-1 / 2-3 source of history[0] / [1] (DATASET_HIST_*:
+//     empty, same as the previous record's state / history[0], or stored)
+//   - state: u8 side to move, u8 half-move counter, 4 x u64 bitboards
+//     (white pawn/lady, black pawn/lady)
+//   - explicit history states, same layout as the state
+//   - i16 value (x 32767), u16 policy entries (0: value-only sample), then
+//     (u16 index, u16 fp16 prob) for every nonzero target_policy entry
+// Hashes are not stored: decoding recomputes them (zobrist_init first).
+// Decoding rejects a side to move other than WHITE/BLACK and overlapping
+// bitboards (blocks also arrive from selfplay_net workers).
+//
+// Version 1 (raw TrainingSample structs after the header) is still read, and
+// dataset_save_append keeps appending v1 to a v1 file.
+//
+// Wherever a dataset file is taken (append, count, open), a replay buffer
+// directory (replay_buffer.h) is accepted too.
+
+#define DATASET_MAGIC       "DAMA"
+#define DATASET_VERSION     2
+#define DATASET_VERSION_RAW 1
 
-#define DATASET_MAGIC   "DAMA"
-#define DATASET_VERSION 1
+#define DATASET_HIST_EMPTY    0
+#define DATASET_HIST_PREV     1
+#define DATASET_HIST_EXPLICIT 2
 
 typedef struct {
     char magic[4];
@@ -36,12 +88,18 @@ typedef struct {
     uint32_t num_samples;
 } DatasetHeader;
 
+typedef struct {
+    uint64_t offset;            // From the start of the file
+    uint32_t samples;
+    uint32_t bytes;
+} DatasetBlockEntry;
+
 // =============================================================================
 // DATASET API
 // =============================================================================
 
 /**
- * Save training samples to binary file.
+ * Save training samples to binary file (v2).
  * @param filename Path to output file.
  * @param samples Array of training samples.
  * @param count Number of samples.
@@ -51,8 +109,9 @@ int dataset_save(const char *filename, const TrainingSample *samples, size_t cou
 
 /**
  * Append training samples to an existing dataset file.
- * Updates the header sample count automatically.
- * Creates the file if it doesn't exist.
+ * Updates the header sample count automatically; a v2 file's last block is
+ * re-encoded with the new samples until it is full.
+ * Creates the file (v2) if it doesn't exist.
  */
 int dataset_save_append(const char *filename, const TrainingSample *samples, size_t count);
 
@@ -99,4 +158,116 @@ void dataset_split(TrainingSample *samples, size_t count, float train_ratio,
                    TrainingSample **train_out, TrainingSample **val_out,
                    size_t *train_count, size_t *val_count);
 
+// =============================================================================
+// BLOCK CODEC (v2 records, e.g. to ship samples over the network)
+// =============================================================================
+
+/** Upper bound on the encoded size of n samples. */
+size_t dataset_block_max_bytes(size_t n);
+
+/**
+ * Encode n samples as one v2 block (records above; history references only
+ * point inside the block). out holds dataset_block_max_bytes(n).
+ * @return Bytes written.
+ */
+size_t dataset_encode_block(const TrainingSample *samples, size_t n, unsigned char *out);
+
+/**
+ * Decode a v2 block of exactly n records and bytes bytes (zobrist_init first).
+ * @return 0 on success, -1 if malformed.
+ */
+int dataset_decode_block(const unsigned char *p, size_t bytes, size_t n, TrainingSample *out);
+
+// =============================================================================
+// STREAMING ACCESS (MAPPED FILE, LARGER-THAN-RAM DATASETS)
+// =============================================================================
+
+/**
+ * Read-only mapping of a dataset file: opening costs the header (and the v2
+ * block index), not the samples, and only the pages actually read become
+ * resident. Samples are read block by block: DATASET_BLOCK_SAMPLES-sample
+ * slices of a v1 file, the encoded blocks of a v2 one.
+ */
+typedef struct {
+    uint32_t version;
+    size_t count;
+    const unsigned char *data;  // v1: first sample (12-byte header: not aligned)
+    DatasetBlockEntry *blocks;  // v2: block index (copied out of the mapping)
+    size_t *block_first;        // v2: first sample of each block, then count
+    size_t n_blocks;
+    void *mapping;
+    size_t mapping_bytes;
+} DatasetView;
+
+/**
+ * Map a dataset file (v1 or v2). A v1 file shorter than its header count is
+ * clamped to the whole samples present; a v2 index that does not match the
+ * header or the file is rejected.
+ * @return 0 on success, -1 on error (view zeroed).
+ */
+int dataset_open(const char *filename, DatasetView *view);
+
+/**
+ * Map n v2 files back to back as one view (samples in file order), e.g.
+ * the segments of a replay buffer. n == 0 gives an empty view.
+ * @return 0 on success, -1 on error (view zeroed).
+ */
+int dataset_open_segments(const char *const *filenames, size_t n, DatasetView *view);
+
+void dataset_close(DatasetView *view);
+
+/** First sample and sample count of block b. */
+void dataset_view_block(const DatasetView *view, size_t b, size_t *first, size_t *count);
+
+/**
+ * Decode block b to out (room for DATASET_BLOCK_SAMPLES samples).
+ * @return Samples decoded, or -1 if the block is corrupt.
+ */
+int dataset_view_read_block(const DatasetView *view, size_t b, TrainingSample *out);
+
+/**
+ * Copy samples [first, first + count) of the view to out.
+ * @return 0 on success, -1 on a corrupt block or allocation failure.
+ */
+int dataset_view_read(const DatasetView *view, size_t first, size_t count, TrainingSample *out);
+
+/** Bytes per sample on disk (header and index included). */
+double dataset_view_bytes_per_sample(const DatasetView *view);
+
+/**
+ * Batches from a sample range of a view, in shuffled block order: the view's
+ * blocks covering the range are taken in a random order each epoch,
+ * DATASET_SHUFFLE_BLOCKS of them are read into a window and shuffled
+ * together. Resident memory is the window, whatever the file size.
+ * Without shuffling the range is read in order (validation).
+ */
+typedef struct {
+    const DatasetView *view;
+    size_t first, count;        // Streamed sample range
+    int shuffle;
+    RNG rng;
+    size_t block_lo;            // First view block of the range
+    size_t *order;              // Block order of the current epoch (from block_lo)
+    size_t n_blocks, next_block;
+    TrainingSample *window;     // Up to DATASET_SHUFFLE_BLOCKS blocks
+    size_t window_count, window_pos;
+} DatasetStream;
+
+/**
+ * @return 0 on success, -1 on allocation failure.
+ */
+int dataset_stream_init(DatasetStream *s, const DatasetView *view, size_t first, size_t count,
+                        int shuffle, uint32_t seed);
+
+/** Start a new epoch (new block order when shuffling). */
+void dataset_stream_rewind(DatasetStream *s);
+
+/**
+ * Copy the next (up to) max samples of the epoch to out.
+ * @return Samples copied, 0 at the end of the epoch.
+ */
+size_t dataset_stream_next(DatasetStream *s, TrainingSample *out, size_t max);
+
+void dataset_stream_free(DatasetStream *s);
+
 #endif // DATASET_H
@@ -11,6 +11,8 @@
 typedef struct {
     int count;
     float file_size_mb;
+    int format_version;         // DATASET_VERSION or DATASET_VERSION_RAW
+    float bytes_per_sample;
     
     // Value stats
     int wins;
@@ -28,6 +30,8 @@ typedef struct {
     float avg_max_prob;
     int sharp_policies; // > 50%
     float sharp_ratio_pct;
+    int value_only;     // No policy target (playout-cap fast searches)
+    float value_only_pct;
     
     // Occupancy
     float avg_pieces;
@@ -46,16 +50,21 @@ typedef struct {
     int piece_histogram[25];  // 1-24
     int buckets[6];           // Grouped histogram: 1-4, 5-8...
     
-    // Duplicates
+    // Duplicates (estimated: HyperLogLog count of distinct hashes, ~1%)
     int duplicates;
     int duplicates_checked; // boolean
     float duplicate_ratio_pct;
 } DatasetStats;
 
 /**
- * Analyze a dataset file and populate the stats structure.
+ * Analyze a dataset file (or replay buffer) and populate the stats
+ * structure: one streamed pass, blocks split across the OpenMP threads,
+ * memory bounded by one block per thread whatever the dataset size.
+ * on_progress (may be NULL) is called from the calling thread about every
+ * percent of samples, and once at the end.
  * Returns 0 on success, non-zero on error.
  */
-int dataset_analyze(const char *path, DatasetStats *stats);
+int dataset_analyze(const char *path, DatasetStats *stats,
+                    void (*on_progress)(size_t done, size_t total));
 
 #endif // DATASET_ANALYSIS_H
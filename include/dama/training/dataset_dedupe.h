@@ -0,0 +1,32 @@
+/**
+ * dataset_dedupe.h - Out-of-Core Deduplication of Training Data
+ *
+ * Partitioned by Zobrist hash: the inputs are streamed block by block into
+ * partition files (hash-disjoint, small enough to fit in memory), the
+ * partitions are deduplicated in parallel, and the results are merged back
+ * in input order. Duplicate positions become one sample (the first
+ * occurrence's state and history) with the averaged policy and value
+ * targets. Memory stays at one partition per thread plus one decoded block
+ * per partition, whatever the input size.
+ */
+
+#ifndef DATASET_DEDUPE_H
+#define DATASET_DEDUPE_H
+
+#include "dama/training/dataset.h"
+
+typedef struct {
+    size_t input;               // Samples read
+    size_t unique;              // Samples written
+    int partitions;
+} DedupeStats;
+
+/**
+ * Deduplicate the concatenation of the inputs (files or replay buffers)
+ * into output (v2, replaced). Temporary partition files are written next
+ * to output and removed.
+ * @return 0 on success, -1 on error.
+ */
+int dataset_dedupe(const char *const *inputs, int n_inputs, const char *output, DedupeStats *stats);
+
+#endif // DATASET_DEDUPE_H
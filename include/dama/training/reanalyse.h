@@ -0,0 +1,44 @@
+/**
+ * reanalyse.h - Fresh Search Targets for Stored Positions
+ *
+ * Old samples carry policy targets from the network that played them.
+ * Reanalysis streams a dataset block by block, searches every position
+ * again with the current network (the games' history states included,
+ * no Dirichlet noise) and rewrites target_policy with the new visit
+ * distribution. Value-only samples get a policy too. target_value is kept,
+ * or blended with the search's root value.
+ *
+ * The positions of a block are searched in parallel, one per thread, with
+ * their leaves batched across searches by one shared InferenceServer (as
+ * the games of a selfplay run), and blocks are written in input order.
+ */
+
+#ifndef REANALYSE_H
+#define REANALYSE_H
+
+#include "dama/training/dataset.h"
+#include "dama/search/mcts.h"
+
+typedef struct {
+    int threads;                // Positions searched at once (0: OpenMP default)
+    float value_blend;          // target_value = (1 - b) * outcome + b * root value
+    void (*on_progress)(size_t done, size_t total);  // Calling thread, once per block (may be NULL)
+} ReanalyseConfig;
+
+typedef struct {
+    size_t samples;             // Samples written
+    size_t searched;            // Positions given a new policy
+    size_t filled;              // Of which value-only before
+    double policy_shift;        // Mean total variation old -> new (samples that had a policy)
+} ReanalyseStats;
+
+/**
+ * Reanalyse input (file or replay buffer) into output (v2 file, replaced
+ * when complete; may be the input file). mcts_cfg supplies the network
+ * (cnn_weights) and the node budget (max_nodes).
+ * @return 0 on success, -1 on error (output untouched).
+ */
+int dataset_reanalyse(const char *input, const char *output, const ReanalyseConfig *cfg,
+                      const MCTSConfig *mcts_cfg, ReanalyseStats *stats);
+
+#endif // REANALYSE_H
@@ -0,0 +1,71 @@
+/**
+ * replay_buffer.h - Rolling Replay Buffer of Training Samples
+ *
+ * A directory of v2 dataset segments (seg_<id>.bin, up to segment_samples
+ * samples each) and an index naming the live ones, oldest first. Appends go
+ * to the newest segment, or a new one when it is full; then the oldest
+ * segments are deleted as long as the others still hold window samples.
+ * No operation rewrites more than the newest segment's last block.
+ *
+ * The dataset API takes the directory wherever it takes a file:
+ * dataset_save_append appends, dataset_get_count counts, and dataset_open
+ * maps the live segments as one view, so training streams (and shuffles
+ * blocks) uniformly across all of them.
+ */
+
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include "dama/training/dataset.h"
+#include <stdint.h>
+
+#define REPLAY_MAGIC        "DRPL"
+#define REPLAY_VERSION      2
+#define REPLAY_INDEX_FILE   "index.bin"
+
+// index.bin: a ReplayIndex, then one u32 sample count per sealed segment
+// (every live one but the newest), oldest first, so that appending and
+// evicting never open the older segments. Version 1 (the header without
+// sealed_samples, no counts) is still read and rewritten as version 2.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t first_segment;     // Oldest live segment id
+    uint32_t next_segment;      // One past the newest
+    uint32_t segment_samples;   // Segment capacity
+    uint32_t reserved;
+    uint64_t window;            // Samples kept (0: all)
+    uint64_t sealed_samples;    // Samples in the sealed segments
+} ReplayIndex;
+
+/** 1 if path is a replay buffer directory (has a valid index). */
+int replay_is_buffer(const char *path);
+
+/** Configuration and segment range of dir. @return 0, or -1 if not a replay buffer. */
+int replay_read_index(const char *dir, ReplayIndex *index);
+
+/**
+ * Create a replay buffer in dir (created if missing), or reconfigure an
+ * existing one and evict down to the new window.
+ * @param segment_samples  0: REPLAY_SEGMENT_SAMPLES, or keep the current one
+ * @param window           Samples kept (0: all)
+ * @return 0 on success, -1 on error.
+ */
+int replay_create(const char *dir, size_t segment_samples, size_t window);
+
+/**
+ * Append samples, then evict whole oldest segments beyond the window.
+ * @return 0 on success, -1 on error.
+ */
+int replay_append(const char *dir, const TrainingSample *samples, size_t count);
+
+/** Delete every segment; the configuration is kept. */
+int replay_clear(const char *dir);
+
+/** Samples in the live segments, -1 on error. */
+long replay_count(const char *dir);
+
+/** Map the live segments, oldest first, as one view (dataset_close it). */
+int replay_open(const char *dir, DatasetView *view);
+
+#endif // REPLAY_BUFFER_H
@@ -0,0 +1,73 @@
+/**
+ * sample_writer.h - Buffered Background Writer of Self-Play Samples
+ *
+ * Game threads push finished games onto a lock-free queue and go back to
+ * playing; one writer thread collects them and appends them to the output
+ * (file or replay buffer) in large block-aligned writes, so the v2 index is
+ * rewritten once per flush instead of once per game. Whatever is buffered
+ * is also written every interval, and all of it at close. Instead of a
+ * path, the writes can go to a sink function (a network collector).
+ */
+
+#ifndef SAMPLE_WRITER_H
+#define SAMPLE_WRITER_H
+
+#include "dama/training/dataset.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef struct SampleChunk {
+    struct SampleChunk *next;
+    size_t count;
+    TrainingSample samples[];
+} SampleChunk;
+
+typedef int (*SampleSink)(void *ctx, const TrainingSample *samples, size_t count);
+
+typedef struct {
+    char path[512];
+    SampleSink sink;                // Called with each write (writer thread), 0 on success
+    void *sink_ctx;
+    size_t flush_samples;           // Buffered samples that trigger a write
+    int interval_ms;                // Longest a pushed sample waits for its write
+
+    _Atomic(SampleChunk*) pending;  // Pushed chunks, newest first
+    atomic_size_t queued;           // Samples pushed since the writer last drained
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;            // Producers -> writer: flush_samples queued, or stop
+    int stop;
+
+    TrainingSample *buffer;         // Drained, not yet written (writer thread only)
+    size_t buffered, capacity;
+    size_t written;
+    int failed;                     // A write failed; later samples are dropped
+} SampleWriter;
+
+/**
+ * Start a writer appending to path.
+ * @param flush_samples  0: SELFPLAY_WRITE_SAMPLES
+ * @param interval_ms    0: SELFPLAY_WRITE_INTERVAL_MS
+ * @return 0 on success, -1 on allocation or thread creation failure.
+ */
+int sample_writer_open(SampleWriter *w, const char *path, size_t flush_samples, int interval_ms);
+
+/** Same, writing through sink(ctx, ...) instead of appending to a path. */
+int sample_writer_open_sink(SampleWriter *w, SampleSink sink, void *ctx,
+                            size_t flush_samples, int interval_ms);
+
+/**
+ * Queue a copy of samples (one game, kept contiguous and in order).
+ * Thread-safe and lock-free except when it wakes the writer.
+ * @return 0 on success, -1 on allocation failure (the samples are dropped).
+ */
+int sample_writer_push(SampleWriter *w, const TrainingSample *samples, size_t count);
+
+/**
+ * Write everything queued and stop the writer.
+ * @return 0 if every write succeeded, -1 otherwise.
+ */
+int sample_writer_close(SampleWriter *w);
+
+#endif // SAMPLE_WRITER_H
@@ -3,6 +3,7 @@
 
 #include "dama/search/mcts.h"
 #include "dama/neural/cnn.h"
+#include "dama/training/sample_writer.h"
 
 // =============================================================================
 // CONFIGURATION
@@ -14,11 +15,18 @@ typedef struct {
     double time_limit;    // Per move
     float temp;           // Temperature
     const char *output_file;
+    SampleSink sink;      // If set, samples go here instead of output_file (e.g. a collector)
+    void *sink_ctx;
     int parallel_threads;
     
     int overwrite_data;   // If 1, overwrites output file; else appends
     float endgame_prob;   // Probability of starting from endgame (0.0-1.0)
     
+    // Playout cap randomization: a share of the moves get the full search and
+    // a policy target, the rest a fast search and a value-only sample
+    int fast_nodes;           // Node budget of the fast searches (0: off, every move full)
+    float full_search_prob;   // Share of full searches (0.0-1.0)
+    
     // Callbacks
     void (*on_start)(int total_games);
     void (*on_game_complete)(int game_idx, int total_games, int winner, int moves, int reason);
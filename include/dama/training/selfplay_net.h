@@ -0,0 +1,129 @@
+/**
+ * selfplay_net.h - Distributed Self-Play: Workers and a Sample Collector
+ *
+ * The collector listens on TCP, serves the current model file and appends
+ * the samples it receives to a dataset file or replay buffer (through a
+ * SampleWriter, so connections never wait on the disk). Workers play
+ * selfplay_run rounds on their own machines, stream each round's samples to
+ * the collector as v2 blocks while they play, and between rounds ask for
+ * the model: when training has published a new one (the file changed), they
+ * load it before the next round.
+ *
+ * Protocol: every message is a NetFrame followed by `bytes` of payload, in
+ * host byte order like the dataset files (homogeneous cluster). One request
+ * at a time per connection, each answered before the next:
+ *   NET_MODEL_QUERY  u64 id of the worker's model (0: none)
+ *     -> NET_MODEL   u64 id, then the model file (empty if the id matches
+ *                    or the collector has no model)
+ *   NET_SAMPLES      u32 count, then a v2 block of count records
+ *     -> NET_ACK     u32 0 (queued for writing) or 1 (rejected)
+ */
+
+#ifndef SELFPLAY_NET_H
+#define SELFPLAY_NET_H
+
+#include "dama/training/sample_writer.h"
+#include "dama/training/selfplay.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define NET_MAGIC   "DSPN"
+
+enum { NET_MODEL_QUERY = 1, NET_MODEL = 2, NET_SAMPLES = 3, NET_ACK = 4 };
+
+typedef struct {
+    char magic[4];
+    uint32_t type;
+    uint64_t bytes;             // Payload that follows
+} NetFrame;
+
+// =============================================================================
+// COLLECTOR
+// =============================================================================
+
+typedef struct {
+    int listen_fd;
+    int port;                   // Bound port (an ephemeral one if 0 was asked)
+    char model_path[512];
+    size_t max_samples;         // collector_run returns after this many (0: never)
+    SampleWriter writer;
+
+    pthread_mutex_t lock;       // Model cache and connection count
+    pthread_cond_t cond;        // A connection ended
+    int connections;
+    unsigned char *model;       // Cached model file, reloaded when it changes
+    size_t model_bytes;
+    uint64_t model_id;          // Hash of the file (0: none)
+    ino_t model_ino;
+    off_t model_size;
+    time_t model_mtime;
+
+    atomic_size_t received;
+    atomic_int stop;
+} Collector;
+
+/**
+ * Listen on bind_addr:port and open data (file or replay buffer) for
+ * appending. The protocol has no authentication: bind_addr NULL binds
+ * NET_COLLECTOR_BIND (loopback); remote workers need an explicit address,
+ * e.g. "0.0.0.0" (all IPv4 interfaces) or "::" (all, IPv6 and IPv4).
+ * port 0 takes any free one. model_path is read on demand and may not
+ * exist yet.
+ * @return 0 on success, -1 on failure.
+ */
+int collector_open(Collector *c, const char *bind_addr, int port, const char *data, const char *model_path,
+                   size_t max_samples);
+
+/**
+ * Serve workers until collector_stop or max_samples received; then wait
+ * for the connections to end and flush the samples.
+ * @return 0 if every sample was written, -1 otherwise.
+ */
+int collector_run(Collector *c);
+
+/** Make collector_run return (any thread, or a signal handler). */
+void collector_stop(Collector *c);
+
+void collector_close(Collector *c);
+
+// =============================================================================
+// WORKER
+// =============================================================================
+
+typedef struct {
+    int fd;
+    uint64_t model_id;          // Model last received (0: none, the next fetch sends it)
+    int failed;                 // A send failed: reconnect before the next round
+} CollectorClient;
+
+/** host: name or IPv4/IPv6 address. @return 0 on success, -1 if host:port cannot be reached. */
+int collector_client_connect(CollectorClient *cl, const char *host, int port);
+
+/**
+ * Ask for the collector's model; a newer one is written to path (replaced
+ * atomically).
+ * @return 1 if path was updated, 0 if unchanged (or none served), -1 on error.
+ */
+int collector_client_fetch_model(CollectorClient *cl, const char *path);
+
+/** Send samples (DATASET_BLOCK_SAMPLES per frame), each frame acknowledged. */
+int collector_client_send(CollectorClient *cl, const TrainingSample *samples, size_t count);
+
+void collector_client_close(CollectorClient *cl);
+
+/**
+ * Worker loop: connect (retrying every NET_RETRY_SECONDS), fetch the model
+ * into model_path and load it into weights (which mcts_cfg searches with),
+ * play a round of sp_cfg->games games streamed to the collector, repeat.
+ * Until the collector serves a model, weights are used as they are.
+ * Returns after `rounds` rounds (0: never) or once *stop is set.
+ */
+void selfplay_worker_run(const char *host, int port, const char *model_path, int rounds,
+                         const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg,
+                         CNNWeights *weights, volatile sig_atomic_t *stop);
+
+#endif // SELFPLAY_NET_H
@@ -14,6 +14,7 @@ typedef struct {
     const char *model_path; // Path to save best model (or NULL)
     const char *backup_path; // Path to save backup model (or NULL)
     int num_threads;
+    int prefetch_depth;     // Batches assembled ahead by a producer thread (0: synchronous)
     
     // Callbacks
     void (*on_init)(int total_samples, int validation_samples);
@@ -27,7 +28,9 @@ typedef struct {
 
 /**
  * Runs the training loop.
- * Loads data, splits validation, runs epochs with SGD and validation.
+ * Maps data, holds out the last 10% for validation, runs epochs with SGD
+ * (batches streamed in shuffled block order, prefetched while the previous
+ * one trains) and validation.
  */
 void training_run(CNNWeights *weights, const TrainingPipelineConfig *cfg);
 
@@ -33,6 +33,11 @@ typedef struct {
 /**
  * CLOP optimizer state.
  * Maintains samples, outcomes, and the fitted quadratic model.
+ *
+ * Every suggestion stays pending until its result arrives through
+ * clop_update (in any order). While pending it enters the model fit at the
+ * mean observed outcome, so suggestions made before it returns move away
+ * from it instead of repeating it.
  */
 typedef struct {
     int num_params;
@@ -49,6 +54,17 @@ typedef struct {
     int num_samples;
     int max_samples;
     
+    // Suggestions not yet evaluated
+    double *pending;       // [max_samples * num_params] - flattened
+    int num_pending;
+    
+    // Normal equations of the fit over the samples, one rank-1 update each
+    // (k = 1 + n + n*(n+1)/2 coefficients)
+    double *normal;        // [k * k] Σ r rᵀ over design rows r - upper triangle, column-major
+    double *rhs;           // [k] Σ outcome * r
+    double sum_outcomes;
+    double *row;           // [k] scratch design row
+    
     // Quadratic model: f(x) = c + Σ l_i*x_i + Σ q_ij*x_i*x_j
     double constant;
     double *linear;        // [num_params]
@@ -79,15 +95,17 @@ int clop_init(CLOPState *state, const CLOPParamDef *param_defs,
 /**
  * Suggest next parameter values to evaluate.
  * Uses the quadratic model to find promising regions.
+ * The suggestion is pending until clop_update or clop_cancel.
  * 
  * @param state      CLOP state
  * @param params_out Output array for suggested parameters [num_params]
- * @return 0 on success, -1 on error
+ * @return 0 on success, -1 on error (or samples plus pending at max_samples)
  */
 int clop_suggest(CLOPState *state, double *params_out);
 
 /**
  * Update CLOP with a new sample.
+ * Clears the matching pending suggestion, if any.
  * 
  * @param state   CLOP state
  * @param params  Parameters that were evaluated [num_params]
@@ -96,6 +114,13 @@ int clop_suggest(CLOPState *state, double *params_out);
  */
 int clop_update(CLOPState *state, const double *params, double outcome);
 
+/**
+ * Drop a pending suggestion that will not be evaluated.
+ * 
+ * @return 0 on success, -1 if params is not pending
+ */
+int clop_cancel(CLOPState *state, const double *params);
+
 /**
  * Get the best parameters found so far.
  * 
@@ -109,6 +134,11 @@ void clop_get_best(const CLOPState *state, double *params_out);
  */
 int clop_get_num_samples(const CLOPState *state);
 
+/**
+ * Get current number of pending suggestions.
+ */
+int clop_get_num_pending(const CLOPState *state);
+
 /**
  * Free CLOP resources.
  */
@@ -4,17 +4,24 @@
 #
 # Logic:
 # 1. Self-Play: Generate 500 games with current BEST model
-# 2. Window: Trim active.dat to last 25,000 games
+# 2. Window: the replay buffer keeps the last ~25,000 games (oldest segments dropped)
 # 3. Train: Train CANDIDATE model on window
 # 4. Evaluate: Tournament CANDIDATE vs BEST (100 games)
 # 5. Promote: If CANDIDATE wins >= 55%, it becomes BEST
+#
+# Distributed: with COLLECTOR_PORT set, step 1 collects SAMPLES_PER_LOOP
+# samples from remote workers instead of playing locally. The collector
+# listens on COLLECTOR_BIND (default loopback: set e.g. 0.0.0.0 on a trusted
+# network, the protocol is unauthenticated). Start the workers with
+#   ./bin/dama train --worker <this host>:$COLLECTOR_PORT --nodes $NODES
+# they pick up BEST_MODEL again after every promotion.
 
 set -e
 
 # ==============================================================================
 # CONFIGURATION (SCALED)
 # ==============================================================================
-DATA_FILE="out/data/active.dat"
+DATA_FILE="out/data/replay" # Replay buffer directory (dama data replay)
 BEST_MODEL="out/models/best.bin"
 CANDIDATE_MODEL="out/models/candidate.bin"
 LOG_DIR="out/logs"
@@ -24,6 +31,11 @@ GAMES_PER_LOOP=500
 WORKERS=8 # M2 CPU cores
 NODES=800
 
+# Distributed generation (empty: local self-play)
+COLLECTOR_PORT="${COLLECTOR_PORT:-}"
+COLLECTOR_BIND="${COLLECTOR_BIND:-127.0.0.1}"
+SAMPLES_PER_LOOP=30000 # ~500 games
+
 # Window (Memory for Small Net)
 # 25,000 games * ~60 moves = 1.5M samples
 WINDOW_SIZE=1500000 
@@ -41,6 +53,7 @@ WIN_THRESHOLD=55 # 55% wins required
 # SETUP
 # ==============================================================================
 mkdir -p out/data out/models out/logs
+./bin/dama data replay "$DATA_FILE" --window $WINDOW_SIZE
 
 echo "================================================================================"
 echo "  DAMA ZERO - SCALED TRAINING LOOP"
@@ -71,22 +84,33 @@ while true; do
 
     # 1. SELF-PLAY
     # -----------------------
-    echo "> Generating $GAMES_PER_LOOP games (Best Model)..."
-    ./bin/dama train \
-        --selfplay \
-        --games $GAMES_PER_LOOP \
-        --nodes $NODES \
-        --temp 1.0 \
-        --data "$DATA_FILE" \
-        --weights "$BEST_MODEL" \
-        --threads $WORKERS \
-        --endgame-prob 0.1 \
-        | tee -a "$LOG_DIR/selfplay_loop${LOOP_COUNT}.log"
+    if [ -n "$COLLECTOR_PORT" ]; then
+        echo "> Collecting $SAMPLES_PER_LOOP samples from workers on port $COLLECTOR_PORT..."
+        ./bin/dama collect \
+            --port $COLLECTOR_PORT \
+            --bind "$COLLECTOR_BIND" \
+            --data "$DATA_FILE" \
+            --weights "$BEST_MODEL" \
+            --samples $SAMPLES_PER_LOOP \
+            | tee -a "$LOG_DIR/selfplay_loop${LOOP_COUNT}.log"
+    else
+        echo "> Generating $GAMES_PER_LOOP games (Best Model)..."
+        ./bin/dama train \
+            --selfplay \
+            --games $GAMES_PER_LOOP \
+            --nodes $NODES \
+            --temp 1.0 \
+            --data "$DATA_FILE" \
+            --weights "$BEST_MODEL" \
+            --threads $WORKERS \
+            --endgame-prob 0.1 \
+            | tee -a "$LOG_DIR/selfplay_loop${LOOP_COUNT}.log"
+    fi
 
     # 2. WINDOW MANAGEMENT
     # -----------------------
-    echo "> Managing Window (Limit $WINDOW_SIZE samples)..."
-    ./bin/dama data trim "$DATA_FILE" $WINDOW_SIZE
+    # Self-play appends already evicted the segments beyond the window
+    echo "> Window: $(./bin/dama data inspect "$DATA_FILE" | grep Samples)"
 
     # 3. TRAINING CANDIDATE
     # -----------------------
@@ -147,7 +171,8 @@ while true; do
     # -----------------------
     if [ "$P1_WINS" -ge "$WIN_THRESHOLD" ]; then
         echo ">>> PROMOTION! Candidate ($P1_WINS wins) replaces Best."
-        cp "$CANDIDATE_MODEL" "$BEST_MODEL"
+        # Replaced in one rename: a collector never serves a half-copied file
+        cp "$CANDIDATE_MODEL" "$BEST_MODEL.tmp" && mv "$BEST_MODEL.tmp" "$BEST_MODEL"
         
         # Save historical checkpoint
         cp "$BEST_MODEL" "out/models/gen_${LOOP_COUNT}_wins_${P1_WINS}.bin"
@@ -0,0 +1,176 @@
+/**
+ * affinity.c - CPU Affinity and NUMA Placement
+ *
+ * Contains: topology from sysfs (allowed CPUs and their NUMA nodes), the
+ * slot -> CPU order of each policy, pinning of game and helper threads
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "dama/common/affinity.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+#define AFFINITY_MAX_CPUS   1024
+
+static AffinityPolicy policy = AFFINITY_NONE;
+
+int affinity_parse(const char *name, AffinityPolicy *out) {
+    if (strcmp(name, "none") == 0) *out = AFFINITY_NONE;
+    else if (strcmp(name, "compact") == 0) *out = AFFINITY_COMPACT;
+    else if (strcmp(name, "scatter") == 0) *out = AFFINITY_SCATTER;
+    else return 0;
+    return 1;
+}
+
+AffinityPolicy affinity_get_policy(void) { return policy; }
+
+#ifdef __linux__
+
+// =============================================================================
+// TOPOLOGY
+// =============================================================================
+
+static cpu_set_t allowed;                   // CPUs the process started with
+static int num_cpus;                        // Allowed CPUs
+static int num_nodes = 1;
+static int cpus[AFFINITY_MAX_CPUS];         // Allowed CPUs by node, then number
+static int node_start[AFFINITY_MAX_CPUS];   // Where each node begins in cpus[]
+static int node_size[AFFINITY_MAX_CPUS];
+static int cpu_node[AFFINITY_MAX_CPUS];     // CPU -> NUMA node
+static int slot_cpu[AFFINITY_MAX_CPUS];     // Game slot -> CPU, in policy order
+
+// The cpuN/nodeM link sysfs keeps for every CPU (0 without NUMA support)
+static int read_cpu_node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    int node = 0;
+    struct dirent *e;
+    while ((e = readdir(dir))) {
+        if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+            node = atoi(e->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+static int by_node_then_cpu(const void *pa, const void *pb) {
+    int a = *(const int*)pa, b = *(const int*)pb;
+    if (cpu_node[a] != cpu_node[b]) return cpu_node[a] - cpu_node[b];
+    return a - b;
+}
+
+// Once, before any thread is pinned: the process mask is the allowed set
+static void read_topology(void) {
+    static int done = 0;
+    if (done) return;
+    done = 1;
+
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    for (int c = 0; c < AFFINITY_MAX_CPUS && c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &allowed)) continue;
+        cpu_node[c] = read_cpu_node(c);
+        cpus[num_cpus++] = c;
+    }
+    qsort(cpus, num_cpus, sizeof(int), by_node_then_cpu);
+
+    num_nodes = 0;
+    for (int i = 0; i < num_cpus; i++) {
+        if (i == 0 || cpu_node[cpus[i]] != cpu_node[cpus[i - 1]]) {
+            node_start[num_nodes] = i;
+            node_size[num_nodes++] = 0;
+        }
+        node_size[num_nodes - 1]++;
+    }
+    if (num_nodes == 0) num_nodes = 1;
+}
+
+void affinity_set_policy(AffinityPolicy p) {
+    policy = p;
+    if (p == AFFINITY_NONE) return;
+    read_topology();
+    if (num_cpus == 0) {
+        log_warn("[Affinity] Cannot read the allowed CPUs, threads are not pinned");
+        policy = AFFINITY_NONE;
+        return;
+    }
+
+    // Compact: the sorted list. Scatter: one CPU from each node in turn
+    if (p == AFFINITY_COMPACT) {
+        memcpy(slot_cpu, cpus, num_cpus * sizeof(int));
+    } else {
+        int n = 0;
+        for (int round = 0; n < num_cpus; round++) {
+            for (int k = 0; k < num_nodes; k++) {
+                if (round < node_size[k]) slot_cpu[n++] = cpus[node_start[k] + round];
+            }
+        }
+    }
+}
+
+int affinity_num_nodes(void) {
+    return num_nodes;
+}
+
+// =============================================================================
+// PINNING
+// =============================================================================
+
+int affinity_pin_slot(int slot) {
+    if (policy == AFFINITY_NONE || slot < 0) return -1;
+    const int cpu = slot_cpu[slot % num_cpus];
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    return sched_setaffinity(0, sizeof(one), &one) == 0 ? cpu : -1;
+}
+
+void affinity_unpin(void) {
+    if (policy == AFFINITY_NONE) return;
+    sched_setaffinity(0, sizeof(allowed), &allowed);
+}
+
+int affinity_helper_attr(pthread_attr_t *attr) {
+    if (policy == AFFINITY_NONE) return 0;
+    const int cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= AFFINITY_MAX_CPUS || !CPU_ISSET(cpu, &allowed)) return 0;
+
+    cpu_set_t node;
+    CPU_ZERO(&node);
+    for (int c = 0; c < AFFINITY_MAX_CPUS && c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, &allowed) && cpu_node[c] == cpu_node[cpu]) CPU_SET(c, &node);
+    }
+    if (pthread_attr_init(attr) != 0) return 0;
+    if (pthread_attr_setaffinity_np(attr, sizeof(node), &node) != 0) {
+        pthread_attr_destroy(attr);
+        return 0;
+    }
+    return 1;
+}
+
+#else
+
+void affinity_set_policy(AffinityPolicy p) {
+    if (p != AFFINITY_NONE) log_warn("[Affinity] Thread pinning needs Linux, threads are not pinned");
+}
+
+int affinity_num_nodes(void) { return 1; }
+int affinity_pin_slot(int slot) { (void)slot; return -1; }
+void affinity_unpin(void) {}
+int affinity_helper_attr(pthread_attr_t *attr) { (void)attr; return 0; }
+
+#endif
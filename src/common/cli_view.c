@@ -5,10 +5,12 @@
  * - Self-play generation
  * - Training configuration
  * - Training results
+ * - Search phase profile
  */
 
 #include "dama/common/cli_view.h"
 #include "dama/common/logging.h"
+#include "dama/common/math_backend.h"
 #include <stdio.h>
 
 // =============================================================================
@@ -25,6 +27,12 @@ void cli_view_print_selfplay(const SelfplayView *view) {
     log_printf("├────────────────────────────────────────────────────────────────────┤\n");
     log_printf("│  MCTS Nodes   : %-4d (Symmetric)                                   │\n", 
                view->mcts_nodes);
+    if (view->fast_nodes > 0) {
+        char cap_buf[64];
+        snprintf(cap_buf, sizeof(cap_buf), "%.0f%% full, else %d nodes (value only)",
+                 view->full_search_prob * 100.0f, view->fast_nodes);
+        log_printf("│  Playout Cap  : %-50s │\n", cap_buf);
+    }
     log_printf("│  Dirichlet    : α=%.2f, ε=%.2f (first 30 moves)                    │\n", 
                view->dirichlet_alpha, view->dirichlet_epsilon);
     log_printf("│  Temperature  : %.1f → 0.05 (after move %d)                         │\n", 
@@ -44,7 +52,7 @@ void cli_view_print_selfplay(const SelfplayView *view) {
     log_printf("│  Max Moves    : %d (or 150 with mercy)                             │\n", view->max_moves);
     log_printf("├────────────────────────────────────────────────────────────────────┤\n");
     log_printf("│  OMP Threads  : %-2d                                                 │\n", view->omp_threads);
-    log_printf("│  Backend      : Apple Accelerate (BLAS/vDSP)                       │\n");
+    log_printf("│  Backend      : %-50s │\n", math_backend_name());
     log_printf("└────────────────────────────────────────────────────────────────────┘\n\n");
 }
 
@@ -69,7 +77,7 @@ void cli_view_print_training_config(const TrainingConfigView *view) {
     log_printf("│  Rewards      : Checkmate ±1.0 │ Mercy ±0.7 │ Draw 0.0             │\n");
     log_printf("│  Canonical    : Board flipped for Black (always \"my turn\")         │\n");
     log_printf("├────────────────────────────────────────────────────────────────────┤\n");
-    log_printf("│  OMP Threads  : %-2d               Backend: Apple Accelerate         │\n", view->omp_threads);
+    log_printf("│  OMP Threads  : %-2d               Backend: %-24s │\n", view->omp_threads, math_backend_name());
     log_printf("└────────────────────────────────────────────────────────────────────┘\n\n");
     
     log_printf("+-------+---------------------------+---------------------------+------------+\n");
@@ -104,7 +112,8 @@ void cli_view_print_dataset_stats(const DatasetStatsView *view) {
     log_printf("File: %s\n\n", view->path);
     
     log_printf("Samples:    %s\n", format_num(view->count));
-    log_printf("File size:  %.2f MB\n\n", view->file_size_mb);
+    log_printf("File size:  %.2f MB\n", view->file_size_mb);
+    log_printf("Format:     v%d (%.0f B/sample)\n\n", view->format_version, view->bytes_per_sample);
     
     log_printf("=== Value Distribution ===\n");
     log_printf("  Wins:   %s (%.1f%%)\n", format_num(view->wins), 100.0f * view->wins / view->count);
@@ -113,6 +122,10 @@ void cli_view_print_dataset_stats(const DatasetStatsView *view) {
     log_printf("\n  Mean: %.4f | Min: %.4f | Max: %.4f\n", view->val_mean, view->val_min, view->val_max);
     
     log_printf("\n=== Policy Stats ===\n");
+    if (view->value_only > 0) {
+        log_printf("  Value-only:       %s (%.1f%%) [fast searches, not below]\n",
+               format_num(view->value_only), view->value_only_pct);
+    }
     log_printf("  Avg moves/sample: %.1f\n", view->avg_moves);
     
     log_printf("  Avg entropy:      %.2f (max=%.2f, ratio=%.1f%%)\n", 
@@ -155,7 +168,7 @@ void cli_view_print_dataset_stats(const DatasetStatsView *view) {
     
     log_printf("\n=== Duplicate Detection ===\n");
     if (view->duplicates_checked) {
-        log_printf("  Duplicate positions: %s (%.2f%%)\n", 
+        log_printf("  Duplicate positions: ~%s (%.2f%%, estimated)\n", 
                    format_num(view->duplicates), view->duplicate_ratio_pct);
         if (view->duplicate_ratio_pct > 10.0f) {
             log_printf("  ⚠️  High duplicate rate may indicate overfitting risk\n");
@@ -198,3 +211,62 @@ void cli_view_print_tournament_leaderboard(const TournamentLeaderboardView *view
     }
     log_printf("└──────┴────────────────────────┴────────┴──────┴──────┴──────┴──────┴────────┴────────┴────────┴──────┴──────┴──────┴──────────┘\n");
 }
+
+// =============================================================================
+// SEARCH PROFILE
+// =============================================================================
+
+void cli_view_print_search_profile(const SearchProfileView *view) {
+    const MCTSProfile *p = view->profile;
+    if (!p || mcts_profile_empty(p)) return;    // Not built with PROFILE=1
+    double ns_per_tick = mcts_profile_ns_per_tick();
+    
+    log_printf("\n=== Search Profile: %s ===\n", view->title ? view->title : "");
+    log_printf("  %-12s %14s %12s %10s\n", "Phase", "Calls", "Total ms", "Avg us");
+    for (int i = 0; i < PROFILE_PHASES; i++) {
+        if (!p->calls[i]) continue;
+        double ms = p->ticks[i] * ns_per_tick / 1e6;
+        log_printf("  %-12s %14s %12.1f %10.2f\n", mcts_profile_phase_name(i),
+                   format_num(p->calls[i]), ms, ms * 1e3 / p->calls[i]);
+    }
+    log_printf("  (movegen and heuristic are also counted in expand/rollout)\n");
+    
+    // Hardware counters per call (perf_counters_enable on a PROFILE=1 build)
+    int has_events = 0;
+    for (int i = 0; i < PROFILE_PHASES; i++) has_events |= p->events[i][PERF_CYCLES] > 0;
+    if (has_events) {
+        log_printf("  %-12s %10s %6s %12s %12s %12s\n", "Phase", "cyc/call", "IPC", "L1D miss", "br miss", "LLC miss");
+        for (int i = 0; i < PROFILE_PHASES; i++) {
+            if (!p->calls[i] || !p->events[i][PERF_CYCLES]) continue;
+            const uint64_t *ev = p->events[i];
+            const double calls = (double)p->calls[i];
+            log_printf("  %-12s %10.0f %6.2f %12.2f %12.2f %12.3f\n", mcts_profile_phase_name(i),
+                       ev[PERF_CYCLES] / calls, (double)ev[PERF_INSTRUCTIONS] / ev[PERF_CYCLES],
+                       ev[PERF_L1D_MISSES] / calls, ev[PERF_BRANCH_MISSES] / calls, ev[PERF_LLC_MISSES] / calls);
+        }
+        log_printf("  (misses per call; user space only, counter reads included)\n");
+    }
+    
+    long batches = 0;
+    for (int i = 0; i < PROFILE_BATCH_BINS; i++) batches += p->batches[i];
+    if (batches > 0) {
+        log_printf("  Batch sizes:");
+        for (int i = 0; i < PROFILE_BATCH_BINS; i++) {
+            if (!p->batches[i]) continue;
+            int lo = 1 << i, hi = (2 << i) - 1;
+            if (lo == hi) log_printf(" %d: %.0f%%", lo, 100.0 * p->batches[i] / batches);
+            else log_printf(" %d-%d: %.0f%%", lo, hi, 100.0 * p->batches[i] / batches);
+        }
+        log_printf("\n");
+    }
+    
+    // A leaf waits for its batch to gather and run: far above one forward
+    // pass, the evaluators are the bottleneck rather than the network itself
+    long waits = p->calls[PROFILE_QUEUE_WAIT], passes = p->calls[PROFILE_INFERENCE];
+    if (waits > 0 && passes > 0) {
+        double wait_us = p->ticks[PROFILE_QUEUE_WAIT] * ns_per_tick / 1e3 / waits;
+        double pass_us = p->ticks[PROFILE_INFERENCE] * ns_per_tick / 1e3 / passes;
+        log_printf("  Wait per leaf %.1f us vs %.1f us per forward pass: %s\n", wait_us, pass_us,
+                   (wait_us > 2.0 * pass_us) ? "queue-bound" : "compute-bound");
+    }
+}
@@ -0,0 +1,327 @@
+/**
+ * logging.c - Structured Logging
+ *
+ * Contains: level filtering and synchronous output, async mode (per-thread
+ * SPSC rings, writer thread merging them by sequence number)
+ */
+
+#include "dama/common/logging.h"
+#include "dama/common/params.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static FILE *g_log_file = NULL;
+static LogLevel g_log_level = LOG_INFO;
+static int g_log_use_color = 1;
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+
+void log_init(const char *path) {
+    if (path && path[0]) {
+        g_log_file = fopen(path, "w");
+    }
+}
+
+void log_close(void) {
+    log_set_async(0);
+    if (g_log_file) {
+        fclose(g_log_file);
+        g_log_file = NULL;
+    }
+}
+
+void log_set_level(LogLevel level) {
+    g_log_level = level;
+}
+
+void log_set_color(int enabled) {
+    g_log_use_color = enabled;
+}
+
+static const char* level_color(LogLevel level) {
+    static const char *colors[] = {LOG_COLOR_RED, LOG_COLOR_YELLOW, NULL, LOG_COLOR_CYAN, LOG_COLOR_GRAY};
+    return colors[level];
+}
+
+static FILE* level_stream(LogLevel level) {
+    return level <= LOG_WARN ? stderr : stdout;
+}
+
+// =============================================================================
+// SYNCHRONOUS OUTPUT
+// =============================================================================
+
+// One message on the console (colored) and in the log file; log_printf
+// messages carry their own newlines
+static void write_message(LogLevel level, int newline, int flush, const char *fmt, va_list args) {
+    FILE *stream = level_stream(level);
+    const char *color = newline ? level_color(level) : NULL;
+
+    if (g_log_use_color && color) {
+        fprintf(stream, "%s", color);
+    }
+    va_list console_args;
+    va_copy(console_args, args);
+    vfprintf(stream, fmt, console_args);
+    va_end(console_args);
+    if (g_log_use_color && color) {
+        fprintf(stream, "%s", LOG_COLOR_RESET);
+    }
+    if (newline) fprintf(stream, "\n");
+    if (flush && newline) fflush(stream);   // log_printf leaves partial lines to stdio
+
+    // File output (no color)
+    if (g_log_file) {
+        va_list file_args;
+        va_copy(file_args, args);
+        vfprintf(g_log_file, fmt, file_args);
+        va_end(file_args);
+        if (newline) fprintf(g_log_file, "\n");
+        if (flush) fflush(g_log_file);
+    }
+}
+
+static void write_text(LogLevel level, int newline, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    write_message(level, newline, 0, fmt, args);
+    va_end(args);
+}
+
+// =============================================================================
+// ASYNC RINGS
+// =============================================================================
+
+typedef struct {
+    uint64_t seq;               // Global order across threads
+    uint8_t level;
+    uint8_t newline;
+    char text[LOG_RECORD_BYTES];
+} LogRecord;
+
+typedef struct LogRing {
+    LogRecord records[LOG_RING_RECORDS];
+    atomic_uint_fast64_t head;  // Next slot the owner fills
+    atomic_uint_fast64_t tail;  // Next slot the writer prints
+    atomic_int owned;           // 0: free for the next new thread
+    struct LogRing *next;
+} LogRing;
+
+static atomic_int async_on = 0;
+static atomic_int writer_run = 0;
+static pthread_t writer_thread;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;   // One consumer at a time
+static _Atomic(LogRing*) rings = NULL;
+static atomic_uint_fast64_t next_seq = 0;
+
+static __thread LogRing *ring_tls = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+// Thread exit: the ring goes back to the pool (queued records still print)
+static void ring_release(void *arg) {
+    atomic_store(&((LogRing*)arg)->owned, 0);
+}
+
+static void make_ring_key(void) {
+    pthread_key_create(&ring_key, ring_release);
+}
+
+// The calling thread's ring: a released one if any, else a new one on the list
+static LogRing* thread_ring(void) {
+    if (ring_tls) return ring_tls;
+    LogRing *ring = NULL;
+    for (LogRing *r = atomic_load(&rings); r && !ring; r = r->next) {
+        int expected = 0;
+        if (atomic_load(&r->owned) == 0 && atomic_compare_exchange_strong(&r->owned, &expected, 1)) ring = r;
+    }
+    if (!ring) {
+        ring = calloc(1, sizeof(LogRing));
+        if (!ring) return NULL;
+        atomic_store(&ring->owned, 1);
+        LogRing *head = atomic_load(&rings);
+        do {
+            ring->next = head;
+        } while (!atomic_compare_exchange_weak(&rings, &head, ring));
+    }
+    pthread_once(&ring_key_once, make_ring_key);
+    pthread_setspecific(ring_key, ring);
+    return ring_tls = ring;
+}
+
+// Print every queued record, oldest sequence number first. Caller holds drain_lock.
+static int drain_locked(void) {
+    int printed = 0;
+    for (;;) {
+        LogRing *best = NULL;
+        uint64_t best_seq = UINT64_MAX;
+        for (LogRing *r = atomic_load(&rings); r; r = r->next) {
+            const uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+            if (tail == atomic_load_explicit(&r->head, memory_order_acquire)) continue;
+            const uint64_t seq = r->records[tail % LOG_RING_RECORDS].seq;
+            if (seq < best_seq) {
+                best_seq = seq;
+                best = r;
+            }
+        }
+        if (!best) break;
+
+        const uint64_t tail = atomic_load_explicit(&best->tail, memory_order_relaxed);
+        const LogRecord *rec = &best->records[tail % LOG_RING_RECORDS];
+        write_text((LogLevel)rec->level, rec->newline, "%s", rec->text);
+        atomic_store_explicit(&best->tail, tail + 1, memory_order_release);
+        printed++;
+    }
+    if (printed) {
+        fflush(stdout);
+        fflush(stderr);
+        if (g_log_file) fflush(g_log_file);
+    }
+    return printed;
+}
+
+void log_flush(void) {
+    if (!atomic_load(&rings)) return;
+    pthread_mutex_lock(&drain_lock);
+    drain_locked();
+    pthread_mutex_unlock(&drain_lock);
+}
+
+static void* writer_main(void *arg) {
+    (void)arg;
+    const struct timespec idle = {0, LOG_WRITER_POLL_US * 1000L};
+    while (atomic_load(&writer_run)) {
+        pthread_mutex_lock(&drain_lock);
+        const int printed = drain_locked();
+        pthread_mutex_unlock(&drain_lock);
+        if (!printed) nanosleep(&idle, NULL);
+    }
+    return NULL;
+}
+
+static void stop_at_exit(void) {
+    log_set_async(0);
+}
+
+int log_set_async(int enabled) {
+    static int exit_hook = 0;
+    if (enabled) {
+        if (atomic_load(&writer_run)) return 0;
+        atomic_store(&writer_run, 1);
+        if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) {
+            atomic_store(&writer_run, 0);
+            log_warn("[Log] Cannot start the writer thread, logging stays synchronous");
+            return -1;
+        }
+        if (!exit_hook) {
+            atexit(stop_at_exit);
+            exit_hook = 1;
+        }
+        atomic_store(&async_on, 1);
+        return 0;
+    }
+    if (!atomic_load(&writer_run)) return 0;
+    atomic_store(&async_on, 0);         // New messages go straight out
+    atomic_store(&writer_run, 0);
+    pthread_join(writer_thread, NULL);
+    pthread_mutex_lock(&drain_lock);
+    drain_locked();
+    pthread_mutex_unlock(&drain_lock);
+    return 0;
+}
+
+// Queue one message; 0 if it must be written synchronously instead
+static int enqueue(LogLevel level, int newline, const char *fmt, va_list args) {
+    LogRing *ring = thread_ring();
+    if (!ring) return 0;
+
+    const uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOG_RING_RECORDS) {
+        log_flush();                    // Full: help the writer rather than drop
+    }
+    LogRecord *rec = &ring->records[head % LOG_RING_RECORDS];
+    va_list copy;
+    va_copy(copy, args);
+    const int len = vsnprintf(rec->text, sizeof(rec->text), fmt, copy);
+    va_end(copy);
+    if (len < 0 || len >= (int)sizeof(rec->text)) return 0;
+
+    rec->level = (uint8_t)level;
+    rec->newline = (uint8_t)newline;
+    rec->seq = atomic_fetch_add_explicit(&next_seq, 1, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    if (!atomic_load(&async_on)) log_flush();     // Raced with log_set_async(0)
+    return 1;
+}
+
+// =============================================================================
+// CORE LOGGING FUNCTION
+// =============================================================================
+
+static void log_message(LogLevel level, int newline, const char *fmt, va_list args) {
+    if (level > g_log_level) return;
+
+    if (!atomic_load_explicit(&async_on, memory_order_relaxed)) {
+        write_message(level, newline, 1, fmt, args);
+        return;
+    }
+    // Errors, and messages too long for a record, are written now, after the queue
+    if (level != LOG_ERROR && enqueue(level, newline, fmt, args)) return;
+    pthread_mutex_lock(&drain_lock);
+    drain_locked();
+    write_message(level, newline, 1, fmt, args);
+    pthread_mutex_unlock(&drain_lock);
+}
+
+// =============================================================================
+// PUBLIC API
+// =============================================================================
+
+void log_error(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_message(LOG_ERROR, 1, fmt, args);
+    va_end(args);
+}
+
+void log_warn(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_message(LOG_WARN, 1, fmt, args);
+    va_end(args);
+}
+
+void log_info(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_message(LOG_INFO, 1, fmt, args);
+    va_end(args);
+}
+
+void log_debug(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_message(LOG_DEBUG, 1, fmt, args);
+    va_end(args);
+}
+
+void log_verbose(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_message(LOG_VERBOSE, 1, fmt, args);
+    va_end(args);
+}
+
+void log_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_message(LOG_INFO, 0, fmt, args);
+    va_end(args);
+}
@@ -0,0 +1,534 @@
+/**
+ * math_backend.c - Vector Kernels for the Selected Backend
+ *
+ * vDSP with Accelerate; elsewhere AVX-512, AVX2 or scalar loops chosen by
+ * the compile target (-march=native). exp uses the Cephes polynomial
+ * (~1 ulp over the softmax range), vectorized the same way.
+ */
+
+#include "dama/common/math_backend.h"
+#include <math.h>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// =============================================================================
+// BACKEND INFO
+// =============================================================================
+
+#if defined(DAMA_BLAS_ACCELERATE)
+    #define BLAS_NAME "Apple Accelerate"
+    #define VEC_NAME  "vDSP"
+#else
+    #if defined(DAMA_BLAS_MKL)
+        #define BLAS_NAME "Intel MKL"
+    #else
+        #define BLAS_NAME "OpenBLAS"
+    #endif
+    #if defined(__AVX512F__)
+        #define VEC_NAME "AVX-512"
+    #elif defined(__AVX2__) && defined(__FMA__)
+        #define VEC_NAME "AVX2"
+    #else
+        #define VEC_NAME "scalar"
+    #endif
+#endif
+
+const char* math_backend_name(void) {
+    return BLAS_NAME " + " VEC_NAME;
+}
+
+#if defined(DAMA_BLAS_ACCELERATE)
+
+// =============================================================================
+// vDSP KERNELS
+// =============================================================================
+
+float vec_max(const float *x, int n) {
+    float m;
+    vDSP_maxv(x, 1, &m, n);
+    return m;
+}
+
+float vec_sum(const float *x, int n) {
+    float s;
+    vDSP_sve(x, 1, &s, n);
+    return s;
+}
+
+void vec_add_scalar(float *x, float a, int n) {
+    vDSP_vsadd(x, 1, &a, x, 1, n);
+}
+
+void vec_add_scalar_relu(float *x, float a, int n) {
+    float zero = 0.0f;
+    vDSP_vsadd(x, 1, &a, x, 1, n);
+    vDSP_vthr(x, 1, &zero, x, 1, n);
+}
+
+void vec_softmax(float *x, float *out, int n) {
+    float neg_max = -vec_max(x, n);
+    vDSP_vsadd(x, 1, &neg_max, x, 1, n);
+    vvexpf(x, x, &n);
+    float sum_exp = vec_sum(x, n);
+    vDSP_vsdiv(x, 1, &sum_exp, out, 1, n);
+}
+
+#else
+
+// =============================================================================
+// SIMD LAYER
+// =============================================================================
+
+#if defined(__AVX512F__)
+    #define VW 16
+    typedef __m512 vf;
+    #define v_load(p)        _mm512_loadu_ps(p)
+    #define v_store(p, a)    _mm512_storeu_ps((p), (a))
+    #define v_set1(x)        _mm512_set1_ps(x)
+    #define v_add(a, b)      _mm512_add_ps((a), (b))
+    #define v_sub(a, b)      _mm512_sub_ps((a), (b))
+    #define v_mul(a, b)      _mm512_mul_ps((a), (b))
+    #define v_fmadd(a, b, c) _mm512_fmadd_ps((a), (b), (c))
+    #define v_max(a, b)      _mm512_max_ps((a), (b))
+    #define v_min(a, b)      _mm512_min_ps((a), (b))
+    #define v_floor(a)       _mm512_roundscale_ps((a), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+    #define v_pow2i(a)       _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32( \
+                                 _mm512_cvttps_epi32(a), _mm512_set1_epi32(127)), 23))
+    #define v_hmax(a)        _mm512_reduce_max_ps(a)
+    #define v_hsum(a)        _mm512_reduce_add_ps(a)
+#elif defined(__AVX2__) && defined(__FMA__)
+    #define VW 8
+    typedef __m256 vf;
+    #define v_load(p)        _mm256_loadu_ps(p)
+    #define v_store(p, a)    _mm256_storeu_ps((p), (a))
+    #define v_set1(x)        _mm256_set1_ps(x)
+    #define v_add(a, b)      _mm256_add_ps((a), (b))
+    #define v_sub(a, b)      _mm256_sub_ps((a), (b))
+    #define v_mul(a, b)      _mm256_mul_ps((a), (b))
+    #define v_fmadd(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+    #define v_max(a, b)      _mm256_max_ps((a), (b))
+    #define v_min(a, b)      _mm256_min_ps((a), (b))
+    #define v_floor(a)       _mm256_floor_ps(a)
+    #define v_pow2i(a)       _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32( \
+                                 _mm256_cvttps_epi32(a), _mm256_set1_epi32(127)), 23))
+
+static inline float v_hmax(__m256 a) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+static inline float v_hsum(__m256 a) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#else
+    #define VW 1
+#endif
+
+// =============================================================================
+// SIMD KERNELS
+// =============================================================================
+
+#if VW > 1
+// Cephes expf: e^x = 2^n * e^r, r = x - n*ln2 in [-ln2/2, ln2/2]
+static inline vf v_exp(vf x) {
+    x = v_min(v_max(x, v_set1(-87.3f)), v_set1(88.37f));
+    vf n = v_floor(v_fmadd(x, v_set1(1.44269504088896341f), v_set1(0.5f)));
+    vf r = v_sub(x, v_mul(n, v_set1(0.693359375f)));
+    r = v_sub(r, v_mul(n, v_set1(-2.12194440e-4f)));
+    
+    vf y = v_set1(1.9875691500e-4f);
+    y = v_fmadd(y, r, v_set1(1.3981999507e-3f));
+    y = v_fmadd(y, r, v_set1(8.3334519073e-3f));
+    y = v_fmadd(y, r, v_set1(4.1665795894e-2f));
+    y = v_fmadd(y, r, v_set1(1.6666665459e-1f));
+    y = v_fmadd(y, r, v_set1(5.0000001201e-1f));
+    y = v_fmadd(y, v_mul(r, r), v_add(r, v_set1(1.0f)));
+    return v_mul(y, v_pow2i(n));
+}
+#endif
+
+float vec_max(const float *x, int n) {
+    int i = 0;
+    float m = -INFINITY;
+#if VW > 1
+    if (n >= VW) {
+        vf vm = v_load(x);
+        for (i = VW; i + VW <= n; i += VW) vm = v_max(vm, v_load(x + i));
+        m = v_hmax(vm);
+    }
+#endif
+    for (; i < n; i++) if (x[i] > m) m = x[i];
+    return m;
+}
+
+float vec_sum(const float *x, int n) {
+    int i = 0;
+    float s = 0.0f;
+#if VW > 1
+    vf vs = v_set1(0.0f);
+    for (; i + VW <= n; i += VW) vs = v_add(vs, v_load(x + i));
+    s = v_hsum(vs);
+#endif
+    for (; i < n; i++) s += x[i];
+    return s;
+}
+
+void vec_add_scalar(float *x, float a, int n) {
+    int i = 0;
+#if VW > 1
+    vf va = v_set1(a);
+    for (; i + VW <= n; i += VW) v_store(x + i, v_add(v_load(x + i), va));
+#endif
+    for (; i < n; i++) x[i] += a;
+}
+
+void vec_add_scalar_relu(float *x, float a, int n) {
+    int i = 0;
+#if VW > 1
+    vf va = v_set1(a), vzero = v_set1(0.0f);
+    for (; i + VW <= n; i += VW) v_store(x + i, v_max(v_add(v_load(x + i), va), vzero));
+#endif
+    for (; i < n; i++) {
+        float v = x[i] + a;
+        x[i] = v > 0 ? v : 0;
+    }
+}
+
+void vec_softmax(float *x, float *out, int n) {
+    float max_x = vec_max(x, n);
+    float sum_exp = 0.0f;
+    int i = 0;
+#if VW > 1
+    vf vmax = v_set1(max_x), vs = v_set1(0.0f);
+    for (; i + VW <= n; i += VW) {
+        vf e = v_exp(v_sub(v_load(x + i), vmax));
+        v_store(x + i, e);
+        vs = v_add(vs, e);
+    }
+    sum_exp = v_hsum(vs);
+#endif
+    for (; i < n; i++) {
+        x[i] = expf(x[i] - max_x);
+        sum_exp += x[i];
+    }
+    
+    float inv = 1.0f / sum_exp;
+    i = 0;
+#if VW > 1
+    vf vinv = v_set1(inv);
+    for (; i + VW <= n; i += VW) v_store(out + i, v_mul(v_load(x + i), vinv));
+#endif
+    for (; i < n; i++) out[i] = x[i] * inv;
+}
+
+#endif // DAMA_BLAS_ACCELERATE
+
+// =============================================================================
+// INT8 KERNELS
+// =============================================================================
+
+// acc += 4-byte group dot products of x (unsigned, 0..127) and w (signed)
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+    #define S8_NAME "AVX-512 VNNI"
+    #define S8W 64
+    typedef __m512i s8_in;
+    typedef __m512i s8_acc;
+    #define s8_load(p)          _mm512_loadu_si512((const void*)(p))
+    #define s8_zero()           _mm512_setzero_si512()
+    #define s8_dot(acc, x, w)   _mm512_dpbusd_epi32((acc), (x), (w))
+    #define s8_hsum(a)          _mm512_reduce_add_epi32(a)
+#elif defined(__AVX512BW__)
+    #define S8_NAME "AVX-512BW"
+    #define S8W 64
+    typedef __m512i s8_in;
+    typedef __m512i s8_acc;
+    #define s8_load(p)          _mm512_loadu_si512((const void*)(p))
+    #define s8_zero()           _mm512_setzero_si512()
+    #define s8_dot(acc, x, w)   _mm512_add_epi32((acc), _mm512_madd_epi16( \
+                                    _mm512_maddubs_epi16((x), (w)), _mm512_set1_epi16(1)))
+    #define s8_hsum(a)          _mm512_reduce_add_epi32(a)
+#elif defined(__AVX2__)
+    #define S8W 32
+    typedef __m256i s8_in;
+    typedef __m256i s8_acc;
+    #define s8_load(p)          _mm256_loadu_si256((const __m256i*)(p))
+    #define s8_zero()           _mm256_setzero_si256()
+    #if defined(__AVXVNNI__)
+        #define S8_NAME "AVX-VNNI"
+        #define s8_dot(acc, x, w)   _mm256_dpbusd_avx_epi32((acc), (x), (w))
+    #else
+        #define S8_NAME "AVX2"
+        #define s8_dot(acc, x, w)   _mm256_add_epi32((acc), _mm256_madd_epi16( \
+                                        _mm256_maddubs_epi16((x), (w)), _mm256_set1_epi16(1)))
+    #endif
+
+static inline int32_t s8_hsum(__m256i a) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #define S8W 16
+    typedef int8x16_t s8_in;
+    typedef int32x4_t s8_acc;
+    #define s8_load(p)          vld1q_s8(p)
+    #define s8_zero()           vdupq_n_s32(0)
+    #define s8_hsum(a)          vaddvq_s32(a)
+    #if defined(__ARM_FEATURE_DOTPROD)
+        #define S8_NAME "NEON sdot"
+        #define s8_dot(acc, x, w)   vdotq_s32((acc), (x), (w))
+    #else
+        #define S8_NAME "NEON"
+
+static inline int32x4_t s8_dot(int32x4_t acc, int8x16_t x, int8x16_t w) {
+    int16x8_t lo = vmull_s8(vget_low_s8(x), vget_low_s8(w));
+    int16x8_t hi = vmull_high_s8(x, w);
+    return vpadalq_s16(vpadalq_s16(acc, lo), hi);
+}
+    #endif
+#else
+    #define S8_NAME "scalar"
+    #define S8W 1
+#endif
+
+const char* vec_s8_name(void) {
+    return S8_NAME;
+}
+
+int32_t vec_dot_s8(const int8_t *x, const int8_t *w, int n) {
+    int i = 0;
+    int32_t s = 0;
+#if S8W > 1
+    s8_acc acc = s8_zero();
+    for (; i + S8W <= n; i += S8W) acc = s8_dot(acc, s8_load(x + i), s8_load(w + i));
+    s = s8_hsum(acc);
+#endif
+    for (; i < n; i++) s += (int32_t)x[i] * w[i];
+    return s;
+}
+
+void vec_gemv_s8(const int8_t *W, const int8_t *x, int32_t *y, int rows, int n) {
+    int r = 0;
+#if S8W > 1
+    if (n % S8W == 0) {
+        for (; r + 4 <= rows; r += 4) {
+            const int8_t *w0 = &W[(size_t)r * n], *w1 = w0 + n, *w2 = w1 + n, *w3 = w2 + n;
+            s8_acc a0 = s8_zero(), a1 = s8_zero(), a2 = s8_zero(), a3 = s8_zero();
+            for (int i = 0; i < n; i += S8W) {
+                s8_in xv = s8_load(x + i);
+                a0 = s8_dot(a0, xv, s8_load(w0 + i));
+                a1 = s8_dot(a1, xv, s8_load(w1 + i));
+                a2 = s8_dot(a2, xv, s8_load(w2 + i));
+                a3 = s8_dot(a3, xv, s8_load(w3 + i));
+            }
+            y[r] = s8_hsum(a0);
+            y[r + 1] = s8_hsum(a1);
+            y[r + 2] = s8_hsum(a2);
+            y[r + 3] = s8_hsum(a3);
+        }
+    }
+#endif
+    for (; r < rows; r++) y[r] = vec_dot_s8(x, &W[(size_t)r * n], n);
+}
+
+// =============================================================================
+// FP16 KERNELS
+// =============================================================================
+
+// Round to nearest even; overflow goes to inf, tiny values to subnormals/0
+static uint16_t f32_to_f16(float f) {
+    union { float f; uint32_t u; } v = { f };
+    uint32_t sign = (v.u >> 16) & 0x8000u;
+    uint32_t abs = v.u & 0x7FFFFFFFu;
+    if (abs >= 0x7F800000u) return (uint16_t)(sign | 0x7C00u | (abs > 0x7F800000u ? 0x200u : 0));
+    if (abs >= 0x477FF000u) return (uint16_t)(sign | 0x7C00u);       // Rounds past 65504
+    if (abs < 0x38800000u) {                                         // Subnormal half
+        if (abs < 0x33000000u) return (uint16_t)sign;
+        uint32_t m = (abs & 0x007FFFFFu) | 0x00800000u;
+        int shift = 126 - (int)(abs >> 23);                          // 14..24
+        uint32_t h = m >> shift, rem = m & ((1u << shift) - 1), half = 1u << (shift - 1);
+        if (rem > half || (rem == half && (h & 1))) h++;
+        return (uint16_t)(sign | h);
+    }
+    uint32_t h = (abs - 0x38000000u) >> 13, rem = abs & 0x1FFFu;
+    if (rem > 0x1000u || (rem == 0x1000u && (h & 1))) h++;
+    return (uint16_t)(sign | h);
+}
+
+static float f16_to_f32(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t e = (h >> 10) & 0x1Fu, m = h & 0x3FFu;
+    union { uint32_t u; float f; } v;
+    if (e == 0x1Fu) v.u = sign | 0x7F800000u | (m << 13);
+    else if (e != 0) v.u = sign | ((e + 112) << 23) | (m << 13);
+    else {
+        v.f = (float)m * (1.0f / 16777216.0f);                      // m * 2^-24
+        v.u |= sign;
+    }
+    return v.f;
+}
+
+// Half-precision loads widened to fp32 lanes
+#if defined(__AVX512F__)
+    #define HW 16
+    typedef __m512 hf;
+    #define h_load(p)           _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(p)))
+    #define h_store(p, a)       _mm256_storeu_si256((__m256i*)(p), _mm512_cvtps_ph((a), _MM_FROUND_TO_NEAREST_INT))
+    #define hx_load(p)          _mm512_loadu_ps(p)
+    #define hx_store(p, a)      _mm512_storeu_ps((p), (a))
+    #define h_zero()            _mm512_setzero_ps()
+    #define h_fmadd(a, b, c)    _mm512_fmadd_ps((a), (b), (c))
+    #define h_hsum(a)           _mm512_reduce_add_ps(a)
+    #define F16_NAME "AVX-512"
+#elif defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+    #define HW 8
+    typedef __m256 hf;
+    #define h_load(p)           _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(p)))
+    #define h_store(p, a)       _mm_storeu_si128((__m128i*)(p), _mm256_cvtps_ph((a), _MM_FROUND_TO_NEAREST_INT))
+    #define hx_load(p)          _mm256_loadu_ps(p)
+    #define hx_store(p, a)      _mm256_storeu_ps((p), (a))
+    #define h_zero()            _mm256_setzero_ps()
+    #define h_fmadd(a, b, c)    _mm256_fmadd_ps((a), (b), (c))
+    #define F16_NAME "F16C"
+
+static inline float h_hsum(__m256 a) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #define HW 4
+    typedef float32x4_t hf;
+    #define h_load(p)           vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)))
+    #define h_store(p, a)       vst1_u16((p), vreinterpret_u16_f16(vcvt_f16_f32(a)))
+    #define hx_load(p)          vld1q_f32(p)
+    #define hx_store(p, a)      vst1q_f32((p), (a))
+    #define h_zero()            vdupq_n_f32(0.0f)
+    #define h_fmadd(a, b, c)    vfmaq_f32((c), (a), (b))
+    #define h_hsum(a)           vaddvq_f32(a)
+    #define F16_NAME "NEON"
+#else
+    #define HW 1
+    #define F16_NAME "scalar"
+#endif
+
+const char* vec_f16_name(void) {
+    return F16_NAME;
+}
+
+void vec_f32_to_f16(const float *x, uint16_t *h, size_t n) {
+    size_t i = 0;
+#if HW > 1
+    size_t vec_n = n - n % HW;
+    for (; i < vec_n; i += HW) h_store(h + i, hx_load(x + i));
+#endif
+    for (; i < n; i++) h[i] = f32_to_f16(x[i]);
+}
+
+void vec_f16_to_f32(const uint16_t *h, float *x, size_t n) {
+    size_t i = 0;
+#if HW > 1
+    size_t vec_n = n - n % HW;
+    for (; i < vec_n; i += HW) hx_store(x + i, h_load(h + i));
+#endif
+    for (; i < n; i++) x[i] = f16_to_f32(h[i]);
+}
+
+float vec_dot_f16(const uint16_t *w, const float *x, int n) {
+    int i = 0;
+    float s = 0.0f;
+#if HW > 1
+    hf acc = h_zero();
+    for (; i + HW <= n; i += HW) acc = h_fmadd(h_load(w + i), hx_load(x + i), acc);
+    s = h_hsum(acc);
+#endif
+    for (; i < n; i++) s += f16_to_f32(w[i]) * x[i];
+    return s;
+}
+
+void vec_gemv_f16(const uint16_t *W, int ld, const float *x, float *y, int rows, int n) {
+    int r = 0;
+#if HW > 1
+    for (; r + 4 <= rows; r += 4) {
+        const uint16_t *w0 = &W[(size_t)r * ld], *w1 = w0 + ld, *w2 = w1 + ld, *w3 = w2 + ld;
+        hf a0 = h_zero(), a1 = h_zero(), a2 = h_zero(), a3 = h_zero();
+        int i = 0;
+        for (; i + HW <= n; i += HW) {
+            hf xv = hx_load(x + i);
+            a0 = h_fmadd(h_load(w0 + i), xv, a0);
+            a1 = h_fmadd(h_load(w1 + i), xv, a1);
+            a2 = h_fmadd(h_load(w2 + i), xv, a2);
+            a3 = h_fmadd(h_load(w3 + i), xv, a3);
+        }
+        float s0 = h_hsum(a0), s1 = h_hsum(a1), s2 = h_hsum(a2), s3 = h_hsum(a3);
+        for (; i < n; i++) {
+            s0 += f16_to_f32(w0[i]) * x[i];
+            s1 += f16_to_f32(w1[i]) * x[i];
+            s2 += f16_to_f32(w2[i]) * x[i];
+            s3 += f16_to_f32(w3[i]) * x[i];
+        }
+        y[r] += s0;
+        y[r + 1] += s1;
+        y[r + 2] += s2;
+        y[r + 3] += s3;
+    }
+#endif
+    for (; r < rows; r++) y[r] += vec_dot_f16(&W[(size_t)r * ld], x, n);
+}
+
+void vec_gemm_f16(const uint16_t *W, int ld, const float *X, int ldx, float *Y, int ldy,
+                  int rows, int n, int batch) {
+    // 4-row blocks: each block is read from memory once and reused from
+    // L1 for the whole batch
+    for (int r = 0; r < rows; r += 4) {
+        int block = rows - r < 4 ? rows - r : 4;
+        for (int b = 0; b < batch; b++) {
+            float y[4] = {0};
+            vec_gemv_f16(&W[(size_t)r * ld], ld, &X[(size_t)b * ldx], y, block, n);
+            for (int k = 0; k < block; k++) Y[(size_t)b * ldy + r + k] += y[k];
+        }
+    }
+}
+
+// =============================================================================
+// BIT EXPANSION
+// =============================================================================
+
+void vec_bits_to_f32(uint64_t bits, float *out) {
+#if defined(__AVX512F__)
+    // The bits are already a lane mask: one masked move per 16 squares
+    const __m512 one = _mm512_set1_ps(1.0f);
+    for (int i = 0; i < 64; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_maskz_mov_ps((__mmask16)(bits >> i), one));
+    }
+#elif defined(__AVX2__)
+    // Broadcast a byte, test lane j against bit j, keep 1.0f where set
+    const __m256i lane_bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (int i = 0; i < 64; i += 8) {
+        __m256i b = _mm256_and_si256(_mm256_set1_epi32((int)((bits >> i) & 0xFF)), lane_bit);
+        __m256 set = _mm256_castsi256_ps(_mm256_cmpeq_epi32(b, lane_bit));
+        _mm256_storeu_ps(out + i, _mm256_and_ps(set, one));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint32x4_t lane_bit = {1, 2, 4, 8};
+    const uint32x4_t one = vreinterpretq_u32_f32(vdupq_n_f32(1.0f));
+    for (int i = 0; i < 64; i += 4) {
+        uint32x4_t set = vtstq_u32(vdupq_n_u32((uint32_t)(bits >> i) & 0xF), lane_bit);
+        vst1q_f32(out + i, vreinterpretq_f32_u32(vandq_u32(set, one)));
+    }
+#else
+    for (int i = 0; i < 64; i++) out[i] = (float)((bits >> i) & 1);
+#endif
+}
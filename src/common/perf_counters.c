@@ -0,0 +1,146 @@
+/**
+ * perf_counters.c - Hardware Performance Counters
+ *
+ * Contains: event table, per-thread perf_event_open groups (closed by a
+ * pthread key destructor), scaled group reads
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "dama/common/perf_counters.h"
+#include "dama/common/logging.h"
+#include <string.h>
+
+int perf_counters_on = 0;
+static unsigned available_mask = 0;
+
+const char* perf_event_name(int event) {
+    static const char *names[PERF_EVENTS] = {"cycles", "instructions", "L1D misses", "branch misses", "LLC misses"};
+    return (event >= 0 && event < PERF_EVENTS) ? names[event] : "?";
+}
+
+unsigned perf_counters_available(void) { return available_mask; }
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+
+typedef struct {
+    int fd[PERF_EVENTS];        // -1: not counting; fd[first open] leads the group
+    int leader;
+    int slot[PERF_EVENTS];      // Position of each event in the group read
+    int opened;
+} PerfGroup;
+
+static __thread PerfGroup *tls_group = NULL;
+static pthread_key_t group_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+static void group_close(void *arg) {
+    PerfGroup *g = arg;
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (g->fd[e] >= 0) close(g->fd[e]);
+    }
+    free(g);
+}
+
+static void make_key(void) {
+    pthread_key_create(&group_key, group_close);
+}
+
+static void event_attr(int event, struct perf_event_attr *a) {
+    memset(a, 0, sizeof(*a));
+    a->size = sizeof(*a);
+    a->exclude_kernel = 1;
+    a->exclude_hv = 1;
+    a->read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (event) {
+        case PERF_CYCLES:        a->type = PERF_TYPE_HARDWARE; a->config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case PERF_INSTRUCTIONS:  a->type = PERF_TYPE_HARDWARE; a->config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case PERF_BRANCH_MISSES: a->type = PERF_TYPE_HARDWARE; a->config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case PERF_L1D_MISSES:    a->type = PERF_TYPE_HW_CACHE; a->config = PERF_COUNT_HW_CACHE_L1D | read_miss; break;
+        case PERF_LLC_MISSES:    a->type = PERF_TYPE_HW_CACHE; a->config = PERF_COUNT_HW_CACHE_LL | read_miss; break;
+    }
+}
+
+// Open the calling thread's group; events the PMU lacks are left out
+static PerfGroup* group_open(int *first_errno) {
+    PerfGroup *g = calloc(1, sizeof(PerfGroup));
+    if (!g) return NULL;
+    g->leader = -1;
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        struct perf_event_attr a;
+        event_attr(e, &a);
+        a.disabled = (g->leader < 0);       // The leader starts the group
+        g->fd[e] = (int)syscall(SYS_perf_event_open, &a, 0, -1, g->leader, 0);
+        if (g->fd[e] < 0) {
+            if (first_errno && !*first_errno) *first_errno = errno;
+            continue;
+        }
+        if (g->leader < 0) g->leader = g->fd[e];
+        g->slot[e] = g->opened++;
+    }
+    if (g->leader < 0) {
+        free(g);
+        return NULL;
+    }
+    ioctl(g->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    pthread_once(&key_once, make_key);
+    pthread_setspecific(group_key, g);
+    return g;
+}
+
+int perf_counters_enable(void) {
+    if (perf_counters_on) return __builtin_popcount(available_mask);
+    int err = 0;
+    PerfGroup *g = tls_group ? tls_group : group_open(&err);
+    if (!g) {
+        log_warn("[Perf] No hardware counters (perf_event_open: %s)%s", strerror(err),
+                 err == EACCES || err == EPERM ? ", see /proc/sys/kernel/perf_event_paranoid" : "");
+        return 0;
+    }
+    tls_group = g;
+    available_mask = 0;
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (g->fd[e] >= 0) available_mask |= 1u << e;
+    }
+    perf_counters_on = 1;
+    return g->opened;
+}
+
+void perf_counters_read(PerfReading *out) {
+    memset(out, 0, sizeof(*out));
+    if (!perf_counters_on) return;
+    if (!tls_group && !(tls_group = group_open(NULL))) return;
+    const PerfGroup *g = tls_group;
+
+    uint64_t buf[3 + PERF_EVENTS];      // nr, time_enabled, time_running, values
+    if (read(g->leader, buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t))) return;
+    const double scale = buf[2] ? (double)buf[1] / buf[2] : 0.0;    // Multiplexed: running < enabled
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (g->fd[e] >= 0) out->count[e] = (uint64_t)(buf[3 + g->slot[e]] * scale);
+    }
+}
+
+#else
+
+int perf_counters_enable(void) {
+    log_warn("[Perf] Hardware counters need Linux perf_event_open");
+    return 0;
+}
+
+void perf_counters_read(PerfReading *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+#endif
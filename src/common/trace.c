@@ -0,0 +1,145 @@
+/**
+ * trace.c - Timeline Tracing (Chrome / Perfetto JSON)
+ *
+ * Contains: ring registration, span recording, the JSON writer run at exit
+ */
+
+#include "dama/common/trace.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+} TraceSpan;
+
+typedef struct TraceRing {
+    TraceSpan *spans;           // TRACE_RING_EVENTS, oldest overwritten
+    uint64_t count;             // Spans recorded (may exceed the ring)
+    int tid;                    // Registration order
+    const char *thread_name;
+    struct TraceRing *next;
+} TraceRing;
+
+int trace_on = 0;
+
+static char trace_path[1024];
+static uint64_t trace_origin_ns;
+static _Atomic(TraceRing*) trace_rings = NULL;
+static atomic_int trace_threads = 0;
+static __thread TraceRing *trace_tls = NULL;
+
+uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// =============================================================================
+// RECORDING
+// =============================================================================
+
+// The calling thread's ring, created and published on first use
+static TraceRing* thread_ring(void) {
+    if (trace_tls) return trace_tls;
+    TraceRing *ring = calloc(1, sizeof(TraceRing));
+    if (!ring) return NULL;
+    ring->spans = malloc(TRACE_RING_EVENTS * sizeof(TraceSpan));
+    if (!ring->spans) {
+        free(ring);
+        return NULL;
+    }
+    ring->tid = atomic_fetch_add(&trace_threads, 1) + 1;
+
+    TraceRing *head = atomic_load(&trace_rings);
+    do {
+        ring->next = head;
+    } while (!atomic_compare_exchange_weak(&trace_rings, &head, ring));
+    return trace_tls = ring;
+}
+
+void trace_span(const char *name, uint64_t start_ns) {
+    const uint64_t end = trace_now();
+    TraceRing *ring = thread_ring();
+    if (!ring) return;
+    TraceSpan *s = &ring->spans[ring->count++ % TRACE_RING_EVENTS];
+    s->name = name;
+    s->start_ns = start_ns;
+    s->dur_ns = end - start_ns;
+}
+
+void trace_thread_name(const char *name) {
+    TraceRing *ring = thread_ring();
+    if (ring && !ring->thread_name) ring->thread_name = name;
+}
+
+// =============================================================================
+// OUTPUT
+// =============================================================================
+
+#ifdef DAMA_TRACE
+static void dump_at_exit(void) {
+    trace_dump();
+}
+#endif
+
+int trace_open(const char *path) {
+#ifndef DAMA_TRACE
+    (void)path;
+    log_warn("[Trace] Built without TRACE=1, nothing is recorded");
+    return -1;
+#else
+    snprintf(trace_path, sizeof(trace_path), "%s", path);
+    trace_origin_ns = trace_now();
+    if (!trace_on) atexit(dump_at_exit);
+    trace_on = 1;
+    return 0;
+#endif
+}
+
+// Microseconds since trace_open, the unit of Chrome's "ts" and "dur"
+static double trace_us(uint64_t ns) {
+    return (double)(int64_t)(ns - trace_origin_ns) / 1e3;
+}
+
+int trace_dump(void) {
+    if (!trace_on) return 0;
+    FILE *f = fopen(trace_path, "w");
+    if (!f) {
+        log_error("[Trace] Cannot write %s", trace_path);
+        return -1;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"dama\"}}");
+    long long spans = 0, lost = 0;
+    for (TraceRing *r = atomic_load(&trace_rings); r; r = r->next) {
+        if (r->thread_name) {
+            fprintf(f, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                       "\"args\": {\"name\": \"%s\"}}", r->tid, r->thread_name);
+        }
+        const uint64_t count = r->count;
+        const uint64_t first = count > TRACE_RING_EVENTS ? count - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = first; i < count; i++) {
+            const TraceSpan *s = &r->spans[i % TRACE_RING_EVENTS];
+            fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                    s->name, trace_us(s->start_ns), s->dur_ns / 1e3, r->tid);
+        }
+        spans += (long long)(count - first);
+        lost += (long long)first;
+    }
+    fprintf(f, "\n]}\n");
+
+    if (fclose(f) != 0) {
+        log_error("[Trace] Cannot write %s", trace_path);
+        return -1;
+    }
+    log_info("[Trace] %lld spans from %d threads written to %s (%lld overwritten)",
+             spans, atomic_load(&trace_threads), trace_path, lost);
+    return 0;
+}
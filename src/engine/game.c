@@ -21,44 +21,36 @@ void init_game(GameState *state) {
 }
 
 // --- Move Execution ---
-static void perform_movement(GameState *s, const int from, const int to) {
-    DBG_VALID_SQ(from);
-    DBG_VALID_SQ(to);
-
-    const Color us = s->current_player;
-    const Bitboard from_to_mask = BIT(from) | BIT(to);
-    
-    const Piece type = TEST_BIT(s->piece[us][LADY], from) ? LADY : PAWN;
-    s->piece[us][type] ^= from_to_mask;
-    
-    if (type == PAWN && TEST_BIT(PROM_RANKS[us], to)) {
-        CLEAR_BIT(s->piece[us][PAWN], to);
-        SET_BIT(s->piece[us][LADY], to);
-    }
-}
-
-void apply_move(GameState *state, const Move *move) {
-    DBG_NOT_NULL(state);
-    DBG_NOT_NULL(move);
-
+static inline void do_move(GameState *state, const int from, const int to, const int is_lady,
+                           Bitboard captured, MoveUndo *undo) {
     const Color us = state->current_player;
     const Color them = us ^ 1;
-    
-    const int from = move->path[0];
-    const int to = (move->length == 0) ? move->path[1] : move->path[move->length];
 
-    state->hash ^= zobrist_keys[us][move->is_lady_move][from];
-    perform_movement(state, from, to);
-    
-    const Piece piece_now = TEST_BIT(state->piece[us][LADY], to) ? LADY : PAWN;
+    undo->hash = state->hash;
+    undo->moves_without_captures = state->moves_without_captures;
+    undo->captured[PAWN] = captured & state->piece[them][PAWN];
+    undo->captured[LADY] = captured & state->piece[them][LADY];
+
+    const Piece type = TEST_BIT(state->piece[us][LADY], from) ? LADY : PAWN;
+    state->piece[us][type] ^= BIT(from) ^ BIT(to);
+    state->hash ^= zobrist_keys[us][is_lady][from];
+
+    undo->promoted = (type == PAWN && TEST_BIT(PROM_RANKS[us], to)) ? 1 : 0;
+    if (undo->promoted) {
+        CLEAR_BIT(state->piece[us][PAWN], to);
+        SET_BIT(state->piece[us][LADY], to);
+    }
+    const Piece piece_now = undo->promoted ? LADY : type;
     state->hash ^= zobrist_keys[us][piece_now][to];
 
-    if (move->length > 0) {
-        for (int i = 0; i < move->length; i++) {
-            const int cap_sq = move->captured_squares[i];
-            const Piece cap_type = TEST_BIT(state->piece[them][LADY], cap_sq) ? LADY : PAWN;
+    if (captured) {
+        state->piece[them][PAWN] &= ~captured;
+        state->piece[them][LADY] &= ~captured;
+        while (captured) {
+            const int cap_sq = __builtin_ctzll(captured);
+            const Piece cap_type = TEST_BIT(undo->captured[LADY], cap_sq) ? LADY : PAWN;
             state->hash ^= zobrist_keys[them][cap_type][cap_sq];
-            CLEAR_BIT(state->piece[them][cap_type], cap_sq);
+            POP_LSB(captured);
         }
         state->moves_without_captures = 0;
     } else {
@@ -70,4 +62,65 @@ void apply_move(GameState *state, const Move *move) {
 
     state->current_player = them;
     state->hash ^= zobrist_black_move;
-}
\ No newline at end of file
+}
+
+static inline void do_full_move(GameState *state, const Move *move, MoveUndo *undo) {
+    const int to = (move->length == 0) ? move->path[1] : move->path[move->length];
+    Bitboard captured = 0;
+    for (int i = 0; i < move->length; i++) captured |= BIT(move->captured_squares[i]);
+    do_move(state, move->path[0], to, move->is_lady_move, captured, undo);
+}
+
+void apply_move(GameState *state, const Move *move) {
+    DBG_NOT_NULL(state);
+    DBG_NOT_NULL(move);
+    DBG_VALID_SQ(move->path[0]);
+
+    MoveUndo scratch;
+    do_full_move(state, move, &scratch);
+}
+
+void apply_packed_move(GameState *state, const PackedMove move) {
+    DBG_NOT_NULL(state);
+    DBG_VALID_SQ(pmove_from(move));
+
+    MoveUndo scratch;
+    do_move(state, pmove_from(move), pmove_to(move), pmove_is_lady(move),
+            pmove_captured_bb(move), &scratch);
+}
+
+void apply_move_with_undo(GameState *state, const Move *move, MoveUndo *undo) {
+    DBG_NOT_NULL(state);
+    DBG_NOT_NULL(move);
+    DBG_NOT_NULL(undo);
+    DBG_VALID_SQ(move->path[0]);
+
+    do_full_move(state, move, undo);
+}
+
+void undo_move(GameState *state, const Move *move, const MoveUndo *undo) {
+    DBG_NOT_NULL(state);
+    DBG_NOT_NULL(move);
+    DBG_NOT_NULL(undo);
+
+    const Color them = state->current_player;
+    const Color us = them ^ 1;
+
+    const int from = move->path[0];
+    const int to = (move->length == 0) ? move->path[1] : move->path[move->length];
+
+    if (undo->promoted) {
+        CLEAR_BIT(state->piece[us][LADY], to);
+        SET_BIT(state->piece[us][PAWN], from);
+    } else {
+        const Piece type = TEST_BIT(state->piece[us][LADY], to) ? LADY : PAWN;
+        state->piece[us][type] ^= BIT(from) ^ BIT(to);
+    }
+
+    state->piece[them][PAWN] |= undo->captured[PAWN];
+    state->piece[them][LADY] |= undo->captured[LADY];
+
+    state->current_player = us;
+    state->moves_without_captures = undo->moves_without_captures;
+    state->hash = undo->hash;
+}
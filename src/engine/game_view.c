@@ -4,7 +4,9 @@
  */
 
 #include "dama/engine/game_view.h"
+#include "dama/engine/movegen.h"
 #include <stdio.h>
+#include <ctype.h>
 
 // --- Debug Utilities Implementation ---
 
@@ -54,3 +56,29 @@ void print_move_description(const Move m) {
         }
     }
 }
+
+int format_move(const Move *m, char *out, size_t size) {
+    int n = snprintf(out, size, "%c%d", COL(m->path[0]) + 'A', ROW(m->path[0]) + 1);
+    const int steps = m->length == 0 ? 1 : m->length;
+    for (int i = 0; i < steps && n >= 0 && (size_t)n < size; i++) {
+        const int sq = m->path[i + 1];
+        n += snprintf(out + n, size - n, "%c%c%d", m->length == 0 ? '-' : 'x', COL(sq) + 'A', ROW(sq) + 1);
+    }
+    return n;
+}
+
+int parse_move(const GameState *s, const char *text, Move *out) {
+    MoveList list;
+    movegen_generate(s, &list);
+    for (int i = 0; i < list.count; i++) {
+        char buf[MOVE_TEXT_MAX];
+        format_move(&list.moves[i], buf, sizeof(buf));
+        int k = 0;
+        while (buf[k] && toupper((unsigned char)text[k]) == toupper((unsigned char)buf[k])) k++;
+        if (buf[k] == '\0' && text[k] == '\0') {
+            *out = list.moves[i];
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -125,8 +125,16 @@ static void add_simple_move(MoveList *list, const int from, const int to, const
     m->first_captured_is_lady = 0;
 }
 
+static int calculate_score(const Move *m);
+static void filter_moves(MoveList *list);
+
 static void save_move(CaptureContext *ctx, const int depth) {
-    if (ctx->list->count >= MAX_MOVES) return;
+    // List full: drop captures that Italian priority already rules out,
+    // so a long capture found late is never lost to truncation
+    if (ctx->list->count >= MAX_MOVES) {
+        filter_moves(ctx->list);
+        if (ctx->list->count >= MAX_MOVES) return;
+    }
     const int safe_depth = (depth > MAX_CHAIN_LENGTH - 1) ? MAX_CHAIN_LENGTH - 1 : depth;
     
     Move *m = &ctx->list->moves[ctx->list->count++];
@@ -245,9 +253,10 @@ static void filter_moves(MoveList *list) {
 }
 
 // --- Public API ---
-void movegen_generate_simple(const GameState *s, MoveList *list) {
+void movegen_generate_simple_table(const GameState *s, MoveList *list) {
     DBG_NOT_NULL(s);
     DBG_NOT_NULL(list);
+    list->count = 0;
     const Color us = s->current_player;
     const Bitboard empty = get_empty_squares(s);
 
@@ -290,6 +299,78 @@ void movegen_generate_simple(const GameState *s, MoveList *list) {
     }
 }
 
+// --- Set-wise (shift) helpers ---
+// Destination sets for one-step moves of every piece in 'bb' at once.
+// The file masks drop moves that wrapped around the board edge.
+static inline Bitboard shift_ne(const Bitboard bb) { return (bb << 9) & NOT_FILE_A; }
+static inline Bitboard shift_nw(const Bitboard bb) { return (bb << 7) & NOT_FILE_H; }
+static inline Bitboard shift_se(const Bitboard bb) { return (bb >> 7) & NOT_FILE_A; }
+static inline Bitboard shift_sw(const Bitboard bb) { return (bb >> 9) & NOT_FILE_H; }
+
+// Pushes a simple move into whichever list is non-NULL (constant-folded per caller)
+static inline void push_simple(MoveList *list, PackedMoveList *plist,
+                               const int from, const int to, const int is_lady) {
+    if (list) {
+        add_simple_move(list, from, to, is_lady);
+    } else if (plist->count < MAX_MOVES) {
+        plist->moves[plist->count++] = (PackedMove)from
+            | ((PackedMove)to << PM_STEP_SHIFT)
+            | ((PackedMove)to << PM_TO_SHIFT)
+            | ((PackedMove)is_lady << PM_LADY_SHIFT);
+    }
+}
+
+static inline void generate_simple_shift(const GameState *s, MoveList *list, PackedMoveList *plist) {
+    const Color us = s->current_player;
+    const Bitboard empty = get_empty_squares(s);
+    const Bitboard pawns = s->piece[us][PAWN];
+    const Bitboard ladies = s->piece[us][LADY];
+
+    // Sources able to step in each direction, found for all pieces at once
+    const Bitboard ne = shift_sw(shift_ne(pawns | ladies) & empty);
+    const Bitboard nw = shift_se(shift_nw(pawns | ladies) & empty);
+    const Bitboard se = shift_nw(shift_se(pawns | ladies) & empty);
+    const Bitboard sw = shift_ne(shift_sw(pawns | ladies) & empty);
+
+    // Serialize per piece, in the same order as the table path
+    // (pawns then ladies, ascending square, direction order)
+    Bitboard movers;
+    if (us == WHITE) {
+        movers = pawns & (ne | nw);
+        while (movers) {
+            const int from = __builtin_ctzll(movers);
+            if (TEST_BIT(ne, from)) push_simple(list, plist, from, from + OFFSET_NE, 0);
+            if (TEST_BIT(nw, from)) push_simple(list, plist, from, from + OFFSET_NW, 0);
+            POP_LSB(movers);
+        }
+    } else {
+        movers = pawns & (se | sw);
+        while (movers) {
+            const int from = __builtin_ctzll(movers);
+            if (TEST_BIT(se, from)) push_simple(list, plist, from, from + OFFSET_SE, 0);
+            if (TEST_BIT(sw, from)) push_simple(list, plist, from, from + OFFSET_SW, 0);
+            POP_LSB(movers);
+        }
+    }
+
+    movers = ladies & (ne | nw | se | sw);
+    while (movers) {
+        const int from = __builtin_ctzll(movers);
+        if (TEST_BIT(ne, from)) push_simple(list, plist, from, from + OFFSET_NE, 1);
+        if (TEST_BIT(nw, from)) push_simple(list, plist, from, from + OFFSET_NW, 1);
+        if (TEST_BIT(se, from)) push_simple(list, plist, from, from + OFFSET_SE, 1);
+        if (TEST_BIT(sw, from)) push_simple(list, plist, from, from + OFFSET_SW, 1);
+        POP_LSB(movers);
+    }
+}
+
+void movegen_generate_simple(const GameState *s, MoveList *list) {
+    DBG_NOT_NULL(s);
+    DBG_NOT_NULL(list);
+    list->count = 0;
+    generate_simple_shift(s, list, NULL);
+}
+
 void movegen_generate_captures(const GameState *s, MoveList *list) {
     DBG_NOT_NULL(s);
     DBG_NOT_NULL(list);
@@ -349,16 +430,241 @@ void movegen_generate(const GameState *s, MoveList *list) {
     DBG_NOT_NULL(s);
     DBG_NOT_NULL(list);
     list->count = 0;
-    movegen_generate_captures(s, list);
     
-    if (list->count > 0) {
+    // Cheap set-wise test first: most positions have no capture at all
+    if (movegen_has_capture(s)) {
+        movegen_generate_captures(s, list);
         filter_moves(list);
     } else {
         movegen_generate_simple(s, list);
     }
 }
 
+void movegen_generate_packed(const GameState *s, PackedMoveList *list) {
+    DBG_NOT_NULL(s);
+    DBG_NOT_NULL(list);
+    list->count = 0;
+    
+    if (movegen_has_capture(s)) {
+        MoveList full;
+        full.count = 0;
+        movegen_generate_captures(s, &full);
+        filter_moves(&full);
+        for (int i = 0; i < full.count; i++) list->moves[i] = move_pack(&full.moves[i]);
+        list->count = full.count;
+    } else {
+        generate_simple_shift(s, NULL, list);
+    }
+}
+
+int movegen_unpack_move(const GameState *s, const PackedMove packed, Move *out) {
+    DBG_NOT_NULL(out);
+    if (pmove_length(packed) == 0) {
+        // Simple moves carry everything
+        out->path[0] = (uint8_t)pmove_from(packed);
+        out->path[1] = (uint8_t)pmove_to(packed);
+        out->length = 0;
+        out->captured_ladies_count = 0;
+        out->is_lady_move = (uint8_t)pmove_is_lady(packed);
+        out->first_captured_is_lady = 0;
+        return 1;
+    }
+    
+    // Captures: rebuild the chain from the position
+    DBG_NOT_NULL(s);
+    MoveList list;
+    movegen_generate(s, &list);
+    for (int i = 0; i < list.count; i++) {
+        if (move_pack(&list.moves[i]) == packed) {
+            *out = list.moves[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// --- Counting (no Move materialization) ---
+
+typedef struct {
+    Bitboard enemy_ladies;
+    Bitboard all_enemy;
+    Bitboard occupied;
+    Bitboard all_ladies;    // Ladies at chain start (priority metrics)
+    Color us;
+    uint8_t is_lady;
+    int captured[MAX_CHAIN_LENGTH];
+    int best_score;
+    uint64_t best_count;
+} CountContext;
+
+static void count_chain_end(CountContext *ctx, const int depth) {
+    const int safe_depth = (depth > MAX_CHAIN_LENGTH - 1) ? MAX_CHAIN_LENGTH - 1 : depth;
+    int ladies = 0;
+    int first_is_lady = 0;
+    for (int k = 0; k < safe_depth; k++) {
+        if (TEST_BIT(ctx->all_ladies, ctx->captured[k])) {
+            ladies++;
+            if (k == 0) first_is_lady = 1;
+        }
+    }
+    // Same key as calculate_score()
+    const int score = (safe_depth << 24) | (ctx->is_lady << 20) | (ladies << 10) | first_is_lady;
+    if (score > ctx->best_score) {
+        ctx->best_score = score;
+        ctx->best_count = 1;
+    } else if (score == ctx->best_score) {
+        ctx->best_count++;
+    }
+}
+
+// Mirrors find_captures() but only scores chain ends
+static void count_captures(CountContext *ctx, const int current_sq, const int depth) {
+    int found_continuation = 0;
+
+    if (!CAN_JUMP_FROM[current_sq]) {
+        if (depth > 0) count_chain_end(ctx, depth);
+        return;
+    }
+
+    const int start_dir = ctx->is_lady ? 0 : (ctx->us == WHITE ? WHITE_DIR_START : BLACK_DIR_START);
+    const int end_dir   = ctx->is_lady ? NUM_DIRECTIONS : (ctx->us == WHITE ? WHITE_DIR_END : BLACK_DIR_END);
+
+    for (int dir = start_dir; dir < end_dir; dir++) {
+        const Bitboard over_mask = JUMP_OVER_SQ[current_sq][dir];
+        if (!(over_mask & ctx->all_enemy)) continue;
+        if (!ctx->is_lady && (over_mask & ctx->enemy_ladies)) continue;
+
+        const Bitboard land_mask = JUMP_LANDING[current_sq][dir];
+        if (ctx->occupied & land_mask) continue;
+
+        const int land_sq = __builtin_ctzll(land_mask);
+        if (depth < MAX_CHAIN_LENGTH) ctx->captured[depth] = __builtin_ctzll(over_mask);
+        found_continuation = 1;
+
+        if (!ctx->is_lady && TEST_BIT(PROM_RANKS[ctx->us], land_sq)) {
+            count_chain_end(ctx, depth + 1);
+        } else {
+            const Bitboard saved_ladies = ctx->enemy_ladies;
+            const Bitboard saved_all = ctx->all_enemy;
+            const Bitboard saved_occupied = ctx->occupied;
+            
+            ctx->enemy_ladies &= ~over_mask;
+            ctx->all_enemy &= ~over_mask;
+            ctx->occupied &= ~over_mask;
+            
+            count_captures(ctx, land_sq, depth + 1);
+            
+            ctx->enemy_ladies = saved_ladies;
+            ctx->all_enemy = saved_all;
+            ctx->occupied = saved_occupied;
+        }
+    }
+
+    if (!found_continuation && depth > 0) {
+        count_chain_end(ctx, depth);
+    }
+}
+
+static int count_simple_moves(const GameState *s) {
+    const Color us = s->current_player;
+    const Bitboard empty = get_empty_squares(s);
+    const Bitboard pawns = s->piece[us][PAWN];
+    const Bitboard ladies = s->piece[us][LADY];
+    
+    // Forward steps for pawns and ladies, backward steps for ladies only
+    const Bitboard fwd = pawns | ladies;
+    if (us == WHITE) {
+        return __builtin_popcountll(shift_ne(fwd) & empty) + __builtin_popcountll(shift_nw(fwd) & empty) +
+               __builtin_popcountll(shift_se(ladies) & empty) + __builtin_popcountll(shift_sw(ladies) & empty);
+    }
+    return __builtin_popcountll(shift_se(fwd) & empty) + __builtin_popcountll(shift_sw(fwd) & empty) +
+           __builtin_popcountll(shift_ne(ladies) & empty) + __builtin_popcountll(shift_nw(ladies) & empty);
+}
+
+int movegen_has_capture(const GameState *s) {
+    DBG_NOT_NULL(s);
+    const Color us = s->current_player;
+    const Color them = us ^ 1;
+    const Bitboard empty = get_empty_squares(s);
+    const Bitboard pawns = s->piece[us][PAWN];
+    const Bitboard ladies = s->piece[us][LADY];
+    const Bitboard all_enemy = s->piece[them][PAWN] | s->piece[them][LADY];
+    const Bitboard enemy_pawns = s->piece[them][PAWN];
+    
+    // Pawns only jump forward and cannot capture ladies
+    const Bitboard fwd = (us == WHITE)
+        ? (shift_ne(shift_ne(pawns) & enemy_pawns) | shift_nw(shift_nw(pawns) & enemy_pawns))
+        : (shift_se(shift_se(pawns) & enemy_pawns) | shift_sw(shift_sw(pawns) & enemy_pawns));
+    if (fwd & empty) return 1;
+    
+    if (!ladies) return 0;
+    const Bitboard lady = shift_ne(shift_ne(ladies) & all_enemy) | shift_nw(shift_nw(ladies) & all_enemy) |
+                          shift_se(shift_se(ladies) & all_enemy) | shift_sw(shift_sw(ladies) & all_enemy);
+    return (lady & empty) ? 1 : 0;
+}
+
+int movegen_count(const GameState *s) {
+    DBG_NOT_NULL(s);
+    if (!movegen_has_capture(s)) return count_simple_moves(s);
+    
+    const Color us = s->current_player;
+    const Color them = us ^ 1;
+    const Bitboard all_occupied = get_all_occupied(s);
+    
+    CountContext ctx = {
+        .enemy_ladies = s->piece[them][LADY],
+        .all_enemy = s->piece[them][PAWN] | s->piece[them][LADY],
+        .all_ladies = s->piece[WHITE][LADY] | s->piece[BLACK][LADY],
+        .us = us,
+        .best_score = -1,
+        .best_count = 0
+    };
+    
+    for (int piece = PAWN; piece <= LADY; piece++) {
+        Bitboard bb = s->piece[us][piece];
+        while (bb) {
+            const int sq = __builtin_ctzll(bb);
+            if (CAN_JUMP_FROM[sq]) {
+                ctx.is_lady = (piece == LADY);
+                ctx.occupied = all_occupied & ~BIT(sq);
+                ctx.enemy_ladies = s->piece[them][LADY];
+                ctx.all_enemy = s->piece[them][PAWN] | s->piece[them][LADY];
+                count_captures(&ctx, sq, 0);
+            }
+            POP_LSB(bb);
+        }
+    }
+    return (int)ctx.best_count;
+}
+
+int movegen_has_any_move(const GameState *s) {
+    DBG_NOT_NULL(s);
+    // A blocked position can still have a capture
+    return count_simple_moves(s) > 0 || movegen_has_capture(s);
+}
+
+uint64_t movegen_perft(const GameState *s, const int depth) {
+    DBG_NOT_NULL(s);
+    if (depth <= 0) return 1;
+    if (depth == 1) return (uint64_t)movegen_count(s);
+    
+    MoveList list;
+    movegen_generate(s, &list);
+    
+    GameState pos = *s;
+    uint64_t nodes = 0;
+    for (int i = 0; i < list.count; i++) {
+        MoveUndo undo;
+        apply_move_with_undo(&pos, &list.moves[i], &undo);
+        nodes += movegen_perft(&pos, depth - 1);
+        undo_move(&pos, &list.moves[i], &undo);
+    }
+    return nodes;
+}
+
 int movegen_is_square_threatened(const GameState *state, const int square) {
+    // Set-wise test first: most positions have no capture to generate
+    if (!movegen_has_capture(state)) return 0;
     MoveList enemy_moves;
     movegen_generate(state, &enemy_moves);
     
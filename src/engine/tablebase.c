@@ -0,0 +1,588 @@
+/**
+ * tablebase.c - Endgame Tablebases
+ *
+ * Contains: position index (layout_index, layout_position), probing (tablebase_probe), table
+ * files (load_table, write_table, tablebase_open/close) and retrograde
+ * generation (tablebase_generate)
+ */
+
+#include "dama/engine/tablebase.h"
+#include "dama/engine/movegen.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// =============================================================================
+// POSITION INDEX
+// =============================================================================
+
+// Dark squares a pawn can stand on (it promotes on the last rank)
+#define WHITE_PAWN_SPACE    0x0FFFFFFFu     // Rows 0-6
+#define BLACK_PAWN_SPACE    0xFFFFFFF0u     // Rows 1-7
+
+typedef struct {
+    int wp, wl, bp, bl;
+} Material;
+
+typedef struct {
+    Material m;
+    uint64_t n_wp, n_bp, n_wl, n_bl;    // Placements of each group
+    size_t entries;                     // Positions x 2 sides to move
+} Layout;
+
+static uint64_t choose(int n, int k) {
+    if (k < 0 || k > n) return 0;
+    uint64_t r = 1;
+    for (int i = 0; i < k; i++) r = r * (uint64_t)(n - i) / (uint64_t)(i + 1);
+    return r;
+}
+
+static int material_key(const Material *m) {
+    return ((m->wp * 8 + m->wl) * 8 + m->bp) * 8 + m->bl;
+}
+
+static void material_name(const Material *m, char *out, size_t size) {
+    snprintf(out, size, "%dP%dL-%dP%dL", m->wp, m->wl, m->bp, m->bl);
+}
+
+static void layout_init(Layout *l, const Material *m) {
+    l->m = *m;
+    l->n_wp = choose(28, m->wp);
+    l->n_bp = choose(28, m->bp);
+    l->n_wl = choose(32 - m->wp - m->bp, m->wl);
+    l->n_bl = choose(32 - m->wp - m->bp - m->wl, m->bl);
+    l->entries = (size_t)(l->n_wp * l->n_bp * l->n_wl * l->n_bl * 2);
+}
+
+// Full-board bitboard -> mask over the 32 dark squares, and back
+static uint32_t dark_mask(Bitboard bb) {
+    uint32_t m = 0;
+    while (bb) {
+        m |= 1u << DARK_INDEX(__builtin_ctzll(bb));
+        POP_LSB(bb);
+    }
+    return m;
+}
+
+static Bitboard board_mask(uint32_t m) {
+    Bitboard bb = 0;
+    while (m) {
+        bb |= BIT(DARK_SQUARE(__builtin_ctz(m)));
+        m &= m - 1;
+    }
+    return bb;
+}
+
+// Colex rank of the squares of m, numbered among the squares of space
+static uint64_t rank_subset(uint32_t m, uint32_t space) {
+    uint64_t r = 0;
+    int i = 0;
+    while (m) {
+        const int sq = __builtin_ctz(m);
+        const int pos = __builtin_popcount(space & ((1u << sq) - 1));
+        r += choose(pos, ++i);
+        m &= m - 1;
+    }
+    return r;
+}
+
+// The p-th square (from 0) of space
+static uint32_t select_square(uint32_t space, int p) {
+    while (p-- > 0) space &= space - 1;
+    return space & (~space + 1);
+}
+
+static uint32_t unrank_subset(uint64_t r, int k, uint32_t space) {
+    uint32_t m = 0;
+    int n = __builtin_popcount(space);
+    for (int i = k; i >= 1; i--) {
+        int p = i - 1;
+        while (p + 1 < n && choose(p + 1, i) <= r) p++;
+        r -= choose(p, i);
+        m |= select_square(space, p);
+        n = p;
+    }
+    return m;
+}
+
+// Dark masks of a position: [color][piece]
+static void position_masks(const GameState *s, uint32_t masks[2][2]) {
+    for (int c = 0; c < NUM_COLORS; c++) {
+        masks[c][PAWN] = dark_mask(s->piece[c][PAWN]);
+        masks[c][LADY] = dark_mask(s->piece[c][LADY]);
+    }
+}
+
+static Material masks_material(const uint32_t masks[2][2]) {
+    Material m = {
+        __builtin_popcount(masks[WHITE][PAWN]), __builtin_popcount(masks[WHITE][LADY]),
+        __builtin_popcount(masks[BLACK][PAWN]), __builtin_popcount(masks[BLACK][LADY])
+    };
+    return m;
+}
+
+static size_t layout_index(const Layout *l, const uint32_t masks[2][2], Color to_move) {
+    const uint32_t pawns = masks[WHITE][PAWN] | masks[BLACK][PAWN];
+    const uint64_t r_wp = rank_subset(masks[WHITE][PAWN], WHITE_PAWN_SPACE);
+    const uint64_t r_bp = rank_subset(masks[BLACK][PAWN], BLACK_PAWN_SPACE);
+    const uint64_t r_wl = rank_subset(masks[WHITE][LADY], ~pawns);
+    const uint64_t r_bl = rank_subset(masks[BLACK][LADY], ~(pawns | masks[WHITE][LADY]));
+    const uint64_t pos = ((r_wp * l->n_bp + r_bp) * l->n_wl + r_wl) * l->n_bl + r_bl;
+    return (size_t)(pos * 2 + (uint64_t)to_move);
+}
+
+/**
+ * Position of an index entry (moves_without_captures 0, no hash).
+ * @return 0 if the slot is broken (two pawns on one square)
+ */
+static int layout_position(const Layout *l, size_t entry, GameState *s) {
+    uint64_t pos = entry / 2;
+    const uint64_t r_bl = pos % l->n_bl; pos /= l->n_bl;
+    const uint64_t r_wl = pos % l->n_wl; pos /= l->n_wl;
+    const uint64_t r_bp = pos % l->n_bp; pos /= l->n_bp;
+    const uint64_t r_wp = pos;
+
+    const uint32_t wp = unrank_subset(r_wp, l->m.wp, WHITE_PAWN_SPACE);
+    const uint32_t bp = unrank_subset(r_bp, l->m.bp, BLACK_PAWN_SPACE);
+    if (wp & bp) return 0;
+    const uint32_t wl = unrank_subset(r_wl, l->m.wl, ~(wp | bp));
+    const uint32_t bl = unrank_subset(r_bl, l->m.bl, ~(wp | bp | wl));
+
+    memset(s, 0, sizeof(*s));
+    s->piece[WHITE][PAWN] = board_mask(wp);
+    s->piece[WHITE][LADY] = board_mask(wl);
+    s->piece[BLACK][PAWN] = board_mask(bp);
+    s->piece[BLACK][LADY] = board_mask(bl);
+    s->current_player = (Color)(entry & 1);
+    return 1;
+}
+
+// =============================================================================
+// PROBING
+// =============================================================================
+
+static TBResult table_read(const TBTable *t, size_t entry) {
+    return (TBResult)((t->data[entry >> 2] >> ((entry & 3) * 2)) & 3);
+}
+
+TBResult tablebase_probe(const Tablebase *tb, const GameState *s) {
+    const Color us = s->current_player;
+    if (!get_pieces(s, us)) return TB_LOSS;
+    if (!get_pieces(s, (Color)(1 - us))) return TB_UNKNOWN;     // Game already over
+    if (__builtin_popcountll(get_all_occupied(s)) > tb->max_pieces) return TB_UNKNOWN;
+
+    uint32_t masks[2][2];
+    position_masks(s, masks);
+    const Material m = masks_material(masks);
+    const TBTable *t = &tb->tables[material_key(&m)];
+    if (!t->data) return TB_UNKNOWN;
+
+    Layout l;
+    layout_init(&l, &m);
+    return table_read(t, layout_index(&l, masks, us));
+}
+
+// =============================================================================
+// TABLE FILES
+// =============================================================================
+
+typedef struct {
+    char magic[4];              // "DTB1"
+    uint8_t counts[4];          // wp, wl, bp, bl
+    uint64_t entries;
+} TBFileHeader;
+
+#define TB_MAGIC "DTB1"
+
+static size_t table_bytes(size_t entries) {
+    return (entries + 3) / 4;
+}
+
+static void table_path(const char *dir, const Material *m, char *out, size_t size) {
+    char name[32];
+    material_name(m, name, sizeof(name));
+    snprintf(out, size, "%s/%s.wdl", dir, name);
+}
+
+/**
+ * Map the table of m from dir into t.
+ * @return 1 if loaded, 0 if there is no file, -1 if it is corrupt (logged)
+ */
+static int load_table(const char *dir, const Material *m, TBTable *t) {
+    char path[512];
+    table_path(dir, m, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    Layout l;
+    layout_init(&l, m);
+    struct stat st;
+    TBFileHeader header;
+    const size_t bytes = sizeof(header) + table_bytes(l.entries);
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < bytes ||
+        read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, TB_MAGIC, 4) != 0 || header.entries != l.entries ||
+        header.counts[0] != m->wp || header.counts[1] != m->wl ||
+        header.counts[2] != m->bp || header.counts[3] != m->bl) {
+        log_error("[Tablebase] %s is not a valid table", path);
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        log_error("[Tablebase] Cannot map %s", path);
+        return -1;
+    }
+    t->mapping = base;
+    t->mapping_bytes = bytes;
+    t->data = (const uint8_t*)base + sizeof(header);
+    t->entries = l.entries;
+    return 1;
+}
+
+// Written next to the final name and renamed over it when complete
+static int write_table(const char *dir, const Material *m, const uint8_t *data, size_t entries) {
+    char path[512], tmp_path[520];
+    table_path(dir, m, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    TBFileHeader header = { .entries = entries };
+    memcpy(header.magic, TB_MAGIC, 4);
+    header.counts[0] = (uint8_t)m->wp;
+    header.counts[1] = (uint8_t)m->wl;
+    header.counts[2] = (uint8_t)m->bp;
+    header.counts[3] = (uint8_t)m->bl;
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        log_error("[Tablebase] Cannot write %s", tmp_path);
+        return -1;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(data, 1, table_bytes(entries), f) == table_bytes(entries);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp_path, path) != 0) {
+        log_error("[Tablebase] Cannot write %s", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static void table_free(TBTable *t) {
+    if (t->mapping) munmap(t->mapping, t->mapping_bytes);
+    else free((void*)t->data);
+    memset(t, 0, sizeof(*t));
+}
+
+// Every material of n pieces with at least one piece a side, fewest pawns
+// first (the order generation needs: promotions lead to fewer pawns)
+static int materials_of(int n, Material *out) {
+    int count = 0;
+    for (int pawns = 0; pawns <= n; pawns++) {
+        for (int wp = 0; wp <= pawns; wp++) {
+            const int bp = pawns - wp;
+            for (int wl = 0; wl <= n - pawns; wl++) {
+                const int bl = n - pawns - wl;
+                if (wp + wl == 0 || bp + bl == 0) continue;
+                out[count++] = (Material){ wp, wl, bp, bl };
+            }
+        }
+    }
+    return count;
+}
+
+#define TB_MAX_MATERIALS 80     // Per piece count (6 pieces: 70)
+
+int tablebase_open(Tablebase *tb, const char *dir) {
+    memset(tb, 0, sizeof(*tb));
+    int loaded = 0;
+    for (int n = 2; n <= TB_MAX_PIECES; n++) {
+        Material list[TB_MAX_MATERIALS];
+        const int count = materials_of(n, list);
+        for (int i = 0; i < count; i++) {
+            const int res = load_table(dir, &list[i], &tb->tables[material_key(&list[i])]);
+            if (res < 0) {
+                tablebase_close(tb);
+                return -1;
+            }
+            if (res > 0) {
+                loaded++;
+                tb->max_pieces = n;
+            }
+        }
+    }
+    return loaded;
+}
+
+void tablebase_close(Tablebase *tb) {
+    for (int k = 0; k < TB_SIGNATURES; k++) {
+        if (tb->tables[k].data) table_free(&tb->tables[k]);
+    }
+    tb->max_pieces = 0;
+}
+
+
+// =============================================================================
+// GENERATION
+// =============================================================================
+
+#define WORK_BROKEN     4           // Work code of a broken slot (TB_* otherwise)
+#define COUNT_NEVER     0xFF        // A successor is not won for the opponent: never lost
+#define STAMP_NONE      0xFFFF      // Not resolved yet
+
+typedef struct {
+    const Tablebase *tb;        // Finished tables
+    const Layout *layout;       // Table being built
+    int key;
+    uint8_t *work;              // Result per entry: TB_* or WORK_BROKEN
+    uint8_t *count;             // Successors in this table not yet known to be won
+    uint16_t *stamp;            // Pass that resolved the entry
+} TableBuild;
+
+static inline uint16_t stamp_load(const TableBuild *b, size_t e) {
+    return atomic_load_explicit((_Atomic uint16_t*)&b->stamp[e], memory_order_relaxed);
+}
+
+// Settle e (first writer wins); 1 if this call did
+static int resolve_entry(TableBuild *b, size_t e, uint8_t result, uint16_t pass) {
+    uint8_t expected = TB_UNKNOWN;
+    if (!atomic_compare_exchange_strong_explicit((_Atomic uint8_t*)&b->work[e], &expected, result,
+                                                 memory_order_relaxed, memory_order_relaxed)) {
+        return 0;
+    }
+    atomic_store_explicit((_Atomic uint16_t*)&b->stamp[e], pass, memory_order_relaxed);
+    return 1;
+}
+
+// One more successor of e is won for the opponent; 1 if it was the last
+static int count_decrement(TableBuild *b, size_t e) {
+    _Atomic uint8_t *c = (_Atomic uint8_t*)&b->count[e];
+    uint8_t v = atomic_load_explicit(c, memory_order_relaxed);
+    while (v != COUNT_NEVER && v > 0) {
+        if (atomic_compare_exchange_weak_explicit(c, &v, (uint8_t)(v - 1),
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            return v == 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Pass 0 for one entry. Successors outside the table (captures,
+ * promotions) are final: a lost one wins, and one that is not won rules a
+ * loss out. Successors inside are counted for the retrograde passes.
+ */
+static int init_entry(TableBuild *b, size_t e) {
+    GameState s;
+    if (!layout_position(b->layout, e, &s)) {
+        b->work[e] = WORK_BROKEN;
+        return 0;
+    }
+    PackedMoveList list;
+    movegen_generate_packed(&s, &list);
+
+    int pending = 0, never_lost = 0;
+    for (int i = 0; i < list.count; i++) {
+        GameState next = s;
+        apply_packed_move(&next, list.moves[i]);
+        uint32_t masks[2][2];
+        position_masks(&next, masks);
+        const Material m = masks_material(masks);
+        if (material_key(&m) == b->key) {
+            pending++;
+            continue;
+        }
+        const TBResult r = tablebase_probe(b->tb, &next);
+        if (r == TB_LOSS) return resolve_entry(b, e, TB_WIN, 0);
+        if (r != TB_WIN) never_lost = 1;
+    }
+    if (!never_lost && pending == 0) return resolve_entry(b, e, TB_LOSS, 0);
+    b->count[e] = never_lost ? COUNT_NEVER : (uint8_t)pending;
+    return 0;
+}
+
+static int step_square(int sq, int dir) {
+    const int row = ROW(sq), col = COL(sq);
+    switch (dir) {
+        case DIR_NE: return (row < 7 && col < 7) ? sq + OFFSET_NE : -1;
+        case DIR_NW: return (row < 7 && col > 0) ? sq + OFFSET_NW : -1;
+        case DIR_SE: return (row > 0 && col < 7) ? sq + OFFSET_SE : -1;
+        default:     return (row > 0 && col > 0) ? sq + OFFSET_SW : -1;
+    }
+}
+
+/**
+ * Retrograde step from s, just resolved to r: every position one quiet
+ * move earlier (a piece of the side that moved steps back; it had no
+ * capture, or the move was not legal) wins if r is a loss, and loses once
+ * all its successors are won.
+ * @return Positions resolved
+ */
+static int visit_predecessors(TableBuild *b, const GameState *s, TBResult r, uint16_t pass) {
+    const Color them = (Color)(1 - s->current_player);
+    const Bitboard empty = ~get_all_occupied(s);
+    // A pawn came from behind: the other color's pawn directions
+    const int back_start = (them == WHITE) ? BLACK_DIR_START : WHITE_DIR_START;
+    const int back_end = (them == WHITE) ? BLACK_DIR_END : WHITE_DIR_END;
+    int resolved = 0;
+
+    for (int t = PAWN; t <= LADY; t++) {
+        Bitboard pieces = s->piece[them][t];
+        while (pieces) {
+            const int to = __builtin_ctzll(pieces);
+            POP_LSB(pieces);
+            const int d0 = (t == PAWN) ? back_start : 0;
+            const int d1 = (t == PAWN) ? back_end : NUM_DIRECTIONS;
+            for (int d = d0; d < d1; d++) {
+                const int from = step_square(to, d);
+                if (from < 0 || !TEST_BIT(empty, from)) continue;
+                GameState prev = *s;
+                prev.piece[them][t] ^= BIT(to) | BIT(from);
+                prev.current_player = them;
+                if (movegen_has_capture(&prev)) continue;
+
+                uint32_t masks[2][2];
+                position_masks(&prev, masks);
+                const size_t e = layout_index(b->layout, masks, them);
+                if (r == TB_LOSS) resolved += resolve_entry(b, e, TB_WIN, pass);
+                else if (count_decrement(b, e)) resolved += resolve_entry(b, e, TB_LOSS, pass);
+            }
+        }
+    }
+    return resolved;
+}
+
+// Retrograde pass: predecessors of everything the previous pass resolved
+static size_t retrograde_pass(TableBuild *b, uint16_t pass, int threads) {
+    const long long entries = (long long)b->layout->entries;
+    size_t resolved = 0;
+    #pragma omp parallel for schedule(dynamic, 4096) reduction(+:resolved) num_threads(threads)
+    for (long long e = 0; e < entries; e++) {
+        if (stamp_load(b, (size_t)e) != pass - 1) continue;
+        GameState s;
+        layout_position(b->layout, (size_t)e, &s);
+        const TBResult r = (TBResult)atomic_load_explicit((_Atomic uint8_t*)&b->work[e], memory_order_relaxed);
+        resolved += (size_t)visit_predecessors(b, &s, r, pass);
+    }
+    return resolved;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Build the table of m from the finished ones in tb into t.
+ * @param passes Output: passes until nothing changed
+ * @return 0 on success, -1 if out of memory
+ */
+static int build_table(const Tablebase *tb, const Material *m, int threads, TBTable *t, int *passes) {
+    Layout l;
+    layout_init(&l, m);
+    uint8_t *work = calloc(l.entries, 1);
+    uint8_t *count = calloc(l.entries, 1);
+    uint16_t *stamp = malloc(l.entries * sizeof(uint16_t));
+    uint8_t *data = calloc(table_bytes(l.entries), 1);
+    if (!work || !count || !stamp || !data) {
+        free(work);
+        free(count);
+        free(stamp);
+        free(data);
+        return -1;
+    }
+    for (size_t e = 0; e < l.entries; e++) stamp[e] = STAMP_NONE;
+
+    TableBuild b = { .tb = tb, .layout = &l, .key = material_key(m),
+                     .work = work, .count = count, .stamp = stamp };
+    size_t resolved = 0;
+    const long long entries = (long long)l.entries;
+    #pragma omp parallel for schedule(dynamic, 4096) reduction(+:resolved) num_threads(threads)
+    for (long long e = 0; e < entries; e++) {
+        resolved += (size_t)init_entry(&b, (size_t)e);
+    }
+    uint16_t pass = 0;
+    while (resolved > 0 && pass < STAMP_NONE - 1) resolved = retrograde_pass(&b, ++pass, threads);
+    *passes = pass + 1;
+
+    // Never resolved: neither side can force a result
+    for (size_t e = 0; e < l.entries; e++) {
+        uint8_t v = work[e];
+        if (v == TB_UNKNOWN) v = TB_DRAW;
+        else if (v == WORK_BROKEN) v = TB_UNKNOWN;
+        data[e >> 2] |= (uint8_t)(v << ((e & 3) * 2));
+    }
+    free(work);
+    free(count);
+    free(stamp);
+
+    t->data = data;
+    t->entries = l.entries;
+    t->mapping = NULL;
+    return 0;
+}
+
+int tablebase_generate(const char *dir, int max_pieces, const TablebaseGenConfig *cfg) {
+    if (max_pieces < 2 || max_pieces > TB_MAX_PIECES) {
+        log_error("[Tablebase] Tables hold 2 to %d pieces", TB_MAX_PIECES);
+        return -1;
+    }
+#ifdef _OPENMP
+    const int threads = (cfg && cfg->threads > 0) ? cfg->threads : omp_get_max_threads();
+#else
+    const int threads = 1;
+#endif
+
+    Tablebase *tb = calloc(1, sizeof(Tablebase));
+    if (!tb) return -1;
+    int res = 0;
+    for (int n = 2; n <= max_pieces && res == 0; n++) {
+        tb->max_pieces = n;     // Same-count tables are needed as promotions
+        Material list[TB_MAX_MATERIALS];
+        const int count = materials_of(n, list);
+        for (int i = 0; i < count && res == 0; i++) {
+            TBTable *t = &tb->tables[material_key(&list[i])];
+            int loaded = load_table(dir, &list[i], t);
+            if (loaded < 0) {
+                res = -1;
+                break;
+            }
+            if (loaded) continue;
+
+            char name[32];
+            material_name(&list[i], name, sizeof(name));
+            const double t0 = now_seconds();
+            int passes = 0;
+            if (build_table(tb, &list[i], threads, t, &passes) != 0) {
+                log_error("[Tablebase] Out of memory building %s", name);
+                res = -1;
+                break;
+            }
+            if (write_table(dir, &list[i], t->data, t->entries) != 0) {
+                res = -1;
+                break;
+            }
+            if (cfg && cfg->on_table) cfg->on_table(name, t->entries / 2, passes, now_seconds() - t0);
+        }
+    }
+    tablebase_close(tb);
+    free(tb);
+    return res;
+}
@@ -0,0 +1,69 @@
+/**
+ * cnn_backend.c - Accelerator Backend Registry
+ *
+ * Contains: cnn_backend_cpu, cnn_backend_find, cnn_backend_attach,
+ * cnn_backend_attach_named, cnn_backend_detach
+ */
+
+#include "dama/neural/cnn_backend.h"
+#include "dama/neural/cnn.h"
+#include "dama/common/error_codes.h"
+#include <string.h>
+
+// =============================================================================
+// CPU BACKEND
+// =============================================================================
+
+// The "device" is host memory: the model is the weights themselves
+static void* cpu_upload(const CNNWeights *w) {
+    return (void*)w;
+}
+
+static void cpu_release(void *model) {
+    (void)model;
+}
+
+static void cpu_forward(void *model, const CNNPackedInput *in, const CNNPolicySubset *legal,
+                        CNNOutput *outs, int batch) {
+    cnn_forward_packed((const CNNWeights*)model, in, legal, outs, batch);
+}
+
+const CNNBackend cnn_backend_cpu = { "cpu", cpu_upload, cpu_release, cpu_forward };
+
+// =============================================================================
+// REGISTRY
+// =============================================================================
+
+static const CNNBackend *const BACKENDS[] = {
+    &cnn_backend_cpu,
+};
+
+const CNNBackend* cnn_backend_find(const char *name) {
+    if (!name) return NULL;
+    for (size_t i = 0; i < sizeof(BACKENDS) / sizeof(BACKENDS[0]); i++) {
+        if (strcmp(BACKENDS[i]->name, name) == 0) return BACKENDS[i];
+    }
+    return NULL;
+}
+
+int cnn_backend_attach(CNNWeights *w, const CNNBackend *backend) {
+    if (!w || !backend) return ERR_NULL_PTR;
+    void *model = backend->upload(w);
+    if (!model) return ERR_MEMORY;
+    cnn_backend_detach(w);
+    w->backend = backend;
+    w->backend_model = model;
+    return ERR_OK;
+}
+
+int cnn_backend_attach_named(CNNWeights *w, const char *name) {
+    const CNNBackend *backend = cnn_backend_find(name);
+    return backend ? cnn_backend_attach(w, backend) : ERR_INVALID_ARG;
+}
+
+void cnn_backend_detach(CNNWeights *w) {
+    if (!w->backend) return;
+    w->backend->release(w->backend_model);
+    w->backend = NULL;
+    w->backend_model = NULL;
+}
@@ -2,10 +2,14 @@
  * cnn_batch_norm.c - Batch Normalization Operations
  * 
  * Extracted from cnn_core.c and cnn_training.c for better modularity.
- * Contains: batch_norm_forward, batch_norm_forward_relu, batch_norm_backward
+ * Contains: batch_norm_forward, batch_norm_forward_relu, batch_norm_backward,
+ * cnn_fold_batch_norm (inference form of the conv layers: plain, Winograd, sparse conv1;
+ * half-precision heads)
  */
 
 #include "dama/neural/cnn.h"
+#include "dama/neural/conv_ops.h"
+#include "dama/common/math_backend.h"
 #include <math.h>
 
 // =============================================================================
@@ -73,7 +77,6 @@ void batch_norm_forward_relu(
     int is_training
 ) {
     int spatial_size = H * W;
-    #pragma omp parallel for
     for (int c = 0; c < C; c++) {
         float mean, var;
         if (is_training) {
@@ -112,6 +115,46 @@ void batch_norm_forward_relu(
     }
 }
 
+// =============================================================================
+// BATCH NORMALIZATION FOLDING (INFERENCE)
+// =============================================================================
+
+// With running stats BN is affine per channel: y = s*(x - mean) + beta,
+// s = gamma / sqrt(var + eps). Scaling each output filter by s moves it
+// into the conv: w' = s*w, b' = s*(b - mean) + beta
+static void fold_layer(const float *w, const float *b,
+                       const float *gamma, const float *beta,
+                       const float *mean, const float *var,
+                       float *fused_w, float *fused_b, int Co, int filter_size) {
+    for (int c = 0; c < Co; c++) {
+        float s = gamma[c] / sqrtf(var[c] + CNN_BN_EPSILON);
+        for (int i = 0; i < filter_size; i++) {
+            fused_w[c * filter_size + i] = w[c * filter_size + i] * s;
+        }
+        fused_b[c] = (b[c] - mean[c]) * s + beta[c];
+    }
+}
+
+void cnn_fold_batch_norm(CNNWeights *w) {
+    fold_layer(w->conv1_w, w->conv1_b, w->bn1_gamma, w->bn1_beta, w->bn1_mean, w->bn1_var,
+               w->fused_conv1_w, w->fused_conv1_b, 64, CNN_INPUT_CHANNELS * 9);
+    fold_layer(w->conv2_w, w->conv2_b, w->bn2_gamma, w->bn2_beta, w->bn2_mean, w->bn2_var,
+               w->fused_conv2_w, w->fused_conv2_b, 64, 64 * 9);
+    fold_layer(w->conv3_w, w->conv3_b, w->bn3_gamma, w->bn3_beta, w->bn3_mean, w->bn3_var,
+               w->fused_conv3_w, w->fused_conv3_b, 64, 64 * 9);
+    fold_layer(w->conv4_w, w->conv4_b, w->bn4_gamma, w->bn4_beta, w->bn4_mean, w->bn4_var,
+               w->fused_conv4_w, w->fused_conv4_b, 64, 64 * 9);
+    
+    conv3x3_winograd_kernel(w->fused_conv2_w, w->wino_conv2_u, 64, 64);
+    conv3x3_winograd_kernel(w->fused_conv3_w, w->wino_conv3_u, 64, 64);
+    conv3x3_winograd_kernel(w->fused_conv4_w, w->wino_conv4_u, 64, 64);
+    
+    conv3x3_sparse_kernel(w->fused_conv1_w, w->sparse_conv1_w, CNN_INPUT_CHANNELS, 64);
+    
+    vec_f32_to_f16(w->policy_w, w->policy_w_h, 512 * 4097);
+    vec_f32_to_f16(w->value_w1, w->value_w1_h, 256 * 4097);
+}
+
 // =============================================================================
 // BATCH NORMALIZATION BACKWARD PASS
 // =============================================================================
@@ -0,0 +1,117 @@
+/**
+ * cnn_cache.c - Neural Evaluation Cache
+ *
+ * Seqlock-guarded, direct-mapped table of compressed CNNOutput results.
+ */
+
+#include "dama/neural/cnn_cache.h"
+#include "dama/neural/cnn.h"
+#include "dama/engine/movegen.h"
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================================
+// LIFECYCLE
+// =============================================================================
+
+CNNCache* cnn_cache_create(size_t size) {
+    size_t pow2 = 1;
+    while (pow2 * 2 <= size) pow2 *= 2;
+    
+    CNNCache *cache = malloc(sizeof(CNNCache));
+    if (!cache) return NULL;
+    cache->entries = calloc(pow2, sizeof(CNNCacheEntry));
+    if (!cache->entries) {
+        free(cache);
+        return NULL;
+    }
+    cache->size = pow2;
+    cache->mask = pow2 - 1;
+    return cache;
+}
+
+void cnn_cache_free(CNNCache *cache) {
+    if (cache) {
+        free(cache->entries);
+        free(cache);
+    }
+}
+
+void cnn_cache_clear(CNNCache *cache) {
+    if (cache) memset(cache->entries, 0, cache->size * sizeof(CNNCacheEntry));
+}
+
+// =============================================================================
+// KEY
+// =============================================================================
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t cnn_cache_key(const GameState *state, const GameState *hist1, const GameState *hist2) {
+    // Rotations keep (A, B) and (B, A) histories apart; a missing state
+    // gets its own constant so "no history" differs from any real one
+    uint64_t h1 = hist1 ? hist1->hash : 0x9E3779B97F4A7C15ULL;
+    uint64_t h2 = hist2 ? hist2->hash : 0xC2B2AE3D27D4EB4FULL;
+    uint64_t key = state->hash ^ rotl64(h1, 21) ^ rotl64(h2, 42);
+    return key ? key : 1;
+}
+
+// =============================================================================
+// PROBE / STORE
+// =============================================================================
+
+int cnn_cache_probe(CNNCache *cache, uint64_t key, CNNOutput *out) {
+    CNNCacheEntry *e = &cache->entries[key & cache->mask];
+    
+    uint64_t seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+    if ((seq & 1) || e->key != key) return 0;
+    
+    int count = e->count;
+    if (count < 0 || count > CNN_CACHE_MAX_MOVES) return 0;
+    uint16_t index[CNN_CACHE_MAX_MOVES];
+    float prob[CNN_CACHE_MAX_MOVES];
+    float value = e->value;
+    memcpy(index, e->index, count * sizeof(uint16_t));
+    memcpy(prob, e->prob, count * sizeof(float));
+    
+    // Copy is only valid if no writer touched the entry meanwhile
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&e->seq, memory_order_relaxed) != seq || e->key != key) return 0;
+    
+    memset(out->policy, 0, sizeof(out->policy));
+    for (int i = 0; i < count; i++) out->policy[index[i]] = prob[i];
+    out->value = value;
+    return 1;
+}
+
+int cnn_cache_store(CNNCache *cache, uint64_t key, const GameState *state, const CNNOutput *out) {
+    PackedMoveList moves;
+    movegen_generate_packed(state, &moves);
+    if (moves.count > CNN_CACHE_MAX_MOVES) return 0;
+    
+    CNNCacheEntry *e = &cache->entries[key & cache->mask];
+    uint64_t seq = atomic_load_explicit(&e->seq, memory_order_relaxed);
+    if ((seq & 1) || !atomic_compare_exchange_strong_explicit(&e->seq, &seq, seq + 1,
+                                                              memory_order_acquire, memory_order_relaxed)) {
+        return 0; // Another writer owns the slot
+    }
+    atomic_thread_fence(memory_order_release);
+    
+    int evicted = (e->key != 0 && e->key != key);
+    e->key = key;
+    e->value = out->value;
+    int count = 0;
+    for (int i = 0; i < moves.count; i++) {
+        int idx = cnn_packed_move_to_index(moves.moves[i], state->current_player);
+        if (idx < 0) continue;
+        e->index[count] = (uint16_t)idx;
+        e->prob[count] = out->policy[idx];
+        count++;
+    }
+    e->count = count;
+    
+    atomic_store_explicit(&e->seq, seq + 2, memory_order_release);
+    return evicted;
+}
@@ -8,6 +8,8 @@
  */
 
 #include "dama/neural/cnn.h"
+#include "dama/neural/conv_ops.h"
+#include "dama/neural/cnn_backend.h"
 #include "dama/common/rng.h"
 #include "dama/common/debug.h"
 #include <stdlib.h>
@@ -65,6 +67,18 @@ void cnn_init(CNNWeights *w) {
         w->bn1_var[i] = w->bn2_var[i] = w->bn3_var[i] = w->bn4_var[i] = 1.0f;
     }
 
+    // Inference form (filled by cnn_fold_batch_norm below)
+    w->fused_conv1_w = alloc_weights(64 * CNN_INPUT_CHANNELS * 3 * 3); w->fused_conv1_b = alloc_weights(64);
+    w->fused_conv2_w = alloc_weights(64 * 64 * 3 * 3); w->fused_conv2_b = alloc_weights(64);
+    w->fused_conv3_w = alloc_weights(64 * 64 * 3 * 3); w->fused_conv3_b = alloc_weights(64);
+    w->fused_conv4_w = alloc_weights(64 * 64 * 3 * 3); w->fused_conv4_b = alloc_weights(64);
+    w->wino_conv2_u = alloc_weights(WINOGRAD_POINTS * 64 * 64);
+    w->wino_conv3_u = alloc_weights(WINOGRAD_POINTS * 64 * 64);
+    w->wino_conv4_u = alloc_weights(WINOGRAD_POINTS * 64 * 64);
+    w->sparse_conv1_w = alloc_weights(CNN_INPUT_CHANNELS * 3 * 3 * 64);
+    w->policy_w_h = calloc(512 * 4097, sizeof(uint16_t));
+    w->value_w1_h = calloc(256 * 4097, sizeof(uint16_t));
+    
     // Fully connected layers
     w->policy_w = alloc_weights(512 * 4097); w->policy_b = alloc_weights(512);
     w->value_w1 = alloc_weights(256 * 4097); w->value_b1 = alloc_weights(256);
@@ -112,10 +126,19 @@ void cnn_init(CNNWeights *w) {
     for (int i=0; i<256*4097; i++) w->value_w1[i] = random_normal() * scale_fc;
     float scale_v2 = sqrtf(1.0f / 256);
     for (int i=0; i<256; i++) w->value_w2[i] = random_normal() * scale_v2;
+    
+    w->quant = NULL;                // fp32 inference until an int8 form is attached
+    w->backend = NULL;              // Built-in CPU path until a backend is attached
+    w->backend_model = NULL;
+    w->mapping = NULL;
+    w->mapping_bytes = 0;
+    cnn_fold_batch_norm(w);
 }
 
 void cnn_free(CNNWeights *w) {
     DBG_NOT_NULL(w);
+    cnn_backend_detach(w);
+    cnn_unmap_weights(w);           // Mapped tensors are NULL from here on
     // Convolutional layers
     free(w->conv1_w); free(w->conv1_b);
     free(w->conv2_w); free(w->conv2_b);
@@ -132,6 +155,15 @@ void cnn_free(CNNWeights *w) {
     free(w->bn3_mean); free(w->bn3_var);
     free(w->bn4_mean); free(w->bn4_var);
     
+    // Inference form
+    free(w->fused_conv1_w); free(w->fused_conv1_b);
+    free(w->fused_conv2_w); free(w->fused_conv2_b);
+    free(w->fused_conv3_w); free(w->fused_conv3_b);
+    free(w->fused_conv4_w); free(w->fused_conv4_b);
+    free(w->wino_conv2_u); free(w->wino_conv3_u); free(w->wino_conv4_u);
+    free(w->sparse_conv1_w);
+    free(w->policy_w_h); free(w->value_w1_h);
+    
     // Fully connected layers
     free(w->policy_w); free(w->policy_b);
     free(w->value_w1); free(w->value_b1);
@@ -163,3 +195,61 @@ void cnn_free(CNNWeights *w) {
     free(w->v_value_w1); free(w->v_value_b1);
     free(w->v_value_w2); free(w->v_value_b2);
 }
+
+// =============================================================================
+// INFERENCE WORKSPACE
+// =============================================================================
+
+#define WS_ALIGN 64
+
+// Next aligned slice of `bytes` from *p
+static void* ws_carve(char **p, size_t bytes) {
+    void *slice = *p;
+    *p += (bytes + WS_ALIGN - 1) & ~(size_t)(WS_ALIGN - 1);
+    return slice;
+}
+
+CNNWorkspace* cnn_workspace_create(int max_batch) {
+    if (max_batch < 1) max_batch = 1;
+    size_t mb = (size_t)max_batch;
+    size_t sizes[] = {
+        mb * sizeof(CNNSparseInput),
+        mb * 4096 * sizeof(float), mb * 4096 * sizeof(float),
+        mb * 4097 * sizeof(float), mb * 512 * sizeof(float), mb * 256 * sizeof(float),
+        64 * 9 * 64 * sizeof(float),
+        WINOGRAD_WORKSPACE_FLOATS(64, mb) * sizeof(float),
+        WINOGRAD_WORKSPACE_FLOATS(64, mb) * sizeof(float),
+    };
+    size_t total = WS_ALIGN;    // Slack to align the start
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        total += (sizes[i] + WS_ALIGN - 1) & ~(size_t)(WS_ALIGN - 1);
+    }
+    
+    CNNWorkspace *ws = malloc(sizeof(CNNWorkspace));
+    void *block = malloc(total);
+    if (!ws || !block) {
+        free(ws);
+        free(block);
+        return NULL;
+    }
+    
+    char *p = (char*)(((uintptr_t)block + WS_ALIGN - 1) & ~(uintptr_t)(WS_ALIGN - 1));
+    ws->max_batch = max_batch;
+    ws->block = block;
+    ws->inputs = ws_carve(&p, sizes[0]);
+    ws->features = ws_carve(&p, sizes[1]);
+    ws->scratch = ws_carve(&p, sizes[2]);
+    ws->fc = ws_carve(&p, sizes[3]);
+    ws->policy = ws_carve(&p, sizes[4]);
+    ws->value_h = ws_carve(&p, sizes[5]);
+    ws->col = ws_carve(&p, sizes[6]);
+    ws->wino_v = ws_carve(&p, sizes[7]);
+    ws->wino_m = ws_carve(&p, sizes[8]);
+    return ws;
+}
+
+void cnn_workspace_free(CNNWorkspace *ws) {
+    if (!ws) return;
+    free(ws->block);
+    free(ws);
+}
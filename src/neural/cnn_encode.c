@@ -2,16 +2,38 @@
  * cnn_encode.c - Game State Encoding for CNN Input
  * 
  * Extracted from cnn_core.c for better modularity.
- * Contains: encode_state_channels_canonical, cnn_encode_state, cnn_encode_sample
+ * Contains: encode_state_channels_canonical, cnn_encode_state, cnn_encode_sample,
+ * cnn_encode_sparse, cnn_encode_packed, cnn_packed_to_dense, cnn_packed_to_sparse
  */
 
 #include "dama/neural/cnn.h"
+#include "dama/neural/cnn_backend.h"
+#include "dama/common/math_backend.h"
 #include <string.h>
 
 // =============================================================================
 // STATE ENCODING (CANONICAL FORM)
 // =============================================================================
 
+// Rows are bytes: the vertical flip of the canonical form is a byte swap
+static void canonical_planes(const GameState *s, int is_white, Bitboard planes[CNN_PIECE_CHANNELS]) {
+    int me = is_white ? WHITE : BLACK;
+    planes[0] = s->piece[me][PAWN];
+    planes[1] = s->piece[me][LADY];
+    planes[2] = s->piece[!me][PAWN];
+    planes[3] = s->piece[!me][LADY];
+    if (!is_white) {
+        for (int p = 0; p < CNN_PIECE_CHANNELS; p++) planes[p] = __builtin_bswap64(planes[p]);
+    }
+}
+
+// One timestep: its 4 planes written in full (zeros included)
+static void expand_planes(const Bitboard planes[CNN_PIECE_CHANNELS], float *tensor, int channel_offset) {
+    for (int p = 0; p < CNN_PIECE_CHANNELS; p++) {
+        vec_bits_to_f32(planes[p], &tensor[(channel_offset + p) * 64]);
+    }
+}
+
 /**
  * Encode state in CANONICAL FORM.
  * 
@@ -22,27 +44,12 @@
  * - Channel 3: "opponent" ladies
  *
  * If it's Black's turn, the board is flipped vertically so Black "starts from bottom".
+ * Writes the 4 planes in full.
  */
 void encode_state_channels_canonical(const GameState *state, float *tensor, int channel_offset) {
-    int is_white = (state->current_player == WHITE);
-    
-    for (int sq = 0; sq < 64; sq++) {
-        int target_sq = is_white ? sq : flip_square(sq);
-        
-        if (is_white) {
-            // White's perspective: White = "my", Black = "opponent"
-            if (check_bit(state->piece[WHITE][PAWN], sq)) tensor[channel_offset * 64 + target_sq] = 1.0f;
-            if (check_bit(state->piece[WHITE][LADY], sq)) tensor[(channel_offset + 1) * 64 + target_sq] = 1.0f;
-            if (check_bit(state->piece[BLACK][PAWN], sq)) tensor[(channel_offset + 2) * 64 + target_sq] = 1.0f;
-            if (check_bit(state->piece[BLACK][LADY], sq)) tensor[(channel_offset + 3) * 64 + target_sq] = 1.0f;
-        } else {
-            // Black's perspective: Black = "my", White = "opponent" (flipped board)
-            if (check_bit(state->piece[BLACK][PAWN], sq)) tensor[channel_offset * 64 + target_sq] = 1.0f;
-            if (check_bit(state->piece[BLACK][LADY], sq)) tensor[(channel_offset + 1) * 64 + target_sq] = 1.0f;
-            if (check_bit(state->piece[WHITE][PAWN], sq)) tensor[(channel_offset + 2) * 64 + target_sq] = 1.0f;
-            if (check_bit(state->piece[WHITE][LADY], sq)) tensor[(channel_offset + 3) * 64 + target_sq] = 1.0f;
-        }
-    }
+    Bitboard planes[CNN_PIECE_CHANNELS];
+    canonical_planes(state, state->current_player == WHITE, planes);
+    expand_planes(planes, tensor, channel_offset);
 }
 
 // Wrapper for compatibility (uses canonical form)
@@ -51,29 +58,82 @@ void encode_state_channels(const GameState *state, float *tensor, int channel_of
 }
 
 /**
- * Encode a single game state for CNN input.
+ * Encode a single game state for CNN input (history planes empty).
  */
 void cnn_encode_state(const GameState *state, float *tensor, float *player) {
-    memset(tensor, 0, CNN_INPUT_CHANNELS * 64 * sizeof(float));
     encode_state_channels_canonical(state, tensor, 0);
+    memset(&tensor[CNN_PIECE_CHANNELS * 64], 0,
+           (CNN_INPUT_CHANNELS - CNN_PIECE_CHANNELS) * 64 * sizeof(float));
     *player = 1.0f;  // Always "my turn" in canonical form
 }
 
 /**
  * Encode a training sample with history for CNN input.
+ * History planes take the perspective of the side to move, not their own.
  */
 void cnn_encode_sample(const TrainingSample *sample, float *tensor, float *player) {
-    memset(tensor, 0, CNN_INPUT_CHANNELS * 64 * sizeof(float));
-    encode_state_channels_canonical(&sample->state, tensor, 0);
-    // Note: History states need same canonical transform as main state
-    
-    // Temporarily set history player to match main state for consistent encoding
-    GameState hist0 = sample->history[0];
-    GameState hist1 = sample->history[1];
-    hist0.current_player = sample->state.current_player;
-    hist1.current_player = sample->state.current_player;
-    
-    encode_state_channels_canonical(&hist0, tensor, 4);
-    encode_state_channels_canonical(&hist1, tensor, 8);
+    int is_white = (sample->state.current_player == WHITE);
+    Bitboard planes[CNN_PIECE_CHANNELS];
+    canonical_planes(&sample->state, is_white, planes);
+    expand_planes(planes, tensor, 0);
+    canonical_planes(&sample->history[0], is_white, planes);
+    expand_planes(planes, tensor, 4);
+    canonical_planes(&sample->history[1], is_white, planes);
+    expand_planes(planes, tensor, 8);
     *player = 1.0f;  // Always 1.0 in canonical form (it's always "my turn")
 }
+
+// =============================================================================
+// SPARSE ENCODING (SET BITS ONLY)
+// =============================================================================
+
+static void append_bits(const Bitboard planes[CNN_PIECE_CHANNELS], int channel_offset, CNNSparseInput *out) {
+    for (int p = 0; p < CNN_PIECE_CHANNELS; p++) {
+        Bitboard bb = planes[p];
+        while (bb && out->count < CNN_MAX_ACTIVE_INPUTS) {
+            int sq = __builtin_ctzll(bb);
+            bb &= bb - 1;
+            out->index[out->count++] = (uint16_t)((channel_offset + p) * 64 + sq);
+        }
+    }
+}
+
+void cnn_encode_sparse(const GameState *state, const GameState *hist1,
+                       const GameState *hist2, CNNSparseInput *out) {
+    // History uses the perspective of the side to move, as in the dense encoding
+    int is_white = (state->current_player == WHITE);
+    Bitboard planes[CNN_PIECE_CHANNELS];
+    out->count = 0;
+    canonical_planes(state, is_white, planes);
+    append_bits(planes, 0, out);
+    if (hist1) {
+        canonical_planes(hist1, is_white, planes);
+        append_bits(planes, 4, out);
+    }
+    if (hist2) {
+        canonical_planes(hist2, is_white, planes);
+        append_bits(planes, 8, out);
+    }
+}
+
+// =============================================================================
+// PACKED ENCODING (BITBOARDS, ACCELERATOR BACKENDS)
+// =============================================================================
+
+void cnn_encode_packed(const GameState *state, const GameState *hist1,
+                       const GameState *hist2, CNNPackedInput *out) {
+    int is_white = (state->current_player == WHITE);
+    memset(out, 0, sizeof(*out));
+    canonical_planes(state, is_white, out->planes[0]);
+    if (hist1) canonical_planes(hist1, is_white, out->planes[1]);
+    if (hist2) canonical_planes(hist2, is_white, out->planes[2]);
+}
+
+void cnn_packed_to_dense(const CNNPackedInput *in, float *tensor) {
+    for (int t = 0; t < CNN_HISTORY_T; t++) expand_planes(in->planes[t], tensor, t * CNN_PIECE_CHANNELS);
+}
+
+void cnn_packed_to_sparse(const CNNPackedInput *in, CNNSparseInput *out) {
+    out->count = 0;
+    for (int t = 0; t < CNN_HISTORY_T; t++) append_bits(in->planes[t], t * CNN_PIECE_CHANNELS, out);
+}
@@ -4,95 +4,238 @@
 
 #include "dama/neural/cnn.h"
 #include "dama/neural/conv_ops.h"
+#include "dama/neural/cnn_quant.h"
+#include "dama/neural/cnn_backend.h"
 #include "dama/common/debug.h"
+#include "dama/common/logging.h"
+#include "dama/common/trace.h"
+#include "dama/engine/movegen.h"
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
-#include <Accelerate/Accelerate.h>
+#include "dama/common/math_backend.h"
+
+// =============================================================================
+// SETTINGS & FC KERNELS
+// =============================================================================
+
+static CNNConvAlgo conv_algo = CNN_CONV_ALGO_DEFAULT;
+static CNNHeadPrecision head_precision = CNN_HEAD_PRECISION_DEFAULT;
+
+void cnn_set_conv_algo(CNNConvAlgo algo) { conv_algo = algo; }
+CNNConvAlgo cnn_get_conv_algo(void) { return conv_algo; }
+
+void cnn_set_head_precision(CNNHeadPrecision precision) { head_precision = precision; }
+CNNHeadPrecision cnn_get_head_precision(void) { return head_precision; }
+
+// FC head layer: y[rows] += W[rows x 4097] * x, on the fp32 masters (BLAS)
+// or their half copies (bandwidth-bound at batch 1: half the bytes)
+static void fc_gemv(const float *W, const uint16_t *W_h, const float *x, float *y, int rows) {
+    if (head_precision == CNN_HEAD_FP16) {
+        vec_gemv_f16(W_h, 4097, x, y, rows, 4097);
+    } else {
+        cblas_sgemv(CblasRowMajor, CblasNoTrans, rows, 4097, 1.0f, W, 4097, x, 1, 1.0f, y, 1);
+    }
+}
+
+// Batched: Y[batch x rows] += X[batch x 4097] * W^T
+static void fc_gemm(const float *W, const uint16_t *W_h, const float *X, float *Y, int rows, int batch) {
+    if (head_precision == CNN_HEAD_FP16) {
+        vec_gemm_f16(W_h, 4097, X, 4097, Y, rows, rows, 4097, batch);
+    } else {
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, batch, rows, 4097,
+                    1.0f, X, 4097, W, 4097, 1.0f, Y, rows);
+    }
+}
+
+// =============================================================================
+// WORKSPACE
+// =============================================================================
+
+// Default workspace of the calling thread, for forward calls that bring none
+static __thread CNNWorkspace *tls_workspace = NULL;
+
+// The thread's workspace, grown to `batch` positions when memory allows
+// (a smaller one still works, in chunks). NULL only if none exists at all
+static CNNWorkspace* thread_workspace(int batch) {
+    if (tls_workspace && tls_workspace->max_batch >= batch) return tls_workspace;
+    CNNWorkspace *ws = cnn_workspace_create(batch);
+    if (ws) {
+        cnn_workspace_free(tls_workspace);
+        tls_workspace = ws;
+    }
+    return tls_workspace;
+}
+
+// Packed inputs of a batch for the attached backend, grown on demand
+static __thread CNNPackedInput *tls_packed = NULL;
+static __thread int tls_packed_cap = 0;
+
+static CNNPackedInput* thread_packed(int batch) {
+    if (tls_packed_cap >= batch) return tls_packed;
+    CNNPackedInput *p = realloc(tls_packed, (size_t)batch * sizeof(CNNPackedInput));
+    if (!p) return NULL;
+    tls_packed = p;
+    tls_packed_cap = batch;
+    return p;
+}
+
+void cnn_workspace_cleanup(void) {
+    cnn_workspace_free(tls_workspace);
+    tls_workspace = NULL;
+    free(tls_packed);
+    tls_packed = NULL;
+    tls_packed_cap = 0;
+}
+
+// No workspace could be allocated: empty policy, neutral value
+static void forward_oom(CNNOutput *outs, int n) {
+    log_error("[CNN] Out of memory for the inference workspace");
+    for (int b = 0; b < n; b++) {
+        memset(outs[b].policy, 0, sizeof(outs[b].policy));
+        outs[b].value = 0.0f;
+    }
+}
 
 // =============================================================================
 // FORWARD PASS
 // =============================================================================
 
+// Conv backbone (BN folded into the weights, ReLU fused) for the first
+// `batch` inputs of ws into ws->features. Conv1 reads the set bits directly
+static void forward_backbone(const CNNWeights *w, CNNWorkspace *ws, int batch) {
+    float *features = ws->features, *scratch = ws->scratch;
+    int threads = conv_threads(batch);
+    #pragma omp parallel for num_threads(threads) if (threads > 1)
+    for (int b = 0; b < batch; b++) {
+        conv3x3_sparse_relu(w->sparse_conv1_w, w->fused_conv1_b, &ws->inputs[b], &scratch[b * 4096], 64);
+    }
+    
+    if (conv_algo == CNN_CONV_WINOGRAD) {
+        // Whole batch per layer: the tiles of every position share one GEMM
+        conv3x3_winograd_relu_ws(scratch, w->wino_conv2_u, w->fused_conv2_b, features, CONV2_SHAPE,
+                                 batch, ws->wino_v, ws->wino_m);
+        conv3x3_winograd_relu_ws(features, w->wino_conv3_u, w->fused_conv3_b, scratch, CONV3_SHAPE,
+                                 batch, ws->wino_v, ws->wino_m);
+        conv3x3_winograd_relu_ws(scratch, w->wino_conv4_u, w->fused_conv4_b, features, CONV4_SHAPE,
+                                 batch, ws->wino_v, ws->wino_m);
+        return;
+    }
+    
+    for (int b = 0; b < batch; b++) {
+        float *tmp = &scratch[b * 4096], *out = &features[b * 4096];
+        conv2d_forward_relu_col(tmp, w->fused_conv2_w, w->fused_conv2_b, out, CONV2_SHAPE, ws->col);
+        conv2d_forward_relu_col(out, w->fused_conv3_w, w->fused_conv3_b, tmp, CONV3_SHAPE, ws->col);
+        conv2d_forward_relu_col(tmp, w->fused_conv4_w, w->fused_conv4_b, out, CONV4_SHAPE, ws->col);
+    }
+}
+
+// Policy over a subset of rows: one dot product per listed index
+// (gathered GEMV), softmax over those logits, 0 elsewhere
+static void policy_head_subset(const CNNWeights *w, const float *fc_input,
+                               const CNNPolicySubset *subset, float *policy) {
+    float logits[MAX_MOVES];
+    memset(policy, 0, CNN_POLICY_SIZE * sizeof(float));
+    if (subset->count <= 0) return;
+    
+    for (int i = 0; i < subset->count; i++) {
+        int row = subset->index[i];
+        logits[i] = w->policy_b[row] + (head_precision == CNN_HEAD_FP16
+                    ? vec_dot_f16(&w->policy_w_h[row * 4097], fc_input, 4097)
+                    : cblas_sdot(4097, &w->policy_w[row * 4097], 1, fc_input, 1));
+    }
+    vec_softmax(logits, logits, subset->count);
+    for (int i = 0; i < subset->count; i++) policy[subset->index[i]] = logits[i];
+}
+
+/**
+ * Whole network on the first `batch` encoded inputs of ws. The FC heads
+ * run as one GEMM per head (GEMV for a single position); legal == NULL
+ * computes the full policy, otherwise one subset per sample.
+ */
+static void forward_encoded(const CNNWeights *w, CNNWorkspace *ws, const CNNPolicySubset *legal,
+                            CNNOutput *outs, int batch) {
+    float *fc_inputs = ws->fc, *policy_outs = ws->policy, *value_hs = ws->value_h;
+    
+    // Conv1-4 (BN folded into the conv weights, ReLU fused)
+    forward_backbone(w, ws, batch);
+    
+    // Flatten + Player (always 1.0 in canonical form: "my turn")
+    for (int b = 0; b < batch; b++) {
+        memcpy(&fc_inputs[b * 4097], &ws->features[b * 4096], 4096 * sizeof(float));
+        fc_inputs[b * 4097 + 4096] = 1.0f;
+    }
+    
+    // =========================================================================
+    // Policy Head: the requested rows per sample, or all 512
+    // policy_outs[batch x 512] = fc_inputs[batch x 4097] * policy_w^T[4097 x 512]
+    // =========================================================================
+    
+    if (legal) {
+        for (int b = 0; b < batch; b++) {
+            policy_head_subset(w, &fc_inputs[b * 4097], &legal[b], outs[b].policy);
+        }
+    } else {
+        for (int b = 0; b < batch; b++) {
+            memcpy(&policy_outs[b * 512], w->policy_b, 512 * sizeof(float));
+        }
+        if (batch == 1) fc_gemv(w->policy_w, w->policy_w_h, fc_inputs, policy_outs, 512);
+        else fc_gemm(w->policy_w, w->policy_w_h, fc_inputs, policy_outs, 512, batch);
+        
+        // Per-sample softmax (vectorized) into the output
+        for (int b = 0; b < batch; b++) {
+            vec_softmax(&policy_outs[b * 512], outs[b].policy, 512);
+        }
+    }
+    
+    // =========================================================================
+    // Value Head
+    // value_hs[batch x 256] = fc_inputs[batch x 4097] * value_w1^T[4097 x 256]
+    // =========================================================================
+    
+    for (int b = 0; b < batch; b++) {
+        memcpy(&value_hs[b * 256], w->value_b1, 256 * sizeof(float));
+    }
+    if (batch == 1) fc_gemv(w->value_w1, w->value_w1_h, fc_inputs, value_hs, 256);
+    else fc_gemm(w->value_w1, w->value_w1_h, fc_inputs, value_hs, 256, batch);
+    
+    // ReLU + final linear per-sample (value_w2 is just 256 -> 1)
+    for (int b = 0; b < batch; b++) {
+        float *vh = &value_hs[b * 256];
+        float v_sum = w->value_b2[0];
+        for (int i = 0; i < 256; i++) v_sum += relu(vh[i]) * w->value_w2[i];
+        outs[b].value = tanh_act(v_sum);
+    }
+}
+
 // NOTE: cnn_forward() without history has been removed.
 // Use cnn_forward_with_history() for all inference with proper history support.
 
 void cnn_forward_with_history(const CNNWeights *w, const GameState *state, 
                             const GameState *hist1, const GameState *hist2, 
                             CNNOutput *out) {
+    cnn_forward_legal(w, state, hist1, hist2, NULL, out);
+}
+
+void cnn_forward_legal(const CNNWeights *w, const GameState *state,
+                       const GameState *hist1, const GameState *hist2,
+                       const CNNPolicySubset *legal, CNNOutput *out) {
     DBG_NOT_NULL(w);
     DBG_NOT_NULL(state);
     DBG_NOT_NULL(out);
-    float player = 1.0f;  // Canonical form: always "my turn"
-    float input[CNN_INPUT_CHANNELS * 64];
-    memset(input, 0, sizeof(input));
-    
-    extern void encode_state_channels_canonical(const GameState *state, float *tensor, int channel_offset);
-    encode_state_channels_canonical(state, input, 0);
-    
-    // Encode history with same player perspective for consistent canonical form
-    if (hist1) {
-        GameState h1 = *hist1;
-        h1.current_player = state->current_player;
-        encode_state_channels_canonical(&h1, input, 4);
+    if (w->quant) {
+        cnn_quant_forward(w->quant, state, hist1, hist2, legal, out);
+        return;
     }
-    if (hist2) {
-        GameState h2 = *hist2;
-        h2.current_player = state->current_player;
-        encode_state_channels_canonical(&h2, input, 8);
+    CNNWorkspace *ws = thread_workspace(1);
+    if (!ws) {
+        forward_oom(out, 1);
+        return;
     }
-
-    // Buffers for activations
-    float conv1_out[64 * 64], bn1_out[64 * 64];
-    float conv2_out[64 * 64], bn2_out[64 * 64];
-    float conv3_out[64 * 64], bn3_out[64 * 64];
-    float conv4_out[64 * 64], bn4_out[64 * 64];
-    float fc_input[4097], policy_out[512], value_h[256];
-
-    // Layer 1 (Fused BN+ReLU)
-    conv2d_forward_s(input, w->conv1_w, w->conv1_b, conv1_out, CONV1_SHAPE);
-    batch_norm_forward_relu(conv1_out, w->bn1_gamma, w->bn1_beta, bn1_out, NULL, NULL, NULL, w->bn1_mean, w->bn1_var, 64, 8, 8, 0);
-
-    // Layer 2
-    conv2d_forward_s(bn1_out, w->conv2_w, w->conv2_b, conv2_out, CONV2_SHAPE);
-    batch_norm_forward_relu(conv2_out, w->bn2_gamma, w->bn2_beta, bn2_out, NULL, NULL, NULL, w->bn2_mean, w->bn2_var, 64, 8, 8, 0);
-
-    // Layer 3
-    conv2d_forward_s(bn2_out, w->conv3_w, w->conv3_b, conv3_out, CONV3_SHAPE);
-    batch_norm_forward_relu(conv3_out, w->bn3_gamma, w->bn3_beta, bn3_out, NULL, NULL, NULL, w->bn3_mean, w->bn3_var, 64, 8, 8, 0);
-
-    // Layer 4
-    conv2d_forward_s(bn3_out, w->conv4_w, w->conv4_b, conv4_out, CONV4_SHAPE);
-    batch_norm_forward_relu(conv4_out, w->bn4_gamma, w->bn4_beta, bn4_out, NULL, NULL, NULL, w->bn4_mean, w->bn4_var, 64, 8, 8, 0);
-
-    // Flatten + Player
-    memcpy(fc_input, bn4_out, 4096 * sizeof(float));
-    fc_input[4096] = player;
-
-    // Policy Head (BLAS optimized)
-    memcpy(policy_out, w->policy_b, 512 * sizeof(float));
-    cblas_sgemv(CblasRowMajor, CblasNoTrans, 512, 4097, 1.0f, 
-                w->policy_w, 4097, fc_input, 1, 1.0f, policy_out, 1);
     
-    // Softmax (vDSP vectorized)
-    float max_p;
-    vDSP_maxv(policy_out, 1, &max_p, 512);
-    float neg_max = -max_p;
-    vDSP_vsadd(policy_out, 1, &neg_max, policy_out, 1, 512);
-    int n512 = 512;
-    vvexpf(policy_out, policy_out, &n512);
-    float sum_exp;
-    vDSP_sve(policy_out, 1, &sum_exp, 512);
-    vDSP_vsdiv(policy_out, 1, &sum_exp, out->policy, 1, 512);
-
-    // Value Head (BLAS optimized)
-    memcpy(value_h, w->value_b1, 256 * sizeof(float));
-    cblas_sgemv(CblasRowMajor, CblasNoTrans, 256, 4097, 1.0f,
-                w->value_w1, 4097, fc_input, 1, 1.0f, value_h, 1);
-    for (int i = 0; i < 256; i++) value_h[i] = relu(value_h[i]);
-    float v_sum = w->value_b2[0];
-    for (int i = 0; i < 256; i++) v_sum += value_h[i] * w->value_w2[i];
-    out->value = tanh_act(v_sum);
+    // History is encoded from the side to move's perspective (canonical form)
+    cnn_encode_sparse(state, hist1, hist2, &ws->inputs[0]);
+    forward_encoded(w, ws, legal, out, 1);
 }
 
 // =============================================================================
@@ -100,8 +243,10 @@ void cnn_forward_with_history(const CNNWeights *w, const GameState *state,
 // =============================================================================
 
 /**
- * Batch forward pass for multiple states. Uses BLAS sgemm for FC layers.
- * Convolutions are still per-sample (no efficient batch conv in Accelerate).
+ * Batch forward pass for multiple states. FC layers as one GEMM per head
+ * (BLAS sgemm, or the fp16 kernel under CNN_HEAD_FP16).
+ * With CNN_CONV_WINOGRAD the convolutions run on the whole batch too
+ * (im2col: per sample).
  * 
  * @param w        Network weights
  * @param states   Array of game states (batch_size)
@@ -116,210 +261,112 @@ void cnn_forward_batch(const CNNWeights *w,
                        const GameState **hist2s,
                        CNNOutput *outs, 
                        int batch_size) {
+    cnn_forward_batch_legal(w, states, hist1s, hist2s, NULL, outs, batch_size);
+}
+
+void cnn_forward_batch_legal(const CNNWeights *w,
+                             const GameState **states,
+                             const GameState **hist1s,
+                             const GameState **hist2s,
+                             const CNNPolicySubset *legal,
+                             CNNOutput *outs,
+                             int batch_size) {
     if (batch_size <= 0) return;
-    
-    // Fallback to single forward if batch is small
-    if (batch_size == 1) {
-        cnn_forward_with_history(w, states[0], 
-                                hist1s ? hist1s[0] : NULL, 
-                                hist2s ? hist2s[0] : NULL, 
-                                &outs[0]);
+    int builtin = !w->backend && !w->quant;
+    CNNWorkspace *ws = builtin ? thread_workspace(batch_size) : NULL;
+    if (builtin && !ws) {
+        forward_oom(outs, batch_size);
         return;
     }
-    
-    // Allocate batch buffers (stack for small batches, heap for large)
-    #define MAX_STACK_BATCH 16
-    float _stack_fc[MAX_STACK_BATCH * 4097];
-    float _stack_policy[MAX_STACK_BATCH * 512];
-    float _stack_value_h[MAX_STACK_BATCH * 256];
-    
-    float *fc_inputs = (batch_size <= MAX_STACK_BATCH) ? _stack_fc : malloc(batch_size * 4097 * sizeof(float));
-    float *policy_outs = (batch_size <= MAX_STACK_BATCH) ? _stack_policy : malloc(batch_size * 512 * sizeof(float));
-    float *value_hs = (batch_size <= MAX_STACK_BATCH) ? _stack_value_h : malloc(batch_size * 256 * sizeof(float));
-    
-    // Check for memory allocation failure - fallback to sequential processing on OOM
-    if (batch_size > MAX_STACK_BATCH && (!fc_inputs || !policy_outs || !value_hs)) {
-        free(fc_inputs);
-        free(policy_outs);
-        free(value_hs);
+    cnn_forward_batch_legal_ws(w, ws, states, hist1s, hist2s, legal, outs, batch_size);
+}
+
+static void forward_batch_ws(const CNNWeights *w, CNNWorkspace *ws,
+                             const GameState **states,
+                             const GameState **hist1s,
+                             const GameState **hist2s,
+                             const CNNPolicySubset *legal,
+                             CNNOutput *outs,
+                             int batch_size) {
+    // Attached backend: the whole batch as packed bitboards in one call
+    if (w->backend) {
+        CNNPackedInput *packed = thread_packed(batch_size);
+        if (!packed) {
+            forward_oom(outs, batch_size);
+            return;
+        }
         for (int b = 0; b < batch_size; b++) {
-            cnn_forward_with_history(w, states[b], 
-                hist1s ? hist1s[b] : NULL, 
-                hist2s ? hist2s[b] : NULL, &outs[b]);
+            cnn_encode_packed(states[b], hist1s ? hist1s[b] : NULL, hist2s ? hist2s[b] : NULL,
+                              &packed[b]);
         }
+        w->backend->forward(w->backend_model, packed, legal, outs, batch_size);
         return;
     }
     
-    extern void encode_state_channels_canonical(const GameState *state, float *tensor, int channel_offset);
-    
-    // Per-sample convolutions (Accelerate doesn't batch these efficiently yet)
-    // Future optimization: layout transformation for im2col batching
-    for (int b = 0; b < batch_size; b++) {
-        float input[CNN_INPUT_CHANNELS * 64];
-        memset(input, 0, sizeof(input));
-        encode_state_channels_canonical(states[b], input, 0);
-        
-        if (hist1s && hist1s[b]) {
-            GameState h1 = *hist1s[b];
-            h1.current_player = states[b]->current_player;
-            encode_state_channels_canonical(&h1, input, 4);
-        }
-        if (hist2s && hist2s[b]) {
-            GameState h2 = *hist2s[b];
-            h2.current_player = states[b]->current_player;
-            encode_state_channels_canonical(&h2, input, 8);
+    // Int8: per sample (GEMV kernels, the weights stay in cache across samples)
+    if (w->quant) {
+        for (int b = 0; b < batch_size; b++) {
+            cnn_quant_forward(w->quant, states[b],
+                              hist1s ? hist1s[b] : NULL,
+                              hist2s ? hist2s[b] : NULL,
+                              legal ? &legal[b] : NULL, &outs[b]);
         }
-        
-        float conv1_out[64 * 64], bn1_out[64 * 64];
-        float conv2_out[64 * 64], bn2_out[64 * 64];
-        float conv3_out[64 * 64], bn3_out[64 * 64];
-        float conv4_out[64 * 64], bn4_out[64 * 64];
-        
-        conv2d_forward_s(input, w->conv1_w, w->conv1_b, conv1_out, CONV1_SHAPE);
-        batch_norm_forward_relu(conv1_out, w->bn1_gamma, w->bn1_beta, bn1_out, NULL, NULL, NULL, w->bn1_mean, w->bn1_var, 64, 8, 8, 0);
-        
-        conv2d_forward_s(bn1_out, w->conv2_w, w->conv2_b, conv2_out, CONV2_SHAPE);
-        batch_norm_forward_relu(conv2_out, w->bn2_gamma, w->bn2_beta, bn2_out, NULL, NULL, NULL, w->bn2_mean, w->bn2_var, 64, 8, 8, 0);
-        
-        conv2d_forward_s(bn2_out, w->conv3_w, w->conv3_b, conv3_out, CONV3_SHAPE);
-        batch_norm_forward_relu(conv3_out, w->bn3_gamma, w->bn3_beta, bn3_out, NULL, NULL, NULL, w->bn3_mean, w->bn3_var, 64, 8, 8, 0);
-        
-        conv2d_forward_s(bn3_out, w->conv4_w, w->conv4_b, conv4_out, CONV4_SHAPE);
-        batch_norm_forward_relu(conv4_out, w->bn4_gamma, w->bn4_beta, bn4_out, NULL, NULL, NULL, w->bn4_mean, w->bn4_var, 64, 8, 8, 0);
-        
-        // Store flattened + player for batch FC
-        memcpy(&fc_inputs[b * 4097], bn4_out, 4096 * sizeof(float));
-        fc_inputs[b * 4097 + 4096] = 1.0f;  // Player always 1.0 in canonical form
-    }
-    
-    // =========================================================================
-    // BATCH FC: Policy Head (sgemm instead of sgemv)
-    // policy_outs[batch_size x 512] = fc_inputs[batch_size x 4097] * policy_w^T[4097 x 512]
-    // =========================================================================
-    
-    // Initialize with bias (broadcast)
-    for (int b = 0; b < batch_size; b++) {
-        memcpy(&policy_outs[b * 512], w->policy_b, 512 * sizeof(float));
-    }
-    
-    // Batched matrix multiply: C = A * B^T + C
-    // A = fc_inputs [batch_size x 4097]
-    // B = policy_w  [512 x 4097]
-    // C = policy_outs [batch_size x 512]
-    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans,
-                batch_size, 512, 4097,       // M, N, K
-                1.0f,                         // alpha
-                fc_inputs, 4097,              // A, lda
-                w->policy_w, 4097,            // B, ldb
-                1.0f,                         // beta
-                policy_outs, 512);            // C, ldc
-    
-    // Per-sample softmax and copy to output
-    for (int b = 0; b < batch_size; b++) {
-        float *p = &policy_outs[b * 512];
-        float max_p;
-        vDSP_maxv(p, 1, &max_p, 512);
-        float neg_max = -max_p;
-        vDSP_vsadd(p, 1, &neg_max, p, 1, 512);
-        int n512 = 512;
-        vvexpf(p, p, &n512);
-        float sum_exp;
-        vDSP_sve(p, 1, &sum_exp, 512);
-        vDSP_vsdiv(p, 1, &sum_exp, outs[b].policy, 1, 512);
+        return;
     }
+    DBG_NOT_NULL(ws);
     
-    // =========================================================================
-    // BATCH FC: Value Head (sgemm for hidden layer)
-    // value_hs[batch_size x 256] = fc_inputs[batch_size x 4097] * value_w1^T[4097 x 256]
-    // =========================================================================
-    
-    for (int b = 0; b < batch_size; b++) {
-        memcpy(&value_hs[b * 256], w->value_b1, 256 * sizeof(float));
+    for (int start = 0; start < batch_size; start += ws->max_batch) {
+        int n = batch_size - start < ws->max_batch ? batch_size - start : ws->max_batch;
+        for (int b = 0; b < n; b++) {
+            int i = start + b;
+            cnn_encode_sparse(states[i], hist1s ? hist1s[i] : NULL, hist2s ? hist2s[i] : NULL,
+                              &ws->inputs[b]);
+        }
+        forward_encoded(w, ws, legal ? &legal[start] : NULL, &outs[start], n);
     }
-    
-    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans,
-                batch_size, 256, 4097,
-                1.0f,
-                fc_inputs, 4097,
-                w->value_w1, 4097,
-                1.0f,
-                value_hs, 256);
-    
-    // ReLU + final linear per-sample (value_w2 is just 256 -> 1)
-    for (int b = 0; b < batch_size; b++) {
-        float *vh = &value_hs[b * 256];
-        for (int i = 0; i < 256; i++) vh[i] = vh[i] > 0 ? vh[i] : 0;  // ReLU
-        
-        float v_sum = w->value_b2[0];
-        for (int i = 0; i < 256; i++) v_sum += vh[i] * w->value_w2[i];
-        outs[b].value = tanhf(v_sum);
+}
+
+void cnn_forward_batch_legal_ws(const CNNWeights *w, CNNWorkspace *ws,
+                                const GameState **states,
+                                const GameState **hist1s,
+                                const GameState **hist2s,
+                                const CNNPolicySubset *legal,
+                                CNNOutput *outs,
+                                int batch_size) {
+    TRACE_BEGIN(t0);
+    forward_batch_ws(w, ws, states, hist1s, hist2s, legal, outs, batch_size);
+    TRACE_END("cnn_forward_batch", t0);
+}
+
+void cnn_forward_packed(const CNNWeights *w, const CNNPackedInput *in,
+                        const CNNPolicySubset *legal, CNNOutput *outs, int batch) {
+    if (batch <= 0) return;
+    CNNWorkspace *ws = thread_workspace(batch);
+    if (!ws) {
+        forward_oom(outs, batch);
+        return;
     }
-    
-    // Cleanup if heap allocated
-    if (batch_size > MAX_STACK_BATCH) {
-        free(fc_inputs);
-        free(policy_outs);
-        free(value_hs);
+    for (int start = 0; start < batch; start += ws->max_batch) {
+        int n = batch - start < ws->max_batch ? batch - start : ws->max_batch;
+        for (int b = 0; b < n; b++) cnn_packed_to_sparse(&in[start + b], &ws->inputs[b]);
+        forward_encoded(w, ws, legal ? &legal[start] : NULL, &outs[start], n);
     }
-    #undef MAX_STACK_BATCH
 }
 
 void cnn_forward_sample(const CNNWeights *w, const TrainingSample *sample, CNNOutput *out) {
-    float player;
-    float input[CNN_INPUT_CHANNELS * 64];
-    cnn_encode_sample(sample, input, &player);
-
-    // Buffers for activations
-    float conv1_out[64 * 64], bn1_out[64 * 64];
-    float conv2_out[64 * 64], bn2_out[64 * 64];
-    float conv3_out[64 * 64], bn3_out[64 * 64];
-    float conv4_out[64 * 64], bn4_out[64 * 64];
-    float fc_input[4097], policy_out[512], value_h[256];
-
-    // Layer 1 (Fused BN+ReLU)
-    conv2d_forward_s(input, w->conv1_w, w->conv1_b, conv1_out, CONV1_SHAPE);
-    batch_norm_forward_relu(conv1_out, w->bn1_gamma, w->bn1_beta, bn1_out, NULL, NULL, NULL, w->bn1_mean, w->bn1_var, 64, 8, 8, 0);
-
-    // Layer 2
-    conv2d_forward_s(bn1_out, w->conv2_w, w->conv2_b, conv2_out, CONV2_SHAPE);
-    batch_norm_forward_relu(conv2_out, w->bn2_gamma, w->bn2_beta, bn2_out, NULL, NULL, NULL, w->bn2_mean, w->bn2_var, 64, 8, 8, 0);
-
-    // Layer 3
-    conv2d_forward_s(bn2_out, w->conv3_w, w->conv3_b, conv3_out, CONV3_SHAPE);
-    batch_norm_forward_relu(conv3_out, w->bn3_gamma, w->bn3_beta, bn3_out, NULL, NULL, NULL, w->bn3_mean, w->bn3_var, 64, 8, 8, 0);
-
-    // Layer 4
-    conv2d_forward_s(bn3_out, w->conv4_w, w->conv4_b, conv4_out, CONV4_SHAPE);
-    batch_norm_forward_relu(conv4_out, w->bn4_gamma, w->bn4_beta, bn4_out, NULL, NULL, NULL, w->bn4_mean, w->bn4_var, 64, 8, 8, 0);
-
-    // Flatten + Player
-    memcpy(fc_input, bn4_out, 4096 * sizeof(float));
-    fc_input[4096] = player;
-
-    // Policy Head (BLAS optimized)
-    memcpy(policy_out, w->policy_b, 512 * sizeof(float));
-    cblas_sgemv(CblasRowMajor, CblasNoTrans, 512, 4097, 1.0f, 
-                w->policy_w, 4097, fc_input, 1, 1.0f, policy_out, 1);
+    if (w->quant) {
+        cnn_quant_forward(w->quant, &sample->state, &sample->history[0], &sample->history[1], NULL, out);
+        return;
+    }
+    CNNWorkspace *ws = thread_workspace(1);
+    if (!ws) {
+        forward_oom(out, 1);
+        return;
+    }
     
-    // Softmax (vDSP vectorized)
-    float max_p;
-    vDSP_maxv(policy_out, 1, &max_p, 512);
-    float neg_max = -max_p;
-    vDSP_vsadd(policy_out, 1, &neg_max, policy_out, 1, 512);
-    int n512 = 512;
-    vvexpf(policy_out, policy_out, &n512);
-    float sum_exp;
-    vDSP_sve(policy_out, 1, &sum_exp, 512);
-    vDSP_vsdiv(policy_out, 1, &sum_exp, out->policy, 1, 512);
-
-    // Value Head (BLAS optimized)
-    memcpy(value_h, w->value_b1, 256 * sizeof(float));
-    cblas_sgemv(CblasRowMajor, CblasNoTrans, 256, 4097, 1.0f,
-                w->value_w1, 4097, fc_input, 1, 1.0f, value_h, 1);
-    for (int i = 0; i < 256; i++) value_h[i] = relu(value_h[i]);
-    float v_sum = w->value_b2[0];
-    for (int i = 0; i < 256; i++) v_sum += value_h[i] * w->value_w2[i];
-    out->value = tanh_act(v_sum);
+    // Canonical form, as cnn_encode_sample
+    cnn_encode_sparse(&sample->state, &sample->history[0], &sample->history[1], &ws->inputs[0]);
+    forward_encoded(w, ws, NULL, out, 1);
 }
 
 // =============================================================================
@@ -340,9 +387,7 @@ int get_move_direction(int from, int to) {
     return -1;
 }
 
-int cnn_move_to_index(const Move *move, int color) {
-    int from = move->path[0];
-    int to = (move->length == 0) ? move->path[1] : move->path[1]; // First jump defines direction
+static int squares_to_index(int from, int to, int color) {
     int dir = get_move_direction(from, to);
     if (dir == -1) return -1;
     
@@ -365,6 +410,30 @@ int cnn_move_to_index(const Move *move, int color) {
     return from * 8 + dir;
 }
 
+int cnn_move_to_index(const Move *move, int color) {
+    // First jump defines direction
+    return squares_to_index(move->path[0], move->path[1], color);
+}
+
+int cnn_packed_move_to_index(PackedMove move, int color) {
+    return squares_to_index(pmove_from(move), pmove_step(move), color);
+}
+
+void cnn_policy_subset(const GameState *state, CNNPolicySubset *out) {
+    PackedMoveList moves;
+    movegen_generate_packed(state, &moves);
+    
+    // Distinct rows only: colliding moves share one probability
+    uint64_t seen[CNN_POLICY_SIZE / 64] = {0};
+    out->count = 0;
+    for (int i = 0; i < moves.count; i++) {
+        int idx = cnn_packed_move_to_index(moves.moves[i], state->current_player);
+        if (idx < 0 || idx >= CNN_POLICY_SIZE || (seen[idx >> 6] >> (idx & 63)) & 1) continue;
+        seen[idx >> 6] |= 1ULL << (idx & 63);
+        out->index[out->count++] = (int16_t)idx;
+    }
+}
+
 float cnn_get_move_prior(const CNNWeights *w, const GameState *state, 
                          const GameState *hist1, const GameState *hist2,
                          const Move *move) {
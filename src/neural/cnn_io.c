@@ -1,55 +1,357 @@
 /**
  * cnn_io.c - CNN Weight I/O Operations
- * 
- * Contains: cnn_save_weights, cnn_load_weights
+ *
+ * Contains: cnn_save_weights, cnn_load_weights (model file v2, mmap-loaded;
+ * legacy raw files still readable), cnn_release_mapping, cnn_unmap_weights
+ *
+ * v2 layout: CNNModelHeader, CNNModelTensor table, then one 64-byte-aligned
+ * payload per tensor. The file is mapped MAP_PRIVATE and the weight pointers
+ * point into it: read-only users (search, tournament, GUI) share the page
+ * cache across processes, writers (training) get private copy-on-write pages.
  */
 
 #include "dama/neural/cnn.h"
+#include "dama/neural/conv_ops.h"
+#include "dama/common/logging.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // =============================================================================
-// WEIGHT I/O
+// FILE FORMAT
 // =============================================================================
 
-void cnn_save_weights(const CNNWeights *w, const char *path) {
-    FILE *f = fopen(path, "wb");
-    if (!f) return;
-    fwrite(w->conv1_w, sizeof(float), 64*CNN_INPUT_CHANNELS*9, f); fwrite(w->conv1_b, sizeof(float), 64, f);
-    fwrite(w->conv2_w, sizeof(float), 64*64*9, f); fwrite(w->conv2_b, sizeof(float), 64, f);
-    fwrite(w->conv3_w, sizeof(float), 64*64*9, f); fwrite(w->conv3_b, sizeof(float), 64, f);
-    fwrite(w->conv4_w, sizeof(float), 64*64*9, f); fwrite(w->conv4_b, sizeof(float), 64, f);
-    fwrite(w->bn1_gamma, sizeof(float), 64, f); fwrite(w->bn1_beta, sizeof(float), 64, f);
-    fwrite(w->bn2_gamma, sizeof(float), 64, f); fwrite(w->bn2_beta, sizeof(float), 64, f);
-    fwrite(w->bn3_gamma, sizeof(float), 64, f); fwrite(w->bn3_beta, sizeof(float), 64, f);
-    fwrite(w->bn4_gamma, sizeof(float), 64, f); fwrite(w->bn4_beta, sizeof(float), 64, f);
-    fwrite(w->bn1_mean, sizeof(float), 64, f); fwrite(w->bn1_var, sizeof(float), 64, f);
-    fwrite(w->bn2_mean, sizeof(float), 64, f); fwrite(w->bn2_var, sizeof(float), 64, f);
-    fwrite(w->bn3_mean, sizeof(float), 64, f); fwrite(w->bn3_var, sizeof(float), 64, f);
-    fwrite(w->bn4_mean, sizeof(float), 64, f); fwrite(w->bn4_var, sizeof(float), 64, f);
-    fwrite(w->policy_w, sizeof(float), 512*4097, f); fwrite(w->policy_b, sizeof(float), 512, f);
-    fwrite(w->value_w1, sizeof(float), 256*4097, f); fwrite(w->value_b1, sizeof(float), 256, f);
-    fwrite(w->value_w2, sizeof(float), 1*256, f); fwrite(w->value_b2, sizeof(float), 1, f);
-    fclose(f);
+typedef struct {
+    char magic[4];              // CNN_MODEL_MAGIC
+    uint32_t version;           // CNN_MODEL_VERSION
+    uint32_t tensor_count;
+    uint32_t form_version;      // CNN_MODEL_FORM_VERSION of the inference tensors
+    uint64_t file_bytes;
+    uint64_t checksum;          // model_hash of everything after the header
+} CNNModelHeader;
+
+typedef struct {
+    char name[24];
+    uint32_t dtype;             // MODEL_F32 / MODEL_F16
+    uint32_t reserved;
+    uint64_t offset;            // From the start of the file, CNN_MODEL_ALIGN-aligned
+    uint64_t count;             // Elements
+} CNNModelTensor;
+
+enum { MODEL_F32, MODEL_F16 };
+
+typedef struct {
+    const char *name;
+    size_t field;               // offsetof(CNNWeights, ...)
+    size_t count;
+    uint32_t dtype;
+    int derived;                // Inference form (cnn_fold_batch_norm output)
+} TensorSpec;
+
+#define T(f, n)     { #f, offsetof(CNNWeights, f), (n), MODEL_F32, 0 }
+#define D(f, n)     { #f, offsetof(CNNWeights, f), (n), MODEL_F32, 1 }
+#define DH(f, n)    { #f, offsetof(CNNWeights, f), (n), MODEL_F16, 1 }
+
+// Masters in the legacy file order, then the inference form
+static const TensorSpec TENSORS[] = {
+    T(conv1_w, 64 * CNN_INPUT_CHANNELS * 9), T(conv1_b, 64),
+    T(conv2_w, 64 * 64 * 9), T(conv2_b, 64),
+    T(conv3_w, 64 * 64 * 9), T(conv3_b, 64),
+    T(conv4_w, 64 * 64 * 9), T(conv4_b, 64),
+    T(bn1_gamma, 64), T(bn1_beta, 64),
+    T(bn2_gamma, 64), T(bn2_beta, 64),
+    T(bn3_gamma, 64), T(bn3_beta, 64),
+    T(bn4_gamma, 64), T(bn4_beta, 64),
+    T(bn1_mean, 64), T(bn1_var, 64),
+    T(bn2_mean, 64), T(bn2_var, 64),
+    T(bn3_mean, 64), T(bn3_var, 64),
+    T(bn4_mean, 64), T(bn4_var, 64),
+    T(policy_w, 512 * 4097), T(policy_b, 512),
+    T(value_w1, 256 * 4097), T(value_b1, 256),
+    T(value_w2, 256), T(value_b2, 1),
+
+    D(fused_conv1_w, 64 * CNN_INPUT_CHANNELS * 9), D(fused_conv1_b, 64),
+    D(fused_conv2_w, 64 * 64 * 9), D(fused_conv2_b, 64),
+    D(fused_conv3_w, 64 * 64 * 9), D(fused_conv3_b, 64),
+    D(fused_conv4_w, 64 * 64 * 9), D(fused_conv4_b, 64),
+    D(wino_conv2_u, WINOGRAD_POINTS * 64 * 64),
+    D(wino_conv3_u, WINOGRAD_POINTS * 64 * 64),
+    D(wino_conv4_u, WINOGRAD_POINTS * 64 * 64),
+    D(sparse_conv1_w, CNN_INPUT_CHANNELS * 9 * 64),
+    DH(policy_w_h, 512 * 4097), DH(value_w1_h, 256 * 4097),
+};
+
+#undef T
+#undef D
+#undef DH
+
+#define TENSOR_COUNT    ((int)(sizeof(TENSORS) / sizeof(TENSORS[0])))
+#define MASTER_COUNT    30
+
+static inline void** tensor_slot(CNNWeights *w, const TensorSpec *t) {
+    return (void**)((char*)w + t->field);
+}
+
+static inline size_t tensor_bytes(const TensorSpec *t) {
+    return t->count * (t->dtype == MODEL_F16 ? sizeof(uint16_t) : sizeof(float));
+}
+
+static inline size_t align_up(size_t n) {
+    return (n + CNN_MODEL_ALIGN - 1) & ~(size_t)(CNN_MODEL_ALIGN - 1);
+}
+
+// FNV-1a over 64-bit words (every section is a multiple of 8 bytes)
+static uint64_t model_hash(uint64_t h, const void *data, size_t bytes) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ word) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+#define MODEL_HASH_SEED 0xCBF29CE484222325ULL
+
+// model_hash of data followed by its zero padding up to CNN_MODEL_ALIGN
+static uint64_t model_hash_padded(uint64_t h, const void *data, size_t bytes) {
+    size_t whole = bytes & ~(size_t)7;
+    h = model_hash(h, data, whole);
+    uint64_t word = 0;
+    memcpy(&word, (const char*)data + whole, bytes - whole);
+    for (size_t i = whole; i < align_up(bytes); i += 8) {
+        h = (h ^ word) * 0x100000001B3ULL;
+        word = 0;
+    }
+    return h;
+}
+
+// =============================================================================
+// MAPPING OWNERSHIP
+// =============================================================================
+
+static inline int in_mapping(const CNNWeights *w, const void *p) {
+    return w->mapping && (const char*)p >= (const char*)w->mapping &&
+           (const char*)p < (const char*)w->mapping + w->mapping_bytes;
+}
+
+void cnn_unmap_weights(CNNWeights *w) {
+    if (!w->mapping) return;
+    for (int i = 0; i < TENSOR_COUNT; i++) {
+        void **slot = tensor_slot(w, &TENSORS[i]);
+        if (in_mapping(w, *slot)) *slot = NULL;
+    }
+    munmap(w->mapping, w->mapping_bytes);
+    w->mapping = NULL;
+    w->mapping_bytes = 0;
+}
+
+void cnn_release_mapping(CNNWeights *w) {
+    if (!w->mapping) return;
+    // Mapped tensors become private heap copies (current values, COW edits included)
+    for (int i = 0; i < TENSOR_COUNT; i++) {
+        void **slot = tensor_slot(w, &TENSORS[i]);
+        if (!in_mapping(w, *slot)) continue;
+        void *copy = malloc(tensor_bytes(&TENSORS[i]));
+        if (copy) memcpy(copy, *slot, tensor_bytes(&TENSORS[i]));
+        *slot = copy;
+    }
+    munmap(w->mapping, w->mapping_bytes);
+    w->mapping = NULL;
+    w->mapping_bytes = 0;
+}
+
+// =============================================================================
+// SAVE
+// =============================================================================
+
+int cnn_save_weights(const CNNWeights *w, const char *path) {
+    // Written next to the target and renamed over it: a process that has the
+    // old file mapped keeps its inode instead of seeing it truncated
+    char tmp_path[1024];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        log_error("[CNN] Path too long: %s", path);
+        return -1;
+    }
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        log_error("[CNN] Cannot open %s for writing", tmp_path);
+        return -1;
+    }
+
+    CNNModelTensor table[TENSOR_COUNT];
+    memset(table, 0, sizeof(table));
+    size_t offset = align_up(sizeof(CNNModelHeader) + sizeof(table));
+    uint64_t hash = MODEL_HASH_SEED;
+    for (int i = 0; i < TENSOR_COUNT; i++) {
+        strncpy(table[i].name, TENSORS[i].name, sizeof(table[i].name) - 1);
+        table[i].dtype = TENSORS[i].dtype;
+        table[i].offset = offset;
+        table[i].count = TENSORS[i].count;
+        offset = align_up(offset + tensor_bytes(&TENSORS[i]));
+    }
+
+    // Checksum: table, then each payload with its zero padding
+    static const char zeros[CNN_MODEL_ALIGN] = {0};
+    size_t pos = sizeof(CNNModelHeader) + sizeof(table);
+    hash = model_hash(hash, table, sizeof(table));
+    hash = model_hash(hash, zeros, align_up(pos) - pos);    // Header and table are 8-byte multiples
+    for (int i = 0; i < TENSOR_COUNT; i++) {
+        const void *data = *tensor_slot((CNNWeights*)w, &TENSORS[i]);
+        size_t bytes = tensor_bytes(&TENSORS[i]);
+        hash = model_hash_padded(hash, data, bytes);
+    }
+
+    CNNModelHeader header = {
+        .magic = {CNN_MODEL_MAGIC[0], CNN_MODEL_MAGIC[1], CNN_MODEL_MAGIC[2], CNN_MODEL_MAGIC[3]},
+        .version = CNN_MODEL_VERSION,
+        .tensor_count = TENSOR_COUNT,
+        .form_version = CNN_MODEL_FORM_VERSION,
+        .file_bytes = offset,
+        .checksum = hash
+    };
+
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(table, sizeof(table), 1, f) == 1;
+    ok = ok && fwrite(zeros, 1, align_up(pos) - pos, f) == align_up(pos) - pos;
+    for (int i = 0; ok && i < TENSOR_COUNT; i++) {
+        const void *data = *tensor_slot((CNNWeights*)w, &TENSORS[i]);
+        size_t bytes = tensor_bytes(&TENSORS[i]);
+        ok = fwrite(data, 1, bytes, f) == bytes &&
+             fwrite(zeros, 1, align_up(bytes) - bytes, f) == align_up(bytes) - bytes;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp_path, path) != 0) {
+        log_error("[CNN] Write failed: %s", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// =============================================================================
+// LOAD
+// =============================================================================
+
+static const CNNModelTensor* find_tensor(const CNNModelTensor *table, uint32_t n, const char *name) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (strncmp(table[i].name, name, sizeof(table[i].name)) == 0) return &table[i];
+    }
+    return NULL;
+}
+
+// Validated v2 file at base: point w's tensors into it
+static int load_mapped(CNNWeights *w, void *base, size_t size, const char *path) {
+    const CNNModelHeader *h = base;
+    if (h->version != CNN_MODEL_VERSION) {
+        log_error("[CNN] Unsupported model version %u: %s", h->version, path);
+        return -1;
+    }
+    size_t table_end = sizeof(CNNModelHeader) + (size_t)h->tensor_count * sizeof(CNNModelTensor);
+    if (h->file_bytes != size || table_end > size) {
+        log_error("[CNN] Truncated model file: %s", path);
+        return -1;
+    }
+    if (model_hash(MODEL_HASH_SEED, (const char*)base + sizeof(CNNModelHeader),
+                   size - sizeof(CNNModelHeader)) != h->checksum) {
+        log_error("[CNN] Checksum mismatch: %s", path);
+        return -1;
+    }
+
+    // Every master must be there; the inference form only as a whole and current
+    const CNNModelTensor *table = (const CNNModelTensor*)(h + 1);
+    const CNNModelTensor *found[TENSOR_COUNT];
+    int use_derived = (h->form_version == CNN_MODEL_FORM_VERSION);
+    for (int i = 0; i < TENSOR_COUNT; i++) {
+        const TensorSpec *t = &TENSORS[i];
+        const CNNModelTensor *e = find_tensor(table, h->tensor_count, t->name);
+        int valid = e && e->dtype == t->dtype && e->count == t->count &&
+                    e->offset % CNN_MODEL_ALIGN == 0 && e->offset >= table_end &&
+                    e->offset + tensor_bytes(t) <= size;
+        found[i] = valid ? e : NULL;
+        if (!valid && !t->derived) {
+            log_error("[CNN] Missing or malformed tensor %s: %s", t->name, path);
+            return -1;
+        }
+        if (!valid) use_derived = 0;
+    }
+
+    for (int i = 0; i < TENSOR_COUNT; i++) {
+        if (TENSORS[i].derived && !use_derived) continue;
+        void **slot = tensor_slot(w, &TENSORS[i]);
+        free(*slot);
+        *slot = (char*)base + found[i]->offset;
+    }
+    w->mapping = base;
+    w->mapping_bytes = size;
+    if (!use_derived) cnn_fold_batch_norm(w);
+    return 0;
+}
+
+// Pre-v2 file: the masters as raw float arrays, nothing else
+static int load_legacy(CNNWeights *w, int fd, size_t size, const char *path) {
+    size_t expected = 0;
+    for (int i = 0; i < MASTER_COUNT; i++) expected += tensor_bytes(&TENSORS[i]);
+    if (size != expected) {
+        log_error("[CNN] Unrecognized weights file (%zu bytes): %s", size, path);
+        return -1;
+    }
+    for (int i = 0; i < MASTER_COUNT; i++) {
+        char *dst = *tensor_slot(w, &TENSORS[i]);
+        size_t left = tensor_bytes(&TENSORS[i]);
+        while (left > 0) {
+            ssize_t got = read(fd, dst, left);
+            if (got <= 0) {
+                log_error("[CNN] Read failed: %s", path);
+                return -1;
+            }
+            dst += got;
+            left -= (size_t)got;
+        }
+    }
+    cnn_fold_batch_norm(w);
+    return 0;
 }
 
 int cnn_load_weights(CNNWeights *w, const char *path) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return -1;
-    fread(w->conv1_w, sizeof(float), 64*CNN_INPUT_CHANNELS*9, f); fread(w->conv1_b, sizeof(float), 64, f);
-    fread(w->conv2_w, sizeof(float), 64*64*9, f); fread(w->conv2_b, sizeof(float), 64, f);
-    fread(w->conv3_w, sizeof(float), 64*64*9, f); fread(w->conv3_b, sizeof(float), 64, f);
-    fread(w->conv4_w, sizeof(float), 64*64*9, f); fread(w->conv4_b, sizeof(float), 64, f);
-    fread(w->bn1_gamma, sizeof(float), 64, f); fread(w->bn1_beta, sizeof(float), 64, f);
-    fread(w->bn2_gamma, sizeof(float), 64, f); fread(w->bn2_beta, sizeof(float), 64, f);
-    fread(w->bn3_gamma, sizeof(float), 64, f); fread(w->bn3_beta, sizeof(float), 64, f);
-    fread(w->bn4_gamma, sizeof(float), 64, f); fread(w->bn4_beta, sizeof(float), 64, f);
-    fread(w->bn1_mean, sizeof(float), 64, f); fread(w->bn1_var, sizeof(float), 64, f);
-    fread(w->bn2_mean, sizeof(float), 64, f); fread(w->bn2_var, sizeof(float), 64, f);
-    fread(w->bn3_mean, sizeof(float), 64, f); fread(w->bn3_var, sizeof(float), 64, f);
-    fread(w->bn4_mean, sizeof(float), 64, f); fread(w->bn4_var, sizeof(float), 64, f);
-    fread(w->policy_w, sizeof(float), 512*4097, f); fread(w->policy_b, sizeof(float), 512, f);
-    fread(w->value_w1, sizeof(float), 256*4097, f); fread(w->value_b1, sizeof(float), 256, f);
-    fread(w->value_w2, sizeof(float), 1*256, f); fread(w->value_b2, sizeof(float), 1, f);
-    fclose(f);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CNNModelHeader)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+
+    // The previous file's tensors become heap copies (a failed load keeps them)
+    cnn_release_mapping(w);
+
+    char magic[4];
+    if (read(fd, magic, 4) != 4) {
+        close(fd);
+        return -1;
+    }
+    if (memcmp(magic, CNN_MODEL_MAGIC, 4) != 0) {
+        int res = (lseek(fd, 0, SEEK_SET) == 0) ? load_legacy(w, fd, size, path) : -1;
+        close(fd);
+        return res;
+    }
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        log_error("[CNN] Cannot map %s", path);
+        return -1;
+    }
+    if (load_mapped(w, base, size, path) != 0) {
+        munmap(base, size);
+        return -1;
+    }
     return 0;
 }
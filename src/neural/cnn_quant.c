@@ -0,0 +1,364 @@
+/**
+ * cnn_quant.c - Int8 Quantized Inference
+ *
+ * Contains: cnn_quant_calibrate (activation ranges + weight quantization),
+ * cnn_quant_save/load, cnn_quant_forward (conv2-4 and FC heads on the int8
+ * dot kernels of math_backend)
+ *
+ * Activations are post-ReLU, so 0..127 covers them with one scale and no
+ * zero point; a layer computes acc * (in_scale * w_scale[channel]) + bias.
+ */
+
+#include "dama/neural/cnn_quant.h"
+#include "dama/neural/cnn.h"
+#include "dama/neural/conv_ops.h"
+#include "dama/common/math_backend.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/logging.h"
+#include "dama/common/debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define FC_IN       4096                // Flattened features (player column folded into the bias)
+#define CONV_K      (64 * 9)            // Conv2-4 reduction length
+#define CALIB_BINS  2048
+
+// =============================================================================
+// QUANTIZATION HELPERS
+// =============================================================================
+
+// Symmetric per-row scales: row r of w (stride floats apart) -> q[r][n]
+static void quantize_rows(const float *w, int rows, int n, int stride, int8_t *q, float *scale) {
+    for (int r = 0; r < rows; r++) {
+        const float *row = &w[(size_t)r * stride];
+        float m = 0.0f;
+        for (int i = 0; i < n; i++) m = fmaxf(m, fabsf(row[i]));
+        float s = (m > 0.0f) ? m / 127.0f : 1.0f;
+        scale[r] = s;
+        for (int i = 0; i < n; i++) {
+            float v = rintf(row[i] / s);
+            q[(size_t)r * n + i] = (int8_t)(v > 127.0f ? 127.0f : (v < -127.0f ? -127.0f : v));
+        }
+    }
+}
+
+static inline void quantize_act(const float *x, int8_t *q, int n, float inv_scale) {
+    for (int i = 0; i < n; i++) {
+        float v = x[i] * inv_scale + 0.5f;     // x >= 0: truncation rounds
+        q[i] = (int8_t)(v >= 127.0f ? 127.0f : v);
+    }
+}
+
+// =============================================================================
+// CALIBRATION
+// =============================================================================
+
+// fp32 activations at the four quantization points: conv2-4 inputs, FC input
+static void calib_forward(const CNNWeights *w, const TrainingSample *s, float act[4][4096]) {
+    CNNSparseInput input;
+    cnn_encode_sparse(&s->state, &s->history[0], &s->history[1], &input);
+    conv3x3_sparse_relu(w->sparse_conv1_w, w->fused_conv1_b, &input, act[0], 64);
+    conv2d_forward_relu_s(act[0], w->fused_conv2_w, w->fused_conv2_b, act[1], CONV2_SHAPE);
+    conv2d_forward_relu_s(act[1], w->fused_conv3_w, w->fused_conv3_b, act[2], CONV3_SHAPE);
+    conv2d_forward_relu_s(act[2], w->fused_conv4_w, w->fused_conv4_b, act[3], CONV4_SHAPE);
+}
+
+// Scale clipping each tensor at the given percentile of its positive values:
+// pass 1 finds the max, pass 2 fills a histogram over [0, max]
+static int calibrate_ranges(const CNNWeights *w, const TrainingSample *samples, int count,
+                            float scale[4]) {
+    float (*act)[4096] = malloc(4 * 4096 * sizeof(float));
+    long (*hist)[CALIB_BINS] = calloc(4, sizeof(*hist));
+    if (!act || !hist) {
+        free(act);
+        free(hist);
+        return ERR_MEMORY;
+    }
+
+    float max[4] = {0};
+    for (int n = 0; n < count; n++) {
+        calib_forward(w, &samples[n], act);
+        for (int t = 0; t < 4; t++) {
+            for (int i = 0; i < 4096; i++) max[t] = fmaxf(max[t], act[t][i]);
+        }
+    }
+
+    long positive[4] = {0};
+    for (int n = 0; n < count; n++) {
+        calib_forward(w, &samples[n], act);
+        for (int t = 0; t < 4; t++) {
+            if (max[t] <= 0.0f) continue;
+            float to_bin = CALIB_BINS / max[t];
+            for (int i = 0; i < 4096; i++) {
+                if (act[t][i] <= 0.0f) continue;
+                int b = (int)(act[t][i] * to_bin);
+                hist[t][b < CALIB_BINS ? b : CALIB_BINS - 1]++;
+                positive[t]++;
+            }
+        }
+    }
+
+    for (int t = 0; t < 4; t++) {
+        float clip = max[t];
+        long target = (long)(CNN_QUANT_CALIB_PERCENTILE * positive[t]);
+        long seen = 0;
+        for (int b = 0; b < CALIB_BINS && positive[t] > 0; b++) {
+            seen += hist[t][b];
+            if (seen >= target) {
+                clip = max[t] * (b + 1) / CALIB_BINS;
+                break;
+            }
+        }
+        scale[t] = (clip > 0.0f) ? clip / 127.0f : 1.0f / 127.0f;
+    }
+
+    free(act);
+    free(hist);
+    return ERR_OK;
+}
+
+static int quant_alloc(CNNQuantWeights *q) {
+    memset(q, 0, sizeof(*q));
+    q->conv1_w = malloc(CNN_INPUT_CHANNELS * 9 * 64 * sizeof(float));
+    q->conv1_b = malloc(64 * sizeof(float));
+    for (int l = 0; l < 3; l++) q->conv_w[l] = malloc(64 * CONV_K);
+    q->policy_w = malloc((size_t)CNN_POLICY_SIZE * FC_IN);
+    q->value_w1 = malloc((size_t)CNN_VALUE_HIDDEN * FC_IN);
+
+    int ok = q->conv1_w && q->conv1_b && q->policy_w && q->value_w1;
+    for (int l = 0; l < 3; l++) ok = ok && q->conv_w[l];
+    if (!ok) {
+        cnn_quant_free(q);
+        return ERR_MEMORY;
+    }
+    return ERR_OK;
+}
+
+int cnn_quant_calibrate(const CNNWeights *w, const TrainingSample *samples, int count,
+                        CNNQuantWeights *q) {
+    if (!w || !samples || !q) return ERR_NULL_PTR;
+    if (count <= 0) return ERR_INVALID_ARG;
+
+    float act_scale[4];
+    int err = calibrate_ranges(w, samples, count, act_scale);
+    if (err != ERR_OK) return err;
+    if ((err = quant_alloc(q)) != ERR_OK) return err;
+
+    memcpy(q->conv1_w, w->sparse_conv1_w, CNN_INPUT_CHANNELS * 9 * 64 * sizeof(float));
+    memcpy(q->conv1_b, w->fused_conv1_b, 64 * sizeof(float));
+
+    const float *conv_w[3] = {w->fused_conv2_w, w->fused_conv3_w, w->fused_conv4_w};
+    const float *conv_b[3] = {w->fused_conv2_b, w->fused_conv3_b, w->fused_conv4_b};
+    for (int l = 0; l < 3; l++) {
+        quantize_rows(conv_w[l], 64, CONV_K, CONV_K, q->conv_w[l], q->conv_scale[l]);
+        memcpy(q->conv_b[l], conv_b[l], 64 * sizeof(float));
+        q->conv_in_scale[l] = act_scale[l];
+    }
+
+    quantize_rows(w->policy_w, CNN_POLICY_SIZE, FC_IN, FC_IN + 1, q->policy_w, q->policy_scale);
+    for (int r = 0; r < CNN_POLICY_SIZE; r++) {
+        q->policy_b[r] = w->policy_b[r] + w->policy_w[(size_t)r * (FC_IN + 1) + FC_IN];
+    }
+    quantize_rows(w->value_w1, CNN_VALUE_HIDDEN, FC_IN, FC_IN + 1, q->value_w1, q->value_scale);
+    for (int r = 0; r < CNN_VALUE_HIDDEN; r++) {
+        q->value_b1[r] = w->value_b1[r] + w->value_w1[(size_t)r * (FC_IN + 1) + FC_IN];
+    }
+    memcpy(q->value_w2, w->value_w2, CNN_VALUE_HIDDEN * sizeof(float));
+    q->value_b2 = w->value_b2[0];
+    q->fc_in_scale = act_scale[3];
+    return ERR_OK;
+}
+
+void cnn_quant_free(CNNQuantWeights *q) {
+    if (!q) return;
+    free(q->conv1_w);
+    free(q->conv1_b);
+    for (int l = 0; l < 3; l++) free(q->conv_w[l]);
+    free(q->policy_w);
+    free(q->value_w1);
+    memset(q, 0, sizeof(*q));
+}
+
+// =============================================================================
+// PERSISTENCE
+// =============================================================================
+
+// Scales and biases: the plain arrays between conv_w and policy_w, then
+// between value_w1 and the end, each written as one block
+#define BLOCK1_OFF  offsetof(CNNQuantWeights, conv_scale)
+#define BLOCK1_LEN  (offsetof(CNNQuantWeights, policy_w) - BLOCK1_OFF)
+#define BLOCK2_OFF  offsetof(CNNQuantWeights, policy_scale)
+#define BLOCK2_LEN  (offsetof(CNNQuantWeights, value_w1) - BLOCK2_OFF)
+#define BLOCK3_OFF  offsetof(CNNQuantWeights, value_scale)
+#define BLOCK3_LEN  (sizeof(CNNQuantWeights) - BLOCK3_OFF)
+
+// Everything but the magic and version
+static size_t payload_bytes(void) {
+    return (CNN_INPUT_CHANNELS * 9 * 64 + 64) * sizeof(float)
+         + 3 * 64 * CONV_K
+         + (size_t)(CNN_POLICY_SIZE + CNN_VALUE_HIDDEN) * FC_IN
+         + BLOCK1_LEN + BLOCK2_LEN + BLOCK3_LEN;
+}
+
+size_t cnn_quant_bytes(const CNNQuantWeights *q) {
+    (void)q;    // Fixed architecture
+    return payload_bytes();
+}
+
+int cnn_quant_save(const CNNQuantWeights *q, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        log_error("[Quant] Cannot open %s for writing", path);
+        return ERR_FILE_OPEN;
+    }
+    uint32_t version = CNN_QUANT_VERSION;
+    fwrite(CNN_QUANT_MAGIC, 1, 4, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(q->conv1_w, sizeof(float), CNN_INPUT_CHANNELS * 9 * 64, f);
+    fwrite(q->conv1_b, sizeof(float), 64, f);
+    for (int l = 0; l < 3; l++) fwrite(q->conv_w[l], 1, 64 * CONV_K, f);
+    fwrite((const char*)q + BLOCK1_OFF, 1, BLOCK1_LEN, f);
+    fwrite(q->policy_w, 1, (size_t)CNN_POLICY_SIZE * FC_IN, f);
+    fwrite((const char*)q + BLOCK2_OFF, 1, BLOCK2_LEN, f);
+    fwrite(q->value_w1, 1, (size_t)CNN_VALUE_HIDDEN * FC_IN, f);
+    fwrite((const char*)q + BLOCK3_OFF, 1, BLOCK3_LEN, f);
+    fclose(f);
+    return ERR_OK;
+}
+
+int cnn_quant_load(CNNQuantWeights *q, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        log_error("[Quant] Cannot open %s", path);
+        return ERR_FILE_OPEN;
+    }
+    char magic[4];
+    uint32_t version = 0;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, CNN_QUANT_MAGIC, 4) != 0 ||
+        fread(&version, sizeof(version), 1, f) != 1) {
+        log_error("[Quant] Invalid file format: %s", path);
+        fclose(f);
+        return ERR_FILE_FORMAT;
+    }
+    if (version != CNN_QUANT_VERSION) {
+        log_error("[Quant] Version mismatch (%u vs %u)", version, CNN_QUANT_VERSION);
+        fclose(f);
+        return ERR_VERSION;
+    }
+    int err = quant_alloc(q);
+    if (err != ERR_OK) {
+        fclose(f);
+        return err;
+    }
+
+    size_t got = 0;
+    got += fread(q->conv1_w, sizeof(float), CNN_INPUT_CHANNELS * 9 * 64, f) * sizeof(float);
+    got += fread(q->conv1_b, sizeof(float), 64, f) * sizeof(float);
+    for (int l = 0; l < 3; l++) got += fread(q->conv_w[l], 1, 64 * CONV_K, f);
+    got += fread((char*)q + BLOCK1_OFF, 1, BLOCK1_LEN, f);
+    got += fread(q->policy_w, 1, (size_t)CNN_POLICY_SIZE * FC_IN, f);
+    got += fread((char*)q + BLOCK2_OFF, 1, BLOCK2_LEN, f);
+    got += fread(q->value_w1, 1, (size_t)CNN_VALUE_HIDDEN * FC_IN, f);
+    got += fread((char*)q + BLOCK3_OFF, 1, BLOCK3_LEN, f);
+    fclose(f);
+
+    if (got != payload_bytes()) {
+        log_error("[Quant] Truncated file: %s", path);
+        cnn_quant_free(q);
+        return ERR_FILE_FORMAT;
+    }
+    return ERR_OK;
+}
+
+// =============================================================================
+// FORWARD PASS
+// =============================================================================
+
+// 3x3 same-padding conv + bias + ReLU on int8: im2col of the quantized
+// planes (one 576-byte column per square), then one int8 GEMV per square
+static void conv_s8_relu(const CNNQuantWeights *q, int l, const float *input, float *output) {
+    int8_t pad[64][CNN_BOARD_SIZE + 2][CNN_BOARD_SIZE + 2];
+    int8_t col[CONV_K];
+    int32_t acc[64];
+    float mult[64];
+
+    memset(pad, 0, sizeof(pad));
+    float inv = 1.0f / q->conv_in_scale[l];
+    for (int c = 0; c < 64; c++) {
+        for (int y = 0; y < CNN_BOARD_SIZE; y++) {
+            quantize_act(&input[(c * CNN_BOARD_SIZE + y) * CNN_BOARD_SIZE], &pad[c][y + 1][1],
+                         CNN_BOARD_SIZE, inv);
+        }
+    }
+    for (int co = 0; co < 64; co++) mult[co] = q->conv_in_scale[l] * q->conv_scale[l][co];
+
+    for (int sq = 0; sq < 64; sq++) {
+        int y = sq / CNN_BOARD_SIZE, x = sq % CNN_BOARD_SIZE;
+        int8_t *c = col;
+        for (int ci = 0; ci < 64; ci++) {
+            for (int ky = 0; ky < 3; ky++) {
+                *c++ = pad[ci][y + ky][x];
+                *c++ = pad[ci][y + ky][x + 1];
+                *c++ = pad[ci][y + ky][x + 2];
+            }
+        }
+        vec_gemv_s8(q->conv_w[l], col, acc, 64, CONV_K);
+        for (int co = 0; co < 64; co++) {
+            float v = acc[co] * mult[co] + q->conv_b[l][co];
+            output[co * 64 + sq] = v > 0.0f ? v : 0.0f;
+        }
+    }
+}
+
+void cnn_quant_forward(const CNNQuantWeights *q, const GameState *state,
+                       const GameState *hist1, const GameState *hist2,
+                       const CNNPolicySubset *legal, CNNOutput *out) {
+    DBG_NOT_NULL(q);
+    DBG_NOT_NULL(state);
+    DBG_NOT_NULL(out);
+
+    CNNSparseInput input;
+    cnn_encode_sparse(state, hist1, hist2, &input);
+
+    float a[64 * 64], b[64 * 64];
+    conv3x3_sparse_relu(q->conv1_w, q->conv1_b, &input, a, 64);
+    conv_s8_relu(q, 0, a, b);
+    conv_s8_relu(q, 1, b, a);
+    conv_s8_relu(q, 2, a, b);
+
+    int8_t fc_input[FC_IN];
+    int32_t acc[CNN_POLICY_SIZE];
+    quantize_act(b, fc_input, FC_IN, 1.0f / q->fc_in_scale);
+
+    // Policy Head: listed rows only, or all of them
+    float logits[CNN_POLICY_SIZE];
+    if (legal) {
+        memset(out->policy, 0, sizeof(out->policy));
+        if (legal->count > 0) {
+            for (int i = 0; i < legal->count; i++) {
+                int r = legal->index[i];
+                int32_t dot = vec_dot_s8(fc_input, &q->policy_w[(size_t)r * FC_IN], FC_IN);
+                logits[i] = dot * (q->fc_in_scale * q->policy_scale[r]) + q->policy_b[r];
+            }
+            vec_softmax(logits, logits, legal->count);
+            for (int i = 0; i < legal->count; i++) out->policy[legal->index[i]] = logits[i];
+        }
+    } else {
+        vec_gemv_s8(q->policy_w, fc_input, acc, CNN_POLICY_SIZE, FC_IN);
+        for (int r = 0; r < CNN_POLICY_SIZE; r++) {
+            logits[r] = acc[r] * (q->fc_in_scale * q->policy_scale[r]) + q->policy_b[r];
+        }
+        vec_softmax(logits, out->policy, CNN_POLICY_SIZE);
+    }
+
+    // Value Head: int8 hidden layer, fp32 output neuron
+    vec_gemv_s8(q->value_w1, fc_input, acc, CNN_VALUE_HIDDEN, FC_IN);
+    float v_sum = q->value_b2;
+    for (int r = 0; r < CNN_VALUE_HIDDEN; r++) {
+        float h = acc[r] * (q->fc_in_scale * q->value_scale[r]) + q->value_b1[r];
+        v_sum += relu(h) * q->value_w2[r];
+    }
+    out->value = tanh_act(v_sum);
+}
@@ -2,18 +2,40 @@
  * conv_ops.c - Convolution Operations Implementation
  * 
  * 2D Convolution with "same" padding (output size = input size).
- * Optimized for 3×3 kernels with OpenMP parallelization and Accelerate BLAS.
+ * Optimized for 3×3 kernels with the BLAS backend (math_backend.h). Per-position
+ * kernels are single-threaded; batched ones split across conv_threads(batch).
+ * conv3x3_sparse_relu: inference conv1 straight from the set input bits.
  */
 
 #include <stdlib.h>
 #include <string.h>
-#include <Accelerate/Accelerate.h>
+#include "dama/common/math_backend.h"
 #include "dama/neural/cnn_types.h"
+#include "dama/neural/conv_ops.h"
+#include "dama/common/debug.h"
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+// =============================================================================
+// THREADING POLICY
+// =============================================================================
+
+static int intra_op_threads = CNN_INTRA_OP_THREADS_DEFAULT;
+
+void cnn_set_intra_op_threads(int threads) { intra_op_threads = threads > 1 ? threads : 1; }
+int cnn_get_intra_op_threads(void) { return intra_op_threads; }
+
+int conv_threads(int batch) {
+    if (intra_op_threads <= 1 || batch < CNN_INTRA_OP_MIN_BATCH) return 1;
+#ifdef _OPENMP
+    // Already one of several callers (self-play games, training samples)
+    if (omp_in_parallel()) return 1;
+#endif
+    return intra_op_threads;
+}
+
 // =============================================================================
 // BUFFER MANAGEMENT (Thread-Local Pre-Allocation)
 // =============================================================================
@@ -43,10 +65,11 @@ void conv_ops_cleanup(void) {
         tls_col_buffer = NULL;
         tls_buffer_initialized = 0;
     }
+    conv_winograd_cleanup();
 }
 
 // =============================================================================
-// HELPER: im2col (Parallelized)
+// HELPER: im2col
 // =============================================================================
 
 // Unrolls input [Ci, H, W] into column matrix [Ci*K*K, H*W]
@@ -55,8 +78,6 @@ static void im2col(const float *data_im, int channels, int height, int width, in
     int width_col = width;
     int channels_col = channels * kernel_size * kernel_size;
     
-    // Parallelize across output channels - each channel is independent
-    #pragma omp parallel for
     for (int c = 0; c < channels_col; c++) {
         int w_offset = c % kernel_size;
         int h_offset = (c / kernel_size) % kernel_size;
@@ -79,7 +100,7 @@ static void im2col(const float *data_im, int channels, int height, int width, in
 }
 
 // =============================================================================
-// HELPER: col2im (Parallelized with atomic)
+// HELPER: col2im
 // =============================================================================
 
 
@@ -89,8 +110,6 @@ static void col2im(const float *data_col, int channels, int height, int width, i
     int width_col = width;
     int channels_col = channels * kernel_size * kernel_size;
     
-    // Parallelize - use atomic to handle overlapping writes
-    #pragma omp parallel for
     for (int c = 0; c < channels_col; c++) {
         int w_offset = c % kernel_size;
         int h_offset = (c / kernel_size) % kernel_size;
@@ -103,9 +122,7 @@ static void col2im(const float *data_col, int channels, int height, int width, i
                 int col_index = (c * height_col + h) * width_col + w;
                 
                 if (im_row >= 0 && im_col >= 0 && im_row < height && im_col < width) {
-                    int idx = (c_im * height + im_row) * width + im_col;
-                    #pragma omp atomic
-                    data_im[idx] += data_col[col_index];
+                    data_im[(c_im * height + im_row) * width + im_col] += data_col[col_index];
                 }
             }
         }
@@ -116,24 +133,28 @@ static void col2im(const float *data_col, int channels, int height, int width, i
 // FORWARD PASS (BLAS SGEMM)
 // =============================================================================
 
-void conv2d_forward(
+static void conv2d_forward_impl(
     const float *input,
     const float *kernel,
     const float *bias,
     float *output,
-    int H, int W, int Ci, int Co, int K
+    int H, int W, int Ci, int Co, int K,
+    int fuse_relu,
+    float *col_buffer
 ) {
     int pad = K / 2;
     
-    // Use thread-local pre-allocated buffer (zero allocation)
-    ensure_buffer_initialized();
-    float *col_buffer = tls_col_buffer;
-    if (!col_buffer) return;  // OOM - cannot proceed
+    // Thread-local pre-allocated buffer unless the caller brings one (zero allocation)
+    if (!col_buffer) {
+        ensure_buffer_initialized();
+        col_buffer = tls_col_buffer;
+        if (!col_buffer) return;  // OOM - cannot proceed
+    }
     
-    // 1. im2col (parallelized internally)
+    // 1. im2col
     im2col(input, Ci, H, W, K, pad, col_buffer);
     
-    // 2. GEMM: Output = Weights * Col (uses Accelerate - already multi-threaded)
+    // 2. GEMM: Output = Weights * Col (BLAS backend)
     int M = Co;
     int N = H * W;
     int K_dim = Ci * K * K;
@@ -144,10 +165,96 @@ void conv2d_forward(
                 col_buffer, N,
                 0.0f, output, N);
     
-    // 3. Add Bias (vDSP vectorized)
-    #pragma omp parallel for
+    // 3. Add Bias (+ ReLU in the same pass, vectorized)
     for (int c = 0; c < Co; c++) {
-        vDSP_vsadd(&output[c * H * W], 1, &bias[c], &output[c * H * W], 1, H * W);
+        if (fuse_relu) vec_add_scalar_relu(&output[c * H * W], bias[c], H * W);
+        else vec_add_scalar(&output[c * H * W], bias[c], H * W);
+    }
+}
+
+void conv2d_forward(
+    const float *input,
+    const float *kernel,
+    const float *bias,
+    float *output,
+    int H, int W, int Ci, int Co, int K
+) {
+    conv2d_forward_impl(input, kernel, bias, output, H, W, Ci, Co, K, 0, NULL);
+}
+
+void conv2d_forward_relu(
+    const float *input,
+    const float *kernel,
+    const float *bias,
+    float *output,
+    int H, int W, int Ci, int Co, int K
+) {
+    conv2d_forward_impl(input, kernel, bias, output, H, W, Ci, Co, K, 1, NULL);
+}
+
+void conv2d_forward_relu_col(
+    const float *input,
+    const float *kernel,
+    const float *bias,
+    float *output,
+    ConvShape shape,
+    float *col
+) {
+    conv2d_forward_impl(input, kernel, bias, output,
+                        shape.H, shape.W, shape.C_in, shape.C_out, shape.K, 1, col);
+}
+
+// =============================================================================
+// SPARSE INPUT FORWARD (binary planes, 8x8)
+// =============================================================================
+
+void conv3x3_sparse_kernel(const float *kernel, float *patches, int Ci, int Co) {
+    for (int ci = 0; ci < Ci; ci++) {
+        for (int k = 0; k < 9; k++) {
+            for (int co = 0; co < Co; co++) {
+                patches[(ci * 9 + k) * Co + co] = kernel[KERNEL_IDX(co, ci, k / 3, k % 3, Ci, 3)];
+            }
+        }
+    }
+}
+
+// A set input bit at (y, x) reaches output (y - ky + 1, x - kx + 1) through
+// tap (ky, kx): add that tap's patch there. Accumulated square-major so each
+// add is one contiguous Co-vector, then transposed to CHW with bias + ReLU
+void conv3x3_sparse_relu(
+    const float *patches,
+    const float *bias,
+    const CNNSparseInput *in,
+    float *output,
+    int Co
+) {
+    enum { SQ = CNN_BOARD_SIZE * CNN_BOARD_SIZE };
+    DBG_ASSERT(Co <= 64, "sparse conv: Co > 64");
+    float acc[SQ][64];
+    memset(acc, 0, sizeof(acc));
+    
+    for (int i = 0; i < in->count; i++) {
+        int ci = in->index[i] / SQ, sq = in->index[i] % SQ;
+        int y = sq / CNN_BOARD_SIZE, x = sq % CNN_BOARD_SIZE;
+        for (int ky = 0; ky < 3; ky++) {
+            int oy = y - ky + 1;
+            if (oy < 0 || oy >= CNN_BOARD_SIZE) continue;
+            for (int kx = 0; kx < 3; kx++) {
+                int ox = x - kx + 1;
+                if (ox < 0 || ox >= CNN_BOARD_SIZE) continue;
+                const float *patch = &patches[(ci * 9 + ky * 3 + kx) * Co];
+                float *dst = acc[oy * CNN_BOARD_SIZE + ox];
+                for (int co = 0; co < Co; co++) dst[co] += patch[co];
+            }
+        }
+    }
+    
+    for (int co = 0; co < Co; co++) {
+        float b = bias[co];
+        for (int sq = 0; sq < SQ; sq++) {
+            float v = acc[sq][co] + b;
+            output[co * SQ + sq] = v > 0 ? v : 0;
+        }
     }
 }
 
@@ -171,18 +278,15 @@ void conv2d_backward(
     float *col_buffer = tls_col_buffer;
     if (!col_buffer) return;  // OOM - cannot proceed
     
-    // 1. Bias Grad (parallelized with vDSP sum)
-    #pragma omp parallel for
+    // 1. Bias Grad (vector sum)
     for (int c = 0; c < Co; c++) {
-        float sum = 0.0f;
-        vDSP_sve(&d_output[c * H * W], 1, &sum, H * W);
-        d_bias[c] += sum;
+        d_bias[c] += vec_sum(&d_output[c * H * W], H * W);
     }
     
-    // 2. Re-compute im2col (parallelized internally)
+    // 2. Re-compute im2col
     im2col(input, Ci, H, W, K, pad, col_buffer);
     
-    // 3. Gradient wrt Weights: d_output * col^T (Accelerate GEMM)
+    // 3. Gradient wrt Weights: d_output * col^T (BLAS GEMM)
     int M = Co;
     int N = Ci * K * K;
     int K_dim = H * W;
@@ -205,11 +309,103 @@ void conv2d_backward(
                     d_output, N,
                     0.0f, col_buffer, N);
         
-        // col2im (parallelized internally)
+        // col2im
         col2im(col_buffer, Ci, H, W, K, pad, d_input);
     }
 }
 
+// =============================================================================
+// BATCHED CONVOLUTION (CHANNEL-MAJOR, TRAINING)
+// =============================================================================
+
+// im2col of positions [b0, b0 + n) of input [Ci][batch][H*W] into col [Ci*K*K][n*H*W]
+static void im2col_batch(const float *input, ConvShape s, int batch, int b0, int n, float *col) {
+    int pad = s.K / 2, HW = s.H * s.W;
+    size_t N = (size_t)n * HW;
+    for (int c = 0; c < s.C_in * s.K * s.K; c++) {
+        int kx = c % s.K, ky = (c / s.K) % s.K, ci = c / (s.K * s.K);
+        const float *plane = &input[((size_t)ci * batch + b0) * HW];
+        float *row = &col[c * N];
+        for (int b = 0; b < n; b++, plane += HW, row += HW) {
+            for (int y = 0; y < s.H; y++) {
+                int iy = y + ky - pad;
+                for (int x = 0; x < s.W; x++) {
+                    int ix = x + kx - pad;
+                    row[y * s.W + x] = (iy >= 0 && iy < s.H && ix >= 0 && ix < s.W)
+                                       ? plane[iy * s.W + ix] : 0.0f;
+                }
+            }
+        }
+    }
+}
+
+// Adjoint of im2col_batch: accumulates col into d_input [Ci][batch][H*W]
+static void col2im_batch(const float *col, ConvShape s, int batch, int b0, int n, float *d_input) {
+    int pad = s.K / 2, HW = s.H * s.W;
+    size_t N = (size_t)n * HW;
+    for (int c = 0; c < s.C_in * s.K * s.K; c++) {
+        int kx = c % s.K, ky = (c / s.K) % s.K, ci = c / (s.K * s.K);
+        float *plane = &d_input[((size_t)ci * batch + b0) * HW];
+        const float *row = &col[c * N];
+        for (int b = 0; b < n; b++, plane += HW, row += HW) {
+            for (int y = 0; y < s.H; y++) {
+                int iy = y + ky - pad;
+                if (iy < 0 || iy >= s.H) continue;
+                for (int x = 0; x < s.W; x++) {
+                    int ix = x + kx - pad;
+                    if (ix >= 0 && ix < s.W) plane[iy * s.W + ix] += row[y * s.W + x];
+                }
+            }
+        }
+    }
+}
+
+void conv2d_forward_batch(const float *input, const float *kernel, const float *bias,
+                          float *output, ConvShape shape, int batch, float *col) {
+    int HW = shape.H * shape.W, KK = shape.C_in * shape.K * shape.K;
+    int N = batch * HW;
+    for (int b0 = 0; b0 < batch; b0 += CONV_BATCH_CHUNK) {
+        int n = batch - b0 < CONV_BATCH_CHUNK ? batch - b0 : CONV_BATCH_CHUNK;
+        im2col_batch(input, shape, batch, b0, n, col);
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans,
+                    shape.C_out, n * HW, KK,
+                    1.0f, kernel, KK,
+                    col, n * HW,
+                    0.0f, &output[b0 * HW], N);
+    }
+    for (int c = 0; c < shape.C_out; c++) vec_add_scalar(&output[(size_t)c * N], bias[c], N);
+}
+
+void conv2d_backward_batch(const float *input, const float *kernel, const float *d_output,
+                           float *d_input, float *d_kernel, float *d_bias,
+                           ConvShape shape, int batch, float *col) {
+    int HW = shape.H * shape.W, KK = shape.C_in * shape.K * shape.K;
+    int N = batch * HW;
+    for (int c = 0; c < shape.C_out; c++) d_bias[c] += vec_sum(&d_output[(size_t)c * N], N);
+    if (d_input) memset(d_input, 0, (size_t)shape.C_in * N * sizeof(float));
+    
+    for (int b0 = 0; b0 < batch; b0 += CONV_BATCH_CHUNK) {
+        int n = batch - b0 < CONV_BATCH_CHUNK ? batch - b0 : CONV_BATCH_CHUNK;
+        
+        // d_kernel += d_output[:, chunk] * col^T
+        im2col_batch(input, shape, batch, b0, n, col);
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans,
+                    shape.C_out, KK, n * HW,
+                    1.0f, &d_output[b0 * HW], N,
+                    col, n * HW,
+                    1.0f, d_kernel, KK);
+        if (!d_input) continue;
+        
+        // d_col = kernel^T * d_output[:, chunk], folded back onto the input
+        cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans,
+                    KK, n * HW, shape.C_out,
+                    1.0f, kernel, KK,
+                    &d_output[b0 * HW], N,
+                    0.0f, col, n * HW);
+        col2im_batch(col, shape, batch, b0, n, d_input);
+    }
+}
+
 // =============================================================================
 // SHAPE-BASED API (Reduced arguments)
 // =============================================================================
@@ -225,6 +421,17 @@ void conv2d_forward_s(
                    shape.H, shape.W, shape.C_in, shape.C_out, shape.K);
 }
 
+void conv2d_forward_relu_s(
+    const float *input,
+    const float *kernel,
+    const float *bias,
+    float *output,
+    ConvShape shape
+) {
+    conv2d_forward_relu(input, kernel, bias, output,
+                        shape.H, shape.W, shape.C_in, shape.C_out, shape.K);
+}
+
 void conv2d_backward_s(
     const float *input,
     const float *kernel,
@@ -239,18 +446,16 @@ void conv2d_backward_s(
 }
 
 // =============================================================================
-// TENSOR OPERATIONS (Parallelized)
+// TENSOR OPERATIONS
 // =============================================================================
 
 void tensor_relu(float *data, int size) {
-    #pragma omp parallel for
     for (int i = 0; i < size; i++) {
         if (data[i] < 0) data[i] = 0;
     }
 }
 
 void tensor_relu_backward(const float *pre, float *d_out, int size) {
-    #pragma omp parallel for
     for (int i = 0; i < size; i++) {
         if (pre[i] <= 0) d_out[i] = 0;
     }
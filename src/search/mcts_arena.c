@@ -0,0 +1,267 @@
+/**
+ * mcts_arena.c - Arena Allocator Slow Path and Backing
+ * 
+ * The fast path (bump within the thread's chunk) is inline in mcts_types.h.
+ * This file owns the per-thread chunk state, the shared-offset refill and
+ * the buffer itself: malloc, or mmap with huge pages, a background
+ * pre-fault thread and page release on reset (ArenaOptions).
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "dama/search/mcts_types.h"
+#include "dama/common/params.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+__thread ArenaChunk arena_tls_chunk = {0};
+
+static _Atomic uint64_t arena_generation_counter = 0;
+
+uint64_t arena_next_generation(void) {
+    return atomic_fetch_add(&arena_generation_counter, 1) + 1;
+}
+
+// =============================================================================
+// FREE LISTS
+// =============================================================================
+
+// Free list of an aligned size, ARENA_FREE_CLASSES if too large to recycle
+static inline int size_class(size_t aligned) {
+    size_t c = aligned / 8 - 1;
+    return (c < ARENA_FREE_CLASSES) ? (int)c : ARENA_FREE_CLASSES;
+}
+
+// Pops race only with other pops (pushes happen while the search is
+// paused), so the head cannot come back under a pending CAS (no ABA)
+static void* free_list_pop(Arena *a, int c) {
+    ArenaFreeBlock *head = atomic_load_explicit(&a->free_list[c], memory_order_acquire);
+    while (head && !atomic_compare_exchange_weak_explicit(&a->free_list[c], &head, head->next,
+                                                          memory_order_acquire, memory_order_acquire)) {
+    }
+    if (head) atomic_fetch_sub_explicit(&a->free_bytes, (size_t)(c + 1) * 8, memory_order_relaxed);
+    return head;
+}
+
+void arena_release(Arena *a, void *ptr, size_t bytes) {
+    if (!a || !ptr || bytes == 0) return;
+    int c = size_class(ARENA_ALIGN(bytes));
+    if (c == ARENA_FREE_CLASSES) return; // Stays allocated until the next reset
+    ArenaFreeBlock *block = (ArenaFreeBlock*)ptr;
+    block->next = atomic_load_explicit(&a->free_list[c], memory_order_relaxed);
+    atomic_store_explicit(&a->free_list[c], block, memory_order_release);
+    atomic_fetch_add_explicit(&a->free_bytes, (size_t)(c + 1) * 8, memory_order_relaxed);
+}
+
+// =============================================================================
+// SLOW PATH
+// =============================================================================
+
+// Raise the high-water mark to the bytes now in use (the fast path never
+// moves the offset, so checking here sees every increase)
+static void note_high_water(Arena *a) {
+    const size_t in_use = arena_bytes_in_use(a);
+    size_t seen = atomic_load_explicit(&a->high_water, memory_order_relaxed);
+    while (in_use > seen &&
+           !atomic_compare_exchange_weak_explicit(&a->high_water, &seen, in_use,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static void* recycled_block(Arena *a, int cls, size_t need) {
+    void *block = free_list_pop(a, cls);
+    if (block) {
+        ArenaCounters *n = &arena_tls_chunk.counters;
+        n->allocs++;
+        n->bytes += need;
+        n->recycled++;
+        note_high_water(a);
+    }
+    return block;
+}
+
+void* arena_alloc_slow(Arena *a, size_t bytes) {
+    ArenaChunk *c = &arena_tls_chunk;
+    const size_t need = ARENA_ALIGN(bytes);
+    const uint64_t gen = atomic_load(&a->generation);
+    
+    // Recycled blocks first, so a bounded search stops growing the offset.
+    // While any are left, a miss takes just its own bytes, not a new chunk
+    // that would bypass the free lists for the next allocations.
+    const int cls = size_class(need);
+    const int recycling = atomic_load_explicit(&a->free_bytes, memory_order_relaxed) != 0;
+    if (recycling && cls < ARENA_FREE_CLASSES) {
+        void *block = recycled_block(a, cls, need);
+        if (block) return block;
+    }
+    
+    // Reserve max(need, chunk) bytes, clamped to what is left.
+    // Requests larger than a chunk are served exactly and leave the chunk alone.
+    size_t start = atomic_load_explicit(&a->offset, memory_order_relaxed);
+    size_t grab;
+    do {
+        const size_t remaining = (start < a->size) ? a->size - start : 0;
+        if (need > remaining) {
+            // Last resort: a larger recycled block (its tail is lost until reset)
+            for (int k = cls + 1; k < ARENA_FREE_CLASSES; k++) {
+                void *block = recycled_block(a, k, need);
+                if (block) return block;
+            }
+            log_error("[Arena] Out of Memory! (Size: %zu, Requested: %zu)", a->size, bytes);
+            return NULL;
+        }
+        grab = (need < a->chunk_size && !recycling) ? a->chunk_size : need;
+        if (grab > remaining) grab = remaining;
+    } while (!atomic_compare_exchange_weak(&a->offset, &start, start + grab));
+    
+    if (grab > need) {
+        c->arena = a;
+        c->generation = gen;
+        c->pos = start + need;
+        c->end = start + grab;
+        c->counters.refills++;
+    }
+    c->counters.allocs++;
+    c->counters.bytes += need;
+    note_high_water(a);
+    return a->buffer + start;
+}
+
+// =============================================================================
+// BACKING
+// =============================================================================
+
+#define ARENA_HUGE_PAGE     ((size_t)2 << 20)
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23      // Linux 5.14
+#endif
+
+typedef struct {
+    unsigned char *start;
+    size_t bytes;
+    size_t step;
+    atomic_int stop;
+    pthread_t thread;
+} ArenaPrefault;
+
+// Fault the pages in, step by step so arena_free can stop it. Contents are
+// left alone: the search may already be writing to them.
+static void* prefault_main(void *arg) {
+    ArenaPrefault *p = arg;
+    int populate = 1;
+    for (size_t done = 0; done < p->bytes && !atomic_load_explicit(&p->stop, memory_order_relaxed); done += p->step) {
+        const size_t len = p->bytes - done < p->step ? p->bytes - done : p->step;
+        if (populate && madvise(p->start + done, len, MADV_POPULATE_WRITE) == 0) continue;
+        populate = 0;           // Older kernel: a value-preserving write per page
+        for (size_t off = 0; off < len; off += 4096) {
+            __atomic_fetch_or(p->start + done + off, 0, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+static void prefault_stop(Arena *a) {
+    ArenaPrefault *p = a->prefault;
+    if (!p) return;
+    atomic_store(&p->stop, 1);
+    pthread_join(p->thread, NULL);
+    free(p);
+    a->prefault = NULL;
+}
+
+static void prefault_start(Arena *a) {
+    ArenaPrefault *p = calloc(1, sizeof(ArenaPrefault));
+    if (!p) return;
+    p->start = a->buffer;
+    p->bytes = a->backing.prefault_bytes < a->size ? a->backing.prefault_bytes : a->size;
+    p->step = a->page_size > ARENA_PREFAULT_STEP ? a->page_size : ARENA_PREFAULT_STEP;
+    atomic_init(&p->stop, 0);
+    if (pthread_create(&p->thread, NULL, prefault_main, p) != 0) {
+        free(p);                // Not an error: pages fault in on first touch
+        return;
+    }
+    a->prefault = p;
+}
+
+// Anonymous mapping of at least size bytes; *page_size is set to its page size
+static unsigned char* map_buffer(size_t size, ArenaPages pages, size_t *mapped, size_t *page_size) {
+#ifdef MAP_HUGETLB
+    if (pages == ARENA_PAGES_HUGETLB) {
+        const size_t len = (size + ARENA_HUGE_PAGE - 1) & ~(ARENA_HUGE_PAGE - 1);
+        void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *mapped = len;
+            *page_size = ARENA_HUGE_PAGE;
+            return p;
+        }
+        log_debug("[Arena] No reserved huge pages for %zu MB (%s), using THP", len >> 20, strerror(errno));
+        pages = ARENA_PAGES_THP;
+    }
+#endif
+
+    // Over-allocate by a huge page and trim, so the buffer starts 2 MB aligned
+    const size_t len = (size + 4095) & ~(size_t)4095;
+    unsigned char *raw = mmap(NULL, len + ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    const size_t head = (ARENA_HUGE_PAGE - (uintptr_t)raw % ARENA_HUGE_PAGE) % ARENA_HUGE_PAGE;
+    if (head) munmap(raw, head);
+    munmap(raw + head + len, ARENA_HUGE_PAGE - head);
+    unsigned char *buf = raw + head;
+#ifdef MADV_HUGEPAGE
+    if (pages == ARENA_PAGES_THP) madvise(buf, len, MADV_HUGEPAGE);
+#endif
+    *mapped = len;
+    *page_size = pages == ARENA_PAGES_THP ? ARENA_HUGE_PAGE : 4096;
+    return buf;
+}
+
+int arena_init_with(Arena *a, size_t total_size, const ArenaOptions *backing) {
+    static const ArenaOptions plain;
+    a->backing = backing ? *backing : plain;
+    a->mapped = 0;
+    a->page_size = 4096;
+    a->prefault = NULL;
+    if (a->backing.pages == ARENA_PAGES_DEFAULT && !a->backing.prefault_bytes && !a->backing.reset_keep) {
+        a->buffer = malloc(total_size);
+    } else {
+        a->buffer = map_buffer(total_size, a->backing.pages, &a->mapped, &a->page_size);
+    }
+    if (!a->buffer) {
+        log_error("[Arena] Allocation failed for size %zu", total_size);
+        return -1;
+    }
+    a->size = total_size;
+    // Keep chunks small relative to the arena so threads can't starve each other
+    a->chunk_size = ARENA_ALIGN(total_size / 64 < ARENA_CHUNK_SIZE ? total_size / 64 : ARENA_CHUNK_SIZE);
+    atomic_init(&a->offset, 0);
+    atomic_init(&a->generation, arena_next_generation());
+    atomic_init(&a->high_water, 0);
+    arena_clear_free_lists(a);
+    if (a->backing.prefault_bytes) prefault_start(a);
+    return 0;
+}
+
+void arena_release_pages(Arena *a, size_t used) {
+    if (!a->mapped) return;
+    const size_t page = a->page_size;
+    const size_t from = (a->backing.reset_keep + page - 1) / page * page;
+    size_t to = (used + page - 1) / page * page;
+    if (to > a->mapped) to = a->mapped;
+    if (to > from) madvise(a->buffer + from, to - from, MADV_DONTNEED);
+}
+
+void arena_free(Arena *a) {
+    atomic_store(&a->generation, arena_next_generation());
+    prefault_stop(a);
+    if (a->mapped) munmap(a->buffer, a->mapped);
+    else free(a->buffer);
+    a->buffer = NULL;
+    a->mapped = 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * mcts_async.c - Background Search and Pondering
+ *
+ * Contains: mcts_async_* (mcts_search on its own thread, stopped through
+ * MCTSConfig.stop_flag), mcts_get_pv, mcts_ponder_start/finish
+ */
+
+#include "dama/search/mcts_async.h"
+#include "dama/engine/movegen.h"
+#include "dama/common/affinity.h"
+#include <string.h>
+
+// =============================================================================
+// ASYNC SEARCH
+// =============================================================================
+
+static void* async_search_main(void *arg) {
+    MCTSAsyncSearch *s = arg;
+    s->best = mcts_search(s->root, s->arena, s->time_limit, s->config, s->stats, s->tt, &s->new_root);
+    atomic_store(&s->done, 1);
+    return NULL;
+}
+
+int mcts_async_start(MCTSAsyncSearch *s, Node *root, Arena *arena, double time_limit_seconds,
+                     MCTSConfig config, MCTSStats *stats, TranspositionTable *tt) {
+    memset(s, 0, sizeof(*s));
+    atomic_init(&s->stop, 0);
+    atomic_init(&s->done, 0);
+    s->root = root;
+    s->arena = arena;
+    s->tt = tt;
+    s->stats = stats;
+    s->config = config;
+    s->config.stop_flag = &s->stop;
+    s->time_limit = time_limit_seconds;
+    pthread_attr_t attr;
+    const int near = affinity_helper_attr(&attr);
+    int failed = pthread_create(&s->thread, near ? &attr : NULL, async_search_main, s) != 0;
+    if (near) pthread_attr_destroy(&attr);
+    if (failed) return -1;
+    s->active = 1;
+    return 0;
+}
+
+int mcts_async_poll(const MCTSAsyncSearch *s) {
+    return !s->active || atomic_load(&s->done);
+}
+
+void mcts_async_stop(MCTSAsyncSearch *s) {
+    atomic_store(&s->stop, 1);
+}
+
+Move mcts_async_wait(MCTSAsyncSearch *s, Node **out_new_root) {
+    Move none = {0};
+    if (!s->active) return none;
+    pthread_join(s->thread, NULL);
+    s->active = 0;
+    if (out_new_root) *out_new_root = s->new_root;
+    return s->best;
+}
+
+int mcts_async_peek(const MCTSAsyncSearch *s, Move *pv, int max_len, double *value) {
+    if (!s->root) return 0;
+    if (s->config.max_tree_nodes > 0 && max_len > 1) max_len = 1;
+    return mcts_get_pv(s->root, pv, max_len, value);
+}
+
+// =============================================================================
+// PRINCIPAL VARIATION
+// =============================================================================
+
+// Most visited child (NULL if none has a visit yet)
+static Node* most_visited_child(const Node *node) {
+    Node *best = NULL;
+    int max_visits = 0;
+    int n = node->num_children;
+    for (int i = 0; i < n; i++) {
+        Node *c = node->children[i];
+        int v = atomic_load(&c->visits);
+        if (v > max_visits) {
+            max_visits = v;
+            best = c;
+        }
+    }
+    return best;
+}
+
+int mcts_get_pv(const Node *root, Move *pv, int max_len, double *value) {
+    if (value) *value = 0.5;
+    int len = 0;
+    const Node *node = root;
+    while (len < max_len) {
+        Node *next = most_visited_child(node);
+        if (!next) break;
+        if (len == 0 && value) {
+            int v = atomic_load(&next->visits);
+            *value = v > 0 ? atomic_load(&next->score) / v : 0.5;
+        }
+        if (!movegen_unpack_move(&node->state, next->move_from_parent, &pv[len])) break;
+        len++;
+        node = next;
+    }
+    return len;
+}
+
+// =============================================================================
+// PONDERING
+// =============================================================================
+
+Node* mcts_ponder_start(MCTSAsyncSearch *s, Node *played, Arena *arena, MCTSConfig config,
+                        TranspositionTable *tt) {
+    memset(s, 0, sizeof(*s));
+    if (!played || played->is_terminal) return NULL;
+
+    Node *target = most_visited_child(played);
+    if (!target) target = played;
+    if (target->is_terminal) return NULL;
+
+    // No clock, no budget: until the opponent has moved
+    config.max_nodes = 0;
+    if (mcts_async_start(s, target, arena, 0.0, config, NULL, tt) != 0) return NULL;
+    return target;
+}
+
+Node* mcts_ponder_finish(MCTSAsyncSearch *s, Node *root, const GameState *state, Arena *arena,
+                         Arena *spare, TranspositionTable *tt, int *out_hit) {
+    int hit = 0;
+    if (s->active) {
+        mcts_async_stop(s);
+        mcts_async_wait(s, NULL);
+        hit = states_equal(&s->root->state, state);
+    }
+    if (out_hit) *out_hit = hit;
+    return root ? mcts_advance_root(root, state, arena, spare, tt) : NULL;
+}
@@ -0,0 +1,171 @@
+/**
+ * mcts_inference.c - Batched CNN Evaluation over the Inference Ring
+ *
+ * Contains: inference_process_batch, InferenceServer evaluator threads
+ * Ring and request primitives are in mcts_worker.h
+ */
+
+#include "dama/search/mcts_inference.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/affinity.h"
+#include "dama/common/trace.h"
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+static inline double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// =============================================================================
+// EVALUATOR STEP
+// =============================================================================
+
+int inference_process_batch(InferenceQueue *queue, const CNNWeights *weights, CNNWorkspace *ws,
+                            int target, long gather_us) {
+    InferenceRequest *batch[MCTS_BATCH_SIZE];
+    int current_batch = 0;
+    if (target > MCTS_BATCH_SIZE) target = MCTS_BATCH_SIZE;
+    if (target < 1) target = 1;
+    double deadline = now_us() + gather_us;
+    
+    for (int spins = 0; current_batch < target; spins++) {
+        InferenceRequest *req = inference_queue_pop(queue);
+        if (req) {
+            batch[current_batch++] = req;
+            continue;
+        }
+        if (atomic_load_explicit(&queue->shutdown, memory_order_relaxed)) return 0;
+        if (current_batch == 0) {
+            // Empty ring: sleep until a push, bounded so limits get checked
+            inference_queue_wait_work(queue, INFERENCE_IDLE_US);
+            if (!(req = inference_queue_pop(queue))) return 0;
+            batch[current_batch++] = req;
+            deadline = now_us() + gather_us;
+            continue;
+        }
+        if ((spins & 63) == 63 && now_us() >= deadline) break;
+        if (spins < INFERENCE_SPIN_LIMIT) CPU_RELAX();
+        else sched_yield();
+    }
+    
+    TRACE_BEGIN(t_batch);
+    CNNOutput outputs[MCTS_BATCH_SIZE];
+    const GameState *states[MCTS_BATCH_SIZE];
+    const GameState *hist1s[MCTS_BATCH_SIZE];
+    const GameState *hist2s[MCTS_BATCH_SIZE];
+    CNNPolicySubset legal[MCTS_BATCH_SIZE];
+    
+    for (int i = 0; i < current_batch; i++) {
+        Node *n = batch[i]->node;
+        states[i] = &n->state;
+        hist1s[i] = (n->parent) ? &n->parent->state : NULL;
+        hist2s[i] = (n->parent && n->parent->parent) ? &n->parent->parent->state : NULL;
+        cnn_policy_subset(states[i], &legal[i]);
+    }
+    
+    PROFILE_BEGIN(t0);
+    if (ws) cnn_forward_batch_legal_ws(weights, ws, states, hist1s, hist2s, legal, outputs, current_batch);
+    else cnn_forward_batch_legal(weights, states, hist1s, hist2s, legal, outputs, current_batch);
+    PROFILE_END(PROFILE_INFERENCE, t0);
+    PROFILE_BATCH(current_batch);
+    
+    // Hand results back: outputs first, then the completion flag
+    for (int i = 0; i < current_batch; i++) {
+        InferenceRequest *req = batch[i];
+        memcpy(req->policy_out, outputs[i].policy, CNN_POLICY_SIZE * sizeof(float));
+        *req->value_out = (outputs[i].value + 1.0f) / 2.0f;
+        inference_request_complete(req);
+    }
+    inference_queue_notify_done(queue);
+    TRACE_END("evaluator batch", t_batch);
+    return current_batch;
+}
+
+// =============================================================================
+// SHARED INFERENCE SERVER
+// =============================================================================
+
+static void *inference_server_main(void *arg) {
+    InferenceServer *server = (InferenceServer*)arg;
+    int slot = atomic_fetch_add_explicit(&server->profile_slots, 1, memory_order_relaxed);
+    PROFILE_BIND(&server->profile[slot]);
+    (void)slot;
+    TRACE_THREAD("evaluator");
+    
+    // Own buffers for the evaluator's lifetime (NULL on OOM: thread default)
+    CNNWorkspace *ws = cnn_workspace_create(server->batch_target < MCTS_BATCH_SIZE
+                                            ? server->batch_target : MCTS_BATCH_SIZE);
+    
+    while (!atomic_load_explicit(&server->queue.shutdown, memory_order_relaxed)) {
+        int n = inference_process_batch(&server->queue, server->weights, ws,
+                                        server->batch_target, server->gather_us);
+        if (n > 0) {
+            atomic_fetch_add_explicit(&server->total_batches, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&server->total_requests, n, memory_order_relaxed);
+        }
+    }
+    cnn_workspace_free(ws);
+    return NULL;
+}
+
+int inference_server_start(InferenceServer *server, const CNNWeights *weights,
+                           int max_in_flight, long gather_us, int evaluators) {
+    RETURN_IF_NULL(server, ERR_NULL_PTR);
+    RETURN_IF_NULL(weights, ERR_NULL_PTR);
+    
+    if (evaluators < 1) evaluators = 1;
+    if (evaluators > INFERENCE_MAX_EVALUATORS) evaluators = INFERENCE_MAX_EVALUATORS;
+    if (max_in_flight < 1) max_in_flight = 1;
+    
+    inference_queue_init(&server->queue);
+    server->weights = weights;
+    server->gather_us = gather_us;
+    // Split pending requests so every evaluator can fill its batch
+    server->batch_target = (max_in_flight + evaluators - 1) / evaluators;
+    atomic_init(&server->total_batches, 0);
+    atomic_init(&server->total_requests, 0);
+    atomic_init(&server->profile_slots, 0);
+    memset(server->profile, 0, sizeof(server->profile));
+    
+    // Evaluators stay on the node of the thread that set the queue up
+    pthread_attr_t attr;
+    const int near = affinity_helper_attr(&attr);
+    server->num_evaluators = 0;
+    for (int i = 0; i < evaluators; i++) {
+        if (pthread_create(&server->threads[i], near ? &attr : NULL, inference_server_main, server) != 0) {
+            if (near) pthread_attr_destroy(&attr);
+            log_error("[Inference] Failed to start evaluator thread %d", i);
+            inference_server_stop(server);
+            return ERR_MEMORY;
+        }
+        server->num_evaluators++;
+    }
+    if (near) pthread_attr_destroy(&attr);
+    return ERR_OK;
+}
+
+void inference_server_stop(InferenceServer *server) {
+    if (!server) return;
+    inference_queue_shutdown(&server->queue);
+    for (int i = 0; i < server->num_evaluators; i++) pthread_join(server->threads[i], NULL);
+    inference_queue_destroy(&server->queue);
+}
+
+void inference_server_merge_profile(const InferenceServer *server, MCTSProfile *out) {
+    if (!server || !out) return;
+    for (int i = 0; i < server->num_evaluators; i++) mcts_profile_merge(out, &server->profile[i]);
+}
+
+int inference_server_submit(InferenceServer *server, InferenceRequest *req) {
+    // Only full when more leaves are in flight than ring slots
+    while (!inference_queue_push(&server->queue, req)) {
+        if (atomic_load_explicit(&server->queue.shutdown, memory_order_relaxed)) return 0;
+        sched_yield();
+    }
+    return 1;
+}
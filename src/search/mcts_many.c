@@ -0,0 +1,213 @@
+/**
+ * mcts_many.c - Search a Batch of Positions
+ *
+ * Contains: mcts_search_many (one search per thread, shared eval cache and
+ * inference server, results reported in input order), position parsing
+ */
+
+#include "dama/search/mcts_many.h"
+#include "dama/search/mcts.h"
+#include "dama/search/mcts_inference.h"
+#include "dama/search/mcts_pool.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/engine/game_view.h"
+#include "dama/engine/movegen.h"
+#include "dama/engine/zobrist.h"
+#include "dama/common/params.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/logging.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// =============================================================================
+// ONE POSITION
+// =============================================================================
+
+// Root value for the side to move, in [-1, 1]
+static float root_value(const Node *root) {
+    double score = 0.0;
+    long visits = 0;
+    for (int i = 0; i < root->num_children; i++) {
+        score += root->children[i]->score;
+        visits += root->children[i]->visits;
+    }
+    return visits > 0 ? (float)(2.0 * score / visits - 1.0) : 0.0f;
+}
+
+static void search_position(const SearchPosition *pos, MCTSConfig cfg, size_t arena_size,
+                            SearchManyResult *out) {
+    if (!movegen_has_any_move(&pos->state)) return;
+    SearchSlot *slot = search_pool_acquire(0, arena_size, &ARENA_BACKING_SEARCH, 0, cfg.use_tt);
+    Node *history, *root = NULL;
+    if (slot && mcts_history_chain(pos->history, pos->plies, &slot->arena, &history) == 0) {
+        root = mcts_create_root_with_history(pos->state, &slot->arena, cfg, history);
+    }
+    if (!root) {
+        log_warn("[Search] No memory for position %d, skipped", out->index);
+        return;
+    }
+
+    out->best = mcts_search(root, &slot->arena, 0.0, cfg, NULL, slot->tt, NULL);
+    out->visits = root->visits;
+    out->value = root_value(root);
+
+    // Visit distribution, most visited first (insertion: at most MAX_MOVES)
+    for (int i = 0; i < root->num_children; i++) {
+        const Node *child = root->children[i];
+        int k = out->num_moves++;
+        for (; k > 0 && out->move_visits[k - 1] < child->visits; k--) {
+            out->moves[k] = out->moves[k - 1];
+            out->move_visits[k] = out->move_visits[k - 1];
+        }
+        out->moves[k] = child->move_from_parent;
+        out->move_visits[k] = child->visits;
+    }
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int mcts_search_many(const SearchPosition *positions, int count, const MCTSConfig *config,
+                     const SearchManyConfig *many, SearchManyResult *results, SearchManyStats *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (count < 0 || (count > 0 && (!positions || !results)) || many->nodes <= 0) return -1;
+    if (count == 0) return 0;
+
+#ifdef _OPENMP
+    int threads = many->threads > 0 ? many->threads : omp_get_max_threads();
+#else
+    int threads = 1;
+#endif
+    if (threads > count) threads = count;
+    const size_t arena_size = many->arena_size ? many->arena_size : ARENA_SIZE_ANALYSE;
+
+    MCTSConfig cfg = *config;
+    cfg.max_nodes = many->nodes;
+    cfg.num_threads = 0;
+    cfg.root_parallel = 0;
+    cfg.use_tree_reuse = 0;
+
+    // Same setup as reanalyse: one eval cache, leaves batched across searches
+    const CNNWeights *weights = (const CNNWeights*)cfg.cnn_weights;
+    CNNCache *cache = NULL;
+    if (weights && !cfg.cnn_cache) {
+        cache = cnn_cache_create(CNN_CACHE_SIZE_DEFAULT);
+        cfg.cnn_cache = cache;
+    }
+    InferenceServer server;
+    int use_server = weights && threads > 1 && !cfg.inference_server;
+    if (use_server) {
+        int leaves = cfg.leaf_batch > 1 ? cfg.leaf_batch : 1;
+        if (inference_server_start(&server, weights, threads * leaves, INFERENCE_SERVER_GATHER_US, 1) == ERR_OK) {
+            cfg.inference_server = &server;
+        } else {
+            log_warn("[Search] Inference server unavailable, searches evaluate locally");
+            use_server = 0;
+        }
+    }
+
+    unsigned char *done = calloc((size_t)count, 1);
+    if (!done) {
+        if (use_server) inference_server_stop(&server);
+        cnn_cache_free(cache);
+        return -1;
+    }
+
+    const double start = now_seconds();
+    int next = 0, searched = 0;
+    long nodes = 0;
+    #pragma omp parallel for num_threads(threads) schedule(dynamic) reduction(+:searched, nodes)
+    for (int i = 0; i < count; i++) {
+        SearchManyResult *r = &results[i];
+        memset(r, 0, sizeof(*r));
+        r->index = i;
+        search_position(&positions[i], cfg, arena_size, r);
+        if (r->visits > 0) searched++;
+        nodes += r->visits;
+
+        // Report every finished result no earlier one is still holding back
+        #pragma omp critical(search_many_report)
+        {
+            done[i] = 1;
+            for (; next < count && done[next]; next++) {
+                if (many->on_result) many->on_result(&results[next], many->user);
+            }
+        }
+    }
+
+    if (stats) {
+        stats->searched = searched;
+        stats->nodes = nodes;
+        stats->seconds = now_seconds() - start;
+    }
+    free(done);
+    if (use_server) inference_server_stop(&server);
+    cnn_cache_free(cache);
+    return 0;
+}
+
+// =============================================================================
+// POSITION TEXT
+// =============================================================================
+
+static int parse_board(const char *squares, const char *side, GameState *s) {
+    if (strlen(squares) != 32 || (strcmp(side, "w") != 0 && strcmp(side, "b") != 0)) return 0;
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < 32; i++) {
+        const int sq = DARK_SQUARE(i);
+        switch (squares[i]) {
+            case 'w': SET_BIT(s->piece[WHITE][PAWN], sq); break;
+            case 'W': SET_BIT(s->piece[WHITE][LADY], sq); break;
+            case 'b': SET_BIT(s->piece[BLACK][PAWN], sq); break;
+            case 'B': SET_BIT(s->piece[BLACK][LADY], sq); break;
+            case '.': break;
+            default: return 0;
+        }
+    }
+    s->current_player = side[0] == 'w' ? WHITE : BLACK;
+    s->hash = zobrist_compute_hash(s);
+    return 1;
+}
+
+int search_position_parse(char **tok, int n, SearchPosition *out, const char **bad_move) {
+    SearchPosition pos;
+    memset(&pos, 0, sizeof(pos));
+    *bad_move = NULL;
+    int i;
+    if (n >= 1 && strcmp(tok[0], "startpos") == 0) {
+        init_game(&pos.state);
+        i = 1;
+    } else if (n >= 3 && strcmp(tok[0], "board") == 0 && parse_board(tok[1], tok[2], &pos.state)) {
+        i = 3;
+    } else {
+        return -1;
+    }
+
+    if (i < n && strcmp(tok[i], "moves") == 0) {
+        for (i++; i < n; i++) {
+            Move m;
+            if (!parse_move(&pos.state, tok[i], &m)) {
+                *bad_move = tok[i];
+                return -1;
+            }
+            pos.history[1] = pos.history[0];
+            pos.history[0] = pos.state;
+            if (pos.plies < 2) pos.plies++;
+            apply_move(&pos.state, &m);
+        }
+    }
+    *out = pos;
+    return 0;
+}
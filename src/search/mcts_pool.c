@@ -0,0 +1,86 @@
+/**
+ * mcts_pool.c - Per-Thread Pool of Search Memory Across Games
+ *
+ * The pool hangs off a pthread key, whose destructor frees it when the
+ * thread exits.
+ */
+
+#include "dama/search/mcts_pool.h"
+#include "dama/common/params.h"
+#include <pthread.h>
+
+typedef struct {
+    SearchSlot slots[SEARCH_POOL_SLOTS];
+} SearchPool;
+
+static pthread_key_t pool_key;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static void pool_destroy(void *ptr) {
+    SearchPool *pool = ptr;
+    if (!pool) return;
+    for (int i = 0; i < SEARCH_POOL_SLOTS; i++) {
+        SearchSlot *s = &pool->slots[i];
+        if (s->arena.buffer) arena_free(&s->arena);
+        if (s->spare.buffer) arena_free(&s->spare);
+        tt_free(s->tt);
+    }
+    free(pool);
+}
+
+static void pool_key_init(void) {
+    pthread_key_create(&pool_key, pool_destroy);
+}
+
+static SearchPool* thread_pool(void) {
+    pthread_once(&pool_once, pool_key_init);
+    SearchPool *pool = pthread_getspecific(pool_key);
+    if (!pool) {
+        pool = calloc(1, sizeof(SearchPool));
+        if (pool && pthread_setspecific(pool_key, pool) != 0) {
+            free(pool);
+            pool = NULL;
+        }
+    }
+    return pool;
+}
+
+static int same_backing(const ArenaOptions *a, const ArenaOptions *b) {
+    return a->pages == b->pages && a->prefault_bytes == b->prefault_bytes && a->reset_keep == b->reset_keep;
+}
+
+// Empty arena of the requested size and backing: reset if it already has them, else reallocated
+static int ready_arena(Arena *a, size_t size, const ArenaOptions *backing) {
+    static const ArenaOptions plain;
+    if (a->buffer && a->size == size && same_backing(&a->backing, backing ? backing : &plain)) {
+        arena_reset(a);
+        return 0;
+    }
+    if (a->buffer) arena_free(a);
+    return arena_init_with(a, size, backing);
+}
+
+SearchSlot* search_pool_acquire(int index, size_t arena_size, const ArenaOptions *backing,
+                                int want_spare, int want_tt) {
+    if (index < 0 || index >= SEARCH_POOL_SLOTS) return NULL;
+    SearchPool *pool = thread_pool();
+    if (!pool) return NULL;
+
+    SearchSlot *s = &pool->slots[index];
+    if (ready_arena(&s->arena, arena_size, backing) != 0) return NULL;
+    if (want_spare && ready_arena(&s->spare, arena_size, backing) != 0) return NULL;
+    if (want_tt) {
+        if (!s->tt) s->tt = tt_create(TT_SIZE_DEFAULT);
+        else tt_reset(s->tt);
+        if (!s->tt) return NULL;
+    }
+    return s;
+}
+
+void search_pool_release(void) {
+    pthread_once(&pool_once, pool_key_init);
+    SearchPool *pool = pthread_getspecific(pool_key);
+    if (!pool) return;
+    pthread_setspecific(pool_key, NULL);
+    pool_destroy(pool);
+}
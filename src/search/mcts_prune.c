@@ -0,0 +1,157 @@
+/**
+ * mcts_prune.c - Bounded-Memory Search
+ *
+ * Contains: mcts_prune_tree (collapse low-visit subtrees and recycle their
+ * nodes through the arena free lists)
+ */
+
+#include "dama/search/mcts.h"
+#include "dama/search/mcts_internal.h"
+#include "dama/common/logging.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================================
+// COLLECT
+// =============================================================================
+
+// Tag of each reachable node: 1 + the most visits among its parents, so
+// a node is worth keeping as long as some parent's children are kept
+static long collect_nodes(const Node *node, const Node *root, NodeMap *seen) {
+    long count = 0;
+    for (int i = 0; i < node->num_children; i++) {
+        const Node *child = node->children[i];
+        uintptr_t tag = (node == root) ? (uintptr_t)INT_MAX + 1 : (uintptr_t)node->visits + 1;
+        uintptr_t old = node_map_get(seen, child);
+        if (old) {
+            if (tag > old) node_map_put(seen, child, tag);
+            continue;
+        }
+        node_map_put(seen, child, tag);
+        count += 1 + collect_nodes(child, root, seen);
+    }
+    return count;
+}
+
+static int compare_desc(const void *a, const void *b) {
+    uintptr_t x = *(const uintptr_t*)a, y = *(const uintptr_t*)b;
+    return (x < y) - (x > y);
+}
+
+// =============================================================================
+// MARK / SWEEP
+// =============================================================================
+
+// Kept nodes map to the parent they were reached through
+static void mark_kept(Node *node, const Node *root, int threshold, NodeMap *keep) {
+    if (node != root && node->visits < threshold) return; // Kept as a leaf
+    for (int i = 0; i < node->num_children; i++) {
+        Node *child = node->children[i];
+        if (node_map_get(keep, child)) continue;
+        node_map_put(keep, child, (uintptr_t)node);
+        mark_kept(child, root, threshold, keep);
+    }
+}
+
+// Children first: a block is only released once nothing reads it anymore
+static void sweep(Node *node, const Node *root, int threshold, NodeMap *keep, NodeMap *seen,
+                  Arena *arena, long *freed) {
+    for (int i = 0; i < node->num_children; i++) {
+        Node *child = node->children[i];
+        if (node_map_get(seen, child)) continue;
+        node_map_put(seen, child, 1);
+        sweep(child, root, threshold, keep, seen, arena, freed);
+    }
+    
+    int kept = (node == root) || node_map_get(keep, node);
+    if (kept && (node == root || node->visits >= threshold)) return;
+    
+    if (node->children) arena_release(arena, node->children, child_block_bytes(node->child_capacity));
+    if (kept) {
+        // Collapsed to a leaf: its statistics stay, children grow back on demand
+        node->children = NULL;
+        node->child_capacity = 0;
+        node->num_children = 0;
+        atomic_store_explicit(&node->expand_state, NODE_UNEXPANDED, memory_order_relaxed);
+    } else {
+        arena_release(arena, node, sizeof(Node));
+        (*freed)++;
+    }
+}
+
+// =============================================================================
+// PUBLIC API
+// =============================================================================
+
+long mcts_prune_tree(Node *root, Arena *arena, TranspositionTable *tt, long limit, long target,
+                     long *out_freed) {
+    if (out_freed) *out_freed = 0;
+    if (!root || !arena) return -1;
+    
+    // Every node takes at least sizeof(Node) of the arena: an upper bound
+    // on the walk, which counts TT-shared nodes once
+    NodeMap seen;
+    size_t bound = arena_bytes_in_use(arena) / sizeof(Node) + 1;
+    if (node_map_init(&seen, bound) != 0) {
+        log_error("[Prune] Failed to allocate node map");
+        return -1;
+    }
+    long live = 1 + collect_nodes(root, root, &seen);
+    if (live <= limit) {
+        node_map_free(&seen);
+        return live;
+    }
+    
+    // Threshold: parents below it lose their children. Only the best
+    // (target - 1 - root children) tags survive; root children always do
+    uintptr_t *tags = malloc(live * sizeof(uintptr_t));
+    if (!tags) {
+        node_map_free(&seen);
+        log_error("[Prune] Failed to allocate tag buffer");
+        return -1;
+    }
+    long n = 0;
+    for (size_t i = 0; i <= seen.mask; i++) {
+        if (seen.keys[i] && seen.values[i] <= (uintptr_t)INT_MAX) tags[n++] = seen.values[i];
+    }
+    qsort(tags, n, sizeof(uintptr_t), compare_desc);
+    long slots = target - 1 - root->num_children;
+    if (slots < 0) slots = 0;
+    int threshold = (slots < n) ? (int)tags[slots] : 1;     // tag = visits + 1
+    free(tags);
+    
+    NodeMap keep;
+    memset(seen.keys, 0, (seen.mask + 1) * sizeof(Node*));
+    if (node_map_init(&keep, (size_t)live) != 0) {
+        node_map_free(&seen);
+        log_error("[Prune] Failed to allocate node map");
+        return -1;
+    }
+    mark_kept(root, root, threshold, &keep);
+    
+    long freed = 0;
+    sweep(root, root, threshold, &keep, &seen, arena, &freed);
+    
+    // Backprop follows node->parent, and a TT-shared node's creator may be
+    // gone: every kept node hangs off the parent it was reached through
+    // (the same one in a plain tree). The TT only keeps survivors.
+    if (tt) tt_reset(tt);
+    for (size_t i = 0; i <= keep.mask; i++) {
+        Node *node = (Node*)keep.keys[i];
+        if (!node || node == root) continue;
+        node->parent = (Node*)keep.values[i];
+        if (tt) tt_insert(tt, node);
+    }
+    // Owners may have changed: re-map every child block
+    child_stats_rebuild(root);
+    for (size_t i = 0; i <= keep.mask; i++) {
+        if (keep.keys[i]) child_stats_rebuild((Node*)keep.keys[i]);
+    }
+    
+    node_map_free(&keep);
+    node_map_free(&seen);
+    path_set_invalidate(&path_tls);
+    if (out_freed) *out_freed = freed;
+    return live - freed;
+}
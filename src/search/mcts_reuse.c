@@ -0,0 +1,158 @@
+/**
+ * mcts_reuse.c - Tree Reuse Across Moves
+ *
+ * Contains: mcts_advance_root (find the played position, compact its
+ * subtree into a spare arena, remap the TT)
+ */
+
+#include "dama/search/mcts.h"
+#include "dama/search/mcts_internal.h"
+#include "dama/common/logging.h"
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================================
+// SUBTREE COPY
+// =============================================================================
+
+// Depth-first copy; a child array that no longer fits is dropped and the
+// node falls back to unexpanded (its own stats are kept)
+static Node* copy_subtree(const Node *src, Node *parent, Arena *dst, NodeMap *map,
+                          TranspositionTable *tt, int *copied) {
+    Node *done = (Node*)node_map_get(map, src);
+    if (done) return done;
+    
+    Node *n = arena_alloc(dst, sizeof(Node));
+    if (!n) return NULL;
+    memcpy(n, src, sizeof(Node));
+    n->parent = parent;
+    n->depth = parent ? (uint16_t)(parent->depth + 1) : 0;
+    atomic_store_explicit(&n->virtual_loss, 0, memory_order_relaxed);
+    n->children = NULL;
+    n->child_capacity = 0;
+    n->num_children = 0;
+    node_map_put(map, src, (uintptr_t)n);
+    (*copied)++;
+    if (tt && parent) tt_insert(tt, n);
+    
+    if (src->children && src->num_children > 0) {
+        if (*copied >= (int)((map->mask + 1) / 2)) goto truncated;    // Map full
+        if (!node_alloc_children(n, dst, src->num_legal)) goto truncated;
+    
+        for (int i = 0; i < src->num_children; i++) {
+            Node *child = copy_subtree(src->children[i], n, dst, map, tt, copied);
+            if (!child) break;
+            child_stats_attach(n, n->num_children++, child);
+        }
+        if (n->num_children < src->num_children) {
+            atomic_store_explicit(&n->expand_state, NODE_UNEXPANDED, memory_order_relaxed);
+        }
+    }
+    return n;
+    
+truncated:
+    n->children = NULL;
+    atomic_store_explicit(&n->expand_state, NODE_UNEXPANDED, memory_order_relaxed);
+    return n;
+}
+
+// History nodes carry only a state (CNN input, repetition checks)
+static Node* copy_history_node(const Node *src, Arena *dst) {
+    if (!src) return NULL;
+    Node *h = arena_alloc(dst, sizeof(Node));
+    if (!h) return NULL;
+    memset(h, 0, sizeof(Node));
+    h->state = src->state;
+    h->move_from_parent = src->move_from_parent;
+    h->player_who_just_moved = src->player_who_just_moved;
+    return h;
+}
+
+static inline int node_matches(const Node *n, const GameState *state) {
+    return n->state.hash == state->hash && states_equal(&n->state, state);
+}
+
+// The path found here gives the history: with TT sharing, the target's
+// own parent pointer may come from another move order
+static Node* find_reuse_root(Node *root, const GameState *state,
+                             const Node **hist1, const Node **hist2) {
+    if (node_matches(root, state)) {
+        *hist1 = root->parent;
+        *hist2 = root->parent ? root->parent->parent : NULL;
+        return root;
+    }
+    for (int i = 0; i < root->num_children; i++) {
+        Node *c = root->children[i];
+        if (node_matches(c, state)) {
+            *hist1 = root;
+            *hist2 = root->parent;
+            return c;
+        }
+    }
+    // Two plies: our move, then the opponent's reply
+    for (int i = 0; i < root->num_children; i++) {
+        Node *c = root->children[i];
+        for (int j = 0; j < c->num_children; j++) {
+            if (node_matches(c->children[j], state)) {
+                *hist1 = c;
+                *hist2 = root;
+                return c->children[j];
+            }
+        }
+    }
+    return NULL;
+}
+
+// Whole structs: the backing (mapping, page size, pre-fault thread) and the
+// high-water mark travel with their buffer. No thread allocates from either.
+static void arena_swap(Arena *a, Arena *b) {
+    Arena tmp;
+    memcpy(&tmp, a, sizeof(Arena));
+    memcpy(a, b, sizeof(Arena));
+    memcpy(b, &tmp, sizeof(Arena));
+    
+    // Cached per-thread chunks point into the old buffers
+    atomic_store(&a->generation, arena_next_generation());
+    atomic_store(&b->generation, arena_next_generation());
+}
+
+// =============================================================================
+// PUBLIC API
+// =============================================================================
+
+Node* mcts_advance_root(Node *root, const GameState *state, Arena *arena, Arena *spare,
+                        TranspositionTable *tt) {
+    if (!root || !state || !arena || !spare || !spare->buffer) return NULL;
+    
+    const Node *hist1 = NULL, *hist2 = NULL;
+    Node *target = find_reuse_root(root, state, &hist1, &hist2);
+    if (!target) return NULL;
+    
+    NodeMap map;
+    if (node_map_init(&map, arena_bytes_in_use(arena) / sizeof(Node) + 1) != 0) {
+        log_error("[Reuse] Failed to allocate node map");
+        return NULL;
+    }
+    
+    arena_reset(spare);
+    tt_reset(tt);
+    
+    Node *history = copy_history_node(hist1, spare);
+    if (history) history->parent = copy_history_node(hist2, spare);
+    int copied = 0;
+    Node *new_root = copy_subtree(target, NULL, spare, &map, tt, &copied);
+    node_map_free(&map);
+    
+    if (!new_root) {
+        arena_reset(spare);
+        tt_reset(tt);
+        return NULL;
+    }
+    new_root->parent = history;
+    
+    // The compacted tree now lives in *arena; the old buffer becomes the spare
+    arena_swap(arena, spare);
+    arena_reset(spare);
+    path_set_invalidate(&path_tls);
+    return new_root;
+}
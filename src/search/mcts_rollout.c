@@ -1,46 +1,62 @@
 /**
  * mcts_rollout.c - MCTS Rollout/Simulation
  * 
- * Contains: simulate_rollout, pick_smart_move
+ * Contains: simulate_rollout (batched playouts), pick_smart_move,
+ * mcts_rollout_set_rng
  */
 
 #include "dama/search/mcts_types.h"
 #include "dama/search/mcts_tree.h"
 #include "dama/engine/movegen.h"
+#include "dama/engine/tablebase.h"
 #include "dama/neural/cnn.h"
 #include "dama/common/params.h"
 #include "dama/common/rng.h"
 #include <stdlib.h>
 #include <math.h>
 
+// Private generator of the calling thread's tree (root-parallel search)
+// or of the leaf it plays out (deterministic search)
+static __thread RNG *rollout_rng;
+
+RNG* mcts_rollout_set_rng(RNG *rng) {
+    RNG *prev = rollout_rng;
+    rollout_rng = rng;
+    return prev;
+}
+
 /**
  * Pick a move using heuristics (greedy or epsilon-greedy).
+ * The lookahead plays candidates on 'state' and takes them back, so it is
+ * left unchanged on return.
  */
-static Move pick_smart_move(const MoveList *list, const GameState *state, int use_lookahead, MCTSConfig config) {
+static Move pick_smart_move(const MoveList *list, GameState *state, int use_lookahead, const MCTSConfig *config) {
     if (list->count == 1) return list->moves[0];
 
     int best_score = -100000;
     int best_idx = 0;
+    MoveHeuristic h;
+    move_heuristic_init(&h, state, config);
 
     for (int i = 0; i < list->count; i++) {
-        Move m = list->moves[i];
+        const Move *m = &list->moves[i];
         int score = 0;
         
-        if (m.length > 0) score += 1000 * m.length;
-        score += (int)evaluate_move_heuristic(state, &m, config);
+        if (m->length > 0) score += 1000 * m->length;
+        score += (int)move_heuristic_score(&h, m->path[0], m->path[m->length == 0 ? 1 : m->length],
+                                           m->length, m->is_lady_move);
 
         // Danger check (1-ply lookahead in endgame)
-        if (use_lookahead && m.length == 0) {
+        if (use_lookahead && m->length == 0) {
             int total_pieces = __builtin_popcountll(get_pieces(state, WHITE) | get_pieces(state, BLACK));
             
             if (total_pieces < 12) {
-                GameState future_state = *state;
-                apply_move(&future_state, &m);
+                MoveUndo undo;
+                apply_move_with_undo(state, m, &undo);
+                const int enemy_can_capture = movegen_has_capture(state);
+                undo_move(state, m, &undo);
                 
-                MoveList enemy_moves;
-                movegen_generate(&future_state, &enemy_moves);
-                
-                if (enemy_moves.count > 0 && enemy_moves.moves[0].length > 0) {
+                if (enemy_can_capture) {
                     score -= WEIGHT_DANGER;
                 }
             }
@@ -55,11 +71,129 @@ static Move pick_smart_move(const MoveList *list, const GameState *state, int us
     return list->moves[best_idx];
 }
 
+// Rollout score of a tablebase result of s, for original_player
+static double tablebase_score(TBResult r, const GameState *s, int original_player) {
+    if (r == TB_DRAW) return DRAW_SCORE;
+    const int winner = (r == TB_WIN) ? (int)s->current_player : 1 - (int)s->current_player;
+    return (winner == original_player) ? WIN_SCORE : LOSS_SCORE;
+}
+
+// =============================================================================
+// PLAYOUTS
+// =============================================================================
+
+// One playout of a batch
+typedef struct {
+    GameState state;
+    int depth;
+    int done;
+    double result;              // For the player who moved into the rolled-out node
+} RolloutLane;
+
+// Score of a lane that reached the depth limit: material with fast
+// rollouts, a draw otherwise
+static double rollout_horizon_score(const GameState *s, int original_player, MCTSConfig config) {
+    if (!config.use_fast_rollout) return DRAW_SCORE;
+    int my_pieces = __builtin_popcountll(get_pieces(s, original_player));
+    int opp_pieces = __builtin_popcountll(get_pieces(s, 1 - original_player));
+    double material_score = 0.5 + FAST_ROLLOUT_MATERIAL_WEIGHT * (my_pieces - opp_pieces);
+    if (material_score < 0.1) material_score = 0.1;
+    if (material_score > 0.9) material_score = 0.9;
+    return material_score;
+}
+
+/**
+ * Play one ply of a lane, or finish it. Random plies (probability
+ * config.rollout_epsilon) draw from the packed move list, which quiet
+ * positions get from the set-wise shift generator without building Move
+ * paths; heuristic plies need the full moves.
+ */
+static inline void rollout_ply(RolloutLane *lane, int original_player, int max_depth,
+                               MCTSConfig config, RNG *rng) {
+    GameState *s = &lane->state;
+    if (lane->depth >= max_depth) {
+        lane->result = rollout_horizon_score(s, original_player, config);
+        lane->done = 1;
+        return;
+    }
+
+    const int random = (double)rng_f32(rng) < config.rollout_epsilon;
+    PackedMoveList packed;
+    MoveList moves;
+    int count;
+    PROFILE_BEGIN(t_movegen);
+    if (random) {
+        movegen_generate_packed(s, &packed);
+        count = packed.count;
+    } else {
+        movegen_generate(s, &moves);
+        count = moves.count;
+    }
+    PROFILE_END(PROFILE_MOVEGEN, t_movegen);
+
+    if (count == 0) {
+        int winner = (s->current_player == WHITE) ? BLACK : WHITE;
+        double score = LOSS_SCORE;
+        if (winner == original_player) {
+            score = WIN_SCORE;
+            if (config.use_decaying_reward) score *= pow(config.decay_factor, lane->depth);
+        }
+        lane->result = score;
+        lane->done = 1;
+        return;
+    }
+    if (s->moves_without_captures >= MAX_MOVES_WITHOUT_CAPTURES) {
+        lane->result = DRAW_SCORE;
+        lane->done = 1;
+        return;
+    }
+
+    const Bitboard occupied = get_all_occupied(s);
+    if (random) {
+        apply_packed_move(s, packed.moves[rng_u32(rng) % count]);
+    } else {
+        PROFILE_BEGIN(t_heuristic);
+        Move chosen = pick_smart_move(&moves, s, config.use_lookahead, &config);
+        PROFILE_END(PROFILE_HEURISTIC, t_heuristic);
+        apply_move(s, &chosen);
+    }
+    lane->depth++;
+    const int captured = __builtin_popcountll(get_all_occupied(s)) < __builtin_popcountll(occupied);
+
+    // A capture may have brought the game into the tablebase
+    if (config.tablebase && captured) {
+        const TBResult r = tablebase_probe(config.tablebase, s);
+        if (r != TB_UNKNOWN) {
+            lane->result = tablebase_score(r, s, original_player);
+            lane->done = 1;
+            return;
+        }
+    }
+
+    // Fast rollout: early termination on material advantage
+    if (config.use_fast_rollout && lane->depth % 5 == 0) {  // Check every 5 moves
+        int my_pieces = __builtin_popcountll(get_pieces(s, original_player));
+        int opp_pieces = __builtin_popcountll(get_pieces(s, 1 - original_player));
+        int diff = my_pieces - opp_pieces;
+
+        if (diff >= FAST_ROLLOUT_MATERIAL_THRESHOLD) {
+            lane->result = FAST_ROLLOUT_WIN_SCORE;
+            lane->done = 1;
+        } else if (diff <= -FAST_ROLLOUT_MATERIAL_THRESHOLD) {
+            lane->result = FAST_ROLLOUT_LOSS_SCORE;
+            lane->done = 1;
+        }
+    }
+}
+
 /**
  * Simulate rollout from node.
  * 
  * If a neural network is available (config.cnn_weights), it performs a forward pass
- * to estimate the value. Otherwise, it performs a classic random/heuristic rollout.
+ * to estimate the value. Otherwise, it performs classic random/heuristic
+ * rollouts: config.rollouts_per_leaf of them (at most ROLLOUT_BATCH_MAX),
+ * played in lockstep and averaged (leaf parallelism). The lanes of a ply
+ * are independent, so their movegen and heuristics overlap in the core.
  * 
  * Returns:
  *   Value in range [0, 1] for backpropagation.
@@ -70,78 +204,52 @@ double simulate_rollout(Node *node, MCTSConfig config) {
         CNNOutput out;
         const GameState *hist1 = node->parent ? &node->parent->state : NULL;
         const GameState *hist2 = (node->parent && node->parent->parent) ? &node->parent->parent->state : NULL;
-        cnn_forward_with_history((CNNWeights*)config.cnn_weights, &node->state, hist1, hist2, &out);
+        CNNPolicySubset value_only = { .count = 0 };   // Policy unused here
+        PROFILE_BEGIN(t0);
+        cnn_forward_legal((CNNWeights*)config.cnn_weights, &node->state, hist1, hist2, &value_only, &out);
+        PROFILE_END(PROFILE_INFERENCE, t0);
         return (out.value + 1.0f) / 2.0f;
     }
 
-    GameState temp_state = node->state;
     int original_player = node->player_who_just_moved;
     
     if (node->is_terminal) {
-        int winner = (temp_state.current_player == WHITE) ? BLACK : WHITE;
+        int winner = (node->state.current_player == WHITE) ? BLACK : WHITE;
         return (winner == original_player) ? WIN_SCORE : LOSS_SCORE;
     }
 
-    int depth = 0;
-    MoveList temp_moves;
-    
+    // Proven at creation (tablebase) or copied from the TT: nothing to play out
+    if (node->status == SOLVED_WIN) return tablebase_score(TB_WIN, &node->state, original_player);
+    if (node->status == SOLVED_LOSS) return tablebase_score(TB_LOSS, &node->state, original_player);
+    if (node->status == SOLVED_DRAW) return DRAW_SCORE;
+
     // Use shorter depth for fast rollout
     int max_depth = config.use_fast_rollout ? 
                     (config.fast_rollout_depth > 0 ? config.fast_rollout_depth : 50) : 
                     MAX_ROLLOUT_DEPTH;
     
-    while (depth < max_depth) {
-        movegen_generate(&temp_state, &temp_moves);
-
-        if (temp_moves.count == 0) {
-            int winner = (temp_state.current_player == WHITE) ? BLACK : WHITE;
-            if (winner == original_player) {
-                double score = WIN_SCORE;
-                if (config.use_decaying_reward) score *= pow(config.decay_factor, depth);
-                return score;
-            }
-            return LOSS_SCORE;
-        }
-        
-        if (temp_state.moves_without_captures >= MAX_MOVES_WITHOUT_CAPTURES) {
-            return DRAW_SCORE;
-        }
-
-        Move chosen_move;
-        
-        // Use thread-safe global RNG
-        RNG *rng = rng_global();
-        double r = (double)rng_f32(rng);
-
-        if (r < config.rollout_epsilon) {
-            chosen_move = temp_moves.moves[rng_u32(rng) % temp_moves.count];
-        } else {
-            chosen_move = pick_smart_move(&temp_moves, &temp_state, config.use_lookahead, config);
-        }
-
-        apply_move(&temp_state, &chosen_move);
-        depth++;
-        
-        // Fast rollout: early termination on material advantage
-        if (config.use_fast_rollout && depth % 5 == 0) {  // Check every 5 moves
-            int my_pieces = __builtin_popcountll(get_pieces(&temp_state, original_player));
-            int opp_pieces = __builtin_popcountll(get_pieces(&temp_state, 1 - original_player));
-            int diff = my_pieces - opp_pieces;
-            
-            if (diff >= FAST_ROLLOUT_MATERIAL_THRESHOLD) return FAST_ROLLOUT_WIN_SCORE;
-            if (diff <= -FAST_ROLLOUT_MATERIAL_THRESHOLD) return FAST_ROLLOUT_LOSS_SCORE;
-        }
+    int lanes = config.rollouts_per_leaf;
+    if (lanes < 1) lanes = 1;
+    if (lanes > ROLLOUT_BATCH_MAX) lanes = ROLLOUT_BATCH_MAX;
+    
+    RolloutLane batch[ROLLOUT_BATCH_MAX];
+    for (int i = 0; i < lanes; i++) {
+        batch[i].state = node->state;
+        batch[i].depth = 0;
+        batch[i].done = 0;
     }
     
-    // At max depth: return material-based evaluation instead of draw
-    if (config.use_fast_rollout) {
-        int my_pieces = __builtin_popcountll(get_pieces(&temp_state, original_player));
-        int opp_pieces = __builtin_popcountll(get_pieces(&temp_state, 1 - original_player));
-        double material_score = 0.5 + FAST_ROLLOUT_MATERIAL_WEIGHT * (my_pieces - opp_pieces);
-        if (material_score < 0.1) material_score = 0.1;
-        if (material_score > 0.9) material_score = 0.9;
-        return material_score;
+    RNG *rng = rollout_rng ? rollout_rng : rng_global();
+    int active = lanes;
+    while (active > 0) {
+        for (int i = 0; i < lanes; i++) {
+            if (batch[i].done) continue;
+            rollout_ply(&batch[i], original_player, max_depth, config, rng);
+            active -= batch[i].done;
+        }
     }
     
-    return DRAW_SCORE;
+    double total = 0.0;
+    for (int i = 0; i < lanes; i++) total += batch[i].result;
+    return total / lanes;
 }
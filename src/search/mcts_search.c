@@ -1,17 +1,24 @@
 /**
  * mcts_search.c - MCTS Main Search Algorithm
  * 
- * Contains: mcts_search, mcts_step_sequential, should_exit_early
- * Worker threads are in mcts_worker.c
+ * Contains: mcts_search (sequential loop, threaded controller or
+ * root-parallel trees), mcts_step_sequential, mcts_step_lockstep
+ * (deterministic search), should_exit_early
+ * Worker threads are in mcts_worker.c, evaluator threads in mcts_inference.c
  */
 
 #include "dama/search/mcts.h"
 #include "dama/search/mcts_tree.h"
 #include "dama/search/mcts_internal.h"
 #include "dama/search/mcts_worker.h"
+#include "dama/search/mcts_inference.h"
+#include "dama/search/search_cache.h"
 #include "dama/neural/cnn.h"
 #include "dama/common/params.h"
 #include "dama/common/debug.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/affinity.h"
+#include "dama/common/trace.h"
 #include "dama/engine/movegen.h"
 #include <time.h>
 #include <stdio.h>
@@ -24,7 +31,6 @@
 
 // External functions from mcts_utils.c
 extern int get_tree_depth(const Node *node);
-extern int get_tree_node_count(const Node *node);
 
 // =============================================================================
 // HELPER FUNCTIONS
@@ -36,10 +42,7 @@ static int get_game_result(const GameState *state) {
     DBG_NOT_NULL(state);
     if (state->moves_without_captures >= MAX_MOVES_WITHOUT_CAPTURES) return 0; // Draw
     
-    MoveList ml;
-    movegen_generate(state, &ml);
-    
-    if (ml.count == 0) {
+    if (!movegen_has_any_move(state)) {
         // Current player has no moves -> Loses
         return (state->current_player == WHITE) ? 2 : 1;
     }
@@ -48,7 +51,7 @@ static int get_game_result(const GameState *state) {
 }
 
 // Early Exit Check: Returns 1 if the best move cannot be overtaken
-static int should_exit_early(Node *root, int max_nodes) {
+int should_exit_early(Node *root, int max_nodes) {
     if (!root || root->num_children < 2) return 0;
     
     int best_visits = -1;
@@ -72,10 +75,199 @@ static int should_exit_early(Node *root, int max_nodes) {
     return 0;
 }
 
+static inline double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Clock and best-move tracking of one search
+typedef struct {
+    struct timespec start;
+    int start_visits;           // Root visits before this search (reused tree)
+    int next_early_check;
+    int next_time_check;
+    const Node *best;           // Most visited root child at the last time check
+    double best_since;          // Seconds into the search when it took the lead
+} SearchClock;
+
+static void search_clock_start(SearchClock *clk, const Node *root) {
+    memset(clk, 0, sizeof(*clk));
+    clock_gettime(CLOCK_MONOTONIC, &clk->start);
+    clk->start_visits = atomic_load(&root->visits);
+}
+
+/**
+ * Managed time (config.soft_time): stop once the runner-up cannot overtake
+ * the most visited move in the visits the hard limit still allows at the
+ * current rate, or past the soft limit unless the choice is unstable (the
+ * lead changed recently, or the runner-up scores better).
+ */
+static int search_time_decided(const Node *root, MCTSConfig config, double hard, double elapsed,
+                               int visits, SearchClock *clk) {
+    if (root->num_legal == 1 && root->num_children == 1) return 1;  // Forced move
+    
+    const Node *best = NULL, *second = NULL;
+    int v1 = 0, v2 = 0;
+    for (int i = 0; i < root->num_children; i++) {
+        const Node *c = root->children[i];
+        int v = atomic_load(&c->visits);
+        if (v > v1) {
+            second = best; v2 = v1;
+            best = c; v1 = v;
+        } else if (v > v2) {
+            second = c; v2 = v;
+        }
+    }
+    if (!best) return 0;
+    if (best != clk->best) {
+        clk->best = best;
+        clk->best_since = elapsed;
+    }
+    
+    int searched = visits - clk->start_visits;
+    if (searched < EARLY_EXIT_MIN_VISITS || elapsed <= 0) return 0;
+    double to_come = searched / elapsed * (hard - elapsed);
+    if (v1 > v2 + to_come) return 1;
+    
+    if (elapsed < config.soft_time) return 0;
+    int recent_lead = elapsed - clk->best_since < TIME_STABLE_SHARE * elapsed;
+    int runner_up_better = second && v2 > 0 &&
+                           atomic_load(&second->score) / v2 > atomic_load(&best->score) / v1;
+    return !recent_lead && !runner_up_better;
+}
+
+/**
+ * Controller check shared by the sequential loop and the threaded poller.
+ * Early exit is tested once every EARLY_EXIT_CHECK_INTERVAL visits, however
+ * many visits happened since the previous call; so is managed time.
+ */
+static int search_limits_reached(Node *root, MCTSConfig config, double time_limit_seconds,
+                                 SearchClock *clk) {
+    if (config.stop_flag && atomic_load((atomic_int*)config.stop_flag)) return 1;
+    int visits = atomic_load(&root->visits);
+    if (config.max_nodes > 0 && visits >= config.max_nodes) return 1;
+    double elapsed = 0.0;
+    if (time_limit_seconds > 0) {
+        elapsed = elapsed_seconds(&clk->start);
+        if (elapsed >= time_limit_seconds) return 1;
+    }
+    
+    // Early exit needs a node budget: "remaining" is meaningless without one
+    if (config.max_nodes > 0 && visits > EARLY_EXIT_MIN_VISITS && visits >= clk->next_early_check) {
+        clk->next_early_check = visits + EARLY_EXIT_CHECK_INTERVAL;
+        if (should_exit_early(root, config.max_nodes)) return 1;
+    }
+    
+    if (config.soft_time > 0 && time_limit_seconds > 0 && visits >= clk->next_time_check) {
+        clk->next_time_check = visits + EARLY_EXIT_CHECK_INTERVAL;
+        if (search_time_decided(root, config, time_limit_seconds, elapsed, visits, clk)) return 1;
+    }
+    return 0;
+}
+
+/**
+ * Threaded controller: sleep until a worker stops the search or the time
+ * limit expires. A timed wait on the exact deadline, so stopping on time
+ * does not depend on a polling period. With poll_seconds > 0 it returns
+ * after at most that long, for checks only the controller makes (external
+ * stop flag, managed time).
+ */
+static void search_control_wait(SearchControl *control, double time_limit_seconds,
+                                const struct timespec *start, double poll_seconds) {
+    pthread_mutex_lock(&control->lock);
+    while (!atomic_load(&control->stop) && !atomic_load(&control->prune_requested)) {
+        if (time_limit_seconds <= 0 && poll_seconds <= 0) {
+            pthread_cond_wait(&control->cond, &control->lock);
+            continue;
+        }
+        double left = time_limit_seconds > 0 ? time_limit_seconds - elapsed_seconds(start) : poll_seconds;
+        if (left <= 0) break;
+        int polling = poll_seconds > 0 && left >= poll_seconds;
+        if (polling) left = poll_seconds;
+        
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        long long ns = ts.tv_nsec + (long long)(left * 1e9);
+        ts.tv_sec += ns / 1000000000LL;
+        ts.tv_nsec = ns % 1000000000LL;
+        pthread_cond_timedwait(&control->cond, &control->lock, &ts);
+        if (polling) break;
+    }
+    pthread_mutex_unlock(&control->lock);
+}
+
+// =============================================================================
+// BOUNDED MEMORY
+// =============================================================================
+
+// Arena bytes per node until the first prune measures the real ratio
+#define TREE_BYTES_PER_NODE_GUESS ((double)(sizeof(Node) + CHILD_STATS_SLOT_BYTES))
+
+// Arena bytes that may sit unused in the threads' current chunks
+static inline size_t chunk_slack(const Arena *arena, int threads) {
+    return (size_t)(threads + 1) * arena->chunk_size;
+}
+
+/**
+ * Arena usage that triggers a prune: max_tree_nodes at the measured bytes
+ * per node plus the chunk slack, capped below the arena size.
+ * 0 when the search is unbounded.
+ */
+static size_t tree_high_water(const Arena *arena, MCTSConfig config, double bytes_per_node, int threads) {
+    if (config.max_tree_nodes <= 0) return 0;
+    size_t reserve = arena->size / 8 + chunk_slack(arena, threads);
+    size_t cap = (arena->size > reserve) ? arena->size - reserve : arena->size / 2;
+    size_t want = (size_t)(config.max_tree_nodes * bytes_per_node) + chunk_slack(arena, threads);
+    return (want < cap) ? want : cap;
+}
+
+/**
+ * Prune a quiescent tree that reached the high water mark and re-measure
+ * bytes per node for the next mark.
+ * @return 0 if nothing could be freed: the search has to stop there
+ */
+static int search_enforce_budget(Node *root, Arena *arena, TranspositionTable *tt, MCTSConfig config,
+                                 int threads, size_t *high_water, MCTSStats *stats) {
+    long target = (long)(config.max_tree_nodes * MCTS_PRUNE_KEEP_FRACTION);
+    long freed = 0;
+    long live = mcts_prune_tree(root, arena, tt, config.max_tree_nodes, target, &freed);
+    if (live <= 0) {
+        *high_water = 0; // Walk failed: carry on unbounded
+        return 1;
+    }
+    
+    size_t used = arena_bytes_in_use(arena);
+    size_t slack = chunk_slack(arena, threads);
+    double bytes_per_node = (used > slack) ? (double)(used - slack) / live : TREE_BYTES_PER_NODE_GUESS;
+    if (bytes_per_node < sizeof(Node)) bytes_per_node = sizeof(Node);
+    *high_water = tree_high_water(arena, config, bytes_per_node, threads);
+    if (used >= *high_water && freed == 0) {
+        // Within the node budget but at the arena cap: cut anyway
+        long more = 0;
+        live = mcts_prune_tree(root, arena, tt, 0, (long)(live * MCTS_PRUNE_KEEP_FRACTION), &more);
+        freed += more;
+    }
+    
+    if (freed > 0 && stats) {
+        stats->tree_prunes++;
+        stats->nodes_recycled += freed;
+    }
+    if (arena_bytes_in_use(arena) >= *high_water && freed == 0) {
+        log_warn("[MCTS] Node budget %d too small to prune (%ld nodes), stopping search",
+                 config.max_tree_nodes, live);
+        return 0;
+    }
+    return 1;
+}
+
 // --- Common Refactored Steps ---
 
-static inline Node* perform_selection(Node *root, MCTSConfig config) {
-    return select_promising_node(root, config);
+static inline Node* perform_selection(Node *root, SelectKernel select, const MCTSConfig *config) {
+    PROFILE_BEGIN(t0);
+    Node *leaf = select(root, config);
+    PROFILE_END(PROFILE_SELECT, t0);
+    return leaf;
 }
 
 static inline void solve_terminal_node(Node *leaf, MCTSConfig config, MCTSStats *stats) {
@@ -85,88 +277,24 @@ static inline void solve_terminal_node(Node *leaf, MCTSConfig config, MCTSStats
     else if (res == 2) result = (leaf->state.current_player == BLACK) ? 1.0 : 0.0;
     else result = config.draw_score;
     
+    PROFILE_BEGIN(t0);
     backpropagate(leaf, result, config.use_solver);
+    PROFILE_END(PROFILE_BACKPROP, t0);
     if (stats) stats->total_iterations++;
 }
 
 static inline Node* perform_expansion(Node *leaf, Arena *arena, TranspositionTable *tt, MCTSConfig config, float *policy, MCTSStats *stats) {
-    if (config.cnn_weights) {
-        pthread_mutex_lock(&leaf->lock);
-        if (leaf->num_children == 0 && !leaf->is_terminal) {
-            MoveList legal_moves;
-            movegen_generate(&leaf->state, &legal_moves);
-            
-            if (legal_moves.count > 0) {
-                leaf->children = arena_alloc(arena, legal_moves.count * sizeof(Node*));
-                
-                float sum = 0.0f;
-                float *filtered_policy = arena_alloc(arena, legal_moves.count * sizeof(float));
-                
-                for (int i=0; i<legal_moves.count; i++) {
-                    int idx = cnn_move_to_index(&legal_moves.moves[i], leaf->state.current_player);
-                    float p = (idx >= 0 && policy) ? policy[idx] : 0.0f;
-                    filtered_policy[i] = p;
-                    sum += p;
-                }
-                
-                for (int i=0; i<legal_moves.count; i++) {
-                    if (sum > 1e-6) filtered_policy[i] /= sum;
-                    else filtered_policy[i] = 1.0f / legal_moves.count;
-                    
-                    GameState child_state = leaf->state;
-                    apply_move(&child_state, &legal_moves.moves[i]);
-                    
-                    Node *child = NULL;
-                    if (tt) {
-                        child = tt_lookup(tt, &child_state);
-                        if (child) {
-                            if (stats) stats->tt_hits++;
-                        }
-                    }
-                    
-                    if (!child) {
-                        child = create_node(leaf, legal_moves.moves[i], child_state, arena, config);
-                        if (tt) {
-                            tt_insert(tt, child);
-                            if (stats) stats->tt_misses++;
-                        }
-                    }
-                    
-                    child->prior = filtered_policy[i];
-                    leaf->children[i] = child;
-                }
-                
-                leaf->untried_moves.count = 0;
-                atomic_thread_fence(memory_order_release);
-                leaf->num_children = legal_moves.count;
-                
-                if (stats) {
-                    stats->total_expansions++;
-                    stats->total_policy_cached += legal_moves.count;
-                }
-            } else {
-                leaf->is_terminal = 1;
-            }
-        }
-        pthread_mutex_unlock(&leaf->lock);
-        return leaf;
-    } else {
-        pthread_mutex_lock(&leaf->lock);
-        Node *next = leaf;
-        if (!leaf->is_terminal) {
-            next = expand_node(leaf, arena, tt, config, stats);
-            if (stats) {
-                stats->total_expansions++;
-                stats->total_policy_cached++;
-            }
-        }
-        pthread_mutex_unlock(&leaf->lock);
-        return next;
-    }
+    PROFILE_BEGIN(t0);
+    Node *next = config.cnn_weights ? mcts_expand_with_policy(leaf, arena, tt, config, policy, stats)
+                                    : mcts_expand_vanilla(leaf, arena, tt, config, stats);
+    PROFILE_END(PROFILE_EXPAND, t0);
+    return next;
 }
 
 static inline void perform_backprop(Node *leaf, double value, MCTSConfig config, MCTSStats *stats) {
+    PROFILE_BEGIN(t0);
     backpropagate(leaf, value, config.use_solver);
+    PROFILE_END(PROFILE_BACKPROP, t0);
     if (stats) stats->total_iterations++;
 }
 
@@ -175,11 +303,13 @@ static inline void perform_backprop(Node *leaf, double value, MCTSConfig config,
 // =============================================================================
 
 // Perform a single MCTS iteration (Sequential)
-static void mcts_step_sequential(Node *root, Arena *arena, MCTSConfig config, MCTSStats *stats, TranspositionTable *tt) {
+static void mcts_step_sequential(Node *root, Arena *arena, MCTSConfig config, SelectKernel select,
+                                 MCTSStats *stats, TranspositionTable *tt) {
     // 1. Selection
-    Node *leaf = perform_selection(root, config);
+    Node *leaf = perform_selection(root, select, &config);
     
     if (leaf->is_terminal) {
+        mcts_note_depth(stats, root, leaf);
         solve_terminal_node(leaf, config, stats);
         return;
     }
@@ -190,87 +320,250 @@ static void mcts_step_sequential(Node *root, Arena *arena, MCTSConfig config, MC
     float *policy_ptr = NULL;
     
     if (config.cnn_weights) {
-        GameState *s0 = &leaf->state;
-        GameState *s1 = (leaf->parent) ? &leaf->parent->state : NULL;
-        GameState *s2 = (leaf->parent && leaf->parent->parent) ? &leaf->parent->parent->state : NULL;
-        cnn_forward_with_history(config.cnn_weights, s0, s1, s2, &out);
+        uint64_t key = 0;
+        if (!mcts_cache_probe(config, leaf, &key, &out, stats)) {
+            const GameState *s1, *s2;
+            mcts_leaf_history(leaf, &s1, &s2);
+            CNNPolicySubset legal;
+            cnn_policy_subset(&leaf->state, &legal);
+            PROFILE_BEGIN(t0);
+            cnn_forward_legal(config.cnn_weights, &leaf->state, s1, s2, &legal, &out);
+            PROFILE_END(PROFILE_INFERENCE, t0);
+            PROFILE_BATCH(1);
+            mcts_cache_store(config, leaf, key, &out, stats);
+        }
         
         // Scale value from [-1, 1] to [0, 1] for MCTS backprop
         value = (out.value + 1.0f) / 2.0f;
         policy_ptr = out.policy;
     } else {
+        PROFILE_BEGIN(t0);
         value = (float)simulate_rollout(leaf, config);
+        PROFILE_END(PROFILE_ROLLOUT, t0);
     }
 
     // 3. Expansion
     Node *next_leaf = perform_expansion(leaf, arena, tt, config, policy_ptr, stats);
+    mcts_note_depth(stats, root, next_leaf);
 
     // 4. Backpropagation
     perform_backprop(next_leaf, value, config, stats);
 }
 
-// =============================================================================
-// THREAD POOL HELPERS
-// =============================================================================
+// Undo the virtual loss of a selection that will not be evaluated
+static inline void revert_virtual_loss(Node *leaf) {
+    for (Node *n = leaf; n; n = n->parent) {
+        atomic_fetch_sub(&n->virtual_loss, 1);
+        child_stats_publish_virtual_loss(n);
+    }
+}
 
-// Initialize inference queue for batch CNN processing
-static void mcts_init_queue(InferenceQueue *queue) {
-    queue->count = 0;
-    queue->shutdown = 0;
-    pthread_mutex_init(&queue->lock, NULL);
-    pthread_cond_init(&queue->cond_batch_ready, NULL);
+/**
+ * Perform up to K iterations with one CNN call (Sequential, batched).
+ *
+ * Selects K leaves in a row; the virtual loss each descent leaves behind
+ * steers the next one elsewhere. All leaves are evaluated by a single
+ * cnn_forward_batch (or the shared InferenceServer, if configured), then
+ * expanded and backpropagated in order. Leaves found in config.cnn_cache
+ * skip the network.
+ * Collection stops early when a leaf comes up twice (tree too narrow).
+ */
+static void mcts_step_sequential_batched(Node *root, Arena *arena, MCTSConfig config, SelectKernel select,
+                                         MCTSStats *stats, TranspositionTable *tt, int batch) {
+    Node *leaves[MCTS_BATCH_SIZE];
+    int count = 0;
+    
+    for (int k = 0; k < batch; k++) {
+        Node *leaf = perform_selection(root, select, &config);
+        
+        if (leaf->is_terminal) {
+            mcts_note_depth(stats, root, leaf);
+            solve_terminal_node(leaf, config, stats);
+            continue;
+        }
+        
+        int duplicate = 0;
+        for (int i = 0; i < count; i++) {
+            if (leaves[i] == leaf) { duplicate = 1; break; }
+        }
+        if (duplicate) {
+            revert_virtual_loss(leaf);
+            break;
+        }
+        leaves[count++] = leaf;
+    }
+    if (count == 0) return;
+    
+    CNNOutput outputs[MCTS_BATCH_SIZE];
+    float values[MCTS_BATCH_SIZE];
+    uint64_t keys[MCTS_BATCH_SIZE];
+    Node *ordered[MCTS_BATCH_SIZE];
+    
+    // Cache hits fill the batch from the back, misses from the front
+    int misses = 0, hits = 0;
+    for (int i = 0; i < count; i++) {
+        int slot = count - 1 - hits;
+        if (mcts_cache_probe(config, leaves[i], &keys[slot], &outputs[slot], stats)) {
+            ordered[slot] = leaves[i];
+            values[slot] = (outputs[slot].value + 1.0f) / 2.0f;
+            hits++;
+        } else {
+            keys[misses] = keys[slot];
+            ordered[misses++] = leaves[i];
+        }
+    }
+    
+    int evaluated = misses;
+    if (misses > 0 && config.inference_server) {
+        // Shared server: leaves from every concurrent game go in one batch
+        InferenceServer *server = (InferenceServer*)config.inference_server;
+        InferenceRequest reqs[MCTS_BATCH_SIZE];
+        int submitted = 0;
+        PROFILE_BEGIN(t0);
+        for (int i = 0; i < misses; i++) {
+            reqs[i].node = ordered[i];
+            reqs[i].policy_out = outputs[i].policy;
+            reqs[i].value_out = &values[i];
+            atomic_init(&reqs[i].ready, 0);
+            if (!inference_server_submit(server, &reqs[i])) break;
+            submitted++;
+        }
+        evaluated = 0;
+        while (evaluated < submitted && inference_server_wait(server, &reqs[evaluated])) evaluated++;
+        PROFILE_END(PROFILE_QUEUE_WAIT, t0);
+        for (int i = evaluated; i < misses; i++) revert_virtual_loss(ordered[i]);
+        for (int i = 0; i < evaluated; i++) outputs[i].value = values[i] * 2.0f - 1.0f;
+    } else if (misses > 0) {
+        const GameState *states[MCTS_BATCH_SIZE];
+        const GameState *hist1s[MCTS_BATCH_SIZE];
+        const GameState *hist2s[MCTS_BATCH_SIZE];
+        CNNPolicySubset legal[MCTS_BATCH_SIZE];
+        
+        for (int i = 0; i < misses; i++) {
+            states[i] = &ordered[i]->state;
+            mcts_leaf_history(ordered[i], &hist1s[i], &hist2s[i]);
+            cnn_policy_subset(states[i], &legal[i]);
+        }
+        
+        PROFILE_BEGIN(t0);
+        cnn_forward_batch_legal(config.cnn_weights, states, hist1s, hist2s, legal, outputs, misses);
+        PROFILE_END(PROFILE_INFERENCE, t0);
+        PROFILE_BATCH(misses);
+        for (int i = 0; i < misses; i++) values[i] = (outputs[i].value + 1.0f) / 2.0f;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (i >= evaluated && i < misses) continue; // Dropped (server shut down)
+        if (i < misses) mcts_cache_store(config, ordered[i], keys[i], &outputs[i], stats);
+        Node *next_leaf = perform_expansion(ordered[i], arena, tt, config, outputs[i].policy, stats);
+        mcts_note_depth(stats, root, next_leaf);
+        perform_backprop(next_leaf, values[i], config, stats);
+    }
 }
 
-// Cleanup inference queue
-static void mcts_destroy_queue(InferenceQueue *queue) {
-    pthread_mutex_destroy(&queue->lock);
-    pthread_cond_destroy(&queue->cond_batch_ready);
+/**
+ * One round of a deterministic rollout search: up to `batch` leaves are
+ * selected in a row (virtual loss steers each descent, as in the batched
+ * CNN step), played out in parallel on config.num_threads OpenMP threads,
+ * then expanded and backpropagated in selection order. Each playout draws
+ * from its own generator, seeded from `stream` in selection order, so the
+ * tree depends on the seed and the batch, never on which thread ran what
+ * or how fast. The rollout phase of the profile is the round's wall time.
+ */
+static void mcts_step_lockstep(Node *root, Arena *arena, MCTSConfig config, SelectKernel select,
+                               MCTSStats *stats, TranspositionTable *tt, int batch, RNG *stream) {
+    Node *leaves[MCTS_BATCH_SIZE];
+    uint32_t seeds[MCTS_BATCH_SIZE];
+    double values[MCTS_BATCH_SIZE];
+    int count = 0;
+    
+    for (int k = 0; k < batch; k++) {
+        Node *leaf = perform_selection(root, select, &config);
+        
+        if (leaf->is_terminal) {
+            mcts_note_depth(stats, root, leaf);
+            solve_terminal_node(leaf, config, stats);
+            continue;
+        }
+        
+        int duplicate = 0;
+        for (int i = 0; i < count; i++) {
+            if (leaves[i] == leaf) { duplicate = 1; break; }
+        }
+        if (duplicate) {
+            revert_virtual_loss(leaf);
+            break;
+        }
+        seeds[count] = rng_u32(stream);
+        leaves[count++] = leaf;
+    }
+    if (count == 0) return;
+    
+    const int threads = config.num_threads > 1 ? config.num_threads : 1;
+    PROFILE_BEGIN(t0);
+    #pragma omp parallel for num_threads(threads) schedule(static) if (threads > 1 && count > 1)
+    for (int i = 0; i < count; i++) {
+        RNG rng;
+        rng_seed(&rng, seeds[i]);
+        RNG *prev = mcts_rollout_set_rng(&rng);
+        values[i] = simulate_rollout(leaves[i], config);
+        mcts_rollout_set_rng(prev);
+    }
+    PROFILE_END(PROFILE_ROLLOUT, t0);
+    
+    for (int i = 0; i < count; i++) {
+        Node *next_leaf = perform_expansion(leaves[i], arena, tt, config, NULL, stats);
+        mcts_note_depth(stats, root, next_leaf);
+        perform_backprop(next_leaf, values[i], config, stats);
+    }
 }
 
+// =============================================================================
+// THREAD POOL HELPERS
+// =============================================================================
+
 // Spawn worker threads for parallel MCTS iterations
 static MCTSStats* mcts_spawn_workers(
     pthread_t *workers, WorkerArgs *args, int num_threads,
-    Node *root, Arena *arena, MCTSConfig config, InferenceQueue *queue, TranspositionTable *tt
+    Node *root, Arena *arena, MCTSConfig config, SelectKernel select, InferenceServer *server,
+    SearchControl *control, TranspositionTable *tt
 ) {
     MCTSStats *worker_stats = calloc(num_threads, sizeof(MCTSStats));
     if (!worker_stats) return NULL;
     
+    // Workers share the node of the searching thread, and of its arena
+    pthread_attr_t attr;
+    const int near = affinity_helper_attr(&attr);
     for (int i = 0; i < num_threads; i++) {
         args[i].root = root;
         args[i].arena = arena;
         args[i].config = config;
-        args[i].queue = queue;
+        args[i].select = select;
+        args[i].server = server;
+        args[i].control = control;
         args[i].tt = tt;
         args[i].thread_id = i;
         args[i].local_stats = &worker_stats[i];
-        pthread_create(&workers[i], NULL, mcts_worker, &args[i]);
+        pthread_create(&workers[i], near ? &attr : NULL, mcts_worker, &args[i]);
     }
+    if (near) pthread_attr_destroy(&attr);
     return worker_stats;
 }
 
-// Signal shutdown and join all worker threads
+// Signal stop and join all worker threads (the evaluators keep serving
+// until every worker is out, so no request is left half-done)
 static void mcts_shutdown_workers(
     pthread_t *workers, int num_threads,
-    InferenceQueue *queue,
+    SearchControl *control,
     MCTSStats *worker_stats,
-    long *out_iterations, long *out_expansions, long *out_children
+    long *out_iterations
 ) {
-    queue->shutdown = 1;
-    pthread_cond_broadcast(&queue->cond_batch_ready);
-    
-    // Wake up any waiting workers
-    pthread_mutex_lock(&queue->lock);
-    for (int i = 0; i < queue->count; i++) {
-        pthread_cond_signal(&queue->requests[i]->cond);
-    }
-    pthread_mutex_unlock(&queue->lock);
+    search_control_stop(control);
     
     // Join and aggregate stats
     for (int i = 0; i < num_threads; i++) {
         pthread_join(workers[i], NULL);
         if (out_iterations) *out_iterations += worker_stats[i].total_iterations;
-        if (out_expansions) *out_expansions += worker_stats[i].total_expansions;
-        if (out_children)   *out_children   += worker_stats[i].total_policy_cached;
     }
 }
 
@@ -279,76 +572,32 @@ static void mcts_merge_worker_stats(MCTSStats *main_stats, MCTSStats *worker_sta
     if (!main_stats || !worker_stats) return;
     for (int i = 0; i < num_threads; i++) {
         main_stats->total_nodes += worker_stats[i].total_nodes;
-        main_stats->total_depth += worker_stats[i].total_depth;
+        if (worker_stats[i].max_depth > main_stats->max_depth) {
+            main_stats->max_depth = worker_stats[i].max_depth;
+        }
         main_stats->total_expansions += worker_stats[i].total_expansions;
         main_stats->total_policy_cached += worker_stats[i].total_policy_cached;
         main_stats->total_children_expanded += worker_stats[i].total_children_expanded;
         main_stats->nodes_with_children += worker_stats[i].nodes_with_children;
         main_stats->tt_hits += worker_stats[i].tt_hits;
         main_stats->tt_misses += worker_stats[i].tt_misses;
+        main_stats->nn_cache_hits += worker_stats[i].nn_cache_hits;
+        main_stats->nn_cache_misses += worker_stats[i].nn_cache_misses;
+        main_stats->nn_cache_evictions += worker_stats[i].nn_cache_evictions;
+        main_stats->expand_collisions += worker_stats[i].expand_collisions;
+        mcts_profile_merge(&main_stats->profile, &worker_stats[i].profile);
         if (worker_stats[i].peak_memory_bytes > main_stats->peak_memory_bytes) {
             main_stats->peak_memory_bytes = worker_stats[i].peak_memory_bytes;
         }
+        main_stats->arena_allocs += worker_stats[i].arena_allocs;
+        main_stats->arena_bytes += worker_stats[i].arena_bytes;
+        main_stats->arena_refills += worker_stats[i].arena_refills;
+        if (worker_stats[i].arena_high_water > main_stats->arena_high_water) {
+            main_stats->arena_high_water = worker_stats[i].arena_high_water;
+        }
     }
 }
 
-// Process a batch of CNN inference requests
-static void mcts_process_cnn_batch(InferenceQueue *queue, const CNNWeights *weights) {
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_nsec += 1000000; // 1ms timeout
-    if (ts.tv_nsec >= 1000000000) {
-        ts.tv_sec += 1;
-        ts.tv_nsec -= 1000000000;
-    }
-    
-    pthread_mutex_lock(&queue->lock);
-    
-    // Wait for requests or timeout
-    while (queue->count < 1 && !queue->shutdown) {
-        pthread_cond_timedwait(&queue->cond_batch_ready, &queue->lock, &ts);
-        if (queue->count > 0) break;
-        
-        struct timespec now;
-        clock_gettime(CLOCK_REALTIME, &now);
-        if (now.tv_sec > ts.tv_sec || (now.tv_sec == ts.tv_sec && now.tv_nsec >= ts.tv_nsec)) break;
-    }
-    
-    if (queue->shutdown || queue->count == 0) {
-        pthread_mutex_unlock(&queue->lock);
-        return;
-    }
-    
-    int current_batch = queue->count;
-    
-    // Batch arrays (stack allocated, limited by MCTS_BATCH_SIZE)
-    CNNOutput outputs[MCTS_BATCH_SIZE];
-    const GameState *states[MCTS_BATCH_SIZE];
-    const GameState *hist1s[MCTS_BATCH_SIZE];
-    const GameState *hist2s[MCTS_BATCH_SIZE];
-    
-    for (int i = 0; i < current_batch; i++) {
-        Node *n = queue->requests[i]->node;
-        states[i] = &n->state;
-        hist1s[i] = (n->parent) ? &n->parent->state : NULL;
-        hist2s[i] = (n->parent && n->parent->parent) ? &n->parent->parent->state : NULL;
-    }
-    
-    cnn_forward_batch(weights, states, hist1s, hist2s, outputs, current_batch);
-    
-    // Distribute results to waiting threads
-    for (int i = 0; i < current_batch; i++) {
-        InferenceRequest *req = queue->requests[i];
-        memcpy(req->policy_out, outputs[i].policy, CNN_POLICY_SIZE * sizeof(float));
-        *req->value_out = (outputs[i].value + 1.0f) / 2.0f;
-        req->ready = 1;
-        pthread_cond_signal(&req->cond);
-    }
-    
-    queue->count = 0;
-    pthread_mutex_unlock(&queue->lock);
-}
-
 // Select the most visited child node (Robust Child selection)
 static Node* mcts_select_best_child(Node *root) {
     Node *best = NULL;
@@ -364,53 +613,230 @@ static Node* mcts_select_best_child(Node *root) {
     return best;
 }
 
-// Helper to recursively count expansions and children (if stats missing)
-static void count_tree_expansions(Node *node, long *total_expansions, long *total_children) {
-    if (!node) return;
-    if (node->num_children > 0) {
-        (*total_expansions)++;
-        (*total_children) += node->num_children;
-        for (int i = 0; i < node->num_children; i++) {
-            count_tree_expansions(node->children[i], total_expansions, total_children);
-        }
-    }
-}
-
-// Update MCTSStats with results from this search
-// Update MCTSStats with results from this search
+// Update MCTSStats with results from this search. Tree counters were
+// kept up to date by the expansions themselves (merged from the workers)
 static void mcts_update_stats(
-    MCTSStats *stats, Node *root, 
-    long iterations, long expansions, long children,
-    double elapsed_time, size_t memory_used, int depth
+    MCTSStats *stats, long iterations,
+    double elapsed_time, size_t memory_used
 ) {
     if (!stats) return;
     
     stats->total_iterations += iterations;
-    stats->total_nodes += get_tree_node_count(root);
     stats->current_move_iterations = iterations;
     stats->total_moves++;
-    stats->total_depth += depth;
+    stats->total_depth += stats->max_depth;
     stats->total_time += elapsed_time;
     stats->total_memory += memory_used;
-    stats->total_expansions += expansions;
-    stats->total_policy_cached += children;
-    
-    // Tree statistics: compute from tree structure if not provided by workers
-    // OR if they look suspicious (expansions=0 but tree is large)
-    if ((children == 0 && expansions == 0 && root) || (expansions == 0 && get_tree_node_count(root) > 100)) {
-        long nodes_with_kids = 0;
-        long total_kids = 0;
-        count_tree_expansions(root, &nodes_with_kids, &total_kids);
-        
-        // DEBUG PRINT
-        // printf("DEBUG FALLBACK: NodesWithKids=%ld TotalKids=%ld TotalNodes=%d\n", nodes_with_kids, total_kids, get_tree_node_count(root));
+}
 
-        stats->total_children_expanded += total_kids;
-        stats->nodes_with_children += nodes_with_kids;
-    } else {
-        stats->total_children_expanded += children;
-        stats->nodes_with_children += expansions;
+// Best move (Robust Child: most visited) and, with tree reuse, its subtree
+static Move mcts_best_move(Node *root, MCTSConfig config, Node **out_new_root) {
+    Node *best_child = mcts_select_best_child(root);
+
+    if (best_child == NULL) {
+        Move empty = {0};
+        return empty;
+    }
+
+    if (config.use_tree_reuse && out_new_root) {
+        *out_new_root = best_child;
+    }
+
+    Move best = {0};
+    movegen_unpack_move(&root->state, best_child->move_from_parent, &best);
+    return best;
+}
+
+// =============================================================================
+// ROOT PARALLELISM
+// =============================================================================
+
+// One of the independent trees of a root-parallel search (all but the first)
+typedef struct {
+    pthread_t thread;
+    const Node *origin;         // The caller's root: state and history to copy
+    size_t arena_size;
+    Arena arena;
+    TranspositionTable *tt;
+    Node *root;
+    RNG rng;
+    MCTSConfig config;
+    double time_limit;
+    MCTSStats stats;
+    int started;
+} RootTree;
+
+// Copy of origin's history chain (states only), so that no backprop of
+// this tree touches a node another tree uses
+static Node* root_tree_history(const Node *origin, Arena *arena) {
+    Node *head = NULL, *tail = NULL;
+    for (const Node *h = origin->parent; h; h = h->parent) {
+        Node *copy = arena_alloc(arena, sizeof(Node));
+        if (!copy) return NULL;
+        memset(copy, 0, sizeof(Node));
+        copy->state = h->state;
+        copy->depth = h->depth;
+        copy->player_who_just_moved = h->player_who_just_moved;
+        if (tail) tail->parent = copy;
+        else head = copy;
+        tail = copy;
+    }
+    return head;
+}
+
+static void* root_tree_run(void *arg) {
+    RootTree *t = arg;
+    // Allocated here: the pages are first touched by the thread that searches them
+    if (arena_init_with(&t->arena, t->arena_size, &ARENA_BACKING_ROOT_TREE) != 0) return NULL;
+    if (t->config.use_tt && !(t->tt = tt_create(TT_SIZE_DEFAULT))) return NULL;
+
+    Node *history = root_tree_history(t->origin, &t->arena);
+    if (t->origin->parent && !history) return NULL;
+    t->root = mcts_create_root_with_history(t->origin->state, &t->arena, t->config, history);
+    if (!t->root) return NULL;
+    mcts_rollout_set_rng(&t->rng);
+    mcts_search(t->root, &t->arena, t->time_limit, t->config, &t->stats, t->tt, NULL);
+    mcts_rollout_set_rng(NULL);
+    return NULL;
+}
+
+/**
+ * Add the root children statistics of another tree to root's. Vanilla
+ * expansion adds root moves in a fixed order, so children the other tree
+ * has and root lacks are created first; a move still missing (out of
+ * arena) only loses its visits.
+ */
+static void root_merge_tree(Node *root, const Node *other, Arena *arena, TranspositionTable *tt,
+                            MCTSConfig config, MCTSStats *stats) {
+    while (!config.cnn_weights && root->num_children < other->num_children) {
+        int before = root->num_children;
+        mcts_expand_vanilla(root, arena, tt, config, stats);
+        if (root->num_children == before) break;
+    }
+
+    for (int i = 0; i < other->num_children; i++) {
+        const Node *c = other->children[i];
+        int visits = atomic_load(&c->visits);
+        if (visits <= 0) continue;
+        for (int k = 0; k < root->num_children; k++) {
+            Node *mine = root->children[k];
+            if (mine->move_from_parent != c->move_from_parent) continue;
+            atomic_fetch_add(&mine->visits, visits);
+            atomic_add_double(&mine->score, atomic_load(&c->score));
+            atomic_add_double(&mine->sum_sq_score, atomic_load(&c->sum_sq_score));
+            if (mine->status == SOLVED_NONE) mine->status = c->status;
+            child_stats_publish(mine);
+            break;
+        }
+    }
+    atomic_fetch_add(&root->visits, atomic_load(&other->visits));
+    atomic_add_double(&root->score, atomic_load(&other->score));
+    atomic_add_double(&root->sum_sq_score, atomic_load(&other->sum_sq_score));
+}
+
+/**
+ * Root parallelism: config.num_threads independent sequential searches of
+ * the same position, each with its own arena, TT and rollout generator,
+ * so no lock or cache line is shared while they run. The first tree is
+ * the caller's (searched on the calling thread, kept for tree reuse); the
+ * others live for this call only. A node budget is split between the
+ * trees. At the end the root children statistics of every tree are added
+ * to the caller's root, which picks the move and holds the merged counts
+ * (mcts_get_policy, the PV).
+ */
+static Move mcts_search_root_parallel(Node *root, Arena *arena, double time_limit_seconds, MCTSConfig config,
+                                      MCTSStats *stats, TranspositionTable *tt, Node **out_new_root) {
+    const int n_trees = config.num_threads;
+    MCTSConfig tree_config = config;
+    tree_config.num_threads = 0;
+    tree_config.root_parallel = 0;
+
+    // Node budget: what the caller's tree still lacks, split evenly
+    int share = 0;
+    if (config.max_nodes > 0) {
+        int missing = config.max_nodes - atomic_load(&root->visits);
+        if (missing <= 0) return mcts_search(root, arena, time_limit_seconds, tree_config, stats, tt, out_new_root);
+        share = (missing + n_trees - 1) / n_trees;
+    }
+    if (config.max_tree_nodes > 0) {
+        tree_config.max_tree_nodes = (config.max_tree_nodes + n_trees - 1) / n_trees;
+    }
+
+    RootTree *trees = calloc(n_trees - 1, sizeof(RootTree));
+    if (!trees) return mcts_search(root, arena, time_limit_seconds, tree_config, stats, tt, out_new_root);
+
+    // The other trees stop with the first (time, external stop, managed
+    // time), except in a pure node search, where each plays its share
+    atomic_int halt = 0;
+    RNG fixed_seeder;
+    rng_seed(&fixed_seeder, config.seed);
+    RNG *seeder = config.deterministic ? &fixed_seeder : rng_global();
+    pthread_attr_t attr;
+    const int near = affinity_helper_attr(&attr);
+    for (int i = 0; i < n_trees - 1; i++) {
+        RootTree *t = &trees[i];
+        t->origin = root;
+        t->arena_size = arena->size / n_trees;
+        t->config = tree_config;
+        t->config.max_nodes = share;
+        t->config.stop_flag = &halt;
+        t->config.verbose = 0;
+        t->time_limit = time_limit_seconds;
+        rng_seed(&t->rng, rng_u32(seeder) ^ ((uint32_t)(i + 1) * 2654435761u));
+        t->config.seed = t->rng.state;     // Deterministic: each tree its own stream
+        t->started = pthread_create(&t->thread, near ? &attr : NULL, root_tree_run, t) == 0;
+    }
+    if (near) pthread_attr_destroy(&attr);
+
+    MCTSConfig first = tree_config;
+    if (share > 0) first.max_nodes = atomic_load(&root->visits) + share;
+    mcts_search(root, arena, time_limit_seconds, first, stats, tt, NULL);
+
+    int node_search = config.max_nodes > 0 && time_limit_seconds <= 0;
+    int stopped = config.stop_flag && atomic_load((atomic_int*)config.stop_flag);
+    if (!node_search || stopped) atomic_store(&halt, 1);
+
+    for (int i = 0; i < n_trees - 1; i++) {
+        RootTree *t = &trees[i];
+        if (!t->started) continue;
+        pthread_join(t->thread, NULL);
+        if (t->root) {
+            root_merge_tree(root, t->root, arena, tt, tree_config, stats);
+            if (stats) {
+                mcts_merge_worker_stats(stats, &t->stats, 1);
+                stats->total_iterations += t->stats.current_move_iterations;
+                stats->current_move_iterations += t->stats.current_move_iterations;
+                stats->tree_prunes += t->stats.tree_prunes;
+                stats->nodes_recycled += t->stats.nodes_recycled;
+            }
+        }
+        if (t->arena.buffer) arena_free(&t->arena);
+        tt_free(t->tt);
     }
+    free(trees);
+
+    return mcts_best_move(root, config, out_new_root);
+}
+
+// =============================================================================
+// PERSISTENT SEARCH CACHE
+// =============================================================================
+
+/**
+ * A fresh root starts from its cached result, if any (a node budget the
+ * cache already covers ends the search at once); the root is stored back
+ * afterwards.
+ */
+static Move mcts_search_cached(Node *root, Arena *arena, double time_limit_seconds, MCTSConfig config,
+                               MCTSStats *stats, TranspositionTable *tt, Node **out_new_root) {
+    SearchCache *cache = config.search_cache;
+    const uint64_t fingerprint = search_cache_fingerprint(&config);
+    int seeded = search_cache_seed(cache, root, arena, tt, config, fingerprint, stats);
+
+    config.search_cache = NULL;
+    Move best = mcts_search(root, arena, time_limit_seconds, config, stats, tt, out_new_root);
+    if (atomic_load(&root->visits) > seeded) search_cache_store(cache, root, fingerprint);
+    return best;
 }
 
 // =============================================================================
@@ -421,107 +847,167 @@ Move mcts_search(Node *root, Arena *arena, double time_limit_seconds, MCTSConfig
                  MCTSStats *stats, TranspositionTable *tt, Node **out_new_root) {
     DBG_NOT_NULL(root);
     DBG_NOT_NULL(arena);
-    struct timespec start_ts, current_ts;
-    clock_gettime(CLOCK_MONOTONIC, &start_ts);
-    
-    // 0. Setup Queue
-    InferenceQueue queue;
-    mcts_init_queue(&queue);
+    if (config.deterministic) {
+        if (config.max_nodes > 0) {
+            // Fixed-node: the clock never ends a deterministic search
+            time_limit_seconds = 0.0;
+            config.soft_time = 0.0;
+        } else {
+            static int warned = 0;
+            if (!warned) log_warn("[MCTS] Deterministic search needs max_nodes, searching normally");
+            warned = 1;
+            config.deterministic = 0;
+        }
+    }
+    if (config.search_cache) {
+        return mcts_search_cached(root, arena, time_limit_seconds, config, stats, tt, out_new_root);
+    }
+    if (config.root_parallel && config.num_threads > 1) {
+        return mcts_search_root_parallel(root, arena, time_limit_seconds, config, stats, tt, out_new_root);
+    }
+    SearchClock clk;
+    search_clock_start(&clk, root);
+    path_set_invalidate(&path_tls);
+    const ArenaCounters arena_start = arena_thread_counters();
+    
+    // Deterministic: no worker threads or shared queue, the search forms
+    // its own rounds and batches (mcts_step_lockstep, local forward passes)
+    int n_workers = config.deterministic ? 0 : config.num_threads;
+    if (config.deterministic) config.inference_server = NULL;
+    RNG stream;
+    rng_seed(&stream, config.seed);
+    // Tree policy specialized for this config, resolved once for every thread
+    SelectKernel select = mcts_select_kernel(&config);
+    if (stats) stats->max_depth = 0;
+    PROFILE_BIND(stats ? &stats->profile : NULL);
+    
+    // 0. Evaluator: the shared server if configured, else a private one
+    InferenceServer local_server;
+    InferenceServer *server = NULL;
+    if (config.cnn_weights && n_workers > 0) {
+        server = (InferenceServer*)config.inference_server;
+        if (!server) {
+            if (inference_server_start(&local_server, config.cnn_weights, n_workers,
+                                       INFERENCE_GATHER_US, MCTS_EVALUATOR_THREADS) == ERR_OK) {
+                server = &local_server;
+            } else {
+                n_workers = 0; // Fall back to sequential search
+            }
+        }
+    }
     
     // 1. Spawn Workers (if num_threads > 0)
-    int n_workers = config.num_threads;
     pthread_t workers[n_workers > 0 ? n_workers : 1];
     WorkerArgs args[n_workers > 0 ? n_workers : 1];
     MCTSStats *worker_stats_arr = NULL;
-
-    if (n_workers > 0) {
+    SearchControl control;
+    search_control_init(&control);
+
+    // Bounded memory: prune a tree that is already over budget (reused root)
+    int search_ok = 1;
+    size_t high_water = tree_high_water(arena, config, TREE_BYTES_PER_NODE_GUESS, n_workers);
+    if (high_water && arena_bytes_in_use(arena) >= high_water) {
+        search_ok = search_enforce_budget(root, arena, tt, config, n_workers, &high_water, stats);
+    }
+    control.memory_high_water = high_water;
+    
+    if (n_workers > 0 && search_ok) {
         worker_stats_arr = mcts_spawn_workers(workers, args, n_workers,
-                                               root, arena, config, &queue, tt);
+                                               root, arena, config, select, server, &control, tt);
     }
     
-    // 2. Main Loop
+    // 2. Main Loop: sequential iterations, or a lightweight controller
     if (config.verbose) {
         printf("MCTS Start: Root=%p\n", root);
     }
     
-    while (1) {
-        // Check termination conditions
-        clock_gettime(CLOCK_MONOTONIC, &current_ts);
-        double elapsed = (current_ts.tv_sec - start_ts.tv_sec) + 
-                        (current_ts.tv_nsec - start_ts.tv_nsec) / 1e9;
-        int visits = atomic_load(&root->visits);
-        int time_exceeded = (time_limit_seconds > 0) && (elapsed >= time_limit_seconds);
-        int nodes_exceeded = (config.max_nodes > 0) && (visits >= config.max_nodes);
-        
-        if (time_exceeded || nodes_exceeded) break;
-
-        // Early Exit Check (every EARLY_EXIT_CHECK_INTERVAL nodes to save CPU)
-        if (visits > EARLY_EXIT_MIN_VISITS && visits % EARLY_EXIT_CHECK_INTERVAL == 0) {
-            if (should_exit_early(root, config.max_nodes)) {
+    long iter_this_move = 0;
+    TRACE_BEGIN(t_search);
+    
+    if (n_workers > 0) {
+        // Workers enforce node/early-exit/memory limits; the clock and the
+        // controller-only checks are left here
+        double poll = 0.0;
+        if (config.soft_time > 0) poll = TIME_CHECK_MS / 1000.0;
+        if (config.stop_flag) poll = SEARCH_STOP_POLL_MS / 1000.0;
+        while (worker_stats_arr) {
+            if (search_limits_reached(root, config, time_limit_seconds, &clk)) break;
+            search_control_wait(&control, time_limit_seconds, &clk.start, poll);
+            if (atomic_load(&control.stop)) break;
+            if (!atomic_load(&control.prune_requested)) continue;  // Deadline or poll: check again
+            
+            // Over budget: prune while every worker is parked, then resume
+            TRACE_BEGIN(t_prune);
+            search_control_wait_idle(&control, n_workers);
+            int resume = search_enforce_budget(root, arena, tt, config, n_workers, &high_water, stats);
+            TRACE_END("prune", t_prune);
+            control.memory_high_water = high_water;
+            if (!resume || search_limits_reached(root, config, time_limit_seconds, &clk)) {
                 break;
             }
+            search_control_resume(&control);
         }
-        
-        if (n_workers == 0) {
-            mcts_step_sequential(root, arena, config, stats, tt);
-            continue;
-        }
-
-        if (!config.cnn_weights) {
-            nanosleep(&(struct timespec){0, 1000000}, NULL); // 1ms sleep check
-            continue;
+    } else {
+        while (search_ok && !search_limits_reached(root, config, time_limit_seconds, &clk)) {
+            int visits = atomic_load(&root->visits);
+            int batch = (config.leaf_batch > MCTS_BATCH_SIZE) ? MCTS_BATCH_SIZE : config.leaf_batch;
+            if (config.max_nodes > 0 && batch > config.max_nodes - visits) batch = config.max_nodes - visits;
+            
+            if (config.deterministic && !config.cnn_weights) {
+                mcts_step_lockstep(root, arena, config, select, stats, tt, batch > 1 ? batch : 1, &stream);
+            } else if (config.cnn_weights && (batch > 1 || config.inference_server)) {
+                TRACE_BEGIN(t_batch);
+                mcts_step_sequential_batched(root, arena, config, select, stats, tt, batch);
+                TRACE_END("mcts batch", t_batch);
+            } else {
+                mcts_step_sequential(root, arena, config, select, stats, tt);
+            }
+            
+            if (high_water && arena_bytes_in_use(arena) >= high_water) {
+                TRACE_BEGIN(t_prune);
+                search_ok = search_enforce_budget(root, arena, tt, config, 0, &high_water, stats);
+                TRACE_END("prune", t_prune);
+            }
         }
-
-        // Process CNN batch requests
-        mcts_process_cnn_batch(&queue, config.cnn_weights);
-        if (queue.shutdown) break;
     }
+    TRACE_END("mcts_search", t_search);
     
     // 3. Cleanup & Join
-    long iter_this_move = 0;
-    long expansions_this_move = 0;
-    long children_this_move = 0;
-
     if (n_workers > 0) {
-        mcts_shutdown_workers(workers, n_workers, &queue, worker_stats_arr,
-                              &iter_this_move, &expansions_this_move, &children_this_move);
-        mcts_merge_worker_stats(stats, worker_stats_arr, n_workers);
-        free(worker_stats_arr);
+        if (worker_stats_arr) {
+            mcts_shutdown_workers(workers, n_workers, &control, worker_stats_arr,
+                                  &iter_this_move);
+            mcts_merge_worker_stats(stats, worker_stats_arr, n_workers);
+            free(worker_stats_arr);
+        }
+        if (server == &local_server) {
+            inference_server_stop(&local_server);
+            if (stats) inference_server_merge_profile(&local_server, &stats->profile);
+        }
     } else {
         iter_this_move = root->visits;
     }
     
-    mcts_destroy_queue(&queue);
 
-    clock_gettime(CLOCK_MONOTONIC, &current_ts);
-    double elapsed_time = (current_ts.tv_sec - start_ts.tv_sec) + 
-                          (current_ts.tv_nsec - start_ts.tv_nsec) / 1e9;
-    int depth = get_tree_depth(root);
+    search_control_destroy(&control);
+    PROFILE_BIND(NULL);     // stats may not outlive the call
+    double elapsed_time = elapsed_seconds(&clk.start);
     size_t memory_used = arena->offset;
     
-    mcts_update_stats(stats, root, iter_this_move, expansions_this_move, 
-                      children_this_move, elapsed_time, memory_used, depth);
+    mcts_update_stats(stats, iter_this_move, elapsed_time, memory_used);
     if (stats) {
         if (memory_used > stats->peak_memory_bytes) 
             stats->peak_memory_bytes = memory_used;
+        size_t high_water = atomic_load(&arena->high_water);
+        if (high_water > stats->arena_high_water) stats->arena_high_water = high_water;
+        mcts_note_arena(stats, &arena_start);
     }
 
     if (config.verbose) {
+        // Full walk on request only: the counters cover this search, not a reused tree
         printf("[MCTS Async] Tree depth: %d. Time: %.3fs. Memory: %.1f KB\n", 
-               depth, elapsed_time, memory_used / 1024.0);
-    }
-
-    // Select best move (Robust Child: most visited)
-    Node *best_child = mcts_select_best_child(root);
-
-    if (best_child == NULL) {
-        Move empty = {0};
-        return empty;
-    }
-
-    if (config.use_tree_reuse && out_new_root) {
-        *out_new_root = best_child;
+               get_tree_depth(root), elapsed_time, memory_used / 1024.0);
     }
 
-    return best_child->move_from_parent;
+    return mcts_best_move(root, config, out_new_root);
 }
@@ -2,7 +2,8 @@
  * mcts_selection.c - MCTS Node Selection Algorithms
  * 
  * Extracted from mcts_tree.c for better modularity.
- * Contains: UCB1, UCB1-Tuned, PUCT, select_promising_node
+ * Contains: UCB1, UCB1-Tuned, PUCT, vectorized child scoring over
+ * ChildStats, per-preset selection kernels, select_promising_node
  */
 
 #include "dama/search/mcts_tree.h"
@@ -10,6 +11,13 @@
 #include "dama/common/params.h"
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 // =============================================================================
 // UCB1 SELECTION
@@ -106,29 +114,268 @@ double calculate_ucb1_score(Node *child, MCTSConfig config) {
     return base_score;
 }
 
+// =============================================================================
+// VECTORIZED CHILD SCORING (ChildStats)
+// =============================================================================
+
+// Same formulas as above, in float, LANES children at a time. The
+// parent-side terms (log N, sqrt N) are computed once per node.
+#if defined(__AVX2__)
+#define LANES 8
+typedef __m256 vfloat;
+typedef __m256 vmask;
+#define v_set1(x)           _mm256_set1_ps(x)
+#define v_load(p)           _mm256_loadu_ps(p)
+#define v_load_i32(p)       _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(p)))
+#define v_load_i8(p)        _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(p))))
+#define v_store(p, v)       _mm256_storeu_ps(p, v)
+#define v_add(a, b)         _mm256_add_ps(a, b)
+#define v_sub(a, b)         _mm256_sub_ps(a, b)
+#define v_mul(a, b)         _mm256_mul_ps(a, b)
+#define v_div(a, b)         _mm256_div_ps(a, b)
+#define v_sqrt(a)           _mm256_sqrt_ps(a)
+#define v_min(a, b)         _mm256_min_ps(a, b)
+#define v_gt(a, b)          _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define v_lt(a, b)          _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define v_eq(a, b)          _mm256_cmp_ps(a, b, _CMP_EQ_OQ)
+#define v_select(m, a, b)   _mm256_blendv_ps(b, a, m)   // m ? a : b
+#define v_iota()            _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define LANES 4
+typedef float32x4_t vfloat;
+typedef uint32x4_t vmask;
+static inline float32x4_t neon_load_i8(const int8_t *p) {
+    int32_t word;
+    memcpy(&word, p, sizeof(word));
+    int16x8_t wide = vmovl_s8(vreinterpret_s8_s32(vdup_n_s32(word)));
+    return vcvtq_f32_s32(vmovl_s16(vget_low_s16(wide)));
+}
+static const float neon_iota[4] = {0, 1, 2, 3};
+#define v_set1(x)           vdupq_n_f32(x)
+#define v_load(p)           vld1q_f32(p)
+#define v_load_i32(p)       vcvtq_f32_s32(vld1q_s32(p))
+#define v_load_i8(p)        neon_load_i8(p)
+#define v_store(p, v)       vst1q_f32(p, v)
+#define v_add(a, b)         vaddq_f32(a, b)
+#define v_sub(a, b)         vsubq_f32(a, b)
+#define v_mul(a, b)         vmulq_f32(a, b)
+#define v_div(a, b)         vdivq_f32(a, b)
+#define v_sqrt(a)           vsqrtq_f32(a)
+#define v_min(a, b)         vminq_f32(a, b)
+#define v_gt(a, b)          vcgtq_f32(a, b)
+#define v_lt(a, b)          vcltq_f32(a, b)
+#define v_eq(a, b)          vceqq_f32(a, b)
+#define v_select(m, a, b)   vbslq_f32(m, a, b)
+#define v_iota()            vld1q_f32(neon_iota)
+#else
+#define LANES 1
+typedef float vfloat;
+typedef int vmask;
+#define v_set1(x)           ((float)(x))
+#define v_load(p)           (*(p))
+#define v_load_i32(p)       ((float)*(p))
+#define v_load_i8(p)        ((float)*(p))
+#define v_store(p, v)       (*(p) = (v))
+#define v_add(a, b)         ((a) + (b))
+#define v_sub(a, b)         ((a) - (b))
+#define v_mul(a, b)         ((a) * (b))
+#define v_div(a, b)         ((a) / (b))
+#define v_sqrt(a)           sqrtf(a)
+#define v_min(a, b)         ((a) < (b) ? (a) : (b))
+#define v_gt(a, b)          ((a) > (b))
+#define v_lt(a, b)          ((a) < (b))
+#define v_eq(a, b)          ((a) == (b))
+#define v_select(m, a, b)   ((m) ? (a) : (b))
+#define v_iota()            0.0f
+#endif
+
+#define NO_SCORE -1e9f      // Threshold a child must beat (as in the scalar loop)
+
+// GCC/Clang: keep the kernel bodies inlined so the flag arguments fold away
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+// Config terms of one descent (per-node terms are filled per level)
+typedef struct {
+    float unvisited;        // UCB1 / UCB1-Tuned value of an unvisited child
+    float puct_c;
+    float bias_c;
+    float log_n;            // log N(parent)
+    float sqrt_n;           // sqrt N(parent) (PUCT)
+} SelectParams;
+
+static inline void select_params_init(SelectParams *p, const MCTSConfig *config) {
+    p->unvisited = config->use_fpu ? (float)config->fpu_value : 1e9f;
+    p->puct_c = (float)config->puct_c;
+    p->bias_c = (float)config->bias_constant;
+    p->log_n = 0.0f;
+    p->sqrt_n = 0.0f;
+}
+
+// Scores of children i .. i + LANES - 1; the flags are constants in the
+// specialized kernels, so only the selected formula is compiled in
+KERNEL_INLINE void score_lanes(const ChildStats *s, int i, const SelectParams *p, float *out,
+                               const int puct, const int tuned, const int bias, const int solver) {
+    const vfloat zero = v_set1(0.0f), one = v_set1(1.0f);
+    vfloat n = v_load_i32(s->visits + i);
+    vfloat w = v_load(s->score + i);
+    vfloat base;
+    
+    if (puct) {
+        vfloat vl = v_load_i32(s->virtual_loss + i);
+        vfloat eff_w = v_sub(w, vl);
+        vfloat eff_n = v_add(n, vl);
+        vmask fresh = v_lt(eff_n, one);
+        vfloat q = v_select(fresh, eff_w, v_div(eff_w, eff_n));
+        vfloat denom = v_select(fresh, one, v_add(one, eff_n));
+        vfloat u = v_div(v_mul(v_mul(v_set1(p->puct_c), v_load(s->prior + i)), v_set1(p->sqrt_n)), denom);
+        base = v_add(q, u);
+    } else {
+        vfloat log_n = v_set1(p->log_n);
+        vfloat mean = v_div(w, n);
+        if (tuned) {
+            vfloat variance = v_sub(v_div(v_load(s->sum_sq + i), n), v_mul(mean, mean));
+            vfloat v_upper = v_add(variance, v_sqrt(v_div(v_mul(v_set1(2.0f), log_n), n)));
+            base = v_add(mean, v_sqrt(v_mul(v_div(log_n, n), v_min(v_upper, v_set1(0.25f)))));
+        } else {
+            base = v_add(mean, v_mul(v_set1((float)UCB1_C), v_sqrt(v_div(log_n, n))));
+        }
+        base = v_select(v_eq(n, zero), v_set1(p->unvisited), base);
+    }
+    
+    if (bias) {
+        base = v_add(base, v_div(v_mul(v_set1(p->bias_c), v_load(s->heuristic + i)), v_add(n, one)));
+    }
+    if (solver) {
+        vfloat status = v_load_i8(s->status + i);
+        base = v_select(v_eq(status, v_set1((float)SOLVED_WIN)), v_set1(-100000.0f), base);
+        base = v_select(v_eq(status, v_set1((float)SOLVED_LOSS)), v_add(v_set1(100000.0f), w), base);
+    }
+    v_store(out + i, base);
+}
+
+// First index of the largest score above NO_SCORE, -1 if none.
+// out[] must be padded with NO_SCORE up to a whole number of lanes.
+static int argmax_lanes(const float *scores, int n) {
+    vfloat best = v_set1(NO_SCORE), best_idx = v_set1(-1.0f);
+    vfloat idx = v_iota();
+    for (int i = 0; i < n; i += LANES) {
+        vfloat v = v_load(scores + i);
+        vmask better = v_gt(v, best);     // Strict: each lane keeps its first maximum
+        best = v_select(better, v, best);
+        best_idx = v_select(better, idx, best_idx);
+        idx = v_add(idx, v_set1((float)LANES));
+    }
+    
+    float lane_best[LANES], lane_idx[LANES];
+    v_store(lane_best, best);
+    v_store(lane_idx, best_idx);
+    int result = -1;
+    float top = NO_SCORE;
+    for (int l = 0; l < LANES; l++) {
+        if (lane_idx[l] < 0.0f) continue;
+        if (lane_best[l] > top || (lane_best[l] == top && (int)lane_idx[l] < result)) {
+            top = lane_best[l];
+            result = (int)lane_idx[l];
+        }
+    }
+    return result;
+}
+
+// Scalar score of one child, solver overrides included
+static double child_selection_score(Node *child, const MCTSConfig *config) {
+    if (config->use_solver) {
+        if (child->status == SOLVED_WIN) return -100000.0;
+        if (child->status == SOLVED_LOSS) return 100000.0 + child->score;
+    }
+    return calculate_ucb1_score(child, *config);
+}
+
+KERNEL_INLINE int select_child_lanes(const Node *parent, SelectParams *p, const MCTSConfig *config,
+                                     const int puct, const int tuned, const int bias, const int solver) {
+    const int n = parent->num_children;
+    double parent_visits = (double)atomic_load_explicit(&parent->visits, memory_order_relaxed);
+    if (puct) p->sqrt_n = (float)sqrt(parent_visits);
+    else p->log_n = (float)log(parent_visits);
+    
+    // Lanes past the last child read padding; their scores are overwritten
+    const ChildStats s = child_stats_of(parent);
+    float scores[MAX_MOVES + LANES];
+    for (int i = 0; i < n; i += LANES) score_lanes(&s, i, p, scores, puct, tuned, bias, solver);
+    for (int i = n; i < n + LANES; i++) scores[i] = NO_SCORE;
+    
+    // TT-shared children mirrored in another parent's block
+    uint64_t foreign = *s.foreign;
+    while (foreign) {
+        int i = __builtin_ctzll(foreign);
+        foreign &= foreign - 1;
+        if (i < n) scores[i] = (float)child_selection_score(parent->children[i], config);
+    }
+    return argmax_lanes(scores, n);
+}
+
+int select_child_index(const Node *parent, MCTSConfig config) {
+    if (parent->num_children == 0 || !parent->children) return -1;
+    SelectParams p;
+    select_params_init(&p, &config);
+    return select_child_lanes(parent, &p, &config, config.use_puct != 0,
+                              !config.use_puct && config.use_ucb1_tuned, config.use_progressive_bias != 0,
+                              config.use_solver != 0);
+}
+
 // =============================================================================
 // NODE SELECTION (Tree Policy)
 // =============================================================================
 
+// Reference loop over the Node fields, with per-child trace output
+static Node* select_child_verbose(Node *current, const MCTSConfig *config) {
+    double best_score = -1e9;
+    Node *best_node = NULL;
+    
+    for (int i = 0; i < current->num_children; i++) {
+        Node *child = current->children[i];
+        if (!child) continue;
+        
+        double ucb_value = child_selection_score(child, config);
+        printf("Sel Child %d: Visits=%d Prior=%.3f Heur=%.3f BiasConst=%.3f UCB=%.3f\n",
+               i, atomic_load(&child->visits), child->prior, child->heuristic_score, config->bias_constant, ucb_value);
+        
+        if (ucb_value > best_score) {
+            best_score = ucb_value;
+            best_node = child;
+        }
+    }
+    return best_node;
+}
+
 /**
- * Select the most promising leaf node for expansion.
+ * Root-to-leaf descent, instantiated once per kernel below.
  * 
  * Traverses from root to leaf using UCB/PUCT scores.
  * Applies virtual loss for thread-safe parallel MCTS.
  * Handles solved nodes (proven wins/losses) when solver is enabled.
+ * Loads the thread's path set so create_node() can check repetitions in O(1).
  */
-Node* select_promising_node(Node *root, MCTSConfig config) {
+KERNEL_INLINE Node* descend(Node *root, const MCTSConfig *config, const int puct, const int tuned,
+                            const int bias, const int solver, const int verbose) {
+    PathSet *path = &path_tls;
+    path_set_begin(path, root);
+    SelectParams params;
+    select_params_init(&params, config);
+    
     Node *current = root;
-    while (!current->is_terminal && current->untried_moves.count == 0) {
+    while (!current->is_terminal && node_is_fully_expanded(current)) {
         if (current->num_children == 0) break;
+        atomic_thread_fence(memory_order_acquire); // Pairs with the expander's release
 
         // Solver: take winning move immediately
         int found_winning_child = 0;
-        if (config.use_solver && current->status == SOLVED_WIN) {
+        if (solver && current->status == SOLVED_WIN) {
             for (int i = 0; i < current->num_children; i++) {
                 if (current->children[i]->status == SOLVED_LOSS) {
                     current = current->children[i];
                     atomic_fetch_add(&current->virtual_loss, 1);
+                    child_stats_publish_virtual_loss(current);
+                    path_set_push(path, current);
                     found_winning_child = 1;
                     break;
                 }
@@ -136,42 +383,67 @@ Node* select_promising_node(Node *root, MCTSConfig config) {
         }
         if (found_winning_child) continue;
         
-        double best_score = -1e9;
-        Node *best_node = NULL;
-        
-        for (int i = 0; i < current->num_children; i++) {
-            Node *child = current->children[i];
-            if (!child) continue;
-            
-            double ucb_value;
-            if (config.use_solver) {
-                if (child->status == SOLVED_WIN) {
-                    ucb_value = -100000.0;
-                } else if (child->status == SOLVED_LOSS) {
-                    ucb_value = 100000.0 + child->score;
-                } else {
-                    ucb_value = calculate_ucb1_score(child, config);
-                }
-            } else {
-                ucb_value = calculate_ucb1_score(child, config);
-            }
-            if (config.verbose) {
-                printf("Sel Child %d: Visits=%d Prior=%.3f Heur=%.3f BiasConst=%.3f UCB=%.3f\n", 
-                       i, atomic_load(&child->visits), child->prior, child->heuristic_score, config.bias_constant, ucb_value);
-            }
-            
-            if (ucb_value > best_score) {
-                best_score = ucb_value;
-                best_node = child;
-            }
+        Node *best_node;
+        if (verbose) {
+            best_node = select_child_verbose(current, config);
+        } else {
+            int best = select_child_lanes(current, &params, config, puct, tuned, bias, solver);
+            best_node = (best >= 0) ? current->children[best] : NULL;
         }
         
         if (best_node) {
             current = best_node;
             atomic_fetch_add(&current->virtual_loss, 1);
+            child_stats_publish_virtual_loss(current);
+            path_set_push(path, current);
         } else {
             break;
         }
     }
     return current;
 }
+
+// =============================================================================
+// SPECIALIZED KERNELS
+// =============================================================================
+
+// Flag combinations of the presets in daily use: Vanilla (UCB1, also with
+// FPU), UCB1-Tuned, Grandmaster and AlphaZero. Anything else, or verbose,
+// runs the generic descent, which tests the flags at every node.
+//
+//      name            puct  tuned  bias  solver
+#define SELECT_KERNELS(X) \
+    X(ucb1,             0,    0,     0,    0) \
+    X(ucb1_tuned,       0,    1,     0,    0) \
+    X(grandmaster,      1,    0,     1,    1) \
+    X(alpha_zero,       1,    0,     0,    1)
+
+#define DEFINE_SELECT_KERNEL(name, puct, tuned, bias, solver) \
+    static Node* select_##name(Node *root, const MCTSConfig *config) { \
+        return descend(root, config, puct, tuned, bias, solver, 0); \
+    }
+SELECT_KERNELS(DEFINE_SELECT_KERNEL)
+#undef DEFINE_SELECT_KERNEL
+
+static Node* select_generic(Node *root, const MCTSConfig *config) {
+    return descend(root, config, config->use_puct != 0, !config->use_puct && config->use_ucb1_tuned,
+                   config->use_progressive_bias != 0, config->use_solver != 0, config->verbose != 0);
+}
+
+SelectKernel mcts_select_kernel(const MCTSConfig *config) {
+    if (config->verbose) return select_generic;
+    const int puct = config->use_puct != 0;
+    const int tuned = !puct && config->use_ucb1_tuned;
+    const int bias = config->use_progressive_bias != 0;
+    const int solver = config->use_solver != 0;
+
+#define MATCH_SELECT_KERNEL(name, k_puct, k_tuned, k_bias, k_solver) \
+    if (puct == k_puct && tuned == k_tuned && bias == k_bias && solver == k_solver) return select_##name;
+    SELECT_KERNELS(MATCH_SELECT_KERNEL)
+#undef MATCH_SELECT_KERNEL
+    return select_generic;
+}
+
+Node* select_promising_node(Node *root, MCTSConfig config) {
+    return mcts_select_kernel(&config)(root, &config);
+}
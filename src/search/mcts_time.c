@@ -0,0 +1,37 @@
+/**
+ * mcts_time.c - Time Management for Games on a Clock
+ */
+
+#include "dama/search/mcts_time.h"
+#include "dama/common/params.h"
+
+void game_clock_init(GameClock *clock, double base, double increment) {
+    clock->remaining = base;
+    clock->increment = increment;
+    clock->moves = 0;
+}
+
+void game_clock_budget(const GameClock *clock, double *soft, double *hard) {
+    double usable = clock->remaining - TIME_SAFETY_MARGIN;
+    if (usable < 0) usable = 0;
+    
+    int moves_left = TIME_MOVES_HORIZON - clock->moves;     // moves: ours only
+    if (moves_left < TIME_MOVES_MIN) moves_left = TIME_MOVES_MIN;
+    
+    double s = usable / moves_left + TIME_INCREMENT_SHARE * clock->increment;
+    double h = TIME_HARD_FACTOR * s;
+    if (h > TIME_HARD_SHARE * usable + clock->increment) h = TIME_HARD_SHARE * usable + clock->increment;
+    if (h > usable) h = usable;
+    if (h < 1e-3) h = 1e-3;     // A zero limit would mean no limit
+    if (s > h) s = h;
+    *soft = s;
+    *hard = h;
+}
+
+int game_clock_spend(GameClock *clock, double seconds) {
+    clock->remaining -= seconds;
+    clock->moves++;
+    if (clock->remaining < 0) return -1;
+    clock->remaining += clock->increment;
+    return 0;
+}
@@ -8,6 +8,7 @@
 #include "dama/search/mcts_tree.h"
 #include "dama/search/mcts_types.h"
 #include "dama/engine/movegen.h"
+#include "dama/engine/tablebase.h"
 #include "dama/neural/cnn.h"
 #include "dama/common/params.h"
 #include "dama/common/debug.h"
@@ -15,55 +16,50 @@
 #include <string.h>
 #include <stdio.h>
 
+__thread PathSet path_tls = {0};
+
 // =============================================================================
 // HEURISTIC EVALUATION
 // =============================================================================
 
-double evaluate_move_heuristic(const GameState *state, const Move *move, MCTSConfig config) {
-    double score = 0.0;
-    int us = state->current_player;
-    
-    int target_idx = (move->length == 0) ? 1 : move->length;
-    int from = move->path[0];
-    int to = move->path[target_idx];
-    int row = to / 8;
-    int col = to % 8;
-    int from_row = from / 8;
-
-    // Capture bonus
-    if (move->length > 0) score += config.weights.w_capture * move->length;
-
-    // Promotion bonus
-    if (!move->is_lady_move) {
-        if (row == 0 || row == 7) score += config.weights.w_promotion;
+void move_heuristic_init(MoveHeuristic *h, const GameState *state, const MCTSConfig *config) {
+    const int us = state->current_player;
+    h->capture = config->weights.w_capture;
+    h->promotion = config->weights.w_promotion;
+    h->edge = config->weights.w_edge;
+    h->center = config->weights.w_center;
+    h->base = config->weights.w_base;
+    h->lady_activity = config->weights.w_lady_activity;
+    for (int row = 0; row < 8; row++) {
         int dist = (us == WHITE) ? (7 - row) : row;
-        score += (7 - dist) * config.weights.w_advance;
+        h->advance[row] = (7 - dist) * config->weights.w_advance;
     }
+    h->base_rows = (us == WHITE) ? 0x00000000000000FFULL : 0xFF00000000000000ULL;
+}
 
-    // Edge safety (pieces only)
-    if (!move->is_lady_move && (col == 0 || col == 7)) score += config.weights.w_edge;
-
-    // Center control
-    if ((row == 3 || row == 4) && (col >= 2 && col <= 5)) score += config.weights.w_center;
+double evaluate_move_heuristic(const GameState *state, const Move *move, MCTSConfig config) {
+    MoveHeuristic h;
+    move_heuristic_init(&h, state, &config);
+    int target_idx = (move->length == 0) ? 1 : move->length;
+    return move_heuristic_score(&h, move->path[0], move->path[target_idx], move->length, move->is_lady_move);
+}
 
-    // Base protection penalty
-    if (!move->is_lady_move) {
-        if ((us == WHITE && from_row == 0) || (us == BLACK && from_row == 7)) {
-            score -= config.weights.w_base;
-        }
-    }
-    
-    // Queen activity
-    if (move->is_lady_move) score += config.weights.w_lady_activity;
-    
-    return score;
+double evaluate_packed_move_heuristic(const GameState *state, PackedMove move, MCTSConfig config) {
+    MoveHeuristic h;
+    move_heuristic_init(&h, state, &config);
+    return move_heuristic_packed(&h, move);
 }
 
 // =============================================================================
 // NODE CREATION
 // =============================================================================
 
-Node* create_node(Node *parent, Move move, GameState state, Arena *arena, MCTSConfig config) {
+Node* create_node(Node *parent, PackedMove move, GameState state, Arena *arena, MCTSConfig config) {
+    return create_node_scored(parent, move, state, arena, config, NULL);
+}
+
+Node* create_node_scored(Node *parent, PackedMove move, GameState state, Arena *arena, MCTSConfig config,
+                         const MoveHeuristic *heuristic) {
     DBG_NOT_NULL(arena);
     Node *node = (Node*)arena_alloc(arena, sizeof(Node));
     if (!node) return NULL;
@@ -72,24 +68,22 @@ Node* create_node(Node *parent, Move move, GameState state, Arena *arena, MCTSCo
     node->state = state;
     node->move_from_parent = move;
     node->parent = parent;
+    node->depth = parent ? (uint16_t)(parent->depth + 1) : 0;
     node->player_who_just_moved = (state.current_player == WHITE) ? BLACK : WHITE;
 
-    node->children = (Node**)arena_alloc(arena, MAX_MOVES * sizeof(Node*));
+    node->children = NULL; // Allocated at exact size on first expansion
     node->num_children = 0;
     atomic_init(&node->visits, 0);
     atomic_init(&node->virtual_loss, 0);
+    atomic_init(&node->score, 0.0);
+    atomic_init(&node->sum_sq_score, 0.0);
+    atomic_init(&node->expand_state, NODE_UNEXPANDED);
     
-    if (pthread_mutex_init(&node->lock, NULL) != 0) {
-        printf("ERROR: Mutex init failed\n");
-    }
-
-    node->score = 0.0;
-    node->sum_sq_score = 0.0;
-    
-    node->heuristic_score = evaluate_move_heuristic(&node->state, &node->move_from_parent, config);
-    
-    movegen_generate(&node->state, &node->untried_moves);
-    node->is_terminal = (node->untried_moves.count == 0 && node->num_children == 0) ? 1 : 0;
+    PROFILE_BEGIN(t_movegen);
+    int legal = movegen_count(&node->state);
+    PROFILE_END(PROFILE_MOVEGEN, t_movegen);
+    node->num_legal = (legal > MAX_MOVES) ? MAX_MOVES : (uint8_t)legal;
+    node->is_terminal = (node->num_legal == 0) ? 1 : 0;
     
     // Solver init
     node->status = SOLVED_NONE;
@@ -100,33 +94,54 @@ Node* create_node(Node *parent, Move move, GameState state, Arena *arena, MCTSCo
         if (state.moves_without_captures >= MAX_MOVES_WITHOUT_CAPTURES) {
             node->status = SOLVED_DRAW;
         }
+    } else if (config.tablebase) {
+        // Known endgame: proven without searching it
+        switch (tablebase_probe(config.tablebase, &node->state)) {
+            case TB_WIN:  node->status = SOLVED_WIN;  break;
+            case TB_LOSS: node->status = SOLVED_LOSS; break;
+            case TB_DRAW: node->status = SOLVED_DRAW; break;
+            default: break;
+        }
     }
     
     // Heuristic & PUCT init
     if (parent) {
-        node->heuristic_score = evaluate_move_heuristic(&parent->state, &move, config);
+        PROFILE_BEGIN(t_heuristic);
+        MoveHeuristic own;
+        if (!heuristic) {
+            move_heuristic_init(&own, &parent->state, &config);
+            heuristic = &own;
+        }
+        node->heuristic_score = move_heuristic_packed(heuristic, move);
         
         if (config.weights.w_threat > 0.0) {
-            int dest = (move.length == 0) ? move.path[1] : move.path[move.length];
-            if (movegen_is_square_threatened(&node->state, dest)) {
+            if (movegen_is_square_threatened(&node->state, pmove_to(move))) {
                 node->heuristic_score -= config.weights.w_threat;
             }
         }
+        PROFILE_END(PROFILE_HEURISTIC, t_heuristic);
         
         node->prior = 0.0f; // Assigned by caller (perform_expansion)
 
 
-        // Loop detection
-        Node *ancestor = parent;
-        while (ancestor) {
-            if (ancestor->state.hash == node->state.hash) {
-                node->is_terminal = 1;
-                node->status = SOLVED_DRAW;
-                node->heuristic_score -= 50000.0;
-                node->score = -1.0;
-                break;
+        // Loop detection: O(1) against the selection path when parent is its
+        // top, otherwise walk the ancestors
+        int repeated = 0;
+        if (path_tls.top == parent) {
+            repeated = path_set_contains(&path_tls, node->state.hash);
+        } else {
+            for (const Node *ancestor = parent; ancestor; ancestor = ancestor->parent) {
+                if (ancestor->state.hash == node->state.hash) {
+                    repeated = 1;
+                    break;
+                }
             }
-            ancestor = ancestor->parent;
+        }
+        if (repeated) {
+            node->is_terminal = 1;
+            node->status = SOLVED_DRAW;
+            node->heuristic_score -= 50000.0;
+            node->score = -1.0;
         }
     } else {
         node->heuristic_score = 0.0;
@@ -151,8 +166,9 @@ int moves_equal(const Move *m1, const Move *m2) {
 
 Node* find_child_by_move(Node *parent, const Move *move) {
     if (!parent || !move) return NULL;
+    const PackedMove packed = move_pack(move);
     for (int i = 0; i < parent->num_children; i++) {
-        if (moves_equal(&parent->children[i]->move_from_parent, move)) {
+        if (parent->children[i]->move_from_parent == packed) {
             return parent->children[i];
         }
     }
@@ -166,16 +182,27 @@ Node* find_child_by_move(Node *parent, const Move *move) {
 Node* expand_node(Node *node, Arena *arena, TranspositionTable *tt, MCTSConfig config, MCTSStats *stats) {
     DBG_NOT_NULL(node);
     DBG_NOT_NULL(arena);
-    if (node->untried_moves.count == 0) return node;
-
-    int idx = node->untried_moves.count - 1;
-    Move move_to_try = node->untried_moves.moves[idx];
-    node->untried_moves.count--;
+    if (node_is_fully_expanded(node)) return node;
+
+    if (!node->children && !node_alloc_children(node, arena, node->num_legal)) return node;
+
+    // Untried moves are not stored: regenerate and take them from the back
+    PackedMoveList legal_moves;
+    PROFILE_BEGIN(t0);
+    movegen_generate_packed(&node->state, &legal_moves);
+    PROFILE_END(PROFILE_MOVEGEN, t0);
+    int idx = legal_moves.count - 1 - node->num_children;
+    if (idx < 0) {
+        node->num_legal = node->num_children; // Count/generate disagreed (MAX_MOVES overflow)
+        return node;
+    }
+    PackedMove move_to_try = legal_moves.moves[idx];
 
     GameState next_state = node->state;
-    apply_move(&next_state, &move_to_try);
+    apply_packed_move(&next_state, move_to_try);
 
     Node *child = create_node(node, move_to_try, next_state, arena, config);
+    if (!child) return node;
 
     if (tt) {
         Node *match = tt_lookup(tt, &next_state);
@@ -191,18 +218,27 @@ Node* expand_node(Node *node, Arena *arena, TranspositionTable *tt, MCTSConfig c
         tt_insert(tt, child);
     }
 
-    if (node->num_children >= MAX_MOVES) {
-        printf("ERROR: Exceeded MAX_MOVES in expand_node\n");
-        return node;
+    if (stats) {
+        if (node->num_children == 0) stats->nodes_with_children++;
+        stats->total_children_expanded++;
+        stats->total_nodes++;
     }
-
-    node->children[node->num_children] = child;
+    
+    child_stats_attach(node, node->num_children, child);
     atomic_thread_fence(memory_order_release);
     node->num_children++;
 
     return child;
 }
 
+void child_stats_rebuild(Node *parent) {
+    if (!parent->children) return;
+    *child_stats_of(parent).foreign = 0;
+    for (int i = 0; i < parent->num_children; i++) {
+        child_stats_attach(parent, i, parent->children[i]);
+    }
+}
+
 // =============================================================================
 // BACKPROPAGATION
 // =============================================================================
@@ -227,7 +263,7 @@ void update_solver_status(Node *node) {
     }
 
     // Are we forced to lose? (fully expanded, all children are wins for opponent)
-    if (node->untried_moves.count == 0) {
+    if (node_is_fully_expanded(node)) {
         int all_win = 1;
         for (int i = 0; i < node->num_children; i++) {
             if (node->children[i]->status != SOLVED_WIN) {
@@ -249,14 +285,15 @@ void backpropagate(Node *node, double result, int use_solver) {
         atomic_fetch_sub(&node->virtual_loss, 1);
         atomic_fetch_add(&node->visits, 1);
         
-        pthread_mutex_lock(&node->lock);
-        node->score += result;
-        node->sum_sq_score += (result * result);
+        atomic_add_double(&node->score, result);
+        atomic_add_double(&node->sum_sq_score, result * result);
         
+        // Status only moves from NONE to a proven value, so a racing
+        // recomputation can at worst repeat the same conclusion
         if (use_solver && (child == NULL || child->status != SOLVED_NONE)) {
             update_solver_status(node);
         }
-        pthread_mutex_unlock(&node->lock);
+        child_stats_publish(node);
 
         result = 1.0 - result;
         child = node;
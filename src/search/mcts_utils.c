@@ -25,8 +25,23 @@ Node* mcts_create_root(GameState state, Arena *arena, MCTSConfig config) {
 }
 
 Node* mcts_create_root_with_history(GameState state, Arena *arena, MCTSConfig config, Node *history_parent) {
-    Move no_move = {0};
-    return create_node(history_parent, no_move, state, arena, config);
+    path_set_invalidate(&path_tls); // Arena may have been reset: cached path is stale
+    return create_node(history_parent, PM_NONE, state, arena, config);
+}
+
+// History nodes carry only a state, like the ones tree reuse keeps
+int mcts_history_chain(const GameState *history, int plies, Arena *arena, Node **head) {
+    *head = NULL;
+    for (int k = plies - 1; k >= 0; k--) {
+        Node *h = arena_alloc(arena, sizeof(Node));
+        if (!h) return -1;
+        memset(h, 0, sizeof(Node));
+        h->state = history[k];
+        h->parent = *head;
+        h->player_who_just_moved = (h->state.current_player == WHITE) ? BLACK : WHITE;
+        *head = h;
+    }
+    return 0;
 }
 
 // =============================================================================
@@ -84,7 +99,7 @@ void mcts_get_policy(Node *root, float *policy, float temperature, const GameSta
         }
         
         if (best_child) {
-            int idx = cnn_move_to_index(&best_child->move_from_parent, state->current_player);
+            int idx = cnn_packed_move_to_index(best_child->move_from_parent, state->current_player);
             if (idx >= 0 && idx < CNN_POLICY_SIZE) {
                 policy[idx] = 1.0f;
             }
@@ -105,7 +120,7 @@ void mcts_get_policy(Node *root, float *policy, float temperature, const GameSta
     // Second pass: normalize
     for (int i = 0; i < root->num_children; i++) {
         Node *child = root->children[i];
-        int idx = cnn_move_to_index(&child->move_from_parent, state->current_player);
+        int idx = cnn_packed_move_to_index(child->move_from_parent, state->current_player);
         if (idx >= 0 && idx < CNN_POLICY_SIZE) {
             double p = pow(child->visits, exponent);
             policy[idx] = (float)(p / sum_pow);
@@ -172,7 +187,9 @@ void print_mcts_stats_sorted(const Node *root) {
     for (int i = 0; i < root->num_children; i++) {
         Node *child = sorted_children[i];
         printf("Move: ");
-        print_move_description(child->move_from_parent);
+        Move m = {0};
+        movegen_unpack_move(&root->state, child->move_from_parent, &m);
+        print_move_description(m);
         
         double win_rate = (child->visits > 0) ? (child->score / child->visits) : 0.0;
         int depth = get_tree_depth(child);
@@ -191,3 +208,48 @@ void print_mcts_stats_sorted(const Node *root) {
     (void)root;
 }
 #endif
+
+// =============================================================================
+// PHASE PROFILING
+// =============================================================================
+
+__thread MCTSProfile *profile_tls = NULL;
+
+const char* mcts_profile_phase_name(int phase) {
+    static const char *names[PROFILE_PHASES] = {
+        "select", "expand", "movegen", "heuristic",
+        "rollout", "inference", "queue wait", "backprop"
+    };
+    return (phase >= 0 && phase < PROFILE_PHASES) ? names[phase] : "?";
+}
+
+void mcts_profile_merge(MCTSProfile *dst, const MCTSProfile *src) {
+    if (!dst || !src) return;
+    for (int i = 0; i < PROFILE_PHASES; i++) {
+        dst->ticks[i] += src->ticks[i];
+        dst->calls[i] += src->calls[i];
+        for (int e = 0; e < PERF_EVENTS; e++) dst->events[i][e] += src->events[i][e];
+    }
+    for (int i = 0; i < PROFILE_BATCH_BINS; i++) dst->batches[i] += src->batches[i];
+}
+
+double mcts_profile_ns_per_tick(void) {
+#if defined(MCTS_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+    // TSC rate against the raw clock over ~10 ms, once per process
+    static double ns_per_tick = 0.0;
+    if (ns_per_tick == 0.0) {
+        struct timespec a, b;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &a);
+        uint64_t t0 = profile_ticks();
+        double ns;
+        do {
+            clock_gettime(CLOCK_MONOTONIC_RAW, &b);
+            ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+        } while (ns < 1e7);
+        ns_per_tick = ns / (double)(profile_ticks() - t0);
+    }
+    return ns_per_tick;
+#else
+    return 1.0;     // profile_ticks() is already in nanoseconds
+#endif
+}
@@ -2,7 +2,8 @@
  * mcts_worker.c - MCTS Multi-threaded Worker Infrastructure
  * 
  * Extracted from mcts_search.c for better modularity.
- * Contains: InferenceQueue, WorkerArgs, mcts_worker()
+ * Contains: mcts_worker() (InferenceQueue ring is in mcts_worker.h,
+ * the evaluator threads in mcts_inference.c)
  * 
  * Uses shared helpers from mcts_internal.h to avoid code duplication.
  */
@@ -14,6 +15,8 @@
 #include "dama/common/params.h"
 #include "dama/engine/movegen.h"
 #include "dama/search/mcts_worker.h"
+#include "dama/search/mcts_inference.h"
+#include "dama/common/trace.h"
 #include <string.h>
 #include <sched.h>
 
@@ -23,10 +26,38 @@
 
 // Wrapper that dispatches to the appropriate shared helper based on config
 static Node* perform_expansion_worker(Node *leaf, Arena *arena, TranspositionTable *tt, MCTSConfig config, float *policy, MCTSStats *stats) {
+    PROFILE_BEGIN(t0);
+    TRACE_BEGIN(t_trace);
+    Node *next;
     if (config.cnn_weights) {
-        return mcts_expand_with_policy(leaf, arena, tt, config, policy, stats);
+        next = mcts_expand_with_policy(leaf, arena, tt, config, policy, stats);
     } else {
-        return mcts_expand_vanilla(leaf, arena, tt, config, stats);
+        next = mcts_expand_vanilla(leaf, arena, tt, config, stats);
+    }
+    PROFILE_END(PROFILE_EXPAND, t0);
+    TRACE_END("expand", t_trace);
+    return next;
+}
+
+// Node, early-exit and memory limits, checked right after each backprop
+static void worker_check_limits(Node *root, const Arena *arena, int max_nodes, SearchControl *control) {
+    if (control->memory_high_water && arena_bytes_in_use(arena) >= control->memory_high_water) {
+        search_control_request_prune(control);
+        return;
+    }
+    
+    int visits = atomic_load_explicit(&root->visits, memory_order_relaxed);
+    if (max_nodes > 0 && visits >= max_nodes) {
+        search_control_stop(control);
+        return;
+    }
+    
+    // One worker per interval wins the CAS and runs the check
+    int next = atomic_load_explicit(&control->next_early_check, memory_order_relaxed);
+    if (max_nodes > 0 && visits > EARLY_EXIT_MIN_VISITS && visits >= next &&
+        atomic_compare_exchange_strong(&control->next_early_check, &next, visits + EARLY_EXIT_CHECK_INTERVAL) &&
+        should_exit_early(root, max_nodes)) {
+        search_control_stop(control);
     }
 }
 
@@ -38,21 +69,40 @@ static Node* perform_expansion_worker(Node *leaf, Arena *arena, TranspositionTab
  * MCTS Worker Thread.
  * 
  * Performs Selection, Expansion, and Backpropagation.
- * For Evaluation, it coordinates with other threads to form efficient batches
- * for the CNN Inference, using a condition variable/queue mechanism.
+ * For Evaluation, it pushes a request on the server's lock-free ring and
+ * waits on the request's completion flag while the evaluators batch.
+ * Stops on args->control; raises it itself on node or early-exit limits,
+ * and parks while the controller prunes a tree over its memory budget.
  */
 void *mcts_worker(void *arg) {
     WorkerArgs *args = (WorkerArgs*)arg;
     Node *root = args->root;
-    InferenceQueue *queue = args->queue;
+    InferenceServer *server = args->server;
     MCTSConfig config = args->config;
+    PROFILE_BIND(args->local_stats ? &args->local_stats->profile : NULL);
+    TRACE_THREAD("search worker");
+    
+    SearchControl *control = args->control;
+    const ArenaCounters arena_start = arena_thread_counters();
     
-    while (!queue->shutdown) {
+    while (!atomic_load_explicit(&control->stop, memory_order_relaxed)) {
+        if (atomic_load_explicit(&control->prune_requested, memory_order_relaxed)) {
+            TRACE_BEGIN(tr_park);
+            search_control_park(control);
+            TRACE_END("parked (prune)", tr_park);
+            continue;
+        }
+        
         // 1. Selection (with Virtual Loss)
-        Node *leaf = select_promising_node(root, config);
+        PROFILE_BEGIN(t_select);
+        TRACE_BEGIN(tr_select);
+        Node *leaf = args->select(root, &config);
+        PROFILE_END(PROFILE_SELECT, t_select);
+        TRACE_END("select", tr_select);
         
         // Check for terminal state - use shared helper from mcts_internal.h
         if (leaf->is_terminal) {
+            mcts_note_depth(args->local_stats, root, leaf);
             mcts_handle_terminal(leaf, config, args->local_stats);
              continue;
         }
@@ -61,61 +111,66 @@ void *mcts_worker(void *arg) {
         float value;
         float policy[CNN_POLICY_SIZE];
         
-        if (config.cnn_weights) {
-            // --- ASYNC BATCHING ---
-            InferenceRequest req;
-            req.node = leaf;
-            req.policy_out = policy;
-            req.value_out = &value;
-            req.ready = 0;
-            pthread_cond_init(&req.cond, NULL);
-            
-            pthread_mutex_lock(&queue->lock);
-            
-            while (queue->count >= MCTS_BATCH_SIZE && !queue->shutdown) {
-                pthread_cond_signal(&queue->cond_batch_ready);
-                pthread_mutex_unlock(&queue->lock);
-                sched_yield(); 
-                pthread_mutex_lock(&queue->lock);
+        if (server) {
+            CNNOutput out;
+            uint64_t key = 0;
+            if (mcts_cache_probe(config, leaf, &key, &out, args->local_stats)) {
+                memcpy(policy, out.policy, sizeof(policy));
+                value = (out.value + 1.0f) / 2.0f;
+            } else {
+                // --- ASYNC BATCHING (lock-free ring) ---
+                InferenceRequest req;
+                req.node = leaf;
+                req.policy_out = policy;
+                req.value_out = &value;
+                atomic_init(&req.ready, 0);
+                
+                PROFILE_BEGIN(t_wait);
+                TRACE_BEGIN(tr_wait);
+                int ok = inference_server_submit(server, &req) && inference_server_wait(server, &req);
+                PROFILE_END(PROFILE_QUEUE_WAIT, t_wait);
+                TRACE_END("queue wait", tr_wait);
+                if (!ok) {
+                    // Server gone: drop this leaf cleanly
+                    for (Node *n = leaf; n; n = n->parent) {
+                        atomic_fetch_sub(&n->virtual_loss, 1);
+                        child_stats_publish_virtual_loss(n);
+                    }
+                    break;
+                }
+                
+                if (config.cnn_cache) {
+                    memcpy(out.policy, policy, sizeof(policy));
+                    out.value = value * 2.0f - 1.0f;
+                    mcts_cache_store(config, leaf, key, &out, args->local_stats);
+                }
             }
-            
-            if (queue->shutdown) {
-                pthread_mutex_unlock(&queue->lock);
-                pthread_cond_destroy(&req.cond);
-                break; 
-            }
-
-            // Enqueue
-            queue->states[queue->count] = leaf->state;
-            queue->requests[queue->count] = &req;
-            queue->count++;
-            
-            if (queue->count >= MCTS_BATCH_SIZE) {
-                pthread_cond_signal(&queue->cond_batch_ready);
-            }
-            
-            // Wait for result
-            while (!req.ready && !queue->shutdown) {
-                 pthread_cond_wait(&req.cond, &queue->lock);
-            }
-            
-            pthread_mutex_unlock(&queue->lock);
-            pthread_cond_destroy(&req.cond);
-            
-            if (queue->shutdown) break;
-            
         } else {
             // Vanilla Rollout
+            PROFILE_BEGIN(t_rollout);
+            TRACE_BEGIN(tr_rollout);
             value = simulate_rollout(leaf, config);
+            PROFILE_END(PROFILE_ROLLOUT, t_rollout);
+            TRACE_END("rollout", tr_rollout);
         }
 
         // 3. Expansion
-        Node *next_leaf = perform_expansion_worker(leaf, args->arena, args->tt, config, (config.cnn_weights ? policy : NULL), args->local_stats);
+        Node *next_leaf = perform_expansion_worker(leaf, args->arena, args->tt, config, (server ? policy : NULL), args->local_stats);
+        mcts_note_depth(args->local_stats, root, next_leaf);
         
         // 4. Backpropagation
+        PROFILE_BEGIN(t_backprop);
+        TRACE_BEGIN(tr_backprop);
         backpropagate(next_leaf, value, config.use_solver);
+        PROFILE_END(PROFILE_BACKPROP, t_backprop);
+        TRACE_END("backprop", tr_backprop);
         if (args->local_stats) args->local_stats->total_iterations++;
+        
+        worker_check_limits(root, args->arena, config.max_nodes, control);
     }
+    mcts_note_arena(args->local_stats, &arena_start);
+    search_control_exit(control);
+    cnn_workspace_cleanup();    // Rollouts may have used the CNN on this thread
     return NULL;
 }
 
@@ -0,0 +1,352 @@
+/**
+ * opening_book.c - Precomputed Opening Book
+ *
+ * Contains: book files (opening_book_open/close), probing
+ * (opening_book_probe/pick), BookBuilder and the search builder
+ * (opening_book_search)
+ */
+
+#include "dama/search/opening_book.h"
+#include "dama/search/mcts_pool.h"
+#include "dama/engine/movegen.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define BOOK_MAGIC      "DBK1"
+
+typedef struct {
+    char magic[4];
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t start_key;         // Hash of the initial position: the zobrist keys in use
+} BookFileHeader;
+
+static uint64_t start_key(void) {
+    GameState s;
+    init_game(&s);
+    return s.hash;
+}
+
+// =============================================================================
+// BOOK FILES
+// =============================================================================
+
+int opening_book_open(OpeningBook *book, const char *path) {
+    memset(book, 0, sizeof(*book));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_error("[Book] Cannot open %s", path);
+        return -1;
+    }
+
+    struct stat st;
+    BookFileHeader header;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(header) ||
+        read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, BOOK_MAGIC, 4) != 0 ||
+        header.count > ((size_t)st.st_size - sizeof(header)) / sizeof(BookEntry)) {
+        log_error("[Book] %s is not a valid book", path);
+        close(fd);
+        return -1;
+    }
+    if (header.start_key != start_key()) {
+        log_error("[Book] %s was written with other zobrist keys", path);
+        close(fd);
+        return -1;
+    }
+
+    const size_t bytes = sizeof(header) + header.count * sizeof(BookEntry);
+    void *base = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        log_error("[Book] Cannot map %s", path);
+        return -1;
+    }
+    book->mapping = base;
+    book->mapping_bytes = bytes;
+    book->entries = (const BookEntry*)((const char*)base + sizeof(header));
+    book->count = header.count;
+    return 0;
+}
+
+void opening_book_close(OpeningBook *book) {
+    if (book->mapping) munmap(book->mapping, book->mapping_bytes);
+    memset(book, 0, sizeof(*book));
+}
+
+// =============================================================================
+// PROBING
+// =============================================================================
+
+// First entry with key >= key
+static size_t lower_bound(const OpeningBook *book, uint64_t key) {
+    size_t lo = 0, hi = book->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (book->entries[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int opening_book_probe(const OpeningBook *book, const GameState *s, BookEntry *out, int max) {
+    if (!book || book->count == 0) return 0;
+    PackedMoveList legal;
+    movegen_generate_packed(s, &legal);
+
+    int n = 0;
+    for (size_t i = lower_bound(book, s->hash); i < book->count && n < max; i++) {
+        const BookEntry *e = &book->entries[i];
+        if (e->key != s->hash) break;
+        for (int k = 0; k < legal.count; k++) {
+            if (legal.moves[k] == e->move) {
+                out[n++] = *e;
+                break;
+            }
+        }
+    }
+    return n;
+}
+
+int opening_book_pick(const OpeningBook *book, const GameState *s, RNG *rng, Move *out) {
+    BookEntry found[MAX_MOVES];
+    int n = opening_book_probe(book, s, found, MAX_MOVES);
+    if (n == 0 || found[0].visits < BOOK_MIN_VISITS) return 0;
+
+    int chosen = 0;
+    if (rng) {
+        const double floor = BOOK_PICK_SHARE * found[0].visits;
+        double total = 0.0;
+        int k = 0;
+        while (k < n && found[k].visits >= floor) total += found[k++].visits;
+        double r = rng_f32(rng) * total;
+        for (chosen = 0; chosen < k - 1; chosen++) {
+            r -= found[chosen].visits;
+            if (r < 0.0) break;
+        }
+    }
+    return movegen_unpack_move(s, found[chosen].move, out);
+}
+
+// =============================================================================
+// BUILDER
+// =============================================================================
+
+void book_builder_init(BookBuilder *b) {
+    memset(b, 0, sizeof(*b));
+}
+
+void book_builder_free(BookBuilder *b) {
+    free(b->entries);
+    memset(b, 0, sizeof(*b));
+}
+
+int book_builder_add(BookBuilder *b, uint64_t key, PackedMove move, uint32_t visits, float score) {
+    if (b->count == b->capacity) {
+        size_t cap = b->capacity ? b->capacity * 2 : 1024;
+        BookEntry *grown = realloc(b->entries, cap * sizeof(BookEntry));
+        if (!grown) return -1;
+        b->entries = grown;
+        b->capacity = cap;
+    }
+    b->entries[b->count++] = (BookEntry){ .key = key, .move = move, .visits = visits, .score = score };
+    return 0;
+}
+
+static int by_key_move(const void *pa, const void *pb) {
+    const BookEntry *a = pa, *b = pb;
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+    if (a->move != b->move) return a->move < b->move ? -1 : 1;
+    return 0;
+}
+
+// File order: by key, most played first
+static int by_key_visits(const void *pa, const void *pb) {
+    const BookEntry *a = pa, *b = pb;
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+    if (a->visits != b->visits) return a->visits > b->visits ? -1 : 1;
+    return by_key_move(pa, pb);
+}
+
+long book_builder_write(BookBuilder *b, const char *path, uint32_t min_visits) {
+    qsort(b->entries, b->count, sizeof(BookEntry), by_key_move);
+    size_t out = 0;
+    for (size_t i = 0; i < b->count;) {
+        BookEntry merged = b->entries[i];
+        double visits = merged.visits;
+        double score = (double)merged.score * merged.visits;
+        size_t j = i + 1;
+        for (; j < b->count && by_key_move(&b->entries[j], &merged) == 0; j++) {
+            visits += b->entries[j].visits;
+            score += (double)b->entries[j].score * b->entries[j].visits;
+        }
+        i = j;
+        if (visits < min_visits || visits <= 0.0) continue;
+        merged.visits = visits > UINT32_MAX ? UINT32_MAX : (uint32_t)visits;
+        merged.score = (float)(score / visits);
+        b->entries[out++] = merged;
+    }
+    b->count = out;
+    qsort(b->entries, b->count, sizeof(BookEntry), by_key_visits);
+
+    // Written next to the final name and renamed over it when complete
+    char tmp_path[520];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    BookFileHeader header = { .count = b->count, .start_key = start_key() };
+    memcpy(header.magic, BOOK_MAGIC, 4);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        log_error("[Book] Cannot write %s", tmp_path);
+        return -1;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(b->entries, sizeof(BookEntry), b->count, f) == b->count;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp_path, path) != 0) {
+        log_error("[Book] Cannot write %s", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return (long)b->count;
+}
+
+// =============================================================================
+// SEARCH BUILDER
+// =============================================================================
+
+static int by_hash(const void *pa, const void *pb) {
+    const GameState *a = pa, *b = pb;
+    return a->hash < b->hash ? -1 : (a->hash > b->hash);
+}
+
+static int by_u64(const void *pa, const void *pb) {
+    uint64_t a = *(const uint64_t*)pa, b = *(const uint64_t*)pb;
+    return a < b ? -1 : (a > b);
+}
+
+// One search of s: its root children into entries, the well visited ones
+// into next. Returns the entries written (0 if s has no search to make).
+static int search_position(const GameState *s, MCTSConfig cfg, double min_share,
+                           BookEntry *entries, GameState *next, int *n_next) {
+    *n_next = 0;
+    SearchSlot *slot = search_pool_acquire(0, ARENA_SIZE_BOOK, &ARENA_BACKING_SEARCH, 0, 0);
+    if (!slot) return 0;
+    Arena *arena = &slot->arena;
+    Node *root = mcts_create_root(*s, arena, cfg);
+    if (!root || root->is_terminal) return 0;
+    mcts_search(root, arena, 0.0, cfg, NULL, NULL, NULL);
+
+    long total = 0;
+    for (int i = 0; i < root->num_children; i++) total += root->children[i]->visits;
+    int n = 0;
+    for (int i = 0; i < root->num_children; i++) {
+        const Node *c = root->children[i];
+        if (c->visits <= 0) continue;
+        entries[n++] = (BookEntry){ .key = s->hash, .move = c->move_from_parent,
+                                    .visits = (uint32_t)c->visits,
+                                    .score = (float)(c->score / c->visits) };
+        if (!c->is_terminal && c->visits >= min_share * total) next[(*n_next)++] = c->state;
+    }
+    return n;
+}
+
+long opening_book_search(BookBuilder *b, const GameState *start, int depth, double min_share,
+                         const MCTSConfig *config, int threads, void (*on_ply)(int ply, long positions)) {
+#ifdef _OPENMP
+    if (threads <= 0) threads = omp_get_max_threads();
+#else
+    threads = 1;
+#endif
+
+    size_t n_frontier = 1, seen_count = 0, seen_cap = 1024;
+    GameState *frontier = malloc(sizeof(GameState));
+    uint64_t *seen = malloc(seen_cap * sizeof(uint64_t));
+    if (!frontier || !seen) {
+        free(frontier);
+        free(seen);
+        return -1;
+    }
+    frontier[0] = *start;
+
+    long searched = 0;
+    int failed = 0;
+    for (int ply = 0; ply < depth && n_frontier > 0 && !failed; ply++) {
+        // Reached twice this ply, or searched at an earlier one: once is enough
+        qsort(frontier, n_frontier, sizeof(GameState), by_hash);
+        size_t unique = 0;
+        for (size_t i = 0; i < n_frontier; i++) {
+            uint64_t key = frontier[i].hash;
+            if (unique > 0 && frontier[unique - 1].hash == key) continue;
+            if (bsearch(&key, seen, seen_count, sizeof(uint64_t), by_u64)) continue;
+            frontier[unique++] = frontier[i];
+        }
+        n_frontier = unique;
+        if (seen_count + n_frontier > seen_cap) {
+            seen_cap = 2 * (seen_count + n_frontier);
+            uint64_t *grown = realloc(seen, seen_cap * sizeof(uint64_t));
+            if (!grown) {
+                failed = 1;
+                break;
+            }
+            seen = grown;
+        }
+        for (size_t i = 0; i < n_frontier; i++) seen[seen_count++] = frontier[i].hash;
+        qsort(seen, seen_count, sizeof(uint64_t), by_u64);
+
+        // Up to MAX_MOVES children of each position go on to the next ply
+        GameState *next = malloc(n_frontier * MAX_MOVES * sizeof(GameState));
+        int *n_next = calloc(n_frontier, sizeof(int));
+        if (!next || !n_next) {
+            free(next);
+            free(n_next);
+            failed = 1;
+            break;
+        }
+
+        #pragma omp parallel num_threads(threads)
+        {
+            BookEntry entries[MAX_MOVES];
+            #pragma omp for schedule(dynamic)
+            for (long i = 0; i < (long)n_frontier; i++) {
+                int n = search_position(&frontier[i], *config, min_share, entries,
+                                        &next[i * MAX_MOVES], &n_next[i]);
+                #pragma omp critical(book_builder)
+                {
+                    for (int k = 0; k < n; k++) {
+                        const BookEntry *e = &entries[k];
+                        if (book_builder_add(b, e->key, e->move, e->visits, e->score) != 0) failed = 1;
+                    }
+                }
+            }
+            search_pool_release();
+        }
+        searched += (long)n_frontier;
+
+        size_t count = 0;
+        for (size_t i = 0; i < n_frontier; i++) {
+            memmove(&next[count], &next[i * MAX_MOVES], n_next[i] * sizeof(GameState));
+            count += n_next[i];
+        }
+        free(n_next);
+        free(frontier);
+        frontier = next;
+        n_frontier = count;
+        if (on_ply) on_ply(ply + 1, searched);
+    }
+
+    free(frontier);
+    free(seen);
+    return failed ? -1 : searched;
+}
@@ -0,0 +1,359 @@
+/**
+ * search_cache.c - Persistent Search Cache
+ *
+ * Contains: cache files (search_cache_open/close), keys and fingerprints,
+ * lock-free probe/store, root seeding (search_cache_seed)
+ */
+
+#include "dama/search/search_cache.h"
+#include "dama/search/mcts_internal.h"
+#include "dama/engine/movegen.h"
+#include "dama/neural/cnn_types.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC         "DSC1"
+#define CACHE_SHARE_MAX     16383   // 14-bit visit share
+#define CACHE_SCORE_MAX     4095    // 12-bit mean score
+
+typedef struct {
+    char magic[4];
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t start_key;         // Hash of the initial position: the zobrist keys in use
+    uint8_t pad[40];            // Entries start on a cache line
+} CacheFileHeader;
+
+static uint64_t start_key(void) {
+    GameState s;
+    init_game(&s);
+    return s.hash;
+}
+
+// =============================================================================
+// CACHE FILES
+// =============================================================================
+
+int search_cache_open(SearchCache *cache, const char *path, size_t entries) {
+    memset(cache, 0, sizeof(*cache));
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        log_error("[SearchCache] Cannot open %s", path);
+        return -1;
+    }
+
+    struct stat st;
+    CacheFileHeader header;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        // New file: a header and zeroed (empty) entries
+        size_t capacity = 1;
+        if (entries == 0) entries = SEARCH_CACHE_ENTRIES;
+        while (capacity * 2 <= entries) capacity *= 2;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, 4);
+        header.capacity = capacity;
+        header.start_key = start_key();
+        if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+            ftruncate(fd, (off_t)(sizeof(header) + capacity * sizeof(SearchCacheEntry))) != 0) {
+            log_error("[SearchCache] Cannot create %s", path);
+            close(fd);
+            return -1;
+        }
+    } else if ((size_t)st.st_size < sizeof(header) ||
+               read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+               memcmp(header.magic, CACHE_MAGIC, 4) != 0 ||
+               header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0 ||
+               header.capacity > ((size_t)st.st_size - sizeof(header)) / sizeof(SearchCacheEntry)) {
+        log_error("[SearchCache] %s is not a valid search cache", path);
+        close(fd);
+        return -1;
+    } else if (header.start_key != start_key()) {
+        log_error("[SearchCache] %s was written with other zobrist keys", path);
+        close(fd);
+        return -1;
+    }
+
+    const size_t bytes = sizeof(header) + header.capacity * sizeof(SearchCacheEntry);
+    void *base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        log_error("[SearchCache] Cannot map %s", path);
+        return -1;
+    }
+    cache->mapping = base;
+    cache->mapping_bytes = bytes;
+    cache->entries = (SearchCacheEntry*)((char*)base + sizeof(header));
+    cache->capacity = header.capacity;
+    cache->mask = header.capacity - 1;
+    return 0;
+}
+
+void search_cache_close(SearchCache *cache) {
+    if (cache->mapping) munmap(cache->mapping, cache->mapping_bytes);
+    memset(cache, 0, sizeof(*cache));
+}
+
+// =============================================================================
+// KEYS
+// =============================================================================
+
+// splitmix64 finalizer
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+static inline uint64_t fp_add(uint64_t h, uint64_t bits) {
+    return mix64(h ^ bits) + 0x9E3779B97F4A7C15ULL;
+}
+
+static inline uint64_t fp_add_double(uint64_t h, double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return fp_add(h, bits);
+}
+
+static uint64_t fp_add_floats(uint64_t h, const float *x, int n) {
+    if (!x) return fp_add(h, 0);
+    for (int i = 0; i < n; i++) {
+        uint32_t bits;
+        memcpy(&bits, &x[i], sizeof(bits));
+        h = fp_add(h, bits);
+    }
+    return h;
+}
+
+uint64_t search_cache_fingerprint(const MCTSConfig *c) {
+    uint64_t h = 0x5EA2C4CAC4E00001ULL;
+    const double reals[] = {
+        c->ucb1_c, c->rollout_epsilon, c->draw_score, c->bias_constant, c->fpu_value, c->decay_factor,
+        c->puct_c, c->weights.w_capture, c->weights.w_promotion, c->weights.w_advance,
+        c->weights.w_center, c->weights.w_edge, c->weights.w_base, c->weights.w_threat,
+        c->weights.w_lady_activity,
+    };
+    const int flags[] = {
+        c->expansion_threshold, c->use_lookahead, c->use_ucb1_tuned, c->use_solver,
+        c->use_progressive_bias, c->use_fpu, c->use_decaying_reward, c->use_fast_rollout,
+        c->fast_rollout_depth, c->rollouts_per_leaf, c->use_puct, c->tablebase != NULL,
+    };
+    for (size_t i = 0; i < sizeof(reals) / sizeof(reals[0]); i++) h = fp_add_double(h, reals[i]);
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) h = fp_add(h, (uint64_t)flags[i]);
+
+    // The network: its biases change with any training step
+    const CNNWeights *w = c->cnn_weights;
+    if (w) {
+        h = fp_add_floats(h, w->fused_conv1_b, CNN_CONV1_CHANNELS);
+        h = fp_add_floats(h, w->fused_conv2_b, CNN_CONV2_CHANNELS);
+        h = fp_add_floats(h, w->fused_conv3_b, CNN_CONV3_CHANNELS);
+        h = fp_add_floats(h, w->fused_conv4_b, CNN_CONV4_CHANNELS);
+        h = fp_add_floats(h, w->policy_b, CNN_POLICY_SIZE);
+        h = fp_add_floats(h, w->value_b1, 256);
+        h = fp_add_floats(h, w->value_w2, 256);
+        h = fp_add_floats(h, w->value_b2, 1);
+        h = fp_add(h, w->quant != NULL);
+    }
+    return h;
+}
+
+// Odd, so that an empty (zeroed) entry never matches
+static inline uint64_t cache_tag(const GameState *s, uint64_t fingerprint) {
+    uint64_t key = s->hash ^ ((uint64_t)s->moves_without_captures * 0x9E3779B97F4A7C15ULL);
+    return mix64(key ^ fingerprint) | 1;
+}
+
+static inline SearchCacheEntry* cache_slot(const SearchCache *cache, uint64_t tag) {
+    return &cache->entries[(tag >> 1) & cache->mask];
+}
+
+// =============================================================================
+// PROBE / STORE
+// =============================================================================
+
+/**
+ * Copy an entry out.
+ * @return 1 if it holds `tag` and was read whole
+ */
+static int cache_read(const SearchCacheEntry *e, uint64_t tag, uint64_t *words) {
+    words[0] = atomic_load_explicit(&e->words[0], memory_order_acquire);
+    uint64_t check = words[0];
+    for (int i = 1; i < SEARCH_CACHE_WORDS; i++) {
+        words[i] = atomic_load_explicit(&e->words[i], memory_order_relaxed);
+        check ^= words[i];
+    }
+    return check == tag;
+}
+
+int search_cache_probe(const SearchCache *cache, const GameState *s, uint64_t fingerprint,
+                       SearchCacheHit *out) {
+    if (!cache || !cache->entries) return 0;
+    const uint64_t tag = cache_tag(s, fingerprint);
+    uint64_t w[SEARCH_CACHE_WORDS];
+    if (!cache_read(cache_slot(cache, tag), tag, w)) return 0;
+
+    out->visits = (uint32_t)w[1];
+    uint32_t value_bits = (uint32_t)(w[1] >> 32);
+    memcpy(&out->value, &value_bits, sizeof(float));
+    out->num_legal = (int)(w[2] & 0xFF);
+    out->count = (int)((w[2] >> 8) & 0xFF);
+    if (out->count > SEARCH_CACHE_MOVES || out->count > out->num_legal) return 0;
+    for (int i = 0; i < out->count; i++) {
+        uint32_t m = (uint32_t)(w[3 + i / 2] >> (32 * (i & 1)));
+        out->move_index[i] = m & 63;
+        out->move_visits[i] = (uint32_t)(((uint64_t)((m >> 6) & CACHE_SHARE_MAX) * out->visits
+                                          + CACHE_SHARE_MAX / 2) / CACHE_SHARE_MAX);
+        out->move_score[i] = (float)((m >> 20) & CACHE_SCORE_MAX) / CACHE_SCORE_MAX;
+    }
+    return 1;
+}
+
+int search_cache_store(SearchCache *cache, const Node *root, uint64_t fingerprint) {
+    if (!cache || !cache->entries || root->num_children == 0) return 0;
+
+    // The most visited children, with their index among the legal moves
+    PackedMoveList legal;
+    movegen_generate_packed(&root->state, &legal);
+    int order[MAX_MOVES], n = 0;
+    uint64_t total = 0;
+    double score = 0.0;
+    for (int i = 0; i < root->num_children; i++) {
+        const Node *c = root->children[i];
+        int v = atomic_load(&c->visits);
+        if (v <= 0) continue;
+        total += (uint64_t)v;
+        score += atomic_load(&c->score);
+        // Insertion sort, most visited first
+        int k = n++;
+        while (k > 0 && atomic_load(&root->children[order[k - 1]]->visits) < v) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = i;
+    }
+    if (total < SEARCH_CACHE_MIN_VISITS) return 0;
+    if (total > UINT32_MAX) total = UINT32_MAX;
+    if (n > SEARCH_CACHE_MOVES) n = SEARCH_CACHE_MOVES;
+
+    // A deeper search of the same position stays
+    const uint64_t tag = cache_tag(&root->state, fingerprint);
+    SearchCacheEntry *e = cache_slot(cache, tag);
+    uint64_t old[SEARCH_CACHE_WORDS];
+    if (cache_read(e, tag, old) && (uint32_t)old[1] > total) return 0;
+
+    uint64_t w[SEARCH_CACHE_WORDS] = {0};
+    float value = (float)(score / (double)total);
+    uint32_t value_bits;
+    memcpy(&value_bits, &value, sizeof(value_bits));
+    w[1] = total | ((uint64_t)value_bits << 32);
+    int count = 0;
+    for (int k = 0; k < n; k++) {
+        const Node *c = root->children[order[k]];
+        int index = -1;
+        for (int j = 0; j < legal.count; j++) {
+            if (legal.moves[j] == c->move_from_parent) {
+                index = j;
+                break;
+            }
+        }
+        if (index < 0) continue;
+        int v = atomic_load(&c->visits);
+        double mean = atomic_load(&c->score) / v;
+        if (mean < 0.0) mean = 0.0;
+        if (mean > 1.0) mean = 1.0;
+        uint32_t share = (uint32_t)((uint64_t)v * CACHE_SHARE_MAX / total);
+        uint32_t m = (uint32_t)index | (share << 6) | ((uint32_t)(mean * CACHE_SCORE_MAX + 0.5) << 20);
+        w[3 + count / 2] |= (uint64_t)m << (32 * (count & 1));
+        count++;
+    }
+    w[2] = (uint64_t)legal.count | ((uint64_t)count << 8);
+
+    // Body first, then the checked key
+    uint64_t check = tag;
+    for (int i = 1; i < SEARCH_CACHE_WORDS; i++) {
+        atomic_store_explicit(&e->words[i], w[i], memory_order_relaxed);
+        check ^= w[i];
+    }
+    atomic_store_explicit(&e->words[0], check, memory_order_release);
+    return 1;
+}
+
+// =============================================================================
+// SEEDING
+// =============================================================================
+
+int search_cache_seed(const SearchCache *cache, Node *root, Arena *arena, TranspositionTable *tt,
+                      MCTSConfig config, uint64_t fingerprint, MCTSStats *stats) {
+    if (!cache || root->is_terminal || atomic_load(&root->visits) > 0 || root->num_children > 0) return 0;
+
+    SearchCacheHit hit;
+    PackedMoveList legal;
+    movegen_generate_packed(&root->state, &legal);
+    if (!search_cache_probe(cache, &root->state, fingerprint, &hit) || hit.num_legal != legal.count) {
+        if (stats) stats->search_cache_misses++;
+        return 0;
+    }
+
+    // Every move gets a child: the cached ones carry visits, the others
+    // are left for the search to try
+    if (config.cnn_weights) {
+        mcts_expand_with_policy(root, arena, tt, config, NULL, stats);
+    } else {
+        while (!node_is_fully_expanded(root)) {
+            int before = root->num_children;
+            mcts_expand_vanilla(root, arena, tt, config, stats);
+            if (root->num_children == before) break;
+        }
+    }
+
+    int slot_of[MAX_MOVES];
+    for (int j = 0; j < legal.count; j++) slot_of[j] = -1;
+    for (int i = 0; i < hit.count; i++) {
+        if (hit.move_index[i] < legal.count) slot_of[hit.move_index[i]] = i;
+    }
+
+    int seeded = 0;
+    double root_score = 0.0, root_sum_sq = 0.0;
+    for (int k = 0; k < root->num_children; k++) {
+        Node *c = root->children[k];
+        int i = -1;
+        for (int j = 0; j < legal.count; j++) {
+            if (legal.moves[j] == c->move_from_parent) {
+                i = slot_of[j];
+                break;
+            }
+        }
+        uint32_t v = (i >= 0) ? hit.move_visits[i] : 0;
+        c->prior = (float)(v + 1) / (float)(hit.visits + root->num_children);
+        if (v > 0 && atomic_load(&c->visits) == 0) {
+            const double mean = hit.move_score[i];
+            atomic_store(&c->visits, (int)v);
+            atomic_store(&c->score, mean * v);
+            atomic_store(&c->sum_sq_score, mean * mean * v);
+            seeded += (int)v;
+            root_score += (1.0 - mean) * v;
+            root_sum_sq += (1.0 - mean) * (1.0 - mean) * v;
+        }
+        child_stats_publish(c);
+    }
+    atomic_store(&root->visits, seeded);
+    atomic_store(&root->score, root_score);
+    atomic_store(&root->sum_sq_score, root_sum_sq);
+
+    if (stats) {
+        if (seeded > 0) stats->search_cache_hits++;
+        else stats->search_cache_misses++;
+    }
+    return seeded;
+}
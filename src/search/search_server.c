@@ -0,0 +1,259 @@
+/**
+ * search_server.c - Resident Engine Behind a Line Protocol
+ *
+ * Contains: position setup (startpos, board, moves), go/stop on top of
+ * MCTSAsyncSearch, info/bestmove reports (search_server_poll)
+ */
+
+#include "dama/search/search_server.h"
+#include "dama/search/mcts_many.h"
+#include "dama/search/mcts_time.h"
+#include "dama/engine/game_view.h"
+#include "dama/engine/movegen.h"
+#include "dama/common/params.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SERVE_MAX_TOKENS    512
+
+static double server_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void reply(SearchServer *srv, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void reply(SearchServer *srv, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(srv->out, fmt, args);
+    va_end(args);
+    fputc('\n', srv->out);
+    fflush(srv->out);
+}
+
+// =============================================================================
+// SETUP
+// =============================================================================
+
+int search_server_init(SearchServer *srv, MCTSConfig config, size_t arena_size, FILE *out) {
+    memset(srv, 0, sizeof(*srv));
+    srv->config = config;
+    srv->out = out;
+    if (arena_init_with(&srv->arena, arena_size, &ARENA_BACKING_SEARCH) != 0) return -1;
+    if (config.use_tree_reuse && arena_init_with(&srv->spare, arena_size, &ARENA_BACKING_SEARCH) != 0) {
+        arena_free(&srv->arena);
+        return -1;
+    }
+    if (config.use_tt) {
+        srv->tt = tt_create(TT_SIZE_DEFAULT);
+        if (!srv->tt) {
+            arena_free(&srv->arena);
+            arena_free(&srv->spare);
+            return -1;
+        }
+    }
+    init_game(&srv->state);
+    return 0;
+}
+
+// Wait for the running search and report its result
+static void finish_search(SearchServer *srv);
+
+void search_server_free(SearchServer *srv) {
+    if (srv->search.active) {
+        mcts_async_stop(&srv->search);
+        finish_search(srv);
+    }
+    arena_free(&srv->arena);
+    arena_free(&srv->spare);
+    tt_free(srv->tt);
+    memset(srv, 0, sizeof(*srv));
+}
+
+// =============================================================================
+// REPORTS
+// =============================================================================
+
+static void report_info(SearchServer *srv, const Node *root, long nodes, int depth) {
+    Move pv[MCTS_PV_MAX];
+    double value = 0.5;
+    int len = srv->search.active ? mcts_async_peek(&srv->search, pv, MCTS_PV_MAX, &value)
+                                 : mcts_get_pv(root, pv, MCTS_PV_MAX, &value);
+    double elapsed = server_now() - srv->started;
+    char line[64 + MCTS_PV_MAX * MOVE_TEXT_MAX];
+    int n = snprintf(line, sizeof(line), "info time %.3f nodes %ld depth %d nps %.0f value %.4f pv",
+                     elapsed, nodes, depth, elapsed > 0 ? nodes / elapsed : 0.0, value);
+    for (int i = 0; i < len && (size_t)n + MOVE_TEXT_MAX + 1 < sizeof(line); i++) {
+        line[n++] = ' ';
+        n += format_move(&pv[i], line + n, sizeof(line) - n);
+    }
+    reply(srv, "%s", line);
+}
+
+static void finish_search(SearchServer *srv) {
+    Move best = mcts_async_wait(&srv->search, NULL);
+    report_info(srv, srv->root, srv->stats.current_move_iterations, srv->stats.max_depth);
+    if (best.length == 0 && best.path[0] == best.path[1]) {
+        // Stopped before its first iteration: any legal move
+        MoveList list;
+        movegen_generate(&srv->state, &list);
+        if (list.count == 0) {
+            reply(srv, "bestmove none");
+            return;
+        }
+        best = list.moves[0];
+    }
+    char text[MOVE_TEXT_MAX];
+    format_move(&best, text, sizeof(text));
+    reply(srv, "bestmove %s", text);
+    if (!srv->config.use_tree_reuse) srv->root = NULL;
+}
+
+int search_server_poll(SearchServer *srv) {
+    if (!srv->search.active) return 0;
+    if (mcts_async_poll(&srv->search)) {
+        finish_search(srv);
+        return 0;
+    }
+    double now = server_now();
+    if (now - srv->last_info >= SERVE_INFO_INTERVAL) {
+        srv->last_info = now;
+        report_info(srv, srv->root, atomic_load(&srv->root->visits), 0);
+    }
+    return 1;
+}
+
+void search_server_finish(SearchServer *srv) {
+    if (srv->search.active && !srv->bounded) {
+        mcts_async_stop(&srv->search);
+        finish_search(srv);
+    }
+    while (search_server_poll(srv)) {
+        struct timespec pause = { 0, 10 * 1000 * 1000 };
+        nanosleep(&pause, NULL);
+    }
+}
+
+// =============================================================================
+// COMMANDS
+// =============================================================================
+
+static void cmd_position(SearchServer *srv, char **tok, int n) {
+    SearchPosition pos;
+    const char *bad_move;
+    if (search_position_parse(tok + 1, n - 1, &pos, &bad_move) != 0) {
+        if (bad_move) reply(srv, "error illegal move %s", bad_move);
+        else reply(srv, "error position needs startpos or board <32 squares> <w|b>");
+        return;
+    }
+
+    // Keep the subtree if the position follows the last search
+    if (srv->root && srv->config.use_tree_reuse) {
+        srv->root = mcts_advance_root(srv->root, &pos.state, &srv->arena, &srv->spare, srv->tt);
+    } else {
+        srv->root = NULL;
+    }
+    srv->state = pos.state;
+    memcpy(srv->history, pos.history, sizeof(pos.history));
+    srv->plies = pos.plies;
+}
+
+static Node* fresh_root(SearchServer *srv) {
+    arena_reset(&srv->arena);
+    if (srv->tt) tt_reset(srv->tt);
+    Node *history;
+    if (mcts_history_chain(srv->history, srv->plies, &srv->arena, &history) != 0) return NULL;
+    return mcts_create_root_with_history(srv->state, &srv->arena, srv->config, history);
+}
+
+static void cmd_go(SearchServer *srv, char **tok, int n) {
+    MCTSConfig cfg = srv->config;
+    double time_limit = 0.0;
+    cfg.max_nodes = 0;
+    for (int i = 1; i < n; i++) {
+        if (strcmp(tok[i], "nodes") == 0 && i + 1 < n) {
+            cfg.max_nodes = atoi(tok[++i]);
+        } else if (strcmp(tok[i], "time") == 0 && i + 1 < n) {
+            time_limit = atof(tok[++i]);
+        } else if (strcmp(tok[i], "clock") == 0 && i + 1 < n) {
+            double remaining = atof(tok[++i]);
+            double increment = (i + 1 < n && tok[i + 1][0] >= '0' && tok[i + 1][0] <= '9') ? atof(tok[++i]) : 0.0;
+            GameClock clock;
+            game_clock_init(&clock, remaining, increment);
+            game_clock_budget(&clock, &cfg.soft_time, &time_limit);
+        } else if (strcmp(tok[i], "infinite") == 0) {
+            cfg.max_nodes = 0;
+            time_limit = 0.0;
+        } else {
+            reply(srv, "error unknown go option %s", tok[i]);
+            return;
+        }
+    }
+
+    if (!movegen_has_any_move(&srv->state)) {
+        reply(srv, "bestmove none");
+        return;
+    }
+    if (!srv->root) srv->root = fresh_root(srv);
+    if (!srv->root) {
+        reply(srv, "error out of arena memory");
+        return;
+    }
+
+    memset(&srv->stats, 0, sizeof(srv->stats));
+    srv->bounded = cfg.max_nodes > 0 || time_limit > 0.0;
+    srv->started = srv->last_info = server_now();
+    if (mcts_async_start(&srv->search, srv->root, &srv->arena, time_limit, cfg, &srv->stats, srv->tt) != 0) {
+        reply(srv, "error cannot start the search");
+    }
+}
+
+int search_server_command(SearchServer *srv, const char *line) {
+    char buf[SERVE_MAX_LINE];
+    snprintf(buf, sizeof(buf), "%s", line);
+    char *tok[SERVE_MAX_TOKENS];
+    int n = 0;
+    for (char *t = strtok(buf, " \t\r\n"); t && n < SERVE_MAX_TOKENS; t = strtok(NULL, " \t\r\n")) tok[n++] = t;
+    if (n == 0) return 0;
+
+    if (strcmp(tok[0], "stop") == 0) {
+        if (srv->search.active) {
+            mcts_async_stop(&srv->search);
+            finish_search(srv);
+        }
+        return 0;
+    }
+    if (strcmp(tok[0], "isready") == 0) {
+        reply(srv, "readyok");
+        return 0;
+    }
+
+    search_server_finish(srv);
+
+    if (strcmp(tok[0], "quit") == 0) return 1;
+    if (strcmp(tok[0], "newgame") == 0) {
+        srv->root = NULL;
+        if (srv->tt) tt_reset(srv->tt);
+    } else if (strcmp(tok[0], "position") == 0) {
+        cmd_position(srv, tok, n);
+    } else if (strcmp(tok[0], "go") == 0) {
+        cmd_go(srv, tok, n);
+    } else if (strcmp(tok[0], "legal") == 0) {
+        MoveList list;
+        movegen_generate(&srv->state, &list);
+        char out[8 + MAX_MOVES * (MOVE_TEXT_MAX + 1)];
+        int len = snprintf(out, sizeof(out), "legal");
+        for (int i = 0; i < list.count; i++) {
+            out[len++] = ' ';
+            len += format_move(&list.moves[i], out + len, sizeof(out) - len);
+        }
+        reply(srv, "%s", out);
+    } else {
+        reply(srv, "error unknown command %s", tok[0]);
+    }
+    return 0;
+}
@@ -6,6 +6,14 @@
 #include "dama/engine/game.h"
 #include "dama/engine/movegen.h"
 #include "dama/search/mcts.h" // mcts_create_root etc
+#include "dama/search/mcts_inference.h"
+#include "dama/search/mcts_async.h"
+#include "dama/search/mcts_time.h"
+#include "dama/search/mcts_pool.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/params.h"
+#include "dama/common/affinity.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -65,36 +73,127 @@ static void compute_elos(TournamentPlayer *players, int n, MatchPairResult *resu
     }
 }
 
+// =============================================================================
+// EARLY STOPPING
+// =============================================================================
+
+static double elo_to_score(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double score_to_elo(double score) {
+    score = fmin(fmax(score, 1e-6), 1.0 - 1e-6);
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Mean and per-game variance of p1's score. A start with one kind of result
+// only has no variance yet: half a game of each result is added to it.
+static void score_moments(int wins, int losses, int draws, double *mean, double *var) {
+    double n = wins + losses + draws;
+    double s = (wins + 0.5 * draws) / n;
+    double v = (wins * (1.0 - s) * (1.0 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / n;
+    if (wins == 0 || losses == 0 || draws == 0) {
+        double w = wins + 0.5, l = losses + 0.5, d = draws + 0.5, m = w + l + d;
+        double sr = (w + 0.5 * d) / m;
+        double vr = (w * (1.0 - sr) * (1.0 - sr) + d * (0.5 - sr) * (0.5 - sr) + l * sr * sr) / m;
+        if (vr > v) v = vr;
+    }
+    *mean = s;
+    *var = v;
+}
+
+double match_sprt_llr(int wins, int losses, int draws, double elo0, double elo1) {
+    int n = wins + losses + draws;
+    if (n == 0) return 0.0;
+    double s, var;
+    score_moments(wins, losses, draws, &s, &var);
+    double s0 = elo_to_score(elo0), s1 = elo_to_score(elo1);
+    return n * (s1 - s0) * (2.0 * s - s0 - s1) / (2.0 * var);
+}
+
+void match_elo_interval(int wins, int losses, int draws, double *elo, double *margin) {
+    int n = wins + losses + draws;
+    if (n == 0) {
+        *elo = 0.0;
+        *margin = INFINITY;
+        return;
+    }
+    double s, var;
+    score_moments(wins, losses, draws, &s, &var);
+    double se = sqrt(var / n);
+    *elo = score_to_elo(s);
+    *margin = 0.5 * (score_to_elo(s + 1.96 * se) - score_to_elo(s - 1.96 * se));
+}
+
+int match_stop_check(const MatchStopRule *rule, int wins, int losses, int draws, double *out_llr) {
+    if (out_llr) *out_llr = 0.0;
+    int min_games = rule->min_games > 0 ? rule->min_games : SPRT_MIN_GAMES;
+    if (wins + losses + draws < min_games) return MATCH_CONTINUE;
+    
+    if (rule->sprt) {
+        double alpha = rule->alpha > 0 ? rule->alpha : SPRT_ALPHA;
+        double beta = rule->beta > 0 ? rule->beta : SPRT_BETA;
+        double llr = match_sprt_llr(wins, losses, draws, rule->elo0, rule->elo1);
+        if (out_llr) *out_llr = llr;
+        if (llr >= log((1.0 - beta) / alpha)) return MATCH_ACCEPT_H1;
+        if (llr <= log(beta / (1.0 - alpha))) return MATCH_ACCEPT_H0;
+    }
+    if (rule->elo_margin > 0) {
+        double elo, margin;
+        match_elo_interval(wins, losses, draws, &elo, &margin);
+        if (margin <= rule->elo_margin) return MATCH_PRECISE;
+    }
+    return MATCH_CONTINUE;
+}
+
 // =============================================================================
 // GAME LOGIC
 // =============================================================================
 
-static int play_single_game(TournamentPlayer *pA, TournamentPlayer *pB, int a_is_white, double time_limit, 
-                            MCTSStats *sA, MCTSStats *sB, int *out_game_moves, double *out_durA, double *out_durB) {
+static int play_single_game(TournamentPlayer *pA, TournamentPlayer *pB, int a_is_white, unsigned game_seed,
+                            const TournamentSystemConfig *cfg, MCTSStats *sA, MCTSStats *sB, int *out_game_moves, double *out_durA, double *out_durB) {
     GameState state;
     init_game(&state);
     
-    Arena arenaA, arenaB;
-    arena_init(&arenaA, ARENA_SIZE_TOURNAMENT);
-    arena_init(&arenaB, ARENA_SIZE_TOURNAMENT);
+    // The thread's pooled arenas and TTs, emptied for this game. Tree reuse
+    // compacts the kept subtree through the slot's spare arena.
+    SearchSlot *slotA = search_pool_acquire(0, ARENA_SIZE_TOURNAMENT, &ARENA_BACKING_TOURNAMENT,
+                                            pA->config.use_tree_reuse, pA->config.use_tt);
+    SearchSlot *slotB = search_pool_acquire(1, ARENA_SIZE_TOURNAMENT, &ARENA_BACKING_TOURNAMENT,
+                                            pB->config.use_tree_reuse, pB->config.use_tt);
+    if (!slotA || !slotB) {
+        log_error("[Tournament] Cannot allocate the search arenas");
+        if (out_game_moves) *out_game_moves = 0;
+        if (out_durA) *out_durA = 0;
+        if (out_durB) *out_durB = 0;
+        return 0;
+    }
+    Node *rootA = NULL, *rootB = NULL;
     
-    TranspositionTable *ttA = NULL;
-    TranspositionTable *ttB = NULL;
-    if (pA->config.use_tt) ttA = tt_create(TT_SIZE_DEFAULT);
-    if (pB->config.use_tt) ttB = tt_create(TT_SIZE_DEFAULT);
+    TranspositionTable *ttA = pA->config.use_tt ? slotA->tt : NULL;
+    TranspositionTable *ttB = pB->config.use_tt ? slotB->tt : NULL;
 
     GameState history[2] = {0};
     int moves = 0;
     
+    // Pondering: each side searches its tree on the other's time
+    MCTSAsyncSearch pondering[2];
+    memset(pondering, 0, sizeof(pondering));
+    
+    // Game clocks, or a fixed time per move (neither in deterministic games)
+    int on_clock = cfg->clock_base > 0 && !cfg->deterministic;
+    GameClock clocks[2];
+    game_clock_init(&clocks[0], cfg->clock_base, cfg->clock_increment);
+    game_clock_init(&clocks[1], cfg->clock_base, cfg->clock_increment);
+    int ponder = cfg->ponder && !cfg->deterministic && (on_clock || cfg->time_limit > 0);
+    
     // Result: 1 (A wins), -1 (B wins), 0 (Draw)
     int result = 0;
     
     double durA = 0, durB = 0;
     
     while (1) {
-        MoveList list;
-        movegen_generate(&state, &list);
-        if (list.count == 0) {
+        if (!movegen_has_any_move(&state)) {
             int winner = (state.current_player == WHITE) ? BLACK : WHITE;
             if ((winner == WHITE && a_is_white) || (winner == BLACK && !a_is_white)) result = 1;
             else result = -1;
@@ -108,33 +207,55 @@ static int play_single_game(TournamentPlayer *pA, TournamentPlayer *pB, int a_is
         
         int is_a_turn = (state.current_player == WHITE) == a_is_white;
         TournamentPlayer *cur = is_a_turn ? pA : pB;
-        Arena *arena = is_a_turn ? &arenaA : &arenaB;
+        SearchSlot *slot = is_a_turn ? slotA : slotB;
+        Arena *arena = &slot->arena;
         MCTSStats *stats = is_a_turn ? sA : sB;
         TranspositionTable *tt = is_a_turn ? ttA : ttB;
+        Node **kept = is_a_turn ? &rootA : &rootB;
+        MCTSAsyncSearch *mine = &pondering[is_a_turn ? 0 : 1];
         
-        // Search
-        arena_reset(arena); // Reset to clear previous tree
-        if (tt) tt_reset(tt); // Reset TT as well since arena reset makes nodes dangling
+        // Book move: no search, and no tree to carry over
+        Move book_move;
+        if (cfg->book && opening_book_pick(cfg->book, &state, NULL, &book_move)) {
+            mcts_ponder_finish(mine, NULL, &state, arena, NULL, tt, NULL);
+            *kept = NULL;
+            history[1] = history[0];
+            history[0] = state;
+            apply_move(&state, &book_move);
+            moves++;
+            continue;
+        }
         
-        // History injection
-        Node *history_head = NULL;
-        if (cur->config.cnn_weights && moves >= 1) {
-             Node *h1 = arena_alloc(arena, sizeof(Node));
-             memset(h1, 0, sizeof(Node));
-             h1->state = history[0];
-             pthread_mutex_init(&h1->lock, NULL);
-             history_head = h1;
-             
-             if (moves >= 2) {
-                 Node *h2 = arena_alloc(arena, sizeof(Node));
-                 memset(h2, 0, sizeof(Node));
-                 h2->state = history[1];
-                 pthread_mutex_init(&h2->lock, NULL);
-                 h1->parent = h2;
-             }
+        // Reuse our previous tree if it reached the current position
+        // (after stopping the ponder search on it)
+        Node *root = NULL;
+        if (cur->config.use_tree_reuse && *kept) {
+            root = mcts_ponder_finish(mine, *kept, &state, arena, &slot->spare, tt, NULL);
         }
         
-        Node *root = mcts_create_root_with_history(state, arena, cur->config, history_head);
+        if (!root) {
+            arena_reset(arena); // Reset to clear previous tree
+            if (tt) tt_reset(tt); // Reset TT as well since arena reset makes nodes dangling
+            
+            // History injection
+            Node *history_head = NULL;
+            if (cur->config.cnn_weights && moves >= 1) {
+                 Node *h1 = arena_alloc(arena, sizeof(Node));
+                 memset(h1, 0, sizeof(Node));
+                 h1->state = history[0];
+                 history_head = h1;
+                 
+                 if (moves >= 2) {
+                     Node *h2 = arena_alloc(arena, sizeof(Node));
+                     memset(h2, 0, sizeof(Node));
+                     h2->state = history[1];
+                     h1->parent = h2;
+                 }
+            }
+            
+            root = mcts_create_root_with_history(state, arena, cur->config, history_head);
+        }
+        *kept = root;
         
         double t0;
         #ifdef _OPENMP
@@ -143,7 +264,17 @@ static int play_single_game(TournamentPlayer *pA, TournamentPlayer *pB, int a_is
         t0 = (double)clock() / CLOCKS_PER_SEC;
         #endif
         
-        Move best = mcts_search(root, arena, time_limit, cur->config, stats, tt, NULL);
+        GameClock *side_clock = &clocks[is_a_turn ? 0 : 1];
+        MCTSConfig search_cfg = cur->config;
+        double time_limit = cfg->time_limit;
+        if (on_clock) game_clock_budget(side_clock, &search_cfg.soft_time, &time_limit);
+        if (cfg->deterministic) {
+            search_cfg.deterministic = 1;
+            search_cfg.seed = game_seed + (unsigned)moves * 2654435761u;
+        }
+        
+        Node *played = NULL;
+        Move best = mcts_search(root, arena, time_limit, search_cfg, stats, tt, &played);
         
         double t1;
         #ifdef _OPENMP
@@ -155,17 +286,25 @@ static int play_single_game(TournamentPlayer *pA, TournamentPlayer *pB, int a_is
         if (is_a_turn) durA += (t1 - t0);
         else durB += (t1 - t0);
         
+        // Flag fall: the side that ran out of time loses
+        if (on_clock && game_clock_spend(side_clock, t1 - t0) != 0) {
+            result = is_a_turn ? -1 : 1;
+            break;
+        }
+        
         history[1] = history[0];
         history[0] = state;
         
         apply_move(&state, &best);
         moves++;
+        
+        if (ponder && played) mcts_ponder_start(mine, played, arena, cur->config, tt);
     }
     
-    arena_free(&arenaA);
-    arena_free(&arenaB);
-    if (ttA) tt_free(ttA);
-    if (ttB) tt_free(ttB);
+    for (int k = 0; k < 2; k++) {
+        mcts_async_stop(&pondering[k]);
+        mcts_async_wait(&pondering[k], NULL);
+    }
     
     if (out_game_moves) *out_game_moves = moves;
     if (out_durA) *out_durA = durA;
@@ -173,6 +312,87 @@ static int play_single_game(TournamentPlayer *pA, TournamentPlayer *pB, int a_is
     return result;
 }
 
+// =============================================================================
+// SHARED INFERENCE
+// =============================================================================
+
+// Give a CNN player one evaluator for all of its parallel games
+static int attach_inference_server(TournamentPlayer *p, InferenceServer *server, int clients) {
+    MCTSConfig *c = &p->config;
+    if (!c->cnn_weights || c->num_threads > 0 || clients < 2) return 0;
+    if (inference_server_start(server, (const CNNWeights*)c->cnn_weights, clients * c->leaf_batch,
+                               INFERENCE_SERVER_GATHER_US, 1) != ERR_OK) return 0;
+    c->inference_server = server;
+    return 1;
+}
+
+static void detach_inference_server(TournamentPlayer *p, InferenceServer *server, int attached) {
+    if (!attached) return;
+    p->config.inference_server = NULL;
+    inference_server_stop(server);
+}
+
+// =============================================================================
+// PER-THREAD TALLIES
+// =============================================================================
+
+// One player's search statistics from one thread's games
+typedef struct {
+    long long iters, nodes, moves, depth, expansions, children_expanded;
+    long long tt_hits, tt_misses;
+    long long search_cache_hits, search_cache_misses;
+    long long arena_allocs, arena_bytes;
+    double duration;
+    size_t peak_memory, arena_high_water;
+    MCTSProfile profile;
+} PlayerTally;
+
+static void tally_add(PlayerTally *t, const MCTSStats *s, double duration) {
+    t->iters += s->total_iterations;
+    t->nodes += s->total_nodes;
+    t->moves += s->total_moves;
+    t->depth += s->total_depth;
+    t->expansions += s->nodes_with_children;
+    t->children_expanded += s->total_children_expanded;
+    t->tt_hits += s->tt_hits;
+    t->tt_misses += s->tt_misses;
+    t->search_cache_hits += s->search_cache_hits;
+    t->search_cache_misses += s->search_cache_misses;
+    t->arena_allocs += s->arena_allocs;
+    t->arena_bytes += s->arena_bytes;
+    t->duration += duration;
+    if (s->peak_memory_bytes > t->peak_memory) t->peak_memory = s->peak_memory_bytes;
+    if (s->arena_high_water > t->arena_high_water) t->arena_high_water = s->arena_high_water;
+    mcts_profile_merge(&t->profile, &s->profile);
+}
+
+static void tally_merge(TournamentPlayer *p, const PlayerTally *t) {
+    p->total_iters += t->iters;
+    p->total_nodes += t->nodes;
+    p->total_moves += t->moves;
+    p->total_depth += t->depth;
+    p->total_expansions += t->expansions;
+    p->total_children_expanded += t->children_expanded;
+    p->tt_hits += t->tt_hits;
+    p->tt_misses += t->tt_misses;
+    p->search_cache_hits += t->search_cache_hits;
+    p->search_cache_misses += t->search_cache_misses;
+    p->arena_allocs += t->arena_allocs;
+    p->arena_bytes += t->arena_bytes;
+    p->total_duration += t->duration;
+    if (t->peak_memory > p->peak_memory) p->peak_memory = t->peak_memory;
+    if (t->arena_high_water > p->arena_high_water) p->arena_high_water = t->arena_high_water;
+    mcts_profile_merge(&p->profile, &t->profile);
+}
+
+// A pair's games so far (under the result lock)
+typedef struct {
+    int i, j;
+    int started, finished;
+    int decided;            // A stop rule ended the match: no new games
+    MatchPairResult res;
+} PairState;
+
 // =============================================================================
 // MAIN RUNNER
 // =============================================================================
@@ -188,123 +408,159 @@ void tournament_run(TournamentSystemConfig *cfg) {
     int total_matches = n * (n - 1) / 2;
     if (cfg->on_start) cfg->on_start(total_matches);
     
+    int threads = 1;
+    #ifdef _OPENMP
+    if (cfg->parallel_games) threads = omp_get_max_threads();
+    #endif
+    
+    // One job per (pair, game), pair-major so pairs finish roughly in order
+    long total_jobs = (long)total_matches * games;
+    if (threads > total_jobs) threads = total_jobs > 0 ? (int)total_jobs : 1;
+    PairState *pairs = calloc(total_matches > 0 ? total_matches : 1, sizeof(PairState));
+    PlayerTally *tallies = calloc((size_t)threads * n, sizeof(PlayerTally));
+    if (!matrix || !pairs || !tallies) {
+        log_error("[Tournament] Out of memory");
+        free(matrix);
+        free(pairs);
+        free(tallies);
+        return;
+    }
+    for (int i = 0, k = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++, k++) {
+            pairs[k].i = i;
+            pairs[k].j = j;
+        }
+    }
+    
+    // Per-player NN eval cache and evaluator, shared by all of its games:
+    // arenas are reset every move, the cache is not
+    CNNCache **caches = calloc(n, sizeof(CNNCache*));
+    InferenceServer *servers = calloc(n, sizeof(InferenceServer));
+    int *attached = calloc(n, sizeof(int));
     for (int i = 0; i < n; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (cfg->on_match_start) cfg->on_match_start(i, j, cfg->players[i].name, cfg->players[j].name);
-            
-            MatchPairResult pair_res = {0};
-            
-            // Run games
-            int p1_wins = 0, p2_wins = 0, draws = 0;
-            
-            // OMP Parallel Games?
-            int use_omp = (cfg->parallel_games);
+        MCTSConfig *c = &cfg->players[i].config;
+        if (caches && c->cnn_weights && !c->cnn_cache) {
+            caches[i] = cnn_cache_create(CNN_CACHE_SIZE_DEFAULT);
+            c->cnn_cache = caches[i];
+        }
+        if (servers && attached) attached[i] = attach_inference_server(&cfg->players[i], &servers[i], threads);
+    }
+    
+    // Idle threads take the next job from one queue: no barrier between
+    // pairs. Results stream out as games end; search stats stay per thread.
+    // Jobs of a pair a stop rule decided are skipped. Threads are pinned
+    // (affinity.h) before their first game allocates the pooled arenas.
+    #pragma omp parallel num_threads(threads) if(threads > 1)
+    {
+        #ifdef _OPENMP
+        affinity_pin_slot(omp_get_thread_num());
+        #else
+        affinity_pin_slot(0);
+        #endif
+        #pragma omp for schedule(dynamic, 1)
+        for (long job = 0; job < total_jobs; job++) {
             #ifdef _OPENMP
-            // Need thread-safe stats aggregation
+            PlayerTally *mine = tallies + (size_t)omp_get_thread_num() * n;
             #else
-            use_omp = 0;
+            PlayerTally *mine = tallies;
             #endif
-            
-            #pragma omp parallel for if(use_omp) reduction(+:p1_wins, p2_wins, draws)
-            for (int g = 0; g < games; g++) {
-                int a_is_white = (g % 2 == 0);
-                MCTSStats s1 = {0}, s2 = {0};
-                int moves_count = 0;
-                double durA = 0, durB = 0;
-                int res = play_single_game(&cfg->players[i], &cfg->players[j], a_is_white, cfg->time_limit, &s1, &s2, &moves_count, &durA, &durB);
-                
-                if (res == 1) p1_wins++;
-                else if (res == -1) p2_wins++;
-                else draws++;
-                
-                // Aggregate stats to P1 (i)
-                #pragma omp atomic
-                cfg->players[i].total_iters += s1.total_iterations;
-                #pragma omp atomic
-                cfg->players[i].total_nodes += s1.total_nodes;
-                #pragma omp atomic
-                cfg->players[i].total_moves += s1.total_moves;
-                #pragma omp atomic
-                cfg->players[i].total_duration += durA;
-                #pragma omp atomic
-                cfg->players[i].total_depth += s1.total_depth;
-                #pragma omp atomic
-                cfg->players[i].total_expansions += s1.nodes_with_children;
-                #pragma omp atomic
-                cfg->players[i].total_children_expanded += s1.total_children_expanded;
-                #pragma omp atomic
-                cfg->players[i].tt_hits += s1.tt_hits;
-                #pragma omp atomic
-                cfg->players[i].tt_misses += s1.tt_misses;
-                
-                #pragma omp critical
-                {
-                    if (s1.peak_memory_bytes > cfg->players[i].peak_memory)
-                        cfg->players[i].peak_memory = s1.peak_memory_bytes;
-                }
-
-                // Aggregate stats to P2 (j)
-                #pragma omp atomic
-                cfg->players[j].total_iters += s2.total_iterations;
-                #pragma omp atomic
-                cfg->players[j].total_nodes += s2.total_nodes;
-                #pragma omp atomic
-                cfg->players[j].total_moves += s2.total_moves;
-                #pragma omp atomic
-                cfg->players[j].total_duration += durB;
-                #pragma omp atomic
-                cfg->players[j].total_depth += s2.total_depth;
-                #pragma omp atomic
-                cfg->players[j].total_expansions += s2.nodes_with_children;
-                #pragma omp atomic
-                cfg->players[j].total_children_expanded += s2.total_children_expanded;
-                #pragma omp atomic
-                cfg->players[j].tt_hits += s2.tt_hits;
-                #pragma omp atomic
-                cfg->players[j].tt_misses += s2.tt_misses;
-
-                #pragma omp critical
-                {
-                    if (s2.peak_memory_bytes > cfg->players[j].peak_memory)
-                        cfg->players[j].peak_memory = s2.peak_memory_bytes;
+            PairState *pair = &pairs[job / games];
+            int g = (int)(job % games);
+            int i = pair->i, j = pair->j;
+        
+            int skip;
+            #pragma omp critical(tournament_results)
+            {
+                skip = pair->decided;
+                if (!skip && pair->started++ == 0 && cfg->on_match_start) {
+                    cfg->on_match_start(i, j, cfg->players[i].name, cfg->players[j].name);
                 }
-                
+            }
+            if (skip) continue;
+        
+            int a_is_white = (g % 2 == 0);
+            MCTSStats s1 = {0}, s2 = {0};
+            int moves_count = 0;
+            double durA = 0, durB = 0;
+            const unsigned game_seed = cfg->seed ^ ((unsigned)(job + 1) * 0x9E3779B9u);
+            int res = play_single_game(&cfg->players[i], &cfg->players[j], a_is_white, game_seed, cfg,
+                                       &s1, &s2, &moves_count, &durA, &durB);
+        
+            tally_add(&mine[i], &s1, durA);
+            tally_add(&mine[j], &s2, durB);
+        
+            #pragma omp critical(tournament_results)
+            {
+                if (res == 1) pair->res.wins++;
+                else if (res == -1) pair->res.losses++;
+                else pair->res.draws++;
+            
                 if (cfg->on_game_complete) {
                     TournamentGameResult gr = {
                         .p1_idx=i, .p2_idx=j, .result=res, .moves=moves_count, .duration=durA+durB, .duration_p1=durA, .duration_p2=durB, .s1=s1, .s2=s2
                     };
-                    #pragma omp critical
                     cfg->on_game_complete(&gr);
                 }
-            }
-            
-            pair_res.wins = p1_wins;
-            pair_res.losses = p2_wins;
-            pair_res.draws = draws;
-            
-            // Store symmetry
-            matrix[i*n + j] = pair_res;
-            matrix[j*n + i] = (MatchPairResult){ .wins=p2_wins, .losses=p1_wins, .draws=draws };
-            
-            // Update player cumulative
-            cfg->players[i].wins += p1_wins;
-            cfg->players[i].losses += p2_wins;
-            cfg->players[i].draws += draws;
-            cfg->players[i].points += p1_wins + 0.5*draws;
-            
-            cfg->players[j].wins += p2_wins;
-            cfg->players[j].losses += p1_wins;
-            cfg->players[j].draws += draws;
-            cfg->players[j].points += p2_wins + 0.5*draws;
+                pair->finished++;
+                if (!pair->decided) {
+                    double llr;
+                    int verdict = match_stop_check(&cfg->stop, pair->res.wins, pair->res.losses, pair->res.draws, &llr);
+                    if (verdict != MATCH_CONTINUE) {
+                        pair->decided = 1;
+                        if (cfg->on_match_decided) cfg->on_match_decided(i, j, verdict, llr);
+                    }
+                }
             
-            if (cfg->on_match_end) cfg->on_match_end(i, j, p1_wins, p2_wins, draws);
+                // Games already running when the match was decided still count
+                int last = pair->decided ? pair->finished == pair->started : pair->finished == games;
+                if (last && cfg->on_match_end) {
+                    cfg->on_match_end(i, j, pair->res.wins, pair->res.losses, pair->res.draws);
+                }
+            }
         }
+        affinity_unpin();
+    }
+    
+    for (int i = 0; i < n; i++) {
+        if (attached && attached[i]) detach_inference_server(&cfg->players[i], &servers[i], 1);
+        for (int t = 0; t < threads; t++) tally_merge(&cfg->players[i], &tallies[(size_t)t * n + i]);
+    }
+    
+    for (int k = 0; k < total_matches; k++) {
+        int i = pairs[k].i, j = pairs[k].j;
+        MatchPairResult r = pairs[k].res;
+        
+        // Store symmetry
+        matrix[i*n + j] = r;
+        matrix[j*n + i] = (MatchPairResult){ .wins=r.losses, .losses=r.wins, .draws=r.draws };
+        
+        // Update player cumulative
+        cfg->players[i].wins += r.wins;
+        cfg->players[i].losses += r.losses;
+        cfg->players[i].draws += r.draws;
+        cfg->players[i].points += r.wins + 0.5*r.draws;
+        
+        cfg->players[j].wins += r.losses;
+        cfg->players[j].losses += r.wins;
+        cfg->players[j].draws += r.draws;
+        cfg->players[j].points += r.losses + 0.5*r.draws;
     }
     
     compute_elos(cfg->players, n, matrix);
     
     if (cfg->on_tournament_end) cfg->on_tournament_end(cfg->players, n);
     
+    for (int i = 0; caches && i < n; i++) {
+        if (caches[i]) {
+            cfg->players[i].config.cnn_cache = NULL;
+            cnn_cache_free(caches[i]);
+        }
+    }
+    free(caches);
+    free(servers);
+    free(attached);
+    free(tallies);
+    free(pairs);
     free(matrix);
 }
 
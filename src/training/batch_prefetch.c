@@ -0,0 +1,148 @@
+/**
+ * batch_prefetch.c - Training Batches Assembled Ahead of the Train Step
+ *
+ * One producer per stream: the stream's window is filled in order, so a
+ * second producer would only wait on the first.
+ */
+
+#include "dama/training/batch_prefetch.h"
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================================
+// PRODUCER
+// =============================================================================
+
+static int ring_full(const BatchPrefetcher *pf) {
+    return pf->filled - pf->released >= pf->depth;
+}
+
+static void* prefetch_main(void *arg) {
+    BatchPrefetcher *pf = arg;
+
+    pthread_mutex_lock(&pf->lock);
+    while (!pf->stop) {
+        if (!pf->active || (!pf->cancel && ring_full(pf))) {
+            pthread_cond_wait(&pf->cond_free, &pf->lock);
+            continue;
+        }
+        if (pf->cancel) {
+            pf->active = 0;
+            pthread_cond_broadcast(&pf->cond_filled);
+            continue;
+        }
+
+        // The slot is free and only this thread touches the stream mid-epoch
+        int slot = (int)(pf->filled % pf->depth);
+        pthread_mutex_unlock(&pf->lock);
+        size_t n = dataset_stream_next(pf->stream, pf->slots + (size_t)slot * pf->batch_size,
+                                       (size_t)pf->batch_size);
+        pthread_mutex_lock(&pf->lock);
+
+        if (n == 0) {
+            pf->active = 0;
+        } else {
+            pf->sizes[slot] = (int)n;
+            pf->filled++;
+        }
+        pthread_cond_broadcast(&pf->cond_filled);
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+int batch_prefetch_init(BatchPrefetcher *pf, DatasetStream *stream, int batch_size, int depth) {
+    memset(pf, 0, sizeof(*pf));
+    pf->stream = stream;
+    pf->batch_size = batch_size;
+    pf->depth = depth > 0 ? depth : 0;
+
+    int slots = pf->depth > 0 ? pf->depth : 1;
+    pf->slots = malloc((size_t)slots * batch_size * sizeof(TrainingSample));
+    pf->sizes = calloc(slots, sizeof(int));
+    if (!pf->slots || !pf->sizes) {
+        free(pf->slots);
+        free(pf->sizes);
+        return -1;
+    }
+    if (pf->depth == 0) return 0;
+
+    pthread_mutex_init(&pf->lock, NULL);
+    pthread_cond_init(&pf->cond_filled, NULL);
+    pthread_cond_init(&pf->cond_free, NULL);
+    if (pthread_create(&pf->thread, NULL, prefetch_main, pf) != 0) {
+        pthread_mutex_destroy(&pf->lock);
+        pthread_cond_destroy(&pf->cond_filled);
+        pthread_cond_destroy(&pf->cond_free);
+        free(pf->slots);
+        free(pf->sizes);
+        return -1;
+    }
+    return 0;
+}
+
+void batch_prefetch_start(BatchPrefetcher *pf) {
+    if (pf->depth == 0) {
+        dataset_stream_rewind(pf->stream);
+        return;
+    }
+
+    pthread_mutex_lock(&pf->lock);
+    if (pf->active) {
+        pf->cancel = 1;
+        pthread_cond_broadcast(&pf->cond_free);
+        while (pf->active) pthread_cond_wait(&pf->cond_filled, &pf->lock);
+    }
+
+    // Producer idle: the stream is ours until active is set
+    dataset_stream_rewind(pf->stream);
+    pf->filled = pf->consumed = pf->released = 0;
+    pf->cancel = 0;
+    pf->active = 1;
+    pthread_cond_broadcast(&pf->cond_free);
+    pthread_mutex_unlock(&pf->lock);
+}
+
+const TrainingSample* batch_prefetch_next(BatchPrefetcher *pf, int *size) {
+    if (pf->depth == 0) {
+        *size = (int)dataset_stream_next(pf->stream, pf->slots, (size_t)pf->batch_size);
+        return *size > 0 ? pf->slots : NULL;
+    }
+
+    pthread_mutex_lock(&pf->lock);
+    pf->released = pf->consumed;  // The previous batch's slot is free
+    pthread_cond_broadcast(&pf->cond_free);
+    while (pf->consumed == pf->filled && pf->active) {
+        pthread_cond_wait(&pf->cond_filled, &pf->lock);
+    }
+    const TrainingSample *batch = NULL;
+    *size = 0;
+    if (pf->consumed < pf->filled) {
+        int slot = (int)(pf->consumed % pf->depth);
+        batch = pf->slots + (size_t)slot * pf->batch_size;
+        *size = pf->sizes[slot];
+        pf->consumed++;
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return batch;
+}
+
+void batch_prefetch_free(BatchPrefetcher *pf) {
+    if (pf->depth > 0) {
+        pthread_mutex_lock(&pf->lock);
+        pf->stop = 1;
+        pthread_cond_broadcast(&pf->cond_free);
+        pthread_mutex_unlock(&pf->lock);
+        pthread_join(pf->thread, NULL);
+        pthread_mutex_destroy(&pf->lock);
+        pthread_cond_destroy(&pf->cond_filled);
+        pthread_cond_destroy(&pf->cond_free);
+    }
+    free(pf->slots);
+    free(pf->sizes);
+    memset(pf, 0, sizeof(*pf));
+}
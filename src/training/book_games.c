@@ -0,0 +1,72 @@
+/**
+ * book_games.c - Opening Book from Selfplay Datasets
+ */
+
+#include "dama/training/book_games.h"
+#include "dama/training/dataset.h"
+#include "dama/engine/movegen.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int piece_count(const GameState *s) {
+    return __builtin_popcountll(s->piece[WHITE][PAWN] | s->piece[WHITE][LADY] |
+                                s->piece[BLACK][PAWN] | s->piece[BLACK][LADY]);
+}
+
+// The legal move of prev that leads to s (PM_NONE if none does)
+static PackedMove played_move(const GameState *prev, const GameState *s) {
+    PackedMoveList legal;
+    movegen_generate_packed(prev, &legal);
+    for (int i = 0; i < legal.count; i++) {
+        GameState next = *prev;
+        apply_packed_move(&next, legal.moves[i]);
+        if (next.current_player == s->current_player &&
+            memcmp(next.piece, s->piece, sizeof(next.piece)) == 0) {
+            return legal.moves[i];
+        }
+    }
+    return PM_NONE;
+}
+
+int book_add_games(BookBuilder *b, const char *dataset, BookGamesStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    DatasetView view;
+    if (dataset_open(dataset, &view) != 0) {
+        log_error("[Book] Cannot read %s", dataset);
+        return -1;
+    }
+    TrainingSample *block = malloc(DATASET_BLOCK_SAMPLES * sizeof(TrainingSample));
+    if (!block) {
+        dataset_close(&view);
+        return -1;
+    }
+
+    int failed = 0;
+    for (size_t blk = 0; blk < view.n_blocks && !failed; blk++) {
+        int n = dataset_view_read_block(&view, blk, block);
+        if (n < 0) {
+            log_error("[Book] Corrupt block %zu in %s", blk, dataset);
+            failed = 1;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            const TrainingSample *s = &block[i];
+            const GameState *prev = &s->history[0];
+            stats->samples++;
+            if (training_sample_history_empty(prev) || piece_count(prev) < BOOK_GAMES_MIN_PIECES) continue;
+            PackedMove move = played_move(prev, &s->state);
+            if (move == PM_NONE) continue;
+            if (book_builder_add(b, prev->hash, move, 1, 0.5f * (1.0f - s->target_value)) != 0) {
+                failed = 1;
+                break;
+            }
+            stats->moves++;
+        }
+    }
+
+    free(block);
+    dataset_close(&view);
+    return failed ? -1 : 0;
+}
@@ -5,11 +5,17 @@
 #include "dama/neural/cnn.h"
 #include "dama/neural/conv_ops.h"
 #include "dama/common/error_codes.h"
+#include "dama/common/logging.h"
+#include "dama/common/trace.h"
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
-#include <Accelerate/Accelerate.h>
+#include "dama/common/math_backend.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 // =============================================================================
 // BATCH NORM BACKWARD
@@ -22,7 +28,9 @@ void batch_norm_backward(
     int C, int H, int W
 ) {
     int S = H * W;
-    #pragma omp parallel for
+    // Channels are independent: each one owns its d_gamma/d_beta entries
+    int threads = conv_threads(S / 64);
+    #pragma omp parallel for num_threads(threads) if (threads > 1)
     for (int c = 0; c < C; c++) {
         float mean = batch_mean[c];
         float var = batch_var[c];
@@ -35,10 +43,7 @@ void batch_norm_backward(
             d_beta_c += d_output[c * S + i];
         }
         
-        // Atomic add for gamma/beta gradients (may be accumulated from multiple samples)
-        #pragma omp atomic
         d_gamma[c] += d_gamma_c;
-        #pragma omp atomic
         d_beta[c] += d_beta_c;
 
         float common = gamma[c] * inv_std / S;
@@ -101,16 +106,8 @@ void cnn_forward_train(
     cblas_sgemv(CblasRowMajor, CblasNoTrans, 512, 4097, 1.0f, 
                 w->policy_w, 4097, fc_input, 1, 1.0f, policy_out, 1);
     
-    // Softmax (vDSP vectorized)
-    float max_p;
-    vDSP_maxv(policy_out, 1, &max_p, 512);  // Find max
-    float neg_max = -max_p;
-    vDSP_vsadd(policy_out, 1, &neg_max, policy_out, 1, 512);  // Subtract max
-    int n512 = 512;
-    vvexpf(policy_out, policy_out, &n512);  // Vectorized exp
-    float sum_exp;
-    vDSP_sve(policy_out, 1, &sum_exp, 512);  // Sum
-    vDSP_vsdiv(policy_out, 1, &sum_exp, policy_out, 1, 512);  // Divide by sum
+    // Softmax (vectorized, in place)
+    vec_softmax(policy_out, policy_out, 512);
 
     // Value head layer 1: value_h = ReLU(W1 * fc_input + b1) (BLAS optimized)
     memcpy(value_h, w->value_b1, 256 * sizeof(float));  // Start with bias
@@ -140,93 +137,122 @@ typedef struct {
     float *d_policy_w, *d_policy_b;
     float *d_value_w1, *d_value_b1;
     float *d_value_w2, *d_value_b2;
+    float *block;               // Owning allocation (NULL for a view of CNNWeights)
 } LocalGradients;
 
-// Forward declaration (needed by local_grads_init for OOM cleanup)
-static void local_grads_free(LocalGradients *lg);
+#define GRAD_TENSORS 22
+
+static const size_t GRAD_SIZES[GRAD_TENSORS] = {
+    64 * CNN_INPUT_CHANNELS * 9, 64, 64 * 64 * 9, 64, 64 * 64 * 9, 64, 64 * 64 * 9, 64,
+    64, 64, 64, 64, 64, 64, 64, 64,
+    512 * 4097, 512, 256 * 4097, 256, 256, 1
+};
+
+static void local_grads_slots(LocalGradients *lg, float **slots[GRAD_TENSORS]) {
+    float **s[GRAD_TENSORS] = {
+        &lg->d_conv1_w, &lg->d_conv1_b, &lg->d_conv2_w, &lg->d_conv2_b,
+        &lg->d_conv3_w, &lg->d_conv3_b, &lg->d_conv4_w, &lg->d_conv4_b,
+        &lg->d_bn1_gamma, &lg->d_bn1_beta, &lg->d_bn2_gamma, &lg->d_bn2_beta,
+        &lg->d_bn3_gamma, &lg->d_bn3_beta, &lg->d_bn4_gamma, &lg->d_bn4_beta,
+        &lg->d_policy_w, &lg->d_policy_b, &lg->d_value_w1, &lg->d_value_b1,
+        &lg->d_value_w2, &lg->d_value_b2
+    };
+    memcpy(slots, s, sizeof(s));
+}
+
+// The first thread accumulates straight into the gradients of w
+static void local_grads_view(CNNWeights *w, LocalGradients *lg) {
+    *lg = (LocalGradients){
+        w->d_conv1_w, w->d_conv1_b, w->d_conv2_w, w->d_conv2_b,
+        w->d_conv3_w, w->d_conv3_b, w->d_conv4_w, w->d_conv4_b,
+        w->d_bn1_gamma, w->d_bn1_beta, w->d_bn2_gamma, w->d_bn2_beta,
+        w->d_bn3_gamma, w->d_bn3_beta, w->d_bn4_gamma, w->d_bn4_beta,
+        w->d_policy_w, w->d_policy_b, w->d_value_w1, w->d_value_b1,
+        w->d_value_w2, w->d_value_b2, NULL
+    };
+}
 
 /**
- * Initialize thread-local gradient buffers.
+ * One contiguous block per gradient set: zeroing it is a single memset.
  * 
- * @return ERR_OK on success, ERR_MEMORY if any allocation fails.
- *         On failure, all partially allocated memory is freed.
+ * @return ERR_OK on success, ERR_MEMORY if the allocation fails.
  */
 static int local_grads_init(LocalGradients *lg) {
-    // Zero struct first so partial allocations can be safely freed
-    memset(lg, 0, sizeof(LocalGradients));
+    size_t total = 0;
+    for (int k = 0; k < GRAD_TENSORS; k++) total += GRAD_SIZES[k];
     
-    // Allocate all gradient buffers with NULL checks
-    lg->d_conv1_w = calloc(64 * CNN_INPUT_CHANNELS * 9, sizeof(float));
-    lg->d_conv1_b = calloc(64, sizeof(float));
-    lg->d_conv2_w = calloc(64 * 64 * 9, sizeof(float));
-    lg->d_conv2_b = calloc(64, sizeof(float));
-    lg->d_conv3_w = calloc(64 * 64 * 9, sizeof(float));
-    lg->d_conv3_b = calloc(64, sizeof(float));
-    lg->d_conv4_w = calloc(64 * 64 * 9, sizeof(float));
-    lg->d_conv4_b = calloc(64, sizeof(float));
-    lg->d_bn1_gamma = calloc(64, sizeof(float));
-    lg->d_bn1_beta = calloc(64, sizeof(float));
-    lg->d_bn2_gamma = calloc(64, sizeof(float));
-    lg->d_bn2_beta = calloc(64, sizeof(float));
-    lg->d_bn3_gamma = calloc(64, sizeof(float));
-    lg->d_bn3_beta = calloc(64, sizeof(float));
-    lg->d_bn4_gamma = calloc(64, sizeof(float));
-    lg->d_bn4_beta = calloc(64, sizeof(float));
-    lg->d_policy_w = calloc(512 * 4097, sizeof(float));
-    lg->d_policy_b = calloc(512, sizeof(float));
-    lg->d_value_w1 = calloc(256 * 4097, sizeof(float));
-    lg->d_value_b1 = calloc(256, sizeof(float));
-    lg->d_value_w2 = calloc(256, sizeof(float));
-    lg->d_value_b2 = calloc(1, sizeof(float));
+    memset(lg, 0, sizeof(LocalGradients));
+    lg->block = malloc(total * sizeof(float));
+    if (!lg->block) return ERR_MEMORY;
     
-    // Check all allocations succeeded
-    if (!lg->d_conv1_w || !lg->d_conv1_b || !lg->d_conv2_w || !lg->d_conv2_b ||
-        !lg->d_conv3_w || !lg->d_conv3_b || !lg->d_conv4_w || !lg->d_conv4_b ||
-        !lg->d_bn1_gamma || !lg->d_bn1_beta || !lg->d_bn2_gamma || !lg->d_bn2_beta ||
-        !lg->d_bn3_gamma || !lg->d_bn3_beta || !lg->d_bn4_gamma || !lg->d_bn4_beta ||
-        !lg->d_policy_w || !lg->d_policy_b || !lg->d_value_w1 || !lg->d_value_b1 ||
-        !lg->d_value_w2 || !lg->d_value_b2) {
-        local_grads_free(lg);
-        return ERR_MEMORY;
+    float **slots[GRAD_TENSORS];
+    local_grads_slots(lg, slots);
+    float *p = lg->block;
+    for (int k = 0; k < GRAD_TENSORS; k++) {
+        *slots[k] = p;
+        p += GRAD_SIZES[k];
     }
-    
     return ERR_OK;
 }
 
-static void local_grads_free(LocalGradients *lg) {
-    free(lg->d_conv1_w); free(lg->d_conv1_b);
-    free(lg->d_conv2_w); free(lg->d_conv2_b);
-    free(lg->d_conv3_w); free(lg->d_conv3_b);
-    free(lg->d_conv4_w); free(lg->d_conv4_b);
-    free(lg->d_bn1_gamma); free(lg->d_bn1_beta);
-    free(lg->d_bn2_gamma); free(lg->d_bn2_beta);
-    free(lg->d_bn3_gamma); free(lg->d_bn3_beta);
-    free(lg->d_bn4_gamma); free(lg->d_bn4_beta);
-    free(lg->d_policy_w); free(lg->d_policy_b);
-    free(lg->d_value_w1); free(lg->d_value_b1);
-    free(lg->d_value_w2); free(lg->d_value_b2);
+static void local_grads_zero(LocalGradients *lg) {
+    size_t total = 0;
+    for (int k = 0; k < GRAD_TENSORS; k++) total += GRAD_SIZES[k];
+    memset(lg->block, 0, total * sizeof(float));
 }
 
-static void local_grads_merge(CNNWeights *w, LocalGradients *lg) {
-    // Merge all thread-local gradients into global (called once per thread end)
-    for (int i = 0; i < 64 * CNN_INPUT_CHANNELS * 9; i++) w->d_conv1_w[i] += lg->d_conv1_w[i];
-    for (int i = 0; i < 64; i++) w->d_conv1_b[i] += lg->d_conv1_b[i];
-    for (int i = 0; i < 64 * 64 * 9; i++) w->d_conv2_w[i] += lg->d_conv2_w[i];
-    for (int i = 0; i < 64; i++) w->d_conv2_b[i] += lg->d_conv2_b[i];
-    for (int i = 0; i < 64 * 64 * 9; i++) w->d_conv3_w[i] += lg->d_conv3_w[i];
-    for (int i = 0; i < 64; i++) w->d_conv3_b[i] += lg->d_conv3_b[i];
-    for (int i = 0; i < 64 * 64 * 9; i++) w->d_conv4_w[i] += lg->d_conv4_w[i];
-    for (int i = 0; i < 64; i++) w->d_conv4_b[i] += lg->d_conv4_b[i];
-    for (int i = 0; i < 64; i++) { w->d_bn1_gamma[i] += lg->d_bn1_gamma[i]; w->d_bn1_beta[i] += lg->d_bn1_beta[i]; }
-    for (int i = 0; i < 64; i++) { w->d_bn2_gamma[i] += lg->d_bn2_gamma[i]; w->d_bn2_beta[i] += lg->d_bn2_beta[i]; }
-    for (int i = 0; i < 64; i++) { w->d_bn3_gamma[i] += lg->d_bn3_gamma[i]; w->d_bn3_beta[i] += lg->d_bn3_beta[i]; }
-    for (int i = 0; i < 64; i++) { w->d_bn4_gamma[i] += lg->d_bn4_gamma[i]; w->d_bn4_beta[i] += lg->d_bn4_beta[i]; }
-    for (int i = 0; i < 512 * 4097; i++) w->d_policy_w[i] += lg->d_policy_w[i];
-    for (int i = 0; i < 512; i++) w->d_policy_b[i] += lg->d_policy_b[i];
-    for (int i = 0; i < 256 * 4097; i++) w->d_value_w1[i] += lg->d_value_w1[i];
-    for (int i = 0; i < 256; i++) w->d_value_b1[i] += lg->d_value_b1[i];
-    for (int i = 0; i < 256; i++) w->d_value_w2[i] += lg->d_value_w2[i];
-    w->d_value_b2[0] += lg->d_value_b2[0];
+/**
+ * Gradient sets of the extra training threads (thread t > 0 uses pool[t - 1]),
+ * kept across steps. Owned by the thread calling cnn_train_step; freed by
+ * cnn_training_cleanup.
+ */
+static __thread LocalGradients *grad_pool = NULL;
+static __thread int grad_pool_count = 0;
+
+// Grow the pool for up to `threads` threads; returns how many can run
+static int grad_pool_reserve(int threads) {
+    if (threads - 1 > grad_pool_count) {
+        LocalGradients *pool = realloc(grad_pool, (size_t)(threads - 1) * sizeof(LocalGradients));
+        if (pool) {
+            grad_pool = pool;
+            while (grad_pool_count < threads - 1 &&
+                   local_grads_init(&grad_pool[grad_pool_count]) == ERR_OK) {
+                grad_pool_count++;
+            }
+        }
+    }
+    return (threads - 1 < grad_pool_count ? threads - 1 : grad_pool_count) + 1;
+}
+
+static void grad_pool_free(void) {
+    for (int t = 0; t < grad_pool_count; t++) free(grad_pool[t].block);
+    free(grad_pool);
+    grad_pool = NULL;
+    grad_pool_count = 0;
+}
+
+/**
+ * Add the pool's first `extra` sets into the gradients of w. Called by every
+ * thread of the team: each one sums its static slice of every tensor over all
+ * sets, so no two threads write the same element (no critical, no atomics).
+ */
+static void local_grads_reduce(CNNWeights *w, const LocalGradients *pool, int extra) {
+    LocalGradients dst;
+    local_grads_view(w, &dst);
+    float **out[GRAD_TENSORS];
+    local_grads_slots(&dst, out);
+    
+    size_t offset = 0;
+    for (int k = 0; k < GRAD_TENSORS; k++) {
+        float *o = *out[k];
+        #pragma omp for schedule(static) nowait
+        for (size_t i = 0; i < GRAD_SIZES[k]; i++) {
+            float sum = 0;
+            for (int t = 0; t < extra; t++) sum += pool[t].block[offset + i];
+            o[i] += sum;
+        }
+        offset += GRAD_SIZES[k];
+    }
 }
 
 // =============================================================================
@@ -417,28 +443,250 @@ void cnn_update_weights(CNNWeights *w, float policy_lr, float value_lr, float mo
     update_layer(w->value_b1, w->d_value_b1, w->v_value_b1, 256, scaled_value_lr, momentum, 0, 0);
     update_layer(w->value_w2, w->d_value_w2, w->v_value_w2, 256, scaled_value_lr, momentum, l1, l2);
     update_layer(w->value_b2, w->d_value_b2, w->v_value_b2, 1, scaled_value_lr, momentum, 0, 0);
+    
+    // Conv/BN params and running stats moved: refresh the inference form
+    cnn_fold_batch_norm(w);
 }
 
 // =============================================================================
-// FULLY PARALLELIZED TRAINING STEP (Data Parallel)
+// MINI-BATCH TRAINING STEP (CNN_TRAIN_BATCHED)
 // =============================================================================
 
-float cnn_train_step(CNNWeights *w, const TrainingSample *batch, int batch_size, float policy_lr, float value_lr, float l1, float l2, float *out_policy_loss, float *out_value_loss) {
-    cnn_zero_gradients(w);
+static CNNTrainAlgo train_algo = CNN_TRAIN_ALGO_DEFAULT;
+
+void cnn_set_train_algo(CNNTrainAlgo algo) { train_algo = algo; }
+CNNTrainAlgo cnn_get_train_algo(void) { return train_algo; }
+
+/**
+ * Activations of one batch, channel-major ([C][batch][64]) through the
+ * backbone so each BN channel is one contiguous batch*64 row.
+ * Thread-local, grown on demand, freed by cnn_training_cleanup.
+ */
+typedef struct {
+    int capacity;
+    float *input;               // [12][batch][64]
+    float *conv_pre[4];         // [64][batch][64] conv output (BN input)
+    float *pre_relu[4];         // BN output
+    float *act[4];              // ReLU(BN output)
+    float mean[4][64], var[4][64];
+    float *fc;                  // [batch][4097] flattened conv4 + player
+    float *policy;              // [batch][512] probabilities, then d_logits
+    float *value_h;             // [batch][256] ReLU hidden, then d_hidden
+    float *value;               // [batch]
+    float *d_fc;                // [batch][4097]
+    float *d_act, *d_pre;       // [64][batch][64]
+    float *col;                 // CONV_BATCH_COL_FLOATS(CONV2_SHAPE)
+    float *block;
+} TrainBatchBuffers;
+
+static __thread TrainBatchBuffers tls_train = {0};
+
+static TrainBatchBuffers* train_buffers(int batch) {
+    TrainBatchBuffers *t = &tls_train;
+    if (t->capacity >= batch) return t;
+    
+    size_t plane = (size_t)64 * 64 * batch;
+    size_t total = (size_t)CNN_INPUT_CHANNELS * 64 * batch + 12 * plane
+                 + (size_t)batch * (4097 + 512 + 256 + 1 + 4097) + 2 * plane
+                 + CONV_BATCH_COL_FLOATS(CONV2_SHAPE);
+    float *block = malloc(total * sizeof(float));
+    if (!block) return NULL;
+    free(t->block);
+    
+    float *p = block;
+    t->input = p; p += (size_t)CNN_INPUT_CHANNELS * 64 * batch;
+    for (int l = 0; l < 4; l++) {
+        t->conv_pre[l] = p; p += plane;
+        t->pre_relu[l] = p; p += plane;
+        t->act[l] = p; p += plane;
+    }
+    t->fc = p; p += (size_t)batch * 4097;
+    t->policy = p; p += (size_t)batch * 512;
+    t->value_h = p; p += (size_t)batch * 256;
+    t->value = p; p += batch;
+    t->d_fc = p; p += (size_t)batch * 4097;
+    t->d_act = p; p += plane;
+    t->d_pre = p; p += plane;
+    t->col = p;
+    t->block = block;
+    t->capacity = batch;
+    return t;
+}
+
+static void train_buffers_free(void) {
+    free(tls_train.block);
+    memset(&tls_train, 0, sizeof(tls_train));
+}
+
+/**
+ * Forward + backward of the whole batch as large GEMMs (batched im2col per
+ * conv, one sgemm per FC layer and direction), BN on batch statistics.
+ * Gradients go straight into w->d_*. Returns -1 on OOM (nothing done).
+ */
+static int accumulate_batched(CNNWeights *w, const TrainingSample *batch, int B,
+                              float *total_p_loss, float *total_v_loss) {
+    TrainBatchBuffers *t = train_buffers(B);
+    if (!t) return -1;
+    const int N = B * 64;
+    float *conv_w[4] = {w->conv1_w, w->conv2_w, w->conv3_w, w->conv4_w};
+    float *conv_b[4] = {w->conv1_b, w->conv2_b, w->conv3_b, w->conv4_b};
+    float *gamma[4] = {w->bn1_gamma, w->bn2_gamma, w->bn3_gamma, w->bn4_gamma};
+    float *beta[4] = {w->bn1_beta, w->bn2_beta, w->bn3_beta, w->bn4_beta};
+    float *run_mean[4] = {w->bn1_mean, w->bn2_mean, w->bn3_mean, w->bn4_mean};
+    float *run_var[4] = {w->bn1_var, w->bn2_var, w->bn3_var, w->bn4_var};
+    float *d_conv_w[4] = {w->d_conv1_w, w->d_conv2_w, w->d_conv3_w, w->d_conv4_w};
+    float *d_conv_b[4] = {w->d_conv1_b, w->d_conv2_b, w->d_conv3_b, w->d_conv4_b};
+    float *d_gamma[4] = {w->d_bn1_gamma, w->d_bn2_gamma, w->d_bn3_gamma, w->d_bn4_gamma};
+    float *d_beta[4] = {w->d_bn1_beta, w->d_bn2_beta, w->d_bn3_beta, w->d_bn4_beta};
+    const ConvShape shapes[4] = {CONV1_SHAPE, CONV2_SHAPE, CONV3_SHAPE, CONV4_SHAPE};
     
-    float total_loss = 0, total_p_loss = 0, total_v_loss = 0;
+    // Encode, scattered to channel-major
+    TRACE_BEGIN(t_forward);
+    for (int b = 0; b < B; b++) {
+        float player, planes[CNN_INPUT_CHANNELS * 64];
+        cnn_encode_sample(&batch[b], planes, &player);
+        for (int c = 0; c < CNN_INPUT_CHANNELS; c++) {
+            memcpy(&t->input[((size_t)c * B + b) * 64], &planes[c * 64], 64 * sizeof(float));
+        }
+    }
+    
+    // Backbone: conv (batched im2col + sgemm), BN over the batch, ReLU
+    for (int l = 0; l < 4; l++) {
+        conv2d_forward_batch(l ? t->act[l - 1] : t->input, conv_w[l], conv_b[l], t->conv_pre[l],
+                             shapes[l], B, t->col);
+        batch_norm_forward_relu(t->conv_pre[l], gamma[l], beta[l], t->act[l], t->pre_relu[l],
+                                t->mean[l], t->var[l], run_mean[l], run_var[l], 64, 1, N, 1);
+    }
+    
+    TRACE_END("train backbone forward", t_forward);
+    
+    // Flatten per sample ([c][s], as the inference path) + player (1.0, canonical)
+    TRACE_BEGIN(t_heads);
+    for (int b = 0; b < B; b++) {
+        float *f = &t->fc[(size_t)b * 4097];
+        for (int c = 0; c < 64; c++) memcpy(&f[c * 64], &t->act[3][((size_t)c * B + b) * 64], 64 * sizeof(float));
+        f[4096] = 1.0f;
+    }
+    
+    // Heads: policy[B x 512] = fc * policy_w^T + b, value_h[B x 256] = fc * value_w1^T + b1
+    for (int b = 0; b < B; b++) {
+        memcpy(&t->policy[b * 512], w->policy_b, 512 * sizeof(float));
+        memcpy(&t->value_h[b * 256], w->value_b1, 256 * sizeof(float));
+    }
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, B, 512, 4097,
+                1.0f, t->fc, 4097, w->policy_w, 4097, 1.0f, t->policy, 512);
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, B, 256, 4097,
+                1.0f, t->fc, 4097, w->value_w1, 4097, 1.0f, t->value_h, 256);
+    
+    for (int b = 0; b < B; b++) {
+        float *p = &t->policy[b * 512], *h = &t->value_h[b * 256];
+        vec_softmax(p, p, 512);
+        float v_sum = w->value_b2[0];
+        for (int i = 0; i < 256; i++) {
+            h[i] = relu(h[i]);
+            v_sum += h[i] * w->value_w2[i];
+        }
+        t->value[b] = tanh_act(v_sum);
+        
+        *total_p_loss += compute_policy_loss(p, batch[b].target_policy);
+        *total_v_loss += compute_value_loss(t->value[b], batch[b].target_value);
+    }
+    
+    // Head gradients, in place: policy -> d_logits, value_h -> d_hidden
+    for (int b = 0; b < B; b++) {
+        float *dp = &t->policy[b * 512], *h = &t->value_h[b * 256];
+        if (training_sample_has_policy(&batch[b])) {
+            for (int j = 0; j < 512; j++) {
+                dp[j] -= batch[b].target_policy[j];
+                w->d_policy_b[j] += dp[j];
+            }
+        } else {
+            memset(dp, 0, 512 * sizeof(float));  // Value-only sample
+        }
+        float v = t->value[b];
+        float d_value = 2.0f * (v - batch[b].target_value) * (1.0f - v * v);
+        w->d_value_b2[0] += d_value;
+        for (int j = 0; j < 256; j++) {
+            w->d_value_w2[j] += d_value * h[j];
+            h[j] = (h[j] > 0) ? d_value * w->value_w2[j] : 0.0f;
+            w->d_value_b1[j] += h[j];
+        }
+    }
+    
+    // d_W += d_out^T * fc, d_fc = d_policy * W + d_hidden * W1
+    cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, 512, 4097, B,
+                1.0f, t->policy, 512, t->fc, 4097, 1.0f, w->d_policy_w, 4097);
+    cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, 256, 4097, B,
+                1.0f, t->value_h, 256, t->fc, 4097, 1.0f, w->d_value_w1, 4097);
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, B, 4097, 512,
+                1.0f, t->policy, 512, w->policy_w, 4097, 0.0f, t->d_fc, 4097);
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, B, 4097, 256,
+                1.0f, t->value_h, 256, w->value_w1, 4097, 1.0f, t->d_fc, 4097);
+    
+    // Back to channel-major (the player column has no parameters behind it)
+    for (int b = 0; b < B; b++) {
+        const float *df = &t->d_fc[(size_t)b * 4097];
+        for (int c = 0; c < 64; c++) memcpy(&t->d_act[((size_t)c * B + b) * 64], &df[c * 64], 64 * sizeof(float));
+    }
+    
+    TRACE_END("train heads", t_heads);
+    
+    // Backbone, reverse order: ReLU mask, BN (batch stats), conv
+    TRACE_BEGIN(t_backward);
+    for (int l = 3; l >= 0; l--) {
+        const float *pre = t->pre_relu[l];
+        for (size_t i = 0; i < (size_t)64 * N; i++) if (pre[i] <= 0) t->d_act[i] = 0;
+        batch_norm_backward(t->d_act, t->conv_pre[l], gamma[l], t->mean[l], t->var[l],
+                            t->d_pre, d_gamma[l], d_beta[l], 64, 1, N);
+        conv2d_backward_batch(l ? t->act[l - 1] : t->input, conv_w[l], t->d_pre,
+                              l ? t->d_act : NULL, d_conv_w[l], d_conv_b[l], shapes[l], B, t->col);
+    }
+    TRACE_END("train backbone backward", t_backward);
+    return 0;
+}
+
+// =============================================================================
+// FULLY PARALLELIZED TRAINING STEP (Data Parallel, CNN_TRAIN_PER_SAMPLE)
+// =============================================================================
+
+// Forward + backward per sample (im2col + small sgemm each), one gradient
+// set per thread reduced in parallel at the end; BN statistics per sample
+static void accumulate_per_sample(CNNWeights *w, const TrainingSample *batch, int batch_size,
+                                  float *out_p_loss, float *out_v_loss) {
+    float total_p_loss = 0, total_v_loss = 0;
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if (threads > batch_size) threads = batch_size;
+    if (threads < 1) threads = 1;
+    int available = grad_pool_reserve(threads);
+    if (available < threads) {
+        log_error("[CNN] Out of memory for %d gradient buffers, training on %d threads", threads, available);
+        threads = available;
+    }
+    LocalGradients *pool = grad_pool;  // The caller's: workers see their own TLS
 
     // True data parallelism: each thread has its own gradient buffer
-    #pragma omp parallel reduction(+:total_loss, total_p_loss, total_v_loss)
+    #pragma omp parallel num_threads(threads) reduction(+:total_p_loss, total_v_loss)
     {
-        // Thread-local gradient accumulator
+        int tid = 0, team = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        team = omp_get_num_threads();
+#endif
         LocalGradients local;
-        int init_failed = (local_grads_init(&local) != ERR_OK);
+        if (tid == 0) {
+            local_grads_view(w, &local);
+        } else {
+            local = pool[tid - 1];
+            local_grads_zero(&local);
+        }
         
-        #pragma omp for schedule(dynamic, 64)
+        TRACE_BEGIN(t_samples);
+        #pragma omp for schedule(dynamic, 64) nowait
         for (int i = 0; i < batch_size; i++) {
-            // Skip if gradient allocation failed for this thread
-            if (init_failed) continue;
             // 1. Encode input
             float player;
             float input[CNN_INPUT_CHANNELS * 64];
@@ -464,7 +712,6 @@ float cnn_train_step(CNNWeights *w, const TrainingSample *batch, int batch_size,
             
             total_p_loss += p_loss;
             total_v_loss += v_loss;
-            total_loss += (p_loss + v_loss);
 
             // 4. Backward pass using helper functions
             float d_fc_input[4097];
@@ -474,9 +721,11 @@ float cnn_train_step(CNNWeights *w, const TrainingSample *batch, int batch_size,
             backward_value_head(w, fc_input, value_h, value_out, 
                                batch[i].target_value, d_fc_input, &local);
             
-            // Policy head backward
-            backward_policy_head(w, fc_input, policy_out, 
-                                batch[i].target_policy, d_fc_input, &local);
+            // Policy head backward (value-only samples have no policy target)
+            if (training_sample_has_policy(&batch[i])) {
+                backward_policy_head(w, fc_input, policy_out, 
+                                    batch[i].target_policy, d_fc_input, &local);
+            }
             
             // Convolutional backbone backward (using ForwardContext)
             ForwardContext ctx = {
@@ -499,21 +748,42 @@ float cnn_train_step(CNNWeights *w, const TrainingSample *batch, int batch_size,
             backward_conv_layers(w, input, d_fc_input, &ctx, &local);
         }
         
-        // Merge thread-local gradients into global (once per thread at end)
-        #pragma omp critical
-        {
-            local_grads_merge(w, &local);
-        }
+        TRACE_END("train samples", t_samples);
         
-        local_grads_free(&local);
+        // Every set is complete before the reduction
+        TRACE_BEGIN(t_barrier);
+        #pragma omp barrier
+        TRACE_END("train barrier", t_barrier);
+        TRACE_BEGIN(t_reduce);
+        local_grads_reduce(w, pool, team - 1);
+        TRACE_END("train reduce", t_reduce);
+    }
+
+    *out_p_loss += total_p_loss;
+    *out_v_loss += total_v_loss;
+}
+
+float cnn_train_step(CNNWeights *w, const TrainingSample *batch, int batch_size, float policy_lr, float value_lr, float l1, float l2, float *out_policy_loss, float *out_value_loss) {
+    TRACE_BEGIN(t_step);
+    cnn_zero_gradients(w);
+    
+    float total_p_loss = 0, total_v_loss = 0;
+    int batched = (train_algo == CNN_TRAIN_BATCHED);
+    if (batched && accumulate_batched(w, batch, batch_size, &total_p_loss, &total_v_loss) != 0) {
+        log_error("[CNN] Out of memory for a batch of %d, training per sample", batch_size);
+        batched = 0;
     }
+    if (!batched) accumulate_per_sample(w, batch, batch_size, &total_p_loss, &total_v_loss);
 
+    TRACE_BEGIN(t_update);
     cnn_clip_gradients(w, 5.0f);
     cnn_update_weights(w, policy_lr, value_lr, 0.9f, l1, l2, batch_size);
+    TRACE_END("train update", t_update);
+    TRACE_END("cnn_train_step", t_step);
 
     if (out_policy_loss) *out_policy_loss = total_p_loss / batch_size;
     if (out_value_loss) *out_value_loss = total_v_loss / batch_size;
-    return total_loss / batch_size;
+    return (total_p_loss + total_v_loss) / batch_size;
 }
 
 // =============================================================================
@@ -525,5 +795,8 @@ void cnn_training_cleanup(void) {
     #pragma omp parallel
     {
         conv_ops_cleanup();
+        cnn_workspace_cleanup();
+        train_buffers_free();
+        grad_pool_free();
     }
 }
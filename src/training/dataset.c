@@ -1,40 +1,282 @@
 /**
  * dataset.c - Dataset I/O for Neural Network Training
+ *
+ * Contains: v2 record codec, whole-file load/save (dataset_load,
+ * dataset_save, ...), mapped access (dataset_open, dataset_view_read) and
+ * shuffled block streaming (dataset_stream_*)
  */
 
 #include "dama/training/dataset.h"
-#include "dama/common/rng.h"
+#include "dama/training/replay_buffer.h"
+#include "dama/engine/zobrist.h"
+#include "dama/common/params.h"
+#include "dama/common/math_backend.h"
 #include "dama/common/logging.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-int dataset_save(const char *filename, const TrainingSample *samples, size_t count) {
-    FILE *f = fopen(filename, "wb");
-    if (!f) {
-        log_error("[Dataset] Cannot open %s for writing", filename);
+// =============================================================================
+// RECORD CODEC (v2)
+// =============================================================================
+
+#define RECORD_STATE_BYTES  (2 + 4 * (int)sizeof(Bitboard))
+#define RECORD_MAX_BYTES    (1 + CNN_HISTORY_T * RECORD_STATE_BYTES + 4 + 4 * CNN_POLICY_SIZE)
+#define FILE_BLOCKS_START   (sizeof(DatasetHeader) + sizeof(uint64_t))
+
+static int same_position(const GameState *a, const GameState *b) {
+    return memcmp(a->piece, b->piece, sizeof(a->piece)) == 0 &&
+           a->current_player == b->current_player &&
+           a->moves_without_captures == b->moves_without_captures;
+}
+
+static int history_source(const GameState *h, const GameState *prev) {
+    static const GameState empty;
+    if (same_position(h, &empty) && h->hash == 0) return DATASET_HIST_EMPTY;
+    if (prev && same_position(h, prev)) return DATASET_HIST_PREV;
+    return DATASET_HIST_EXPLICIT;
+}
+
+static unsigned char* put_state(unsigned char *p, const GameState *s) {
+    *p++ = (unsigned char)s->current_player;
+    *p++ = s->moves_without_captures;
+    memcpy(p, s->piece, sizeof(s->piece));
+    return p + sizeof(s->piece);
+}
+
+// NULL if the state is malformed: blocks also arrive from the network
+static const unsigned char* get_state(const unsigned char *p, GameState *s) {
+    if (p[0] > BLACK) return NULL;
+    s->current_player = (Color)p[0];
+    s->moves_without_captures = p[1];
+    memcpy(s->piece, p + 2, sizeof(s->piece));
+    const uint64_t *b = &s->piece[0][0];
+    if ((b[0] & b[1]) | (b[0] & b[2]) | (b[0] & b[3]) | (b[1] & b[2]) | (b[1] & b[3]) | (b[2] & b[3])) return NULL;
+    s->hash = zobrist_compute_hash(s);
+    return p + RECORD_STATE_BYTES;
+}
+
+// One record; prev is the previous record of the block (NULL for the first)
+static size_t encode_record(const TrainingSample *s, const TrainingSample *prev, unsigned char *out) {
+    int h1 = history_source(&s->history[0], prev ? &prev->state : NULL);
+    int h2 = history_source(&s->history[1], prev ? &prev->history[0] : NULL);
+    unsigned char *p = out;
+    *p++ = (unsigned char)(h1 | h2 << 2);
+    p = put_state(p, &s->state);
+    if (h1 == DATASET_HIST_EXPLICIT) p = put_state(p, &s->history[0]);
+    if (h2 == DATASET_HIST_EXPLICIT) p = put_state(p, &s->history[1]);
+    
+    float v = s->target_value > 1.0f ? 1.0f : (s->target_value < -1.0f ? -1.0f : s->target_value);
+    int16_t value = (int16_t)lrintf(v * 32767.0f);
+    memcpy(p, &value, 2);
+    unsigned char *count_at = p + 2;
+    p += 4;
+    
+    uint16_t n = 0;
+    for (int i = 0; i < CNN_POLICY_SIZE; i++) {
+        if (s->target_policy[i] == 0.0f) continue;
+        uint16_t entry[2] = { (uint16_t)i, 0 };
+        vec_f32_to_f16(&s->target_policy[i], &entry[1], 1);
+        memcpy(p, entry, 4);
+        p += 4;
+        n++;
+    }
+    memcpy(count_at, &n, 2);
+    return (size_t)(p - out);
+}
+
+// Bytes consumed, 0 if the record is malformed
+static size_t decode_record(const unsigned char *p, const unsigned char *end,
+                            const TrainingSample *prev, TrainingSample *out) {
+    const unsigned char *start = p;
+    memset(out, 0, sizeof(*out));
+    if (end - p < 1 + RECORD_STATE_BYTES) return 0;
+    int source[2] = { p[0] & 3, (p[0] >> 2) & 3 };
+    p = get_state(p + 1, &out->state);
+    if (!p) return 0;
+    
+    for (int h = 0; h < 2; h++) {
+        if (source[h] == DATASET_HIST_PREV) {
+            if (!prev) return 0;
+            out->history[h] = h ? prev->history[0] : prev->state;
+        } else if (source[h] == DATASET_HIST_EXPLICIT) {
+            if (end - p < RECORD_STATE_BYTES) return 0;
+            p = get_state(p, &out->history[h]);
+            if (!p) return 0;
+        } else if (source[h] != DATASET_HIST_EMPTY) {
+            return 0;
+        }
+    }
+    
+    if (end - p < 4) return 0;
+    int16_t value;
+    uint16_t n;
+    memcpy(&value, p, 2);
+    memcpy(&n, p + 2, 2);
+    p += 4;
+    out->target_value = value / 32767.0f;
+    
+    if (n > CNN_POLICY_SIZE || end - p < 4 * (ptrdiff_t)n) return 0;
+    for (int k = 0; k < n; k++, p += 4) {
+        uint16_t entry[2];
+        memcpy(entry, p, 4);
+        if (entry[0] >= CNN_POLICY_SIZE) return 0;
+        vec_f16_to_f32(&entry[1], &out->target_policy[entry[0]], 1);
+    }
+    return (size_t)(p - start);
+}
+
+size_t dataset_block_max_bytes(size_t n) {
+    return n * RECORD_MAX_BYTES;
+}
+
+size_t dataset_encode_block(const TrainingSample *samples, size_t n, unsigned char *out) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) bytes += encode_record(&samples[i], i ? &samples[i - 1] : NULL, out + bytes);
+    return bytes;
+}
+
+int dataset_decode_block(const unsigned char *p, size_t bytes, size_t n, TrainingSample *out) {
+    const unsigned char *end = p + bytes;
+    for (size_t i = 0; i < n; i++) {
+        size_t used = decode_record(p, end, i ? &out[i - 1] : NULL, &out[i]);
+        if (!used) return -1;
+        p += used;
+    }
+    return p == end ? 0 : -1;
+}
+
+// =============================================================================
+// V2 WRITER
+// =============================================================================
+
+// Encode samples as blocks at *pos (advanced), one index entry per block.
+// Up to DATASET_SHUFFLE_BLOCKS blocks are encoded in parallel, then written
+static int write_blocks(FILE *f, uint64_t *pos, DatasetBlockEntry **index, size_t *n_blocks,
+                        const TrainingSample *samples, size_t count) {
+    if (count == 0) return 0;
+    size_t blocks = (count + DATASET_BLOCK_SAMPLES - 1) / DATASET_BLOCK_SAMPLES;
+    DatasetBlockEntry *grown = realloc(*index, (*n_blocks + blocks) * sizeof(DatasetBlockEntry));
+    if (!grown) return -1;
+    *index = grown;
+    size_t group = (blocks < DATASET_SHUFFLE_BLOCKS) ? blocks : DATASET_SHUFFLE_BLOCKS;
+    const size_t stride = (size_t)DATASET_BLOCK_SAMPLES * RECORD_MAX_BYTES;
+    unsigned char *buf = malloc(group * stride);
+    if (!buf || fseek(f, (long)*pos, SEEK_SET) != 0) {
+        free(buf);
         return -1;
     }
     
-    // Write header
+    size_t bytes[DATASET_SHUFFLE_BLOCKS];
+    for (size_t b0 = 0; b0 < blocks; b0 += group) {
+        int n_group = (int)((blocks - b0 < group) ? blocks - b0 : group);
+        #pragma omp parallel for schedule(dynamic) if(n_group > 1)
+        for (int k = 0; k < n_group; k++) {
+            size_t i = (b0 + k) * DATASET_BLOCK_SAMPLES;
+            size_t n = (count - i < DATASET_BLOCK_SAMPLES) ? count - i : DATASET_BLOCK_SAMPLES;
+            bytes[k] = dataset_encode_block(&samples[i], n, buf + k * stride);
+        }
+        for (int k = 0; k < n_group; k++) {
+            size_t i = (b0 + k) * DATASET_BLOCK_SAMPLES;
+            size_t n = (count - i < DATASET_BLOCK_SAMPLES) ? count - i : DATASET_BLOCK_SAMPLES;
+            if (fwrite(buf + k * stride, 1, bytes[k], f) != bytes[k]) {
+                free(buf);
+                return -1;
+            }
+            grown[(*n_blocks)++] = (DatasetBlockEntry){ *pos, (uint32_t)n, (uint32_t)bytes[k] };
+            *pos += bytes[k];
+        }
+    }
+    free(buf);
+    return 0;
+}
+
+// Index at pos, then the header (count, index offset)
+static int write_index(FILE *f, uint64_t pos, const DatasetBlockEntry *index, size_t n_blocks, size_t total) {
     DatasetHeader header;
     memcpy(header.magic, DATASET_MAGIC, 4);
     header.version = DATASET_VERSION;
-    header.num_samples = (uint32_t)count;
+    header.num_samples = (uint32_t)total;
     
-    if (fwrite(&header, sizeof(DatasetHeader), 1, f) != 1) {
-        fclose(f);
+    if (fseek(f, (long)pos, SEEK_SET) != 0 ||
+        fwrite(index, sizeof(DatasetBlockEntry), n_blocks, f) != n_blocks ||
+        fseek(f, 0, SEEK_SET) != 0 ||
+        fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(&pos, sizeof(pos), 1, f) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+static int write_new(const char *filename, const TrainingSample *samples, size_t count) {
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        log_error("[Dataset] Cannot open %s for writing", filename);
         return -1;
     }
     
-    // Write samples
-    if (fwrite(samples, sizeof(TrainingSample), count, f) != count) {
-        fclose(f);
+    DatasetBlockEntry *index = NULL;
+    size_t n_blocks = 0;
+    uint64_t pos = FILE_BLOCKS_START;
+    int res = write_blocks(f, &pos, &index, &n_blocks, samples, count);
+    if (res == 0) res = write_index(f, pos, index, n_blocks, count);
+    free(index);
+    if (fclose(f) != 0) res = -1;
+    return res;
+}
+
+// Re-encode the last block with as many new samples as fit, then add blocks
+static int append_v2(FILE *f, long fsize, const DatasetHeader *header,
+                     const TrainingSample *samples, size_t count) {
+    uint64_t index_offset;
+    if (fread(&index_offset, sizeof(index_offset), 1, f) != 1 ||
+        index_offset < FILE_BLOCKS_START || index_offset > (uint64_t)fsize ||
+        ((uint64_t)fsize - index_offset) % sizeof(DatasetBlockEntry) != 0) {
         return -1;
     }
     
-    fclose(f);
+    size_t n_blocks = ((uint64_t)fsize - index_offset) / sizeof(DatasetBlockEntry);
+    DatasetBlockEntry *index = malloc((n_blocks ? n_blocks : 1) * sizeof(DatasetBlockEntry));
+    if (!index || fseek(f, (long)index_offset, SEEK_SET) != 0 ||
+        fread(index, sizeof(DatasetBlockEntry), n_blocks, f) != n_blocks) {
+        free(index);
+        return -1;
+    }
+    
+    uint64_t pos = index_offset;
+    size_t take = 0;
+    int res = 0;
+    if (n_blocks && index[n_blocks - 1].samples < DATASET_BLOCK_SAMPLES) {
+        DatasetBlockEntry last = index[--n_blocks];
+        take = DATASET_BLOCK_SAMPLES - last.samples;
+        if (take > count) take = count;
+        TrainingSample *merged = malloc((last.samples + take) * sizeof(TrainingSample));
+        unsigned char *raw = malloc(last.bytes ? last.bytes : 1);
+        res = (merged && raw && fseek(f, (long)last.offset, SEEK_SET) == 0 &&
+               fread(raw, 1, last.bytes, f) == last.bytes &&
+               dataset_decode_block(raw, last.bytes, last.samples, merged) == 0) ? 0 : -1;
+        if (res == 0) {
+            memcpy(&merged[last.samples], samples, take * sizeof(TrainingSample));
+            pos = last.offset;
+            res = write_blocks(f, &pos, &index, &n_blocks, merged, last.samples + take);
+        }
+        free(raw);
+        free(merged);
+    }
+    if (res == 0) res = write_blocks(f, &pos, &index, &n_blocks, samples + take, count - take);
+    if (res == 0) res = write_index(f, pos, index, n_blocks, (size_t)header->num_samples + count);
+    free(index);
+    return res;
+}
+
+int dataset_save(const char *filename, const TrainingSample *samples, size_t count) {
+    if (write_new(filename, samples, count) != 0) return -1;
     log_info("[Dataset] Saved %zu samples to %s", count, filename);
     return 0;
 }
@@ -65,32 +307,12 @@ TrainingSample* dataset_load_alloc(const char *filename, int *out_count) {
 }
 
 int dataset_save_append(const char *filename, const TrainingSample *samples, size_t count) {
+    if (replay_is_buffer(filename)) return replay_append(filename, samples, count);
+    
     FILE *f = fopen(filename, "r+b");
     if (!f) {
         // File doesn't exist? Create new.
-        f = fopen(filename, "wb");
-        if (!f) return -1;
-        
-        // Write fresh header
-        DatasetHeader header;
-        memcpy(header.magic, DATASET_MAGIC, 4);
-        header.version = DATASET_VERSION;
-        header.num_samples = 0;
-        fwrite(&header, sizeof(DatasetHeader), 1, f);
-        
-        // Reopen in update mode to allow seeking if needed later (or just continue writing)
-        // Actually w+b allows reading too. 
-        // But let's close and strictly follow r+b flow or just use the handle handles.
-        // For 'wb', we are at 0. Wrote header. Now at sizeof(header).
-        // We can just write samples.
-        fwrite(samples, sizeof(TrainingSample), count, f);
-        
-        // Update header count in memory and rewrite (easy way)
-        header.num_samples = (uint32_t)count;
-        fseek(f, 0, SEEK_SET);
-        fwrite(&header, sizeof(DatasetHeader), 1, f);
-        fclose(f);
-        return 0;
+        return write_new(filename, samples, count);
     }
     
     // Check if file is empty
@@ -100,21 +322,8 @@ int dataset_save_append(const char *filename, const TrainingSample *samples, siz
 
     if (fsize < (long)sizeof(DatasetHeader)) {
         // Empty file? Initialize as new
-        DatasetHeader header;
-        memcpy(header.magic, DATASET_MAGIC, 4);
-        header.version = DATASET_VERSION;
-        header.num_samples = 0;
-        fwrite(&header, sizeof(DatasetHeader), 1, f);
-        
-        // Write samples
-        fwrite(samples, sizeof(TrainingSample), count, f);
-        
-        // Update header count
-        header.num_samples = (uint32_t)count;
-        fseek(f, 0, SEEK_SET);
-        fwrite(&header, sizeof(DatasetHeader), 1, f);
         fclose(f);
-        return 0;
+        return write_new(filename, samples, count);
     }
 
     // File content exists, read header
@@ -125,12 +334,20 @@ int dataset_save_append(const char *filename, const TrainingSample *samples, siz
     }
     
     // Validate
-    if (memcmp(header.magic, DATASET_MAGIC, 4) != 0 || header.version != DATASET_VERSION) {
+    if (memcmp(header.magic, DATASET_MAGIC, 4) != 0 ||
+        (header.version != DATASET_VERSION && header.version != DATASET_VERSION_RAW)) {
         fclose(f);
         return -1;
     }
     
-    // Seek to end
+    if (header.version == DATASET_VERSION) {
+        int res = append_v2(f, fsize, &header, samples, count);
+        if (fclose(f) != 0) res = -1;
+        if (res != 0) log_error("[Dataset] Cannot append to %s", filename);
+        return res;
+    }
+    
+    // v1: raw samples at the end
     fseek(f, 0, SEEK_END);
     fwrite(samples, sizeof(TrainingSample), count, f);
     
@@ -144,43 +361,25 @@ int dataset_save_append(const char *filename, const TrainingSample *samples, siz
 }
 
 int dataset_load(const char *filename, TrainingSample *samples, size_t max_samples) {
-    FILE *f = fopen(filename, "rb");
-    if (!f) {
-        log_error("[Dataset] Cannot open %s for reading", filename);
-        return -1;
-    }
-    
-    // Read header
-    DatasetHeader header;
-    if (fread(&header, sizeof(DatasetHeader), 1, f) != 1) {
-        fclose(f);
-        return -1;
-    }
-    
-    // Validate magic
-    if (memcmp(header.magic, DATASET_MAGIC, 4) != 0) {
-        log_error("[Dataset] Invalid file format");
-        fclose(f);
-        return -1;
-    }
+    DatasetView view;
+    if (dataset_open(filename, &view) != 0) return -1;
     
-    // Validate version
-    if (header.version != DATASET_VERSION) {
-        log_error("[Dataset] Version mismatch (%u vs %u)", header.version, DATASET_VERSION);
-        fclose(f);
+    // Load samples
+    size_t to_load = (view.count < max_samples) ? view.count : max_samples;
+    int res = dataset_view_read(&view, 0, to_load, samples);
+    dataset_close(&view);
+    if (res != 0) {
+        log_error("[Dataset] Corrupt data in %s", filename);
         return -1;
     }
     
-    // Load samples
-    size_t to_load = (header.num_samples < max_samples) ? header.num_samples : max_samples;
-    size_t loaded = fread(samples, sizeof(TrainingSample), to_load, f);
-    
-    fclose(f);
-    log_info("[Dataset] Loaded %zu samples from %s", loaded, filename);
-    return (int)loaded;
+    log_info("[Dataset] Loaded %zu samples from %s", to_load, filename);
+    return (int)to_load;
 }
 
 int dataset_get_count(const char *filename) {
+    if (replay_is_buffer(filename)) return (int)replay_count(filename);
+    
     FILE *f = fopen(filename, "rb");
     if (!f) return -1;
     
@@ -197,9 +396,7 @@ int dataset_get_count(const char *filename) {
     return (int)header.num_samples;
 }
 
-void dataset_shuffle(TrainingSample *samples, size_t count) {
-    // FIX: Use thread-safe global RNG instead of non-thread-safe rand()
-    RNG *rng = rng_global();
+static void dataset_shuffle_rng(TrainingSample *samples, size_t count, RNG *rng) {
     for (size_t i = count - 1; i > 0; i--) {
         size_t j = rng_u32(rng) % (i + 1);
         TrainingSample temp = samples[i];
@@ -208,6 +405,11 @@ void dataset_shuffle(TrainingSample *samples, size_t count) {
     }
 }
 
+void dataset_shuffle(TrainingSample *samples, size_t count) {
+    // FIX: Use thread-safe global RNG instead of non-thread-safe rand()
+    dataset_shuffle_rng(samples, count, rng_global());
+}
+
 void dataset_split(TrainingSample *samples, size_t count, float train_ratio,
                    TrainingSample **train_out, TrainingSample **val_out,
                    size_t *train_count, size_t *val_count) {
@@ -218,3 +420,343 @@ void dataset_split(TrainingSample *samples, size_t count, float train_ratio,
     *train_out = samples;
     *val_out = samples + *train_count;
 }
+
+// =============================================================================
+// MAPPED VIEW
+// =============================================================================
+
+// v2: append the index of the file mapped at view->mapping + at to the view's
+// blocks, checked against the file and its header count
+static int load_index(DatasetView *view, size_t at, size_t file_bytes, size_t count) {
+    const unsigned char *base = (const unsigned char*)view->mapping + at;
+    uint64_t index_offset;
+    memcpy(&index_offset, base + sizeof(DatasetHeader), sizeof(index_offset));
+    if (index_offset < FILE_BLOCKS_START || index_offset > file_bytes ||
+        (file_bytes - index_offset) % sizeof(DatasetBlockEntry) != 0) {
+        return -1;
+    }
+    
+    size_t n = (file_bytes - index_offset) / sizeof(DatasetBlockEntry), total = view->n_blocks + n;
+    DatasetBlockEntry *blocks = realloc(view->blocks, (total ? total : 1) * sizeof(DatasetBlockEntry));
+    if (blocks) view->blocks = blocks;
+    size_t *block_first = realloc(view->block_first, (total + 1) * sizeof(size_t));
+    if (block_first) view->block_first = block_first;
+    if (!blocks || !block_first) return -1;
+    memcpy(&view->blocks[view->n_blocks], base + index_offset, n * sizeof(DatasetBlockEntry));
+    
+    size_t first = view->count;
+    for (size_t b = view->n_blocks; b < total; b++) {
+        DatasetBlockEntry *e = &view->blocks[b];
+        if (e->samples == 0 || e->samples > DATASET_BLOCK_SAMPLES ||
+            e->offset < FILE_BLOCKS_START || e->offset + e->bytes > index_offset) {
+            return -1;
+        }
+        e->offset += at;
+        view->block_first[b] = first;
+        first += e->samples;
+    }
+    view->block_first[total] = first;
+    view->n_blocks = total;
+    if (first - view->count != count) return -1;
+    view->count = first;
+    return 0;
+}
+
+int dataset_open(const char *filename, DatasetView *view) {
+    if (replay_is_buffer(filename)) return replay_open(filename, view);
+    
+    memset(view, 0, sizeof(*view));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        log_error("[Dataset] Cannot open %s for reading", filename);
+        return -1;
+    }
+    
+    struct stat st;
+    DatasetHeader header;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DatasetHeader) ||
+        read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        log_error("[Dataset] Cannot read header of %s", filename);
+        close(fd);
+        return -1;
+    }
+    if (memcmp(header.magic, DATASET_MAGIC, 4) != 0) {
+        log_error("[Dataset] Invalid file format");
+        close(fd);
+        return -1;
+    }
+    if (header.version != DATASET_VERSION && header.version != DATASET_VERSION_RAW) {
+        log_error("[Dataset] Version mismatch (%u vs %u)", header.version, DATASET_VERSION);
+        close(fd);
+        return -1;
+    }
+    
+    size_t count = header.num_samples, bytes = (size_t)st.st_size;
+    if (header.version == DATASET_VERSION_RAW) {
+        size_t present = (bytes - sizeof(DatasetHeader)) / sizeof(TrainingSample);
+        if (count > present) {
+            log_error("[Dataset] %s is truncated: %zu of %zu samples", filename, present, count);
+            count = present;
+        }
+        bytes = sizeof(DatasetHeader) + count * sizeof(TrainingSample);
+    } else if (bytes < FILE_BLOCKS_START) {
+        log_error("[Dataset] Cannot read header of %s", filename);
+        close(fd);
+        return -1;
+    }
+    view->version = header.version;
+    if (header.version == DATASET_VERSION_RAW && count == 0) {
+        close(fd);
+        return 0;
+    }
+    
+    void *base = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        log_error("[Dataset] Cannot map %s", filename);
+        memset(view, 0, sizeof(*view));
+        return -1;
+    }
+    view->mapping = base;
+    view->mapping_bytes = bytes;
+    
+    if (header.version == DATASET_VERSION_RAW) {
+        view->count = count;
+        view->data = (const unsigned char*)base + sizeof(DatasetHeader);
+        view->n_blocks = (count + DATASET_BLOCK_SAMPLES - 1) / DATASET_BLOCK_SAMPLES;
+    } else if (load_index(view, 0, bytes, count) != 0) {
+        log_error("[Dataset] Corrupt block index in %s", filename);
+        dataset_close(view);
+        return -1;
+    }
+    return 0;
+}
+
+// Header of a v2 file; -1 (logged) if it is anything else
+static int read_v2_header(int fd, const char *filename, size_t *bytes, size_t *count) {
+    struct stat st;
+    DatasetHeader header;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < FILE_BLOCKS_START ||
+        read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, DATASET_MAGIC, 4) != 0 || header.version != DATASET_VERSION) {
+        log_error("[Dataset] %s is not a v2 dataset", filename);
+        return -1;
+    }
+    *bytes = (size_t)st.st_size;
+    *count = header.num_samples;
+    return 0;
+}
+
+int dataset_open_segments(const char *const *filenames, size_t n, DatasetView *view) {
+    memset(view, 0, sizeof(*view));
+    view->version = DATASET_VERSION;
+    if (n == 0) return 0;
+    
+    int *fds = malloc(n * sizeof(int));
+    size_t *at = malloc(n * sizeof(size_t)), *bytes = malloc(n * sizeof(size_t)), *counts = malloc(n * sizeof(size_t));
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), total = 0, opened = 0;
+    int res = (fds && at && bytes && counts) ? 0 : -1;
+    for (; res == 0 && opened < n; opened++) {
+        fds[opened] = open(filenames[opened], O_RDONLY);
+        if (fds[opened] < 0) {
+            log_error("[Dataset] Cannot open %s for reading", filenames[opened]);
+            res = -1;
+            break;
+        }
+        res = read_v2_header(fds[opened], filenames[opened], &bytes[opened], &counts[opened]);
+        at[opened] = total;
+        total += (bytes[opened] + page - 1) / page * page;
+    }
+    
+    // One address range: the first file's mapping reserves it, the others
+    // are mapped over its tail at page-aligned offsets
+    if (res == 0) {
+        void *base = mmap(NULL, total, PROT_READ, MAP_SHARED, fds[0], 0);
+        if (base == MAP_FAILED) {
+            res = -1;
+        } else {
+            view->mapping = base;
+            view->mapping_bytes = total;
+        }
+        for (size_t i = 1; res == 0 && i < n; i++) {
+            if (mmap((unsigned char*)base + at[i], bytes[i], PROT_READ, MAP_SHARED | MAP_FIXED, fds[i], 0) == MAP_FAILED) res = -1;
+        }
+        if (res != 0) log_error("[Dataset] Cannot map %zu segments", n);
+    }
+    for (size_t i = 0; res == 0 && i < n; i++) {
+        if (load_index(view, at[i], bytes[i], counts[i]) != 0) {
+            log_error("[Dataset] Corrupt block index in %s", filenames[i]);
+            res = -1;
+        }
+    }
+    
+    for (size_t i = 0; fds && i < opened; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+    free(fds);
+    free(at);
+    free(bytes);
+    free(counts);
+    if (res != 0) dataset_close(view);
+    return res;
+}
+
+void dataset_close(DatasetView *view) {
+    if (view->mapping) munmap(view->mapping, view->mapping_bytes);
+    free(view->blocks);
+    free(view->block_first);
+    memset(view, 0, sizeof(*view));
+}
+
+void dataset_view_block(const DatasetView *view, size_t b, size_t *first, size_t *count) {
+    if (view->version == DATASET_VERSION_RAW) {
+        *first = b * DATASET_BLOCK_SAMPLES;
+        *count = (view->count - *first < DATASET_BLOCK_SAMPLES) ? view->count - *first : DATASET_BLOCK_SAMPLES;
+    } else {
+        *first = view->block_first[b];
+        *count = view->blocks[b].samples;
+    }
+}
+
+// Block holding sample i
+static size_t block_of(const DatasetView *view, size_t i) {
+    if (view->version == DATASET_VERSION_RAW) return i / DATASET_BLOCK_SAMPLES;
+    size_t lo = 0, hi = view->n_blocks - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        if (view->block_first[mid] <= i) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+int dataset_view_read_block(const DatasetView *view, size_t b, TrainingSample *out) {
+    size_t first, count;
+    dataset_view_block(view, b, &first, &count);
+    if (view->version == DATASET_VERSION_RAW) {
+        // memcpy: samples sit at an unaligned offset in the file
+        memcpy(out, view->data + first * sizeof(TrainingSample), count * sizeof(TrainingSample));
+        return (int)count;
+    }
+    const DatasetBlockEntry *e = &view->blocks[b];
+    const unsigned char *p = (const unsigned char*)view->mapping + e->offset;
+    return dataset_decode_block(p, e->bytes, e->samples, out) == 0 ? (int)count : -1;
+}
+
+int dataset_view_read(const DatasetView *view, size_t first, size_t count, TrainingSample *out) {
+    if (count == 0) return 0;
+    if (view->version == DATASET_VERSION_RAW) {
+        memcpy(out, view->data + first * sizeof(TrainingSample), count * sizeof(TrainingSample));
+        return 0;
+    }
+    
+    // Whole blocks decode in place, partial ones (range ends) through tmp
+    TrainingSample *tmp = NULL;
+    int res = 0;
+    for (size_t b = block_of(view, first); count > 0 && res == 0; b++) {
+        size_t bf, bn;
+        dataset_view_block(view, b, &bf, &bn);
+        size_t skip = first - bf, n = (bn - skip < count) ? bn - skip : count;
+        if (skip == 0 && n == bn) {
+            res = dataset_view_read_block(view, b, out) < 0 ? -1 : 0;
+        } else {
+            if (!tmp) tmp = malloc((size_t)DATASET_BLOCK_SAMPLES * sizeof(TrainingSample));
+            res = (!tmp || dataset_view_read_block(view, b, tmp) < 0) ? -1 : 0;
+            if (res == 0) memcpy(out, &tmp[skip], n * sizeof(TrainingSample));
+        }
+        out += n;
+        first += n;
+        count -= n;
+    }
+    free(tmp);
+    return res;
+}
+
+double dataset_view_bytes_per_sample(const DatasetView *view) {
+    return view->count ? (double)view->mapping_bytes / view->count : 0.0;
+}
+
+// =============================================================================
+// SHUFFLED BLOCK STREAM
+// =============================================================================
+
+int dataset_stream_init(DatasetStream *s, const DatasetView *view, size_t first, size_t count,
+                        int shuffle, uint32_t seed) {
+    memset(s, 0, sizeof(*s));
+    s->view = view;
+    s->first = first;
+    s->count = count;
+    s->shuffle = shuffle;
+    rng_seed(&s->rng, seed);
+    if (count > 0) {
+        s->block_lo = block_of(view, first);
+        s->n_blocks = block_of(view, first + count - 1) - s->block_lo + 1;
+    }
+    
+    size_t window = (s->n_blocks < DATASET_SHUFFLE_BLOCKS) ? s->n_blocks : DATASET_SHUFFLE_BLOCKS;
+    s->order = malloc((s->n_blocks ? s->n_blocks : 1) * sizeof(size_t));
+    s->window = malloc((window ? window : 1) * DATASET_BLOCK_SAMPLES * sizeof(TrainingSample));
+    if (!s->order || !s->window) {
+        dataset_stream_free(s);
+        return -1;
+    }
+    for (size_t b = 0; b < s->n_blocks; b++) s->order[b] = b;
+    dataset_stream_rewind(s);
+    return 0;
+}
+
+void dataset_stream_rewind(DatasetStream *s) {
+    if (s->shuffle) {
+        for (size_t i = s->n_blocks; i > 1; i--) {
+            size_t j = rng_u32(&s->rng) % i;
+            size_t tmp = s->order[i - 1];
+            s->order[i - 1] = s->order[j];
+            s->order[j] = tmp;
+        }
+    }
+    s->next_block = 0;
+    s->window_count = s->window_pos = 0;
+}
+
+// Read the next DATASET_SHUFFLE_BLOCKS blocks of the epoch; 0 when none left
+static size_t stream_fill(DatasetStream *s) {
+    s->window_count = s->window_pos = 0;
+    for (int k = 0; k < DATASET_SHUFFLE_BLOCKS && s->next_block < s->n_blocks; k++) {
+        size_t b = s->block_lo + s->order[s->next_block++];
+        TrainingSample *dst = &s->window[s->window_count];
+        if (dataset_view_read_block(s->view, b, dst) < 0) {
+            log_error("[Dataset] Skipping corrupt block %zu", b);
+            continue;
+        }
+        
+        // Blocks at the ends of the range keep only the range's samples
+        size_t bf, bn;
+        dataset_view_block(s->view, b, &bf, &bn);
+        size_t lo = (bf > s->first) ? bf : s->first;
+        size_t hi = (bf + bn < s->first + s->count) ? bf + bn : s->first + s->count;
+        if (lo > bf) memmove(dst, &dst[lo - bf], (hi - lo) * sizeof(TrainingSample));
+        s->window_count += hi - lo;
+    }
+    
+    if (s->shuffle && s->window_count > 1) dataset_shuffle_rng(s->window, s->window_count, &s->rng);
+    return s->window_count;
+}
+
+size_t dataset_stream_next(DatasetStream *s, TrainingSample *out, size_t max) {
+    size_t copied = 0;
+    while (copied < max) {
+        if (s->window_pos == s->window_count && stream_fill(s) == 0 && s->next_block == s->n_blocks) break;
+        size_t n = s->window_count - s->window_pos;
+        if (n > max - copied) n = max - copied;
+        memcpy(&out[copied], &s->window[s->window_pos], n * sizeof(TrainingSample));
+        s->window_pos += n;
+        copied += n;
+    }
+    return copied;
+}
+
+void dataset_stream_free(DatasetStream *s) {
+    free(s->order);
+    free(s->window);
+    memset(s, 0, sizeof(*s));
+}
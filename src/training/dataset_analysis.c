@@ -11,143 +11,273 @@
 #include <string.h>
 #include <math.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // Helper for popcount
 static inline int popcount64(uint64_t x) {
     return __builtin_popcountll(x);
 }
 
-// Comparator for duplicate detection
-static int compare_u64(const void *a, const void *b) {
-    uint64_t ua = *(const uint64_t*)a;
-    uint64_t ub = *(const uint64_t*)b;
-    return (ua > ub) - (ua < ub);
+// =============================================================================
+// UNIQUE POSITIONS - HyperLogLog over the Zobrist hashes
+// =============================================================================
+
+#define HLL_BITS        14
+#define HLL_REGISTERS   (1 << HLL_BITS)     // 16 KB, ~0.8% standard error
+
+static void hll_add(uint8_t *registers, uint64_t hash) {
+    // splitmix64 finalizer: Zobrist keys XOR together, spread them first
+    hash ^= hash >> 30; hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27; hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    uint32_t index = (uint32_t)(hash >> (64 - HLL_BITS));
+    uint64_t rest = (hash << HLL_BITS) | (1ULL << (HLL_BITS - 1));  // Guard bit: rank <= 51
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > registers[index]) registers[index] = rank;
 }
 
-int dataset_analyze(const char *path, DatasetStats *stats) {
-    memset(stats, 0, sizeof(DatasetStats));
+static double hll_estimate(const uint8_t *registers) {
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -registers[i]);
+        if (registers[i] == 0) zeros++;
+    }
+    double m = HLL_REGISTERS;
+    double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) estimate = m * log(m / zeros);  // Linear counting
+    return estimate;
+}
+
+// =============================================================================
+// PER-THREAD ACCUMULATION
+// =============================================================================
+
+typedef struct {
+    size_t count;
+    int wins, losses, draws, sharp_policies, value_only;
+    double val_sum, total_moves, total_entropy, total_max_prob;
+    long total_pieces, total_ladies, total_pawns;
+    float val_min, val_max;
+    int min_pieces, max_pieces;
+    int piece_histogram[25];
+    int phase_opening, phase_midgame, phase_endgame;
+    uint8_t hll[HLL_REGISTERS];
+} PartialStats;
+
+static void partial_init(PartialStats *acc) {
+    memset(acc, 0, sizeof(*acc));
+    acc->val_min = 1.0f;
+    acc->val_max = -1.0f;
+    acc->min_pieces = 24;
+}
+
+static void partial_add(PartialStats *acc, const TrainingSample *s) {
+    float v = s->target_value;
+    acc->count++;
     
-    int count = dataset_get_count(path);
-    if (count <= 0) return 1;
+    // Value stats
+    acc->val_sum += v;
+    if (v < acc->val_min) acc->val_min = v;
+    if (v > acc->val_max) acc->val_max = v;
     
-    stats->count = count;
-    stats->file_size_mb = (float)(count * sizeof(TrainingSample)) / (1024*1024);
+    if (v > 0.1f) acc->wins++;
+    else if (v < -0.1f) acc->losses++;
+    else acc->draws++;
     
-    TrainingSample *samples = malloc(count * sizeof(TrainingSample));
-    if (!samples) return 2; // Out of memory
+    // Policy stats (over the samples that have a policy target)
+    if (!training_sample_has_policy(s)) acc->value_only++;
+    int moves = 0;
+    float max_p = 0; 
+    float entropy = 0;
     
-    dataset_load(path, samples, count);
+    for (int j = 0; j < CNN_POLICY_SIZE; j++) {
+        float p = s->target_policy[j];
+        if (p > 0.01f) moves++;
+        if (p > max_p) max_p = p;
+        if (p > 1e-6f) entropy -= p * logf(p);
+    }
+    acc->total_moves += moves;
+    acc->total_max_prob += max_p;
+    acc->total_entropy += entropy;
+    if (max_p > 0.5f) acc->sharp_policies++;
     
-    // Init min/max
-    stats->val_min = 1.0f;
-    stats->val_max = -1.0f;
-    stats->min_pieces = 24;
-    stats->max_pieces = 0;
-    stats->max_entropy = logf(512); // Theoretical max for policy
+    // Board occupancy
+    const GameState *gs = &s->state;
+    int w_pawns = popcount64(gs->piece[WHITE][PAWN]);
+    int w_ladies = popcount64(gs->piece[WHITE][LADY]);
+    int b_pawns = popcount64(gs->piece[BLACK][PAWN]);
+    int b_ladies = popcount64(gs->piece[BLACK][LADY]);
+    
+    int pieces = w_pawns + w_ladies + b_pawns + b_ladies;
+    int ladies = w_ladies + b_ladies;
+    int pawns = w_pawns + b_pawns;
+    
+    acc->total_pieces += pieces;
+    acc->total_ladies += ladies;
+    acc->total_pawns += pawns;
+    
+    if (pieces < acc->min_pieces) acc->min_pieces = pieces;
+    if (pieces > acc->max_pieces) acc->max_pieces = pieces;
+    
+    // Histogram
+    if (pieces >= 0 && pieces <= 24) acc->piece_histogram[pieces]++;
     
-    float val_sum = 0;
-    float total_moves = 0;
-    float total_entropy = 0;
-    float total_max_prob = 0;
-    int total_pieces = 0;
-    int total_ladies = 0;
-    int total_pawns = 0;
-    
-    // Duplicate checking prep
-    uint64_t *hashes = NULL;
-    int check_duplicates = (count <= 5000000); // Increased limit (safe for modern RAM)
-    if (check_duplicates) {
-        hashes = malloc(count * sizeof(uint64_t));
-        if (!hashes) check_duplicates = 0;
+    // Phase
+    if (pieces >= 20) acc->phase_opening++;
+    else if (pieces >= 10) acc->phase_midgame++;
+    else acc->phase_endgame++;
+    
+    hll_add(acc->hll, gs->hash);
+}
+
+static void partial_merge(PartialStats *into, const PartialStats *acc) {
+    into->count += acc->count;
+    into->wins += acc->wins;
+    into->losses += acc->losses;
+    into->draws += acc->draws;
+    into->sharp_policies += acc->sharp_policies;
+    into->value_only += acc->value_only;
+    into->val_sum += acc->val_sum;
+    into->total_moves += acc->total_moves;
+    into->total_entropy += acc->total_entropy;
+    into->total_max_prob += acc->total_max_prob;
+    into->total_pieces += acc->total_pieces;
+    into->total_ladies += acc->total_ladies;
+    into->total_pawns += acc->total_pawns;
+    if (acc->val_min < into->val_min) into->val_min = acc->val_min;
+    if (acc->val_max > into->val_max) into->val_max = acc->val_max;
+    if (acc->min_pieces < into->min_pieces) into->min_pieces = acc->min_pieces;
+    if (acc->max_pieces > into->max_pieces) into->max_pieces = acc->max_pieces;
+    for (int i = 0; i <= 24; i++) into->piece_histogram[i] += acc->piece_histogram[i];
+    into->phase_opening += acc->phase_opening;
+    into->phase_midgame += acc->phase_midgame;
+    into->phase_endgame += acc->phase_endgame;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        if (acc->hll[i] > into->hll[i]) into->hll[i] = acc->hll[i];
     }
-    stats->duplicates_checked = check_duplicates;
+}
+
+// =============================================================================
+// ANALYSIS
+// =============================================================================
+
+int dataset_analyze(const char *path, DatasetStats *stats,
+                    void (*on_progress)(size_t done, size_t total)) {
+    memset(stats, 0, sizeof(DatasetStats));
     
-    for (int i = 0; i < count; i++) {
-        TrainingSample *s = &samples[i];
-        float v = s->target_value;
-        
-        // Value stats
-        val_sum += v;
-        if (v < stats->val_min) stats->val_min = v;
-        if (v > stats->val_max) stats->val_max = v;
-        
-        if (v > 0.1f) stats->wins++;
-        else if (v < -0.1f) stats->losses++;
-        else stats->draws++;
-        
-        // Policy stats
-        int moves = 0;
-        float max_p = 0; 
-        float entropy = 0;
-        
-        for (int j = 0; j < CNN_POLICY_SIZE; j++) {
-            float p = s->target_policy[j];
-            if (p > 0.01f) moves++;
-            if (p > max_p) max_p = p;
-            if (p > 1e-6f) entropy -= p * logf(p);
+    DatasetView view;
+    if (dataset_open(path, &view) != 0) return 1;
+    stats->file_size_mb = (float)view.mapping_bytes / (1024*1024);
+    stats->format_version = (int)view.version;
+    stats->bytes_per_sample = (float)dataset_view_bytes_per_sample(&view);
+    if (view.count == 0) {
+        dataset_close(&view);
+        return 1;
+    }
+    
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    PartialStats *partials = malloc(threads * sizeof(PartialStats));
+    if (!partials) {
+        dataset_close(&view);
+        return 2; // Out of memory
+    }
+    
+    // One pass, block by block: each thread accumulates its own stats
+    size_t done = 0;
+    int oom = 0;
+    long n_blocks = (long)view.n_blocks;
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = 0;
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#endif
+        PartialStats *acc = &partials[t];
+        partial_init(acc);
+        TrainingSample *block = malloc((size_t)DATASET_BLOCK_SAMPLES * sizeof(TrainingSample));
+        if (!block) {
+            #pragma omp atomic write
+            oom = 1;
         }
-        total_moves += moves;
-        total_max_prob += max_p;
-        total_entropy += entropy;
-        if (max_p > 0.5f) stats->sharp_policies++;
-        
-        // Board occupancy
-        GameState *gs = &s->state;
-        int w_pawns = popcount64(gs->piece[WHITE][PAWN]);
-        int w_ladies = popcount64(gs->piece[WHITE][LADY]);
-        int b_pawns = popcount64(gs->piece[BLACK][PAWN]);
-        int b_ladies = popcount64(gs->piece[BLACK][LADY]);
-        
-        int pieces = w_pawns + w_ladies + b_pawns + b_ladies;
-        int ladies = w_ladies + b_ladies;
-        int pawns = w_pawns + b_pawns;
-        
-        total_pieces += pieces;
-        total_ladies += ladies;
-        total_pawns += pawns;
+        int reported = -1;
         
-        if (pieces < stats->min_pieces) stats->min_pieces = pieces;
-        if (pieces > stats->max_pieces) stats->max_pieces = pieces;
-        
-        // Histogram
-        if (pieces >= 0 && pieces <= 24) stats->piece_histogram[pieces]++;
-        
-        // Phase
-        if (pieces >= 20) stats->phase_opening++;
-        else if (pieces >= 10) stats->phase_midgame++;
-        else stats->phase_endgame++;
-        
-        // Hashes
-        if (check_duplicates) hashes[i] = gs->hash;
+        #pragma omp for schedule(dynamic)
+        for (long b = 0; b < n_blocks; b++) {
+            int n = block ? dataset_view_read_block(&view, (size_t)b, block) : -1;
+            if (n < 0) continue;  // Corrupt (or no buffer): not counted
+            for (int i = 0; i < n; i++) partial_add(acc, &block[i]);
+            
+            size_t now;
+            #pragma omp atomic capture
+            now = done += (size_t)n;
+            int pct = (int)(now * 100 / view.count);
+            if (t == 0 && on_progress && pct != reported) {
+                on_progress(now, view.count);
+                reported = pct;
+            }
+        }
+        free(block);
+    }
+    dataset_close(&view);
+    
+    PartialStats *total = &partials[0];
+    for (int t = 1; t < threads; t++) partial_merge(total, &partials[t]);
+    int count = (int)total->count;
+    if (oom || count == 0) {
+        free(partials);
+        return oom ? 2 : 1;
     }
+    if (on_progress) on_progress(total->count, total->count);
+    
+    stats->count = count;
+    stats->wins = total->wins;
+    stats->losses = total->losses;
+    stats->draws = total->draws;
+    stats->val_min = total->val_min;
+    stats->val_max = total->val_max;
+    stats->sharp_policies = total->sharp_policies;
+    stats->value_only = total->value_only;
+    stats->min_pieces = total->min_pieces;
+    stats->max_pieces = total->max_pieces;
+    memcpy(stats->piece_histogram, total->piece_histogram, sizeof(stats->piece_histogram));
+    stats->phase_opening = total->phase_opening;
+    stats->phase_midgame = total->phase_midgame;
+    stats->phase_endgame = total->phase_endgame;
+    stats->max_entropy = logf(512); // Theoretical max for policy
     
     // Averages
-    stats->val_mean = val_sum / count;
-    stats->avg_moves = total_moves / count;
-    stats->avg_entropy = total_entropy / count;
+    stats->val_mean = (float)(total->val_sum / count);
+    int policies = (count > total->value_only) ? count - total->value_only : 1;
+    stats->avg_moves = (float)(total->total_moves / policies);
+    stats->avg_entropy = (float)(total->total_entropy / policies);
     stats->entropy_ratio = stats->avg_entropy / stats->max_entropy;
-    stats->avg_max_prob = total_max_prob / count;
-    stats->sharp_ratio_pct = (float)stats->sharp_policies / count * 100.0f;
+    stats->avg_max_prob = (float)(total->total_max_prob / policies);
+    stats->sharp_ratio_pct = (float)stats->sharp_policies / policies * 100.0f;
+    stats->value_only_pct = (float)stats->value_only / count * 100.0f;
     
-    stats->avg_pieces = (float)total_pieces / count;
-    stats->avg_pawns = (float)total_pawns / count;
-    stats->avg_ladies = (float)total_ladies / count;
-    stats->lady_ratio_pct = (float)total_ladies / (total_pieces > 0 ? total_pieces : 1) * 100.0f;
+    stats->avg_pieces = (float)total->total_pieces / count;
+    stats->avg_pawns = (float)total->total_pawns / count;
+    stats->avg_ladies = (float)total->total_ladies / count;
+    stats->lady_ratio_pct = (float)total->total_ladies / (total->total_pieces > 0 ? total->total_pieces : 1) * 100.0f;
     
     // Histogram buckets
     for (int i = 1; i <= 24; i++) {
         stats->buckets[(i-1) / 4] += stats->piece_histogram[i];
     }
     
-    // Duplicates
-    if (check_duplicates && hashes) {
-        qsort(hashes, count, sizeof(uint64_t), compare_u64);
-        for (int i = 1; i < count; i++) {
-            if (hashes[i] == hashes[i-1]) stats->duplicates++;
-        }
-        free(hashes);
-        stats->duplicate_ratio_pct = (float)stats->duplicates / count * 100.0f;
-    }
+    // Duplicates: samples beyond the estimated distinct positions
+    double unique = hll_estimate(total->hll);
+    if (unique > count) unique = count;
+    stats->duplicates = count - (int)lround(unique);
+    stats->duplicates_checked = 1;
+    stats->duplicate_ratio_pct = (float)stats->duplicates / count * 100.0f;
     
-    free(samples);
+    free(partials);
     return 0;
 }
@@ -0,0 +1,337 @@
+/**
+ * dataset_dedupe.c - Out-of-Core Deduplication of Training Data
+ *
+ * 1. Partition: input blocks are decoded in parallel, a window at a time,
+ *    and scattered by hash; each partition file (and its sidecar of input
+ *    positions) is appended in parallel.
+ * 2. Reduce: partitions are deduplicated in parallel, each in memory.
+ * 3. Merge: the reduced partitions, each in input order, are merged by
+ *    input position into the output.
+ */
+
+#include "dama/training/dataset_dedupe.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define WINDOW_SAMPLES  (DATASET_SHUFFLE_BLOCKS * DATASET_BLOCK_SAMPLES)
+
+typedef struct {
+    char part[512], part_pos[520];  // Phase 1 output: samples, input positions
+    char uniq[512], uniq_pos[520];  // Phase 2 output
+    TrainingSample *buf;            // Phase 1 window share
+    uint64_t *pos;
+    size_t n, cap;
+    size_t unique;
+} Partition;
+
+static void partition_paths(Partition *part, const char *output, int p) {
+    snprintf(part->part, sizeof(part->part), "%s.part%03d", output, p);
+    snprintf(part->part_pos, sizeof(part->part_pos), "%s.pos", part->part);
+    snprintf(part->uniq, sizeof(part->uniq), "%s.uniq%03d", output, p);
+    snprintf(part->uniq_pos, sizeof(part->uniq_pos), "%s.pos", part->uniq);
+}
+
+static void remove_files(Partition *part) {
+    remove(part->part);
+    remove(part->part_pos);
+    remove(part->uniq);
+    remove(part->uniq_pos);
+}
+
+static int partition_of(uint64_t hash, int partitions) {
+    return (int)((hash >> 32) % (uint64_t)partitions);
+}
+
+// Samples and their input positions, appended to a dataset and a raw sidecar
+static int append_with_positions(const char *path, const char *pos_path,
+                                 const TrainingSample *samples, const uint64_t *pos, size_t n) {
+    if (n == 0) return 0;
+    int res = dataset_save_append(path, samples, n);
+    FILE *f = fopen(pos_path, "ab");
+    if (!f || fwrite(pos, sizeof(uint64_t), n, f) != n) res = -1;
+    if (f && fclose(f) != 0) res = -1;
+    return res;
+}
+
+// =============================================================================
+// PHASE 1 - PARTITION
+// =============================================================================
+
+static int partition_view(const DatasetView *view, uint64_t *position, TrainingSample *window,
+                          Partition *parts, int partitions) {
+    for (size_t b0 = 0; b0 < view->n_blocks; b0 += DATASET_SHUFFLE_BLOCKS) {
+        int n_group = (int)((view->n_blocks - b0 < DATASET_SHUFFLE_BLOCKS) ? view->n_blocks - b0 : DATASET_SHUFFLE_BLOCKS);
+        int bad = 0;
+        #pragma omp parallel for schedule(dynamic) reduction(|:bad)
+        for (int k = 0; k < n_group; k++) {
+            if (dataset_view_read_block(view, b0 + k, &window[(size_t)k * DATASET_BLOCK_SAMPLES]) < 0) bad = 1;
+        }
+        if (bad) {
+            log_error("[Dedupe] Corrupt block in blocks %zu-%zu", b0, b0 + n_group - 1);
+            return -1;
+        }
+
+        // Scatter in input order (partitions stay in input order)
+        for (int k = 0; k < n_group; k++) {
+            size_t first, count;
+            dataset_view_block(view, b0 + k, &first, &count);
+            for (size_t i = 0; i < count; i++) {
+                const TrainingSample *s = &window[(size_t)k * DATASET_BLOCK_SAMPLES + i];
+                Partition *part = &parts[partition_of(s->state.hash, partitions)];
+                if (part->n == part->cap) {
+                    size_t cap = part->cap ? 2 * part->cap : DATASET_BLOCK_SAMPLES;
+                    TrainingSample *buf = realloc(part->buf, cap * sizeof(TrainingSample));
+                    if (buf) part->buf = buf;
+                    uint64_t *pos = realloc(part->pos, cap * sizeof(uint64_t));
+                    if (pos) part->pos = pos;
+                    if (!buf || !pos) return -1;
+                    part->cap = cap;
+                }
+                part->buf[part->n] = *s;
+                part->pos[part->n++] = (*position)++;
+            }
+        }
+
+        int failed = 0;
+        #pragma omp parallel for schedule(dynamic) reduction(|:failed)
+        for (int p = 0; p < partitions; p++) {
+            if (append_with_positions(parts[p].part, parts[p].part_pos, parts[p].buf, parts[p].pos, parts[p].n) != 0) failed = 1;
+            parts[p].n = 0;
+        }
+        if (failed) return -1;
+    }
+    return 0;
+}
+
+// =============================================================================
+// PHASE 2 - REDUCE
+// =============================================================================
+
+typedef struct {
+    uint64_t hash;
+    size_t index;
+} HashIndex;
+
+// By hash, then input order: the first of a run is the first occurrence
+static int compare_hash_index(const void *a, const void *b) {
+    const HashIndex *x = a, *y = b;
+    if (x->hash != y->hash) return (x->hash > y->hash) - (x->hash < y->hash);
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+static int reduce_partition(Partition *part) {
+    part->unique = 0;
+    if (dataset_get_count(part->part) <= 0) return 0;  // No sample hashed here
+
+    DatasetView view;
+    if (dataset_open(part->part, &view) != 0) return -1;
+    size_t n = view.count;
+    TrainingSample *samples = malloc(n * sizeof(TrainingSample));
+    uint64_t *pos = malloc(n * sizeof(uint64_t));
+    HashIndex *order = malloc(n * sizeof(HashIndex));
+    char *keep = calloc(n, 1);
+    FILE *f = fopen(part->part_pos, "rb");
+    int res = (samples && pos && order && keep && f &&
+               dataset_view_read(&view, 0, n, samples) == 0 &&
+               fread(pos, sizeof(uint64_t), n, f) == n) ? 0 : -1;
+    if (f) fclose(f);
+    dataset_close(&view);
+
+    if (res == 0) {
+        for (size_t i = 0; i < n; i++) order[i] = (HashIndex){ samples[i].state.hash, i };
+        qsort(order, n, sizeof(HashIndex), compare_hash_index);
+
+        // Each run of equal hashes folds into its first occurrence: averaged targets
+        for (size_t r = 0; r < n; ) {
+            // (policies over the samples that have one: value-only ones add none)
+            size_t end = r + 1;
+            TrainingSample *lead = &samples[order[r].index];
+            int policies = training_sample_has_policy(lead);
+            while (end < n && order[end].hash == order[r].hash) {
+                const TrainingSample *dup = &samples[order[end].index];
+                if (training_sample_has_policy(dup)) {
+                    for (int k = 0; k < CNN_POLICY_SIZE; k++) lead->target_policy[k] += dup->target_policy[k];
+                    policies++;
+                }
+                lead->target_value += dup->target_value;
+                end++;
+            }
+            if (end - r > 1) lead->target_value /= (float)(end - r);
+            if (policies > 1) {
+                float scale = 1.0f / (float)policies;
+                for (int k = 0; k < CNN_POLICY_SIZE; k++) lead->target_policy[k] *= scale;
+            }
+            keep[order[r].index] = 1;
+            r = end;
+        }
+
+        // Compact in input order
+        size_t u = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (!keep[i]) continue;
+            if (u != i) {
+                samples[u] = samples[i];
+                pos[u] = pos[i];
+            }
+            u++;
+        }
+        part->unique = u;
+        res = append_with_positions(part->uniq, part->uniq_pos, samples, pos, u);
+    }
+
+    remove(part->part);
+    remove(part->part_pos);
+    free(samples);
+    free(pos);
+    free(order);
+    free(keep);
+    return res;
+}
+
+// =============================================================================
+// PHASE 3 - MERGE
+// =============================================================================
+
+typedef struct {
+    DatasetView view;
+    FILE *pos_file;
+    TrainingSample *block;
+    size_t next_block, count, at;
+    uint64_t pos;               // Input position of block[at]
+    int live;
+} PartitionReader;
+
+static int reader_advance(PartitionReader *r) {
+    if (++r->at >= r->count) {
+        if (r->next_block == r->view.n_blocks) {
+            r->live = 0;
+            return 0;
+        }
+        int n = dataset_view_read_block(&r->view, r->next_block++, r->block);
+        if (n <= 0) return -1;
+        r->count = (size_t)n;
+        r->at = 0;
+    }
+    return fread(&r->pos, sizeof(uint64_t), 1, r->pos_file) == 1 ? 0 : -1;
+}
+
+static int reader_open(PartitionReader *r, const Partition *part) {
+    memset(r, 0, sizeof(*r));
+    if (part->unique == 0) return 0;
+    if (dataset_open(part->uniq, &r->view) != 0) return -1;
+    r->pos_file = fopen(part->uniq_pos, "rb");
+    r->block = malloc((size_t)DATASET_BLOCK_SAMPLES * sizeof(TrainingSample));
+    if (!r->pos_file || !r->block) return -1;
+    r->live = 1;
+    r->at = r->count = 0;  // Empty: the first advance reads block 0
+    return reader_advance(r);
+}
+
+static void reader_close(PartitionReader *r) {
+    dataset_close(&r->view);
+    if (r->pos_file) fclose(r->pos_file);
+    free(r->block);
+}
+
+static int merge_partitions(Partition *parts, int partitions, const char *output) {
+    PartitionReader *readers = calloc(partitions, sizeof(PartitionReader));
+    TrainingSample *out = malloc((size_t)WINDOW_SAMPLES * sizeof(TrainingSample));
+    int res = (readers && out) ? 0 : -1;
+    for (int p = 0; res == 0 && p < partitions; p++) res = reader_open(&readers[p], &parts[p]);
+
+    size_t n = 0;
+    while (res == 0) {
+        // Smallest input position next (each reader is in input order)
+        int best = -1;
+        for (int p = 0; p < partitions; p++) {
+            if (readers[p].live && (best < 0 || readers[p].pos < readers[best].pos)) best = p;
+        }
+        if (best < 0) break;
+        out[n++] = readers[best].block[readers[best].at];
+        res = reader_advance(&readers[best]);
+        if (n == WINDOW_SAMPLES) {
+            if (res == 0) res = dataset_save_append(output, out, n);
+            n = 0;
+        }
+    }
+    if (res == 0) res = dataset_save_append(output, out, n);
+
+    for (int p = 0; readers && p < partitions; p++) reader_close(&readers[p]);
+    free(readers);
+    free(out);
+    return res;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+int dataset_dedupe(const char *const *inputs, int n_inputs, const char *output, DedupeStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    DatasetView *views = calloc(n_inputs > 0 ? n_inputs : 1, sizeof(DatasetView));
+    if (!views) return -1;
+    int res = 0, opened = 0;
+    for (; res == 0 && opened < n_inputs; opened++) {
+        res = dataset_open(inputs[opened], &views[opened]);
+        stats->input += views[opened].count;
+    }
+
+    // Enough partitions for the memory budget and the threads
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    double raw = (double)stats->input * sizeof(TrainingSample);
+    int partitions = (int)(raw / DEDUPE_PARTITION_BYTES) + 1;
+    if (partitions < threads) partitions = threads;
+    if (partitions > DEDUPE_MAX_PARTITIONS) partitions = DEDUPE_MAX_PARTITIONS;
+    stats->partitions = partitions;
+
+    Partition *parts = calloc(partitions, sizeof(Partition));
+    TrainingSample *window = malloc((size_t)WINDOW_SAMPLES * sizeof(TrainingSample));
+    if (!parts || !window) res = -1;
+    for (int p = 0; parts && p < partitions; p++) {
+        partition_paths(&parts[p], output, p);
+        remove_files(&parts[p]);
+    }
+
+    uint64_t position = 0;
+    for (int i = 0; res == 0 && i < n_inputs; i++) {
+        res = partition_view(&views[i], &position, window, parts, partitions);
+    }
+    for (int i = 0; i < opened; i++) dataset_close(&views[i]);
+    free(views);
+    free(window);
+    for (int p = 0; parts && p < partitions; p++) {
+        free(parts[p].buf);
+        free(parts[p].pos);
+        parts[p].buf = NULL;
+        parts[p].pos = NULL;
+    }
+
+    if (res == 0) {
+        int failed = 0;
+        #pragma omp parallel for schedule(dynamic) reduction(|:failed)
+        for (int p = 0; p < partitions; p++) {
+            if (reduce_partition(&parts[p]) != 0) failed = 1;
+        }
+        res = failed ? -1 : 0;
+    }
+
+    if (res == 0) {
+        remove(output);
+        res = merge_partitions(parts, partitions, output);
+        for (int p = 0; p < partitions; p++) stats->unique += parts[p].unique;
+    }
+    for (int p = 0; parts && p < partitions; p++) remove_files(&parts[p]);
+    free(parts);
+    if (res != 0) log_error("[Dedupe] Failed to write %s", output);
+    return res;
+}
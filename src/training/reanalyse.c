@@ -0,0 +1,181 @@
+/**
+ * reanalyse.c - Fresh Search Targets for Stored Positions
+ */
+
+#include "dama/training/reanalyse.h"
+#include "dama/training/sample_writer.h"
+#include "dama/search/mcts_inference.h"
+#include "dama/search/mcts_pool.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/common/params.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// =============================================================================
+// ONE POSITION
+// =============================================================================
+
+// Root value for the side to move, in [-1, 1]
+static float root_value(const Node *root) {
+    double score = 0.0;
+    long visits = 0;
+    for (int i = 0; i < root->num_children; i++) {
+        score += root->children[i]->score;
+        visits += root->children[i]->visits;
+    }
+    return visits > 0 ? (float)(2.0 * score / visits - 1.0) : 0.0f;
+}
+
+/**
+ * Search s again and rewrite its targets.
+ * @param shift Output: total variation between the old and new policy
+ * @return 1 if s got a new policy, 0 if left alone (no move, no arena)
+ */
+static int reanalyse_sample(TrainingSample *s, MCTSConfig cfg, float blend, float *shift) {
+    SearchSlot *slot = search_pool_acquire(0, ARENA_SIZE_REANALYSE, &ARENA_BACKING_SEARCH, 0, 0);
+    if (!slot) return 0;
+    Arena *arena = &slot->arena;
+
+    Node *history;
+    if (mcts_history_chain(s->history, training_sample_history_plies(s), arena, &history) != 0) return 0;
+    Node *root = mcts_create_root_with_history(s->state, arena, cfg, history);
+    if (!root || root->is_terminal) return 0;
+
+    mcts_search(root, arena, 0.0, cfg, NULL, NULL, NULL);
+    if (root->num_children == 0) return 0;
+
+    float policy[CNN_POLICY_SIZE];
+    mcts_get_policy(root, policy, 1.0f, &s->state);
+    float tv = 0.0f;
+    for (int k = 0; k < CNN_POLICY_SIZE; k++) tv += fabsf(policy[k] - s->target_policy[k]);
+    *shift = 0.5f * tv;
+    memcpy(s->target_policy, policy, sizeof(policy));
+
+    if (blend > 0.0f) s->target_value = (1.0f - blend) * s->target_value + blend * root_value(root);
+    return 1;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+int dataset_reanalyse(const char *input, const char *output, const ReanalyseConfig *cfg,
+                      const MCTSConfig *mcts_cfg, ReanalyseStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    const CNNWeights *weights = (const CNNWeights*)mcts_cfg->cnn_weights;
+    if (!weights) {
+        log_error("[Reanalyse] A network is required");
+        return -1;
+    }
+
+    DatasetView view;
+    if (dataset_open(input, &view) != 0) {
+        log_error("[Reanalyse] Cannot read %s", input);
+        return -1;
+    }
+
+    // Written next to output and renamed over it when complete
+    char tmp_path[520];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", output);
+    remove(tmp_path);
+    SampleWriter writer;
+    TrainingSample *block = malloc(DATASET_BLOCK_SAMPLES * sizeof(TrainingSample));
+    if (!block || sample_writer_open(&writer, tmp_path, 0, 0) != 0) {
+        free(block);
+        dataset_close(&view);
+        return -1;
+    }
+
+#ifdef _OPENMP
+    int threads = cfg->threads > 0 ? cfg->threads : omp_get_max_threads();
+#else
+    int threads = 1;
+#endif
+
+    // Same setup as a selfplay run: one eval cache, leaves batched across searches
+    MCTSConfig search_cfg = *mcts_cfg;
+    CNNCache *cache = NULL;
+    if (!search_cfg.cnn_cache) {
+        cache = cnn_cache_create(CNN_CACHE_SIZE_DEFAULT);
+        search_cfg.cnn_cache = cache;
+    }
+    InferenceServer server;
+    int use_server = (threads > 1 && mcts_cfg->num_threads == 0);
+    if (use_server) {
+        if (inference_server_start(&server, weights, threads * mcts_cfg->leaf_batch,
+                                   INFERENCE_SERVER_GATHER_US, 1) == ERR_OK) {
+            search_cfg.inference_server = &server;
+        } else {
+            log_warn("[Reanalyse] Inference server unavailable, searches evaluate locally");
+            use_server = 0;
+        }
+    }
+
+    int n = 0, failed = 0;
+    size_t searched = 0, filled = 0;
+    double shift = 0.0;
+    size_t shifted = 0;
+    #pragma omp parallel num_threads(threads)
+    {
+        for (size_t b = 0; b < view.n_blocks; b++) {
+            #pragma omp single
+            {
+                n = dataset_view_read_block(&view, b, block);
+                if (n < 0) {
+                    log_error("[Reanalyse] Corrupt block %zu in %s", b, input);
+                    failed = 1;
+                }
+            }
+            if (failed) break;
+
+            #pragma omp for schedule(dynamic) reduction(+:searched, filled, shift, shifted)
+            for (int i = 0; i < n; i++) {
+                int had_policy = training_sample_has_policy(&block[i]);
+                float tv = 0.0f;
+                if (reanalyse_sample(&block[i], search_cfg, cfg->value_blend, &tv)) {
+                    searched++;
+                    if (had_policy) {
+                        shift += tv;
+                        shifted++;
+                    } else {
+                        filled++;
+                    }
+                }
+            }
+
+            // Blocks go out in input order; the writer overlaps the next one
+            #pragma omp single
+            {
+                if (sample_writer_push(&writer, block, (size_t)n) != 0) failed = 1;
+                stats->samples += (size_t)n;
+                if (cfg->on_progress) cfg->on_progress(stats->samples, view.count);
+            }
+            if (failed) break;
+        }
+        search_pool_release();
+    }
+
+    if (use_server) inference_server_stop(&server);
+    cnn_cache_free(cache);
+    free(block);
+    dataset_close(&view);
+    if (sample_writer_close(&writer) != 0) failed = 1;
+    if (!failed && stats->samples == 0) failed = dataset_save(tmp_path, NULL, 0) != 0;
+    if (failed || rename(tmp_path, output) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    stats->searched = searched;
+    stats->filled = filled;
+    stats->policy_shift = shifted ? shift / shifted : 0.0;
+    return 0;
+}
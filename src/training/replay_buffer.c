@@ -0,0 +1,279 @@
+/**
+ * replay_buffer.c - Rolling Replay Buffer of Training Samples
+ *
+ * Crash safety: a segment is written before the index names it, and
+ * leaves the index before it is deleted. The index is replaced atomically.
+ */
+
+#include "dama/training/replay_buffer.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+// =============================================================================
+// INDEX
+// =============================================================================
+
+static void index_path(const char *dir, char *out, size_t size) {
+    snprintf(out, size, "%s/%s", dir, REPLAY_INDEX_FILE);
+}
+
+static void segment_path(const char *dir, uint32_t id, char *out, size_t size) {
+    snprintf(out, size, "%s/seg_%08u.bin", dir, id);
+}
+
+static long segment_count(const char *dir, uint32_t id) {
+    char path[512];
+    segment_path(dir, id, path, sizeof(path));
+    return dataset_get_count(path);
+}
+
+// The index as held in memory: the header and the sealed segments' counts
+typedef struct {
+    ReplayIndex head;
+    uint32_t *sealed;           // Samples of segment first_segment + i
+} Replay;
+
+static uint32_t sealed_segments(const ReplayIndex *h) {
+    return h->next_segment > h->first_segment ? h->next_segment - h->first_segment - 1 : 0;
+}
+
+static void replay_free(Replay *r) {
+    free(r->sealed);
+    r->sealed = NULL;
+}
+
+// Version 1 kept no counts: read them from the segments once
+static int count_sealed(const char *dir, Replay *r) {
+    r->head.sealed_samples = 0;
+    for (uint32_t i = 0; i < sealed_segments(&r->head); i++) {
+        long n = segment_count(dir, r->head.first_segment + i);
+        if (n < 0) return -1;
+        r->sealed[i] = (uint32_t)n;
+        r->head.sealed_samples += (uint64_t)n;
+    }
+    r->head.version = REPLAY_VERSION;
+    return 0;
+}
+
+static int read_index(const char *dir, Replay *r) {
+    char path[512];
+    index_path(dir, path, sizeof(path));
+    memset(r, 0, sizeof(*r));
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    ReplayIndex *h = &r->head;
+    const size_t v1_bytes = offsetof(ReplayIndex, sealed_samples);
+    int ok = fread(h, v1_bytes, 1, f) == 1 &&
+             memcmp(h->magic, REPLAY_MAGIC, 4) == 0 &&
+             (h->version == REPLAY_VERSION || h->version == 1) &&
+             h->first_segment <= h->next_segment &&
+             h->segment_samples > 0;
+    uint32_t n = ok ? sealed_segments(h) : 0;
+    if (ok) {
+        r->sealed = malloc((n ? n : 1) * sizeof(uint32_t));
+        ok = r->sealed != NULL;
+    }
+    if (ok && h->version == REPLAY_VERSION) {
+        ok = fread(&h->sealed_samples, sizeof(h->sealed_samples), 1, f) == 1 &&
+             fread(r->sealed, sizeof(uint32_t), n, f) == n;
+        uint64_t total = 0;
+        for (uint32_t i = 0; ok && i < n; i++) total += r->sealed[i];
+        ok = ok && total == h->sealed_samples;
+    }
+    fclose(f);
+    if (ok && h->version == 1) ok = count_sealed(dir, r) == 0;
+    if (!ok) replay_free(r);
+    return ok ? 0 : -1;
+}
+
+static int write_index(const char *dir, const Replay *r) {
+    char path[512], tmp[520];
+    index_path(dir, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+    uint32_t n = sealed_segments(&r->head);
+    int ok = fwrite(&r->head, sizeof(r->head), 1, f) == 1 &&
+             fwrite(r->sealed, sizeof(uint32_t), n, f) == n;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        log_error("[Replay] Cannot write index of %s", dir);
+        return -1;
+    }
+    return 0;
+}
+
+// Samples in the newest segment (the only one not counted in the index)
+static long newest_count(const char *dir, const Replay *r) {
+    if (r->head.first_segment == r->head.next_segment) return 0;
+    return segment_count(dir, r->head.next_segment - 1);
+}
+
+// Drop the oldest segments while the newer ones still hold the window
+static int evict(const char *dir, Replay *r, long newest) {
+    ReplayIndex *h = &r->head;
+    if (h->window == 0) return 0;
+
+    uint64_t total = h->sealed_samples + (uint64_t)newest;
+    uint32_t dropped = 0;
+    while (dropped < sealed_segments(h) && total - r->sealed[dropped] >= h->window) {
+        total -= r->sealed[dropped];
+        dropped++;
+    }
+    if (dropped == 0) return 0;
+
+    uint32_t first = h->first_segment;
+    for (uint32_t i = 0; i < dropped; i++) h->sealed_samples -= r->sealed[i];
+    h->first_segment += dropped;
+    memmove(r->sealed, r->sealed + dropped, sealed_segments(h) * sizeof(uint32_t));
+    if (write_index(dir, r) != 0) return -1;
+    for (uint32_t id = first; id < first + dropped; id++) {
+        char path[512];
+        segment_path(dir, id, path, sizeof(path));
+        remove(path);
+    }
+    return 0;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+int replay_is_buffer(const char *path) {
+    ReplayIndex index;
+    return replay_read_index(path, &index) == 0;
+}
+
+int replay_read_index(const char *dir, ReplayIndex *index) {
+    Replay r;
+    if (read_index(dir, &r) != 0) return -1;
+    *index = r.head;
+    replay_free(&r);
+    return 0;
+}
+
+int replay_create(const char *dir, size_t segment_samples, size_t window) {
+    Replay r;
+    if (read_index(dir, &r) != 0) {
+        mkdir(dir, 0755);
+        memset(&r, 0, sizeof(r));
+        memcpy(r.head.magic, REPLAY_MAGIC, 4);
+        r.head.version = REPLAY_VERSION;
+        r.head.segment_samples = REPLAY_SEGMENT_SAMPLES;
+    }
+    if (segment_samples > 0) r.head.segment_samples = (uint32_t)segment_samples;
+    r.head.window = window;
+    long newest = newest_count(dir, &r);
+    int res = (newest >= 0 && write_index(dir, &r) == 0) ? evict(dir, &r, newest) : -1;
+    replay_free(&r);
+    return res;
+}
+
+int replay_append(const char *dir, const TrainingSample *samples, size_t count) {
+    Replay r;
+    if (read_index(dir, &r) != 0) return -1;
+    ReplayIndex *h = &r.head;
+
+    // Only the newest segment's header is read: the others are counted in the index
+    long used = newest_count(dir, &r);
+    int res = used < 0 ? -1 : 0;
+    char path[512];
+    while (res == 0 && count > 0) {
+        // Newest segment, or a new one when there is none or it is full
+        int fresh = h->first_segment == h->next_segment || used >= (long)h->segment_samples;
+        uint32_t id = fresh ? h->next_segment : h->next_segment - 1;
+
+        size_t n = h->segment_samples - (size_t)(fresh ? 0 : used);
+        if (n > count) n = count;
+        segment_path(dir, id, path, sizeof(path));
+        if (fresh) remove(path);  // Leftover of an interrupted append
+        if (dataset_save_append(path, samples, n) != 0) {
+            res = -1;
+            break;
+        }
+        if (fresh) {
+            // The full newest segment is sealed: its count goes in the index
+            if (h->first_segment < h->next_segment) {
+                uint32_t sealed = sealed_segments(h);
+                uint32_t *grown = realloc(r.sealed, (sealed + 1) * sizeof(uint32_t));
+                if (!grown) {
+                    res = -1;
+                    break;
+                }
+                r.sealed = grown;
+                r.sealed[sealed] = (uint32_t)used;
+                h->sealed_samples += (uint64_t)used;
+            }
+            h->next_segment++;
+            used = 0;
+            if (write_index(dir, &r) != 0) {
+                res = -1;
+                break;
+            }
+        }
+        used += (long)n;
+        samples += n;
+        count -= n;
+    }
+    if (res == 0) res = evict(dir, &r, used);
+    replay_free(&r);
+    return res;
+}
+
+int replay_clear(const char *dir) {
+    Replay r;
+    if (read_index(dir, &r) != 0) return -1;
+
+    uint32_t first = r.head.first_segment, next = r.head.next_segment;
+    r.head.first_segment = r.head.next_segment;
+    r.head.sealed_samples = 0;
+    int res = write_index(dir, &r);
+    replay_free(&r);
+    if (res != 0) return -1;
+    for (uint32_t id = first; id < next; id++) {
+        char path[512];
+        segment_path(dir, id, path, sizeof(path));
+        remove(path);
+    }
+    return 0;
+}
+
+long replay_count(const char *dir) {
+    Replay r;
+    if (read_index(dir, &r) != 0) return -1;
+    long newest = newest_count(dir, &r);
+    long total = newest < 0 ? -1 : (long)r.head.sealed_samples + newest;
+    replay_free(&r);
+    return total;
+}
+
+int replay_open(const char *dir, DatasetView *view) {
+    ReplayIndex index;
+    if (replay_read_index(dir, &index) != 0) {
+        memset(view, 0, sizeof(*view));
+        return -1;
+    }
+
+    size_t n = index.next_segment - index.first_segment;
+    char *paths = malloc((n ? n : 1) * 512);
+    const char **names = malloc((n ? n : 1) * sizeof(char*));
+    int res = -1;
+    if (paths && names) {
+        for (size_t i = 0; i < n; i++) {
+            names[i] = paths + i * 512;
+            segment_path(dir, index.first_segment + (uint32_t)i, paths + i * 512, 512);
+        }
+        res = dataset_open_segments(names, n, view);
+    } else {
+        memset(view, 0, sizeof(*view));
+    }
+    free(paths);
+    free(names);
+    return res;
+}
@@ -0,0 +1,191 @@
+/**
+ * sample_writer.c - Buffered Background Writer of Self-Play Samples
+ *
+ * The queue is a Treiber stack: producers CAS their chunk in as the head,
+ * the writer takes the whole list with one exchange and reverses it back
+ * into push order. There is a single consumer, so no ABA.
+ */
+
+#include "dama/training/sample_writer.h"
+#include "dama/common/params.h"
+#include "dama/common/logging.h"
+#include "dama/common/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// =============================================================================
+// WRITER THREAD
+// =============================================================================
+
+// Move the queued chunks, oldest first, into the buffer
+static void drain(SampleWriter *w) {
+    SampleChunk *list = atomic_exchange(&w->pending, NULL);
+    SampleChunk *ordered = NULL;
+    while (list) {
+        SampleChunk *next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    while (ordered) {
+        SampleChunk *chunk = ordered;
+        ordered = chunk->next;
+        atomic_fetch_sub(&w->queued, chunk->count);
+
+        if (w->buffered + chunk->count > w->capacity) {
+            size_t capacity = w->capacity * 2;
+            if (capacity < w->buffered + chunk->count) capacity = w->buffered + chunk->count;
+            TrainingSample *grown = realloc(w->buffer, capacity * sizeof(TrainingSample));
+            if (!grown) {
+                log_error("[SampleWriter] Out of memory, %zu samples dropped", chunk->count);
+                w->failed = 1;
+                free(chunk);
+                continue;
+            }
+            w->buffer = grown;
+            w->capacity = capacity;
+        }
+        memcpy(w->buffer + w->buffered, chunk->samples, chunk->count * sizeof(TrainingSample));
+        w->buffered += chunk->count;
+        free(chunk);
+    }
+}
+
+static int append_to_path(void *ctx, const TrainingSample *samples, size_t count) {
+    return dataset_save_append((const char*)ctx, samples, count);
+}
+
+// Write the first n buffered samples
+static void write_buffered(SampleWriter *w, size_t n) {
+    if (n == 0) return;
+    TRACE_BEGIN(t0);
+    if (!w->failed && w->sink(w->sink_ctx, w->buffer, n) != 0) {
+        log_error("[SampleWriter] Cannot write to %s, later samples are dropped", w->path);
+        w->failed = 1;
+    }
+    TRACE_END("sample write", t0);
+    if (!w->failed) w->written += n;
+    memmove(w->buffer, w->buffer + n, (w->buffered - n) * sizeof(TrainingSample));
+    w->buffered -= n;
+}
+
+static void* writer_main(void *arg) {
+    SampleWriter *w = arg;
+    TRACE_THREAD("sample writer");
+
+    pthread_mutex_lock(&w->lock);
+    while (!w->stop) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        long long ns = ts.tv_nsec + (long long)w->interval_ms * 1000000LL;
+        ts.tv_sec += ns / 1000000000LL;
+        ts.tv_nsec = ns % 1000000000LL;
+        int timed_out = 0;
+        while (!w->stop && atomic_load(&w->queued) < w->flush_samples && !timed_out) {
+            timed_out = pthread_cond_timedwait(&w->cond, &w->lock, &ts) != 0;
+        }
+        if (w->stop) break;
+        pthread_mutex_unlock(&w->lock);
+
+        // Whole blocks when the buffer filled up, everything when time ran out
+        drain(w);
+        size_t n = w->buffered;
+        if (!timed_out && n >= DATASET_BLOCK_SAMPLES) n -= n % DATASET_BLOCK_SAMPLES;
+        write_buffered(w, n);
+
+        pthread_mutex_lock(&w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    drain(w);
+    write_buffered(w, w->buffered);
+    return NULL;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+// Everything but the output is set up here, then the thread starts
+static int writer_start(SampleWriter *w, size_t flush_samples, int interval_ms) {
+    w->flush_samples = flush_samples ? flush_samples : SELFPLAY_WRITE_SAMPLES;
+    w->interval_ms = interval_ms > 0 ? interval_ms : SELFPLAY_WRITE_INTERVAL_MS;
+    atomic_init(&w->pending, NULL);
+    atomic_init(&w->queued, 0);
+
+    w->capacity = w->flush_samples + DATASET_BLOCK_SAMPLES;
+    w->buffer = malloc(w->capacity * sizeof(TrainingSample));
+    if (!w->buffer) return -1;
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    if (pthread_create(&w->thread, NULL, writer_main, w) != 0) {
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+        free(w->buffer);
+        w->buffer = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int sample_writer_open(SampleWriter *w, const char *path, size_t flush_samples, int interval_ms) {
+    memset(w, 0, sizeof(*w));
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    w->sink = append_to_path;
+    w->sink_ctx = w->path;
+    return writer_start(w, flush_samples, interval_ms);
+}
+
+int sample_writer_open_sink(SampleWriter *w, SampleSink sink, void *ctx,
+                            size_t flush_samples, int interval_ms) {
+    memset(w, 0, sizeof(*w));
+    snprintf(w->path, sizeof(w->path), "sink");
+    w->sink = sink;
+    w->sink_ctx = ctx;
+    return writer_start(w, flush_samples, interval_ms);
+}
+
+int sample_writer_push(SampleWriter *w, const TrainingSample *samples, size_t count) {
+    if (count == 0) return 0;
+    SampleChunk *chunk = malloc(sizeof(SampleChunk) + count * sizeof(TrainingSample));
+    if (!chunk) {
+        log_error("[SampleWriter] Out of memory, %zu samples dropped", count);
+        return -1;
+    }
+    chunk->count = count;
+    memcpy(chunk->samples, samples, count * sizeof(TrainingSample));
+
+    // Counted before it is visible, so the writer never subtracts more than was added
+    size_t before = atomic_fetch_add(&w->queued, count);
+    chunk->next = atomic_load_explicit(&w->pending, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&w->pending, &chunk->next, chunk,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+
+    // Only the push that crosses the threshold takes the lock
+    if (before < w->flush_samples && before + count >= w->flush_samples) {
+        pthread_mutex_lock(&w->lock);
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+    }
+    return 0;
+}
+
+int sample_writer_close(SampleWriter *w) {
+    if (!w->buffer) return -1;
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    free(w->buffer);
+    w->buffer = NULL;
+    return w->failed ? -1 : 0;
+}
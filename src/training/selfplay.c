@@ -5,9 +5,17 @@
 #include "dama/training/selfplay.h"
 #include "dama/common/rng.h"
 #include "dama/common/logging.h"
+#include "dama/common/affinity.h"
+#include "dama/common/trace.h"
 #include "dama/engine/movegen.h"
 #include "dama/neural/cnn.h"
+#include "dama/search/mcts_inference.h"
+#include "dama/search/mcts_pool.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/common/error_codes.h"
 #include "dama/training/dataset.h"
+#include "dama/training/replay_buffer.h"
+#include "dama/training/sample_writer.h"
 #include "dama/training/endgame.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,6 +25,8 @@
 
 #ifdef _OPENMP
 #include <omp.h>
+#else
+#define omp_get_thread_num() 0
 #endif
 
 // =============================================================================
@@ -68,14 +78,13 @@ static void add_dirichlet_noise(Node *root, RNG *rng, float eps, float alpha) {
         for (int i = 0; i < n; i++) {
             root->children[i]->prior = (1.0f - eps) * root->children[i]->prior + eps * noise[i] / sum;
         }
+        child_stats_rebuild(root);
     }
     free(noise);
 }
 
 static int is_game_over(const GameState *s) {
-    MoveList m;
-    movegen_generate(s, &m);
-    return m.count == 0;
+    return !movegen_has_any_move(s);
 }
 
 
@@ -90,7 +99,7 @@ static int is_game_over(const GameState *s) {
  * High temp: sample proportionally to visit^(1/temp)
  */
 static Move select_move_by_temperature(Node *root, float temp, RNG *rng) {
-    Move chosen = {0};
+    PackedMove chosen = PM_NONE;
     
     if (temp < 0.1f) {
         // Greedy: select most visited child
@@ -120,12 +129,14 @@ static Move select_move_by_temperature(Node *root, float temp, RNG *rng) {
                 break;
             }
         }
-        if (chosen.path[0] == 0) {
+        if (chosen == PM_NONE) {
             chosen = root->children[0]->move_from_parent;
         }
     }
     
-    return chosen;
+    Move move = {0};
+    movegen_unpack_move(&root->state, chosen, &move);
+    return move;
 }
 
 /**
@@ -135,8 +146,10 @@ static Move select_move_by_temperature(Node *root, float temp, RNG *rng) {
  * Features:
  * - Temperature annealing (exploration -> exploitation)
  * - Dirichlet noise for root exploration
- * - Resignation check using NN value
+ * - Resignation check using NN value (through the shared eval cache)
  * - Tree reuse for efficiency
+ * - Playout cap randomization (fast_nodes > 0): only full searches record a
+ *   policy; fast ones leave it zero (value-only sample) and get no noise
  */
 static int play_game(
     const CNNWeights *weights, 
@@ -147,7 +160,10 @@ static int play_game(
     EndReason *out_reason, 
     float initial_temp, 
     RNG *rng,
-    float endgame_prob
+    float endgame_prob,
+    int fast_nodes,
+    float full_search_prob,
+    CNNCache *cache
 ) {
     GameState state;
     
@@ -168,8 +184,22 @@ static int play_game(
         }
     }
     
-    Arena arena;
-    arena_init(&arena, ARENA_SIZE_SELFPLAY); // Use central constant
+    // Both sides share one tree, so reuse needs the same network
+    int reuse = DEFAULT_TREE_REUSE && cfg_white.cnn_weights == cfg_black.cnn_weights;
+    
+    // The thread's pooled arenas, emptied for this game
+    SearchSlot *slot = search_pool_acquire(0, ARENA_SIZE_SELFPLAY, &ARENA_BACKING_SELFPLAY, reuse, 0);
+    if (!slot && reuse) {
+        reuse = 0;
+        slot = search_pool_acquire(0, ARENA_SIZE_SELFPLAY, &ARENA_BACKING_SELFPLAY, 0, 0);
+    }
+    if (!slot) {
+        log_error("[selfplay] Cannot allocate the search arena");
+        *out_steps = 0;
+        *out_reason = END_MAX_MOVES;
+        return 0;
+    }
+    Arena *arena = &slot->arena;
     Node *root = NULL; // Persistent root for tree reuse
 
     int moves = 0;
@@ -180,25 +210,28 @@ static int play_game(
         float temp = (moves < DEFAULT_TEMP_THRESHOLD) ? initial_temp : 0.1f;
         
         MCTSConfig cfg = (state.current_player == WHITE) ? cfg_white : cfg_black;
+        int full = (fast_nodes <= 0 || rng_f32(rng) < full_search_prob);
+        if (!full) cfg.max_nodes = fast_nodes;
         
-        // Tree Reuse: Only create root if we don't have one (start of game or lost track)
-        if (!DEFAULT_TREE_REUSE || !root) {
-             if (!DEFAULT_TREE_REUSE) arena_reset(&arena);
-             root = mcts_create_root(state, &arena, cfg);
+        // Tree Reuse: compact the subtree under the played move, or start fresh
+        if (reuse && root) {
+            root = mcts_advance_root(root, &state, arena, &slot->spare, NULL);
         } else {
-             // Verify root state matches current state
-             if (root->state.hash != state.hash) {
-                 root = mcts_create_root(state, &arena, cfg);
-             }
+            root = NULL;
+        }
+        if (!root) {
+            arena_reset(arena);
+            root = mcts_create_root(state, arena, cfg);
         }
         
         // Add Dirichlet noise for exploration (first 30 moves)
-        if (moves < 30) {
+        if (full && moves < 30) {
             add_dirichlet_noise(root, rng, DEFAULT_DIRICHLET_EPSILON, DEFAULT_DIRICHLET_ALPHA);
         }
         
-        mcts_search(root, &arena, 0.0, cfg, NULL, NULL, NULL); // Time 0.0 -> use max_nodes or implicit
-        mcts_get_policy(root, policy, temp, &state);
+        mcts_search(root, arena, 0.0, cfg, NULL, NULL, NULL); // Time 0.0 -> use max_nodes or implicit
+        if (full) mcts_get_policy(root, policy, temp, &state);
+        else memset(policy, 0, sizeof(policy));  // Value-only sample
         
         // Select move using temperature-based sampling
         Move chosen = select_move_by_temperature(root, temp, rng);
@@ -212,27 +245,10 @@ static int play_game(
         
         apply_move(&state, &chosen);
         
-        // Tree Reuse: Advance root to the chosen child
-        if (DEFAULT_TREE_REUSE && root) {
-            Node *next_root = find_child_by_move(root, &chosen);
-            if (next_root) {
-                // Found! Reuse this subtree
-                root = next_root;
-                root->parent = NULL; // Detach from parent to be safe (though logically fine)
-            } else {
-                root = NULL; // Will recreate next iter
-            }
-        } else {
-             root = NULL;
-             // Reset handled at start of next loop via (!DEFAULT_TREE_REUSE) check
-        }
-        
-        // Arena accumulates for whole game (~40k nodes).
         moves++;
         
         // Checks
         if (state.moves_without_captures >= MAX_MOVES_WITHOUT_CAPTURES) {
-            arena_free(&arena);
             *out_steps = moves;
             *out_reason = END_40_MOVE;
             return 0; // Draw
@@ -243,10 +259,15 @@ static int play_game(
             CNNOutput out;
             GameState *h1 = (moves>=1) ? &history_buffer[moves-1].state : NULL;
             GameState *h2 = (moves>=2) ? &history_buffer[moves-2].state : NULL;
-            cnn_forward_with_history(weights, &state, h1, h2, &out);
+            uint64_t key = cache ? cnn_cache_key(&state, h1, h2) : 0;
+            if (!cache || !cnn_cache_probe(cache, key, &out)) {
+                CNNPolicySubset legal;
+                cnn_policy_subset(&state, &legal);
+                cnn_forward_legal(weights, &state, h1, h2, &legal, &out);
+                if (cache) cnn_cache_store(cache, key, &state, &out);
+            }
              
             if (out.value < RESIGN_THRESHOLD) {
-                 arena_free(&arena);
                  *out_steps = moves;
                  *out_reason = END_RESIGNATION;
                  return (state.current_player == WHITE) ? -1 : 1;
@@ -254,7 +275,6 @@ static int play_game(
         }
     }
     
-    arena_free(&arena);
     *out_steps = moves;
     *out_reason = (moves >= max_moves) ? END_MAX_MOVES : END_CHECKMATE;
     
@@ -269,12 +289,25 @@ static int play_game(
 void selfplay_run(const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg) {
     if (sp_cfg->on_start) sp_cfg->on_start(sp_cfg->games);
     
-    // File setup
-    if (sp_cfg->overwrite_data) {
+    // File setup (a sink owns its output)
+    int overwrite = sp_cfg->overwrite_data && !sp_cfg->sink;
+    if (overwrite && replay_is_buffer(sp_cfg->output_file)) {
+        replay_clear(sp_cfg->output_file);
+    } else if (overwrite) {
         FILE *f = fopen(sp_cfg->output_file, "wb");
         if (f) fclose(f); // Create/Truncate
     }
     
+    // Finished games are queued; one thread writes them in large appends
+    SampleWriter writer;
+    int opened = sp_cfg->sink ? sample_writer_open_sink(&writer, sp_cfg->sink, sp_cfg->sink_ctx, 0, 0)
+                              : sample_writer_open(&writer, sp_cfg->output_file, 0, 0);
+    if (opened != 0) {
+        log_error("[selfplay] Cannot start the sample writer for %s",
+                  sp_cfg->sink ? "the sink" : sp_cfg->output_file);
+        return;
+    }
+    
     int completed_games = 0;
     int total_wins = 0, total_losses = 0, total_draws = 0;
     
@@ -283,8 +316,34 @@ void selfplay_run(const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg) {
     // CNN weights from mcts_cfg
     const CNNWeights *weights = (const CNNWeights*)mcts_cfg->cnn_weights;
     
+    // One eval cache for all games: openings and resign checks repeat positions
+    MCTSConfig game_cfg = *mcts_cfg;
+    CNNCache *cache = NULL;
+    if (weights && !game_cfg.cnn_cache) {
+        cache = cnn_cache_create(CNN_CACHE_SIZE_DEFAULT);
+        if (!cache) log_warn("[selfplay] Failed to allocate NN eval cache");
+        game_cfg.cnn_cache = cache;
+    }
+    
+    // Sequential searches in parallel games: batch their leaves across games
+    InferenceServer server;
+    int use_server = (weights && num_threads > 1 && mcts_cfg->num_threads == 0);
+    if (use_server) {
+        if (inference_server_start(&server, weights, num_threads * mcts_cfg->leaf_batch,
+                                   INFERENCE_SERVER_GATHER_US, 1) == ERR_OK) {
+            game_cfg.inference_server = &server;
+        } else {
+            log_warn("[selfplay] Inference server unavailable, games evaluate locally");
+            use_server = 0;
+        }
+    }
+    
     #pragma omp parallel num_threads(num_threads)
     {
+        // Pinned first: game buffers and pooled arenas come from its node
+        affinity_pin_slot(omp_get_thread_num());
+        TRACE_THREAD("selfplay game");
+        
         // Thread-local RNG
         RNG rng;
         unsigned int seed = time(NULL) ^ (omp_get_thread_num() * 12345);
@@ -311,8 +370,8 @@ void selfplay_run(const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg) {
             EndReason reason;
             
             // Mixed Opponent: Probabilistically replace one side with Grandmaster
-            MCTSConfig w_cfg = *mcts_cfg;
-            MCTSConfig b_cfg = *mcts_cfg;
+            MCTSConfig w_cfg = game_cfg;
+            MCTSConfig b_cfg = game_cfg;
             
             if (rng_f32(&rng) < MIX_OPPONENT_PROB) {
                 if (rng_u32(&rng) % 2 == 0) {
@@ -324,7 +383,11 @@ void selfplay_run(const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg) {
                 }
             }
             
-            int res = play_game(weights, w_cfg, b_cfg, history, &steps, &reason, sp_cfg->temp, &rng, sp_cfg->endgame_prob);
+            TRACE_BEGIN(t_game);
+            int res = play_game(weights, w_cfg, b_cfg, history, &steps, &reason, sp_cfg->temp, &rng, sp_cfg->endgame_prob,
+                                sp_cfg->fast_nodes, sp_cfg->full_search_prob,
+                                (CNNCache*)game_cfg.cnn_cache);
+            TRACE_END("selfplay game", t_game);
             
             // Stats update (atomic)
             #pragma omp atomic
@@ -361,10 +424,12 @@ void selfplay_run(const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg) {
                 s->target_value = val;
             }
             
-            // Write to file (Critical section)
-            #pragma omp critical(file_io)
+            TRACE_BEGIN(t_push);
+            sample_writer_push(&writer, batch, batch_cnt);
+            TRACE_END("sample push", t_push);
+            
+            #pragma omp critical(progress)
             {
-                dataset_save_append(sp_cfg->output_file, batch, batch_cnt);
                 if (sp_cfg->on_game_complete) {
                     sp_cfg->on_game_complete(i, sp_cfg->games, res, steps, reason);
                 }
@@ -376,5 +441,14 @@ void selfplay_run(const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg) {
         
         free(history);
         free(batch);
+        search_pool_release(); // Training comes next: give the arenas back
+        affinity_unpin();
+    }
+    
+    if (use_server) inference_server_stop(&server);
+    cnn_cache_free(cache);
+    if (sample_writer_close(&writer) != 0) {
+        log_error("[selfplay] Some samples were not written to %s",
+                  sp_cfg->sink ? "the sink" : sp_cfg->output_file);
     }
 }
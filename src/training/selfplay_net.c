@@ -0,0 +1,467 @@
+/**
+ * selfplay_net.c - Distributed Self-Play: Workers and a Sample Collector
+ *
+ * The collector runs one thread per worker connection. Samples go through
+ * the shared SampleWriter (lock-free push), the model cache is behind the
+ * collector lock and copied out before it is sent, so a slow worker never
+ * holds up the others.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "dama/training/selfplay_net.h"
+#include "dama/neural/cnn_backend.h"
+#include "dama/common/params.h"
+#include "dama/common/error_codes.h"
+#include "dama/common/logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define NET_MAX_MODEL_BYTES ((uint64_t)1 << 30)
+#define NET_CHUNK_BYTES     ((size_t)1 << 20)
+
+// =============================================================================
+// FRAMING
+// =============================================================================
+
+// Payload bytes of a NET_SAMPLES frame of up to DATASET_BLOCK_SAMPLES records
+static size_t samples_payload_max(void) {
+    return sizeof(uint32_t) + dataset_block_max_bytes(DATASET_BLOCK_SAMPLES);
+}
+
+static int send_all(int fd, struct iovec *iov, int n) {
+    while (n > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)n;
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (n > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char*)iov->iov_base + sent;
+            iov->iov_len -= (size_t)sent;
+        }
+    }
+    return 0;
+}
+
+// One message, header and both payload parts in a single send
+static int send_frame(int fd, uint32_t type, const void *a, size_t a_bytes, const void *b, size_t b_bytes) {
+    NetFrame frame;
+    memcpy(frame.magic, NET_MAGIC, 4);
+    frame.type = type;
+    frame.bytes = a_bytes + b_bytes;
+    struct iovec iov[3] = {
+        { &frame, sizeof(frame) }, { (void*)a, a_bytes }, { (void*)b, b_bytes }
+    };
+    return send_all(fd, iov, 3);
+}
+
+// Blocking; with stop, gives up within NET_POLL_MS once it is set
+static int recv_all(int fd, void *buf, size_t bytes, atomic_int *stop) {
+    unsigned char *p = buf;
+    while (bytes > 0) {
+        if (stop) {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            int ready = poll(&pfd, 1, NET_POLL_MS);
+            if (atomic_load(stop)) return -1;
+            if (ready <= 0) continue;
+        }
+        ssize_t got = recv(fd, p, bytes, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        p += got;
+        bytes -= (size_t)got;
+    }
+    return 0;
+}
+
+static int recv_frame(int fd, NetFrame *frame, atomic_int *stop) {
+    if (recv_all(fd, frame, sizeof(*frame), stop) != 0) return -1;
+    return memcmp(frame->magic, NET_MAGIC, 4) == 0 ? 0 : -1;
+}
+
+// FNV-1a; never 0, which means "no model"
+static uint64_t model_id(const unsigned char *data, size_t bytes) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < bytes; i++) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h ? h : 1;
+}
+
+// =============================================================================
+// COLLECTOR
+// =============================================================================
+
+typedef struct {
+    Collector *c;
+    int fd;
+} Connection;
+
+// Reload the cached model if the file was replaced (caller holds the lock)
+static void refresh_model(Collector *c) {
+    struct stat st;
+    if (stat(c->model_path, &st) != 0) return;  // Keep serving the last one
+    if (c->model && st.st_ino == c->model_ino && st.st_size == c->model_size &&
+        st.st_mtime == c->model_mtime) return;
+
+    size_t bytes = (size_t)st.st_size;
+    unsigned char *data = malloc(bytes ? bytes : 1);
+    FILE *f = fopen(c->model_path, "rb");
+    int ok = data && f && fread(data, 1, bytes, f) == bytes;
+    if (f) fclose(f);
+    if (!ok) {
+        free(data);
+        log_warn("[Collector] Cannot read model %s", c->model_path);
+        return;
+    }
+    free(c->model);
+    c->model = data;
+    c->model_bytes = bytes;
+    c->model_id = model_id(data, bytes);
+    c->model_ino = st.st_ino;
+    c->model_size = st.st_size;
+    c->model_mtime = st.st_mtime;
+    log_printf("[Collector] Serving model %016llx (%zu bytes)\n", (unsigned long long)c->model_id, bytes);
+}
+
+static int serve_model(Collector *c, int fd, uint64_t have) {
+    pthread_mutex_lock(&c->lock);
+    refresh_model(c);
+    uint64_t id = c->model_id;
+    size_t bytes = (id != have) ? c->model_bytes : 0;
+    unsigned char *copy = bytes ? malloc(bytes) : NULL;
+    if (copy) memcpy(copy, c->model, bytes);
+    pthread_mutex_unlock(&c->lock);
+    if (bytes && !copy) return -1;
+
+    int res = send_frame(fd, NET_MODEL, &id, sizeof(id), copy, bytes);
+    free(copy);
+    return res;
+}
+
+static void* connection_main(void *arg) {
+    Connection *conn = arg;
+    Collector *c = conn->c;
+    int fd = conn->fd;
+    free(conn);
+
+    TrainingSample *samples = malloc(DATASET_BLOCK_SAMPLES * sizeof(TrainingSample));
+    unsigned char *payload = malloc(samples_payload_max());
+    size_t received = 0;
+    NetFrame frame;
+    while (samples && payload && recv_frame(fd, &frame, &c->stop) == 0) {
+        if (frame.type == NET_MODEL_QUERY && frame.bytes == sizeof(uint64_t)) {
+            uint64_t have;
+            if (recv_all(fd, &have, sizeof(have), &c->stop) != 0 || serve_model(c, fd, have) != 0) break;
+        } else if (frame.type == NET_SAMPLES && frame.bytes >= sizeof(uint32_t) &&
+                   frame.bytes <= samples_payload_max()) {
+            if (recv_all(fd, payload, (size_t)frame.bytes, &c->stop) != 0) break;
+            uint32_t n, status = 1;
+            memcpy(&n, payload, sizeof(n));
+            if (n > 0 && n <= DATASET_BLOCK_SAMPLES &&
+                dataset_decode_block(payload + sizeof(n), (size_t)frame.bytes - sizeof(n), n, samples) == 0 &&
+                sample_writer_push(&c->writer, samples, n) == 0) {
+                atomic_fetch_add(&c->received, n);
+                received += n;
+                status = 0;
+            }
+            if (send_frame(fd, NET_ACK, &status, sizeof(status), NULL, 0) != 0) break;
+        } else {
+            log_warn("[Collector] Malformed request, closing the connection");
+            break;
+        }
+    }
+    close(fd);
+    free(samples);
+    free(payload);
+    log_printf("[Collector] Worker disconnected after %zu samples\n", received);
+
+    pthread_mutex_lock(&c->lock);
+    c->connections--;
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+// Port of a bound IPv4 or IPv6 socket (0 on failure)
+static int bound_port(int fd) {
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*)&addr, &len) != 0) return 0;
+    if (addr.ss_family == AF_INET6) return ntohs(((struct sockaddr_in6*)&addr)->sin6_port);
+    return ntohs(((struct sockaddr_in*)&addr)->sin_port);
+}
+
+// First address of bind_addr:port that takes a listening socket
+static int listen_on(const char *bind_addr, int port) {
+    char service[8];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints, *list;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(bind_addr, service, &hints, &list) != 0) return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = list; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1, zero = 0;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        // "::" takes IPv4 workers too
+        if (ai->ai_family == AF_INET6) setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, 64) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+int collector_open(Collector *c, const char *bind_addr, int port, const char *data, const char *model_path,
+                   size_t max_samples) {
+    memset(c, 0, sizeof(*c));
+    snprintf(c->model_path, sizeof(c->model_path), "%s", model_path);
+    c->max_samples = max_samples;
+    atomic_init(&c->received, 0);
+    atomic_init(&c->stop, 0);
+
+    if (!bind_addr) bind_addr = NET_COLLECTOR_BIND;
+    c->listen_fd = listen_on(bind_addr, port);
+    c->port = c->listen_fd >= 0 ? bound_port(c->listen_fd) : 0;
+    if (c->port == 0) {
+        log_error("[Collector] Cannot listen on %s port %d", bind_addr, port);
+        if (c->listen_fd >= 0) close(c->listen_fd);
+        return -1;
+    }
+
+    if (sample_writer_open(&c->writer, data, 0, 0) != 0) {
+        close(c->listen_fd);
+        return -1;
+    }
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    return 0;
+}
+
+int collector_run(Collector *c) {
+    while (!atomic_load(&c->stop)) {
+        if (c->max_samples && atomic_load(&c->received) >= c->max_samples) break;
+        struct pollfd pfd = { c->listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, NET_POLL_MS) <= 0) continue;
+        int fd = accept(c->listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        Connection *conn = malloc(sizeof(Connection));
+        pthread_t thread;
+        pthread_mutex_lock(&c->lock);
+        c->connections++;
+        pthread_mutex_unlock(&c->lock);
+        if (conn) *conn = (Connection){ c, fd };
+        if (!conn || pthread_create(&thread, NULL, connection_main, conn) != 0) {
+            close(fd);
+            free(conn);
+            pthread_mutex_lock(&c->lock);
+            c->connections--;
+            pthread_mutex_unlock(&c->lock);
+            continue;
+        }
+        pthread_detach(thread);
+        log_printf("[Collector] Worker connected\n");
+    }
+
+    // Connections notice the stop within NET_POLL_MS
+    atomic_store(&c->stop, 1);
+    pthread_mutex_lock(&c->lock);
+    while (c->connections > 0) pthread_cond_wait(&c->cond, &c->lock);
+    pthread_mutex_unlock(&c->lock);
+    return sample_writer_close(&c->writer);
+}
+
+void collector_stop(Collector *c) {
+    atomic_store(&c->stop, 1);
+}
+
+void collector_close(Collector *c) {
+    sample_writer_close(&c->writer);  // No-op after collector_run
+    close(c->listen_fd);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->cond);
+    free(c->model);
+    c->model = NULL;
+}
+
+// =============================================================================
+// WORKER
+// =============================================================================
+
+int collector_client_connect(CollectorClient *cl, const char *host, int port) {
+    cl->fd = -1;
+    cl->failed = 0;
+    char service[8];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints, *list;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &list) != 0) return -1;
+
+    // Every address of host in turn (IPv6 and IPv4)
+    int fd = -1;
+    for (struct addrinfo *ai = list; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(list);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    cl->fd = fd;
+    return 0;
+}
+
+int collector_client_fetch_model(CollectorClient *cl, const char *path) {
+    NetFrame frame;
+    uint64_t id;
+    if (send_frame(cl->fd, NET_MODEL_QUERY, &cl->model_id, sizeof(cl->model_id), NULL, 0) != 0 ||
+        recv_frame(cl->fd, &frame, NULL) != 0 || frame.type != NET_MODEL ||
+        frame.bytes < sizeof(id) || frame.bytes - sizeof(id) > NET_MAX_MODEL_BYTES ||
+        recv_all(cl->fd, &id, sizeof(id), NULL) != 0) return -1;
+    size_t left = (size_t)(frame.bytes - sizeof(id));
+    if (left == 0) return 0;
+
+    // Streamed to a temporary file, then renamed over path. Any failure
+    // leaves the connection mid-frame: the caller reconnects.
+    char tmp[520];
+    snprintf(tmp, sizeof(tmp), "%s.part", path);
+    FILE *f = fopen(tmp, "wb");
+    unsigned char *buf = malloc(NET_CHUNK_BYTES);
+    int ok = f && buf;
+    while (ok && left > 0) {
+        size_t n = left < NET_CHUNK_BYTES ? left : NET_CHUNK_BYTES;
+        ok = recv_all(cl->fd, buf, n, NULL) == 0 && fwrite(buf, 1, n, f) == n;
+        left -= n;
+    }
+    free(buf);
+    if (f && fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    cl->model_id = id;
+    return 1;
+}
+
+int collector_client_send(CollectorClient *cl, const TrainingSample *samples, size_t count) {
+    unsigned char *payload = malloc(dataset_block_max_bytes(DATASET_BLOCK_SAMPLES));
+    if (!payload) return -1;
+    int res = 0;
+    while (res == 0 && count > 0) {
+        uint32_t n = count < DATASET_BLOCK_SAMPLES ? (uint32_t)count : DATASET_BLOCK_SAMPLES;
+        size_t bytes = dataset_encode_block(samples, n, payload);
+        NetFrame frame;
+        uint32_t status;
+        res = (send_frame(cl->fd, NET_SAMPLES, &n, sizeof(n), payload, bytes) == 0 &&
+               recv_frame(cl->fd, &frame, NULL) == 0 && frame.type == NET_ACK &&
+               frame.bytes == sizeof(status) && recv_all(cl->fd, &status, sizeof(status), NULL) == 0 &&
+               status == 0) ? 0 : -1;
+        samples += n;
+        count -= n;
+    }
+    free(payload);
+    return res;
+}
+
+void collector_client_close(CollectorClient *cl) {
+    if (cl->fd >= 0) close(cl->fd);
+    cl->fd = -1;
+}
+
+// Writer thread of a round: every write goes to the collector
+static int worker_sink(void *ctx, const TrainingSample *samples, size_t count) {
+    CollectorClient *cl = ctx;
+    if (!cl->failed && collector_client_send(cl, samples, count) != 0) {
+        log_error("[Worker] Lost the collector, the rest of this round is dropped");
+        cl->failed = 1;
+    }
+    return cl->failed ? -1 : 0;
+}
+
+void selfplay_worker_run(const char *host, int port, const char *model_path, int rounds,
+                         const SelfplayConfig *sp_cfg, const MCTSConfig *mcts_cfg,
+                         CNNWeights *weights, volatile sig_atomic_t *stop) {
+    CollectorClient cl = { -1, 0, 0 };
+    SelfplayConfig round_cfg = *sp_cfg;
+    round_cfg.sink = worker_sink;
+    round_cfg.sink_ctx = &cl;
+
+    for (int round = 0; !*stop && (rounds == 0 || round < rounds); ) {
+        if (cl.fd < 0 || cl.failed) {
+            collector_client_close(&cl);
+            if (collector_client_connect(&cl, host, port) != 0) {
+                log_warn("[Worker] Collector %s:%d unreachable, retrying in %ds", host, port, NET_RETRY_SECONDS);
+                sleep(NET_RETRY_SECONDS);
+                continue;
+            }
+            log_printf("[Worker] Connected to %s:%d\n", host, port);
+        }
+
+        // Hot swap: a model published since the last round replaces ours
+        int fetched = collector_client_fetch_model(&cl, model_path);
+        if (fetched < 0) {
+            cl.failed = 1;
+            continue;
+        }
+        if (fetched == 1) {
+            if (cnn_load_weights(weights, model_path) == 0) {
+                // The backend's device copy is a snapshot of the old weights
+                if (weights->backend && cnn_backend_attach(weights, weights->backend) != ERR_OK) {
+                    log_warn("[Worker] Cannot upload the model to the %s backend, using the CPU path",
+                             weights->backend->name);
+                    cnn_backend_detach(weights);
+                }
+                log_printf("[Worker] Loaded model %016llx\n", (unsigned long long)cl.model_id);
+            } else {
+                // Forget it: the next round asks for the model again
+                log_error("[Worker] Cannot load the received model %s", model_path);
+                cl.model_id = 0;
+            }
+        }
+
+        selfplay_run(&round_cfg, mcts_cfg);
+        round++;
+    }
+    collector_client_close(&cl);
+}
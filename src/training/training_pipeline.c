@@ -1,10 +1,15 @@
 /**
  * training_pipeline.c - High level training loop implementation
+ *
+ * The dataset is mapped and streamed (DatasetStream), never loaded whole:
+ * memory stays at one shuffle window plus the prefetch ring. Batches are
+ * decoded and assembled by a producer thread (BatchPrefetcher) while the
+ * previous one trains.
  */
 
 #include "dama/training/training_pipeline.h"
 #include "dama/training/dataset.h"
-#include "dama/common/rng.h"
+#include "dama/training/batch_prefetch.h"
 #include "dama/common/params.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,22 +25,14 @@
 // HELPERS
 // =============================================================================
 
-static void shuffle_samples(TrainingSample *arr, int n, RNG *rng) {
-    for (int i = n - 1; i > 0; i--) {
-        int j = rng_u32(rng) % (i + 1);
-        TrainingSample tmp = arr[i];
-        arr[i] = arr[j];
-        arr[j] = tmp;
-    }
-}
-
-// Validation loop - returns separate policy and value loss
-static void run_validation(CNNWeights *w, const TrainingSample *samples, int count, 
-                           float *out_p_loss, float *out_v_loss, float *out_acc) {
+// Validation over one chunk - accumulates policy/value loss and correct moves
+// (policy loss and accuracy over the samples that have a policy target)
+static void validate_chunk(CNNWeights *w, const TrainingSample *samples, int count, 
+                           double *sum_p_loss, double *sum_v_loss, int *sum_correct, int *sum_policies) {
     double total_p_loss = 0, total_v_loss = 0;
-    int correct_moves = 0;
+    int correct_moves = 0, policies = 0;
     
-    #pragma omp parallel for reduction(+:total_p_loss, total_v_loss, correct_moves)
+    #pragma omp parallel for reduction(+:total_p_loss, total_v_loss, correct_moves, policies)
     for (int i = 0; i < count; i++) {
         float policy[CNN_POLICY_SIZE];
         float value;
@@ -56,6 +53,8 @@ static void run_validation(CNNWeights *w, const TrainingSample *samples, int cou
         double v_loss = (value - samples[i].target_value) * (value - samples[i].target_value);
         total_p_loss += p_loss;
         total_v_loss += v_loss;
+        if (!training_sample_has_policy(&samples[i])) continue;  // Value-only
+        policies++;
         
         // Accuracy (top 1 move)
         int best_pred = 0;
@@ -75,9 +74,31 @@ static void run_validation(CNNWeights *w, const TrainingSample *samples, int cou
         }
     }
     
-    *out_p_loss = (float)(total_p_loss / count);
+    *sum_p_loss += total_p_loss;
+    *sum_v_loss += total_v_loss;
+    *sum_correct += correct_moves;
+    *sum_policies += policies;
+}
+
+// Validation loop (streamed in chunks) - returns separate policy and value loss
+static void run_validation(CNNWeights *w, BatchPrefetcher *val,
+                           float *out_p_loss, float *out_v_loss, float *out_acc) {
+    double total_p_loss = 0, total_v_loss = 0;
+    int correct_moves = 0, policies = 0;
+    size_t count = 0;
+    const TrainingSample *chunk;
+    int n;
+    
+    batch_prefetch_start(val);
+    while ((chunk = batch_prefetch_next(val, &n)) != NULL) {
+        validate_chunk(w, chunk, n, &total_p_loss, &total_v_loss, &correct_moves, &policies);
+        count += n;
+    }
+    
+    if (policies == 0) policies = 1;
+    *out_p_loss = (float)(total_p_loss / policies);
     *out_v_loss = (float)(total_v_loss / count);
-    *out_acc = (float)correct_moves / count;
+    *out_acc = (float)correct_moves / policies;
 }
 
 // =============================================================================
@@ -85,32 +106,44 @@ static void run_validation(CNNWeights *w, const TrainingSample *samples, int cou
 // =============================================================================
 
 void training_run(CNNWeights *weights, const TrainingPipelineConfig *cfg) {
-    // 1. Load Data
-    int count = dataset_get_count(cfg->data_path);
-    if (count <= 0) {
+    // 1. Map the data: startup cost does not depend on the file size
+    DatasetView view;
+    if (dataset_open(cfg->data_path, &view) != 0 || view.count == 0) {
         // Error or empty. 
         // We can't easily return error code from void, maybe add logging callback or return int.
         // Assuming caller checks file existence.
+        dataset_close(&view);
         if (cfg->on_init) cfg->on_init(0, 0);
         return;
     }
+    int count = (int)view.count;
     
-    TrainingSample *samples = malloc(count * sizeof(TrainingSample));
-    if (!samples) return; // OOM
-    
-    dataset_load(cfg->data_path, samples, count);
-    
-    // Shuffle
-    RNG rng;
-    rng_seed(&rng, time(NULL));
-    shuffle_samples(samples, count, &rng);
-    
-    // Split 90/10
+    // Split 90/10: validation is the tail of the file (the newest games), so
+    // no game has positions on both sides and nothing has to be read up front
     int n_val = count / 10;
     if (n_val < 100) n_val = (count > 100) ? 100 : count/5; // Ensure some validation
     int n_train = count - n_val;
-    TrainingSample *train_data = samples;
-    TrainingSample *val_data = samples + n_train;
+    
+    // Train batches: shuffled blocks; validation: in order, chunk by chunk.
+    // Both are assembled prefetch_depth batches ahead
+    int chunk = (cfg->batch_size > DATASET_BLOCK_SAMPLES) ? cfg->batch_size : DATASET_BLOCK_SAMPLES;
+    DatasetStream train_stream, val_stream;
+    BatchPrefetcher train_pf, val_pf;
+    int ok = 0;
+    if (dataset_stream_init(&train_stream, &view, 0, n_train, 1, (uint32_t)time(NULL)) == 0) {
+        if (dataset_stream_init(&val_stream, &view, n_train, n_val, 0, 1) == 0) {
+            if (batch_prefetch_init(&train_pf, &train_stream, cfg->batch_size, cfg->prefetch_depth) == 0) {
+                if (batch_prefetch_init(&val_pf, &val_stream, chunk, cfg->prefetch_depth) == 0) ok = 1;
+                else batch_prefetch_free(&train_pf);
+            }
+            if (!ok) dataset_stream_free(&val_stream);
+        }
+        if (!ok) dataset_stream_free(&train_stream);
+    }
+    if (!ok) {  // OOM
+        dataset_close(&view);
+        return;
+    }
     
     if (cfg->on_init) cfg->on_init(n_train, n_val);
     
@@ -135,18 +168,16 @@ void training_run(CNNWeights *weights, const TrainingPipelineConfig *cfg) {
         float display_lr = sqrtf(policy_lr * value_lr);
         if (cfg->on_epoch_start) cfg->on_epoch_start(epoch, cfg->epochs, display_lr);
         
-        // Shuffle train data
-        shuffle_samples(train_data, n_train, &rng);
+        // New block order and windows for this epoch
+        batch_prefetch_start(&train_pf);
         
         // Training Batches
         int num_batches = (n_train + cfg->batch_size - 1) / cfg->batch_size;
         float epoch_p_loss = 0, epoch_v_loss = 0;
+        const TrainingSample *batch;
+        int size, start = 0;
         
-        for (int b = 0; b < num_batches; b++) {
-            int start = b * cfg->batch_size;
-            int end = start + cfg->batch_size;
-            if (end > n_train) end = n_train;
-            int size = end - start;
+        for (int b = 0; (batch = batch_prefetch_next(&train_pf, &size)) != NULL; b++) {
             
             // Linear LR Warmup for first epoch (applies to both LRs)
             float effective_policy_lr = policy_lr;
@@ -158,7 +189,7 @@ void training_run(CNNWeights *weights, const TrainingPipelineConfig *cfg) {
             }
             
             float p_loss, v_loss;
-            cnn_train_step(weights, &train_data[start], size, effective_policy_lr, effective_value_lr, 0.0f, cfg->l2_decay, &p_loss, &v_loss);
+            cnn_train_step(weights, batch, size, effective_policy_lr, effective_value_lr, 0.0f, cfg->l2_decay, &p_loss, &v_loss);
             
             epoch_p_loss += p_loss * size;
             epoch_v_loss += v_loss * size;
@@ -166,13 +197,14 @@ void training_run(CNNWeights *weights, const TrainingPipelineConfig *cfg) {
             if (cfg->on_batch_log && b % 10 == 0) {
                 cfg->on_batch_log(b, num_batches, p_loss, v_loss, start + size);
             }
+            start += size;
         }
         epoch_p_loss /= n_train;
         epoch_v_loss /= n_train;
         
         // Validation
         float val_p_loss, val_v_loss, val_acc;
-        run_validation(weights, val_data, n_val, &val_p_loss, &val_v_loss, &val_acc);
+        run_validation(weights, &val_pf, &val_p_loss, &val_v_loss, &val_acc);
         float total_val_loss = val_p_loss + val_v_loss;
         
         // Improvement check (based on total validation loss)
@@ -213,7 +245,11 @@ void training_run(CNNWeights *weights, const TrainingPipelineConfig *cfg) {
     
     // Cleanup
     cnn_training_cleanup(); // Important for freeing thread-local buffers
-    free(samples);
+    batch_prefetch_free(&train_pf);
+    batch_prefetch_free(&val_pf);
+    dataset_stream_free(&train_stream);
+    dataset_stream_free(&val_stream);
+    dataset_close(&view);
     
     if (cfg->on_complete) cfg->on_complete(best_val_loss, best_epoch);
 }
@@ -3,12 +3,17 @@
  * 
  * Confident Local Optimization for Noisy Black-Box Parameter Tuning.
  * Uses local quadratic regression with LAPACK for least squares fitting.
+ * The normal equations grow by one rank-1 update per sample, so a refit
+ * costs the same at sample 20 and at sample 20000.
  * 
  * Algorithm:
  * 1. Collect samples (params, outcome)
  * 2. Fit quadratic model: f(x) = c + Σ l_i*x_i + Σ q_ij*x_i*x_j
  * 3. Discard samples confidently below mean
  * 4. Suggest next point by maximizing expected improvement
+ *
+ * Several suggestions may be in flight at once: pending points are fitted
+ * at the mean outcome ("constant liar") until their results come back.
  */
 
 #include "dama/tuning/clop.h"
@@ -17,17 +22,10 @@
 #include <string.h>
 #include <math.h>
 
-#ifdef __APPLE__
-#include <Accelerate/Accelerate.h>
-// Mac Accelerate uses __CLPK_integer which may not be defined
-typedef int lapack_int;
-#else
+#include "dama/common/math_backend.h"
+
+// LAPACK integer (LP64 in every backend)
 typedef int lapack_int;
-// Declare dgels for non-Apple
-extern void dgels_(char *trans, int *m, int *n, int *nrhs, 
-                   double *a, int *lda, double *b, int *ldb,
-                   double *work, int *lwork, int *info);
-#endif
 
 // =============================================================================
 // INTERNAL RNG (Xorshift32)
@@ -77,21 +75,19 @@ static int num_coefficients(int n) {
 }
 
 /**
- * Build design matrix row for quadratic model.
+ * Design row of a sample for the quadratic model, x normalized.
  * Row = [1, x1, x2, ..., xn, x1², x1*x2, ..., xn²]
  */
-static void build_design_row(const double *x, int n, double *row) {
-    int idx = 0;
+static void build_design_row(const CLOPState *state, const double *params, double *row) {
+    int n = state->num_params;
+    double *x = row + 1;
     
-    // Constant term
-    row[idx++] = 1.0;
-    
-    // Linear terms
-    for (int i = 0; i < n; i++) {
-        row[idx++] = x[i];
-    }
+    // Constant and linear terms
+    row[0] = 1.0;
+    normalize_params(state, params, x);
     
     // Quadratic terms (upper triangular including diagonal)
+    int idx = 1 + n;
     for (int i = 0; i < n; i++) {
         for (int j = i; j < n; j++) {
             row[idx++] = x[i] * x[j];
@@ -100,86 +96,63 @@ static void build_design_row(const double *x, int n, double *row) {
 }
 
 /**
- * Fit quadratic model using LAPACK least squares (dgels).
- * Solves: min ||Ax - b||² where A is design matrix, b is outcomes.
+ * Fold one design row with target y into the normal equations
+ * (AᵀA)β = Aᵀb: AᵀA += row rowᵀ (upper triangle), Aᵀb += y row.
+ */
+static void accumulate_row(int c, const double *row, double y, double *normal, double *rhs) {
+    cblas_dsyr(CblasColMajor, CblasUpper, c, 1.0, row, 1, normal, c);
+    cblas_daxpy(c, y, row, 1, rhs, 1);
+}
+
+/**
+ * Fit quadratic model by least squares: solves the normal equations kept
+ * up to date by clop_update with a Cholesky factorization (LAPACK dposv),
+ * so the cost depends on the number of coefficients, not of samples.
+ * Pending suggestions are extra rows at the mean observed outcome.
  */
 static int fit_quadratic_model(CLOPState *state) {
     if (state->num_samples < state->min_samples_for_model) {
         return 0;  // Not enough samples yet
     }
     
-    int m = state->num_samples;
-    int n = num_coefficients(state->num_params);
+    int c = num_coefficients(state->num_params);
     
-    if (m < n) {
+    if (state->num_samples < c) {
         return 0;  // Underdetermined system, skip fitting
     }
     
-    // Allocate design matrix (column-major for LAPACK)
-    double *A = malloc(m * n * sizeof(double));
-    double *b = malloc(m * sizeof(double));
+    double *A = malloc(c * c * sizeof(double));
+    double *b = malloc(c * sizeof(double));
     if (!A || !b) {
         free(A); free(b);
         return -1;
     }
+    memcpy(A, state->normal, c * c * sizeof(double));
+    memcpy(b, state->rhs, c * sizeof(double));
     
-    // Temporary for normalized params
-    double *norm_params = malloc(state->num_params * sizeof(double));
-    if (!norm_params) {
-        free(A); free(b);
-        return -1;
+    double mean = state->sum_outcomes / state->num_samples;
+    for (int i = 0; i < state->num_pending; i++) {
+        build_design_row(state, &state->pending[i * state->num_params], state->row);
+        accumulate_row(c, state->row, mean, A, b);
     }
     
-    // Build design matrix
-    for (int i = 0; i < m; i++) {
-        double *sample = &state->samples[i * state->num_params];
-        normalize_params(state, sample, norm_params);
-        
-        double row[64];  // Assume max 64 coefficients
-        build_design_row(norm_params, state->num_params, row);
-        
-        // Store in column-major order
-        for (int j = 0; j < n; j++) {
-            A[j * m + i] = row[j];
-        }
-        b[i] = state->outcomes[i];
-    }
-    
-    free(norm_params);
-    
-    // Call LAPACK dgels (least squares via QR)
-    lapack_int M = m;
-    lapack_int N_dim = n;  // Renamed to avoid conflict
+    lapack_int N = c;
     lapack_int nrhs = 1;
-    lapack_int lda = m;
-    lapack_int ldb = m > n ? m : n;
     lapack_int info;
-    
-    // Query workspace size
-    lapack_int lwork = -1;
-    double work_query;
-    dgels_("N", &M, &N_dim, &nrhs, A, &lda, b, &ldb, &work_query, &lwork, &info);
-    
-    lwork = (lapack_int)work_query;
-    double *work = malloc(lwork * sizeof(double));
-    if (!work) {
-        free(A); free(b);
-        return -1;
-    }
-    
-    // Solve least squares
-    dgels_("N", &M, &N_dim, &nrhs, A, &lda, b, &ldb, work, &lwork, &info);
-    
-    free(work);
+    dposv_("U", &N, &nrhs, A, &N, b, &N, &info);
     free(A);
     
-    if (info != 0) {
-        log_error("[CLOP] LAPACK dgels failed with info=%d", info);
+    if (info > 0) {
+        free(b);
+        return 0;  // Samples do not pin every coefficient yet, keep the last model
+    }
+    if (info < 0) {
+        log_error("[CLOP] LAPACK dposv failed with info=%d", info);
         free(b);
         return -1;
     }
     
-    // Extract coefficients from b (first n elements)
+    // Extract coefficients from b
     int idx = 0;
     state->constant = b[idx++];
     
@@ -242,11 +215,17 @@ int clop_init(CLOPState *state, const CLOPParamDef *param_defs,
     state->best_params = malloc(num_params * sizeof(double));
     state->samples = malloc(max_samples * num_params * sizeof(double));
     state->outcomes = malloc(max_samples * sizeof(double));
+    state->pending = malloc(max_samples * num_params * sizeof(double));
+    int c = num_coefficients(num_params);
+    state->normal = calloc(c * c, sizeof(double));
+    state->rhs = calloc(c, sizeof(double));
+    state->row = malloc(c * sizeof(double));
     state->linear = malloc(num_params * sizeof(double));
     state->quadratic = malloc(num_params * num_params * sizeof(double));
     
     if (!state->current || !state->best_params || !state->samples ||
-        !state->outcomes || !state->linear || !state->quadratic) {
+        !state->outcomes || !state->pending || !state->normal || !state->rhs || !state->row ||
+        !state->linear || !state->quadratic) {
         clop_free(state);
         return -1;
     }
@@ -272,11 +251,24 @@ int clop_init(CLOPState *state, const CLOPParamDef *param_defs,
     return 0;
 }
 
-int clop_suggest(CLOPState *state, double *params_out) {
-    if (!state || !params_out) {
-        return -1;
+// Position of params among the pending suggestions, -1 if absent
+static int find_pending(const CLOPState *state, const double *params) {
+    size_t size = state->num_params * sizeof(double);
+    for (int i = 0; i < state->num_pending; i++) {
+        if (memcmp(&state->pending[i * state->num_params], params, size) == 0) return i;
     }
-    
+    return -1;
+}
+
+static void remove_pending(CLOPState *state, int idx) {
+    int n = state->num_params;
+    state->num_pending--;
+    if (idx != state->num_pending) {
+        memcpy(&state->pending[idx * n], &state->pending[state->num_pending * n], n * sizeof(double));
+    }
+}
+
+static int suggest_point(CLOPState *state, double *params_out) {
     int n = state->num_params;
     
     // Early phase: Latin Hypercube / random exploration
@@ -353,12 +345,35 @@ int clop_suggest(CLOPState *state, double *params_out) {
     return 0;
 }
 
+int clop_suggest(CLOPState *state, double *params_out) {
+    if (!state || !params_out) {
+        return -1;
+    }
+    
+    // Every suggestion will become a sample
+    if (state->num_samples + state->num_pending >= state->max_samples) {
+        log_error("[CLOP] Sample buffer full");
+        return -1;
+    }
+    
+    if (suggest_point(state, params_out) < 0) {
+        return -1;
+    }
+    
+    memcpy(&state->pending[state->num_pending * state->num_params], params_out,
+           state->num_params * sizeof(double));
+    state->num_pending++;
+    return 0;
+}
+
 int clop_update(CLOPState *state, const double *params, double outcome) {
     if (!state || !params) {
         return -1;
     }
     
-    if (state->num_samples >= state->max_samples) {
+    // Room for a sample that was never suggested only beyond the pending ones
+    int reserved = find_pending(state, params) >= 0 ? state->num_pending - 1 : state->num_pending;
+    if (state->num_samples + reserved >= state->max_samples) {
         log_error("[CLOP] Sample buffer full");
         return -1;
     }
@@ -370,6 +385,15 @@ int clop_update(CLOPState *state, const double *params, double outcome) {
     state->outcomes[idx] = outcome;
     state->num_samples++;
     
+    build_design_row(state, params, state->row);
+    accumulate_row(num_coefficients(state->num_params), state->row, outcome, state->normal, state->rhs);
+    state->sum_outcomes += outcome;
+    
+    int p = find_pending(state, params);
+    if (p >= 0) {
+        remove_pending(state, p);
+    }
+    
     // Update best if improved
     if (outcome > state->best_outcome) {
         state->best_outcome = outcome;
@@ -380,6 +404,19 @@ int clop_update(CLOPState *state, const double *params, double outcome) {
     return 0;
 }
 
+int clop_cancel(CLOPState *state, const double *params) {
+    if (!state || !params) {
+        return -1;
+    }
+    
+    int p = find_pending(state, params);
+    if (p < 0) {
+        return -1;
+    }
+    remove_pending(state, p);
+    return 0;
+}
+
 void clop_get_best(const CLOPState *state, double *params_out) {
     if (!state || !params_out) return;
     memcpy(params_out, state->best_params, state->num_params * sizeof(double));
@@ -389,6 +426,10 @@ int clop_get_num_samples(const CLOPState *state) {
     return state ? state->num_samples : 0;
 }
 
+int clop_get_num_pending(const CLOPState *state) {
+    return state ? state->num_pending : 0;
+}
+
 void clop_free(CLOPState *state) {
     if (!state) return;
     
@@ -396,6 +437,10 @@ void clop_free(CLOPState *state) {
     free(state->best_params);
     free(state->samples);
     free(state->outcomes);
+    free(state->pending);
+    free(state->normal);
+    free(state->rhs);
+    free(state->row);
     free(state->linear);
     free(state->quadratic);
     
@@ -1,112 +1,352 @@
 /**
  * bench_framework.h - Benchmark Framework
- * 
- * Provides timing utilities and benchmark registration.
+ *
+ * Provides timing utilities, per-repetition statistics and machine-readable
+ * output (JSON/CSV) with regression checks against a stored baseline.
+ *
+ * A timed loop is split into repetitions of BENCH_SAMPLE_MS (or one
+ * iteration, when an iteration lasts longer): each repetition gives one
+ * sample of the time per operation, and median, p95 and stddev are taken
+ * over the samples. The clock is monotonic.
+ *
+ * With perf_counters_enable() each run also brackets the calling thread's
+ * hardware counters and reports them per operation, or per bench_set_units
+ * unit (a search's nodes).
+ *
+ *   int iter = 0;
+ *   BenchRun run = bench_start();
+ *   while (bench_continue(&run, iter)) {
+ *       ...
+ *       iter++;
+ *   }
+ *   bench_record_result("name", iter, &run);
  */
 
 #ifndef BENCH_FRAMEWORK_H
 #define BENCH_FRAMEWORK_H
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <sys/time.h>
+
+#include "dama/common/perf_counters.h"
 
 // =============================================================================
 // TIMING UTILITIES
 // =============================================================================
 
 static inline double get_time_ms(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
 }
 
 static inline double get_time_us(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1e3;
 }
 
 // =============================================================================
-// BENCHMARK MACROS
+// TIMED RUNS
 // =============================================================================
 
-#define BENCH_WARMUP_ITERATIONS 3
-#define BENCH_MIN_ITERATIONS    10
 #define BENCH_TARGET_TIME_MS    1000.0  // Run benchmark for at least 1 second
+#define BENCH_MIN_ITERATIONS    10
+#define BENCH_SAMPLE_MS         50.0    // One repetition (~20 per benchmark)
+#define BENCH_MAX_SAMPLES       256
 
 typedef struct {
-    const char *name;
-    double total_time_ms;
+    double target_ms;
+    int min_iterations;
+    double start_ms;
+    double elapsed_ms;
+    double rep_start_ms;                // Current repetition
+    int rep_start_iter;
+    int num_samples;
+    double samples_us[BENCH_MAX_SAMPLES];   // Time per operation of each repetition
+    double units_per_iter;              // Counters are reported per unit (default: 1 "op")
+    const char *unit;
+    PerfReading perf_start;
+    PerfReading perf;                   // Whole run, once finished
+} BenchRun;
+
+static inline BenchRun bench_start_for(double target_ms, int min_iterations) {
+    BenchRun run;
+    memset(&run, 0, sizeof(run));
+    run.target_ms = target_ms;
+    run.min_iterations = min_iterations;
+    run.units_per_iter = 1.0;
+    run.unit = "op";
+    perf_counters_read(&run.perf_start);
+    run.start_ms = run.rep_start_ms = get_time_ms();
+    return run;
+}
+
+/** Report counters per `unit` (e.g. nodes), `per_iter` of them per iteration. */
+static inline void bench_set_units(BenchRun *run, double per_iter, const char *unit) {
+    run->units_per_iter = per_iter;
+    run->unit = unit;
+}
+
+static inline BenchRun bench_start(void) {
+    return bench_start_for(BENCH_TARGET_TIME_MS, BENCH_MIN_ITERATIONS);
+}
+
+static inline void bench_close_rep(BenchRun *run, double now, int iter) {
+    if (run->num_samples < BENCH_MAX_SAMPLES) {
+        run->samples_us[run->num_samples++] = (now - run->rep_start_ms) * 1000.0 / (iter - run->rep_start_iter);
+    }
+    run->rep_start_ms = now;
+    run->rep_start_iter = iter;
+}
+
+/**
+ * Loop condition of a timed benchmark, `iter` operations done so far.
+ * Closes the repetition in progress when it is long enough.
+ * @return 0 once the target time and the minimum iterations are reached
+ */
+static inline int bench_continue(BenchRun *run, int iter) {
+    const double now = get_time_ms();
+    if (iter > run->rep_start_iter && now - run->rep_start_ms >= BENCH_SAMPLE_MS) {
+        bench_close_rep(run, now, iter);
+    }
+    if (now - run->start_ms < run->target_ms || iter < run->min_iterations) return 1;
+
+    // A tail shorter than half a repetition is too noisy to be a sample
+    if (iter > run->rep_start_iter &&
+        (run->num_samples == 0 || now - run->rep_start_ms >= BENCH_SAMPLE_MS / 2)) {
+        bench_close_rep(run, now, iter);
+    }
+    run->elapsed_ms = now - run->start_ms;
+    PerfReading end;
+    perf_counters_read(&end);
+    perf_reading_delta(&run->perf, &end, &run->perf_start);
+    return 0;
+}
+
+// =============================================================================
+// RESULTS
+// =============================================================================
+
+#define BENCH_MAX_RESULTS       128
+
+typedef struct {
+    char section[32];
+    char name[64];
+    int is_metric;              // A value (memory, rate), not a timed loop
     int iterations;
+    int samples;
     double ops_per_sec;
-    double avg_time_us;
-    double min_time_us;
-    double max_time_us;
+    double mean_us;
+    double median_us;
+    double p95_us;
+    double stddev_us;
+    double value;               // Metrics only
+    char unit[32];
+    int has_perf;               // Timed results with hardware counters
+    char per[16];               // Unit the counters are divided by
+    double perf[PERF_EVENTS];
 } BenchResult;
 
-static inline void print_bench_header(void) {
-    printf("\n");
-    printf("╔════════════════════════════════════════════════════════════════════════╗\n");
-    printf("║                        BENCHMARK RESULTS                               ║\n");
-    printf("╠════════════════════════════════════════════════════════════════════════╣\n");
-    printf("║ %-35s │ %10s │ %12s │ %8s ║\n", "Benchmark", "Ops/sec", "Avg (μs)", "Iters");
-    printf("╠════════════════════════════════════════════════════════════════════════╣\n");
-}
-
-static inline void print_bench_result(BenchResult *r) {
-    printf("║ %-35s │ %10.0f │ %12.2f │ %8d ║\n", 
-           r->name, r->ops_per_sec, r->avg_time_us, r->iterations);
-}
-
-static inline void print_bench_separator(const char *section) {
-    printf("╠────────────────────────────────────────────────────────────────────────╣\n");
-    printf("║ %-70s ║\n", section);
-    printf("╠════════════════════════════════════════════════════════════════════════╣\n");
-}
-
-static inline void print_bench_footer(void) {
-    printf("╚════════════════════════════════════════════════════════════════════════╝\n\n");
-}
-
-// Run a benchmark function and collect stats
-#define RUN_BENCH(name, setup_code, bench_code, teardown_code) do { \
-    BenchResult _result = {0}; \
-    _result.name = name; \
-    _result.min_time_us = 1e9; \
-    _result.max_time_us = 0; \
-    \
-    /* Warmup */ \
-    for (int _w = 0; _w < BENCH_WARMUP_ITERATIONS; _w++) { \
-        setup_code; \
-        bench_code; \
-        teardown_code; \
-    } \
-    \
-    /* Actual benchmark */ \
-    double _start = get_time_ms(); \
-    while (_result.total_time_ms < BENCH_TARGET_TIME_MS || \
-           _result.iterations < BENCH_MIN_ITERATIONS) { \
-        setup_code; \
-        double _iter_start = get_time_us(); \
-        bench_code; \
-        double _iter_time = get_time_us() - _iter_start; \
-        teardown_code; \
-        \
-        if (_iter_time < _result.min_time_us) _result.min_time_us = _iter_time; \
-        if (_iter_time > _result.max_time_us) _result.max_time_us = _iter_time; \
-        _result.iterations++; \
-        _result.total_time_ms = get_time_ms() - _start; \
-    } \
-    \
-    _result.avg_time_us = (_result.total_time_ms * 1000.0) / _result.iterations; \
-    _result.ops_per_sec = _result.iterations / (_result.total_time_ms / 1000.0); \
-    print_bench_result(&_result); \
-} while(0)
-
-// Simpler version for benchmarks that don't need setup/teardown
-#define BENCH(name, code) RUN_BENCH(name, {}, code, {})
+static BenchResult bench_results[BENCH_MAX_RESULTS];
+static int bench_result_count = 0;
+static char bench_section[32] = "";
+
+static inline void bench_set_section(const char *section) {
+    snprintf(bench_section, sizeof(bench_section), "%s", section);
+}
+
+static int bench_cmp_double(const void *a, const void *b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static inline BenchResult bench_new_result(const char *name) {
+    BenchResult r;
+    memset(&r, 0, sizeof(r));
+    snprintf(r.section, sizeof(r.section), "%s", bench_section);
+    snprintf(r.name, sizeof(r.name), "%s", name);
+    return r;
+}
+
+static inline void bench_keep_result(const BenchResult *r) {
+    if (bench_result_count < BENCH_MAX_RESULTS) bench_results[bench_result_count++] = *r;
+}
+
+/** Statistics of a finished run; kept for the JSON/CSV output. */
+static inline BenchResult bench_record_result(const char *name, int iterations, const BenchRun *run) {
+    BenchResult r = bench_new_result(name);
+    r.iterations = iterations;
+    r.samples = run->num_samples;
+    r.ops_per_sec = iterations / (run->elapsed_ms / 1000.0);
+    r.mean_us = (run->elapsed_ms * 1000.0) / iterations;
+
+    double sorted[BENCH_MAX_SAMPLES];
+    const int n = run->num_samples;
+    memcpy(sorted, run->samples_us, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), bench_cmp_double);
+    if (n > 0) {
+        r.median_us = (n % 2) ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+        r.p95_us = sorted[(int)ceil(0.95 * n) - 1];
+        double mean = 0.0, var = 0.0;
+        for (int i = 0; i < n; i++) mean += sorted[i];
+        mean /= n;
+        for (int i = 0; i < n; i++) var += (sorted[i] - mean) * (sorted[i] - mean);
+        r.stddev_us = n > 1 ? sqrt(var / (n - 1)) : 0.0;
+    }
+    if (run->perf.count[PERF_CYCLES] > 0) {
+        const double units = iterations * run->units_per_iter;
+        r.has_perf = 1;
+        snprintf(r.per, sizeof(r.per), "%s", run->unit);
+        for (int e = 0; e < PERF_EVENTS; e++) r.perf[e] = run->perf.count[e] / units;
+    }
+    bench_keep_result(&r);
+    return r;
+}
+
+static inline void bench_record_metric(const char *name, double value, const char *unit) {
+    BenchResult r = bench_new_result(name);
+    r.is_metric = 1;
+    r.value = value;
+    snprintf(r.unit, sizeof(r.unit), "%s", unit);
+    bench_keep_result(&r);
+}
+
+// =============================================================================
+// MACHINE-READABLE OUTPUT
+// =============================================================================
+
+// Names hold no control characters; quotes and backslashes are escaped
+static inline void bench_json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+/**
+ * One result per line, so bench_compare_baseline reads the file back without
+ * a JSON parser.
+ * @return 0 on success, -1 if the file cannot be written
+ */
+static inline int bench_write_json(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "{\n  \"results\": [\n");
+    for (int i = 0; i < bench_result_count; i++) {
+        const BenchResult *r = &bench_results[i];
+        fprintf(f, "    {\"section\": ");
+        bench_json_string(f, r->section);
+        fprintf(f, ", \"name\": ");
+        bench_json_string(f, r->name);
+        if (r->is_metric) {
+            fprintf(f, ", \"kind\": \"metric\", \"value\": %.6g, \"unit\": ", r->value);
+            bench_json_string(f, r->unit);
+            fprintf(f, "}");
+        } else {
+            fprintf(f, ", \"kind\": \"time\", \"iterations\": %d, \"samples\": %d, \"ops_per_sec\": %.6g, "
+                       "\"mean_us\": %.6g, \"median_us\": %.6g, \"p95_us\": %.6g, \"stddev_us\": %.6g",
+                    r->iterations, r->samples, r->ops_per_sec, r->mean_us, r->median_us, r->p95_us, r->stddev_us);
+            if (r->has_perf) {
+                fprintf(f, ", \"per\": \"%s\", \"cycles\": %.6g, \"instructions\": %.6g, \"ipc\": %.4g, "
+                           "\"l1d_misses\": %.6g, \"branch_misses\": %.6g, \"llc_misses\": %.6g",
+                        r->per, r->perf[PERF_CYCLES], r->perf[PERF_INSTRUCTIONS],
+                        r->perf[PERF_INSTRUCTIONS] / r->perf[PERF_CYCLES],
+                        r->perf[PERF_L1D_MISSES], r->perf[PERF_BRANCH_MISSES], r->perf[PERF_LLC_MISSES]);
+            }
+            fprintf(f, "}");
+        }
+        fprintf(f, "%s\n", i + 1 < bench_result_count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static inline int bench_write_csv(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "section,name,kind,iterations,samples,ops_per_sec,mean_us,median_us,p95_us,stddev_us,value,unit,"
+               "per,cycles,instructions,ipc,l1d_misses,branch_misses,llc_misses\n");
+    for (int i = 0; i < bench_result_count; i++) {
+        const BenchResult *r = &bench_results[i];
+        if (r->is_metric) {
+            fprintf(f, "%s,\"%s\",metric,,,,,,,,%.6g,%s,,,,,,,\n", r->section, r->name, r->value, r->unit);
+        } else {
+            fprintf(f, "%s,\"%s\",time,%d,%d,%.6g,%.6g,%.6g,%.6g,%.6g,,,", r->section, r->name,
+                    r->iterations, r->samples, r->ops_per_sec, r->mean_us, r->median_us, r->p95_us, r->stddev_us);
+            if (r->has_perf) {
+                fprintf(f, "%s,%.6g,%.6g,%.4g,%.6g,%.6g,%.6g\n", r->per, r->perf[PERF_CYCLES],
+                        r->perf[PERF_INSTRUCTIONS], r->perf[PERF_INSTRUCTIONS] / r->perf[PERF_CYCLES],
+                        r->perf[PERF_L1D_MISSES], r->perf[PERF_BRANCH_MISSES], r->perf[PERF_LLC_MISSES]);
+            } else {
+                fprintf(f, ",,,,,,\n");
+            }
+        }
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// =============================================================================
+// BASELINE COMPARISON
+// =============================================================================
+
+// String value of "key" in a bench_write_json line (escapes removed)
+static inline int bench_json_field(const char *line, const char *key, char *out, size_t size) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\": \"", key);
+    const char *p = strstr(line, pattern);
+    if (!p) return 0;
+    p += strlen(pattern);
+    size_t n = 0;
+    for (; *p && *p != '"' && n + 1 < size; p++) {
+        if (*p == '\\' && p[1]) p++;
+        out[n++] = *p;
+    }
+    out[n] = '\0';
+    return 1;
+}
+
+/**
+ * Compare the timed results of this run with a baseline written by
+ * bench_write_json, on the median time per operation. Benchmarks missing
+ * on either side are skipped.
+ * @return Benchmarks slower than max_slowdown_pct, or -1 if the baseline
+ *         cannot be read
+ */
+static inline int bench_compare_baseline(const char *path, double max_slowdown_pct) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    printf("%-44s %12s %12s %9s\n", "Benchmark (median us/op)", "baseline", "current", "change");
+    int compared = 0, regressions = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        char section[32], name[64];
+        const char *median = strstr(line, "\"median_us\": ");
+        if (!median || !bench_json_field(line, "section", section, sizeof(section)) ||
+            !bench_json_field(line, "name", name, sizeof(name))) continue;
+        const double base = atof(median + strlen("\"median_us\": "));
+
+        for (int i = 0; i < bench_result_count; i++) {
+            const BenchResult *r = &bench_results[i];
+            if (r->is_metric || strcmp(r->section, section) != 0 || strcmp(r->name, name) != 0) continue;
+            if (base <= 0.0 || r->median_us <= 0.0) break;
+            const double change = (r->median_us / base - 1.0) * 100.0;
+            const int slow = change > max_slowdown_pct;
+            printf("%-44s %12.3f %12.3f %+8.1f%%%s\n", name, base, r->median_us, change, slow ? "  SLOWER" : "");
+            compared++;
+            regressions += slow;
+            break;
+        }
+    }
+    fclose(f);
+    printf("\n%d compared, %d slower than %.1f%%\n", compared, regressions, max_slowdown_pct);
+    return regressions;
+}
 
 #endif // BENCH_FRAMEWORK_H
@@ -8,13 +8,34 @@
  *   ./bin/run_bench engine    - Only engine benchmarks
  *   ./bin/run_bench neural    - Only neural benchmarks
  *   ./bin/run_bench mcts      - Only MCTS benchmarks
+ *   ./bin/run_bench training  - Only training benchmarks
+ *   ./bin/run_bench memory    - Memory footprint of search and training
+ *   ./bin/run_bench scaling   - Thread scaling of the presets (not in the full run)
+ *
+ * Options (after the filter, if any):
+ *   --json <file>          Write every result (median, p95, stddev) as JSON
+ *   --csv <file>           Same, as CSV
+ *   --baseline <file>      Compare with a JSON written before; exit 1 when
+ *                          a benchmark got slower than --max-slowdown
+ *   --max-slowdown <pct>   Allowed median slowdown (default: 10)
+ *   --max-threads <n>      Largest thread count of the scaling suite (default: CPUs)
+ *   --trace <file>         Chrome trace of the run (needs make TRACE=1)
+ *   --perf                 Hardware counters per result (Linux perf_event_open):
+ *                          cycles, IPC, L1D / branch / LLC misses per op or node
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE     // RUSAGE_THREAD
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <sys/time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "bench_framework.h"
 
 #include "dama/engine/game.h"
 #include "dama/engine/movegen.h"
@@ -22,25 +43,36 @@
 #include "dama/training/endgame.h"
 #include "dama/search/mcts.h"
 #include "dama/search/mcts_tree_stats.h"
+#include "dama/search/mcts_inference.h"
 #include "dama/neural/cnn.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/neural/cnn_quant.h"
+#include "dama/neural/conv_ops.h"
 #include "dama/training/dataset.h"
 #include "dama/common/rng.h"
 #include "dama/common/params.h"
+#include "dama/common/cli_view.h"
+#include "dama/common/trace.h"
+#include "dama/common/perf_counters.h"
 
 // =============================================================================
-// TIMING UTILITIES
+// OUTPUT
 // =============================================================================
 
-static double get_time_ms(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+static void print_result(const char *name, int iterations, const BenchRun *run) {
+    BenchResult r = bench_record_result(name, iterations, run);
+    printf("║ %-36s │ %12.0f │ %14.2f │ %10d║\n", name, r.ops_per_sec, r.mean_us, iterations);
+    if (!r.has_perf) return;
+    char line[96];
+    snprintf(line, sizeof(line), "per %s: %.0f cyc, IPC %.2f, L1D %.2f, br %.2f, LLC %.3f", r.per,
+             r.perf[PERF_CYCLES], r.perf[PERF_INSTRUCTIONS] / r.perf[PERF_CYCLES],
+             r.perf[PERF_L1D_MISSES], r.perf[PERF_BRANCH_MISSES], r.perf[PERF_LLC_MISSES]);
+    printf("║   %-79s║\n", line);
 }
 
-static void print_result(const char *name, int iterations, double total_ms) {
-    double ops_per_sec = iterations / (total_ms / 1000.0);
-    double avg_us = (total_ms * 1000.0) / iterations;
-    printf("║ %-36s │ %12.0f │ %14.2f │ %10d║\n", name, ops_per_sec, avg_us, iterations);
+static void print_metric(const char *name, double value, const char *unit) {
+    bench_record_metric(name, value, unit);
+    printf("║ %-36s │ %12.1f │ %-27s║\n", name, value, unit);
 }
 
 static void print_header(void) {
@@ -62,8 +94,19 @@ static void print_footer(void) {
     printf("╚══════════════════════════════════════════════════════════════════════════════════╝\n\n");
 }
 
-#define TARGET_TIME_MS 1000.0
-#define MIN_ITERATIONS 10
+// Phase profiles of the MCTS runs, printed after the table (make PROFILE=1)
+#define MAX_BENCH_PROFILES 8
+static struct {
+    char name[64];
+    MCTSProfile profile;
+} bench_profiles[MAX_BENCH_PROFILES];
+static int bench_profile_count = 0;
+
+static void keep_profile(const char *name, const MCTSStats *stats) {
+    if (bench_profile_count >= MAX_BENCH_PROFILES || mcts_profile_empty(&stats->profile)) return;
+    snprintf(bench_profiles[bench_profile_count].name, sizeof(bench_profiles[0].name), "%s", name);
+    bench_profiles[bench_profile_count++].profile = stats->profile;
+}
 
 // =============================================================================
 // ENGINE BENCHMARKS
@@ -71,19 +114,20 @@ static void print_footer(void) {
 
 static void bench_engine(void) {
     print_section("ENGINE MODULE");
+    bench_set_section("engine");
     
     // Move generation - initial position
     {
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             MoveList moves;
             movegen_generate(&state, &moves);
             iter++;
         }
-        print_result("movegen: initial position", iter, get_time_ms() - start);
+        print_result("movegen: initial position", iter, &run);
     }
     
     // Move generation - midgame
@@ -97,12 +141,115 @@ static void bench_engine(void) {
         }
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             movegen_generate(&base_state, &moves);
             iter++;
         }
-        print_result("movegen: midgame position", iter, get_time_ms() - start);
+        print_result("movegen: midgame position", iter, &run);
+        
+        PackedMoveList packed;
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            movegen_generate_packed(&base_state, &packed);
+            iter++;
+        }
+        print_result("movegen_packed: midgame position", iter, &run);
+        print_metric("memory: sizeof(MoveList)", (double)sizeof(MoveList), "bytes");
+        print_metric("memory: sizeof(PackedMoveList)", (double)sizeof(PackedMoveList), "bytes");
+    }
+    
+    // Simple moves and capture detection: set-wise shifts vs per-square tables
+    {
+        GameState base_state;
+        init_game(&base_state);
+        MoveList moves;
+        for (int i = 0; i < 10; i++) {
+            movegen_generate(&base_state, &moves);
+            if (moves.count > 0) apply_move(&base_state, &moves.moves[0]);
+        }
+        
+        int iter = 0;
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            movegen_generate_simple_table(&base_state, &moves);
+            iter++;
+        }
+        print_result("movegen_simple: table (midgame)", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            movegen_generate_simple(&base_state, &moves);
+            iter++;
+        }
+        print_result("movegen_simple: shift (midgame)", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            moves.count = 0;
+            movegen_generate_captures(&base_state, &moves);
+            volatile int any = moves.count > 0;
+            (void)any;
+            iter++;
+        }
+        print_result("any capture: DFS generate (midgame)", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            volatile int any = movegen_has_capture(&base_state);
+            (void)any;
+            iter++;
+        }
+        print_result("any capture: shift (midgame)", iter, &run);
+    }
+    
+    // Legal move counting (no MoveList)
+    {
+        GameState base_state;
+        init_game(&base_state);
+        MoveList moves;
+        for (int i = 0; i < 10; i++) {
+            movegen_generate(&base_state, &moves);
+            if (moves.count > 0) apply_move(&base_state, &moves.moves[0]);
+        }
+        
+        int iter = 0;
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            volatile int n = movegen_count(&base_state);
+            (void)n;
+            iter++;
+        }
+        print_result("movegen_count: midgame position", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            volatile int any = movegen_has_any_move(&base_state);
+            (void)any;
+            iter++;
+        }
+        print_result("movegen_has_any_move: midgame", iter, &run);
+    }
+    
+    // Perft (bulk counting at the last ply)
+    {
+        GameState state;
+        init_game(&state);
+        uint64_t nodes = 0;
+        
+        int iter = 0;
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            nodes = movegen_perft(&state, 6);
+            iter++;
+        }
+        print_result("perft: depth 6", iter, &run);
+        print_metric("perft: leaf nodes/sec", nodes * iter / (run.elapsed_ms / 1000.0) / 1e6, "M nodes/s");
     }
     
     // Apply move
@@ -114,25 +261,35 @@ static void bench_engine(void) {
         Move m = moves.moves[0];
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState copy = state;
             apply_move(&copy, &m);
             iter++;
         }
-        print_result("apply_move: simple move", iter, get_time_ms() - start);
+        print_result("apply_move: simple move", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            MoveUndo undo;
+            apply_move_with_undo(&state, &m, &undo);
+            undo_move(&state, &m, &undo);
+            iter++;
+        }
+        print_result("apply_move_with_undo + undo_move", iter, &run);
     }
     
     // Init game + hash
     {
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             iter++;
         }
-        print_result("init_game + zobrist", iter, get_time_ms() - start);
+        print_result("init_game + zobrist", iter, &run);
     }
     
     // Explicit Zobrist Compute Hash
@@ -141,13 +298,13 @@ static void bench_engine(void) {
         init_game(&state);
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             volatile uint64_t hash = zobrist_compute_hash(&state);
             (void)hash;
             iter++;
         }
-        print_result("zobrist_compute_hash", iter, get_time_ms() - start);
+        print_result("zobrist_compute_hash", iter, &run);
     }
     
     // Endgame generation
@@ -156,13 +313,13 @@ static void bench_engine(void) {
         rng_seed(&rng, 12345);
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             setup_random_endgame(&state, &rng);
             iter++;
         }
-        print_result("endgame: random position", iter, get_time_ms() - start);
+        print_result("endgame: random position", iter, &run);
     }
 }
 
@@ -172,6 +329,7 @@ static void bench_engine(void) {
 
 static void bench_neural(void) {
     print_section("NEURAL NETWORK MODULE");
+    bench_set_section("neural");
     
     CNNWeights weights;
     cnn_init(&weights);
@@ -179,19 +337,108 @@ static void bench_neural(void) {
     GameState state;
     init_game(&state);
     
-    // Single forward pass
+    // Conv kernels: one 64 -> 64 layer, a single position and a batch of 16
+    {
+        static float input[16 * 64 * 64], output[16 * 64 * 64];
+        for (int i = 0; i < 16 * 64 * 64; i++) input[i] = (float)(i % 7) * 0.1f;
+        
+        int iter = 0;
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            conv2d_forward_relu_s(input, weights.fused_conv2_w, weights.fused_conv2_b, output, CONV2_SHAPE);
+            iter++;
+        }
+        print_result("conv 64->64: im2col", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            conv3x3_winograd_relu(input, weights.wino_conv2_u, weights.fused_conv2_b, output, CONV2_SHAPE, 1);
+            iter++;
+        }
+        print_result("conv 64->64: winograd", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            for (int b = 0; b < 16; b++) {
+                conv2d_forward_relu_s(&input[b * 4096], weights.fused_conv2_w, weights.fused_conv2_b,
+                                      &output[b * 4096], CONV2_SHAPE);
+            }
+            iter++;
+        }
+        print_result("conv 64->64 x16: im2col", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            conv3x3_winograd_relu(input, weights.wino_conv2_u, weights.fused_conv2_b, output, CONV2_SHAPE, 16);
+            iter++;
+        }
+        print_result("conv 64->64 x16: winograd", iter, &run);
+    }
+    
+    // Conv1 + encoding: dense planes (im2col) vs set bits (patch adds)
+    {
+        GameState hist1 = state;
+        float dense[CNN_INPUT_CHANNELS * 64], output[64 * 64], player;
+        CNNSparseInput sparse;
+        
+        int iter = 0;
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            cnn_encode_state(&state, dense, &player);
+            encode_state_channels_canonical(&hist1, dense, 4);
+            conv2d_forward_relu_s(dense, weights.fused_conv1_w, weights.fused_conv1_b, output, CONV1_SHAPE);
+            iter++;
+        }
+        print_result("encode + conv1: dense", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            cnn_encode_sparse(&state, &hist1, NULL, &sparse);
+            conv3x3_sparse_relu(weights.sparse_conv1_w, weights.fused_conv1_b, &sparse, output, 64);
+            iter++;
+        }
+        print_result("encode + conv1: sparse", iter, &run);
+    }
+    
+    // Single forward pass, per conv algorithm
     {
         TrainingSample sample = {0};
         sample.state = state;
         CNNOutput out;
         
-        int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
-            cnn_forward_sample(&weights, &sample, &out);
-            iter++;
+        const CNNConvAlgo algos[] = {CNN_CONV_IM2COL, CNN_CONV_WINOGRAD};
+        const char *names[] = {"cnn_forward: single (im2col)", "cnn_forward: single (winograd)"};
+        CNNConvAlgo saved = cnn_get_conv_algo();
+        for (int a = 0; a < 2; a++) {
+            cnn_set_conv_algo(algos[a]);
+            int iter = 0;
+            BenchRun run = bench_start();
+            while (bench_continue(&run, iter)) {
+                cnn_forward_sample(&weights, &sample, &out);
+                iter++;
+            }
+            print_result(names[a], iter, &run);
+        }
+        cnn_set_conv_algo(saved);
+        
+        // Int8 model calibrated on the benchmark position itself
+        CNNQuantWeights q;
+        if (cnn_quant_calibrate(&weights, &sample, 1, &q) == 0) {
+            weights.quant = &q;
+            int iter = 0;
+            BenchRun run = bench_start();
+            while (bench_continue(&run, iter)) {
+                cnn_forward_sample(&weights, &sample, &out);
+                iter++;
+            }
+            print_result("cnn_forward: single (int8)", iter, &run);
+            weights.quant = NULL;
+            cnn_quant_free(&q);
         }
-        print_result("cnn_forward: single", iter, get_time_ms() - start);
     }
     
     // Forward with history
@@ -200,12 +447,66 @@ static void bench_neural(void) {
         CNNOutput out;
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             cnn_forward_with_history(&weights, &state, &hist1, NULL, &out);
             iter++;
         }
-        print_result("cnn_forward_with_history", iter, get_time_ms() - start);
+        print_result("cnn_forward_with_history", iter, &run);
+        
+        // Legal-move policy rows only (subset built inside the loop, as in search)
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            CNNPolicySubset legal;
+            cnn_policy_subset(&state, &legal);
+            cnn_forward_legal(&weights, &state, &hist1, NULL, &legal, &out);
+            iter++;
+        }
+        print_result("cnn_forward_legal", iter, &run);
+        
+        // FC head weight precision (the heads dominate a batch-1 forward)
+        const CNNHeadPrecision precs[] = {CNN_HEAD_FP32, CNN_HEAD_FP16};
+        const char *names[] = {"cnn_forward: heads fp32", "cnn_forward: heads fp16"};
+        CNNHeadPrecision saved = cnn_get_head_precision();
+        for (int p = 0; p < 2; p++) {
+            cnn_set_head_precision(precs[p]);
+            iter = 0;
+            run = bench_start();
+            while (bench_continue(&run, iter)) {
+                cnn_forward_with_history(&weights, &state, &hist1, NULL, &out);
+                iter++;
+            }
+            print_result(names[p], iter, &run);
+        }
+        cnn_set_head_precision(saved);
+    }
+    
+    // Eval cache: hit in place of a forward pass, and the store on a miss
+    {
+        GameState hist1 = state;
+        CNNOutput out;
+        cnn_forward_with_history(&weights, &state, &hist1, NULL, &out);
+        CNNCache *cache = cnn_cache_create(CNN_CACHE_SIZE_DEFAULT);
+        uint64_t key = cnn_cache_key(&state, &hist1, NULL);
+        
+        int iter = 0;
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            cnn_cache_store(cache, key, &state, &out);
+            iter++;
+        }
+        print_result("cnn_cache_store", iter, &run);
+        
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            volatile int hit = cnn_cache_probe(cache, key, &out);
+            (void)hit;
+            iter++;
+        }
+        print_result("cnn_cache_probe: hit", iter, &run);
+        cnn_cache_free(cache);
     }
     
     // Batch forward
@@ -220,13 +521,45 @@ static void bench_neural(void) {
             state_ptrs[i] = &states[i];
         }
         
+        const CNNConvAlgo algos[] = {CNN_CONV_IM2COL, CNN_CONV_WINOGRAD};
+        const char *names[] = {"cnn_forward_batch: 16 (im2col)", "cnn_forward_batch: 16 (winograd)"};
+        CNNConvAlgo saved = cnn_get_conv_algo();
+        for (int a = 0; a < 2; a++) {
+            cnn_set_conv_algo(algos[a]);
+            int iter = 0;
+            BenchRun run = bench_start();
+            while (bench_continue(&run, iter)) {
+                cnn_forward_batch(&weights, state_ptrs, NULL, NULL, outputs, BATCH_SIZE);
+                iter++;
+            }
+            print_result(names[a], iter, &run);
+        }
+        cnn_set_conv_algo(saved);
+        
+        const CNNHeadPrecision precs[] = {CNN_HEAD_FP32, CNN_HEAD_FP16};
+        const char *prec_names[] = {"cnn_forward_batch: 16 (heads fp32)", "cnn_forward_batch: 16 (heads fp16)"};
+        CNNHeadPrecision saved_prec = cnn_get_head_precision();
+        for (int p = 0; p < 2; p++) {
+            cnn_set_head_precision(precs[p]);
+            int iter = 0;
+            BenchRun run = bench_start();
+            while (bench_continue(&run, iter)) {
+                cnn_forward_batch(&weights, state_ptrs, NULL, NULL, outputs, BATCH_SIZE);
+                iter++;
+            }
+            print_result(prec_names[p], iter, &run);
+        }
+        cnn_set_head_precision(saved_prec);
+        
+        CNNPolicySubset legal[BATCH_SIZE];
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
-            cnn_forward_batch(&weights, state_ptrs, NULL, NULL, outputs, BATCH_SIZE);
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            for (int i = 0; i < BATCH_SIZE; i++) cnn_policy_subset(&states[i], &legal[i]);
+            cnn_forward_batch_legal(&weights, state_ptrs, NULL, NULL, legal, outputs, BATCH_SIZE);
             iter++;
         }
-        print_result("cnn_forward_batch: 16", iter, get_time_ms() - start);
+        print_result("cnn_forward_batch_legal: 16", iter, &run);
         #undef BATCH_SIZE
     }
     
@@ -238,12 +571,12 @@ static void bench_neural(void) {
         float player;
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             cnn_encode_sample(&sample, tensor, &player);
             iter++;
         }
-        print_result("cnn_encode_sample", iter, get_time_ms() - start);
+        print_result("cnn_encode_sample", iter, &run);
     }
     
     // Move index conversion
@@ -253,13 +586,13 @@ static void bench_neural(void) {
         m.path[1] = 20;
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             volatile int idx = cnn_move_to_index(&m, WHITE);
             (void)idx;
             iter++;
         }
-        print_result("cnn_move_to_index", iter, get_time_ms() - start);
+        print_result("cnn_move_to_index", iter, &run);
     }
     
     cnn_free(&weights);
@@ -271,12 +604,13 @@ static void bench_neural(void) {
 
 static void bench_mcts(void) {
     print_section("MCTS MODULE");
+    bench_set_section("mcts");
     
     // Root creation
     {
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             Arena arena;
@@ -287,15 +621,15 @@ static void bench_mcts(void) {
             arena_free(&arena);
             iter++;
         }
-        print_result("mcts_create_root", iter, get_time_ms() - start);
+        print_result("mcts_create_root", iter, &run);
     }
     
     // MCTS 100 nodes Vanilla
     {
         MCTSStats stats = {0};
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             Arena arena;
@@ -307,15 +641,16 @@ static void bench_mcts(void) {
             arena_free(&arena);
             iter++;
         }
-        print_result("mcts: 100 nodes (Vanilla)", iter, get_time_ms() - start);
+        bench_set_units(&run, 100, "node");
+        print_result("mcts: 100 nodes (Vanilla)", iter, &run);
     }
     
     // MCTS 500 nodes Vanilla
     {
         MCTSStats stats = {0};
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             Arena arena;
@@ -327,15 +662,40 @@ static void bench_mcts(void) {
             arena_free(&arena);
             iter++;
         }
-        print_result("mcts: 500 nodes (Vanilla)", iter, get_time_ms() - start);
+        bench_set_units(&run, 500, "node");
+        print_result("mcts: 500 nodes (Vanilla)", iter, &run);
+        keep_profile("mcts: 500 nodes (Vanilla)", &stats);
+    }
+    
+    // Batched playouts: the same 100 leaves, 1..ROLLOUT_BATCH_MAX rollouts each
+    for (int lanes = 1; lanes <= ROLLOUT_BATCH_MAX; lanes *= 2) {
+        int iter = 0;
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
+            GameState state;
+            init_game(&state);
+            Arena arena;
+            arena_init(&arena, ARENA_SIZE_BENCHMARK);
+            MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+            config.max_nodes = 100;
+            config.rollouts_per_leaf = lanes;
+            Node *root = mcts_create_root(state, &arena, config);
+            mcts_search(root, &arena, 10.0, config, NULL, NULL, NULL);
+            arena_free(&arena);
+            iter++;
+        }
+        bench_set_units(&run, 100, "node");
+        char name[64];
+        snprintf(name, sizeof(name), "mcts: 100 nodes (Vanilla, x%d)", lanes);
+        print_result(name, iter, &run);
     }
     
     // MCTS 100 nodes Grandmaster
     {
         MCTSStats stats = {0};
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             Arena arena;
@@ -347,14 +707,15 @@ static void bench_mcts(void) {
             arena_free(&arena);
             iter++;
         }
-        print_result("mcts: 100 nodes (Grandmaster)", iter, get_time_ms() - start);
+        bench_set_units(&run, 100, "node");
+        print_result("mcts: 100 nodes (Grandmaster)", iter, &run);
     }
     
     // Arena allocation
     {
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             Arena arena;
             arena_init(&arena, ARENA_SIZE_BENCHMARK);
             for (int i = 0; i < 1000; i++) {
@@ -363,7 +724,8 @@ static void bench_mcts(void) {
             arena_free(&arena);
             iter++;
         }
-        print_result("arena_alloc: 1000 nodes", iter, get_time_ms() - start);
+        bench_set_units(&run, 1000, "node");
+        print_result("arena_alloc: 1000 nodes", iter, &run);
     }
     
     // MCTS 1000 nodes with AlphaZero config (heavier)
@@ -373,8 +735,8 @@ static void bench_mcts(void) {
         cnn_init(&weights);
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             Arena arena;
@@ -387,16 +749,169 @@ static void bench_mcts(void) {
             arena_free(&arena);
             iter++;
         }
-        print_result("mcts: 1000 nodes (AlphaZero+CNN)", iter, get_time_ms() - start);
+        bench_set_units(&run, 1000, "node");
+        print_result("mcts: 1000 nodes (AlphaZero+CNN)", iter, &run);
+        keep_profile("mcts: 1000 nodes (AlphaZero+CNN)", &stats);
+        
+        // Same search, one CNN call per leaf (no sequential batching)
+        memset(&stats, 0, sizeof(stats));
+        iter = 0;
+        run = bench_start();
+        while (bench_continue(&run, iter)) {
+            GameState state;
+            init_game(&state);
+            Arena arena;
+            arena_init(&arena, ARENA_SIZE_BENCHMARK);
+            MCTSConfig config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+            config.max_nodes = 1000;
+            config.cnn_weights = &weights;
+            config.leaf_batch = 1;
+            Node *root = mcts_create_root(state, &arena, config);
+            mcts_search(root, &arena, 10.0, config, &stats, NULL, NULL);
+            arena_free(&arena);
+            iter++;
+        }
+        bench_set_units(&run, 1000, "node");
+        print_result("mcts: 1000 nodes (CNN, leaf_batch=1)", iter, &run);
+        keep_profile("mcts: 1000 nodes (CNN, leaf_batch=1)", &stats);
+        
+        // Parallel games (selfplay layout): local batches vs one shared server
+        for (int shared = 0; shared <= 1; shared++) {
+            const int games = 4;
+            InferenceServer server;
+            if (shared) inference_server_start(&server, &weights, games * MCTS_LEAF_BATCH, INFERENCE_SERVER_GATHER_US, 1);
+            
+            iter = 0;
+            run = bench_start();
+            while (bench_continue(&run, iter)) {
+                #pragma omp parallel for num_threads(games)
+                for (int g = 0; g < games; g++) {
+                    GameState state;
+                    init_game(&state);
+                    Arena arena;
+                    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+                    MCTSConfig config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+                    config.max_nodes = 400;
+                    config.cnn_weights = &weights;
+                    config.inference_server = shared ? &server : NULL;
+                    Node *root = mcts_create_root(state, &arena, config);
+                    mcts_search(root, &arena, 10.0, config, NULL, NULL, NULL);
+                    arena_free(&arena);
+                }
+                iter++;
+            }
+            print_result(shared ? "mcts: 4 games x 400 nodes (shared server)"
+                                : "mcts: 4 games x 400 nodes (per-game batches)", iter, &run);
+            if (shared) {
+                long batches = atomic_load(&server.total_batches);
+                print_metric("server avg batch", batches ? (double)atomic_load(&server.total_requests) / batches : 0.0, "leaves");
+                inference_server_stop(&server);
+            }
+        }
         
         cnn_free(&weights);
     }
     
+    // Tree memory footprint (arena bytes per node)
+    {
+        GameState state;
+        init_game(&state);
+        Arena arena;
+        arena_init(&arena, ARENA_SIZE_BENCHMARK);
+        MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+        config.max_nodes = 2000;
+        Node *root = mcts_create_root(state, &arena, config);
+        mcts_search(root, &arena, 10.0, config, NULL, NULL, NULL);
+        int nodes = get_tree_node_count(root);
+        print_metric("memory: sizeof(Node)", (double)sizeof(Node), "bytes");
+        print_metric("memory: arena/node (Vanilla 2000)", (double)arena.offset / nodes, "bytes/node");
+        arena_free(&arena);
+    }
+    
+    // Tree policy alone: root-to-leaf descents over a grown tree (no rollout)
+    {
+        GameState state;
+        init_game(&state);
+        Arena arena;
+        arena_init(&arena, ARENA_SIZE_BENCHMARK);
+        MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+        config.max_nodes = 20000;
+        Node *root = mcts_create_root(state, &arena, config);
+        mcts_search(root, &arena, 30.0, config, NULL, NULL, NULL);
+        
+        for (int puct = 0; puct <= 1; puct++) {
+            MCTSConfig c = config;
+            c.use_puct = puct;              // With the solver: the AlphaZero kernel
+            c.use_solver = puct;
+            SelectKernel select = mcts_select_kernel(&c);
+            int iter = 0;
+            BenchRun run = bench_start();
+            while (bench_continue(&run, iter)) {
+                Node *leaf = select(root, &c);
+                for (Node *n = leaf; n != root; n = n->parent) {
+                    atomic_fetch_sub(&n->virtual_loss, 1);
+                    child_stats_publish_virtual_loss(n);
+                }
+                iter++;
+            }
+            print_result(puct ? "select: descent (PUCT, 20000 nodes)" : "select: descent (UCB1, 20000 nodes)",
+                         iter, &run);
+        }
+        path_set_invalidate(&path_tls);
+        arena_free(&arena);
+    }
+    
+    // Repetition check in create_node: ancestor walk vs path set (deep line)
+    {
+        GameState state;
+        init_game(&state);
+        Arena tree, scratch;
+        arena_init(&tree, ARENA_SIZE_BENCHMARK);
+        arena_init(&scratch, ARENA_SIZE_BENCHMARK);
+        MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+        
+        // 512-ply line with distinct hashes, so the walk never stops early
+        const int line_depth = 512;
+        Node *root = mcts_create_root(state, &tree, config);
+        Node *leaf = root;
+        for (int i = 1; i < line_depth; i++) {
+            GameState s = state;
+            s.hash = zobrist_compute_hash(&state) ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL);
+            leaf = create_node(leaf, PM_NONE, s, &tree, config);
+        }
+        GameState child = state;
+        child.hash ^= 0x5555555555555555ULL;
+        
+        for (int use_path = 0; use_path <= 1; use_path++) {
+            path_set_invalidate(&path_tls);
+            if (use_path) {
+                Node *line[512];
+                int n = 0;
+                for (Node *p = leaf; p && n < line_depth; p = p->parent) line[n++] = p;
+                path_set_begin(&path_tls, root);
+                for (int i = n - 2; i >= 0; i--) path_set_push(&path_tls, line[i]);
+            }
+            
+            int iter = 0;
+            BenchRun run = bench_start();
+            while (bench_continue(&run, iter)) {
+                if (iter % 100000 == 0) arena_reset(&scratch);
+                create_node(leaf, PM_NONE, child, &scratch, config);
+                iter++;
+            }
+            print_result(use_path ? "create_node: depth 512 (path set)" : "create_node: depth 512 (walk)",
+                         iter, &run);
+        }
+        path_set_invalidate(&path_tls);
+        arena_free(&scratch);
+        arena_free(&tree);
+    }
+    
     // Transposition table operations
     {
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             TranspositionTable *tt = tt_create(4096);
             if (!tt) continue;
             
@@ -409,7 +924,7 @@ static void bench_mcts(void) {
             tt_free(tt);
             iter++;
         }
-        print_result("tt: create+free (4096)", iter, get_time_ms() - start);
+        print_result("tt: create+free (4096)", iter, &run);
     }
 
     // Parallel Scaling Benchmarks
@@ -423,13 +938,10 @@ static void bench_mcts(void) {
         int n_threads = threads_to_test[t];
         MCTSStats stats = {0};
         
-        int iter = 0;
-        double start = get_time_ms();
-        
         // We run fewer iterations for heavy threaded tests to save time
-        double target_time = 2000.0; 
-        
-        while (get_time_ms() - start < target_time || iter < 3) {
+        int iter = 0;
+        BenchRun run = bench_start_for(2000.0, 3);
+        while (bench_continue(&run, iter)) {
             GameState state;
             init_game(&state);
             Arena arena;
@@ -447,8 +959,314 @@ static void bench_mcts(void) {
         
         char name[64];
         snprintf(name, sizeof(name), "mcts: 800 nodes (%d threads)", n_threads);
-        print_result(name, iter, get_time_ms() - start);
+        print_result(name, iter, &run);
+        keep_profile(name, &stats);
+    }
+    
+    cnn_free(&weights);
+}
+
+// =============================================================================
+// THREAD SCALING
+// =============================================================================
+
+static int scaling_max_threads = 0;     // --max-threads (0: online CPUs)
+
+#define SCALING_MAX_COUNTS 16
+
+typedef struct {
+    int threads;
+    double ms_per_search;
+    double nps;                 // Root visits per second
+    double collisions;          // Lost expansion claims per 1000 root visits
+    double wait_us;             // Queue wait per leaf (make PROFILE=1)
+    long batches[PROFILE_BATCH_BINS];
+    long num_batches;
+} ScalingRow;
+
+// Next thread count: 0 (sequential), 1, 2, 4, ... and the maximum itself
+static int scaling_next(int threads) {
+    if (threads == 0) return 1;
+    if (threads < scaling_max_threads && threads * 2 > scaling_max_threads) return scaling_max_threads;
+    return threads * 2;
+}
+
+static ScalingRow scaling_run(const char *name, MCTSConfig config, int use_tt) {
+    ScalingRow row = { .threads = config.num_threads };
+    TranspositionTable *tt = use_tt ? tt_create(TT_SIZE_DEFAULT) : NULL;
+    MCTSStats stats = {0};
+    long visits = 0;
+    
+    int iter = 0;
+    BenchRun run = bench_start_for(BENCH_TARGET_TIME_MS, 3);
+    while (bench_continue(&run, iter)) {
+        GameState state;
+        init_game(&state);
+        Arena arena;
+        arena_init(&arena, ARENA_SIZE_BENCHMARK);
+        if (tt) tt_reset(tt);
+        Node *root = mcts_create_root(state, &arena, config);
+        mcts_search(root, &arena, 10.0, config, &stats, tt, NULL);
+        visits += atomic_load(&root->visits);
+        arena_free(&arena);
+        iter++;
+    }
+    tt_free(tt);
+    
+    row.ms_per_search = bench_record_result(name, iter, &run).median_us / 1000.0;
+    row.nps = visits / (run.elapsed_ms / 1000.0);
+    if (visits) row.collisions = 1000.0 * stats.expand_collisions / visits;
+    const MCTSProfile *p = &stats.profile;
+    if (p->calls[PROFILE_QUEUE_WAIT]) {
+        row.wait_us = p->ticks[PROFILE_QUEUE_WAIT] * mcts_profile_ns_per_tick() / 1e3 / p->calls[PROFILE_QUEUE_WAIT];
+    }
+    for (int b = 0; b < PROFILE_BATCH_BINS; b++) {
+        row.batches[b] = p->batches[b];
+        row.num_batches += p->batches[b];
+    }
+    return row;
+}
+
+/**
+ * One configuration over thread counts 0 (sequential), 1, 2, 4, ... max:
+ * time per search, NPS and speedup against one worker, lost expansion
+ * claims (the tree is lock-free: a contended leaf is backed up, not waited
+ * on) and, for CNN configs, the batch size distribution and the queue wait
+ * per leaf (both need make PROFILE=1).
+ */
+static void bench_scaling_config(const char *label, MCTSConfig base, int max_nodes, int use_tt) {
+    char title[96];
+    snprintf(title, sizeof(title), "SCALING: %s, %d nodes, %s", label, max_nodes, use_tt ? "TT" : "no TT");
+    print_section(title);
+    
+    ScalingRow rows[SCALING_MAX_COUNTS];
+    char names[SCALING_MAX_COUNTS][64];
+    int count = 0;
+    double nps_one = 0.0;
+    for (int threads = 0; threads <= scaling_max_threads && count < SCALING_MAX_COUNTS; threads = scaling_next(threads)) {
+        MCTSConfig config = base;
+        config.max_nodes = max_nodes;
+        config.num_threads = threads;
+        config.use_tt = use_tt;
+        snprintf(names[count], sizeof(names[0]), "scaling %s%s: %d threads", label, use_tt ? " +TT" : "", threads);
+        rows[count] = scaling_run(names[count], config, use_tt);
+        if (threads == 1) nps_one = rows[count].nps;
+        count++;
+    }
+    
+    printf("║ %-7s │ %9s │ %10s │ %8s │ %11s │ %8s │ %9s ║\n",
+           "threads", "ms/search", "NPS", "speedup", "coll./1k", "wait us", "avg batch");
+    for (int i = 0; i < count; i++) {
+        const ScalingRow *r = &rows[i];
+        const double speedup = nps_one > 0.0 ? r->nps / nps_one : 0.0;
+        double leaves = 0.0;    // Bin midpoints: bin b holds sizes 2^b .. 2^(b+1) - 1
+        for (int b = 0; b < PROFILE_BATCH_BINS; b++) leaves += r->batches[b] * ((3L << b) - 1) / 2.0;
+        const double avg_batch = r->num_batches ? leaves / r->num_batches : 0.0;
+        printf("║ %-7d │ %9.2f │ %10.0f │ %7.2fx │ %11.2f │ %8.1f │ %9.1f ║\n",
+               r->threads, r->ms_per_search, r->nps, speedup, r->collisions, r->wait_us, avg_batch);
+        
+        char metric[96];
+        snprintf(metric, sizeof(metric), "%s nps", names[i]);
+        bench_record_metric(metric, r->nps, "iterations/s");
+        snprintf(metric, sizeof(metric), "%s speedup", names[i]);
+        bench_record_metric(metric, speedup, "x vs 1 thread");
+        snprintf(metric, sizeof(metric), "%s collisions", names[i]);
+        bench_record_metric(metric, r->collisions, "per 1000 iterations");
+        if (!base.cnn_weights || !r->num_batches) continue;
+        
+        snprintf(metric, sizeof(metric), "%s queue wait", names[i]);
+        bench_record_metric(metric, r->wait_us, "us/leaf");
+        
+        // Batch sizes: share of batches per power-of-two bin
+        int used = printf("║   batches:");
+        for (int b = 0; b < PROFILE_BATCH_BINS; b++) {
+            if (!r->batches[b]) continue;
+            const double share = 100.0 * r->batches[b] / r->num_batches;
+            used += printf(" %d+:%.0f%%", 1 << b, share);
+            snprintf(metric, sizeof(metric), "%s batch %d+", names[i], 1 << b);
+            bench_record_metric(metric, share, "% of batches");
+        }
+        printf("%*s║\n", used < 85 ? 85 - used : 0, "");   // "║" is 3 bytes, 1 column
+    }
+}
+
+static void bench_scaling(void) {
+    bench_set_section("scaling");
+    if (scaling_max_threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        scaling_max_threads = cpus > 1 ? (int)cpus : 2;
+    }
+    
+    CNNWeights weights;
+    cnn_init(&weights);
+    MCTSConfig alpha_zero = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    alpha_zero.cnn_weights = &weights;
+    
+    for (int use_tt = 0; use_tt <= 1; use_tt++) {
+        bench_scaling_config("Vanilla", mcts_get_preset(MCTS_PRESET_VANILLA), 2000, use_tt);
+        bench_scaling_config("Grandmaster", mcts_get_preset(MCTS_PRESET_GRANDMASTER), 2000, use_tt);
+        bench_scaling_config("AlphaZero+CNN", alpha_zero, 800, use_tt);
+    }
+    
+    cnn_free(&weights);
+}
+
+// =============================================================================
+// MEMORY FOOTPRINT
+// =============================================================================
+
+typedef struct {
+    long nodes;
+    size_t child_slot_waste;    // Slots reserved for moves never expanded
+} TreeFootprint;
+
+// Nodes a tree owns (transposition links are counted once, by their parent)
+static void tree_footprint(const Node *node, TreeFootprint *fp) {
+    fp->nodes++;
+    if (!node->children) return;
+    fp->child_slot_waste += (size_t)(node->child_capacity - node->num_children) * CHILD_STATS_SLOT_BYTES;
+    for (int i = 0; i < node->num_children; i++) {
+        const Node *child = node->children[i];
+        if (child && child->parent == node) tree_footprint(child, fp);
+    }
+}
+
+/**
+ * One single-threaded search per preset, then what it cost in memory:
+ * arena bytes per node and per expanded child, child-block slots left
+ * unused and chunk tails (both waste), the arena high water, the TT
+ * occupancy and the CNN cache footprint.
+ */
+static void bench_memory_config(const char *label, MCTSConfig config, int max_nodes, CNNCache *cache) {
+    char title[96], metric[96];
+    snprintf(title, sizeof(title), "MEMORY: %s, %d nodes", label, max_nodes);
+    print_section(title);
+    config.max_nodes = max_nodes;
+    config.num_threads = 0;
+    config.use_tt = 1;
+    config.cnn_cache = cache;
+    
+    TranspositionTable *tt = tt_create(TT_SIZE_DEFAULT);
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    if (cache) cnn_cache_clear(cache);
+    GameState state;
+    init_game(&state);
+    MCTSStats stats = {0};
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 10.0, config, &stats, tt, NULL);
+    
+    TreeFootprint fp = {0};
+    tree_footprint(root, &fp);
+    const size_t in_use = arena_bytes_in_use(&arena);
+    const size_t handed_out = atomic_load(&arena.offset);
+    
+    snprintf(metric, sizeof(metric), "%s: bytes/node", label);
+    print_metric(metric, fp.nodes ? (double)in_use / fp.nodes : 0.0, "arena bytes");
+    snprintf(metric, sizeof(metric), "%s: bytes/child", label);
+    print_metric(metric, compute_tree_stats(&stats).bytes_per_child, "arena bytes");
+    snprintf(metric, sizeof(metric), "%s: unused child slots", label);
+    print_metric(metric, fp.child_slot_waste / 1024.0, "KB");
+    snprintf(metric, sizeof(metric), "%s: chunk tails", label);
+    print_metric(metric, (handed_out > (size_t)stats.arena_bytes ? handed_out - stats.arena_bytes : 0) / 1024.0, "KB");
+    snprintf(metric, sizeof(metric), "%s: arena high water", label);
+    print_metric(metric, stats.arena_high_water / 1024.0, "KB");
+    snprintf(metric, sizeof(metric), "%s: TT occupancy", label);
+    print_metric(metric, 100.0 * atomic_load(&tt->count) / tt->size, "% of entries");
+    if (cache) {
+        snprintf(metric, sizeof(metric), "%s: NN cache size", label);
+        print_metric(metric, cache->size * sizeof(CNNCacheEntry) / 1024.0, "KB");
+        snprintf(metric, sizeof(metric), "%s: NN cache filled", label);
+        print_metric(metric, stats.nn_cache_misses * sizeof(CNNCacheEntry) / 1024.0, "KB (one entry per miss)");
+    }
+    
+    arena_free(&arena);
+    tt_free(tt);
+}
+
+// Page faults of the calling thread so far
+static long thread_page_faults(void) {
+    struct rusage ru;
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &ru);
+#else
+    getrusage(RUSAGE_SELF, &ru);
+#endif
+    return ru.ru_minflt + ru.ru_majflt;
+}
+
+/**
+ * The first search on a fresh arena of each backing: its time and the page
+ * faults the search thread took (pre-faulting moves them to another thread,
+ * huge pages divide them by 512).
+ */
+static void bench_arena_backing(const char *label, const ArenaOptions *backing, int max_nodes) {
+    char metric[96];
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = max_nodes;
+    config.num_threads = 0;
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    if (arena_init_with(&arena, ARENA_SIZE_SELFPLAY, backing) != 0) return;
+    const long faults = thread_page_faults();
+    const double start = get_time_ms();
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 0.0, config, NULL, NULL, NULL);
+    const double ms = get_time_ms() - start;
+    
+    snprintf(metric, sizeof(metric), "%s: first search", label);
+    print_metric(metric, ms, "ms");
+    snprintf(metric, sizeof(metric), "%s: page faults", label);
+    print_metric(metric, (double)(thread_page_faults() - faults), "in the search thread");
+    arena_free(&arena);
+}
+
+// Resident memory one training step adds per sample (samples and the step's buffers)
+static double train_bytes_per_sample(CNNWeights *weights, int batch) {
+    const size_t before = get_current_rss();
+    TrainingSample *samples = calloc(batch, sizeof(TrainingSample));
+    if (!samples) return 0.0;
+    for (int i = 0; i < batch; i++) {
+        init_game(&samples[i].state);
+        samples[i].target_policy[i % CNN_POLICY_SIZE] = 1.0f;
     }
+    float p, v;
+    cnn_train_step(weights, samples, batch, 0.01f, 0.001f, 0.0f, 0.0f, &p, &v);
+    const size_t after = get_current_rss();
+    free(samples);
+    return after > before ? (double)(after - before) / batch : 0.0;
+}
+
+static void bench_memory(void) {
+    bench_set_section("memory");
+    
+    CNNWeights weights;
+    cnn_init(&weights);
+    CNNCache *cache = cnn_cache_create(CNN_CACHE_SIZE_DEFAULT);
+    MCTSConfig alpha_zero = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    alpha_zero.cnn_weights = &weights;
+    
+    bench_memory_config("Vanilla", mcts_get_preset(MCTS_PRESET_VANILLA), 2000, NULL);
+    bench_memory_config("Grandmaster", mcts_get_preset(MCTS_PRESET_GRANDMASTER), 2000, NULL);
+    bench_memory_config("AlphaZero+CNN", alpha_zero, 800, cache);
+    cnn_cache_free(cache);
+    
+    print_section("MEMORY: ARENA BACKING, Vanilla 50000 nodes");
+    const ArenaOptions thp = { ARENA_PAGES_THP, 0, 0 };
+    bench_arena_backing("malloc", NULL, 50000);
+    bench_arena_backing("mmap + THP", &thp, 50000);
+    bench_arena_backing("mmap + THP + pre-fault", &ARENA_BACKING_SELFPLAY, 50000);
+    
+    print_section("MEMORY: TRAINING");
+    print_metric("TrainingSample", sizeof(TrainingSample), "bytes");
+    // One sample first, so fixed costs (gradients, first buffers) are not
+    // charged to a batch; then smallest batch first, as the thread-local
+    // buffers only grow
+    train_bytes_per_sample(&weights, 1);
+    print_metric("cnn_train_step: 32, RSS/sample", train_bytes_per_sample(&weights, 32), "bytes");
+    print_metric("cnn_train_step: 256, RSS/sample", train_bytes_per_sample(&weights, 256), "bytes");
     
     cnn_free(&weights);
 }
@@ -460,6 +1278,7 @@ static void bench_mcts(void) {
 
 static void bench_training(void) {
     print_section("TRAINING MODULE");
+    bench_set_section("training");
     
     CNNWeights weights;
     cnn_init(&weights);
@@ -473,12 +1292,12 @@ static void bench_training(void) {
         float p, v;
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             cnn_train_step(&weights, &sample, 1, 0.01f, 0.001f, 0.0f, 0.0f, &p, &v);
             iter++;
         }
-        print_result("cnn_train_step: batch=1", iter, get_time_ms() - start);
+        print_result("cnn_train_step: batch=1", iter, &run);
     }
     
     // Batch train step
@@ -493,13 +1312,20 @@ static void bench_training(void) {
         }
         float p, v;
         
-        int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
-            cnn_train_step(&weights, samples, BATCH, 0.01f, 0.001f, 0.0f, 0.0f, &p, &v);
-            iter++;
+        const CNNTrainAlgo algos[] = {CNN_TRAIN_PER_SAMPLE, CNN_TRAIN_BATCHED};
+        const char *names[] = {"cnn_train_step: 32 (per-sample)", "cnn_train_step: 32 (batched)"};
+        CNNTrainAlgo saved = cnn_get_train_algo();
+        for (int a = 0; a < 2; a++) {
+            cnn_set_train_algo(algos[a]);
+            int iter = 0;
+            BenchRun run = bench_start();
+            while (bench_continue(&run, iter)) {
+                cnn_train_step(&weights, samples, BATCH, 0.01f, 0.001f, 0.0f, 0.0f, &p, &v);
+                iter++;
+            }
+            print_result(names[a], iter, &run);
         }
-        print_result("cnn_train_step: batch=32", iter, get_time_ms() - start);
+        cnn_set_train_algo(saved);
         #undef BATCH
     }
     
@@ -512,12 +1338,12 @@ static void bench_training(void) {
         memset(samples, 0, N_SAMPLES * sizeof(TrainingSample));
         
         int iter = 0;
-        double start = get_time_ms();
-        while (get_time_ms() - start < TARGET_TIME_MS || iter < MIN_ITERATIONS) {
+        BenchRun run = bench_start();
+        while (bench_continue(&run, iter)) {
             dataset_shuffle(samples, N_SAMPLES);
             iter++;
         }
-        print_result("dataset_shuffle: 1000", iter, get_time_ms() - start);
+        print_result("dataset_shuffle: 1000", iter, &run);
         
         free(samples);
         #undef N_SAMPLES
@@ -534,7 +1360,19 @@ int main(int argc, char **argv) {
     zobrist_init();
     movegen_init();
     
-    const char *filter = (argc > 1) ? argv[1] : NULL;
+    const char *filter = NULL;
+    const char *json_path = NULL, *csv_path = NULL, *baseline = NULL;
+    double max_slowdown = 10.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i+1 < argc) json_path = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0 && i+1 < argc) csv_path = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i+1 < argc) baseline = argv[++i];
+        else if (strcmp(argv[i], "--max-slowdown") == 0 && i+1 < argc) max_slowdown = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-threads") == 0 && i+1 < argc) scaling_max_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--trace") == 0 && i+1 < argc) trace_open(argv[++i]);
+        else if (strcmp(argv[i], "--perf") == 0) perf_counters_enable();
+        else if (argv[i][0] != '-' && argv[i][0] != '\0') filter = argv[i];
+    }
     
     print_header();
     
@@ -554,7 +1392,38 @@ int main(int argc, char **argv) {
         bench_training();
     }
     
+    if (!filter || strcmp(filter, "memory") == 0) {
+        bench_memory();
+    }
+    
+    // Long (presets x TT x thread counts): only on request
+    if (filter && strcmp(filter, "scaling") == 0) {
+        bench_scaling();
+    }
+    
     print_footer();
     
+    for (int i = 0; i < bench_profile_count; i++) {
+        SearchProfileView view = { .title = bench_profiles[i].name, .profile = &bench_profiles[i].profile };
+        cli_view_print_search_profile(&view);
+    }
+    
+    if (json_path && bench_write_json(json_path) != 0) {
+        fprintf(stderr, "Cannot write %s\n", json_path);
+        return 1;
+    }
+    if (csv_path && bench_write_csv(csv_path) != 0) {
+        fprintf(stderr, "Cannot write %s\n", csv_path);
+        return 1;
+    }
+    if (baseline) {
+        int slower = bench_compare_baseline(baseline, max_slowdown);
+        if (slower < 0) {
+            fprintf(stderr, "Cannot read baseline %s\n", baseline);
+            return 1;
+        }
+        if (slower > 0) return 1;
+    }
+    
     return 0;
 }
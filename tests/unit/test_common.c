@@ -1,7 +1,7 @@
 /**
  * test_common.c - Unit Tests for Common Module
  * 
- * Tests: rng.h, params.h, logging.h
+ * Tests: rng.h, params.h, logging.h, math_backend.h
  */
 
 // Note: Includes are in test_main.c
@@ -226,3 +226,232 @@ TEST(common_debug_dbg_valid_color_passes) {
     DBG_VALID_COLOR(1);
 }
 
+
+// =============================================================================
+// MATH BACKEND TESTS
+// =============================================================================
+
+TEST(common_vec_kernels_match_scalar) {
+    // Odd length: full vectors plus a scalar tail
+    float x[37];
+    float max_ref = -1e30f, sum_ref = 0.0f;
+    for (int i = 0; i < 37; i++) {
+        x[i] = (float)((i * 7919) % 101) / 10.0f - 5.0f;
+        if (x[i] > max_ref) max_ref = x[i];
+        sum_ref += x[i];
+    }
+    ASSERT_FLOAT_EQ(max_ref, vec_max(x, 37), 0.0f);
+    ASSERT_FLOAT_EQ(sum_ref, vec_sum(x, 37), 1e-4f);
+    
+    vec_add_scalar(x, 2.5f, 37);
+    ASSERT_FLOAT_EQ(max_ref + 2.5f, vec_max(x, 37), 1e-6f);
+    
+    float y[37];
+    for (int i = 0; i < 37; i++) y[i] = x[i];
+    vec_add_scalar_relu(y, -2.5f, 37);
+    for (int i = 0; i < 37; i++) {
+        float ref = x[i] - 2.5f;
+        ASSERT_FLOAT_EQ(ref > 0 ? ref : 0.0f, y[i], 1e-6f);
+    }
+    ASSERT_TRUE(math_backend_name()[0] != '\0');
+}
+
+TEST(common_vec_softmax_matches_expf) {
+    float logits[512], out[512];
+    RNG rng;
+    rng_seed(&rng, 42);
+    for (int i = 0; i < 512; i++) logits[i] = rng_f32(&rng) * 60.0f - 30.0f;
+    
+    float max_l = -1e30f;
+    for (int i = 0; i < 512; i++) if (logits[i] > max_l) max_l = logits[i];
+    double ref[512], sum = 0.0;
+    for (int i = 0; i < 512; i++) sum += (ref[i] = exp((double)logits[i] - max_l));
+    
+    vec_softmax(logits, out, 512);
+    float total = 0.0f;
+    for (int i = 0; i < 512; i++) {
+        ASSERT_FLOAT_EQ((float)(ref[i] / sum), out[i], 1e-6f + 1e-5f * (float)(ref[i] / sum));
+        total += out[i];
+    }
+    ASSERT_FLOAT_EQ(1.0f, total, 1e-4f);
+    
+    // In place, as the training forward pass uses it
+    float in_place[5] = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f};
+    vec_softmax(in_place, in_place, 5);
+    float norm = 0.0f;
+    for (int k = 0; k < 5; k++) norm += expf((float)-k);
+    ASSERT_FLOAT_EQ(expf(-4.0f) / norm, in_place[0], 1e-6f);
+    ASSERT_FLOAT_EQ(1.0f / norm, in_place[4], 1e-6f);
+}
+
+TEST(common_vec_s8_kernels_match_scalar) {
+    // 7-bit activations, full-range weights; rows of odd and vector length
+    static int8_t x[4096], W[9 * 4096];
+    RNG rng;
+    rng_seed(&rng, 7);
+    for (int i = 0; i < 4096; i++) x[i] = (int8_t)(rng_u32(&rng) % 128);
+    for (int i = 0; i < 9 * 4096; i++) W[i] = (int8_t)((int)(rng_u32(&rng) % 255) - 127);
+    
+    int lens[2] = {4096, 37};
+    for (int t = 0; t < 2; t++) {
+        int n = lens[t];
+        int32_t y[9];
+        vec_gemv_s8(W, x, y, 9, n);
+        for (int r = 0; r < 9; r++) {
+            int32_t ref = 0;
+            for (int i = 0; i < n; i++) ref += (int32_t)x[i] * W[r * n + i];
+            ASSERT_EQ(ref, y[r]);
+            ASSERT_EQ(ref, vec_dot_s8(x, &W[r * n], n));
+        }
+    }
+    ASSERT_TRUE(vec_s8_name()[0] != '\0');
+}
+
+TEST(common_vec_f16_kernels_match_scalar) {
+    // Known encodings, at the start (vector path) and the end (scalar tail)
+    const float vals[8] = {1.0f, -2.0f, 65504.0f, 1e6f, 5.9604645e-8f, 0.1f, 0.0f, -0.5f};
+    const uint16_t bits[8] = {0x3C00, 0xC000, 0x7BFF, 0x7C00, 0x0001, 0x2E66, 0x0000, 0xB800};
+    float x[37] = {0};
+    uint16_t h[37];
+    for (int k = 0; k < 8; k++) x[k] = x[29 + k] = vals[k];
+    vec_f32_to_f16(x, h, 37);
+    for (int k = 0; k < 8; k++) {
+        ASSERT_EQ(bits[k], h[k]);
+        ASSERT_EQ(bits[k], h[29 + k]);
+    }
+    
+    // Widening is exact
+    const float widened[8] = {1.0f, -2.0f, 65504.0f, INFINITY, 5.9604645e-8f, 0.0999755859375f, 0.0f, -0.5f};
+    float back[37];
+    vec_f16_to_f32(h, back, 37);
+    for (int k = 0; k < 8; k++) {
+        ASSERT_TRUE(back[k] == widened[k]);
+        ASSERT_TRUE(back[29 + k] == widened[k]);
+    }
+    
+    // GEMV/GEMM against the fp32 dot products: only the weight rounding differs
+    enum { ROWS = 7, N = 4097, BATCH = 3 };
+    static float W[ROWS * N], X[BATCH * N];
+    static uint16_t W_h[ROWS * N];
+    RNG rng;
+    rng_seed(&rng, 3);
+    for (int i = 0; i < ROWS * N; i++) W[i] = rng_f32(&rng) * 0.2f - 0.1f;
+    for (int i = 0; i < BATCH * N; i++) X[i] = rng_f32(&rng);
+    vec_f32_to_f16(W, W_h, ROWS * N);
+    
+    float y[BATCH * ROWS] = {0};
+    vec_gemm_f16(W_h, N, X, N, y, ROWS, ROWS, N, BATCH);
+    for (int b = 0; b < BATCH; b++) {
+        float gemv[ROWS] = {0};
+        vec_gemv_f16(W_h, N, &X[b * N], gemv, ROWS, N);
+        for (int r = 0; r < ROWS; r++) {
+            double ref = 0.0;
+            for (int i = 0; i < N; i++) ref += (double)W[r * N + i] * X[b * N + i];
+            float dot = vec_dot_f16(&W_h[r * N], &X[b * N], N);
+            ASSERT_FLOAT_EQ((float)ref, dot, 0.05f);
+            ASSERT_FLOAT_EQ(dot, gemv[r], 1e-3f);
+            ASSERT_FLOAT_EQ(dot, y[b * ROWS + r], 1e-3f);
+        }
+    }
+    ASSERT_TRUE(vec_f16_name()[0] != '\0');
+}
+
+TEST(common_vec_bits_to_f32_expands_every_bit) {
+    const uint64_t patterns[] = {0, ~0ULL, 0x8000000000000001ULL, 0x00FF00FF0F0F3355ULL,
+                                 0xA5A5A5A5DEADBEEFULL};
+    float out[64];
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+        for (int i = 0; i < 64; i++) out[i] = -1.0f;
+        vec_bits_to_f32(patterns[p], out);
+        for (int i = 0; i < 64; i++) {
+            ASSERT_FLOAT_EQ((float)((patterns[p] >> i) & 1), out[i], 0.0f);
+        }
+    }
+}
+
+TEST(common_affinity_pins_and_releases_threads) {
+    AffinityPolicy p;
+    ASSERT_TRUE(affinity_parse("scatter", &p));
+    ASSERT_EQ(AFFINITY_SCATTER, p);
+    ASSERT_FALSE(affinity_parse("spread", &p));
+    
+    // No policy: nothing is pinned
+    pthread_attr_t attr;
+    ASSERT_EQ(AFFINITY_NONE, affinity_get_policy());
+    ASSERT_EQ(-1, affinity_pin_slot(0));
+    ASSERT_EQ(0, affinity_helper_attr(&attr));
+    
+#ifdef __linux__
+    affinity_set_policy(AFFINITY_COMPACT);
+    ASSERT_GE(affinity_num_nodes(), 1);
+    int cpu = affinity_pin_slot(0);
+    ASSERT_GE(cpu, 0);
+    ASSERT_EQ(cpu, affinity_pin_slot(0));
+    ASSERT_EQ(1, affinity_helper_attr(&attr));
+    pthread_attr_destroy(&attr);
+    
+    // Workers of a pinned search start on its node
+    zobrist_init();
+    movegen_init();
+    GameState state;
+    init_game(&state);
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 200;
+    config.num_threads = 2;
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 0.0, config, NULL, NULL, NULL);
+    ASSERT_GE(root->visits, 100);
+    arena_free(&arena);
+    
+    affinity_unpin();
+    affinity_set_policy(AFFINITY_NONE);
+#endif
+}
+
+static void* log_test_thread(void *arg) {
+    const int id = *(const int*)arg;
+    for (int i = 0; i < 600; i++) log_printf("t%d %d\n", id, i);
+    return NULL;
+}
+
+TEST(common_log_async_keeps_every_message_in_order) {
+    const char *path = "/tmp/test_async.log";
+    log_init(path);
+    
+    // Console copy goes to /dev/null; the file is what gets checked
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    ASSERT_TRUE(saved >= 0 && null_fd >= 0);
+    dup2(null_fd, STDOUT_FILENO);
+    
+    // More messages per thread than a ring holds: producers must wait, not drop
+    ASSERT_EQ(0, log_set_async(1));
+    pthread_t threads[3];
+    int ids[3] = {0, 1, 2};
+    for (int t = 0; t < 3; t++) pthread_create(&threads[t], NULL, log_test_thread, &ids[t]);
+    for (int t = 0; t < 3; t++) pthread_join(threads[t], NULL);
+    log_set_async(0);
+    log_close();
+    
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(null_fd);
+    
+    FILE *f = fopen(path, "r");
+    ASSERT_NOT_NULL(f);
+    int next[3] = {0, 0, 0};
+    int id, i, lines = 0;
+    while (fscanf(f, "t%d %d\n", &id, &i) == 2) {
+        ASSERT_TRUE(id >= 0 && id < 3);
+        ASSERT_EQ(next[id], i);
+        next[id]++;
+        lines++;
+    }
+    fclose(f);
+    remove(path);
+    ASSERT_EQ(1800, lines);
+}
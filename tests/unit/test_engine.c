@@ -1,7 +1,7 @@
 /**
  * test_engine.c - Unit Tests for Engine Module
  * 
- * Tests: game.h, movegen.h, endgame.h
+ * Tests: game.h, movegen.h, endgame.h, tablebase.h
  */
 
 // Note: Includes are in test_main.c
@@ -235,6 +235,214 @@ TEST(engine_lady_moves_all_directions) {
     ASSERT_GT(moves.count, 0);
 }
 
+// =============================================================================
+// MOVE COUNTING / PERFT TESTS
+// =============================================================================
+
+static uint64_t perft_by_generate(const GameState *s, int depth) {
+    if (depth == 0) return 1;
+    MoveList list;
+    movegen_generate(s, &list);
+    uint64_t n = 0;
+    for (int i = 0; i < list.count; i++) {
+        GameState next = *s;
+        apply_move(&next, &list.moves[i]);
+        n += perft_by_generate(&next, depth - 1);
+    }
+    return n;
+}
+
+TEST(engine_movegen_count_matches_generate) {
+    RNG rng;
+    rng_seed(&rng, 777);
+    
+    // Random playouts cover captures, multi-jumps, promotions and ladies
+    for (int game = 0; game < 50; game++) {
+        GameState state;
+        init_game(&state);
+        for (int ply = 0; ply < 150; ply++) {
+            MoveList list;
+            movegen_generate(&state, &list);
+            ASSERT_EQ(list.count, movegen_count(&state));
+            ASSERT_EQ(list.count > 0, movegen_has_any_move(&state));
+            if (list.count == 0) break;
+            apply_move(&state, &list.moves[rng_u32(&rng) % list.count]);
+        }
+    }
+}
+
+TEST(engine_movegen_has_any_move_blocked_position) {
+    GameState state;
+    init_game(&state);
+    state.piece[WHITE][PAWN] = 0;
+    state.piece[WHITE][LADY] = 0;
+    state.piece[BLACK][PAWN] = 0;
+    state.piece[BLACK][LADY] = 0;
+    
+    // White pawn on B2 (9) blocked by black pawns on A3 (16) and C3 (18),
+    // with D4 (27) occupied so C3 cannot be jumped
+    SET_BIT(state.piece[WHITE][PAWN], 9);
+    SET_BIT(state.piece[BLACK][PAWN], 16);
+    SET_BIT(state.piece[BLACK][PAWN], 18);
+    SET_BIT(state.piece[BLACK][PAWN], 27);
+    state.current_player = WHITE;
+    
+    ASSERT_FALSE(movegen_has_any_move(&state));
+    ASSERT_EQ(0, movegen_count(&state));
+    
+    // Free the landing square: now the capture is the only move
+    CLEAR_BIT(state.piece[BLACK][PAWN], 27);
+    ASSERT_TRUE(movegen_has_any_move(&state));
+    ASSERT_EQ(1, movegen_count(&state));
+}
+
+TEST(engine_perft_matches_full_generation) {
+    GameState state;
+    init_game(&state);
+    
+    // Reference counts for the Italian initial position
+    static const uint64_t expected[] = {1, 7, 49, 302, 1469, 7361, 36473};
+    for (int depth = 0; depth <= 6; depth++) {
+        ASSERT_EQ(expected[depth], movegen_perft(&state, depth));
+    }
+    for (int depth = 2; depth <= 5; depth++) {
+        ASSERT_EQ(perft_by_generate(&state, depth), movegen_perft(&state, depth));
+    }
+}
+
+TEST(engine_shift_movegen_matches_table) {
+    RNG rng;
+    rng_seed(&rng, 9001);
+    
+    for (int game = 0; game < 50; game++) {
+        GameState state;
+        init_game(&state);
+        for (int ply = 0; ply < 150; ply++) {
+            MoveList shift, table, captures;
+            movegen_generate_simple(&state, &shift);
+            movegen_generate_simple_table(&state, &table);
+            
+            // Same moves in the same order
+            ASSERT_EQ(table.count, shift.count);
+            for (int i = 0; i < table.count; i++) {
+                ASSERT_EQ(table.moves[i].path[0], shift.moves[i].path[0]);
+                ASSERT_EQ(table.moves[i].path[1], shift.moves[i].path[1]);
+                ASSERT_EQ(table.moves[i].is_lady_move, shift.moves[i].is_lady_move);
+            }
+            
+            captures.count = 0;
+            movegen_generate_captures(&state, &captures);
+            ASSERT_EQ(captures.count > 0, movegen_has_capture(&state));
+            
+            MoveList list;
+            movegen_generate(&state, &list);
+            if (list.count == 0) break;
+            apply_move(&state, &list.moves[rng_u32(&rng) % list.count]);
+        }
+    }
+}
+
+TEST(engine_packed_moves_roundtrip) {
+    RNG rng;
+    rng_seed(&rng, 31337);
+    
+    for (int game = 0; game < 50; game++) {
+        GameState state;
+        init_game(&state);
+        for (int ply = 0; ply < 150; ply++) {
+            MoveList list;
+            PackedMoveList packed;
+            movegen_generate(&state, &list);
+            movegen_generate_packed(&state, &packed);
+            ASSERT_EQ(list.count, packed.count);
+            if (list.count == 0) break;
+            
+            for (int i = 0; i < list.count; i++) {
+                const Move *m = &list.moves[i];
+                ASSERT_TRUE(packed.moves[i] == move_pack(m));
+                
+                Move back;
+                ASSERT_TRUE(movegen_unpack_move(&state, packed.moves[i], &back));
+                ASSERT_TRUE(moves_equal(m, &back));
+                ASSERT_EQ(m->is_lady_move, back.is_lady_move);
+                ASSERT_EQ(m->captured_ladies_count, back.captured_ladies_count);
+                ASSERT_EQ(m->first_captured_is_lady, back.first_captured_is_lady);
+                
+                GameState a = state, b = state;
+                apply_move(&a, m);
+                apply_packed_move(&b, packed.moves[i]);
+                ASSERT_TRUE(states_equal(&a, &b));
+                ASSERT_TRUE(a.hash == b.hash);
+            }
+            apply_move(&state, &list.moves[rng_u32(&rng) % list.count]);
+        }
+    }
+}
+
+TEST(engine_move_text_roundtrips) {
+    GameState state;
+    init_game(&state);
+    char text[MOVE_TEXT_MAX];
+    
+    // Every legal move along one game, captures and multi-jumps included
+    for (int ply = 0; ply < 60; ply++) {
+        MoveList list;
+        movegen_generate(&state, &list);
+        if (list.count == 0) break;
+        for (int i = 0; i < list.count; i++) {
+            const Move *m = &list.moves[i];
+            format_move(m, text, sizeof(text));
+            ASSERT_EQ((size_t)(2 + 3 * (m->length ? m->length : 1)), strlen(text));
+            Move parsed;
+            ASSERT_TRUE(parse_move(&state, text, &parsed));
+            ASSERT_EQ(move_pack(m), move_pack(&parsed));
+            text[0] = (char)tolower((unsigned char)text[0]);
+            ASSERT_TRUE(parse_move(&state, text, &parsed));
+        }
+        apply_move(&state, &list.moves[(ply * 7) % list.count]);
+    }
+    
+    init_game(&state);
+    ASSERT_TRUE(parse_move(&state, "B3-A4", &(Move){0}));
+    ASSERT_FALSE(parse_move(&state, "B3-A4x", &(Move){0}));
+    ASSERT_FALSE(parse_move(&state, "B3", &(Move){0}));
+    ASSERT_FALSE(parse_move(&state, "A6-B5", &(Move){0}));
+}
+
+TEST(engine_undo_move_restores_state) {
+    RNG rng;
+    rng_seed(&rng, 4242);
+    
+    // Every legal move along random games: apply_move_with_undo must match
+    // apply_move, and undo_move must give back the original position
+    for (int game = 0; game < 30; game++) {
+        GameState state;
+        init_game(&state);
+        for (int ply = 0; ply < 150; ply++) {
+            MoveList list;
+            movegen_generate(&state, &list);
+            if (list.count == 0) break;
+            
+            for (int i = 0; i < list.count; i++) {
+                GameState expected = state;
+                apply_move(&expected, &list.moves[i]);
+                
+                GameState pos = state;
+                MoveUndo undo;
+                apply_move_with_undo(&pos, &list.moves[i], &undo);
+                ASSERT_TRUE(states_equal(&pos, &expected));
+                ASSERT_TRUE(pos.hash == expected.hash);
+                ASSERT_TRUE(pos.hash == zobrist_compute_hash(&pos));
+                
+                undo_move(&pos, &list.moves[i], &undo);
+                ASSERT_TRUE(states_equal(&pos, &state));
+                ASSERT_TRUE(pos.hash == state.hash);
+            }
+            apply_move(&state, &list.moves[rng_u32(&rng) % list.count]);
+        }
+    }
+}
+
 // =============================================================================
 // ENDGAME TESTS
 // =============================================================================
@@ -258,6 +466,119 @@ TEST(engine_endgame_generator_creates_valid_positions) {
     }
 }
 
+// =============================================================================
+// TABLEBASE TESTS
+// =============================================================================
+
+#define TEST_TB_DIR "/tmp/test_tablebase"
+
+static void tablebase_fixture_clear(void) {
+    DIR *d = opendir(TEST_TB_DIR);
+    if (!d) return;
+    struct dirent *ent;
+    char path[512];
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", TEST_TB_DIR, ent->d_name);
+        remove(path);
+    }
+    closedir(d);
+    rmdir(TEST_TB_DIR);
+}
+
+// All tables up to 3 pieces, built fresh
+static int tablebase_fixture(Tablebase *tb) {
+    tablebase_fixture_clear();
+    mkdir(TEST_TB_DIR, 0755);
+    if (tablebase_generate(TEST_TB_DIR, 3, NULL) != 0) return -1;
+    return tablebase_open(tb, TEST_TB_DIR);
+}
+
+// Same position with the colors swapped (board turned around)
+static GameState tablebase_flip(const GameState *s) {
+    GameState f = *s;
+    for (int c = 0; c < NUM_COLORS; c++) {
+        for (int t = 0; t < NUM_PIECE_TYPES; t++) {
+            Bitboard bb = s->piece[c][t], out = 0;
+            while (bb) {
+                SET_BIT(out, 63 - __builtin_ctzll(bb));
+                POP_LSB(bb);
+            }
+            f.piece[1 - c][t] = out;
+        }
+    }
+    f.current_player = (Color)(1 - s->current_player);
+    return f;
+}
+
+TEST(engine_tablebase_results_follow_from_moves) {
+    Tablebase tb;
+    ASSERT_GT(tablebase_fixture(&tb), 0);
+    ASSERT_EQ(3, tb.max_pieces);
+    
+    // Lady takes the last pawn
+    GameState s;
+    memset(&s, 0, sizeof(s));
+    SET_BIT(s.piece[WHITE][LADY], 19);
+    SET_BIT(s.piece[BLACK][PAWN], 28);
+    s.current_player = WHITE;
+    ASSERT_EQ(TB_WIN, tablebase_probe(&tb, &s));
+    s.current_player = BLACK;
+    ASSERT_NE(TB_UNKNOWN, tablebase_probe(&tb, &s));
+    
+    // Every result agrees with the results one move later and with the
+    // color-swapped position
+    RNG rng;
+    rng_seed(&rng, 777);
+    int counts[4] = {0};
+    for (int i = 0; i < 2000; i++) {
+        memset(&s, 0, sizeof(s));
+        const int pieces = 2 + (int)(rng_u32(&rng) % 2);
+        for (int k = 0; k < pieces; k++) {
+            const Color c = (k == 0) ? WHITE : (k == 1) ? BLACK : (Color)(rng_u32(&rng) % 2);
+            int sq;
+            do sq = DARK_SQUARES[rng_u32(&rng) % NUM_DARK_SQUARES];
+            while (TEST_BIT(get_all_occupied(&s), sq));
+            const int promo_row = (c == WHITE) ? 7 : 0;
+            const Piece t = (ROW(sq) == promo_row || rng_u32(&rng) % 2) ? LADY : PAWN;
+            SET_BIT(s.piece[c][t], sq);
+        }
+        s.current_player = (Color)(rng_u32(&rng) % 2);
+        
+        const TBResult r = tablebase_probe(&tb, &s);
+        ASSERT_NE(TB_UNKNOWN, r);
+        counts[r]++;
+        GameState flipped = tablebase_flip(&s);
+        ASSERT_EQ(r, tablebase_probe(&tb, &flipped));
+        
+        MoveList moves;
+        movegen_generate(&s, &moves);
+        int any_loss = 0, all_win = 1, any_draw = 0;
+        for (int m = 0; m < moves.count; m++) {
+            GameState next = s;
+            apply_move(&next, &moves.moves[m]);
+            const TBResult c = tablebase_probe(&tb, &next);
+            ASSERT_NE(TB_UNKNOWN, c);
+            any_loss |= (c == TB_LOSS);
+            any_draw |= (c == TB_DRAW);
+            all_win &= (c == TB_WIN);
+        }
+        if (r == TB_WIN) ASSERT_TRUE(any_loss);
+        if (r == TB_LOSS) ASSERT_TRUE(!any_loss && all_win);
+        if (r == TB_DRAW) ASSERT_TRUE(!any_loss && any_draw);
+    }
+    ASSERT_GT(counts[TB_WIN], 0);
+    ASSERT_GT(counts[TB_LOSS], 0);
+    ASSERT_GT(counts[TB_DRAW], 0);
+    
+    // Too many pieces
+    init_game(&s);
+    ASSERT_EQ(TB_UNKNOWN, tablebase_probe(&tb, &s));
+    
+    tablebase_close(&tb);
+    tablebase_fixture_clear();
+}
+
 // =============================================================================
 // BITBOARD TESTS
 // =============================================================================
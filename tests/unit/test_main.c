@@ -15,6 +15,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 // Include the test framework first
 #include "test_framework.h"
@@ -23,15 +28,44 @@
 #include "dama/engine/game.h"
 #include "dama/engine/movegen.h"
 #include "dama/engine/zobrist.h"
+#include "dama/engine/tablebase.h"
+#include "dama/engine/game_view.h"
 #include "dama/training/endgame.h"
 #include "dama/search/mcts.h"
 #include "dama/search/mcts_types.h"
+#include "dama/search/mcts_internal.h"
+#include "dama/search/mcts_worker.h"
+#include "dama/search/mcts_inference.h"
+#include "dama/search/mcts_pool.h"
+#include "dama/search/mcts_async.h"
+#include "dama/search/mcts_time.h"
+#include "dama/search/opening_book.h"
+#include "dama/search/search_cache.h"
+#include "dama/search/search_server.h"
+#include "dama/search/mcts_many.h"
+#include "dama/tournament/tournament.h"
+#include "dama/tuning/clop.h"
 #include "dama/neural/cnn.h"
+#include "dama/neural/cnn_cache.h"
+#include "dama/neural/cnn_quant.h"
+#include "dama/neural/cnn_backend.h"
+#include "dama/neural/conv_ops.h"
 #include "dama/training/dataset.h"
+#include "dama/training/batch_prefetch.h"
+#include "dama/training/replay_buffer.h"
+#include "dama/training/sample_writer.h"
+#include "dama/training/selfplay_net.h"
+#include "dama/training/reanalyse.h"
+#include "dama/training/book_games.h"
+#include "dama/training/dataset_dedupe.h"
+#include "dama/training/dataset_analysis.h"
 #include "dama/common/rng.h"
 #include "dama/common/params.h"
 #include "dama/common/error_codes.h"
 #include "dama/common/debug.h"
+#include "dama/common/math_backend.h"
+#include "dama/common/affinity.h"
+#include "dama/common/logging.h"
 
 // Include all test files
 #include "test_engine.c"
@@ -59,7 +93,15 @@ static void register_all_tests(void) {
     REGISTER_TEST(engine_apply_move_updates_board);
     REGISTER_TEST(engine_promotion_to_lady);
     REGISTER_TEST(engine_lady_moves_all_directions);
+    REGISTER_TEST(engine_movegen_count_matches_generate);
+    REGISTER_TEST(engine_movegen_has_any_move_blocked_position);
+    REGISTER_TEST(engine_perft_matches_full_generation);
+    REGISTER_TEST(engine_shift_movegen_matches_table);
+    REGISTER_TEST(engine_undo_move_restores_state);
+    REGISTER_TEST(engine_packed_moves_roundtrip);
+    REGISTER_TEST(engine_move_text_roundtrips);
     REGISTER_TEST(engine_endgame_generator_creates_valid_positions);
+    REGISTER_TEST(engine_tablebase_results_follow_from_moves);
     REGISTER_TEST(engine_bit_macros_work_correctly);
     REGISTER_TEST(engine_row_col_macros_work_correctly);
     
@@ -67,14 +109,40 @@ static void register_all_tests(void) {
     REGISTER_TEST(search_arena_init_and_alloc);
     REGISTER_TEST(search_arena_reset_clears_used);
     REGISTER_TEST(search_arena_alloc_multiple);
+    REGISTER_TEST(search_arena_reset_reuses_buffer);
+    REGISTER_TEST(search_arena_release_recycles_blocks);
+    REGISTER_TEST(search_arena_parallel_allocs_are_disjoint);
+    REGISTER_TEST(search_arena_mapped_backing_releases_on_reset);
+    REGISTER_TEST(search_pool_resets_slots_between_games);
+    REGISTER_TEST(search_inference_ring_is_fifo_and_bounded);
+    REGISTER_TEST(search_inference_ring_multi_producer_handoff);
+    REGISTER_TEST(search_expansion_claim_is_exclusive);
+    REGISTER_TEST(search_expand_with_policy_marks_expanded);
+    REGISTER_TEST(search_threaded_vanilla_search_is_consistent);
+    REGISTER_TEST(search_threaded_cnn_search_stops_at_node_limit);
+    REGISTER_TEST(search_threaded_search_stops_on_time);
+    REGISTER_TEST(search_deterministic_tree_ignores_threads_and_clock);
+    REGISTER_TEST(search_root_parallel_merges_root_statistics);
+    REGISTER_TEST(search_batched_rollouts_average_their_lanes);
+    REGISTER_TEST(search_move_heuristic_matches_square_rules);
+    REGISTER_TEST(search_sequential_leaf_batch_is_consistent);
+    REGISTER_TEST(search_nn_cache_hits_on_repeated_search);
+    REGISTER_TEST(search_inference_server_batches_across_searches);
     REGISTER_TEST(search_mcts_presets_have_valid_configs);
     REGISTER_TEST(search_create_root_returns_valid_node);
     REGISTER_TEST(search_create_root_generates_children);
+    REGISTER_TEST(search_expand_node_allocates_exact_children);
+    REGISTER_TEST(search_child_stats_mirror_children);
+    REGISTER_TEST(search_vectorized_selection_matches_scalar);
+    REGISTER_TEST(search_select_kernels_match_generic);
+    REGISTER_TEST(search_path_set_detects_repetition);
     REGISTER_TEST(search_mcts_search_returns_valid_move);
     REGISTER_TEST(search_mcts_search_increases_visits);
     REGISTER_TEST(search_mcts_stats_are_collected);
     REGISTER_TEST(search_get_tree_depth_returns_positive);
     REGISTER_TEST(search_get_tree_node_count_matches_stats);
+    REGISTER_TEST(search_incremental_stats_match_tree_walk);
+    REGISTER_TEST(search_profile_records_phases);
     REGISTER_TEST(search_mcts_get_policy_sums_to_one);
     REGISTER_TEST(search_mcts_get_policy_nonzero_entries);
     // New search tests
@@ -85,11 +153,37 @@ static void register_all_tests(void) {
     REGISTER_TEST(search_solver_detects_terminal);
     REGISTER_TEST(search_tt_create_and_free);
     REGISTER_TEST(search_tt_mask_is_power_of_two);
+    REGISTER_TEST(search_tt_bucket_is_one_cache_line);
+    REGISTER_TEST(search_tt_bucket_holds_multiple_positions);
+    REGISTER_TEST(search_tt_reset_invalidates_entries);
+    REGISTER_TEST(search_tt_busy_slot_is_neither_matched_nor_taken);
+    REGISTER_TEST(search_tt_stats_track_lookups);
     REGISTER_TEST(search_tree_reuse_preserves_stats);
+    REGISTER_TEST(search_advance_root_compacts_subtree);
+    REGISTER_TEST(search_advance_root_swaps_arena_backing);
+    REGISTER_TEST(search_advance_root_rejects_unknown_position);
+    REGISTER_TEST(search_prune_tree_keeps_root_statistics);
+    REGISTER_TEST(search_bounded_memory_search_stays_within_budget);
     // Advanced tests (NEW)
     REGISTER_TEST(search_tt_higher_visits_not_replaced);
     REGISTER_TEST(search_more_nodes_equals_better_or_same_move);
     REGISTER_TEST(search_parallel_mcts_visits_are_consistent);
+    REGISTER_TEST(search_tournament_schedules_every_game_once);
+    REGISTER_TEST(search_match_sprt_decides_clear_results);
+    REGISTER_TEST(search_match_elo_interval_narrows_with_games);
+    REGISTER_TEST(search_clop_tracks_pending_suggestions);
+    REGISTER_TEST(search_clop_incremental_fit_recovers_quadratic);
+    REGISTER_TEST(search_async_search_runs_until_stopped);
+    REGISTER_TEST(search_ponder_hit_hands_over_pondered_tree);
+    REGISTER_TEST(search_game_clock_budgets_stay_within_clock);
+    REGISTER_TEST(search_game_clock_budget_follows_own_moves);
+    REGISTER_TEST(search_managed_time_returns_forced_move_at_once);
+    REGISTER_TEST(search_tablebase_solves_nodes_and_rollouts);
+    REGISTER_TEST(search_opening_book_from_search_probes_legal_moves);
+    REGISTER_TEST(search_cache_seeds_roots_across_runs);
+    REGISTER_TEST(search_server_answers_position_and_go);
+    REGISTER_TEST(search_history_chain_links_last_position_first);
+    REGISTER_TEST(search_many_reports_results_in_input_order);
     
     // Neural tests
     REGISTER_TEST(neural_cnn_init_allocates_weights);
@@ -100,10 +194,24 @@ static void register_all_tests(void) {
     REGISTER_TEST(neural_cnn_forward_produces_valid_output);
     REGISTER_TEST(neural_cnn_forward_with_history);
     REGISTER_TEST(neural_cnn_forward_is_deterministic);
+    REGISTER_TEST(neural_bn_fold_matches_unfused_layers);
+    REGISTER_TEST(neural_sparse_conv1_matches_dense);
+    REGISTER_TEST(neural_winograd_matches_im2col);
+    REGISTER_TEST(neural_legal_policy_matches_renormalized_full);
+    REGISTER_TEST(neural_workspace_chunks_match_batch);
+    REGISTER_TEST(neural_cpu_backend_matches_builtin_batch);
+    REGISTER_TEST(neural_intra_op_threads_policy);
+    REGISTER_TEST(neural_fp16_heads_track_fp32);
+    REGISTER_TEST(neural_quant_tracks_fp32_and_roundtrips);
     REGISTER_TEST(neural_move_to_index_returns_valid_index);
     REGISTER_TEST(neural_move_to_index_different_for_colors);
     REGISTER_TEST(neural_cnn_save_and_load_roundtrip);
     REGISTER_TEST(neural_cnn_load_nonexistent_fails);
+    REGISTER_TEST(neural_cnn_model_file_is_mapped_in_place);
+    REGISTER_TEST(neural_cnn_load_legacy_raw_file);
+    REGISTER_TEST(neural_cnn_load_rejects_corrupt_model);
+    REGISTER_TEST(neural_cache_roundtrip_keeps_legal_policy);
+    REGISTER_TEST(neural_cache_key_depends_on_history);
     
     // Training tests
     REGISTER_TEST(training_dataset_save_and_load);
@@ -112,9 +220,24 @@ static void register_all_tests(void) {
     REGISTER_TEST(training_dataset_get_count_nonexistent);
     REGISTER_TEST(training_dataset_shuffle_changes_order);
     REGISTER_TEST(training_dataset_split);
+    REGISTER_TEST(training_dataset_stream_covers_every_sample);
+    REGISTER_TEST(training_dataset_v2_roundtrip);
+    REGISTER_TEST(training_dataset_decode_rejects_impossible_states);
+    REGISTER_TEST(training_prefetch_matches_synchronous_stream);
+    REGISTER_TEST(training_replay_buffer_appends_and_evicts);
+    REGISTER_TEST(training_sample_writer_keeps_every_game_contiguous);
+    REGISTER_TEST(training_collector_serves_model_and_receives_samples);
+    REGISTER_TEST(training_collector_listens_on_loopback_by_default);
+    REGISTER_TEST(training_dedupe_averages_duplicates_in_input_order);
+    REGISTER_TEST(training_dedupe_keeps_value_only_samples_out_of_policy_average);
+    REGISTER_TEST(training_dataset_analyze_is_thread_independent);
+    REGISTER_TEST(training_reanalyse_rewrites_policies_in_order);
+    REGISTER_TEST(training_book_games_counts_played_moves);
     REGISTER_TEST(training_sample_struct_size);
     REGISTER_TEST(training_sample_policy_sums_to_valid);
     REGISTER_TEST(training_cnn_train_step_reduces_loss);
+    REGISTER_TEST(training_batched_step_matches_per_sample);
+    REGISTER_TEST(training_per_sample_gradients_independent_of_threads);
     REGISTER_TEST(training_cnn_gradients_cleared_after_update);
     
     // Common tests
@@ -138,6 +261,13 @@ static void register_all_tests(void) {
     REGISTER_TEST(common_debug_dbg_not_null_passes);
     REGISTER_TEST(common_debug_dbg_valid_sq_passes);
     REGISTER_TEST(common_debug_dbg_valid_color_passes);
+    REGISTER_TEST(common_vec_kernels_match_scalar);
+    REGISTER_TEST(common_vec_softmax_matches_expf);
+    REGISTER_TEST(common_vec_s8_kernels_match_scalar);
+    REGISTER_TEST(common_vec_f16_kernels_match_scalar);
+    REGISTER_TEST(common_vec_bits_to_f32_expands_every_bit);
+    REGISTER_TEST(common_affinity_pins_and_releases_threads);
+    REGISTER_TEST(common_log_async_keeps_every_message_in_order);
 }
 
 // =============================================================================
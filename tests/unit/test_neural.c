@@ -179,6 +179,444 @@ TEST(neural_cnn_forward_is_deterministic) {
     cnn_free(&weights);
 }
 
+TEST(neural_bn_fold_matches_unfused_layers) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    // Non-trivial BN: identity params would hide a wrong fold
+    float *bn[4][4] = {
+        {weights.bn1_gamma, weights.bn1_beta, weights.bn1_mean, weights.bn1_var},
+        {weights.bn2_gamma, weights.bn2_beta, weights.bn2_mean, weights.bn2_var},
+        {weights.bn3_gamma, weights.bn3_beta, weights.bn3_mean, weights.bn3_var},
+        {weights.bn4_gamma, weights.bn4_beta, weights.bn4_mean, weights.bn4_var},
+    };
+    float *conv_b[4] = {weights.conv1_b, weights.conv2_b, weights.conv3_b, weights.conv4_b};
+    RNG rng;
+    rng_seed(&rng, 7);
+    for (int l = 0; l < 4; l++) {
+        for (int c = 0; c < 64; c++) {
+            bn[l][0][c] = 0.5f + rng_f32(&rng);
+            bn[l][1][c] = rng_f32(&rng) - 0.5f;
+            bn[l][2][c] = rng_f32(&rng) - 0.5f;
+            bn[l][3][c] = 0.2f + rng_f32(&rng);
+            conv_b[l][c] = rng_f32(&rng) * 0.2f - 0.1f;
+        }
+    }
+    cnn_fold_batch_norm(&weights);
+    
+    GameState state;
+    init_game(&state);
+    float input[CNN_INPUT_CHANNELS * 64], player;
+    cnn_encode_state(&state, input, &player);
+    
+    // Reference: the training layout (conv, then BN with running stats + ReLU)
+    float ref[64 * 64], ref_in[64 * 64], pre[64 * 64];
+    float fused[64 * 64], fused_in[64 * 64];
+    const float *conv_w[4] = {weights.conv1_w, weights.conv2_w, weights.conv3_w, weights.conv4_w};
+    const float *fused_w[4] = {weights.fused_conv1_w, weights.fused_conv2_w,
+                               weights.fused_conv3_w, weights.fused_conv4_w};
+    const float *fused_b[4] = {weights.fused_conv1_b, weights.fused_conv2_b,
+                               weights.fused_conv3_b, weights.fused_conv4_b};
+    const ConvShape shapes[4] = {CONV1_SHAPE, CONV2_SHAPE, CONV3_SHAPE, CONV4_SHAPE};
+    for (int l = 0; l < 4; l++) {
+        const float *in_ref = l ? ref_in : input;
+        const float *in_fused = l ? fused_in : input;
+        conv2d_forward_s(in_ref, conv_w[l], conv_b[l], pre, shapes[l]);
+        batch_norm_forward_relu(pre, bn[l][0], bn[l][1], ref, NULL, NULL, NULL,
+                                bn[l][2], bn[l][3], 64, 8, 8, 0);
+        conv2d_forward_relu_s(in_fused, fused_w[l], fused_b[l], fused, shapes[l]);
+        
+        for (int i = 0; i < 64 * 64; i++) {
+            ASSERT_FLOAT_EQ(ref[i], fused[i], 1e-4f * (1.0f + fabsf(ref[i])));
+        }
+        memcpy(ref_in, ref, sizeof(ref));
+        memcpy(fused_in, fused, sizeof(fused));
+    }
+    
+    cnn_free(&weights);
+}
+
+TEST(neural_sparse_conv1_matches_dense) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    // Three plies in: Black to move, so the canonical flip applies throughout
+    GameState plies[4];
+    init_game(&plies[0]);
+    for (int p = 1; p < 4; p++) {
+        plies[p] = plies[p - 1];
+        MoveList moves;
+        movegen_generate(&plies[p], &moves);
+        apply_move(&plies[p], &moves.moves[(p * 5) % moves.count]);
+    }
+    GameState state = plies[3], h1 = plies[2], h2 = plies[1];
+    ASSERT_EQ(BLACK, state.current_player);
+    
+    float dense[CNN_INPUT_CHANNELS * 64], player;
+    cnn_encode_state(&state, dense, &player);
+    h1.current_player = h2.current_player = state.current_player;
+    encode_state_channels_canonical(&h1, dense, 4);
+    encode_state_channels_canonical(&h2, dense, 8);
+    
+    CNNSparseInput sparse;
+    h1.current_player = WHITE;     // cnn_encode_sparse must ignore the history's own side
+    cnn_encode_sparse(&state, &h1, &h2, &sparse);
+    int ones = 0;
+    for (int i = 0; i < CNN_INPUT_CHANNELS * 64; i++) ones += (dense[i] == 1.0f);
+    ASSERT_EQ(ones, sparse.count);
+    for (int i = 0; i < sparse.count; i++) ASSERT_FLOAT_EQ(1.0f, dense[sparse.index[i]], 0.0f);
+    
+    float ref[64 * 64], out[64 * 64];
+    conv2d_forward_relu_s(dense, weights.fused_conv1_w, weights.fused_conv1_b, ref, CONV1_SHAPE);
+    conv3x3_sparse_relu(weights.sparse_conv1_w, weights.fused_conv1_b, &sparse, out, 64);
+    for (int i = 0; i < 64 * 64; i++) ASSERT_FLOAT_EQ(ref[i], out[i], 1e-5f);
+    
+    cnn_free(&weights);
+}
+
+TEST(neural_winograd_matches_im2col) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    // The zero border matters: every tile touches an edge or a neighbour
+    enum { BATCH = 3 };
+    static float input[BATCH * 64 * 64], ref[BATCH * 64 * 64], out[BATCH * 64 * 64];
+    RNG rng;
+    rng_seed(&rng, 11);
+    for (int i = 0; i < BATCH * 64 * 64; i++) input[i] = rng_f32(&rng) * 2.0f - 1.0f;
+    
+    for (int b = 0; b < BATCH; b++) {
+        conv2d_forward_relu_s(&input[b * 4096], weights.fused_conv2_w, weights.fused_conv2_b,
+                              &ref[b * 4096], CONV2_SHAPE);
+    }
+    conv3x3_winograd_relu(input, weights.wino_conv2_u, weights.fused_conv2_b, out, CONV2_SHAPE, BATCH);
+    for (int i = 0; i < BATCH * 4096; i++) {
+        ASSERT_FLOAT_EQ(ref[i], out[i], 1e-4f * (1.0f + fabsf(ref[i])));
+    }
+    
+    // Whole network, batched, under both algorithms
+    GameState states[BATCH];
+    const GameState *ptrs[BATCH];
+    init_game(&states[0]);
+    for (int b = 1; b < BATCH; b++) {
+        states[b] = states[b - 1];
+        MoveList moves;
+        movegen_generate(&states[b], &moves);
+        apply_move(&states[b], &moves.moves[moves.count - 1]);
+    }
+    for (int b = 0; b < BATCH; b++) ptrs[b] = &states[b];
+    
+    CNNOutput outs_ref[BATCH], outs[BATCH];
+    CNNConvAlgo saved = cnn_get_conv_algo();
+    cnn_set_conv_algo(CNN_CONV_IM2COL);
+    cnn_forward_batch(&weights, ptrs, NULL, NULL, outs_ref, BATCH);
+    cnn_set_conv_algo(CNN_CONV_WINOGRAD);
+    cnn_forward_batch(&weights, ptrs, NULL, NULL, outs, BATCH);
+    cnn_set_conv_algo(saved);
+    for (int b = 0; b < BATCH; b++) {
+        ASSERT_FLOAT_EQ(outs_ref[b].value, outs[b].value, 1e-4f);
+        for (int i = 0; i < CNN_POLICY_SIZE; i++) {
+            ASSERT_FLOAT_EQ(outs_ref[b].policy[i], outs[b].policy[i], 1e-5f);
+        }
+    }
+    
+    cnn_free(&weights);
+}
+
+TEST(neural_legal_policy_matches_renormalized_full) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    enum { BATCH = 4 };
+    GameState states[BATCH];
+    const GameState *ptrs[BATCH];
+    CNNPolicySubset legal[BATCH];
+    init_game(&states[0]);
+    for (int b = 1; b < BATCH; b++) {
+        states[b] = states[b - 1];
+        MoveList moves;
+        movegen_generate(&states[b], &moves);
+        apply_move(&states[b], &moves.moves[0]);
+    }
+    for (int b = 0; b < BATCH; b++) {
+        ptrs[b] = &states[b];
+        cnn_policy_subset(&states[b], &legal[b]);
+        ASSERT_GT(legal[b].count, 0);
+    }
+    
+    CNNOutput full[BATCH], single[BATCH], batched[BATCH];
+    cnn_forward_batch(&weights, ptrs, NULL, NULL, full, BATCH);
+    cnn_forward_batch_legal(&weights, ptrs, NULL, NULL, legal, batched, BATCH);
+    for (int b = 0; b < BATCH; b++) {
+        cnn_forward_legal(&weights, &states[b], NULL, NULL, &legal[b], &single[b]);
+        
+        float legal_sum = 0.0f;
+        for (int i = 0; i < legal[b].count; i++) legal_sum += full[b].policy[legal[b].index[i]];
+        ASSERT_GT(legal_sum, 0.0f);
+        
+        int in_subset[CNN_POLICY_SIZE] = {0};
+        for (int i = 0; i < legal[b].count; i++) in_subset[legal[b].index[i]] = 1;
+        for (int i = 0; i < CNN_POLICY_SIZE; i++) {
+            float expected = in_subset[i] ? full[b].policy[i] / legal_sum : 0.0f;
+            ASSERT_FLOAT_EQ(expected, single[b].policy[i], 1e-5f);
+            ASSERT_FLOAT_EQ(expected, batched[b].policy[i], 1e-5f);
+        }
+        ASSERT_FLOAT_EQ(full[b].value, single[b].value, 1e-5f);
+        ASSERT_FLOAT_EQ(full[b].value, batched[b].value, 1e-5f);
+    }
+    
+    // Empty subset: value only, policy all zero
+    CNNPolicySubset none = { .count = 0 };
+    cnn_forward_legal(&weights, &states[0], NULL, NULL, &none, &single[0]);
+    ASSERT_FLOAT_EQ(full[0].value, single[0].value, 1e-5f);
+    for (int i = 0; i < CNN_POLICY_SIZE; i++) ASSERT_FLOAT_EQ(0.0f, single[0].policy[i], 0.0f);
+    
+    cnn_free(&weights);
+}
+
+TEST(neural_workspace_chunks_match_batch) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    enum { BATCH = 5 };
+    GameState states[BATCH];
+    const GameState *ptrs[BATCH], *hist1s[BATCH];
+    init_game(&states[0]);
+    for (int b = 1; b < BATCH; b++) {
+        states[b] = states[b - 1];
+        MoveList moves;
+        movegen_generate(&states[b], &moves);
+        apply_move(&states[b], &moves.moves[moves.count - 1]);
+    }
+    for (int b = 0; b < BATCH; b++) {
+        ptrs[b] = &states[b];
+        hist1s[b] = b ? &states[b - 1] : NULL;
+    }
+    
+    // Smaller than the batch: 2 + 2 + 1, the last chunk a single GEMV
+    CNNWorkspace *ws = cnn_workspace_create(2);
+    ASSERT_NOT_NULL(ws);
+    ASSERT_EQ(0, (int)((uintptr_t)ws->fc % 64));
+    ASSERT_EQ(0, (int)((uintptr_t)ws->wino_m % 64));
+    
+    CNNOutput ref[BATCH], outs[BATCH];
+    cnn_forward_batch(&weights, ptrs, hist1s, NULL, ref, BATCH);
+    cnn_forward_batch_legal_ws(&weights, ws, ptrs, hist1s, NULL, NULL, outs, BATCH);
+    for (int b = 0; b < BATCH; b++) {
+        ASSERT_FLOAT_EQ(ref[b].value, outs[b].value, 1e-5f);
+        for (int i = 0; i < CNN_POLICY_SIZE; i++) {
+            ASSERT_FLOAT_EQ(ref[b].policy[i], outs[b].policy[i], 1e-5f);
+        }
+    }
+    
+    cnn_workspace_free(ws);
+    cnn_workspace_cleanup();
+    cnn_free(&weights);
+}
+
+TEST(neural_cpu_backend_matches_builtin_batch) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    enum { BATCH = 4 };
+    GameState states[BATCH];
+    const GameState *ptrs[BATCH], *hist1s[BATCH];
+    CNNPolicySubset legal[BATCH];
+    init_game(&states[0]);
+    for (int b = 1; b < BATCH; b++) {
+        states[b] = states[b - 1];
+        MoveList moves;
+        movegen_generate(&states[b], &moves);
+        apply_move(&states[b], &moves.moves[0]);
+    }
+    for (int b = 0; b < BATCH; b++) {
+        ptrs[b] = &states[b];
+        hist1s[b] = b ? &states[b - 1] : NULL;
+        cnn_policy_subset(&states[b], &legal[b]);
+    }
+    
+    // Packed bitboards carry exactly the sparse encoding (Black: flipped)
+    CNNPackedInput packed;
+    CNNSparseInput a, b;
+    cnn_encode_packed(&states[1], &states[0], NULL, &packed);
+    cnn_encode_sparse(&states[1], &states[0], NULL, &a);
+    cnn_packed_to_sparse(&packed, &b);
+    ASSERT_EQ(a.count, b.count);
+    for (int i = 0; i < a.count; i++) ASSERT_EQ(a.index[i], b.index[i]);
+    
+    // ... and the dense training encoding
+    TrainingSample sample = {0};
+    sample.state = states[2];
+    sample.history[0] = states[1];
+    sample.history[1] = states[0];
+    float dense[CNN_INPUT_CHANNELS * 64], unpacked[CNN_INPUT_CHANNELS * 64], player;
+    cnn_encode_sample(&sample, dense, &player);
+    cnn_encode_packed(&states[2], &states[1], &states[0], &packed);
+    cnn_packed_to_dense(&packed, unpacked);
+    for (int i = 0; i < CNN_INPUT_CHANNELS * 64; i++) ASSERT_FLOAT_EQ(dense[i], unpacked[i], 0.0f);
+    
+    ASSERT_TRUE(cnn_backend_find("no-such-backend") == NULL);
+    const CNNBackend *cpu = cnn_backend_find("cpu");
+    ASSERT_NOT_NULL(cpu);
+    
+    CNNOutput ref[BATCH], outs[BATCH];
+    cnn_forward_batch_legal(&weights, ptrs, hist1s, NULL, legal, ref, BATCH);
+    ASSERT_EQ(ERR_OK, cnn_backend_attach(&weights, cpu));
+    cnn_forward_batch_legal(&weights, ptrs, hist1s, NULL, legal, outs, BATCH);
+    for (int i = 0; i < BATCH; i++) {
+        ASSERT_FLOAT_EQ(ref[i].value, outs[i].value, 1e-6f);
+        for (int k = 0; k < CNN_POLICY_SIZE; k++) {
+            ASSERT_FLOAT_EQ(ref[i].policy[k], outs[i].policy[k], 1e-6f);
+        }
+    }
+    
+    cnn_backend_detach(&weights);
+    ASSERT_TRUE(weights.backend == NULL);
+    
+    // --backend <name>: an unknown name leaves the weights on the built-in path
+    ASSERT_EQ(ERR_INVALID_ARG, cnn_backend_attach_named(&weights, "no-such-backend"));
+    ASSERT_TRUE(weights.backend == NULL);
+    ASSERT_EQ(ERR_OK, cnn_backend_attach_named(&weights, "cpu"));
+    ASSERT_TRUE(weights.backend == cpu);
+    cnn_backend_detach(&weights);
+    cnn_workspace_cleanup();
+    cnn_free(&weights);
+}
+
+TEST(neural_intra_op_threads_policy) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    ASSERT_EQ(CNN_INTRA_OP_THREADS_DEFAULT, cnn_get_intra_op_threads());
+    ASSERT_EQ(1, conv_threads(CNN_INTRA_OP_MIN_BATCH));
+    
+    cnn_set_intra_op_threads(4);
+    ASSERT_EQ(1, conv_threads(CNN_INTRA_OP_MIN_BATCH - 1));
+    ASSERT_EQ(4, conv_threads(CNN_INTRA_OP_MIN_BATCH));
+    int nested = 0;
+    #pragma omp parallel num_threads(2)
+    {
+        #pragma omp single
+        nested = conv_threads(CNN_INTRA_OP_MIN_BATCH);
+    }
+    ASSERT_EQ(1, nested);
+    
+    // Same batch, split or not
+    enum { BATCH = CNN_INTRA_OP_MIN_BATCH };
+    GameState states[BATCH];
+    const GameState *ptrs[BATCH];
+    init_game(&states[0]);
+    for (int b = 1; b < BATCH; b++) {
+        states[b] = states[b - 1];
+        MoveList moves;
+        movegen_generate(&states[b], &moves);
+        if (moves.count == 0) init_game(&states[b]);
+        else apply_move(&states[b], &moves.moves[b % moves.count]);
+    }
+    for (int b = 0; b < BATCH; b++) ptrs[b] = &states[b];
+    static CNNOutput split[BATCH], serial[BATCH];
+    cnn_forward_batch(&weights, ptrs, NULL, NULL, split, BATCH);
+    cnn_set_intra_op_threads(1);
+    cnn_forward_batch(&weights, ptrs, NULL, NULL, serial, BATCH);
+    for (int b = 0; b < BATCH; b++) {
+        ASSERT_FLOAT_EQ(serial[b].value, split[b].value, 1e-6f);
+        for (int i = 0; i < CNN_POLICY_SIZE; i++) ASSERT_FLOAT_EQ(serial[b].policy[i], split[b].policy[i], 1e-6f);
+    }
+    
+    cnn_set_intra_op_threads(CNN_INTRA_OP_THREADS_DEFAULT);
+    cnn_workspace_cleanup();
+    cnn_free(&weights);
+}
+
+TEST(neural_fp16_heads_track_fp32) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    enum { BATCH = 3 };
+    GameState states[BATCH];
+    const GameState *ptrs[BATCH];
+    init_game(&states[0]);
+    for (int b = 1; b < BATCH; b++) {
+        states[b] = states[b - 1];
+        MoveList moves;
+        movegen_generate(&states[b], &moves);
+        apply_move(&states[b], &moves.moves[0]);
+    }
+    for (int b = 0; b < BATCH; b++) ptrs[b] = &states[b];
+    
+    CNNOutput ref[BATCH], half[BATCH], single;
+    CNNHeadPrecision saved = cnn_get_head_precision();
+    cnn_set_head_precision(CNN_HEAD_FP32);
+    cnn_forward_batch(&weights, ptrs, NULL, NULL, ref, BATCH);
+    cnn_set_head_precision(CNN_HEAD_FP16);
+    cnn_forward_batch(&weights, ptrs, NULL, NULL, half, BATCH);
+    for (int b = 0; b < BATCH; b++) {
+        cnn_forward_with_history(&weights, &states[b], NULL, NULL, &single);
+        ASSERT_FLOAT_EQ(ref[b].value, half[b].value, 1e-3f);
+        ASSERT_FLOAT_EQ(half[b].value, single.value, 1e-5f);
+        for (int i = 0; i < CNN_POLICY_SIZE; i++) {
+            ASSERT_FLOAT_EQ(ref[b].policy[i], half[b].policy[i], 1e-5f + 1e-2f * ref[b].policy[i]);
+            ASSERT_FLOAT_EQ(half[b].policy[i], single.policy[i], 1e-5f);
+        }
+    }
+    cnn_set_head_precision(saved);
+    
+    cnn_free(&weights);
+}
+
+TEST(neural_quant_tracks_fp32_and_roundtrips) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    // Calibration set: a short line of play with its history
+    enum { N = 8 };
+    static TrainingSample samples[N];
+    memset(samples, 0, sizeof(samples));
+    GameState s;
+    init_game(&s);
+    for (int n = 0; n < N; n++) {
+        samples[n].state = s;
+        if (n > 0) samples[n].history[0] = samples[n - 1].state;
+        if (n > 1) samples[n].history[1] = samples[n - 2].state;
+        MoveList moves;
+        movegen_generate(&s, &moves);
+        if (moves.count == 0) break;
+        apply_move(&s, &moves.moves[n % moves.count]);
+    }
+    
+    CNNQuantWeights q, loaded;
+    ASSERT_EQ(ERR_OK, cnn_quant_calibrate(&weights, samples, N, &q));
+    ASSERT_EQ(ERR_INVALID_ARG, cnn_quant_calibrate(&weights, samples, 0, &loaded));
+    
+    const char *path = "/tmp/test_weights.q8";
+    ASSERT_EQ(ERR_OK, cnn_quant_save(&q, path));
+    ASSERT_EQ(ERR_OK, cnn_quant_load(&loaded, path));
+    remove(path);
+    
+    for (int n = 0; n < N; n++) {
+        CNNOutput ref, out, out_loaded;
+        weights.quant = NULL;
+        cnn_forward_sample(&weights, &samples[n], &ref);
+        weights.quant = &q;
+        cnn_forward_sample(&weights, &samples[n], &out);
+        weights.quant = &loaded;
+        cnn_forward_sample(&weights, &samples[n], &out_loaded);
+        
+        ASSERT_FLOAT_EQ(ref.value, out.value, 0.05f);
+        float policy_err = 0.0f;
+        for (int i = 0; i < CNN_POLICY_SIZE; i++) {
+            policy_err += fabsf(ref.policy[i] - out.policy[i]);
+            ASSERT_FLOAT_EQ(out.policy[i], out_loaded.policy[i], 0.0f);
+        }
+        ASSERT_LT(policy_err, 0.1f);
+        ASSERT_FLOAT_EQ(out.value, out_loaded.value, 0.0f);
+    }
+    
+    weights.quant = NULL;
+    cnn_quant_free(&q);
+    cnn_quant_free(&loaded);
+    cnn_free(&weights);
+}
+
 // =============================================================================
 // MOVE INDEX TESTS
 // =============================================================================
@@ -255,3 +693,151 @@ TEST(neural_cnn_load_nonexistent_fails) {
     
     cnn_free(&weights);
 }
+
+TEST(neural_cnn_model_file_is_mapped_in_place) {
+    CNNWeights saved, loaded;
+    cnn_init(&saved);
+    cnn_init(&loaded);
+    const char *path = "/tmp/test_model_v2.bin";
+    ASSERT_EQ(0, cnn_save_weights(&saved, path));
+    
+    ASSERT_EQ(0, cnn_load_weights(&loaded, path));
+    ASSERT_NOT_NULL(loaded.mapping);
+    ASSERT_EQ(0, (int)((uintptr_t)loaded.policy_w_h % CNN_MODEL_ALIGN));
+    
+    GameState state;
+    init_game(&state);
+    CNNOutput a, b;
+    cnn_forward_with_history(&saved, &state, NULL, NULL, &a);
+    cnn_forward_with_history(&loaded, &state, NULL, NULL, &b);
+    ASSERT_FLOAT_EQ(a.value, b.value, 1e-6f);
+    for (int i = 0; i < CNN_POLICY_SIZE; i++) ASSERT_FLOAT_EQ(a.policy[i], b.policy[i], 1e-6f);
+    
+    // Private mapping: edits and a re-save over the mapped file are safe
+    loaded.policy_b[0] += 1.0f;
+    ASSERT_EQ(0, cnn_save_weights(&loaded, path));
+    ASSERT_EQ(0, cnn_load_weights(&loaded, path));
+    ASSERT_FLOAT_EQ(saved.policy_b[0] + 1.0f, loaded.policy_b[0], 1e-6f);
+    
+    cnn_free(&saved);
+    cnn_free(&loaded);
+    remove(path);
+}
+
+TEST(neural_cnn_load_legacy_raw_file) {
+    CNNWeights saved, loaded;
+    cnn_init(&saved);
+    cnn_init(&loaded);
+    const char *path = "/tmp/test_weights_legacy.bin";
+    
+    // Pre-v2 layout: the masters back to back, no header
+    FILE *f = fopen(path, "wb");
+    ASSERT_NOT_NULL(f);
+    const struct { float *p; size_t n; } arrays[] = {
+        {saved.conv1_w, 64 * CNN_INPUT_CHANNELS * 9}, {saved.conv1_b, 64},
+        {saved.conv2_w, 64 * 64 * 9}, {saved.conv2_b, 64},
+        {saved.conv3_w, 64 * 64 * 9}, {saved.conv3_b, 64},
+        {saved.conv4_w, 64 * 64 * 9}, {saved.conv4_b, 64},
+        {saved.bn1_gamma, 64}, {saved.bn1_beta, 64}, {saved.bn2_gamma, 64}, {saved.bn2_beta, 64},
+        {saved.bn3_gamma, 64}, {saved.bn3_beta, 64}, {saved.bn4_gamma, 64}, {saved.bn4_beta, 64},
+        {saved.bn1_mean, 64}, {saved.bn1_var, 64}, {saved.bn2_mean, 64}, {saved.bn2_var, 64},
+        {saved.bn3_mean, 64}, {saved.bn3_var, 64}, {saved.bn4_mean, 64}, {saved.bn4_var, 64},
+        {saved.policy_w, 512 * 4097}, {saved.policy_b, 512},
+        {saved.value_w1, 256 * 4097}, {saved.value_b1, 256},
+        {saved.value_w2, 256}, {saved.value_b2, 1},
+    };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        fwrite(arrays[i].p, sizeof(float), arrays[i].n, f);
+    }
+    fclose(f);
+    
+    ASSERT_EQ(0, cnn_load_weights(&loaded, path));
+    ASSERT_TRUE(loaded.mapping == NULL);
+    ASSERT_FLOAT_EQ(saved.conv4_w[123], loaded.conv4_w[123], 1e-6f);
+    ASSERT_FLOAT_EQ(saved.fused_conv2_w[77], loaded.fused_conv2_w[77], 1e-6f);
+    ASSERT_FLOAT_EQ(saved.value_w2[255], loaded.value_w2[255], 1e-6f);
+    
+    cnn_free(&saved);
+    cnn_free(&loaded);
+    remove(path);
+}
+
+TEST(neural_cnn_load_rejects_corrupt_model) {
+    CNNWeights saved, loaded;
+    cnn_init(&saved);
+    cnn_init(&loaded);
+    const char *path = "/tmp/test_model_corrupt.bin";
+    ASSERT_EQ(0, cnn_save_weights(&saved, path));
+    float before = loaded.policy_w[0];
+    
+    // Flip one payload byte near the end of the file
+    FILE *f = fopen(path, "r+b");
+    ASSERT_NOT_NULL(f);
+    fseek(f, -100, SEEK_END);
+    int c = fgetc(f);
+    fseek(f, -100, SEEK_END);
+    fputc(c ^ 0x5A, f);
+    fclose(f);
+    
+    ASSERT_NE(0, cnn_load_weights(&loaded, path));
+    ASSERT_TRUE(loaded.mapping == NULL);
+    ASSERT_FLOAT_EQ(before, loaded.policy_w[0], 0.0f);
+    
+    cnn_free(&saved);
+    cnn_free(&loaded);
+    remove(path);
+}
+
+// =============================================================================
+// EVAL CACHE TESTS
+// =============================================================================
+
+TEST(neural_cache_roundtrip_keeps_legal_policy) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    CNNCache *cache = cnn_cache_create(1024);
+    ASSERT_NOT_NULL(cache);
+    ASSERT_EQ(1024, (int)cache->size);
+    
+    GameState state;
+    init_game(&state);
+    CNNOutput out, cached;
+    cnn_forward_with_history(&weights, &state, NULL, NULL, &out);
+    
+    uint64_t key = cnn_cache_key(&state, NULL, NULL);
+    ASSERT_FALSE(cnn_cache_probe(cache, key, &cached));
+    ASSERT_EQ(0, cnn_cache_store(cache, key, &state, &out));
+    ASSERT_TRUE(cnn_cache_probe(cache, key, &cached));
+    ASSERT_FLOAT_EQ(out.value, cached.value, 1e-6f);
+    
+    // Legal-move entries survive exactly, everything else reads as zero
+    PackedMoveList moves;
+    movegen_generate_packed(&state, &moves);
+    float legal_sum = 0.0f, cached_sum = 0.0f;
+    for (int i = 0; i < moves.count; i++) {
+        int idx = cnn_packed_move_to_index(moves.moves[i], state.current_player);
+        ASSERT_FLOAT_EQ(out.policy[idx], cached.policy[idx], 1e-6f);
+        legal_sum += out.policy[idx];
+    }
+    for (int i = 0; i < CNN_POLICY_SIZE; i++) cached_sum += cached.policy[i];
+    ASSERT_FLOAT_EQ(legal_sum, cached_sum, 1e-5f);
+    
+    cnn_cache_free(cache);
+    cnn_free(&weights);
+}
+
+TEST(neural_cache_key_depends_on_history) {
+    GameState s0, s1;
+    init_game(&s0);
+    s1 = s0;
+    MoveList list;
+    movegen_generate(&s1, &list);
+    apply_move(&s1, &list.moves[0]);
+    
+    uint64_t none = cnn_cache_key(&s1, NULL, NULL);
+    uint64_t one = cnn_cache_key(&s1, &s0, NULL);
+    uint64_t two = cnn_cache_key(&s1, &s0, &s0);
+    ASSERT_TRUE(none != one);
+    ASSERT_TRUE(one != two);
+    ASSERT_TRUE(cnn_cache_key(&s1, &s0, NULL) == one);
+}
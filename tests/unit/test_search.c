@@ -58,6 +58,711 @@ TEST(search_arena_alloc_multiple) {
     arena_free(&arena);
 }
 
+TEST(search_arena_reset_reuses_buffer) {
+    Arena arena;
+    arena_init(&arena, 4096);
+    
+    void *p1 = arena_alloc(&arena, 64);
+    ASSERT_TRUE(p1 == (void*)arena.buffer);
+    arena_alloc(&arena, 64);
+    
+    // Reset must also invalidate this thread's cached chunk
+    arena_reset(&arena);
+    void *p2 = arena_alloc(&arena, 64);
+    ASSERT_TRUE(p2 == (void*)arena.buffer);
+    
+    arena_free(&arena);
+}
+
+TEST(search_arena_release_recycles_blocks) {
+    Arena arena;
+    arena_init(&arena, 4096);
+    
+    void *p1 = arena_alloc(&arena, 128);
+    ASSERT_NOT_NULL(p1);
+    size_t used = arena_bytes_in_use(&arena);
+    
+    arena_release(&arena, p1, 128);
+    ASSERT_LT(arena_bytes_in_use(&arena), used);
+    
+    // Lists are per exact size: another size does not take the block...
+    void *other = arena_alloc(&arena, 100);
+    ASSERT_NOT_NULL(other);
+    ASSERT_TRUE(other != p1);
+    
+    // ...the same size does
+    void *p2 = arena_alloc(&arena, 128);
+    ASSERT_TRUE(p2 == p1);
+    
+    // Free list empty again: a fresh block from the buffer
+    void *p3 = arena_alloc(&arena, 128);
+    ASSERT_NOT_NULL(p3);
+    ASSERT_TRUE(p3 != p1);
+    
+    // Reset drops the free lists with everything else
+    arena_release(&arena, p3, 128);
+    arena_reset(&arena);
+    ASSERT_EQ(arena_bytes_in_use(&arena), 0);
+    
+    arena_free(&arena);
+}
+
+#define ARENA_TEST_THREADS 4
+#define ARENA_TEST_ALLOCS  2000
+
+typedef struct {
+    Arena *arena;
+    int id;
+    unsigned char *blocks[ARENA_TEST_ALLOCS];
+} ArenaTestArgs;
+
+static void *arena_test_worker(void *arg) {
+    ArenaTestArgs *t = (ArenaTestArgs*)arg;
+    for (int i = 0; i < ARENA_TEST_ALLOCS; i++) {
+        t->blocks[i] = arena_alloc(t->arena, 48);
+        if (t->blocks[i]) memset(t->blocks[i], t->id + 1, 48);
+    }
+    return NULL;
+}
+
+TEST(search_arena_parallel_allocs_are_disjoint) {
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    static ArenaTestArgs args[ARENA_TEST_THREADS];
+    pthread_t threads[ARENA_TEST_THREADS];
+    for (int t = 0; t < ARENA_TEST_THREADS; t++) {
+        args[t].arena = &arena;
+        args[t].id = t;
+        pthread_create(&threads[t], NULL, arena_test_worker, &args[t]);
+    }
+    for (int t = 0; t < ARENA_TEST_THREADS; t++) pthread_join(threads[t], NULL);
+    
+    // Any overlap would have been overwritten by another thread's id
+    for (int t = 0; t < ARENA_TEST_THREADS; t++) {
+        for (int i = 0; i < ARENA_TEST_ALLOCS; i++) {
+            ASSERT_NOT_NULL(args[t].blocks[i]);
+            ASSERT_EQ(t + 1, args[t].blocks[i][0]);
+            ASSERT_EQ(t + 1, args[t].blocks[i][47]);
+        }
+    }
+    
+    arena_free(&arena);
+}
+
+TEST(search_arena_mapped_backing_releases_on_reset) {
+    const size_t mb = (size_t)1 << 20;
+    Arena arena;
+    ArenaOptions backing = { ARENA_PAGES_THP, 4 * mb, 1 * mb };
+    ASSERT_EQ(0, arena_init_with(&arena, 16 * mb, &backing));
+    ASSERT_EQ(16 * mb, arena.mapped);
+    ASSERT_EQ(0, (uintptr_t)arena.buffer % (2 * mb));
+    
+    // Pages used beyond reset_keep come back zeroed, the kept ones intact
+    unsigned char *p = arena_alloc(&arena, 8 * mb);
+    ASSERT_TRUE(p == arena.buffer);
+    memset(p, 0xAB, 8 * mb);
+    arena_reset(&arena);
+    ASSERT_EQ(0, atomic_load(&arena.offset));
+    ASSERT_EQ(0xAB, arena.buffer[mb - 1]);
+    ASSERT_EQ(0, arena.buffer[2 * mb]);
+    ASSERT_EQ(0, arena.buffer[8 * mb - 1]);
+    ASSERT_NOT_NULL(arena_alloc(&arena, 12 * mb));
+    arena_free(&arena);
+    ASSERT_TRUE(arena.buffer == NULL);
+    
+    // Freed while the pre-fault thread is still running
+    ArenaOptions prefault = { ARENA_PAGES_DEFAULT, 64 * mb, 0 };
+    ASSERT_EQ(0, arena_init_with(&arena, 64 * mb, &prefault));
+    ASSERT_NOT_NULL(arena_alloc(&arena, 1024));
+    arena_free(&arena);
+    
+    // Hugetlb falls back to THP without reserved pages; no options: malloc
+    ArenaOptions hugetlb = { ARENA_PAGES_HUGETLB, 0, 0 };
+    ASSERT_EQ(0, arena_init_with(&arena, 4 * mb, &hugetlb));
+    ASSERT_NOT_NULL(arena_alloc(&arena, mb));
+    arena_free(&arena);
+    ASSERT_EQ(0, arena_init_with(&arena, mb, NULL));
+    ASSERT_EQ(0, arena.mapped);
+    arena_free(&arena);
+}
+
+TEST(search_pool_resets_slots_between_games) {
+    const size_t size = 1024 * 1024;
+    SearchSlot *slot = search_pool_acquire(0, size, NULL, 1, 1);
+    ASSERT_NOT_NULL(slot);
+    ASSERT_NOT_NULL(slot->spare.buffer);
+    ASSERT_NOT_NULL(slot->tt);
+    unsigned char *buffer = slot->arena.buffer;
+    TranspositionTable *tt = slot->tt;
+    uint64_t generation = tt->generation;
+    ASSERT_NOT_NULL(arena_alloc(&slot->arena, 4096));
+    ASSERT_GT(atomic_load(&slot->arena.offset), 0);
+    
+    // Next game: same memory, emptied
+    SearchSlot *again = search_pool_acquire(0, size, NULL, 0, 1);
+    ASSERT_TRUE(again == slot);
+    ASSERT_TRUE(again->arena.buffer == buffer);
+    ASSERT_EQ(0, (int)atomic_load(&again->arena.offset));
+    ASSERT_TRUE(again->tt == tt);
+    ASSERT_NE(generation, again->tt->generation);
+    
+    // Another size is reallocated; other slots are independent
+    SearchSlot *bigger = search_pool_acquire(0, 2 * size, NULL, 0, 0);
+    ASSERT_NOT_NULL(bigger);
+    ASSERT_EQ(2 * size, bigger->arena.size);
+    SearchSlot *other = search_pool_acquire(1, size, NULL, 0, 0);
+    ASSERT_NOT_NULL(other);
+    ASSERT_TRUE(other != bigger);
+    ASSERT_TRUE(search_pool_acquire(SEARCH_POOL_SLOTS, size, NULL, 0, 0) == NULL);
+    
+    search_pool_release();
+}
+
+// =============================================================================
+// INFERENCE RING TESTS
+// =============================================================================
+
+TEST(search_inference_ring_is_fifo_and_bounded) {
+    static InferenceQueue q;
+    inference_queue_init(&q);
+    static InferenceRequest reqs[INFERENCE_RING_SIZE + 1];
+    
+    for (int i = 0; i < INFERENCE_RING_SIZE; i++) ASSERT_TRUE(inference_queue_push(&q, &reqs[i]));
+    ASSERT_FALSE(inference_queue_push(&q, &reqs[INFERENCE_RING_SIZE]));
+    
+    for (int i = 0; i < INFERENCE_RING_SIZE; i++) ASSERT_TRUE(inference_queue_pop(&q) == &reqs[i]);
+    ASSERT_TRUE(inference_queue_pop(&q) == NULL);
+    
+    // Slots are reusable after a full lap
+    ASSERT_TRUE(inference_queue_push(&q, &reqs[0]));
+    ASSERT_TRUE(inference_queue_pop(&q) == &reqs[0]);
+    inference_queue_destroy(&q);
+}
+
+#define RING_TEST_PRODUCERS 4
+#define RING_TEST_REQUESTS  500
+
+typedef struct {
+    InferenceQueue *q;
+    int id;
+    int completed;
+} RingTestArgs;
+
+static void *ring_test_producer(void *arg) {
+    RingTestArgs *t = (RingTestArgs*)arg;
+    for (int i = 0; i < RING_TEST_REQUESTS; i++) {
+        float value = -1.0f;
+        InferenceRequest req;
+        req.node = (Node*)(uintptr_t)(t->id + 1);   // Tag only, never dereferenced
+        req.policy_out = NULL;
+        req.value_out = &value;
+        atomic_init(&req.ready, 0);
+        while (!inference_queue_push(t->q, &req)) sched_yield();
+        if (!inference_request_wait(&req, t->q)) break;
+        if (value == (float)t->id) t->completed++;
+    }
+    return NULL;
+}
+
+TEST(search_inference_ring_multi_producer_handoff) {
+    static InferenceQueue q;
+    inference_queue_init(&q);
+    
+    RingTestArgs args[RING_TEST_PRODUCERS];
+    pthread_t threads[RING_TEST_PRODUCERS];
+    for (int t = 0; t < RING_TEST_PRODUCERS; t++) {
+        args[t] = (RingTestArgs){ .q = &q, .id = t, .completed = 0 };
+        pthread_create(&threads[t], NULL, ring_test_producer, &args[t]);
+    }
+    
+    // Consumer: answer each request with its producer's id
+    int served = 0;
+    while (served < RING_TEST_PRODUCERS * RING_TEST_REQUESTS) {
+        InferenceRequest *req = inference_queue_pop(&q);
+        if (!req) {
+            inference_queue_wait_work(&q, 1000);
+            continue;
+        }
+        *req->value_out = (float)((uintptr_t)req->node - 1);
+        served++;
+        inference_request_complete(req);
+        inference_queue_notify_done(&q);
+    }
+    for (int t = 0; t < RING_TEST_PRODUCERS; t++) pthread_join(threads[t], NULL);
+    
+    ASSERT_EQ(RING_TEST_PRODUCERS * RING_TEST_REQUESTS, served);
+    for (int t = 0; t < RING_TEST_PRODUCERS; t++) ASSERT_EQ(RING_TEST_REQUESTS, args[t].completed);
+    inference_queue_destroy(&q);
+}
+
+// =============================================================================
+// EXPANSION CLAIM TESTS
+// =============================================================================
+
+TEST(search_expansion_claim_is_exclusive) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    Node *root = mcts_create_root(state, &arena, config);
+    
+    ASSERT_EQ(NODE_UNEXPANDED, root->expand_state);
+    ASSERT_TRUE(node_try_claim_expansion(root));
+    ASSERT_FALSE(node_try_claim_expansion(root));
+    
+    // While claimed, other expanders back off and get the leaf back
+    ASSERT_TRUE(mcts_expand_vanilla(root, &arena, NULL, config, NULL) == root);
+    ASSERT_EQ(0, root->num_children);
+    
+    node_release_expansion(root, 0);
+    ASSERT_EQ(NODE_UNEXPANDED, root->expand_state);
+    Node *child = mcts_expand_vanilla(root, &arena, NULL, config, NULL);
+    ASSERT_TRUE(child != root);
+    ASSERT_EQ(1, root->num_children);
+    
+    arena_free(&arena);
+}
+
+TEST(search_expand_with_policy_marks_expanded) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    Node *root = mcts_create_root(state, &arena, config);
+    
+    mcts_expand_with_policy(root, &arena, NULL, config, NULL, NULL);
+    ASSERT_EQ(NODE_EXPANDED, root->expand_state);
+    ASSERT_EQ(7, root->num_children);
+    
+    // Uniform priors without a policy
+    for (int i = 0; i < root->num_children; i++) {
+        ASSERT_FLOAT_EQ(1.0f / 7.0f, root->children[i]->prior, 1e-5f);
+    }
+    
+    // A second expansion is a no-op
+    mcts_expand_with_policy(root, &arena, NULL, config, NULL, NULL);
+    ASSERT_EQ(7, root->num_children);
+    
+    arena_free(&arena);
+}
+
+TEST(search_threaded_vanilla_search_is_consistent) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 2000;
+    config.num_threads = 4;
+    
+    Node *root = mcts_create_root(state, &arena, config);
+    MCTSStats stats = {0};
+    mcts_search(root, &arena, 2.0, config, &stats, NULL, NULL);
+    
+    ASSERT_GT(root->visits, 0);
+    
+    int sum_child_visits = 0;
+    for (int i = 0; i < root->num_children; i++) {
+        sum_child_visits += root->children[i]->visits;
+        ASSERT_LE(root->children[i]->virtual_loss, 0);
+    }
+    // Only the root-level backoffs/backprops stop at the root itself
+    ASSERT_LE(sum_child_visits, root->visits);
+    ASSERT_GE(root->score, 0.0);
+    ASSERT_LE(root->score, (double)root->visits);
+    
+    arena_free(&arena);
+}
+
+TEST(search_threaded_cnn_search_stops_at_node_limit) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    config.cnn_weights = &weights;
+    config.num_threads = 3;
+    config.max_nodes = 200;
+    
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    
+    // Workers stop themselves (node limit or early exit); at most one
+    // iteration each in flight
+    ASSERT_TRUE(root->visits >= 200 || should_exit_early(root, 200));
+    ASSERT_LE(root->visits, 200 + config.num_threads);
+    for (int i = 0; i < root->num_children; i++) ASSERT_LE(root->children[i]->virtual_loss, 0);
+    
+    cnn_free(&weights);
+    arena_free(&arena);
+}
+
+TEST(search_threaded_search_stops_on_time) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.num_threads = 2;
+    config.max_nodes = 0;   // Clock only
+    
+    Node *root = mcts_create_root(state, &arena, config);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    mcts_search(root, &arena, 0.05, config, NULL, NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    
+    ASSERT_TRUE(elapsed >= 0.05);
+    ASSERT_TRUE(elapsed < 0.5);
+    ASSERT_GT(root->visits, EARLY_EXIT_MIN_VISITS);
+    
+    arena_free(&arena);
+}
+
+// Root child visits and scores of a deterministic search
+static int deterministic_search(MCTSConfig config, double time_limit, int *visits, double *scores) {
+    GameState state;
+    init_game(&state);
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, time_limit, config, NULL, NULL, NULL);
+    int n = root->num_children;
+    for (int i = 0; i < n; i++) {
+        visits[i] = root->children[i]->visits;
+        scores[i] = root->children[i]->score;
+    }
+    visits[n] = root->visits;
+    arena_free(&arena);
+    return n;
+}
+
+TEST(search_deterministic_tree_ignores_threads_and_clock) {
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 1500;
+    config.deterministic = 1;
+    config.seed = 1234;
+    config.leaf_batch = 8;
+    
+    int v1[MAX_MOVES + 1], v2[MAX_MOVES + 1];
+    double s1[MAX_MOVES], s2[MAX_MOVES];
+    int n1 = deterministic_search(config, 0.0, v1, s1);
+    ASSERT_GT(n1, 1);
+    ASSERT_GT(v1[n1], 100);
+    
+    // Worker count and a tiny time limit change nothing but the speed
+    config.num_threads = 4;
+    int n2 = deterministic_search(config, 1e-6, v2, s2);
+    ASSERT_EQ(n1, n2);
+    for (int i = 0; i <= n1; i++) ASSERT_EQ(v1[i], v2[i]);
+    for (int i = 0; i < n1; i++) ASSERT_FLOAT_EQ(s1[i], s2[i], 0.0);
+    
+    // Root-parallel trees are reproducible too
+    config.root_parallel = 1;
+    n1 = deterministic_search(config, 0.0, v1, s1);
+    n2 = deterministic_search(config, 0.0, v2, s2);
+    ASSERT_EQ(n1, n2);
+    for (int i = 0; i <= n1; i++) ASSERT_EQ(v1[i], v2[i]);
+    
+    // Another seed, another tree
+    config.root_parallel = 0;
+    n1 = deterministic_search(config, 0.0, v1, s1);
+    config.seed = 4321;
+    n2 = deterministic_search(config, 0.0, v2, s2);
+    int same = n1 == n2;
+    for (int i = 0; same && i < n1; i++) same = v1[i] == v2[i] && s1[i] == s2[i];
+    ASSERT_FALSE(same);
+}
+
+TEST(search_root_parallel_merges_root_statistics) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 2000;
+    config.num_threads = 4;
+    config.root_parallel = 1;
+    
+    Node *root = mcts_create_root(state, &arena, config);
+    MCTSStats stats = {0};
+    Move best = mcts_search(root, &arena, 0.0, config, &stats, NULL, NULL);
+    
+    // The caller's tree searched a quarter of the budget, the merge adds the rest
+    ASSERT_GT(root->visits, 1000);
+    ASSERT_LE(root->visits, 2000 + config.num_threads);
+    ASSERT_GT(stats.current_move_iterations, 1000);
+    int sum_child_visits = 0, best_visits = 0;
+    for (int i = 0; i < root->num_children; i++) {
+        const Node *c = root->children[i];
+        sum_child_visits += c->visits;
+        if (c->visits > best_visits) best_visits = c->visits;
+        ASSERT_LE(c->score, (double)c->visits);
+    }
+    ASSERT_LE(sum_child_visits, root->visits);
+    ASSERT_EQ(root->num_legal, root->num_children);
+    
+    MoveList legal;
+    movegen_generate(&state, &legal);
+    int found = 0;
+    for (int i = 0; i < legal.count; i++) {
+        if (move_pack(&legal.moves[i]) == move_pack(&best)) found = 1;
+    }
+    ASSERT_TRUE(found);
+    
+    // Time only: every tree stops with the first
+    arena_reset(&arena);
+    config.max_nodes = 0;
+    root = mcts_create_root(state, &arena, config);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    mcts_search(root, &arena, 0.05, config, NULL, NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    ASSERT_TRUE(elapsed < 0.5);
+    ASSERT_GT(root->visits, EARLY_EXIT_MIN_VISITS);
+    
+    arena_free(&arena);
+}
+
+TEST(search_batched_rollouts_average_their_lanes) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_PURE_VANILLA);
+    Node *root = mcts_create_root(state, &arena, config);
+    
+    // One lane: a game result (win, draw or loss)
+    RNG rng;
+    rng_seed(&rng, 12345);
+    mcts_rollout_set_rng(&rng);
+    double one = simulate_rollout(root, config);
+    ASSERT_TRUE(one == WIN_SCORE || one == DRAW_SCORE || one == LOSS_SCORE);
+    
+    // Eight lanes: the mean of eight results, the same for the same seed
+    config.rollouts_per_leaf = ROLLOUT_BATCH_MAX;
+    rng_seed(&rng, 777);
+    double mean = simulate_rollout(root, config);
+    rng_seed(&rng, 777);
+    ASSERT_FLOAT_EQ(mean, simulate_rollout(root, config), 1e-12);
+    double scaled = mean * ROLLOUT_BATCH_MAX * 4.0;     // Results are multiples of 1/4
+    ASSERT_FLOAT_EQ(scaled, (double)(long)(scaled + 0.5), 1e-9);
+    ASSERT_GE(mean, 0.0);
+    ASSERT_LE(mean, 1.0);
+    mcts_rollout_set_rng(NULL);
+    
+    // Searches run on them
+    config.max_nodes = 100;
+    mcts_search(root, &arena, 0.0, config, NULL, NULL, NULL);
+    ASSERT_GE(root->visits, 100);
+    ASSERT_LE(root->score, (double)root->visits);
+    
+    arena_free(&arena);
+}
+
+// Square-by-square heuristic the masks replace
+static double reference_heuristic(int us, const Move *m, const MCTSConfig *c) {
+    int to = m->path[m->length == 0 ? 1 : m->length], from = m->path[0];
+    int row = to / 8, col = to % 8, from_row = from / 8;
+    double score = 0.0;
+    if (m->length > 0) score += c->weights.w_capture * m->length;
+    if (!m->is_lady_move) {
+        if (row == 0 || row == 7) score += c->weights.w_promotion;
+        int dist = (us == WHITE) ? (7 - row) : row;
+        score += (7 - dist) * c->weights.w_advance;
+    }
+    if (!m->is_lady_move && (col == 0 || col == 7)) score += c->weights.w_edge;
+    if ((row == 3 || row == 4) && (col >= 2 && col <= 5)) score += c->weights.w_center;
+    if (!m->is_lady_move && ((us == WHITE && from_row == 0) || (us == BLACK && from_row == 7))) {
+        score -= c->weights.w_base;
+    }
+    if (m->is_lady_move) score += c->weights.w_lady_activity;
+    return score;
+}
+
+TEST(search_move_heuristic_matches_square_rules) {
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_GRANDMASTER);
+    RNG rng;
+    rng_seed(&rng, 4242);
+    int checked = 0;
+    for (int game = 0; game < 20; game++) {
+        GameState state;
+        init_game(&state);
+        for (int ply = 0; ply < 120; ply++) {
+            MoveList list;
+            movegen_generate(&state, &list);
+            if (list.count == 0) break;
+            MoveHeuristic h;
+            move_heuristic_init(&h, &state, &config);
+            for (int i = 0; i < list.count; i++) {
+                const Move *m = &list.moves[i];
+                double want = reference_heuristic(state.current_player, m, &config);
+                ASSERT_FLOAT_EQ(want, move_heuristic_packed(&h, move_pack(m)), 1e-12);
+                ASSERT_FLOAT_EQ(want, evaluate_move_heuristic(&state, m, config), 1e-12);
+                
+                // The set-wise shortcut agrees with the full generation
+                GameState child = state;
+                apply_move(&child, m);
+                int to = m->path[m->length == 0 ? 1 : m->length];
+                int threatened = 0;
+                if (movegen_has_capture(&child)) {
+                    MoveList replies;
+                    movegen_generate(&child, &replies);
+                    for (int r = 0; r < replies.count && !threatened; r++) {
+                        for (int k = 0; k < replies.moves[r].length; k++) {
+                            if (replies.moves[r].captured_squares[k] == to) threatened = 1;
+                        }
+                    }
+                }
+                ASSERT_EQ(threatened, movegen_is_square_threatened(&child, to));
+                checked++;
+            }
+            apply_move(&state, &list.moves[rng_u32(&rng) % list.count]);
+        }
+    }
+    ASSERT_GT(checked, 1000);
+}
+
+TEST(search_sequential_leaf_batch_is_consistent) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    config.cnn_weights = &weights;
+    config.num_threads = 0;
+    config.leaf_batch = 8;
+    config.max_nodes = 300;
+    
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    
+    // Batches never overshoot the node budget
+    ASSERT_GT(root->visits, 0);
+    ASSERT_LE(root->visits, 300);
+    
+    int sum_child_visits = 0;
+    for (int i = 0; i < root->num_children; i++) {
+        sum_child_visits += root->children[i]->visits;
+        ASSERT_LE(root->children[i]->virtual_loss, 0);
+    }
+    ASSERT_LE(sum_child_visits, root->visits);
+    ASSERT_GT(sum_child_visits, 1);
+    
+    cnn_free(&weights);
+    arena_free(&arena);
+}
+
+TEST(search_nn_cache_hits_on_repeated_search) {
+    GameState state;
+    init_game(&state);
+    CNNWeights weights;
+    cnn_init(&weights);
+    CNNCache *cache = cnn_cache_create(4096);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    config.cnn_weights = &weights;
+    config.num_threads = 0;
+    config.max_nodes = 100;
+    config.cnn_cache = cache;
+    
+    MCTSStats first = {0}, second = {0};
+    for (int pass = 0; pass < 2; pass++) {
+        Arena arena;
+        arena_init(&arena, ARENA_SIZE_BENCHMARK);
+        Node *root = mcts_create_root(state, &arena, config);
+        mcts_search(root, &arena, 5.0, config, pass ? &second : &first, NULL, NULL);
+        ASSERT_GT(root->visits, 0);
+        arena_free(&arena);
+    }
+    
+    // Fresh tree, same positions: the second search is served by the cache
+    ASSERT_GT(first.nn_cache_misses, 0);
+    ASSERT_GT(second.nn_cache_hits, 0);
+    ASSERT_LT(second.nn_cache_misses, first.nn_cache_misses);
+    
+    cnn_cache_free(cache);
+    cnn_free(&weights);
+}
+
+#define SERVER_TEST_GAMES 3
+
+typedef struct {
+    MCTSConfig config;
+    Arena arena;
+    Node *root;
+} ServerTestGame;
+
+static void *server_test_game(void *arg) {
+    ServerTestGame *g = (ServerTestGame*)arg;
+    GameState state;
+    init_game(&state);
+    g->root = mcts_create_root(state, &g->arena, g->config);
+    mcts_search(g->root, &g->arena, 5.0, g->config, NULL, NULL, NULL);
+    return NULL;
+}
+
+TEST(search_inference_server_batches_across_searches) {
+    CNNWeights weights;
+    cnn_init(&weights);
+    InferenceServer server;
+    ASSERT_EQ(ERR_OK, inference_server_start(&server, &weights, SERVER_TEST_GAMES * 4,
+                                                  INFERENCE_SERVER_GATHER_US, 1));
+    
+    static ServerTestGame games[SERVER_TEST_GAMES];
+    pthread_t threads[SERVER_TEST_GAMES];
+    for (int g = 0; g < SERVER_TEST_GAMES; g++) {
+        games[g].config = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+        games[g].config.cnn_weights = &weights;
+        games[g].config.num_threads = 0;
+        games[g].config.leaf_batch = 4;
+        games[g].config.max_nodes = 100;
+        games[g].config.inference_server = &server;
+        arena_init(&games[g].arena, ARENA_SIZE_BENCHMARK);
+        pthread_create(&threads[g], NULL, server_test_game, &games[g]);
+    }
+    for (int g = 0; g < SERVER_TEST_GAMES; g++) pthread_join(threads[g], NULL);
+    inference_server_stop(&server);
+    
+    long leaves = 0;
+    for (int g = 0; g < SERVER_TEST_GAMES; g++) {
+        Node *root = games[g].root;
+        ASSERT_GT(root->visits, 0);
+        ASSERT_LE(root->visits, 100);
+        for (int i = 0; i < root->num_children; i++) ASSERT_LE(root->children[i]->virtual_loss, 0);
+        leaves += root->visits;
+        arena_free(&games[g].arena);
+    }
+    
+    // Every evaluation went through the server, several per forward pass
+    ASSERT_GT(atomic_load(&server.total_requests), 0);
+    ASSERT_LE(atomic_load(&server.total_requests), leaves);
+    ASSERT_LT(atomic_load(&server.total_batches), atomic_load(&server.total_requests));
+    cnn_free(&weights);
+}
+
 // =============================================================================
 // MCTS PRESET TESTS
 // =============================================================================
@@ -116,17 +821,250 @@ TEST(search_create_root_generates_children) {
     
     Node *root = mcts_create_root(state, &arena, config);
     
-    // Root should have untried moves or children
-    // Depending on implementation, children may be created lazily
-    ASSERT_TRUE(root->num_children >= 0 || root->untried_moves.count > 0);
+    // Children are created lazily: the root only records its legal move count
+    ASSERT_EQ(7, root->num_legal);
+    ASSERT_EQ(0, root->num_children);
+    ASSERT_FALSE(node_is_fully_expanded(root));
     
     arena_free(&arena);
 }
 
+TEST(search_expand_node_allocates_exact_children) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    Node *root = mcts_create_root(state, &arena, config);
+    ASSERT_TRUE(root->children == NULL);
+    
+    for (int i = 0; i < root->num_legal; i++) {
+        Node *child = expand_node(root, &arena, NULL, config, NULL);
+        ASSERT_TRUE(child != root);
+        ASSERT_TRUE(child->parent == root);
+    }
+    ASSERT_EQ(7, root->num_children);
+    ASSERT_TRUE(node_is_fully_expanded(root));
+    
+    // Every child must be a distinct legal move
+    for (int i = 0; i < root->num_children; i++) {
+        for (int j = i + 1; j < root->num_children; j++) {
+            ASSERT_TRUE(root->children[i]->move_from_parent != root->children[j]->move_from_parent);
+        }
+    }
+    
+    // Fully expanded: further calls are no-ops
+    ASSERT_TRUE(expand_node(root, &arena, NULL, config, NULL) == root);
+    ASSERT_EQ(7, root->num_children);
+    
+    arena_free(&arena);
+}
+
+// Every slot that is not foreign mirrors its child; owned children know their slot
+static void check_child_stats(const Node *node, int *checked) {
+    if (!node->children) return;
+    ChildStats s = child_stats_of(node);
+    for (int i = 0; i < node->num_children; i++) {
+        const Node *child = node->children[i];
+        if (!(*s.foreign & (1ULL << i))) {
+            ASSERT_TRUE(child->parent == node);
+            ASSERT_EQ(i, child->slot);
+            ASSERT_EQ(child->visits, s.visits[i]);
+            ASSERT_EQ(child->status, s.status[i]);
+            ASSERT_TRUE(fabs(s.score[i] - child->score) <= 1e-3 * (1.0 + fabs(child->score)));
+            ASSERT_TRUE(s.prior[i] == child->prior);
+            (*checked)++;
+        }
+        check_child_stats(child, checked);
+    }
+}
+
+TEST(search_child_stats_mirror_children) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 2000;
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    
+    int checked = 0;
+    check_child_stats(root, &checked);
+    ASSERT_GT(checked, 100);
+    
+    arena_free(&arena);
+}
+
+// Vectorized pick vs the scalar formulas on every expanded node
+static void check_selection(Node *node, MCTSConfig config, int *checked) {
+    if (!node->children || node->num_children == 0) return;
+    if (node_is_fully_expanded(node)) {
+        double best = -1e9;
+        for (int i = 0; i < node->num_children; i++) {
+            double v = calculate_ucb1_score(node->children[i], config);
+            if (config.use_solver && node->children[i]->status == SOLVED_WIN) v = -100000.0;
+            if (config.use_solver && node->children[i]->status == SOLVED_LOSS) v = 100000.0 + node->children[i]->score;
+            if (v > best) best = v;
+        }
+        int pick = select_child_index(node, config);
+        ASSERT_TRUE(pick >= 0 && pick < node->num_children);
+        Node *child = node->children[pick];
+        double v = calculate_ucb1_score(child, config);
+        if (config.use_solver && child->status == SOLVED_WIN) v = -100000.0;
+        if (config.use_solver && child->status == SOLVED_LOSS) v = 100000.0 + child->score;
+        // Float lanes may only split near-ties differently
+        ASSERT_TRUE(v >= best - 1e-4 * (1.0 + fabs(best)));
+        (*checked)++;
+    }
+    for (int i = 0; i < node->num_children; i++) check_selection(node->children[i], config, checked);
+}
+
+// Non-uniform priors for the PUCT pass
+static void assign_priors(Node *node) {
+    if (!node->children) return;
+    for (int i = 0; i < node->num_children; i++) {
+        node->children[i]->prior = 1.0f / (float)(1 + (i * 7 + node->depth) % 5);
+        assign_priors(node->children[i]);
+    }
+    child_stats_rebuild(node);
+}
+
+TEST(search_vectorized_selection_matches_scalar) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 3000;
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    assign_priors(root);
+    
+    for (int mode = 0; mode < 5; mode++) {
+        MCTSConfig c = config;
+        c.use_puct = (mode == 2);
+        c.use_ucb1_tuned = (mode == 1);
+        c.use_progressive_bias = (mode >= 3);
+        c.use_solver = (mode == 4);
+        int checked = 0;
+        check_selection(root, c, &checked);
+        ASSERT_GT(checked, 20);
+    }
+    
+    arena_free(&arena);
+}
+
+// Descent by select_child_index alone: the generic reference of the kernels
+static Node* reference_descent(Node *root, MCTSConfig config) {
+    Node *current = root;
+    while (!current->is_terminal && node_is_fully_expanded(current) && current->num_children > 0) {
+        int best = select_child_index(current, config);
+        if (best < 0) break;
+        current = current->children[best];
+    }
+    return current;
+}
+
+TEST(search_select_kernels_match_generic) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 3000;
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    assign_priors(root);
+    
+    MCTSConfig gm = mcts_get_preset(MCTS_PRESET_GRANDMASTER);
+    MCTSConfig az = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    MCTSConfig odd = mcts_get_preset(MCTS_PRESET_TUNED_ONLY);
+    odd.use_progressive_bias = 1;
+    odd.bias_constant = 0.5;
+    odd.weights = gm.weights;
+    
+    // Presets get their own kernels; other combinations share the generic one
+    ASSERT_TRUE(mcts_select_kernel(&config) != mcts_select_kernel(&gm));
+    ASSERT_TRUE(mcts_select_kernel(&gm) != mcts_select_kernel(&az));
+    MCTSConfig odd2 = odd;
+    odd2.use_solver = 1;
+    ASSERT_TRUE(mcts_select_kernel(&odd) == mcts_select_kernel(&odd2));
+    
+    MCTSConfig configs[4] = {config, gm, az, odd};
+    for (int c = 0; c < 4; c++) {
+        Node *expected = reference_descent(root, configs[c]);
+        Node *leaf = mcts_select_kernel(&configs[c])(root, &configs[c]);
+        ASSERT_TRUE(leaf == expected);
+        for (Node *n = leaf; n != root; n = n->parent) {
+            atomic_fetch_sub(&n->virtual_loss, 1);
+            child_stats_publish_virtual_loss(n);
+        }
+    }
+    
+    path_set_invalidate(&path_tls);
+    arena_free(&arena);
+}
+
 // =============================================================================
 // MCTS SEARCH TESTS
 // =============================================================================
 
+TEST(search_path_set_detects_repetition) {
+    GameState s0;
+    init_game(&s0);
+    s0.piece[WHITE][PAWN] = 0;
+    s0.piece[BLACK][PAWN] = 0;
+    s0.piece[WHITE][LADY] = BIT(1);
+    s0.piece[BLACK][LADY] = BIT(62);
+    s0.hash = zobrist_compute_hash(&s0);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    Node *root = mcts_create_root(s0, &arena, config);
+    
+    // Ladies shuffle out and back: the fourth ply repeats the root
+    const int from[4] = {1, 62, 10, 53};
+    const int to[4]   = {10, 53, 1, 62};
+    Node *nodes[4];
+    Node *parent = root;
+    GameState s = s0;
+    
+    path_set_begin(&path_tls, root);
+    for (int i = 0; i < 4; i++) {
+        Move m = {0};
+        m.path[0] = (uint8_t)from[i];
+        m.path[1] = (uint8_t)to[i];
+        m.is_lady_move = 1;
+        apply_move(&s, &m);
+        // Detach the last parent: only the path set can see the root now
+        if (i == 3) parent->parent = NULL;
+        nodes[i] = create_node(parent, move_pack(&m), s, &arena, config);
+        ASSERT_NOT_NULL(nodes[i]);
+        path_set_push(&path_tls, nodes[i]);
+        parent = nodes[i];
+    }
+    
+    ASSERT_EQ(s0.hash, nodes[3]->state.hash);
+    for (int i = 0; i < 3; i++) ASSERT_EQ(SOLVED_NONE, nodes[i]->status);
+    ASSERT_EQ(SOLVED_DRAW, nodes[3]->status);
+    ASSERT_TRUE(nodes[3]->is_terminal);
+    
+    // Rewind to the root: the repeated position is gone from the set
+    path_set_begin(&path_tls, root);
+    ASSERT_TRUE(path_set_contains(&path_tls, s0.hash));
+    ASSERT_FALSE(path_set_contains(&path_tls, nodes[0]->state.hash));
+    
+    path_set_invalidate(&path_tls);
+    arena_free(&arena);
+}
+
 TEST(search_mcts_search_returns_valid_move) {
     GameState state;
     init_game(&state);
@@ -237,6 +1175,91 @@ TEST(search_get_tree_node_count_matches_stats) {
     arena_free(&arena);
 }
 
+static void count_expanded(const Node *node, long *expanded, long *children) {
+    if (node->num_children == 0) return;
+    (*expanded)++;
+    *children += node->num_children;
+    for (int i = 0; i < node->num_children; i++) count_expanded(node->children[i], expanded, children);
+}
+
+TEST(search_incremental_stats_match_tree_walk) {
+    for (int threads = 0; threads <= 2; threads += 2) {
+        GameState state;
+        init_game(&state);
+        
+        Arena arena;
+        arena_init(&arena, ARENA_SIZE_BENCHMARK);
+        
+        MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+        config.max_nodes = 400;
+        config.num_threads = threads;
+        
+        Node *root = mcts_create_root(state, &arena, config);
+        MCTSStats stats = {0};
+        mcts_search(root, &arena, 1.0, config, &stats, NULL, NULL);
+        
+        // Fresh tree: every node was created, and reached, by this search
+        long expanded = 0, children = 0;
+        count_expanded(root, &expanded, &children);
+        ASSERT_EQ(stats.max_depth, get_tree_depth(root));
+        ASSERT_EQ(stats.total_depth, stats.max_depth);
+        ASSERT_EQ(stats.nodes_with_children, expanded);
+        ASSERT_EQ(stats.total_children_expanded, children);
+        ASSERT_EQ(stats.total_nodes, get_tree_node_count(root) - 1);
+        
+        arena_free(&arena);
+    }
+}
+
+TEST(search_profile_records_phases) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 200;
+    Node *root = mcts_create_root(state, &arena, config);
+    MCTSStats stats = {0};
+    mcts_search(root, &arena, 1.0, config, &stats, NULL, NULL);
+    ASSERT_TRUE(profile_tls == NULL);   // Unbound on return
+    int visits = root->visits;
+    
+    MCTSConfig cnn = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    cnn.max_nodes = 200;
+    cnn.cnn_weights = &weights;
+    arena_reset(&arena);
+    Node *cnn_root = mcts_create_root(state, &arena, cnn);
+    MCTSStats cnn_stats = {0};
+    mcts_search(cnn_root, &arena, 1.0, cnn, &cnn_stats, NULL, NULL);
+
+#ifdef MCTS_PROFILE
+    // One descent and one backprop per iteration
+    ASSERT_EQ(stats.profile.calls[PROFILE_SELECT], visits);
+    ASSERT_EQ(stats.profile.calls[PROFILE_BACKPROP], visits);
+    ASSERT_GT(stats.profile.calls[PROFILE_ROLLOUT], 0);
+    ASSERT_GT(stats.profile.calls[PROFILE_MOVEGEN], 0);
+    ASSERT_GT(stats.profile.calls[PROFILE_HEURISTIC], 0);
+    
+    // Every forward pass lands in one batch size bin
+    long batches = 0;
+    for (int i = 0; i < PROFILE_BATCH_BINS; i++) batches += cnn_stats.profile.batches[i];
+    ASSERT_GT(batches, 0);
+    ASSERT_EQ(batches, cnn_stats.profile.calls[PROFILE_INFERENCE]);
+#else
+    // Compiled out: nothing recorded
+    (void)visits;
+    ASSERT_TRUE(mcts_profile_empty(&stats.profile));
+    ASSERT_TRUE(mcts_profile_empty(&cnn_stats.profile));
+#endif
+    
+    cnn_free(&weights);
+    arena_free(&arena);
+}
+
 // =============================================================================
 // POLICY EXTRACTION TESTS
 // =============================================================================
@@ -433,10 +1456,148 @@ TEST(search_tt_mask_is_power_of_two) {
     TranspositionTable *tt = tt_create(1024);
     
     ASSERT_NOT_NULL(tt);
-    // Mask should be size - 1 for power-of-2 bucket hashing
-    ASSERT_EQ(1023, tt->mask);
+    // Mask should be num_buckets - 1 for power-of-2 bucket hashing
+    ASSERT_EQ(1024 / TT_WAYS, tt->num_buckets);
+    ASSERT_EQ(tt->num_buckets - 1, tt->mask);
+    ASSERT_EQ(0, tt->mask & (tt->mask + 1));
+    
+    tt_free(tt);
+}
+
+TEST(search_tt_bucket_is_one_cache_line) {
+    ASSERT_EQ(64, sizeof(TTBucket));
+    
+    TranspositionTable *tt = tt_create(1024);
+    ASSERT_NOT_NULL(tt);
+    ASSERT_EQ(0, (uintptr_t)tt->buckets % 64);
+    tt_free(tt);
+}
+
+TEST(search_tt_bucket_holds_multiple_positions) {
+    // Single bucket: every position collides
+    TranspositionTable *tt = tt_create(TT_WAYS);
+    ASSERT_NOT_NULL(tt);
+    ASSERT_EQ(1, tt->num_buckets);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    
+    GameState state;
+    init_game(&state);
+    MoveList moves;
+    movegen_generate(&state, &moves);
+    ASSERT_GE(moves.count, TT_WAYS);
+    
+    GameState children[TT_WAYS];
+    for (int i = 0; i < TT_WAYS; i++) {
+        children[i] = state;
+        apply_move(&children[i], &moves.moves[i]);
+        Node *n = create_node(NULL, move_pack(&moves.moves[i]), children[i], &arena, config);
+        ASSERT_NOT_NULL(n);
+        tt_insert(tt, n);
+    }
+    
+    ASSERT_EQ(TT_WAYS, tt->count);
+    for (int i = 0; i < TT_WAYS; i++) {
+        Node *found = tt_lookup(tt, &children[i]);
+        ASSERT_NOT_NULL(found);
+        ASSERT_EQ(children[i].hash, found->state.hash);
+    }
+    
+    tt_free(tt);
+    arena_free(&arena);
+}
+
+TEST(search_tt_reset_invalidates_entries) {
+    TranspositionTable *tt = tt_create(1024);
+    ASSERT_NOT_NULL(tt);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    
+    GameState state;
+    init_game(&state);
+    Node *n = create_node(NULL, PM_NONE, state, &arena, config);
+    tt_insert(tt, n);
+    ASSERT_NOT_NULL(tt_lookup(tt, &state));
+    
+    uint64_t gen = tt->generation;
+    tt_reset(tt);
+    ASSERT_NE(gen, tt->generation);
+    ASSERT_EQ(0, tt->count);
+    ASSERT_TRUE(tt_lookup(tt, &state) == NULL);
+    
+    // Stale slot is reusable in the new generation
+    tt_insert(tt, n);
+    ASSERT_NOT_NULL(tt_lookup(tt, &state));
+    ASSERT_EQ(1, tt->count);
+    
+    tt_free(tt);
+    arena_free(&arena);
+}
+
+TEST(search_tt_busy_slot_is_neither_matched_nor_taken) {
+    TranspositionTable *tt = tt_create(1024);
+    ASSERT_NOT_NULL(tt);
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    
+    GameState state;
+    init_game(&state);
+    Node *n = create_node(NULL, PM_NONE, state, &arena, config);
+    TTBucket *bucket = &tt->buckets[state.hash & tt->mask];
+    
+    // A slot mid-write (claimed, node not yet published) matches no lookup
+    tt_insert(tt, n);
+    int w = 0;
+    while (w < TT_WAYS && atomic_load(&bucket->entries[w].node) != n) w++;
+    ASSERT_LT(w, TT_WAYS);
+    atomic_store(&bucket->entries[w].key, TT_KEY_BUSY);
+    ASSERT_TRUE(tt_lookup(tt, &state) == NULL);
+    
+    // Nor is it evicted by another insert: with every way busy the insert is dropped
+    for (int k = 0; k < TT_WAYS; k++) atomic_store(&bucket->entries[k].key, TT_KEY_BUSY);
+    tt_reset(tt);
+    tt_insert(tt, n);
+    ASSERT_TRUE(tt_lookup(tt, &state) == NULL);
+    for (int k = 0; k < TT_WAYS; k++) ASSERT_TRUE(atomic_load(&bucket->entries[k].key) == TT_KEY_BUSY);
+    
+    // Published: key after node
+    atomic_store(&bucket->entries[1].key, 0);
+    tt_insert(tt, n);
+    ASSERT_TRUE(tt_lookup(tt, &state) == n);
+    ASSERT_TRUE(atomic_load(&bucket->entries[0].key) == TT_KEY_BUSY);
+    
+    tt_free(tt);
+    arena_free(&arena);
+}
+
+TEST(search_tt_stats_track_lookups) {
+    TranspositionTable *tt = tt_create(4096);
+    ASSERT_NOT_NULL(tt);
+    
+    GameState state;
+    init_game(&state);
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 300;
+    
+    Node *root = mcts_create_root(state, &arena, config);
+    MCTSStats stats = {0};
+    mcts_search(root, &arena, 1.0, config, &stats, tt, NULL);
+    
+    // Every vanilla expansion does exactly one lookup
+    ASSERT_GT(stats.tt_misses, 0);
+    ASSERT_EQ(stats.total_expansions, stats.tt_hits + stats.tt_misses);
+    ASSERT_GT(tt->count, 0);
     
     tt_free(tt);
+    arena_free(&arena);
 }
 
 // =============================================================================
@@ -461,12 +1622,209 @@ TEST(search_tree_reuse_preserves_stats) {
     // new_root should be a child with visits
     if (new_root) {
         ASSERT_GT(new_root->visits, 0);
-        ASSERT_TRUE(moves_equal(&new_root->move_from_parent, &best));
+        ASSERT_TRUE(new_root->move_from_parent == move_pack(&best));
+    }
+    
+    arena_free(&arena);
+}
+
+TEST(search_advance_root_compacts_subtree) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena, spare;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    arena_init(&spare, ARENA_SIZE_BENCHMARK);
+    TranspositionTable *tt = tt_create(4096);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.use_tt = 1;
+    config.max_nodes = 2000;
+    
+    Node *root = mcts_create_root(state, &arena, config);
+    Move best = mcts_search(root, &arena, 5.0, config, NULL, tt, NULL);
+    size_t used_before = atomic_load(&arena.offset);
+    
+    Move m = best;
+    Node *child = find_child_by_move(root, &m);
+    ASSERT_NOT_NULL(child);
+    int child_visits = child->visits;
+    int child_nodes = get_tree_node_count(child);
+    
+    GameState next = state;
+    apply_move(&next, &best);
+    Node *new_root = mcts_advance_root(root, &next, &arena, &spare, tt);
+    ASSERT_NOT_NULL(new_root);
+    
+    // Same statistics, only the kept subtree (plus history) in the arena
+    ASSERT_TRUE(states_equal(&new_root->state, &next));
+    ASSERT_EQ(new_root->visits, child_visits);
+    ASSERT_EQ(get_tree_node_count(new_root), child_nodes);
+    ASSERT_LT(atomic_load(&arena.offset), used_before);
+    ASSERT_EQ(atomic_load(&spare.offset), 0);
+    ASSERT_NOT_NULL(new_root->parent);
+    ASSERT_TRUE(states_equal(&new_root->parent->state, &state));
+    
+    // TT points at the copies, not at the discarded tree
+    if (new_root->num_children > 0) {
+        Node *c = new_root->children[0];
+        ASSERT_TRUE(tt_lookup(tt, &c->state) == c);
+    }
+    
+    // The search continues on the compacted tree
+    config.max_nodes = new_root->visits + 100;
+    mcts_search(new_root, &arena, 5.0, config, NULL, tt, NULL);
+    ASSERT_GT(new_root->visits, child_visits);
+    
+    tt_free(tt);
+    arena_free(&spare);
+    arena_free(&arena);
+}
+
+TEST(search_advance_root_swaps_arena_backing) {
+    GameState state;
+    init_game(&state);
+    
+    // Mapped arenas with pre-fault threads; the spare also releases on reset
+    const size_t mb = (size_t)1 << 20;
+    ArenaOptions backing = { ARENA_PAGES_THP, 64 * mb, 0 };
+    ArenaOptions spare_backing = { ARENA_PAGES_THP, 64 * mb, 4 * mb };
+    Arena arena, spare;
+    ASSERT_EQ(0, arena_init_with(&arena, 64 * mb, &backing));
+    ASSERT_EQ(0, arena_init_with(&spare, 64 * mb, &spare_backing));
+    ASSERT_NOT_NULL(arena.prefault);
+    ASSERT_NOT_NULL(spare.prefault);
+    const unsigned char *spare_buffer = spare.buffer;
+    const void *spare_prefault = spare.prefault, *arena_prefault = arena.prefault;
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 2000;
+    Node *root = mcts_create_root(state, &arena, config);
+    Move best = mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    GameState next = state;
+    apply_move(&next, &best);
+    Node *new_root = mcts_advance_root(root, &next, &arena, &spare, NULL);
+    ASSERT_NOT_NULL(new_root);
+    
+    // Each buffer keeps its own mapping, pre-fault thread and reset policy
+    ASSERT_TRUE(arena.buffer == spare_buffer);
+    ASSERT_TRUE(arena.prefault == spare_prefault);
+    ASSERT_TRUE(spare.prefault == arena_prefault);
+    ASSERT_EQ(4 * mb, arena.backing.reset_keep);
+    ASSERT_EQ(0, spare.backing.reset_keep);
+    ASSERT_EQ(64 * mb, arena.mapped);
+    
+    config.max_nodes = new_root->visits + 100;
+    mcts_search(new_root, &arena, 5.0, config, NULL, NULL, NULL);
+    arena_reset(&arena);
+    arena_reset(&spare);
+    arena_free(&spare);
+    arena_free(&arena);
+}
+
+TEST(search_advance_root_rejects_unknown_position) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena, spare;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    arena_init(&spare, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 50;
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    size_t used = atomic_load(&arena.offset);
+    
+    // Three plies away: out of reach, the tree is left untouched
+    GameState far = state;
+    for (int i = 0; i < 3; i++) {
+        MoveList list;
+        movegen_generate(&far, &list);
+        apply_move(&far, &list.moves[0]);
     }
+    ASSERT_TRUE(mcts_advance_root(root, &far, &arena, &spare, NULL) == NULL);
+    ASSERT_EQ(atomic_load(&arena.offset), used);
+    
+    arena_free(&spare);
+    arena_free(&arena);
+}
+
+// =============================================================================
+// BOUNDED MEMORY TESTS
+// =============================================================================
+
+TEST(search_prune_tree_keeps_root_statistics) {
+    GameState state;
+    init_game(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 3000;
+    Node *root = mcts_create_root(state, &arena, config);
+    mcts_search(root, &arena, 5.0, config, NULL, NULL, NULL);
+    
+    int root_visits = root->visits;
+    int root_children = root->num_children;
+    long before = get_tree_node_count(root);
+    ASSERT_GT(before, 1000);
+    
+    // Under the limit: nothing happens
+    long freed = -1;
+    ASSERT_EQ(mcts_prune_tree(root, &arena, NULL, before, 100, &freed), before);
+    ASSERT_EQ(freed, 0);
+    
+    long left = mcts_prune_tree(root, &arena, NULL, 500, 400, &freed);
+    ASSERT_GT(freed, 0);
+    ASSERT_EQ(left, before - freed);
+    ASSERT_LE(left, 400);
+    ASSERT_EQ(get_tree_node_count(root), left);
+    ASSERT_EQ(root->visits, root_visits);
+    ASSERT_EQ(root->num_children, root_children);
+    ASSERT_GT(atomic_load(&arena.free_bytes), 0);
+    
+    // Regrowth is served from the free lists first
+    size_t free_bytes = atomic_load(&arena.free_bytes);
+    config.max_nodes = 0;
+    mcts_search(root, &arena, 0.05, config, NULL, NULL, NULL);
+    ASSERT_GT(root->visits, root_visits);
+    ASSERT_LT(atomic_load(&arena.free_bytes), free_bytes);
     
     arena_free(&arena);
 }
 
+TEST(search_bounded_memory_search_stays_within_budget) {
+    GameState state;
+    init_game(&state);
+    
+    for (int threads = 0; threads <= 2; threads += 2) {
+        Arena arena;
+        arena_init(&arena, ARENA_SIZE_BENCHMARK);
+        
+        MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+        config.num_threads = threads;
+        config.max_nodes = 6000;
+        config.max_tree_nodes = 1000;
+        
+        MCTSStats stats = {0};
+        Node *root = mcts_create_root(state, &arena, config);
+        Move best = mcts_search(root, &arena, 10.0, config, &stats, NULL, NULL);
+        
+        // Well past the budget (early exit may stop short of max_nodes)
+        ASSERT_GT(root->visits, 3 * config.max_tree_nodes);
+        ASSERT_GT(stats.tree_prunes, 0);
+        ASSERT_GT(stats.nodes_recycled, 0);
+        // Budget plus what the threads' partly used chunks can hold
+        long slack = (long)((threads + 1) * arena.chunk_size / sizeof(Node));
+        ASSERT_LE(get_tree_node_count(root), config.max_tree_nodes + slack);
+        ASSERT_TRUE(best.path[0] != best.path[1] || best.length > 0);
+        
+        arena_free(&arena);
+    }
+}
+
 // =============================================================================
 // TT REPLACEMENT POLICY TESTS (NEW)
 // =============================================================================
@@ -484,8 +1842,9 @@ TEST(search_tt_higher_visits_not_replaced) {
     MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
     
     // Create node N1 with 100 visits
-    Move dummy_move = {0};
-    dummy_move.path[0] = 9; dummy_move.path[1] = 18;
+    Move dummy = {0};
+    dummy.path[0] = 9; dummy.path[1] = 18;
+    PackedMove dummy_move = move_pack(&dummy);
     Node *n1 = create_node(NULL, dummy_move, state, &arena, config);
     ASSERT_NOT_NULL(n1);
     atomic_store(&n1->visits, 100);
@@ -534,7 +1893,7 @@ TEST(search_more_nodes_equals_better_or_same_move) {
     Move move1 = mcts_search(root1, &arena1, 1.0, config, NULL, NULL, NULL);
     int visits1 = 0;
     for (int i = 0; i < root1->num_children; i++) {
-        if (moves_equal(&root1->children[i]->move_from_parent, &move1)) {
+        if (root1->children[i]->move_from_parent == move_pack(&move1)) {
             visits1 = root1->children[i]->visits;
             break;
         }
@@ -546,7 +1905,7 @@ TEST(search_more_nodes_equals_better_or_same_move) {
     Move move2 = mcts_search(root2, &arena2, 5.0, config, NULL, NULL, NULL);
     int visits2 = 0;
     for (int i = 0; i < root2->num_children; i++) {
-        if (moves_equal(&root2->children[i]->move_from_parent, &move2)) {
+        if (root2->children[i]->move_from_parent == move_pack(&move2)) {
             visits2 = root2->children[i]->visits;
             break;
         }
@@ -601,3 +1960,644 @@ TEST(search_parallel_mcts_visits_are_consistent) {
     arena_free(&arena);
 }
 
+
+// =============================================================================
+// TOURNAMENT TESTS
+// =============================================================================
+
+static int tourney_starts[3][3], tourney_ends[3][3], tourney_games;
+
+static void tourney_on_match_start(int i, int j, const char *n1, const char *n2) {
+    (void)n1; (void)n2;
+    tourney_starts[i][j]++;
+}
+
+static void tourney_on_game_complete(const TournamentGameResult *r) {
+    (void)r;
+    tourney_games++;
+}
+
+static void tourney_on_match_end(int i, int j, int s1, int s2, int d) {
+    tourney_ends[i][j] += (s1 + s2 + d == 3);
+}
+
+TEST(search_tournament_schedules_every_game_once) {
+    zobrist_init();
+    movegen_init();
+    memset(tourney_starts, 0, sizeof(tourney_starts));
+    memset(tourney_ends, 0, sizeof(tourney_ends));
+    tourney_games = 0;
+    
+    TournamentPlayer players[3];
+    memset(players, 0, sizeof(players));
+    for (int p = 0; p < 3; p++) {
+        snprintf(players[p].name, sizeof(players[p].name), "P%d", p);
+        players[p].config = mcts_get_preset(MCTS_PRESET_GRANDMASTER);
+        players[p].config.max_nodes = 20 + 10 * p;
+    }
+    TournamentSystemConfig cfg = {
+        .num_players = 3, .players = players, .games_per_pair = 3, .time_limit = 0,
+        .parallel_games = 1,
+        .on_match_start = tourney_on_match_start,
+        .on_game_complete = tourney_on_game_complete,
+        .on_match_end = tourney_on_match_end
+    };
+    tournament_run(&cfg);
+    
+    // Each pair announced once and closed once with all of its games
+    ASSERT_EQ(9, tourney_games);
+    for (int i = 0; i < 3; i++) {
+        for (int j = i + 1; j < 3; j++) {
+            ASSERT_EQ(1, tourney_starts[i][j]);
+            ASSERT_EQ(1, tourney_ends[i][j]);
+        }
+    }
+    // Per-thread stats merged into every player
+    for (int p = 0; p < 3; p++) {
+        ASSERT_EQ(6, players[p].wins + players[p].losses + players[p].draws);
+        ASSERT_GT(players[p].total_moves, 0);
+        ASSERT_GT(players[p].total_iters, 0);
+    }
+    search_pool_release();
+}
+
+TEST(search_match_sprt_decides_clear_results) {
+    MatchStopRule rule = { .sprt = 1, .elo0 = 0.0, .elo1 = 50.0, .min_games = 10 };
+    double llr;
+    
+    // Even score: H0 once there is enough evidence, not before
+    ASSERT_EQ(MATCH_CONTINUE, match_stop_check(&rule, 3, 3, 3, &llr));
+    ASSERT_EQ(MATCH_CONTINUE, match_stop_check(&rule, 10, 10, 10, &llr));
+    ASSERT_LT(llr, 0.0);
+    ASSERT_EQ(MATCH_ACCEPT_H0, match_stop_check(&rule, 100, 100, 100, &llr));
+    ASSERT_LT(llr, log(SPRT_BETA / (1.0 - SPRT_ALPHA)));
+    
+    // A crushing score: H1 after a handful of games, even with no losses or draws
+    ASSERT_EQ(MATCH_ACCEPT_H1, match_stop_check(&rule, 30, 5, 5, &llr));
+    ASSERT_EQ(MATCH_ACCEPT_H1, match_stop_check(&rule, 12, 0, 0, &llr));
+    ASSERT_EQ(MATCH_CONTINUE, match_stop_check(&rule, 9, 0, 0, &llr));  // min_games
+    
+    // Symmetric: the LLR of a result is minus that of the mirrored test
+    ASSERT_FLOAT_EQ(match_sprt_llr(20, 12, 8, 0.0, 50.0), -match_sprt_llr(20, 12, 8, 50.0, 0.0), 1e-9);
+    
+    // No rule: never stops
+    MatchStopRule none = {0};
+    ASSERT_EQ(MATCH_CONTINUE, match_stop_check(&none, 500, 0, 0, NULL));
+}
+
+TEST(search_match_elo_interval_narrows_with_games) {
+    double elo, m_small, m_large;
+    match_elo_interval(6, 4, 10, &elo, &m_small);
+    ASSERT_GT(elo, 0.0);
+    match_elo_interval(60, 40, 100, &elo, &m_large);
+    ASSERT_GT(elo, 0.0);
+    ASSERT_LT(m_large, m_small);
+    ASSERT_FLOAT_EQ(m_small / sqrt(10.0), m_large, 0.2 * m_large);
+    
+    match_elo_interval(50, 50, 0, &elo, &m_large);
+    ASSERT_FLOAT_EQ(0.0, elo, 1e-9);
+    
+    MatchStopRule rule = { .elo_margin = 60.0, .min_games = 10 };
+    ASSERT_EQ(MATCH_CONTINUE, match_stop_check(&rule, 6, 4, 10, NULL));
+    ASSERT_EQ(MATCH_PRECISE, match_stop_check(&rule, 60, 40, 100, NULL));
+}
+
+TEST(search_clop_tracks_pending_suggestions) {
+    static const CLOPParamDef defs[2] = {
+        {"a", 0.0, 1.0, 0.5},
+        {"b", 0.0, 2.0, 1.0},
+    };
+    CLOPState clop;
+    ASSERT_EQ(0, clop_init(&clop, defs, 2, 4));
+    
+    // Suggestions are pending until their result comes back, in any order
+    double x[4][2];
+    for (int i = 0; i < 3; i++) ASSERT_EQ(0, clop_suggest(&clop, x[i]));
+    ASSERT_EQ(3, clop_get_num_pending(&clop));
+    ASSERT_EQ(0, clop_update(&clop, x[2], 0.7));
+    ASSERT_EQ(0, clop_update(&clop, x[0], 0.4));
+    ASSERT_EQ(1, clop_get_num_pending(&clop));
+    ASSERT_EQ(2, clop_get_num_samples(&clop));
+    
+    // A cancelled suggestion frees its slot; in-flight ones keep theirs
+    ASSERT_EQ(0, clop_suggest(&clop, x[3]));
+    ASSERT_NE(0, clop_suggest(&clop, x[2]));
+    ASSERT_EQ(0, clop_cancel(&clop, x[3]));
+    ASSERT_NE(0, clop_cancel(&clop, x[3]));
+    ASSERT_EQ(0, clop_update(&clop, x[1], 0.5));
+    ASSERT_EQ(0, clop_get_num_pending(&clop));
+    
+    double best[2];
+    clop_get_best(&clop, best);
+    ASSERT_FLOAT_EQ(x[2][0], best[0], 1e-12);
+    ASSERT_FLOAT_EQ(x[2][1], best[1], 1e-12);
+    clop_free(&clop);
+}
+
+TEST(search_clop_incremental_fit_recovers_quadratic) {
+    static const CLOPParamDef defs[2] = {
+        {"a", 0.0, 1.0, 0.5},
+        {"b", 0.0, 2.0, 1.0},
+    };
+    CLOPState clop;
+    ASSERT_EQ(0, clop_init(&clop, defs, 2, 32));
+    
+    // Exact outcomes of f(u, v) in normalized coordinates (v = b / 2)
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 5; j++) {
+            double u = i / 4.0, v = j / 4.0;
+            double p[2] = {u, 2.0 * v};
+            double f = 0.4 + 0.3 * u - 0.2 * v - 0.5 * u * u + 0.25 * u * v + 0.1 * v * v;
+            ASSERT_EQ(0, clop_update(&clop, p, f));
+        }
+    }
+    
+    double next[2];
+    ASSERT_EQ(0, clop_suggest(&clop, next));
+    ASSERT_FLOAT_EQ(0.4, clop.constant, 1e-9);
+    ASSERT_FLOAT_EQ(0.3, clop.linear[0], 1e-9);
+    ASSERT_FLOAT_EQ(-0.2, clop.linear[1], 1e-9);
+    ASSERT_FLOAT_EQ(-0.5, clop.quadratic[0], 1e-9);
+    ASSERT_FLOAT_EQ(0.25, clop.quadratic[1], 1e-9);
+    ASSERT_FLOAT_EQ(0.1, clop.quadratic[3], 1e-9);
+    clop_free(&clop);
+}
+
+// Spin until node has at least n visits (or a CPU-second has passed)
+static void wait_for_visits(const Node *node, int n) {
+    clock_t start = clock();
+    while (atomic_load(&node->visits) < n && clock() - start < CLOCKS_PER_SEC) {
+    }
+}
+
+TEST(search_async_search_runs_until_stopped) {
+    GameState state;
+    init_game(&state);
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    
+    // No clock, no budget: only the stop ends it (threaded controller)
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 0;
+    config.num_threads = 2;
+    Node *root = mcts_create_root(state, &arena, config);
+    MCTSAsyncSearch search;
+    ASSERT_EQ(0, mcts_async_start(&search, root, &arena, 0.0, config, NULL, NULL));
+    wait_for_visits(root, 300);
+    ASSERT_GE(root->visits, 300);
+    
+    // Live best line: legal moves, alternating sides
+    Move pv[8];
+    double value = -1.0;
+    int len = mcts_async_peek(&search, pv, 8, &value);
+    ASSERT_GE(len, 1);
+    ASSERT_TRUE(value >= 0.0 && value <= 1.0);
+    
+    mcts_async_stop(&search);
+    Move best = mcts_async_wait(&search, NULL);
+    ASSERT_TRUE(mcts_async_poll(&search));
+    ASSERT_GT(best.length + best.path[0] + best.path[1], 0);
+    
+    // Settled tree: the first PV move is the move the search returned
+    len = mcts_get_pv(root, pv, 8, NULL);
+    ASSERT_GE(len, 1);
+    ASSERT_EQ(best.path[0], pv[0].path[0]);
+    ASSERT_EQ(best.path[1], pv[0].path[1]);
+    
+    arena_free(&arena);
+}
+
+TEST(search_ponder_hit_hands_over_pondered_tree) {
+    GameState state;
+    init_game(&state);
+    Arena arena, spare;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    arena_init(&spare, ARENA_SIZE_BENCHMARK);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.use_tree_reuse = 1;
+    config.max_nodes = 2000;
+    Node *root = mcts_create_root(state, &arena, config);
+    Node *played = NULL;
+    Move best = mcts_search(root, &arena, 5.0, config, NULL, NULL, &played);
+    ASSERT_NOT_NULL(played);
+    
+    MCTSAsyncSearch ponder;
+    Node *expected = mcts_ponder_start(&ponder, played, &arena, config, NULL);
+    ASSERT_NOT_NULL(expected);
+    ASSERT_TRUE(expected->parent == played);
+    int before = atomic_load(&expected->visits);
+    wait_for_visits(expected, before + 500);
+    
+    // The opponent plays the expected reply
+    GameState next = state;
+    apply_move(&next, &best);
+    Move reply;
+    ASSERT_TRUE(movegen_unpack_move(&played->state, expected->move_from_parent, &reply));
+    apply_move(&next, &reply);
+    
+    int hit = 0;
+    Node *new_root = mcts_ponder_finish(&ponder, root, &next, &arena, &spare, NULL, &hit);
+    ASSERT_EQ(1, hit);
+    ASSERT_NOT_NULL(new_root);
+    ASSERT_TRUE(states_equal(&new_root->state, &next));
+    ASSERT_GE(new_root->visits, before + 500);
+    
+    arena_free(&spare);
+    arena_free(&arena);
+}
+
+TEST(search_game_clock_budgets_stay_within_clock) {
+    GameClock clock;
+    game_clock_init(&clock, 60.0, 0.5);
+    double soft, hard;
+    game_clock_budget(&clock, &soft, &hard);
+    ASSERT_GT(soft, 1.0);
+    ASSERT_LE(soft, hard);
+    ASSERT_LE(hard, TIME_HARD_SHARE * 60.0 + 0.5);
+    
+    // Spent time is charged, then the increment added
+    ASSERT_EQ(0, game_clock_spend(&clock, soft));
+    ASSERT_FLOAT_EQ(60.0 - soft + 0.5, clock.remaining, 1e-9);
+    
+    // Nearly flagged: still a (tiny) limit, never into the margin
+    game_clock_init(&clock, 0.02, 0.0);
+    game_clock_budget(&clock, &soft, &hard);
+    ASSERT_GT(hard, 0.0);
+    ASSERT_LE(hard, 0.01);
+    ASSERT_NE(0, game_clock_spend(&clock, 0.5));
+}
+
+TEST(search_game_clock_budget_follows_own_moves) {
+    // The clock counts this side's moves: each one shortens the horizon by one
+    GameClock clock;
+    game_clock_init(&clock, 60.0, 0.0);
+    clock.moves = 10;
+    double soft, hard;
+    game_clock_budget(&clock, &soft, &hard);
+    ASSERT_FLOAT_EQ((60.0 - TIME_SAFETY_MARGIN) / (TIME_MOVES_HORIZON - 10), soft, 1e-9);
+    
+    // Past the horizon the clock is spread over TIME_MOVES_MIN moves
+    clock.moves = TIME_MOVES_HORIZON;
+    game_clock_budget(&clock, &soft, &hard);
+    ASSERT_FLOAT_EQ((60.0 - TIME_SAFETY_MARGIN) / TIME_MOVES_MIN, soft, 1e-9);
+    
+    // game_clock_spend counts one move per call
+    game_clock_init(&clock, 60.0, 0.0);
+    ASSERT_EQ(0, game_clock_spend(&clock, 1.0));
+    ASSERT_EQ(1, clock.moves);
+}
+
+TEST(search_managed_time_returns_forced_move_at_once) {
+    GameState state;
+    init_game(&state);
+    state.piece[WHITE][PAWN] = 0;
+    state.piece[WHITE][LADY] = 0;
+    state.piece[BLACK][PAWN] = 0;
+    state.piece[BLACK][LADY] = 0;
+    SET_BIT(state.piece[WHITE][PAWN], 11);
+    SET_BIT(state.piece[BLACK][PAWN], 20);
+    SET_BIT(state.piece[BLACK][PAWN], 62);
+    state.current_player = WHITE;
+    state.hash = zobrist_compute_hash(&state);
+    MoveList moves;
+    movegen_generate(&state, &moves);
+    ASSERT_EQ(1, moves.count);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.soft_time = 1.0;
+    Node *root = mcts_create_root(state, &arena, config);
+    MCTSStats stats = {0};
+    Move best = mcts_search(root, &arena, 5.0, config, &stats, NULL, NULL);
+    ASSERT_EQ(moves.moves[0].path[0], best.path[0]);
+    ASSERT_LT(stats.total_time, 0.5);
+    
+    arena_free(&arena);
+}
+
+TEST(search_tablebase_solves_nodes_and_rollouts) {
+    Tablebase tb;
+    ASSERT_GT(tablebase_fixture(&tb), 0);
+    
+    // White lady takes the last black pawn
+    GameState state;
+    memset(&state, 0, sizeof(state));
+    SET_BIT(state.piece[WHITE][LADY], 19);
+    SET_BIT(state.piece[BLACK][PAWN], 28);
+    state.current_player = WHITE;
+    state.hash = zobrist_compute_hash(&state);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.use_solver = 1;
+    config.max_nodes = 200;
+    config.tablebase = &tb;
+    Node *root = mcts_create_root(state, &arena, config);
+    ASSERT_EQ(SOLVED_WIN, root->status);
+    
+    // Known result, no playout: black (who just moved) has lost
+    ASSERT_FLOAT_EQ(LOSS_SCORE, simulate_rollout(root, config), 1e-9);
+    
+    Node *played = NULL;
+    Move best = mcts_search(root, &arena, 0.0, config, NULL, NULL, &played);
+    ASSERT_EQ(1, best.length);
+    ASSERT_EQ(28, best.captured_squares[0]);
+    
+    arena_free(&arena);
+    tablebase_close(&tb);
+    tablebase_fixture_clear();
+}
+
+TEST(search_opening_book_from_search_probes_legal_moves) {
+    const char *path = "/tmp/test_opening.book";
+    zobrist_init();
+    movegen_init();
+    GameState start;
+    init_game(&start);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 200;
+    BookBuilder b;
+    book_builder_init(&b);
+    long searched = opening_book_search(&b, &start, 2, 0.1, &config, 1, NULL);
+    ASSERT_GT(searched, 1);
+    
+    // A colliding entry under the start key with a move that is not legal there
+    ASSERT_EQ(0, book_builder_add(&b, start.hash, PM_NONE, 1000000, 1.0f));
+    ASSERT_GT(book_builder_write(&b, path, 1), 0);
+    book_builder_free(&b);
+    
+    OpeningBook book;
+    ASSERT_EQ(0, opening_book_open(&book, path));
+    for (size_t i = 1; i < book.count; i++) ASSERT_LE(book.entries[i - 1].key, book.entries[i].key);
+    
+    // Start position: legal moves only, most visited first
+    BookEntry found[MAX_MOVES];
+    int n = opening_book_probe(&book, &start, found, MAX_MOVES);
+    ASSERT_GT(n, 0);
+    for (int i = 0; i < n; i++) {
+        Move m;
+        ASSERT_TRUE(movegen_unpack_move(&start, found[i].move, &m));
+        ASSERT_GE(found[i].score, 0.0f);
+        ASSERT_LE(found[i].score, 1.0f);
+        if (i > 0) ASSERT_GE(found[i - 1].visits, found[i].visits);
+    }
+    Move top, drawn;
+    ASSERT_TRUE(opening_book_pick(&book, &start, NULL, &top));
+    ASSERT_EQ(found[0].move, move_pack(&top));
+    RNG rng;
+    rng_seed(&rng, 7);
+    for (int k = 0; k < 20; k++) {
+        ASSERT_TRUE(opening_book_pick(&book, &start, &rng, &drawn));
+        ASSERT_GE(drawn.path[0], 0);
+    }
+    
+    // A reply to the top move was searched; a position never reached is out of book
+    GameState after = start;
+    apply_move(&after, &top);
+    ASSERT_GT(opening_book_probe(&book, &after, found, MAX_MOVES), 0);
+    GameState empty;
+    memset(&empty, 0, sizeof(empty));
+    SET_BIT(empty.piece[WHITE][LADY], 19);
+    SET_BIT(empty.piece[BLACK][PAWN], 28);
+    empty.hash = zobrist_compute_hash(&empty);
+    ASSERT_FALSE(opening_book_pick(&book, &empty, NULL, &drawn));
+    
+    opening_book_close(&book);
+    remove(path);
+}
+
+TEST(search_cache_seeds_roots_across_runs) {
+    const char *path = "/tmp/test_search.cache";
+    remove(path);
+    zobrist_init();
+    movegen_init();
+    GameState start;
+    init_game(&start);
+    
+    SearchCache cache;
+    ASSERT_EQ(0, search_cache_open(&cache, path, 1000));
+    ASSERT_EQ(512, cache.capacity);
+    
+    Arena arena;
+    arena_init(&arena, ARENA_SIZE_BENCHMARK);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.max_nodes = 400;
+    config.search_cache = &cache;
+    
+    // First search: a miss, stored when done
+    MCTSStats stats = {0};
+    Node *root = mcts_create_root(start, &arena, config);
+    Move first = mcts_search(root, &arena, 0.0, config, &stats, NULL, NULL);
+    ASSERT_EQ(0, stats.search_cache_hits);
+    ASSERT_EQ(1, stats.search_cache_misses);
+    int searched = 0;
+    for (int i = 0; i < root->num_children; i++) searched += root->children[i]->visits;
+    
+    const uint64_t fingerprint = search_cache_fingerprint(&config);
+    SearchCacheHit hit;
+    ASSERT_TRUE(search_cache_probe(&cache, &start, fingerprint, &hit));
+    ASSERT_EQ(searched, hit.visits);
+    ASSERT_EQ(root->num_legal, hit.num_legal);
+    ASSERT_GT(hit.count, 0);
+    for (int i = 1; i < hit.count; i++) ASSERT_GE(hit.move_visits[i - 1], hit.move_visits[i]);
+    
+    // Kept in the file: a fresh root starts from it, the budget is covered
+    search_cache_close(&cache);
+    ASSERT_EQ(0, search_cache_open(&cache, path, 0));
+    ASSERT_EQ(512, cache.capacity);
+    arena_reset(&arena);
+    memset(&stats, 0, sizeof(stats));
+    root = mcts_create_root(start, &arena, config);
+    Move again = mcts_search(root, &arena, 0.0, config, &stats, NULL, NULL);
+    ASSERT_EQ(1, stats.search_cache_hits);
+    ASSERT_EQ(move_pack(&first), move_pack(&again));
+    ASSERT_EQ(root->num_legal, root->num_children);
+    ASSERT_GE(root->visits, searched - hit.count);
+    ASSERT_LE(root->visits, 400);
+    
+    // Another config never reads it; neither does a torn entry
+    MCTSConfig other = config;
+    other.ucb1_c *= 2.0;
+    ASSERT_NE(fingerprint, search_cache_fingerprint(&other));
+    ASSERT_FALSE(search_cache_probe(&cache, &start, search_cache_fingerprint(&other), &hit));
+    for (size_t i = 0; i < cache.capacity; i++) {
+        if (atomic_load(&cache.entries[i].words[0]) == 0) continue;
+        atomic_fetch_xor(&cache.entries[i].words[5], 1);
+    }
+    ASSERT_FALSE(search_cache_probe(&cache, &start, fingerprint, &hit));
+    
+    arena_free(&arena);
+    search_cache_close(&cache);
+    remove(path);
+}
+
+// Output of a SearchServer so far, from the start
+static void server_output(FILE *out, char *buf, size_t size) {
+    fflush(out);
+    rewind(out);
+    size_t n = fread(buf, 1, size - 1, out);
+    buf[n] = '\0';
+    fseek(out, 0, SEEK_END);
+}
+
+TEST(search_server_answers_position_and_go) {
+    zobrist_init();
+    movegen_init();
+    FILE *out = tmpfile();
+    ASSERT_NOT_NULL(out);
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    config.use_tree_reuse = 1;
+    SearchServer srv;
+    ASSERT_EQ(0, search_server_init(&srv, config, ARENA_SIZE_BENCHMARK, out));
+    static char text[1 << 16];
+    
+    ASSERT_EQ(0, search_server_command(&srv, "isready"));
+    ASSERT_EQ(0, search_server_command(&srv, "position startpos moves B3-A4 zz"));
+    server_output(out, text, sizeof(text));
+    ASSERT_TRUE(strstr(text, "readyok\n") != NULL);
+    ASSERT_TRUE(strstr(text, "error illegal move zz\n") != NULL);
+    
+    // A bounded search reports when done; the next command waits for it
+    ASSERT_EQ(0, search_server_command(&srv, "position startpos moves B3-A4"));
+    ASSERT_EQ(0, search_server_command(&srv, "go nodes 300"));
+    ASSERT_EQ(0, search_server_command(&srv, "legal"));
+    ASSERT_FALSE(search_server_poll(&srv));
+    server_output(out, text, sizeof(text));
+    char *best = strstr(text, "bestmove ");
+    ASSERT_NOT_NULL(best);
+    ASSERT_TRUE(strstr(text, "info time ") < best);
+    ASSERT_TRUE(strstr(best, "legal A6-B5 ") != NULL);
+    
+    // The reply to the best move is in the kept tree
+    Move m;
+    char move_text[MOVE_TEXT_MAX + 1];
+    ASSERT_EQ(1, sscanf(best, "bestmove %15s", move_text));
+    ASSERT_TRUE(parse_move(&srv.state, move_text, &m));
+    char line[128];
+    snprintf(line, sizeof(line), "position startpos moves B3-A4 %s", move_text);
+    ASSERT_EQ(0, search_server_command(&srv, line));
+    ASSERT_NOT_NULL(srv.root);
+    ASSERT_GT(atomic_load(&srv.root->visits), 0);
+    
+    // An unbounded search runs until stopped; a board with no move for white
+    ASSERT_EQ(0, search_server_command(&srv, "go infinite"));
+    ASSERT_TRUE(search_server_poll(&srv));
+    ASSERT_EQ(0, search_server_command(&srv, "stop"));
+    ASSERT_FALSE(search_server_poll(&srv));
+    ASSERT_EQ(0, search_server_command(&srv, "position board ............................bbbb w"));
+    ASSERT_EQ(0, search_server_command(&srv, "go nodes 10"));
+    server_output(out, text, sizeof(text));
+    ASSERT_TRUE(strstr(text, "bestmove none\n") != NULL);
+    ASSERT_EQ(1, search_server_command(&srv, "quit"));
+    
+    search_server_free(&srv);
+    fclose(out);
+}
+
+TEST(search_history_chain_links_last_position_first) {
+    zobrist_init();
+    movegen_init();
+    GameState history[2];
+    init_game(&history[1]);
+    MoveList moves;
+    movegen_generate(&history[1], &moves);
+    history[0] = history[1];
+    apply_move(&history[0], &moves.moves[0]);
+    
+    Arena arena;
+    arena_init(&arena, 4096);
+    Node *head;
+    ASSERT_EQ(0, mcts_history_chain(history, 0, &arena, &head));
+    ASSERT_TRUE(head == NULL);
+    ASSERT_EQ(0, mcts_history_chain(history, 2, &arena, &head));
+    ASSERT_EQ(history[0].hash, head->state.hash);
+    ASSERT_EQ(WHITE, head->player_who_just_moved);
+    ASSERT_EQ(history[1].hash, head->parent->state.hash);
+    ASSERT_TRUE(head->parent->parent == NULL);
+    
+    // A full arena fails instead of returning a shorter chain
+    Arena tiny;
+    arena_init(&tiny, sizeof(Node) + 16);
+    ASSERT_EQ(-1, mcts_history_chain(history, 2, &tiny, &head));
+    arena_free(&tiny);
+    arena_free(&arena);
+}
+
+static int many_reported[8], many_reports;
+
+static void many_on_result(const SearchManyResult *r, void *user) {
+    (void)user;
+    many_reported[many_reports++] = r->index;
+}
+
+TEST(search_many_reports_results_in_input_order) {
+    zobrist_init();
+    movegen_init();
+    static const char *lines[] = {
+        "startpos",
+        "startpos moves B3-A4",
+        "board ............................bbbb w",
+        "startpos moves B3-A4 A6-B5",
+        "startpos moves D3-C4",
+        "board .........W..........b........... b",
+    };
+    const int n = (int)(sizeof(lines) / sizeof(lines[0]));
+    SearchPosition positions[6];
+    for (int i = 0; i < n; i++) {
+        char buf[128], *tok[16];
+        int t = 0;
+        snprintf(buf, sizeof(buf), "%s", lines[i]);
+        for (char *p = strtok(buf, " "); p; p = strtok(NULL, " ")) tok[t++] = p;
+        const char *bad_move;
+        ASSERT_EQ(0, search_position_parse(tok, t, &positions[i], &bad_move));
+    }
+    ASSERT_EQ(2, positions[3].plies);
+    
+    MCTSConfig config = mcts_get_preset(MCTS_PRESET_VANILLA);
+    SearchManyConfig many = { .threads = 3, .nodes = 200, .arena_size = ARENA_SIZE_BENCHMARK,
+                              .on_result = many_on_result };
+    SearchManyResult results[6];
+    SearchManyStats stats;
+    many_reports = 0;
+    ASSERT_EQ(0, mcts_search_many(positions, n, &config, &many, results, &stats));
+    
+    ASSERT_EQ(n, many_reports);
+    long nodes = 0;
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ(i, many_reported[i]);
+        ASSERT_EQ(i, results[i].index);
+        nodes += results[i].visits;
+        if (i == 2) {
+            ASSERT_EQ(0, results[i].visits);    // White has no move
+            ASSERT_EQ(0, results[i].best.length);
+            continue;
+        }
+        ASSERT_GT(results[i].visits, 0);
+        ASSERT_LE(results[i].visits, 200);
+        ASSERT_TRUE(results[i].value >= -1.0f && results[i].value <= 1.0f);
+        int sum = 0;
+        for (int k = 0; k < results[i].num_moves; k++) {
+            Move m;
+            ASSERT_TRUE(movegen_unpack_move(&positions[i].state, results[i].moves[k], &m));
+            if (k > 0) ASSERT_LE(results[i].move_visits[k], results[i].move_visits[k - 1]);
+            sum += results[i].move_visits[k];
+        }
+        ASSERT_LE(sum, results[i].visits);
+    }
+    ASSERT_EQ(n - 1, stats.searched);
+    ASSERT_EQ(nodes, stats.nodes);
+    
+    // A move that is not legal is named back
+    char buf[64], *tok[8];
+    int t = 0;
+    snprintf(buf, sizeof(buf), "startpos moves B3-A4 B3-A4");
+    for (char *p = strtok(buf, " "); p; p = strtok(NULL, " ")) tok[t++] = p;
+    const char *bad_move;
+    ASSERT_EQ(-1, search_position_parse(tok, t, &positions[0], &bad_move));
+    ASSERT_NOT_NULL(bad_move);
+    ASSERT_STR_EQ("B3-A4", bad_move);
+}
@@ -7,7 +7,13 @@
 // Note: Includes are in test_main.c
 #include "dama/engine/zobrist.h"
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 // =============================================================================
 // DATASET TESTS
@@ -41,7 +47,7 @@ TEST(training_dataset_save_and_load) {
     
     // Verify
     for (int i = 0; i < 5; i++) {
-        ASSERT_FLOAT_EQ(samples[i].target_value, loaded[i].target_value, 1e-6f);
+        ASSERT_FLOAT_EQ(samples[i].target_value, loaded[i].target_value, 1e-4f);  // v2 quantizes to 1/32767
     }
     
     // Cleanup
@@ -90,7 +96,7 @@ TEST(training_dataset_load_alloc) {
     memset(samples, 0, sizeof(samples));
     for (int i = 0; i < 10; i++) {
         init_game(&samples[i].state);
-        samples[i].target_value = (float)i;
+        samples[i].target_value = (float)i / 10.0f;  // v2 stores values in [-1, 1]
     }
     
     dataset_save(path, samples, 10);
@@ -101,7 +107,7 @@ TEST(training_dataset_load_alloc) {
     
     ASSERT_NOT_NULL(loaded);
     ASSERT_EQ(10, count);
-    ASSERT_FLOAT_EQ(5.0f, loaded[5].target_value, 1e-6f);
+    ASSERT_FLOAT_EQ(0.5f, loaded[5].target_value, 1e-4f);
     
     free(loaded);
     remove(path);
@@ -157,6 +163,581 @@ TEST(training_dataset_split) {
     free(samples);
 }
 
+TEST(training_dataset_stream_covers_every_sample) {
+    const char *path = "/tmp/test_dataset_stream.bin";
+    enum { N = 2 * DATASET_BLOCK_SAMPLES + 300, FIRST = 100 };
+    TrainingSample *samples = calloc(N, sizeof(TrainingSample));
+    ASSERT_NOT_NULL(samples);
+    for (int i = 0; i < N; i++) samples[i].state.piece[0][0] = (uint64_t)i;  // id survives the v2 codec
+    ASSERT_EQ(0, dataset_save(path, samples, N));
+    
+    DatasetView view;
+    ASSERT_EQ(0, dataset_open(path, &view));
+    ASSERT_EQ(N, (int)view.count);
+    TrainingSample one;
+    dataset_view_read(&view, 1234, 1, &one);
+    ASSERT_EQ(1234, (int)one.state.piece[0][0]);
+    
+    // Shuffled: each sample of the range exactly once per epoch, not in file order
+    DatasetStream stream;
+    ASSERT_EQ(0, dataset_stream_init(&stream, &view, FIRST, N - FIRST, 1, 42));
+    char *seen = calloc(N, 1);
+    TrainingSample batch[64];
+    for (int epoch = 0; epoch < 2; epoch++) {
+        memset(seen, 0, N);
+        dataset_stream_rewind(&stream);
+        int total = 0, in_order = 1;
+        size_t n;
+        while ((n = dataset_stream_next(&stream, batch, 64)) > 0) {
+            for (size_t k = 0; k < n; k++) {
+                int id = (int)batch[k].state.piece[0][0];
+                ASSERT_GE(id, FIRST);
+                ASSERT_EQ(0, seen[id]);
+                seen[id] = 1;
+                if (id != FIRST + total + (int)k) in_order = 0;
+            }
+            total += (int)n;
+        }
+        ASSERT_EQ(N - FIRST, total);
+        ASSERT_FALSE(in_order);
+    }
+    dataset_stream_free(&stream);
+    
+    // Unshuffled (validation): file order
+    ASSERT_EQ(0, dataset_stream_init(&stream, &view, FIRST, 200, 0, 1));
+    ASSERT_EQ(64, (int)dataset_stream_next(&stream, batch, 64));
+    ASSERT_EQ(FIRST, (int)batch[0].state.piece[0][0]);
+    ASSERT_EQ(FIRST + 63, (int)batch[63].state.piece[0][0]);
+    dataset_stream_free(&stream);
+    dataset_close(&view);
+    
+    // A truncated raw (v1) file (header claims more) maps the whole samples it has
+    FILE *f = fopen(path, "wb");
+    ASSERT_NOT_NULL(f);
+    DatasetHeader header = { DATASET_MAGIC, DATASET_VERSION_RAW, 20 };
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(samples, sizeof(TrainingSample), 10, f);
+    fclose(f);
+    ASSERT_EQ(0, dataset_open(path, &view));
+    ASSERT_EQ(10, (int)view.count);
+    dataset_close(&view);
+    
+    free(seen);
+    free(samples);
+    remove(path);
+}
+
+TEST(training_dataset_v2_roundtrip) {
+    const char *path = "/tmp/test_dataset_v2.bin";
+    enum { N = DATASET_BLOCK_SAMPLES + 200, EXTRA = 50 };
+    zobrist_init();
+    
+    // Game-like records: history[0]/[1] are the previous records' positions
+    TrainingSample *samples = calloc(N + EXTRA, sizeof(TrainingSample));
+    ASSERT_NOT_NULL(samples);
+    GameState state;
+    init_game(&state);
+    for (int i = 0; i < N + EXTRA; i++) {
+        MoveList moves;
+        movegen_generate(&state, &moves);
+        if (moves.count == 0 || i % 60 == 0) {
+            init_game(&state);  // new game: empty history
+            movegen_generate(&state, &moves);
+        } else {
+            samples[i].history[0] = samples[i-1].state;
+            samples[i].history[1] = samples[i-1].history[0];
+        }
+        samples[i].state = state;
+        samples[i].target_value = (i % 3 - 1) * 0.37f;
+        for (int m = 0; m < moves.count; m++) {
+            samples[i].target_policy[cnn_move_to_index(&moves.moves[m], state.current_player)] += 1.0f / moves.count;
+        }
+        apply_move(&state, &moves.moves[i % moves.count]);
+    }
+    samples[7].history[1] = samples[3].state;  // not the previous record's: stored
+    
+    ASSERT_EQ(0, dataset_save(path, samples, N));
+    DatasetView view;
+    ASSERT_EQ(0, dataset_open(path, &view));
+    ASSERT_EQ(DATASET_VERSION, (int)view.version);
+    ASSERT_EQ(N, (int)view.count);
+    ASSERT_EQ(2, (int)view.n_blocks);
+    ASSERT_LT(dataset_view_bytes_per_sample(&view), sizeof(TrainingSample) / 20.0);
+    dataset_close(&view);
+    
+    // Append fills the partial last block, then starts a new one
+    ASSERT_EQ(0, dataset_save_append(path, samples + N, EXTRA));
+    TrainingSample *loaded = calloc(N + EXTRA, sizeof(TrainingSample));
+    ASSERT_EQ(N + EXTRA, dataset_load(path, loaded, N + EXTRA));
+    for (int i = 0; i < N + EXTRA; i++) {
+        const TrainingSample *a = &samples[i], *b = &loaded[i];
+        ASSERT_EQ(0, memcmp(&a->state, &b->state, sizeof(GameState)));
+        ASSERT_EQ(0, memcmp(a->history, b->history, sizeof(a->history)));
+        ASSERT_FLOAT_EQ(a->target_value, b->target_value, 1e-4f);
+        for (int k = 0; k < CNN_POLICY_SIZE; k++) {
+            ASSERT_FLOAT_EQ(a->target_policy[k], b->target_policy[k], 1e-3f);
+        }
+    }
+    
+    // A corrupt index is rejected
+    FILE *f = fopen(path, "r+b");
+    ASSERT_NOT_NULL(f);
+    DatasetHeader header;
+    ASSERT_EQ(1, (int)fread(&header, sizeof(header), 1, f));
+    header.num_samples += 1;
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, f);
+    fclose(f);
+    ASSERT_NE(0, dataset_open(path, &view));
+    
+    free(loaded);
+    free(samples);
+    remove(path);
+}
+
+TEST(training_dataset_decode_rejects_impossible_states) {
+    zobrist_init();
+    TrainingSample sample, out;
+    memset(&sample, 0, sizeof(sample));
+    init_game(&sample.state);
+    sample.target_policy[0] = 1.0f;
+    unsigned char block[256];
+    size_t bytes = dataset_encode_block(&sample, 1, block);
+    ASSERT_EQ(0, dataset_decode_block(block, bytes, 1, &out));
+    
+    // Record: flags, side to move, half-move counter, 4 bitboards
+    unsigned char bad[256];
+    memcpy(bad, block, bytes);
+    bad[1] = 2;
+    ASSERT_EQ(-1, dataset_decode_block(bad, bytes, 1, &out));
+    
+    // A white pawn and a black lady on the same square
+    memcpy(bad, block, bytes);
+    memcpy(bad + 3 + 3 * sizeof(uint64_t), bad + 3, sizeof(uint64_t));
+    ASSERT_EQ(-1, dataset_decode_block(bad, bytes, 1, &out));
+}
+
+TEST(training_prefetch_matches_synchronous_stream) {
+    const char *path = "/tmp/test_prefetch.bin";
+    enum { N = 3 * DATASET_BLOCK_SAMPLES + 77, BATCH = 100 };
+    TrainingSample *samples = calloc(N, sizeof(TrainingSample));
+    ASSERT_NOT_NULL(samples);
+    for (int i = 0; i < N; i++) samples[i].state.piece[0][0] = (uint64_t)i;
+    ASSERT_EQ(0, dataset_save(path, samples, N));
+    DatasetView view;
+    ASSERT_EQ(0, dataset_open(path, &view));
+    
+    // Same seed: the producer thread must hand out the synchronous sequence
+    DatasetStream sync_stream, async_stream;
+    BatchPrefetcher sync_pf, async_pf;
+    ASSERT_EQ(0, dataset_stream_init(&sync_stream, &view, 0, N, 1, 7));
+    ASSERT_EQ(0, dataset_stream_init(&async_stream, &view, 0, N, 1, 7));
+    ASSERT_EQ(0, batch_prefetch_init(&sync_pf, &sync_stream, BATCH, 0));
+    ASSERT_EQ(0, batch_prefetch_init(&async_pf, &async_stream, BATCH, 3));
+    for (int epoch = 0; epoch < 3; epoch++) {
+        batch_prefetch_start(&sync_pf);
+        batch_prefetch_start(&async_pf);
+        int total = 0, n_sync, n_async;
+        const TrainingSample *a, *b;
+        while ((a = batch_prefetch_next(&sync_pf, &n_sync)) != NULL) {
+            b = batch_prefetch_next(&async_pf, &n_async);
+            ASSERT_NOT_NULL(b);
+            ASSERT_EQ(n_sync, n_async);
+            for (int k = 0; k < n_sync; k++) {
+                ASSERT_EQ((int)a[k].state.piece[0][0], (int)b[k].state.piece[0][0]);
+            }
+            total += n_sync;
+            if (epoch == 1 && total >= 5 * BATCH) break;  // Abandoned mid-epoch
+        }
+        if (epoch != 1) {
+            ASSERT_EQ(N, total);
+            ASSERT_TRUE(batch_prefetch_next(&async_pf, &n_async) == NULL);
+        }
+    }
+    batch_prefetch_free(&sync_pf);
+    batch_prefetch_free(&async_pf);
+    dataset_stream_free(&sync_stream);
+    dataset_stream_free(&async_stream);
+    
+    dataset_close(&view);
+    free(samples);
+    remove(path);
+}
+
+TEST(training_replay_buffer_appends_and_evicts) {
+    const char *dir = "/tmp/test_replay";
+    enum { SEGMENT = 1500, WINDOW = 4000, CHUNK = 1000, CHUNKS = 6 };
+    replay_clear(dir);
+    ASSERT_EQ(0, replay_create(dir, SEGMENT, WINDOW));
+    ASSERT_TRUE(replay_is_buffer(dir));
+    ASSERT_FALSE(replay_is_buffer("/tmp/test_replay/none"));
+    
+    TrainingSample *chunk = calloc(CHUNK, sizeof(TrainingSample));
+    ASSERT_NOT_NULL(chunk);
+    for (int c = 0; c < CHUNKS; c++) {
+        for (int i = 0; i < CHUNK; i++) chunk[i].state.piece[0][0] = (uint64_t)(c * CHUNK + i);
+        ASSERT_EQ(0, dataset_save_append(dir, chunk, CHUNK));  // Dispatches to replay_append
+    }
+    
+    // 6000 samples in 4 segments (1500 each): the first goes, 4500 stay
+    ASSERT_EQ(4500, dataset_get_count(dir));
+    char path[256];
+    snprintf(path, sizeof(path), "%s/seg_%08u.bin", dir, 0u);
+    ASSERT_EQ(-1, dataset_get_count(path));
+    
+    // One view over the live segments, oldest first
+    DatasetView view;
+    ASSERT_EQ(0, dataset_open(dir, &view));
+    ASSERT_EQ(4500, (int)view.count);
+    TrainingSample *all = calloc(view.count, sizeof(TrainingSample));
+    ASSERT_EQ(0, dataset_view_read(&view, 0, view.count, all));
+    for (int i = 0; i < (int)view.count; i++) {
+        ASSERT_EQ(1500 + i, (int)all[i].state.piece[0][0]);
+    }
+    
+    // Streams cover every segment
+    DatasetStream stream;
+    ASSERT_EQ(0, dataset_stream_init(&stream, &view, 0, view.count, 1, 3));
+    size_t n, total = 0;
+    while ((n = dataset_stream_next(&stream, all, 700)) > 0) total += n;
+    ASSERT_EQ(4500, (int)total);
+    dataset_stream_free(&stream);
+    dataset_close(&view);
+    
+    // A smaller window evicts right away; clear keeps the configuration
+    ASSERT_EQ(0, replay_create(dir, 0, 2000));
+    ASSERT_EQ(3000, dataset_get_count(dir));
+    
+    // A version 1 index (no segment counts) is read and rewritten as version 2
+    char index_file[256];
+    snprintf(index_file, sizeof(index_file), "%s/%s", dir, REPLAY_INDEX_FILE);
+    ReplayIndex index;
+    ASSERT_EQ(0, replay_read_index(dir, &index));
+    index.version = 1;
+    FILE *f = fopen(index_file, "wb");
+    ASSERT_NOT_NULL(f);
+    fwrite(&index, offsetof(ReplayIndex, sealed_samples), 1, f);
+    fclose(f);
+    ASSERT_EQ(3000, dataset_get_count(dir));
+    ASSERT_EQ(0, replay_create(dir, 0, 2000));
+    ASSERT_EQ(0, replay_read_index(dir, &index));
+    ASSERT_EQ(REPLAY_VERSION, (int)index.version);
+    ASSERT_EQ(1500, (int)index.sealed_samples);
+    
+    // Appends and counts read only the newest segment: the sealed ones are
+    // counted in the index (the oldest is unreadable here, and evicted)
+    snprintf(path, sizeof(path), "%s/seg_%08u.bin", dir, index.first_segment);
+    fclose(fopen(path, "wb"));
+    ASSERT_EQ(0, replay_append(dir, chunk, CHUNK));
+    ASSERT_EQ(2500, dataset_get_count(dir));
+    ASSERT_EQ(-1, dataset_get_count(path));
+    ASSERT_EQ(0, replay_clear(dir));
+    ASSERT_EQ(0, dataset_get_count(dir));
+    ASSERT_TRUE(replay_is_buffer(dir));
+    
+    free(all);
+    free(chunk);
+    snprintf(path, sizeof(path), "%s/%s", dir, REPLAY_INDEX_FILE);
+    remove(path);
+    rmdir(dir);
+}
+
+TEST(training_sample_writer_keeps_every_game_contiguous) {
+    const char *path = "/tmp/test_sample_writer.bin";
+    enum { GAMES = 200, MAX_LEN = 40 };
+    remove(path);
+    
+    SampleWriter writer;
+    ASSERT_EQ(0, sample_writer_open(&writer, path, 100, 10));
+    
+    // Game g has 1 + g % MAX_LEN samples, ids g * 64 + k
+    size_t expected = 0;
+    for (int g = 0; g < GAMES; g++) expected += 1 + g % MAX_LEN;
+    int push_failures = 0;
+    #pragma omp parallel for num_threads(4) schedule(dynamic) reduction(+:push_failures)
+    for (int g = 0; g < GAMES; g++) {
+        TrainingSample game[MAX_LEN];
+        memset(game, 0, sizeof(game));
+        int len = 1 + g % MAX_LEN;
+        for (int k = 0; k < len; k++) game[k].state.piece[0][0] = (uint64_t)(g * 64 + k);
+        if (sample_writer_push(&writer, game, (size_t)len) != 0) push_failures++;
+    }
+    ASSERT_EQ(0, push_failures);
+    ASSERT_EQ(0, sample_writer_close(&writer));
+    ASSERT_EQ((long)expected, dataset_get_count(path));
+    
+    // Games interleave in any order, but each one is whole and in order
+    TrainingSample *all = malloc(expected * sizeof(TrainingSample));
+    ASSERT_NOT_NULL(all);
+    ASSERT_EQ((int)expected, dataset_load(path, all, expected));
+    int seen[GAMES] = {0};
+    for (size_t i = 0; i < expected; i++) {
+        int id = (int)all[i].state.piece[0][0];
+        int g = id / 64, k = id % 64;
+        ASSERT_LT(g, GAMES);
+        ASSERT_EQ(seen[g], k);
+        if (k > 0) ASSERT_EQ(id - 1, (int)all[i - 1].state.piece[0][0]);
+        seen[g]++;
+    }
+    for (int g = 0; g < GAMES; g++) ASSERT_EQ(1 + g % MAX_LEN, seen[g]);
+    
+    free(all);
+    remove(path);
+}
+
+static void* collector_test_run(void *arg) {
+    Collector *c = arg;
+    static int res;
+    res = collector_run(c);
+    return &res;
+}
+
+TEST(training_collector_serves_model_and_receives_samples) {
+    const char *data = "/tmp/test_collector.bin", *model = "/tmp/test_collector_model.bin";
+    const char *cache = "/tmp/test_collector_cache.bin";
+    enum { SAMPLES = 2500 };
+    remove(data);
+    remove(cache);
+    FILE *f = fopen(model, "wb");
+    ASSERT_NOT_NULL(f);
+    fputs("model v1", f);
+    fclose(f);
+    
+    Collector c;
+    ASSERT_EQ(0, collector_open(&c, NULL, 0, data, model, SAMPLES));
+    ASSERT_GT(c.port, 0);
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, collector_test_run, &c));
+    
+    // The model is sent once, then only when the file changes
+    CollectorClient cl;
+    ASSERT_EQ(0, collector_client_connect(&cl, "127.0.0.1", c.port));
+    ASSERT_EQ(1, collector_client_fetch_model(&cl, cache));
+    ASSERT_EQ(0, collector_client_fetch_model(&cl, cache));
+    cl.model_id = 0;  // What a worker does when the model does not load
+    ASSERT_EQ(1, collector_client_fetch_model(&cl, cache));
+    char buf[32] = {0};
+    f = fopen(cache, "rb");
+    ASSERT_NOT_NULL(f);
+    ASSERT_EQ(8, (int)fread(buf, 1, sizeof(buf), f));
+    fclose(f);
+    ASSERT_EQ(0, strcmp(buf, "model v1"));
+    
+    f = fopen(model, "wb");
+    ASSERT_NOT_NULL(f);
+    fputs("model v2, retrained", f);
+    fclose(f);
+    ASSERT_EQ(1, collector_client_fetch_model(&cl, cache));
+    
+    // More than one frame's worth; the collector returns once it has them all
+    TrainingSample *sent = calloc(SAMPLES, sizeof(TrainingSample));
+    ASSERT_NOT_NULL(sent);
+    for (int i = 0; i < SAMPLES; i++) {
+        sent[i].state.piece[0][0] = (uint64_t)i;
+        sent[i].target_value = (i % 3) - 1.0f;
+        sent[i].target_policy[i % CNN_POLICY_SIZE] = 1.0f;
+    }
+    ASSERT_EQ(0, collector_client_send(&cl, sent, SAMPLES));
+    int *res;
+    pthread_join(thread, (void**)&res);
+    collector_client_close(&cl);
+    ASSERT_EQ(0, *res);
+    collector_close(&c);
+    
+    TrainingSample *got = malloc(SAMPLES * sizeof(TrainingSample));
+    ASSERT_NOT_NULL(got);
+    ASSERT_EQ(SAMPLES, dataset_load(data, got, SAMPLES));
+    for (int i = 0; i < SAMPLES; i++) {
+        ASSERT_EQ((uint64_t)i, got[i].state.piece[0][0]);
+        ASSERT_FLOAT_EQ(sent[i].target_value, got[i].target_value, 1e-6f);
+        ASSERT_FLOAT_EQ(1.0f, got[i].target_policy[i % CNN_POLICY_SIZE], 1e-6f);
+    }
+    
+    free(sent);
+    free(got);
+    remove(data);
+    remove(model);
+    remove(cache);
+}
+
+TEST(training_collector_listens_on_loopback_by_default) {
+    const char *data = "/tmp/test_collector_bind.bin";
+    remove(data);
+    
+    Collector c;
+    ASSERT_EQ(0, collector_open(&c, NULL, 0, data, "/tmp/test_collector_none.bin", 0));
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(0, getsockname(c.listen_fd, (struct sockaddr*)&addr, &len));
+    ASSERT_EQ(AF_INET, addr.sin_family);
+    ASSERT_EQ(INADDR_LOOPBACK, ntohl(addr.sin_addr.s_addr));
+    
+    // Names resolve through getaddrinfo; the kernel completes the handshake
+    CollectorClient cl;
+    ASSERT_EQ(0, collector_client_connect(&cl, "localhost", c.port));
+    collector_client_close(&cl);
+    collector_close(&c);
+    
+    // An address that is not ours cannot be bound
+    ASSERT_EQ(-1, collector_open(&c, "192.0.2.1", 0, data, "/tmp/test_collector_none.bin", 0));
+    remove(data);
+}
+
+TEST(training_dedupe_averages_duplicates_in_input_order) {
+    const char *a_path = "/tmp/test_dedupe_a.bin", *b_path = "/tmp/test_dedupe_b.bin";
+    const char *out_path = "/tmp/test_dedupe_out.bin";
+    zobrist_init();
+    movegen_init();
+    
+    // Positions P0..P3: the initial position after one of its first moves
+    GameState p[4];
+    MoveList moves;
+    GameState start;
+    init_game(&start);
+    movegen_generate(&start, &moves);
+    ASSERT_GE(moves.count, 4);
+    for (int k = 0; k < 4; k++) {
+        p[k] = start;
+        apply_move(&p[k], &moves.moves[k]);
+    }
+    
+    // A: P0 P1 P2 P1, B: P0 P3 (value = 0.1 * order, policy on index order)
+    const int order[6] = { 0, 1, 2, 1, 0, 3 };
+    TrainingSample s[6];
+    memset(s, 0, sizeof(s));
+    for (int i = 0; i < 6; i++) {
+        s[i].state = p[order[i]];
+        s[i].target_value = 0.1f * i;
+        s[i].target_policy[i] = 1.0f;
+    }
+    ASSERT_EQ(0, dataset_save(a_path, s, 4));
+    ASSERT_EQ(0, dataset_save(b_path, s + 4, 2));
+    
+    // Several partitions (hash-disjoint), merged back in input order
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    const char *inputs[2] = { a_path, b_path };
+    DedupeStats stats;
+    int res = dataset_dedupe(inputs, 2, out_path, &stats);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    ASSERT_EQ(0, res);
+    ASSERT_EQ(6, (int)stats.input);
+    ASSERT_EQ(4, (int)stats.unique);
+    ASSERT_GE(stats.partitions, threads < 4 ? 4 : threads);
+    
+    TrainingSample out[4];
+    ASSERT_EQ(4, dataset_load(out_path, out, 4));
+    for (int k = 0; k < 4; k++) ASSERT_TRUE(out[k].state.hash == p[k].hash);
+    ASSERT_FLOAT_EQ(0.2f, out[0].target_value, 1e-4f);   // (0.0 + 0.4) / 2
+    ASSERT_FLOAT_EQ(0.5f, out[0].target_policy[0], 1e-3f);
+    ASSERT_FLOAT_EQ(0.5f, out[0].target_policy[4], 1e-3f);
+    ASSERT_FLOAT_EQ(0.2f, out[1].target_value, 1e-4f);   // (0.1 + 0.3) / 2
+    ASSERT_FLOAT_EQ(0.5f, out[1].target_policy[3], 1e-3f);
+    ASSERT_FLOAT_EQ(0.2f, out[2].target_value, 1e-4f);
+    ASSERT_FLOAT_EQ(0.5f, out[3].target_value, 1e-4f);
+    ASSERT_FLOAT_EQ(1.0f, out[3].target_policy[5], 1e-3f);
+    
+    remove(a_path);
+    remove(b_path);
+    remove(out_path);
+}
+
+TEST(training_dedupe_keeps_value_only_samples_out_of_policy_average) {
+    const char *in_path = "/tmp/test_dedupe_vo.bin", *out_path = "/tmp/test_dedupe_vo_out.bin";
+    zobrist_init();
+    movegen_init();
+    
+    // One position three times: two with a policy, one value-only (fast search)
+    TrainingSample s[3];
+    memset(s, 0, sizeof(s));
+    for (int i = 0; i < 3; i++) {
+        init_game(&s[i].state);
+        s[i].target_value = 0.3f * i;
+    }
+    s[0].target_policy[0] = 1.0f;
+    s[2].target_policy[1] = 1.0f;
+    ASSERT_FALSE(training_sample_has_policy(&s[1]));
+    ASSERT_EQ(0, dataset_save(in_path, s, 3));
+    
+    const char *inputs[1] = { in_path };
+    DedupeStats stats;
+    ASSERT_EQ(0, dataset_dedupe(inputs, 1, out_path, &stats));
+    TrainingSample out;
+    ASSERT_EQ(1, dataset_load(out_path, &out, 1));
+    ASSERT_FLOAT_EQ(0.3f, out.target_value, 1e-4f);        // Every sample: (0 + 0.3 + 0.6) / 3
+    ASSERT_FLOAT_EQ(0.5f, out.target_policy[0], 1e-3f);    // Policy samples only
+    ASSERT_FLOAT_EQ(0.5f, out.target_policy[1], 1e-3f);
+    
+    // Value-only alone stays value-only through the v2 round trip
+    ASSERT_EQ(0, dataset_save(in_path, &s[1], 1));
+    ASSERT_EQ(1, dataset_load(in_path, &out, 1));
+    ASSERT_FALSE(training_sample_has_policy(&out));
+    
+    remove(in_path);
+    remove(out_path);
+}
+
+static int analyze_progress_calls;
+static void count_analyze_progress(size_t done, size_t total) {
+    (void)done; (void)total;
+    analyze_progress_calls++;
+}
+
+TEST(training_dataset_analyze_is_thread_independent) {
+    const char *path = "/tmp/test_analyze.bin";
+    enum { N = 3 * DATASET_BLOCK_SAMPLES, DISTINCT = 2000 };
+    zobrist_init();
+    TrainingSample *samples = calloc(N, sizeof(TrainingSample));
+    ASSERT_NOT_NULL(samples);
+    for (int i = 0; i < N; i++) {
+        samples[i].state.piece[WHITE][PAWN] = (Bitboard)(i % DISTINCT + 1);
+        samples[i].state.piece[BLACK][LADY] = 1ULL << 63;
+        samples[i].target_value = (i % 3 - 1) * 1.0f;
+        samples[i].target_policy[i % CNN_POLICY_SIZE] = 1.0f;
+    }
+    ASSERT_EQ(0, dataset_save(path, samples, N));
+    
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    DatasetStats one, many;
+    analyze_progress_calls = 0;
+    ASSERT_EQ(0, dataset_analyze(path, &one, count_analyze_progress));
+    ASSERT_GT(analyze_progress_calls, 0);
+#ifdef _OPENMP
+    omp_set_num_threads(3);
+#endif
+    ASSERT_EQ(0, dataset_analyze(path, &many, NULL));
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    
+    ASSERT_EQ(N, one.count);
+    ASSERT_EQ(N / 3, one.wins);
+    ASSERT_EQ(N / 3, one.losses);
+    ASSERT_FLOAT_EQ(1.0f, one.avg_max_prob, 1e-3f);
+    ASSERT_EQ(one.wins, many.wins);
+    ASSERT_EQ(one.min_pieces, many.min_pieces);
+    ASSERT_EQ(one.max_pieces, many.max_pieces);
+    ASSERT_FLOAT_EQ(one.avg_pieces, many.avg_pieces, 1e-5f);
+    ASSERT_FLOAT_EQ(one.avg_entropy, many.avg_entropy, 1e-5f);
+    ASSERT_EQ(one.duplicates, many.duplicates);  // Register max is order-independent
+    
+    // Distinct positions are estimated, not counted
+    ASSERT_TRUE(one.duplicates_checked);
+    ASSERT_LT(abs(one.duplicates - (N - DISTINCT)), (N - DISTINCT) / 30);
+    
+    free(samples);
+    remove(path);
+}
+
 // =============================================================================
 // TRAINING SAMPLE TESTS
 // =============================================================================
@@ -193,6 +774,132 @@ TEST(training_sample_policy_sums_to_valid) {
     ASSERT_FLOAT_EQ(1.0f, sum, 0.01f);
 }
 
+TEST(training_reanalyse_rewrites_policies_in_order) {
+    const char *path = "/tmp/test_reanalyse.bin", *out_path = "/tmp/test_reanalyse_out.bin";
+    enum { N = 6 };
+    zobrist_init();
+    movegen_init();
+    CNNWeights weights;
+    cnn_init(&weights);
+    
+    // One game's first plies; odd ones value-only
+    TrainingSample in[N];
+    memset(in, 0, sizeof(in));
+    init_game(&in[0].state);
+    for (int i = 0; i < N; i++) {
+        if (i > 0) {
+            in[i].history[0] = in[i - 1].state;
+            in[i].history[1] = in[i - 1].history[0];
+            MoveList moves;
+            in[i].state = in[i - 1].state;
+            movegen_generate(&in[i].state, &moves);
+            ASSERT_GT(moves.count, 0);
+            apply_move(&in[i].state, &moves.moves[0]);
+        }
+        if (i % 2 == 0) in[i].target_policy[0] = 1.0f;
+        in[i].target_value = (i % 3) - 1.0f;
+    }
+    ASSERT_EQ(0, dataset_save(path, in, N));
+    
+    MCTSConfig mcts_cfg = mcts_get_preset(MCTS_PRESET_ALPHA_ZERO);
+    mcts_cfg.cnn_weights = &weights;
+    mcts_cfg.max_nodes = 16;
+    ReanalyseConfig cfg = { .threads = 2, .value_blend = 0.0f, .on_progress = NULL };
+    ReanalyseStats stats;
+    ASSERT_EQ(0, dataset_reanalyse(path, out_path, &cfg, &mcts_cfg, &stats));
+    ASSERT_EQ((size_t)N, stats.samples);
+    ASSERT_EQ((size_t)N, stats.searched);
+    ASSERT_EQ((size_t)N / 2, stats.filled);
+    
+    // Same positions in the same order, every one with a full policy, outcomes kept
+    TrainingSample out[N];
+    ASSERT_EQ(N, dataset_load(out_path, out, N));
+    for (int i = 0; i < N; i++) {
+        ASSERT_EQ(in[i].state.hash, out[i].state.hash);
+        ASSERT_EQ(in[i].history[0].hash, out[i].history[0].hash);
+        ASSERT_FLOAT_EQ(in[i].target_value, out[i].target_value, 1e-4f);
+        float sum = 0.0f;
+        for (int k = 0; k < CNN_POLICY_SIZE; k++) sum += out[i].target_policy[k];
+        ASSERT_FLOAT_EQ(1.0f, sum, 0.01f);
+    }
+    
+    // In place, values replaced by the search's
+    cfg.value_blend = 1.0f;
+    ASSERT_EQ(0, dataset_reanalyse(out_path, out_path, &cfg, &mcts_cfg, &stats));
+    ASSERT_EQ(N, dataset_load(out_path, out, N));
+    for (int i = 0; i < N; i++) {
+        ASSERT_EQ(in[i].state.hash, out[i].state.hash);
+        ASSERT_GE(out[i].target_value, -1.0f);
+        ASSERT_LE(out[i].target_value, 1.0f);
+    }
+    
+    cnn_free(&weights);
+    remove(path);
+    remove(out_path);
+}
+
+TEST(training_book_games_counts_played_moves) {
+    const char *path = "/tmp/test_book_games.bin", *book_path = "/tmp/test_book_games.book";
+    enum { GAMES = 3, PLIES = 4 };
+    zobrist_init();
+    movegen_init();
+    
+    // Three games: the first two open with the same move and white wins
+    // them, the third opens differently and black wins
+    TrainingSample in[GAMES * PLIES];
+    memset(in, 0, sizeof(in));
+    for (int g = 0; g < GAMES; g++) {
+        for (int i = 0; i < PLIES; i++) {
+            TrainingSample *s = &in[g * PLIES + i];
+            if (i == 0) {
+                init_game(&s->state);
+            } else {
+                s->history[0] = s[-1].state;
+                s->state = s[-1].state;
+                MoveList moves;
+                movegen_generate(&s->state, &moves);
+                apply_move(&s->state, &moves.moves[(i == 1 && g == 2) ? 1 : 0]);
+            }
+            int white_wins = g < 2;
+            int white_to_move = s->state.current_player == WHITE;
+            s->target_value = (white_wins == white_to_move) ? 1.0f : -1.0f;
+        }
+    }
+    ASSERT_EQ(0, dataset_save(path, in, GAMES * PLIES));
+    
+    BookBuilder b;
+    book_builder_init(&b);
+    BookGamesStats stats;
+    ASSERT_EQ(0, book_add_games(&b, path, &stats));
+    ASSERT_EQ((size_t)(GAMES * PLIES), stats.samples);
+    ASSERT_EQ((size_t)(GAMES * (PLIES - 1)), stats.moves);
+    ASSERT_GT(book_builder_write(&b, book_path, 1), 0);
+    book_builder_free(&b);
+    
+    OpeningBook book;
+    ASSERT_EQ(0, opening_book_open(&book, book_path));
+    BookEntry found[MAX_MOVES];
+    ASSERT_EQ(2, opening_book_probe(&book, &in[0].state, found, MAX_MOVES));
+    ASSERT_EQ(2u, found[0].visits);
+    ASSERT_FLOAT_EQ(1.0f, found[0].score, 1e-6f);
+    ASSERT_EQ(1u, found[1].visits);
+    ASSERT_FLOAT_EQ(0.0f, found[1].score, 1e-6f);
+    opening_book_close(&book);
+    
+    // Moves played fewer times than min_visits are left out
+    book_builder_init(&b);
+    ASSERT_EQ(0, book_add_games(&b, path, &stats));
+    ASSERT_GT(book_builder_write(&b, book_path, 2), 0);
+    book_builder_free(&b);
+    ASSERT_EQ(0, opening_book_open(&book, book_path));
+    ASSERT_EQ(1, opening_book_probe(&book, &in[0].state, found, MAX_MOVES));
+    ASSERT_EQ(2u, found[0].visits);
+    opening_book_close(&book);
+    
+    remove(path);
+    remove(book_path);
+}
+
 // =============================================================================
 // CNN TRAINING TESTS
 // =============================================================================
@@ -232,6 +939,138 @@ TEST(training_cnn_train_step_reduces_loss) {
     cnn_free(&weights);
 }
 
+TEST(training_batched_step_matches_per_sample) {
+    zobrist_init();
+    movegen_init();
+    
+    CNNWeights per_sample, batched;
+    cnn_init(&per_sample);
+    cnn_init(&batched);
+    const char *path = "/tmp/test_train_algo.bin";
+    ASSERT_EQ(0, cnn_save_weights(&per_sample, path));
+    ASSERT_EQ(0, cnn_load_weights(&batched, path));
+    
+    // One sample: batch statistics are that sample's, the two paths agree
+    TrainingSample sample = {0};
+    init_game(&sample.state);
+    sample.history[0] = sample.history[1] = sample.state;
+    sample.target_policy[3] = 0.25f;
+    sample.target_policy[40] = 0.75f;
+    sample.target_value = -0.5f;
+    
+    float p1, v1, p2, v2;
+    cnn_set_train_algo(CNN_TRAIN_PER_SAMPLE);
+    cnn_train_step(&per_sample, &sample, 1, 0.05f, 0.01f, 0.0f, 0.0f, &p1, &v1);
+    cnn_set_train_algo(CNN_TRAIN_BATCHED);
+    cnn_train_step(&batched, &sample, 1, 0.05f, 0.01f, 0.0f, 0.0f, &p2, &v2);
+    
+    ASSERT_FLOAT_EQ(p1, p2, 1e-4f);
+    ASSERT_FLOAT_EQ(v1, v2, 1e-5f);
+    for (int i = 0; i < 64 * CNN_INPUT_CHANNELS * 9; i += 7) {
+        ASSERT_FLOAT_EQ(per_sample.d_conv1_w[i], batched.d_conv1_w[i], 1e-4f);
+    }
+    for (int i = 0; i < 64 * 64 * 9; i += 13) {
+        ASSERT_FLOAT_EQ(per_sample.d_conv3_w[i], batched.d_conv3_w[i], 1e-4f);
+    }
+    for (int i = 0; i < 64; i++) {
+        ASSERT_FLOAT_EQ(per_sample.d_bn2_gamma[i], batched.d_bn2_gamma[i], 1e-4f);
+        ASSERT_FLOAT_EQ(per_sample.bn4_mean[i], batched.bn4_mean[i], 1e-5f);
+    }
+    for (int i = 0; i < 512 * 4097; i += 997) {
+        ASSERT_FLOAT_EQ(per_sample.d_policy_w[i], batched.d_policy_w[i], 1e-5f);
+    }
+    for (int i = 0; i < 256 * 4097; i += 991) {
+        ASSERT_FLOAT_EQ(per_sample.d_value_w1[i], batched.d_value_w1[i], 1e-5f);
+    }
+    
+    // A real batch (larger than one im2col chunk) trains
+    enum { BATCH = CONV_BATCH_CHUNK + 5 };
+    static TrainingSample samples[BATCH];
+    GameState state;
+    init_game(&state);
+    for (int b = 0; b < BATCH; b++) {
+        MoveList moves;
+        movegen_generate(&state, &moves);
+        if (moves.count == 0) init_game(&state);
+        else apply_move(&state, &moves.moves[b % moves.count]);
+        memset(&samples[b], 0, sizeof(samples[b]));
+        samples[b].state = state;
+        samples[b].target_policy[b % CNN_POLICY_SIZE] = 1.0f;
+        samples[b].target_value = (b % 2) ? 0.5f : -0.5f;
+    }
+    float first = cnn_train_step(&batched, samples, BATCH, 0.05f, 0.01f, 0.0f, 0.0f, &p2, &v2);
+    float last = first;
+    for (int i = 0; i < 15; i++) last = cnn_train_step(&batched, samples, BATCH, 0.05f, 0.01f, 0.0f, 0.0f, &p2, &v2);
+    ASSERT_LT(last, first);
+    
+    cnn_set_train_algo(CNN_TRAIN_ALGO_DEFAULT);
+    cnn_training_cleanup();
+    cnn_free(&per_sample);
+    cnn_free(&batched);
+    remove(path);
+}
+
+TEST(training_per_sample_gradients_independent_of_threads) {
+    zobrist_init();
+    movegen_init();
+    
+    CNNWeights serial, parallel;
+    cnn_init(&serial);
+    cnn_init(&parallel);
+    const char *path = "/tmp/test_train_threads.bin";
+    ASSERT_EQ(0, cnn_save_weights(&serial, path));
+    ASSERT_EQ(0, cnn_load_weights(&parallel, path));
+    
+    enum { BATCH = 7 };
+    TrainingSample samples[BATCH];
+    GameState state;
+    init_game(&state);
+    for (int b = 0; b < BATCH; b++) {
+        MoveList moves;
+        movegen_generate(&state, &moves);
+        apply_move(&state, &moves.moves[0]);
+        memset(&samples[b], 0, sizeof(samples[b]));
+        samples[b].state = state;
+        samples[b].target_policy[(b * 37) % CNN_POLICY_SIZE] = 1.0f;
+        samples[b].target_value = (b % 2) ? 1.0f : -1.0f;
+    }
+    
+    float p, v;
+    cnn_set_train_algo(CNN_TRAIN_PER_SAMPLE);
+#ifdef _OPENMP
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    cnn_train_step(&serial, samples, BATCH, 0.05f, 0.01f, 0.0f, 0.0f, &p, &v);
+#ifdef _OPENMP
+    omp_set_num_threads(3);
+#endif
+    // Twice: the second step reuses (and must re-zero) the thread buffers
+    cnn_train_step(&parallel, samples, BATCH, 0.0f, 0.0f, 0.0f, 0.0f, &p, &v);
+    cnn_train_step(&parallel, samples, BATCH, 0.05f, 0.01f, 0.0f, 0.0f, &p, &v);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_threads);
+#endif
+    
+    for (int i = 0; i < 64 * 64 * 9; i += 11) {
+        ASSERT_FLOAT_EQ(serial.d_conv2_w[i], parallel.d_conv2_w[i], 1e-4f);
+    }
+    for (int i = 0; i < 64; i++) {
+        ASSERT_FLOAT_EQ(serial.d_bn3_gamma[i], parallel.d_bn3_gamma[i], 1e-4f);
+        ASSERT_FLOAT_EQ(serial.d_bn1_beta[i], parallel.d_bn1_beta[i], 1e-4f);
+    }
+    for (int i = 0; i < 512 * 4097; i += 499) {
+        ASSERT_FLOAT_EQ(serial.d_policy_w[i], parallel.d_policy_w[i], 1e-5f);
+    }
+    ASSERT_FLOAT_EQ(serial.d_value_b2[0], parallel.d_value_b2[0], 1e-5f);
+    
+    cnn_set_train_algo(CNN_TRAIN_ALGO_DEFAULT);
+    cnn_training_cleanup();
+    cnn_free(&serial);
+    cnn_free(&parallel);
+    remove(path);
+}
+
 TEST(training_cnn_gradients_cleared_after_update) {
     CNNWeights weights;
     cnn_init(&weights);